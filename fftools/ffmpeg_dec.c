@@ -1150,6 +1150,7 @@ static int dec_open(DecoderPriv *dp, AVDictionary **dec_opts,
                     const DecoderOpts *o, AVFrame *param_out)
 {
     const AVCodec *codec = o->codec;
+    int shared_threads;
     int ret;
 
     dp->flags      = o->flags;
@@ -1207,12 +1208,22 @@ static int dec_open(DecoderPriv *dp, AVDictionary **dec_opts,
         return ret;
     }
 
+    // av_opt_set_dict2() removes the options it applies, so look for the user's one first
+    shared_threads = dec_threads_shared && !av_dict_get(*dec_opts, "shared_threads", NULL, 0);
+
     ret = av_opt_set_dict2(dp->dec_ctx, dec_opts, AV_OPT_SEARCH_CHILDREN);
     if (ret < 0) {
         av_log(dp, AV_LOG_ERROR, "Error applying decoder options: %s\n",
                av_err2str(ret));
         return ret;
     }
+
+    // only decoders with a process wide thread pool have the option
+    if (shared_threads) {
+        ret = av_opt_set_int(dp->dec_ctx, "shared_threads", 1, AV_OPT_SEARCH_CHILDREN);
+        if (ret < 0 && ret != AVERROR_OPTION_NOT_FOUND)
+            return ret;
+    }
     ret = check_avoptions(*dec_opts);
     if (ret < 0)
         return ret;
@@ -42,6 +42,7 @@
 #include "libavutil/avassert.h"
 #include "libavutil/avstring.h"
 #include "libavutil/avutil.h"
+#include "libavutil/eval.h"
 #include "libavutil/mathematics.h"
 #include "libavutil/mem.h"
 #include "libavutil/opt.h"
@@ -74,6 +75,7 @@ int stdin_interaction = 1;
 float max_error_rate  = 2.0/3;
 char *filter_nbthreads;
 int filter_complex_nbthreads = 0;
+int dec_threads_shared = 0;
 int vstats_version = 2;
 int auto_conversion_filters = 1;
 int64_t stats_period = 500000;
@@ -487,6 +489,20 @@ static int opt_sdp_file(void *optctx, const char *opt, const char *arg)
     return sch_sdp_filename(sch, arg);
 }
 
+static int opt_filter_queue_max_bytes(void *optctx, const char *opt, const char *arg)
+{
+    Scheduler *sch = optctx;
+    char *tail;
+    double size = av_strtod(arg, &tail);
+
+    if (*tail || size < 0 || size > SIZE_MAX) {
+        av_log(NULL, AV_LOG_ERROR, "Invalid size for -%s: %s\n", opt, arg);
+        return AVERROR(EINVAL);
+    }
+    sch_filter_queue_max_bytes(sch, size);
+    return 0;
+}
+
 #if CONFIG_VAAPI
 static int opt_vaapi_device(void *optctx, const char *opt, const char *arg)
 {
@@ -1556,6 +1572,12 @@ const OptionDef options[] = {
     { "filter_complex_threads", OPT_TYPE_INT, OPT_EXPERT,
         { &filter_complex_nbthreads },
         "number of threads for -filter_complex" },
+    { "filter_queue_max_bytes", OPT_TYPE_FUNC, OPT_FUNC_ARG | OPT_EXPERT,
+        { .func_arg = opt_filter_queue_max_bytes },
+        "maximum size of the frames queued for each filtergraph", "size" },
+    { "dec_threads_shared",     OPT_TYPE_BOOL, OPT_EXPERT,
+        { &dec_threads_shared },
+        "share one thread pool between the decoders supporting it" },
     { "lavfi",               OPT_TYPE_FUNC, OPT_FUNC_ARG | OPT_EXPERT,
         { .func_arg = opt_filter_complex },
         "create a complex filtergraph", "graph_description" },
@@ -298,6 +298,8 @@ struct Scheduler {
     char               *sdp_filename;
     int                 sdp_auto;
 
+    size_t              filter_queue_max_bytes;
+
     enum SchedulerState state;
     atomic_int          terminate;
     atomic_int          task_failed;
@@ -611,6 +613,23 @@ int sch_sdp_filename(Scheduler *sch, const char *sdp_filename)
     return sch->sdp_filename ? 0 : AVERROR(ENOMEM);
 }
 
+void sch_filter_queue_max_bytes(Scheduler *sch, size_t max_bytes)
+{
+    sch->filter_queue_max_bytes = max_bytes;
+}
+
+static size_t frame_size(const void *obj)
+{
+    const AVFrame *frame = obj;
+    size_t size = 0;
+
+    for (int i = 0; i < FF_ARRAY_ELEMS(frame->buf) && frame->buf[i]; i++)
+        size += frame->buf[i]->size;
+    for (int i = 0; i < frame->nb_extended_buf; i++)
+        size += frame->extended_buf[i]->size;
+    return size;
+}
+
 static const AVClass sch_mux_class = {
     .class_name                = "SchMux",
     .version                   = LIBAVUTIL_VERSION_INT,
@@ -1559,6 +1578,9 @@ int sch_start(Scheduler *sch)
     for (unsigned i = 0; i < sch->nb_filters; i++) {
         SchFilterGraph *fg = &sch->filters[i];
 
+        if (sch->filter_queue_max_bytes)
+            tq_set_max_bytes(fg->queue, sch->filter_queue_max_bytes, frame_size);
+
         ret = task_start(&fg->task);
         if (ret < 0)
             goto fail;
@@ -288,6 +288,16 @@ int sch_mux_stream_ready(Scheduler *sch, unsigned mux_idx, unsigned stream_idx);
  */
 int sch_sdp_filename(Scheduler *sch, const char *sdp_filename);
 
+/**
+ * Limit the size of the frames queued for each filtergraph, in bytes of frame
+ * data, in addition to DEFAULT_FRAME_THREAD_QUEUE_SIZE frames.  Decoders
+ * producing frames in bursts then block before the queued frames use more
+ * memory than this.  0, the default, sets no limit.
+ *
+ * Must be called before sch_start().
+ */
+void sch_filter_queue_max_bytes(Scheduler *sch, size_t max_bytes);
+
 /**
  * Add an encoder to the scheduler.
  *
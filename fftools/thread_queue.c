@@ -37,6 +37,7 @@ enum {
 typedef struct FifoElem {
     void        *obj;
     unsigned int stream_idx;
+    size_t       size;
 } FifoElem;
 
 struct ThreadQueue {
@@ -48,6 +49,10 @@ struct ThreadQueue {
     ObjPool *obj_pool;
     void   (*obj_move)(void *dst, void *src);
 
+    size_t (*obj_size)(const void *obj);
+    size_t   max_bytes;
+    size_t   queued_bytes;
+
     pthread_mutex_t lock;
     pthread_cond_t  cond;
 };
@@ -117,9 +122,29 @@ fail:
     return NULL;
 }
 
+void tq_set_max_bytes(ThreadQueue *tq, size_t max_bytes,
+                      size_t (*obj_size)(const void *obj))
+{
+    pthread_mutex_lock(&tq->lock);
+    tq->max_bytes = max_bytes;
+    tq->obj_size  = obj_size;
+    pthread_cond_broadcast(&tq->cond);
+    pthread_mutex_unlock(&tq->lock);
+}
+
+static int can_write(const ThreadQueue *tq, size_t size)
+{
+    if (!av_fifo_can_write(tq->fifo))
+        return 0;
+    // an item is always accepted into an empty queue, however large
+    return !tq->max_bytes || !tq->queued_bytes ||
+           tq->queued_bytes + size <= tq->max_bytes;
+}
+
 int tq_send(ThreadQueue *tq, unsigned int stream_idx, void *data)
 {
     int *finished;
+    size_t size;
     int ret;
 
     av_assert0(stream_idx < tq->nb_streams);
@@ -132,14 +157,16 @@ int tq_send(ThreadQueue *tq, unsigned int stream_idx, void *data)
         goto finish;
     }
 
-    while (!(*finished & FINISHED_RECV) && !av_fifo_can_write(tq->fifo))
+    size = tq->obj_size ? tq->obj_size(data) : 0;
+
+    while (!(*finished & FINISHED_RECV) && !can_write(tq, size))
         pthread_cond_wait(&tq->cond, &tq->lock);
 
     if (*finished & FINISHED_RECV) {
         ret = AVERROR_EOF;
         *finished |= FINISHED_SEND;
     } else {
-        FifoElem elem = { .stream_idx = stream_idx };
+        FifoElem elem = { .stream_idx = stream_idx, .size = size };
 
         ret = objpool_get(tq->obj_pool, &elem.obj);
         if (ret < 0)
@@ -149,6 +176,7 @@ int tq_send(ThreadQueue *tq, unsigned int stream_idx, void *data)
 
         ret = av_fifo_write(tq->fifo, &elem, 1);
         av_assert0(ret >= 0);
+        tq->queued_bytes += size;
         pthread_cond_broadcast(&tq->cond);
     }
 
@@ -165,6 +193,8 @@ static int receive_locked(ThreadQueue *tq, int *stream_idx,
     unsigned int nb_finished = 0;
 
     while (av_fifo_read(tq->fifo, &elem, 1) >= 0) {
+        tq->queued_bytes -= elem.size;
+
         if (tq->finished[elem.stream_idx] & FINISHED_RECV) {
             objpool_release(tq->obj_pool, &elem.obj);
             continue;
@@ -40,6 +40,18 @@ ThreadQueue *tq_alloc(unsigned int nb_streams, size_t queue_size,
                       ObjPool *obj_pool, void (*obj_move)(void *dst, void *src));
 void         tq_free(ThreadQueue **tq);
 
+/**
+ * Limit the amount of data stored in the queue, in addition to the number of
+ * items.  Senders block while adding an item would exceed the limit, unless
+ * the queue is empty.
+ *
+ * @param max_bytes the maximum size of the queued items, 0 for no limit
+ * @param obj_size callback returning the size of an item, called on the item
+ *                 passed to tq_send()
+ */
+void tq_set_max_bytes(ThreadQueue *tq, size_t max_bytes,
+                      size_t (*obj_size)(const void *obj));
+
 /**
  * Send an item for the given stream to the queue.
  *
@@ -0,0 +1,47 @@
+/*
+ * DSP for HEVC/VVC on aarch64
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/mem_internal.h"
+
+#include "h2656dsp.h"
+
+// the largest block of both codecs
+#define MAX_PB_SIZE 128
+
+#define H2656_PUT_HV(taps, bitd)                                                                                \
+void ff_h2656_put_ ## taps ## tap_hv_ ## bitd ## _neon(int16_t *dst, ptrdiff_t dststride,                       \
+    const uint8_t *src, ptrdiff_t srcstride, int height, const int8_t *hf, const int8_t *vf, int width)         \
+{                                                                                                               \
+    LOCAL_ALIGNED_16(int16_t, tmp, [(MAX_PB_SIZE + taps - 1) * MAX_PB_SIZE]);                                   \
+    const int extra_before = taps / 2 - 1;                                                                      \
+                                                                                                                \
+    ff_h2656_put_ ## taps ## tap_h_ ## bitd ## _neon(tmp, MAX_PB_SIZE * sizeof(*tmp),                           \
+        src - extra_before * srcstride, srcstride, height + taps - 1, hf, vf, width);                           \
+    ff_h2656_put_ ## taps ## tap_v_14_neon(dst, dststride, (const uint8_t *)(tmp + extra_before * MAX_PB_SIZE), \
+        MAX_PB_SIZE * sizeof(*tmp), height, hf, vf, width);                                                     \
+}
+
+#define H2656_PUT_HV_FUNCS(bitd) \
+    H2656_PUT_HV(4, bitd)        \
+    H2656_PUT_HV(8, bitd)
+
+H2656_PUT_HV_FUNCS(8)
+H2656_PUT_HV_FUNCS(10)
+H2656_PUT_HV_FUNCS(12)
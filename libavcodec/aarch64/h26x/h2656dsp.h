@@ -0,0 +1,49 @@
+/*
+ * DSP for HEVC/VVC on aarch64
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVCODEC_AARCH64_H26X_H2656DSP_H
+#define AVCODEC_AARCH64_H26X_H2656DSP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// The intermediate (bi-prediction) puts of any width, dststride is in bytes
+#define H2656_PEL_PROTOTYPE(name, D) \
+void ff_h2656_put_ ## name ## _ ## D ## _neon(int16_t *dst, ptrdiff_t dststride, const uint8_t *src, ptrdiff_t srcstride, \
+    int height, const int8_t *hf, const int8_t *vf, int width)
+
+#define H2656_PEL_PROTOTYPES(D)              \
+    H2656_PEL_PROTOTYPE(pixels,    D);       \
+    H2656_PEL_PROTOTYPE(4tap_h,    D);       \
+    H2656_PEL_PROTOTYPE(4tap_v,    D);       \
+    H2656_PEL_PROTOTYPE(4tap_hv,   D);       \
+    H2656_PEL_PROTOTYPE(8tap_h,    D);       \
+    H2656_PEL_PROTOTYPE(8tap_v,    D);       \
+    H2656_PEL_PROTOTYPE(8tap_hv,   D)
+
+H2656_PEL_PROTOTYPES(8);
+H2656_PEL_PROTOTYPES(10);
+H2656_PEL_PROTOTYPES(12);
+
+// the vertical passes of hv, on the int16_t output of the h pass
+H2656_PEL_PROTOTYPE(4tap_v, 14);
+H2656_PEL_PROTOTYPE(8tap_v, 14);
+
+#endif /* AVCODEC_AARCH64_H26X_H2656DSP_H */
@@ -25,6 +25,7 @@
 #include "libavutil/cpu.h"
 #include "libavutil/aarch64/cpu.h"
 #include "libavcodec/hevc/dsp.h"
+#include "libavcodec/aarch64/h26x/h2656dsp.h"
 
 void ff_hevc_v_loop_filter_chroma_8_neon(uint8_t *_pix, ptrdiff_t _stride,
                                          const int *_tc, const uint8_t *_no_p, const uint8_t *_no_q);
@@ -364,6 +365,40 @@ NEON8_FNPROTO(qpel_bi_hv, (uint8_t *dst, ptrdiff_t dststride,
         member[7][v][h] = ff_hevc_put_hevc_##fn##32_8_neon##ext; \
         member[9][v][h] = ff_hevc_put_hevc_##fn##64_8_neon##ext;
 
+#define H2656_PUT_FUNC(name, pel, fname, bd)                                                    \
+static void hevc_put_##name##_##bd##_neon(int16_t *dst, const uint8_t *src, ptrdiff_t srcstride, \
+    int height, intptr_t mx, intptr_t my, int width)                                            \
+{                                                                                               \
+    ff_h2656_put_##fname##_##bd##_neon(dst, 2 * MAX_PB_SIZE, src, srcstride, height,            \
+        ff_hevc_##pel##_filters[mx], ff_hevc_##pel##_filters[my], width);                       \
+}
+
+#define H2656_PUT_FUNCS(bd)                              \
+    H2656_PUT_FUNC(pel_pixels, qpel, pixels,  bd)        \
+    H2656_PUT_FUNC(qpel_h,     qpel, 8tap_h,  bd)        \
+    H2656_PUT_FUNC(qpel_v,     qpel, 8tap_v,  bd)        \
+    H2656_PUT_FUNC(qpel_hv,    qpel, 8tap_hv, bd)        \
+    H2656_PUT_FUNC(epel_h,     epel, 4tap_h,  bd)        \
+    H2656_PUT_FUNC(epel_v,     epel, 4tap_v,  bd)        \
+    H2656_PUT_FUNC(epel_hv,    epel, 4tap_hv, bd)
+
+H2656_PUT_FUNCS(10)
+H2656_PUT_FUNCS(12)
+
+// the shared HEVC/VVC functions take any width
+#define H2656_PUT_INIT(bd) do {                                      \
+    for (int i = 0; i < 10; i++) {                                   \
+        c->put_hevc_qpel[i][0][0] = hevc_put_pel_pixels_##bd##_neon; \
+        c->put_hevc_qpel[i][0][1] = hevc_put_qpel_h_##bd##_neon;     \
+        c->put_hevc_qpel[i][1][0] = hevc_put_qpel_v_##bd##_neon;     \
+        c->put_hevc_qpel[i][1][1] = hevc_put_qpel_hv_##bd##_neon;    \
+        c->put_hevc_epel[i][0][0] = hevc_put_pel_pixels_##bd##_neon; \
+        c->put_hevc_epel[i][0][1] = hevc_put_epel_h_##bd##_neon;     \
+        c->put_hevc_epel[i][1][0] = hevc_put_epel_v_##bd##_neon;     \
+        c->put_hevc_epel[i][1][1] = hevc_put_epel_hv_##bd##_neon;    \
+    }                                                                \
+} while (0)
+
 av_cold void ff_hevc_dsp_init_aarch64(HEVCDSPContext *c, const int bit_depth)
 {
     int cpu_flags = av_get_cpu_flags();
@@ -491,6 +526,7 @@ av_cold void ff_hevc_dsp_init_aarch64(HEVCDSPContext *c, const int bit_depth)
         c->idct_dc[1]                  = ff_hevc_idct_8x8_dc_10_neon;
         c->idct_dc[2]                  = ff_hevc_idct_16x16_dc_10_neon;
         c->idct_dc[3]                  = ff_hevc_idct_32x32_dc_10_neon;
+        H2656_PUT_INIT(10);
     }
     if (bit_depth == 12) {
         c->hevc_h_loop_filter_luma     = ff_hevc_h_loop_filter_luma_12_neon;
@@ -501,5 +537,6 @@ av_cold void ff_hevc_dsp_init_aarch64(HEVCDSPContext *c, const int bit_depth)
         c->add_residual[1]             = ff_hevc_add_residual_8x8_12_neon;
         c->add_residual[2]             = ff_hevc_add_residual_16x16_12_neon;
         c->add_residual[3]             = ff_hevc_add_residual_32x32_12_neon;
+        H2656_PUT_INIT(12);
     }
 }
@@ -0,0 +1,134 @@
+/*
+ * VVC DSP init for aarch64
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/aarch64/cpu.h"
+#include "libavcodec/vvc/ctu.h"
+#include "libavcodec/vvc/dec.h"
+#include "libavcodec/vvc/dsp.h"
+#include "libavcodec/aarch64/h26x/h2656dsp.h"
+
+#define AVG_PROTOTYPES(bd)                                                                      \
+void ff_vvc_avg_##bd##_neon(uint8_t *dst, ptrdiff_t dst_stride,                                 \
+    const int16_t *src0, const int16_t *src1, int width, int height);                           \
+void ff_vvc_w_avg_##bd##_neon(uint8_t *dst, ptrdiff_t dst_stride,                               \
+    const int16_t *src0, const int16_t *src1, int width, int height,                            \
+    uintptr_t w0_w1, uintptr_t offset_shift);                                                   \
+void ff_vvc_dmvr_##bd##_neon(int16_t *dst, const uint8_t *src, ptrdiff_t src_stride,            \
+    int height, intptr_t mx, intptr_t my, int width);                                           \
+
+AVG_PROTOTYPES(8)
+AVG_PROTOTYPES(10)
+AVG_PROTOTYPES(12)
+
+int ff_vvc_sad_neon(const int16_t *src0, const int16_t *src1, int dx, int dy, int block_w, int block_h);
+
+#define PUT_FUNC(name, bd)                                                                      \
+static void vvc_put_##name##_##bd##_neon(int16_t *dst, const uint8_t *src, ptrdiff_t src_stride, \
+    int height, const int8_t *hf, const int8_t *vf, int width)                                  \
+{                                                                                               \
+    ff_h2656_put_##name##_##bd##_neon(dst, 2 * MAX_PB_SIZE, src, src_stride,                    \
+        height, hf, vf, width);                                                                 \
+}
+
+#define PUT_FUNCS(bd)       \
+    PUT_FUNC(pixels,  bd)   \
+    PUT_FUNC(4tap_h,  bd)   \
+    PUT_FUNC(4tap_v,  bd)   \
+    PUT_FUNC(4tap_hv, bd)   \
+    PUT_FUNC(8tap_h,  bd)   \
+    PUT_FUNC(8tap_v,  bd)   \
+    PUT_FUNC(8tap_hv, bd)
+
+PUT_FUNCS(8)
+PUT_FUNCS(10)
+PUT_FUNCS(12)
+
+// the weights and the rounding are packed in two registers, there are too many arguments otherwise
+#define W_AVG_FUNC(bd)                                                                          \
+static void vvc_w_avg_##bd##_neon(uint8_t *dst, const ptrdiff_t dst_stride,                     \
+    const int16_t *src0, const int16_t *src1, const int width, const int height,                \
+    const int denom, const int w0, const int w1, const int o0, const int o1)                    \
+{                                                                                               \
+    const int shift          = denom + FFMAX(3, 15 - bd);                                       \
+    const int offset         = ((o0 + o1) * (1 << (bd - 8)) + 1) * (1 << (shift - 1));          \
+    const uintptr_t w0_w1    = ((uintptr_t)w0 << 32) | (uint32_t)w1;                            \
+    const uintptr_t off_shft = ((uintptr_t)offset << 32) | (uint32_t)shift;                     \
+                                                                                                \
+    ff_vvc_w_avg_##bd##_neon(dst, dst_stride, src0, src1, width, height, w0_w1, off_shft);      \
+}
+
+W_AVG_FUNC(8)
+W_AVG_FUNC(10)
+W_AVG_FUNC(12)
+
+static void vvc_sad_5x5_neon(int *sad, const int16_t *src0, const int16_t *src1,
+    const int block_w, const int block_h)
+{
+    for (int dy = 0; dy < 5; dy++) {
+        for (int dx = 0; dx < 5; dx++)
+            sad[dx] = ff_vvc_sad_neon(src0, src1, dx, dy, block_w, block_h);
+        sad += 5;
+    }
+}
+
+#define INTER_INIT(bd) do {                                                  \
+    for (int i = 0; i < 7; i++) {                                            \
+        c->inter.put[LUMA][i][0][0]   = vvc_put_pixels_##bd##_neon;          \
+        c->inter.put[LUMA][i][0][1]   = vvc_put_8tap_h_##bd##_neon;          \
+        c->inter.put[LUMA][i][1][0]   = vvc_put_8tap_v_##bd##_neon;          \
+        c->inter.put[LUMA][i][1][1]   = vvc_put_8tap_hv_##bd##_neon;         \
+        c->inter.put[CHROMA][i][0][0] = vvc_put_pixels_##bd##_neon;          \
+        c->inter.put[CHROMA][i][0][1] = vvc_put_4tap_h_##bd##_neon;          \
+        c->inter.put[CHROMA][i][1][0] = vvc_put_4tap_v_##bd##_neon;          \
+        c->inter.put[CHROMA][i][1][1] = vvc_put_4tap_hv_##bd##_neon;         \
+    }                                                                        \
+    /* the neon put and avg are faster than the c put_bi */                  \
+    memset(c->inter.put_bi, 0, sizeof(c->inter.put_bi));                    \
+    c->inter.avg            = ff_vvc_avg_##bd##_neon;                        \
+    c->inter.w_avg          = vvc_w_avg_##bd##_neon;                         \
+    c->inter.dmvr[0][0]     = ff_vvc_dmvr_##bd##_neon;                       \
+    c->inter.sad            = ff_vvc_sad_neon;                               \
+    c->inter.sad_5x5        = vvc_sad_5x5_neon;                              \
+} while (0)
+
+av_cold void ff_vvc_dsp_init_aarch64(VVCDSPContext *const c, const int bd, const int cpu_flags)
+{
+    if (!have_neon(cpu_flags))
+        return;
+
+    switch (bd) {
+    case 8:
+        INTER_INIT(8);
+        break;
+    case 10:
+        INTER_INIT(10);
+        break;
+    case 12:
+        INTER_INIT(12);
+        break;
+    default:
+        break;
+    }
+}
@@ -2862,6 +2862,14 @@ typedef struct AVCodecParserContext {
      * one returned by a decoder.
      */
     int format;
+
+    /**
+     * For a key frame starting a gradual decoding refresh, the number of
+     * pictures in output order until the first one decoded correctly, 0 if the
+     * frame itself is. For example, this corresponds to H.266 ph_recovery_poc_cnt.
+     * -1 for the other frames, or if the parser does not know.
+     */
+    int recovery_distance;
 } AVCodecParserContext;
 
 typedef struct AVCodecParser {
@@ -114,9 +114,47 @@ static const CBSBSFType h266_metadata_type = {
     .update_fragment = &h266_metadata_update_fragment,
 };
 
+// the units to read to build an AUD, the others are copied as they are
+static const CodedBitstreamUnitType aud_decompose_unit_types[] = {
+    VVC_TRAIL_NUT,
+    VVC_STSA_NUT,
+    VVC_RADL_NUT,
+    VVC_RASL_NUT,
+    VVC_IDR_W_RADL,
+    VVC_IDR_N_LP,
+    VVC_CRA_NUT,
+    VVC_GDR_NUT,
+    VVC_VPS_NUT,
+    VVC_SPS_NUT,
+    VVC_PPS_NUT,
+    VVC_PH_NUT,
+};
+
 static int h266_metadata_init(AVBSFContext *bsf)
 {
-    return ff_cbs_bsf_generic_init(bsf, &h266_metadata_type);
+    H266MetadataContext *ctx = bsf->priv_data;
+    int err;
+
+    err = ff_cbs_bsf_generic_init(bsf, &h266_metadata_type);
+    if (err < 0)
+        return err;
+
+    // an empty list, unlike none, means that no unit is read
+    ctx->common.input->decompose_unit_types    = aud_decompose_unit_types;
+    ctx->common.input->nb_decompose_unit_types = ctx->aud == BSF_ELEMENT_INSERT ?
+                                                 FF_ARRAY_ELEMS(aud_decompose_unit_types) : 0;
+    return 0;
+}
+
+static int h266_metadata_filter(AVBSFContext *bsf, AVPacket *pkt)
+{
+    H266MetadataContext *ctx = bsf->priv_data;
+
+    // nothing to edit
+    if (ctx->aud == BSF_ELEMENT_PASS)
+        return ff_bsf_get_packet_ref(bsf, pkt);
+
+    return ff_cbs_bsf_generic_filter(bsf, pkt);
 }
 
 #define OFFSET(x) offsetof(H266MetadataContext, x)
@@ -146,5 +184,5 @@ const FFBitStreamFilter ff_vvc_metadata_bsf = {
     .priv_data_size = sizeof(H266MetadataContext),
     .init           = &h266_metadata_init,
     .close          = &ff_cbs_bsf_generic_close,
-    .filter         = &ff_cbs_bsf_generic_filter,
+    .filter         = &h266_metadata_filter,
 };
@@ -21,6 +21,7 @@
 
 #include <string.h>
 
+#include "libavutil/buffer.h"
 #include "libavutil/intreadwrite.h"
 #include "libavutil/mem.h"
 
@@ -35,6 +36,9 @@
 typedef struct VVCBSFContext {
     uint8_t length_size;
     int extradata_parsed;
+
+    AVBufferPool *pool;     ///< output packets, of pool_size bytes
+    size_t pool_size;
 } VVCBSFContext;
 
 static int vvc_extradata_to_annexb(AVBSFContext *ctx)
@@ -211,11 +215,54 @@ static int vvc_mp4toannexb_init(AVBSFContext *ctx)
     return 0;
 }
 
+/**
+ * Check the NAL units of the packet and find whether it holds an IRAP.
+ * @return the size of the Annex B output, or a negative error code
+ */
+static int64_t scan_nal_units(AVBSFContext *ctx, const AVPacket *in, int *is_irap)
+{
+    VVCBSFContext *s = ctx->priv_data;
+    GetByteContext gb;
+    int64_t size = 0;
+    int has_vcl_or_ps = 0;
+
+    *is_irap = 0;
+    bytestream2_init(&gb, in->data, in->size);
+    while (bytestream2_get_bytes_left(&gb)) {
+        uint32_t nalu_size = 0;
+        int nalu_type;
+
+        if (bytestream2_get_bytes_left(&gb) < s->length_size)
+            return AVERROR_INVALIDDATA;
+
+        for (int i = 0; i < s->length_size; i++)
+            nalu_size = (nalu_size << 8) | bytestream2_get_byte(&gb);
+
+        if (nalu_size < 2 || nalu_size > bytestream2_get_bytes_left(&gb))
+            return AVERROR_INVALIDDATA;
+
+        nalu_type = (bytestream2_peek_be16(&gb) >> 3) & 0x1f;
+        *is_irap      |= nalu_type >= VVC_IDR_W_RADL && nalu_type <= VVC_RSV_IRAP_11;
+        has_vcl_or_ps |= nalu_type != VVC_AUD_NUT;
+        size          += 4 + nalu_size;
+        bytestream2_skip(&gb, nalu_size);
+    }
+
+    /* the extradata is added before the first nal unit other than an AUD */
+    if (*is_irap && has_vcl_or_ps)
+        size += ctx->par_out->extradata_size;
+    if (size > INT_MAX - AV_INPUT_BUFFER_PADDING_SIZE)
+        return AVERROR_INVALIDDATA;
+    return size;
+}
+
 static int vvc_mp4toannexb_filter(AVBSFContext *ctx, AVPacket *out)
 {
     VVCBSFContext *s = ctx->priv_data;
     AVPacket *in;
     GetByteContext gb;
+    uint8_t *dst;
+    int64_t size;
 
     int is_irap = 0;
     int added_extra = 0;
@@ -231,77 +278,65 @@ static int vvc_mp4toannexb_filter(AVBSFContext *ctx, AVPacket *out)
         return 0;
     }
 
-    bytestream2_init(&gb, in->data, in->size);
+    size = scan_nal_units(ctx, in, &is_irap);
+    if (size < 0) {
+        ret = size;
+        goto fail;
+    }
 
-    /* check if this packet contains an IRAP. The extradata will need to be added before any potential PH_NUT */
-    while (bytestream2_get_bytes_left(&gb)) {
-        uint32_t nalu_size = 0;
-        int nalu_type;
+    /* 4 byte sizes are replaced by start codes in place */
+    if (size == in->size && s->length_size == 4 && in->buf && av_buffer_is_writable(in->buf)) {
+        for (uint8_t *p = in->data; p < in->data + in->size;) {
+            const uint32_t nalu_size = AV_RB32(p);
 
-        if (bytestream2_get_bytes_left(&gb) < s->length_size) {
-            ret = AVERROR_INVALIDDATA;
-            goto fail;
+            AV_WB32(p, 1);
+            p += 4 + nalu_size;
         }
+        av_packet_move_ref(out, in);
+        av_packet_free(&in);
+        return 0;
+    }
 
-        for (i = 0; i < s->length_size; i++)
-            nalu_size = (nalu_size << 8) | bytestream2_get_byte(&gb);
-
-        if (nalu_size < 2 || nalu_size > bytestream2_get_bytes_left(&gb)) {
-            ret = AVERROR_INVALIDDATA;
+    if (!s->pool || s->pool_size < size + AV_INPUT_BUFFER_PADDING_SIZE) {
+        // some room for the next packets, which are often a bit larger
+        s->pool_size = FFMIN(size + size / 4, INT_MAX - AV_INPUT_BUFFER_PADDING_SIZE) +
+                       AV_INPUT_BUFFER_PADDING_SIZE;
+        av_buffer_pool_uninit(&s->pool);
+        s->pool = av_buffer_pool_init(s->pool_size, NULL);
+        if (!s->pool) {
+            ret = AVERROR(ENOMEM);
             goto fail;
         }
-
-        nalu_type = (bytestream2_peek_be16(&gb) >> 3) & 0x1f;
-        is_irap = nalu_type >= VVC_IDR_W_RADL && nalu_type <= VVC_RSV_IRAP_11;
-        if (is_irap) {
-            break;
-        }
-        bytestream2_seek(&gb, nalu_size, SEEK_CUR);
     }
+    out->buf = av_buffer_pool_get(s->pool);
+    if (!out->buf) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+    out->data = dst = out->buf->data;
+    out->size = size;
 
-    bytestream2_seek(&gb, 0, SEEK_SET);
+    bytestream2_init(&gb, in->data, in->size);
     while (bytestream2_get_bytes_left(&gb)) {
         uint32_t nalu_size = 0;
         int nalu_type;
-        int add_extradata, extra_size, prev_size;
-
-        if (bytestream2_get_bytes_left(&gb) < s->length_size) {
-            ret = AVERROR_INVALIDDATA;
-            goto fail;
-        }
 
         for (i = 0; i < s->length_size; i++)
             nalu_size = (nalu_size << 8) | bytestream2_get_byte(&gb);
 
-        if (nalu_size < 2 || nalu_size > bytestream2_get_bytes_left(&gb)) {
-            ret = AVERROR_INVALIDDATA;
-            goto fail;
-        }
-
         nalu_type = (bytestream2_peek_be16(&gb) >> 3) & 0x1f;
 
         /* prepend extradata to IRAP frames */
-        add_extradata = is_irap && nalu_type != VVC_AUD_NUT && !added_extra;
-        extra_size = add_extradata * ctx->par_out->extradata_size;
-        added_extra |= add_extradata;
-
-        if (FFMIN(INT_MAX, SIZE_MAX) < 4ULL + nalu_size + extra_size) {
-            ret = AVERROR_INVALIDDATA;
-            goto fail;
+        if (is_irap && nalu_type != VVC_AUD_NUT && !added_extra) {
+            memcpy(dst, ctx->par_out->extradata, ctx->par_out->extradata_size);
+            dst += ctx->par_out->extradata_size;
+            added_extra = 1;
         }
-
-        prev_size = out->size;
-
-        ret = av_grow_packet(out, 4 + nalu_size + extra_size);
-        if (ret < 0)
-            goto fail;
-
-        if (extra_size)
-            memcpy(out->data + prev_size, ctx->par_out->extradata, extra_size);
-        AV_WB32(out->data + prev_size + extra_size, 1);
-        bytestream2_get_buffer(&gb, out->data + prev_size + 4 + extra_size,
-                               nalu_size);
+        AV_WB32(dst, 1);
+        bytestream2_get_buffer(&gb, dst + 4, nalu_size);
+        dst += 4 + nalu_size;
     }
+    memset(dst, 0, AV_INPUT_BUFFER_PADDING_SIZE);
 
     ret = av_packet_copy_props(out, in);
     if (ret < 0)
@@ -315,6 +350,13 @@ static int vvc_mp4toannexb_filter(AVBSFContext *ctx, AVPacket *out)
     return ret;
 }
 
+static void vvc_mp4toannexb_close(AVBSFContext *ctx)
+{
+    VVCBSFContext *s = ctx->priv_data;
+
+    av_buffer_pool_uninit(&s->pool);
+}
+
 static const enum AVCodecID codec_ids[] = {
     AV_CODEC_ID_VVC, AV_CODEC_ID_NONE,
 };
@@ -325,4 +367,5 @@ const FFBitStreamFilter ff_vvc_mp4toannexb_bsf = {
     .priv_data_size = sizeof(VVCBSFContext),
     .init           = vvc_mp4toannexb_init,
     .filter         = vvc_mp4toannexb_filter,
+    .close          = vvc_mp4toannexb_close,
 };
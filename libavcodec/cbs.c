@@ -191,6 +191,17 @@ av_cold void ff_cbs_fragment_free(CodedBitstreamFragment *frag)
     frag->nb_units_allocated = 0;
 }
 
+int ff_cbs_read_unit(CodedBitstreamContext *ctx,
+                     CodedBitstreamUnit *unit)
+{
+    ff_refstruct_unref(&unit->content_ref);
+    unit->content = NULL;
+
+    av_assert0(unit->data && unit->data_ref);
+
+    return ctx->codec->read_unit(ctx, unit);
+}
+
 static int cbs_read_fragment_content(CodedBitstreamContext *ctx,
                                      CodedBitstreamFragment *frag)
 {
@@ -208,12 +219,7 @@ static int cbs_read_fragment_content(CodedBitstreamContext *ctx,
                 continue;
         }
 
-        ff_refstruct_unref(&unit->content_ref);
-        unit->content = NULL;
-
-        av_assert0(unit->data && unit->data_ref);
-
-        err = ctx->codec->read_unit(ctx, unit);
+        err = ff_cbs_read_unit(ctx, unit);
         if (err == AVERROR(ENOSYS)) {
             av_log(ctx->log_ctx, AV_LOG_VERBOSE,
                    "Decomposition unimplemented for unit %d "
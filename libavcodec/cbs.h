@@ -374,6 +374,16 @@ int ff_cbs_read(CodedBitstreamContext *ctx,
                 CodedBitstreamFragment *frag,
                 const uint8_t *data, size_t size);
 
+/**
+ * Decompose a single unit of a fragment read before.
+ *
+ * This is meant for units whose type was left out of decompose_unit_types
+ * when the fragment was read.  The internal state of the coded bitstream
+ * context is updated with any persistent data from the unit.
+ */
+int ff_cbs_read_unit(CodedBitstreamContext *ctx,
+                     CodedBitstreamUnit *unit);
+
 
 /**
  * Write the content of the fragment to its own internal buffer.
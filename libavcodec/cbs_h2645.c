@@ -773,6 +773,61 @@ cbs_h2645_replace_ps(5, VPS, vps, vps_video_parameter_set_id)
 cbs_h2645_replace_ps(5, SPS, sps, sps_seq_parameter_set_id)
 cbs_h2645_replace_ps(5, PPS, pps, pps_pic_parameter_set_id)
 
+/**
+ * Keep a copy of the unit a parameter set was read from, none when it was
+ * written.
+ */
+static int cbs_h266_store_ps_data(H266ParamSetData *d, const CodedBitstreamUnit *unit)
+{
+    av_freep(&d->data);
+    d->size = 0;
+    if (!unit->data)
+        return 0;
+
+    d->data = av_memdup(unit->data, unit->data_size);
+    if (!d->data)
+        return AVERROR(ENOMEM);
+    d->size = unit->data_size;
+    return 0;
+}
+
+/**
+ * Reuse the available parameter set if the unit is the one it was read from.
+ * @return 1 if the unit content was set, 0 if the unit must be read
+ */
+static int cbs_h266_reuse_ps(CodedBitstreamContext *ctx, CodedBitstreamUnit *unit)
+{
+    CodedBitstreamH266Context *priv = ctx->priv_data;
+    const H266ParamSetData *d;
+    void *ps;
+
+    // the ids are the first syntax elements after the nal unit header
+    if (ctx->trace_enable || unit->data_size < 3)
+        return 0;
+    switch (unit->type) {
+    case VVC_VPS_NUT:
+        ps = priv->vps[unit->data[2] >> 4];
+        d  = &priv->vps_data[unit->data[2] >> 4];
+        break;
+    case VVC_SPS_NUT:
+        ps = priv->sps[unit->data[2] >> 4];
+        d  = &priv->sps_data[unit->data[2] >> 4];
+        break;
+    case VVC_PPS_NUT:
+        ps = priv->pps[unit->data[2] >> 2];
+        d  = &priv->pps_data[unit->data[2] >> 2];
+        break;
+    default:
+        return 0;
+    }
+    if (!ps || d->size != unit->data_size || memcmp(d->data, unit->data, d->size))
+        return 0;
+
+    unit->content_ref = ff_refstruct_ref(ps);
+    unit->content     = unit->content_ref;
+    return 1;
+}
+
 #define cbs_h266_replace_ps(h26n, ps_name, ps_var, id_element) \
 static int cbs_h26 ## h26n ## _replace_ ## ps_var(CodedBitstreamContext *ctx, \
                                                   CodedBitstreamUnit *unit)  \
@@ -785,7 +840,7 @@ static int cbs_h26 ## h26n ## _replace_ ## ps_var(CodedBitstreamContext *ctx, \
         return err; \
     av_assert0(unit->content_ref); \
     ff_refstruct_replace(&priv->ps_var[id], unit->content_ref); \
-    return 0; \
+    return cbs_h266_store_ps_data(&priv->ps_var ## _data[id], unit); \
 }
 
 cbs_h266_replace_ps(6, VPS, vps, vps_video_parameter_set_id)
@@ -808,7 +863,7 @@ static int cbs_h266_replace_sps(CodedBitstreamContext *ctx,
         }
     }
     ff_refstruct_replace(&priv->sps[id], unit->content_ref);
-    return 0;
+    return cbs_h266_store_ps_data(&priv->sps_data[id], unit);
 }
 
 static int cbs_h266_replace_ph(CodedBitstreamContext *ctx,
@@ -1070,13 +1125,22 @@ static int cbs_h265_read_nal_unit(CodedBitstreamContext *ctx,
 static int cbs_h266_read_nal_unit(CodedBitstreamContext *ctx,
                                   CodedBitstreamUnit *unit)
 {
+    const CodedBitstreamH266Context *h266 = ctx->priv_data;
     GetBitContext gbc;
     int err;
 
+    // nuh_layer_id is in the first byte of the nal unit header
+    if (h266->skip_layers && unit->data_size >= 2 &&
+        (h266->skip_layers >> (unit->data[0] & 0x3f) & 1))
+        return AVERROR(EAGAIN);
+
     err = init_get_bits8(&gbc, unit->data, unit->data_size);
     if (err < 0)
         return err;
 
+    if (cbs_h266_reuse_ps(ctx, unit))
+        return 0;
+
     err = ff_cbs_alloc_unit_content(ctx, unit);
     if (err < 0)
         return err;
@@ -1945,12 +2009,21 @@ static void cbs_h266_flush(CodedBitstreamContext *ctx)
 {
     CodedBitstreamH266Context *h266 = ctx->priv_data;
 
-    for (int i = 0; i < FF_ARRAY_ELEMS(h266->vps); i++)
+    for (int i = 0; i < FF_ARRAY_ELEMS(h266->vps); i++) {
         ff_refstruct_unref(&h266->vps[i]);
-    for (int i = 0; i < FF_ARRAY_ELEMS(h266->sps); i++)
+        av_freep(&h266->vps_data[i].data);
+        h266->vps_data[i].size = 0;
+    }
+    for (int i = 0; i < FF_ARRAY_ELEMS(h266->sps); i++) {
         ff_refstruct_unref(&h266->sps[i]);
-    for (int i = 0; i < FF_ARRAY_ELEMS(h266->pps); i++)
+        av_freep(&h266->sps_data[i].data);
+        h266->sps_data[i].size = 0;
+    }
+    for (int i = 0; i < FF_ARRAY_ELEMS(h266->pps); i++) {
         ff_refstruct_unref(&h266->pps[i]);
+        av_freep(&h266->pps_data[i].data);
+        h266->pps_data[i].size = 0;
+    }
     ff_refstruct_unref(&h266->ph_ref);
 }
 
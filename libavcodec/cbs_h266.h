@@ -853,6 +853,11 @@ typedef struct H266RawSEI {
     SEIRawMessageList    message_list;
 } H266RawSEI;
 
+typedef struct H266ParamSetData {
+    uint8_t *data;
+    size_t   size;
+} H266ParamSetData;
+
 typedef struct CodedBitstreamH266Context {
     // Reader/writer context in common with the H.264 implementation.
     CodedBitstreamH2645Context common;
@@ -862,8 +867,19 @@ typedef struct CodedBitstreamH266Context {
     H266RawVPS  *vps[VVC_MAX_VPS_COUNT]; ///< RefStruct references
     H266RawSPS  *sps[VVC_MAX_SPS_COUNT]; ///< RefStruct references
     H266RawPPS  *pps[VVC_MAX_PPS_COUNT]; ///< RefStruct references
+
+    // The units the parameter sets above were read from.  A unit identical
+    // to the one of the available parameter set with its id is not read
+    // again, its content is a new reference to that parameter set.
+    H266ParamSetData vps_data[VVC_MAX_VPS_COUNT];
+    H266ParamSetData sps_data[VVC_MAX_SPS_COUNT];
+    H266ParamSetData pps_data[VVC_MAX_PPS_COUNT];
     H266RawPictureHeader *ph;
     void *ph_ref; ///< RefStruct reference backing ph above
+
+    // Bit n set: the units with nuh_layer_id n are not decomposed, so the
+    // parameter sets of those layers do not replace the ones above.
+    uint64_t skip_layers;
 } CodedBitstreamH266Context;
 
 #endif /* AVCODEC_CBS_H266_H */
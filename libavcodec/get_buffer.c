@@ -62,6 +62,16 @@ static void frame_pool_free(FFRefStructOpaque unused, void *obj)
         av_buffer_pool_uninit(&pool->pools[i]);
 }
 
+static AVBufferRef *buffer_allocz_huge(size_t size)
+{
+    AVBufferRef *ret = av_buffer_alloc_huge(size);
+    if (!ret)
+        return NULL;
+
+    memset(ret->data, 0, size);
+    return ret;
+}
+
 static int update_frame_pool(AVCodecContext *avctx, AVFrame *frame)
 {
     FramePool *pool = avctx->internal->pool;
@@ -89,6 +99,10 @@ static int update_frame_pool(AVCodecContext *avctx, AVFrame *frame)
         int unaligned;
         ptrdiff_t linesize1[4];
         size_t size[4];
+        AVBufferRef *(*alloc)(size_t size) = CONFIG_MEMORY_POISONING ? NULL : av_buffer_allocz;
+
+        if (avctx->internal->huge_pages)
+            alloc = CONFIG_MEMORY_POISONING ? av_buffer_alloc_huge : buffer_allocz_huge;
 
         avcodec_align_dimensions2(avctx, &w, &h, pool->stride_align);
 
@@ -119,10 +133,7 @@ static int update_frame_pool(AVCodecContext *avctx, AVFrame *frame)
                     ret = AVERROR(EINVAL);
                     goto fail;
                 }
-                pool->pools[i] = av_buffer_pool_init(size[i] + 16 + STRIDE_ALIGN - 1,
-                                                     CONFIG_MEMORY_POISONING ?
-                                                        NULL :
-                                                        av_buffer_allocz);
+                pool->pools[i] = av_buffer_pool_init(size[i] + 16 + STRIDE_ALIGN - 1, alloc);
                 if (!pool->pools[i]) {
                     ret = AVERROR(ENOMEM);
                     goto fail;
@@ -33,13 +33,14 @@
 
 #include "hevc/hevc.h"
 
-int ff_h2645_extract_rbsp(const uint8_t *src, int length,
-                          H2645RBSP *rbsp, H2645NAL *nal, int small_padding)
+/**
+ * Find the first byte pair that may start an escape or a start code, *length is
+ * cut at a start code found on the way.
+ */
+static av_always_inline int find_first_zero_pair(const uint8_t *src, int *plength)
 {
-    int i, si, di;
-    uint8_t *dst;
+    int i, length = *plength;
 
-    nal->skipped_bytes = 0;
 #define STARTCODE_TEST                                                  \
         if (i + 2 < length && src[i + 1] == 0 &&                        \
            (src[i + 2] == 3 || src[i + 2] == 1)) {                      \
@@ -86,6 +87,76 @@ int ff_h2645_extract_rbsp(const uint8_t *src, int length,
     }
 #endif /* HAVE_FAST_UNALIGNED */
 
+    *plength = length;
+    return i;
+}
+
+/**
+ * Find the first position from i of 00 00 followed by an escape (03) or by
+ * what ends the NAL unit (01 or 02), length if there is none.  Words without
+ * a zero byte are skipped at once.
+ */
+static av_always_inline int find_next_zero_pair(const uint8_t *src, int i, const int length)
+{
+#if HAVE_FAST_64BIT
+#define ZERO_TEST(w) (((w) - 0x0101010101010101ULL) & ~(w) & 0x8080808080808080ULL)
+#else
+#define ZERO_TEST(w) (((w) - 0x01010101U) & ~(w) & 0x80808080U)
+#endif
+    const int step = HAVE_FAST_64BIT ? 8 : 4;
+
+    while (i + 2 < length) {
+        if (HAVE_FAST_UNALIGNED && i + step + 2 <= length) {
+#if HAVE_FAST_64BIT
+            const uint64_t w = AV_RN64(src + i);
+#else
+            const uint32_t w = AV_RN32(src + i);
+#endif
+            if (!ZERO_TEST(w)) {
+                i += step;
+                continue;
+            }
+        }
+        if (!src[i] && !src[i + 1] && src[i + 2] && src[i + 2] <= 3)
+            return i;
+        i++;
+    }
+#undef ZERO_TEST
+    return length;
+}
+
+static int add_skipped_byte(H2645NAL *nal, const int pos)
+{
+    if (!nal->skipped_bytes_pos)
+        return 0;
+
+    nal->skipped_bytes++;
+    if (nal->skipped_bytes_pos_size < nal->skipped_bytes) {
+        nal->skipped_bytes_pos_size *= 2;
+        av_assert0(nal->skipped_bytes_pos_size >= nal->skipped_bytes);
+        av_reallocp_array(&nal->skipped_bytes_pos,
+                nal->skipped_bytes_pos_size,
+                sizeof(*nal->skipped_bytes_pos));
+        if (!nal->skipped_bytes_pos) {
+            nal->skipped_bytes_pos_size = 0;
+            return AVERROR(ENOMEM);
+        }
+    }
+    nal->skipped_bytes_pos[nal->skipped_bytes - 1] = pos;
+    return 0;
+}
+
+int ff_h2645_extract_rbsp(const uint8_t *src, int length,
+                          H2645RBSP *rbsp, H2645NAL *nal, int small_padding)
+{
+    int i, si, di, ret;
+    uint8_t *dst;
+
+    nal->skipped_bytes = 0;
+    nal->escaped       = 0;
+
+    i = find_first_zero_pair(src, &length);
+
     if (i >= length - 1 && small_padding) { // no escaped 0
         nal->data     =
         nal->raw_data = src;
@@ -100,38 +171,25 @@ int ff_h2645_extract_rbsp(const uint8_t *src, int length,
     memcpy(dst, src, i);
     si = di = i;
     while (si + 2 < length) {
-        // remove escapes (very rare 1:2^22)
-        if (src[si + 2] > 3) {
-            dst[di++] = src[si++];
-            dst[di++] = src[si++];
-        } else if (src[si] == 0 && src[si + 1] == 0 && src[si + 2] != 0) {
-            if (src[si + 2] == 3) { // escape
-                dst[di++] = 0;
-                dst[di++] = 0;
-                si       += 3;
-
-                if (nal->skipped_bytes_pos) {
-                    nal->skipped_bytes++;
-                    if (nal->skipped_bytes_pos_size < nal->skipped_bytes) {
-                        nal->skipped_bytes_pos_size *= 2;
-                        av_assert0(nal->skipped_bytes_pos_size >= nal->skipped_bytes);
-                        av_reallocp_array(&nal->skipped_bytes_pos,
-                                nal->skipped_bytes_pos_size,
-                                sizeof(*nal->skipped_bytes_pos));
-                        if (!nal->skipped_bytes_pos) {
-                            nal->skipped_bytes_pos_size = 0;
-                            return AVERROR(ENOMEM);
-                        }
-                    }
-                    if (nal->skipped_bytes_pos)
-                        nal->skipped_bytes_pos[nal->skipped_bytes-1] = di - 1;
-                }
-                continue;
-            } else // next start code
-                goto nsc;
-        }
+        // copy up to the next escape (very rare 1:2^22) or start code
+        const int next = find_next_zero_pair(src, si, length);
 
-        dst[di++] = src[si++];
+        memcpy(dst + di, src + si, next - si);
+        di += next - si;
+        si  = next;
+        if (si + 2 >= length)
+            break;
+
+        if (src[si + 2] == 3) { // escape
+            dst[di++] = 0;
+            dst[di++] = 0;
+            si       += 3;
+
+            ret = add_skipped_byte(nal, di - 1);
+            if (ret < 0)
+                return ret;
+        } else // next start code
+            goto nsc;
     }
     while (si < length)
         dst[di++] = src[si++];
@@ -148,6 +206,40 @@ nsc:
     return si;
 }
 
+/**
+ * Like ff_h2645_extract_rbsp(), but leave the escapes in place and only
+ * record the positions of the emulation prevention bytes in src.
+ */
+static int find_escapes(const uint8_t *src, int length, H2645NAL *nal)
+{
+    int i, ret;
+
+    nal->skipped_bytes = 0;
+    nal->escaped       = 1;
+
+    i = find_first_zero_pair(src, &length);
+    if (i > length)
+        i = length;
+
+    while ((i = find_next_zero_pair(src, i, length)) < length) {
+        if (src[i + 2] != 3) { // next start code
+            length = i;
+            break;
+        }
+        ret = add_skipped_byte(nal, i + 2);
+        if (ret < 0)
+            return ret;
+        i += 3;
+    }
+
+    nal->data     =
+    nal->raw_data = src;
+    nal->size     =
+    nal->raw_size = length;
+
+    return length;
+}
+
 static const char *const vvc_nal_type_name[32] = {
     "TRAIL_NUT", // VVC_TRAIL_NUT
     "STSA_NUT", // VVC_STSA_NUT
@@ -549,7 +641,11 @@ int ff_h2645_packet_split(H2645Packet *pkt, const uint8_t *buf, int length,
         }
         nal = &pkt->nals[pkt->nb_nals];
 
-        consumed = ff_h2645_extract_rbsp(bc.buffer, extract_length, &pkt->rbsp, nal, small_padding);
+        if (pkt->keep_vcl_escapes && codec_id == AV_CODEC_ID_VVC && small_padding &&
+            extract_length >= 2 && (bc.buffer[1] >> 3) <= VVC_RSV_IRAP_11)
+            consumed = find_escapes(bc.buffer, extract_length, nal);
+        else
+            consumed = ff_h2645_extract_rbsp(bc.buffer, extract_length, &pkt->rbsp, nal, small_padding);
         if (consumed < 0)
             return consumed;
 
@@ -69,6 +69,13 @@ typedef struct H2645NAL {
     int skipped_bytes;
     int skipped_bytes_pos_size;
     int *skipped_bytes_pos;
+
+    /**
+     * The emulation prevention bytes were left in data, data == raw_data and
+     * skipped_bytes_pos holds their positions in it instead of the positions in
+     * the extracted RBSP.
+     */
+    int escaped;
 } H2645NAL;
 
 typedef struct H2645RBSP {
@@ -85,6 +92,12 @@ typedef struct H2645Packet {
     int nb_nals;
     int nals_allocated;
     unsigned nal_buffer_size;
+
+    /**
+     * VVC only, set by the caller to keep the emulation prevention bytes
+     * of the VCL NAL units, see H2645NAL.escaped.
+     */
+    int keep_vcl_escapes;
 } H2645Packet;
 
 /**
@@ -61,6 +61,12 @@ typedef struct AVCodecInternal {
 
     struct FramePool *pool;
 
+    /**
+     * Decoders can set this during init to back the buffers of the default
+     * get_buffer2() pools with huge pages.
+     */
+    int huge_pages;
+
     struct FFRefStructPool *progress_frame_pool;
 
     void *thread_ctx;
@@ -43,6 +43,9 @@
 #include "vvc_paramset.h"
 #include "vvc_parse_extradata.h"
 
+#define POOLS_PER_PLANE 4
+#define POOL_SIZE_ALIGN 4096
+
 typedef struct VVdeCContext {
     AVClass      *av_class;
     vvdecDecoder *vvdecDec;
@@ -51,8 +54,14 @@ typedef struct VVdeCContext {
     int          is_nalff;
     int          nal_length_size;
     bool         bFlush;
-    AVBufferPool *pools[3];     /** Pools for each data plane. */
-    int          pool_size[3];
+    /**
+     * Pools for each data plane, per size class.  They are kept across
+     * resolution changes and only the least recently created one of a plane
+     * is replaced when all are in use for other sizes.
+     */
+    AVBufferPool *pools[3][POOLS_PER_PLANE];
+    int          pool_size[3][POOLS_PER_PLANE];
+    int          next_pool[3];
 } VVdeCContext;
 
 
@@ -68,26 +77,39 @@ static void *ff_vvdec_buffer_allocator(void *ctx, vvdecComponentType comp,
 {
     AVBufferRef *buf;
     VVdeCContext *s;
-    int plane;
+    int plane, i;
+    uint64_t alignedsize;
 
-    uint32_t alignedsize = FFALIGN(size, alignment);
     s = (VVdeCContext *) ctx;
     plane = (int) comp;
 
-    if (plane < 0 || plane > 3)
+    if (plane < 0 || plane >= FF_ARRAY_ELEMS(s->pools))
+        return NULL;
+
+    // round up to a size class, so close sizes share a pool
+    alignedsize = FFALIGN((uint64_t) FFALIGN(size, alignment), POOL_SIZE_ALIGN);
+    if (alignedsize > INT_MAX)
         return NULL;
 
-    if (alignedsize != s->pool_size[plane]) {
-        av_buffer_pool_uninit(&s->pools[plane]);
-        s->pools[plane] = av_buffer_pool_init(alignedsize, NULL);
-        if (!s->pools[plane]) {
-            s->pool_size[plane] = 0;
+    for (i = 0; i < POOLS_PER_PLANE; i++)
+        if (s->pools[plane][i] && s->pool_size[plane][i] == alignedsize)
+            break;
+
+    if (i == POOLS_PER_PLANE) {
+        i = s->next_pool[plane];
+        s->next_pool[plane] = (i + 1) % POOLS_PER_PLANE;
+
+        // buffers still in use keep the replaced pool alive until returned
+        av_buffer_pool_uninit(&s->pools[plane][i]);
+        s->pools[plane][i] = av_buffer_pool_init(alignedsize, NULL);
+        if (!s->pools[plane][i]) {
+            s->pool_size[plane][i] = 0;
             return NULL;
         }
-        s->pool_size[plane] = alignedsize;
+        s->pool_size[plane][i] = alignedsize;
     }
 
-    buf = av_buffer_pool_get(s->pools[plane]);
+    buf = av_buffer_pool_get(s->pools[plane][i]);
     if (!buf)
         return NULL;
 
@@ -350,10 +372,9 @@ static av_cold int ff_vvdec_decode_init(AVCodecContext *avctx)
     s->is_nalff = 0;
     s->nal_length_size = 0;
 
-    for (i = 0; i < FF_ARRAY_ELEMS(s->pools); i++) {
-        s->pools[i] = NULL;
-        s->pool_size[i] = 0;
-    }
+    memset(s->pools, 0, sizeof(s->pools));
+    memset(s->pool_size, 0, sizeof(s->pool_size));
+    memset(s->next_pool, 0, sizeof(s->next_pool));
 
     if (!avctx->internal->is_copy) {
         if (avctx->extradata_size > 0 && avctx->extradata) {
@@ -373,8 +394,10 @@ static av_cold int ff_vvdec_decode_close(AVCodecContext *avctx)
     VVdeCContext *s = (VVdeCContext *) avctx->priv_data;
 
     for (int i = 0; i < FF_ARRAY_ELEMS(s->pools); i++) {
-        av_buffer_pool_uninit(&s->pools[i]);
-        s->pool_size[i] = 0;
+        for (int j = 0; j < POOLS_PER_PLANE; j++) {
+            av_buffer_pool_uninit(&s->pools[i][j]);
+            s->pool_size[i][j] = 0;
+        }
     }
 
     if (0 != vvdec_decoder_close(s->vvdecDec)) {
@@ -452,24 +475,37 @@ static av_cold int ff_vvdec_decode_frame(AVCodecContext *avctx, AVFrame *data,
                     goto fail;
             }
 
-            if (frame->planes[0].allocator)
-                avframe->buf[0] =
-                    av_buffer_ref((AVBufferRef *) frame->planes[0].allocator);
-            if (frame->planes[1].allocator)
-                avframe->buf[1] =
-                    av_buffer_ref((AVBufferRef *) frame->planes[1].allocator);
-            if (frame->planes[2].allocator)
-                avframe->buf[2] =
-                    av_buffer_ref((AVBufferRef *) frame->planes[2].allocator);
-
-            for (int i = 0; i < 4; i++) {
-                avframe->data[i] = (uint8_t *) src_data[i];
-                avframe->linesize[i] = src_linesizes[i];
-            }
+            if (avctx->get_buffer2 != avcodec_default_get_buffer2) {
+                /* vvdec picks its own strides and margins, so a user
+                 * allocator gets a copy of the picture */
+                ret = ff_get_buffer(avctx, avframe, 0);
+                if (ret < 0)
+                    goto fail;
 
-            ret = ff_decode_frame_props(avctx, avframe);
-            if (ret < 0)
-                goto fail;
+                av_image_copy(avframe->data, avframe->linesize,
+                              src_data, src_linesizes,
+                              avctx->pix_fmt, frame->width, frame->height);
+            } else {
+                for (int i = 0; i < 3; i++) {
+                    if (!frame->planes[i].allocator)
+                        continue;
+                    avframe->buf[i] =
+                        av_buffer_ref((AVBufferRef *) frame->planes[i].allocator);
+                    if (!avframe->buf[i]) {
+                        ret = AVERROR(ENOMEM);
+                        goto fail;
+                    }
+                }
+
+                for (int i = 0; i < 4; i++) {
+                    avframe->data[i] = (uint8_t *) src_data[i];
+                    avframe->linesize[i] = src_linesizes[i];
+                }
+
+                ret = ff_decode_frame_props(avctx, avframe);
+                if (ret < 0)
+                    goto fail;
+            }
 
             if (frame->picAttributes) {
                 if (frame->picAttributes->isRefPic)
@@ -553,7 +589,8 @@ FFCodec ff_libvvdec_decoder = {
     CODEC_LONG_NAME("H.266 / VVC Decoder VVdeC"),
     .p.type         = AVMEDIA_TYPE_VIDEO,
     .p.id           = AV_CODEC_ID_VVC,
-    .p.capabilities = AV_CODEC_CAP_DELAY | AV_CODEC_CAP_OTHER_THREADS,
+    .p.capabilities = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_DELAY |
+                      AV_CODEC_CAP_OTHER_THREADS,
     .p.profiles     = NULL_IF_CONFIG_SMALL(ff_vvc_profiles),
     .p.priv_class   = &class_libvvdec,
     .p.wrapper_name = "libvvdec",
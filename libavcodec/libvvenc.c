@@ -24,9 +24,12 @@
 #include <vvenc/vvencCfg.h>
 #include <vvenc/version.h>
 
+#include "libavutil/avassert.h"
 #include "libavutil/avstring.h"
+#include "libavutil/buffer.h"
 #include "libavutil/avutil.h"
 #include "libavutil/common.h"
+#include "libavutil/fifo.h"
 #include "libavutil/frame.h"
 #include "libavutil/imgutils.h"
 #include "libavutil/log.h"
@@ -49,7 +52,19 @@ typedef struct VVenCContext {
     AVClass         *class;
     vvencEncoder    *encoder;
     vvencAccessUnit *au;
+    vvencYUVBuffer  *yuvbuf;        ///< input converted from the formats vvenc cannot read in place
+    AVFrame         *frame;
+    /* vvenc writes the access units straight into the buffers handed out as packets */
+    AVBufferPool    *pool;
+    AVBufferRef     *payload_buf;
+    int              payload_size;
     bool             encode_done;
+    /* with AV_CODEC_FLAG_RECON_FRAME, the packets wait for their reconstructed pictures */
+    AVFifo          *pkt_fifo;      ///< AVPacket*, in coded order
+    AVFrame        **recon;         ///< reconstructed pictures not returned yet
+    int              nb_recon;
+    int              recon_error;   ///< set by the callback when a picture could not be kept
+    enum AVPixelFormat recon_fmt;
     int   preset;
     int   qp;
     int   qpa;
@@ -57,6 +72,10 @@ typedef struct VVenCContext {
     char *level;
     int   tier;
     char *stats;
+    int   max_parallel_frames;
+    int   wpp;
+    char *tiles;
+    int   lookahead;
     AVDictionary *vvenc_opts;
 } VVenCContext;
 
@@ -87,8 +106,10 @@ static void vvenc_set_verbository(vvenc_config *params)
 
 static void vvenc_set_pic_format(AVCodecContext *avctx, vvenc_config *params)
 {
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(avctx->pix_fmt);
+
     params->m_internChromaFormat = VVENC_CHROMA_420;
-    params->m_inputBitDepth[0]   = 10;
+    params->m_inputBitDepth[0]   = desc->comp[0].depth;
 }
 
 static void vvenc_set_color_format(AVCodecContext *avctx, vvenc_config *params)
@@ -144,6 +165,61 @@ FF_DISABLE_DEPRECATION_WARNINGS
 FF_ENABLE_DEPRECATION_WARNINGS
 }
 
+static int vvenc_set_int_param(AVCodecContext *avctx, vvenc_config *params,
+                               const char *name, int value)
+{
+    char str[16];
+
+    snprintf(str, sizeof(str), "%d", value);
+    if (vvenc_set_param(params, name, str) != 0) {
+        av_log(avctx, AV_LOG_ERROR, "Invalid value for %s: %s.\n", name, str);
+        return AVERROR(EINVAL);
+    }
+    return 0;
+}
+
+/**
+ * Apply the threading and parallelism options.  Unset ones are derived from
+ * the thread count, except the tiles which change the bitstream and are left
+ * to vvenc; vvenc-params may still override them.
+ */
+static int vvenc_set_parallelism(AVCodecContext *avctx, vvenc_config *params)
+{
+    VVenCContext *s = avctx->priv_data;
+    int ret;
+
+    if (avctx->thread_count > 0)
+        params->m_numThreads = avctx->thread_count;
+
+    if (s->tiles && vvenc_set_param(params, "Tiles", s->tiles) != 0) {
+        av_log(avctx, AV_LOG_ERROR, "Invalid tiles: %s.\n", s->tiles);
+        return AVERROR(EINVAL);
+    }
+
+    if (s->wpp >= 0) {
+        ret = vvenc_set_int_param(avctx, params, "WaveFrontSynchro", s->wpp);
+        if (ret < 0)
+            return ret;
+    }
+
+    if (s->max_parallel_frames >= 0) {
+        ret = vvenc_set_int_param(avctx, params, "MaxParallelFrames", s->max_parallel_frames);
+        if (ret < 0)
+            return ret;
+    } else if (avctx->thread_count == 1) {
+        ret = vvenc_set_int_param(avctx, params, "MaxParallelFrames", 0);
+        if (ret < 0)
+            return ret;
+    }
+
+    if (s->lookahead >= 0) {
+        ret = vvenc_set_int_param(avctx, params, "LookAhead", s->lookahead);
+        if (ret < 0)
+            return ret;
+    }
+    return 0;
+}
+
 static int vvenc_parse_vvenc_params(AVCodecContext *avctx, vvenc_config *params)
 {
     VVenCContext *s = avctx->priv_data;
@@ -215,6 +291,86 @@ static int vvenc_set_rc_mode(AVCodecContext *avctx, vvenc_config *params)
     return 0;
 }
 
+/**
+ * Make the access unit payload point to a pool buffer, allocating a new one
+ * if the last one was handed out as a packet.
+ */
+static int vvenc_attach_payload(VVenCContext *s)
+{
+    if (!s->payload_buf) {
+        s->payload_buf = av_buffer_pool_get(s->pool);
+        if (!s->payload_buf)
+            return AVERROR(ENOMEM);
+    }
+    s->au->payload         = s->payload_buf->data;
+    s->au->payloadSize     = s->payload_size;
+    s->au->payloadUsedSize = 0;
+    return 0;
+}
+
+static void vvenc_narrow_plane(uint8_t *dst, ptrdiff_t dst_stride,
+                               const int16_t *src, ptrdiff_t src_stride,
+                               int width, int height)
+{
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++)
+            dst[x] = src[x];
+        dst += dst_stride;
+        src += src_stride;
+    }
+}
+
+/**
+ * Called by vvenc_encode() for each reconstructed picture. The buffer is
+ * only valid during the call, so the picture is copied.
+ */
+static void vvenc_recon_callback(void *ctx, vvencYUVBuffer *yuvbuf)
+{
+    AVCodecContext *avctx = ctx;
+    VVenCContext *s = avctx->priv_data;
+    AVFrame **recon, *frame;
+    int ret;
+
+    if (s->recon_error < 0)
+        return;
+
+    recon = av_realloc_array(s->recon, s->nb_recon + 1, sizeof(*s->recon));
+    if (!recon) {
+        s->recon_error = AVERROR(ENOMEM);
+        return;
+    }
+    s->recon = recon;
+
+    frame = av_frame_alloc();
+    if (!frame) {
+        s->recon_error = AVERROR(ENOMEM);
+        return;
+    }
+    frame->format = s->recon_fmt;
+    frame->width  = yuvbuf->planes[0].width;
+    frame->height = yuvbuf->planes[0].height;
+    ret = av_frame_get_buffer(frame, 0);
+    if (ret < 0) {
+        av_frame_free(&frame);
+        s->recon_error = ret;
+        return;
+    }
+
+    for (int i = 0; i < 3; i++) {
+        const vvencYUVPlane *p = &yuvbuf->planes[i];
+
+        if (s->recon_fmt == AV_PIX_FMT_YUV420P)
+            vvenc_narrow_plane(frame->data[i], frame->linesize[i], p->ptr, p->stride,
+                               p->width, p->height);
+        else
+            av_image_copy_plane(frame->data[i], frame->linesize[i], (const uint8_t *)p->ptr,
+                                p->stride * sizeof(*p->ptr), p->width * sizeof(*p->ptr), p->height);
+    }
+    frame->pts = yuvbuf->ctsValid ? yuvbuf->cts : AV_NOPTS_VALUE;
+
+    s->recon[s->nb_recon++] = frame;
+}
+
 static int vvenc_init_extradata(AVCodecContext *avctx, VVenCContext *s)
 {
     int ret;
@@ -266,8 +422,9 @@ static av_cold int vvenc_init(AVCodecContext *avctx)
 
     vvenc_set_verbository(&params);
 
-    if (avctx->thread_count > 0)
-        params.m_numThreads = avctx->thread_count;
+    ret = vvenc_set_parallelism(avctx, &params);
+    if (ret != 0)
+        return ret;
 
     /* GOP settings (IDR/CRA) */
     if (avctx->flags & AV_CODEC_FLAG_CLOSED_GOP)
@@ -323,6 +480,15 @@ static av_cold int vvenc_init(AVCodecContext *avctx)
 
     vvenc_get_config(s->encoder, &params);     /* get the adapted config */
 
+    if (avctx->flags & AV_CODEC_FLAG_RECON_FRAME) {
+        /* the reconstructed pictures have the internal bit depth */
+        s->recon_fmt = params.m_internalBitDepth[0] == 8 ? AV_PIX_FMT_YUV420P : AV_PIX_FMT_YUV420P10;
+        s->pkt_fifo  = av_fifo_alloc2(1, sizeof(AVPacket *), AV_FIFO_FLAG_AUTO_GROW);
+        if (!s->pkt_fifo)
+            return AVERROR(ENOMEM);
+        vvenc_encoder_set_RecYUVBufferCallback(s->encoder, avctx, vvenc_recon_callback);
+    }
+
     av_log(avctx, AV_LOG_INFO, "libvvenc version: %s\n", vvenc_get_version());
     if (av_log_get_level() >= AV_LOG_VERBOSE)
         av_log(avctx, AV_LOG_INFO, "%s\n", vvenc_get_config_as_string(&params, params.m_verbosity));
@@ -341,11 +507,28 @@ static av_cold int vvenc_init(AVCodecContext *avctx)
         av_log(avctx, AV_LOG_FATAL, "cannot allocate memory for AU payload\n");
         return AVERROR(ENOMEM);
     }
-    vvenc_accessUnit_alloc_payload(s->au, avctx->width * avctx->height);
-    if (!s->au->payload) {
+    s->payload_size = avctx->width * avctx->height;
+    s->pool = av_buffer_pool_init(s->payload_size + AV_INPUT_BUFFER_PADDING_SIZE, NULL);
+    if (!s->pool)
+        return AVERROR(ENOMEM);
+    ret = vvenc_attach_payload(s);
+    if (ret < 0) {
         av_log(avctx, AV_LOG_FATAL, "cannot allocate payload memory of size %d\n",
-               avctx->width * avctx->height);
+               s->payload_size);
+        return ret;
+    }
+
+    s->frame = av_frame_alloc();
+    if (!s->frame)
         return AVERROR(ENOMEM);
+
+    if (avctx->pix_fmt != AV_PIX_FMT_YUV420P10) {
+        s->yuvbuf = vvenc_YUVBuffer_alloc();
+        if (!s->yuvbuf)
+            return AVERROR(ENOMEM);
+        vvenc_YUVBuffer_alloc_buffer(s->yuvbuf, VVENC_CHROMA_420, avctx->width, avctx->height);
+        if (!s->yuvbuf->planes[0].ptr)
+            return AVERROR(ENOMEM);
     }
 
     ret = vvenc_init_extradata(avctx, s);
@@ -360,8 +543,27 @@ static av_cold int vvenc_close(AVCodecContext *avctx)
 {
     VVenCContext *s = avctx->priv_data;
 
-    if (s->au)
-        vvenc_accessUnit_free(s->au, true);
+    if (s->au) {
+        /* the payload belongs to the pool */
+        s->au->payload = NULL;
+        vvenc_accessUnit_free(s->au, false);
+    }
+    av_buffer_unref(&s->payload_buf);
+    av_buffer_pool_uninit(&s->pool);
+    av_frame_free(&s->frame);
+
+    if (s->pkt_fifo) {
+        AVPacket *pkt;
+        while (av_fifo_read(s->pkt_fifo, &pkt, 1) >= 0)
+            av_packet_free(&pkt);
+        av_fifo_freep2(&s->pkt_fifo);
+    }
+    for (int i = 0; i < s->nb_recon; i++)
+        av_frame_free(&s->recon[i]);
+    av_freep(&s->recon);
+
+    if (s->yuvbuf)
+        vvenc_YUVBuffer_free(s->yuvbuf, true);
 
     if (s->encoder) {
         vvenc_print_summary(s->encoder);
@@ -373,66 +575,249 @@ static av_cold int vvenc_close(AVCodecContext *avctx)
     return 0;
 }
 
-static av_cold int vvenc_frame(AVCodecContext *avctx, AVPacket *pkt, const AVFrame *frame,
-                               int *got_packet)
+static void vvenc_widen_plane(int16_t *dst, ptrdiff_t dst_stride,
+                              const uint8_t *src, ptrdiff_t src_stride,
+                              int width, int height)
 {
-    VVenCContext *s = avctx->priv_data;
-    vvencYUVBuffer *pyuvbuf;
-    vvencYUVBuffer yuvbuf;
-    int ret;
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++)
+            dst[x] = src[x];
+        dst += dst_stride;
+        src += src_stride;
+    }
+}
 
-    pyuvbuf = NULL;
-    if (frame) {
-        vvenc_YUVBuffer_default(&yuvbuf);
-        yuvbuf.planes[0].ptr = (int16_t *) frame->data[0];
-        yuvbuf.planes[1].ptr = (int16_t *) frame->data[1];
-        yuvbuf.planes[2].ptr = (int16_t *) frame->data[2];
+static void vvenc_split_plane(int16_t *dst_u, int16_t *dst_v, ptrdiff_t dst_stride,
+                              const uint8_t *src, ptrdiff_t src_stride,
+                              int width, int height)
+{
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            dst_u[x] = src[2 * x];
+            dst_v[x] = src[2 * x + 1];
+        }
+        dst_u += dst_stride;
+        dst_v += dst_stride;
+        src   += src_stride;
+    }
+}
 
-        yuvbuf.planes[0].width  = frame->width;
-        yuvbuf.planes[0].height = frame->height;
-        yuvbuf.planes[0].stride = frame->linesize[0] >> 1; /* stride is used in 16bit samples in vvenc */
+static void vvenc_split_plane_msb10(int16_t *dst_u, int16_t *dst_v, ptrdiff_t dst_stride,
+                                    const uint8_t *_src, ptrdiff_t src_stride,
+                                    int width, int height)
+{
+    for (int y = 0; y < height; y++) {
+        const uint16_t *src = (const uint16_t *)_src;
+        for (int x = 0; x < width; x++) {
+            dst_u[x] = src[2 * x]     >> 6;
+            dst_v[x] = src[2 * x + 1] >> 6;
+        }
+        dst_u  += dst_stride;
+        dst_v  += dst_stride;
+        _src   += src_stride;
+    }
+}
 
-        yuvbuf.planes[1].width  = frame->width >> 1;
-        yuvbuf.planes[1].height = frame->height >> 1;
-        yuvbuf.planes[1].stride = frame->linesize[1] >> 1;
+static void vvenc_shift_plane_msb10(int16_t *dst, ptrdiff_t dst_stride,
+                                    const uint8_t *_src, ptrdiff_t src_stride,
+                                    int width, int height)
+{
+    for (int y = 0; y < height; y++) {
+        const uint16_t *src = (const uint16_t *)_src;
+        for (int x = 0; x < width; x++)
+            dst[x] = src[x] >> 6;
+        dst  += dst_stride;
+        _src += src_stride;
+    }
+}
 
-        yuvbuf.planes[2].width  = frame->width >> 1;
-        yuvbuf.planes[2].height = frame->height >> 1;
-        yuvbuf.planes[2].stride = frame->linesize[2] >> 1;
+/**
+ * Convert a frame vvenc cannot read in place into its 16 bit planar input
+ * buffer, in a single pass over the source.  8 bit samples are widened
+ * only, vvenc scales them to its internal bit depth itself.
+ */
+static void vvenc_convert_frame(AVCodecContext *avctx, vvencYUVBuffer *buf, const AVFrame *frame)
+{
+    const int cw = frame->width  >> 1;
+    const int ch = frame->height >> 1;
+    vvencYUVPlane *p = buf->planes;
+
+    switch (avctx->pix_fmt) {
+    case AV_PIX_FMT_YUV420P:
+        vvenc_widen_plane(p[0].ptr, p[0].stride, frame->data[0], frame->linesize[0],
+                          frame->width, frame->height);
+        vvenc_widen_plane(p[1].ptr, p[1].stride, frame->data[1], frame->linesize[1], cw, ch);
+        vvenc_widen_plane(p[2].ptr, p[2].stride, frame->data[2], frame->linesize[2], cw, ch);
+        break;
+    case AV_PIX_FMT_NV12:
+        vvenc_widen_plane(p[0].ptr, p[0].stride, frame->data[0], frame->linesize[0],
+                          frame->width, frame->height);
+        vvenc_split_plane(p[1].ptr, p[2].ptr, p[1].stride, frame->data[1], frame->linesize[1], cw, ch);
+        break;
+    case AV_PIX_FMT_P010:
+        vvenc_shift_plane_msb10(p[0].ptr, p[0].stride, frame->data[0], frame->linesize[0],
+                                frame->width, frame->height);
+        vvenc_split_plane_msb10(p[1].ptr, p[2].ptr, p[1].stride, frame->data[1], frame->linesize[1], cw, ch);
+        break;
+    default:
+        av_assert0(0);
+    }
+}
 
-        yuvbuf.cts = frame->pts;
-        yuvbuf.ctsValid = true;
-        pyuvbuf = &yuvbuf;
+static vvencYUVBuffer *vvenc_wrap_frame(AVCodecContext *avctx, vvencYUVBuffer *yuvbuf,
+                                        const AVFrame *frame)
+{
+    VVenCContext *s = avctx->priv_data;
+
+    if (s->yuvbuf) {
+        vvenc_convert_frame(avctx, s->yuvbuf, frame);
+        yuvbuf = s->yuvbuf;
+    } else {
+        vvenc_YUVBuffer_default(yuvbuf);
+        yuvbuf->planes[0].ptr = (int16_t *) frame->data[0];
+        yuvbuf->planes[1].ptr = (int16_t *) frame->data[1];
+        yuvbuf->planes[2].ptr = (int16_t *) frame->data[2];
+
+        yuvbuf->planes[0].width  = frame->width;
+        yuvbuf->planes[0].height = frame->height;
+        yuvbuf->planes[0].stride = frame->linesize[0] >> 1; /* stride is used in 16bit samples in vvenc */
+
+        yuvbuf->planes[1].width  = frame->width >> 1;
+        yuvbuf->planes[1].height = frame->height >> 1;
+        yuvbuf->planes[1].stride = frame->linesize[1] >> 1;
+
+        yuvbuf->planes[2].width  = frame->width >> 1;
+        yuvbuf->planes[2].height = frame->height >> 1;
+        yuvbuf->planes[2].stride = frame->linesize[2] >> 1;
     }
 
-    if (!s->encode_done) {
-        if (vvenc_encode(s->encoder, pyuvbuf, s->au, &s->encode_done) != 0)
-            return AVERROR_EXTERNAL;
-    } else
-        return 0;
+    yuvbuf->cts = frame->pts;
+    yuvbuf->ctsValid = true;
+    return yuvbuf;
+}
 
-    if (s->au->payloadUsedSize > 0) {
-        ret = ff_get_encode_buffer(avctx, pkt, s->au->payloadUsedSize, 0);
-        if (ret < 0)
+static int vvenc_encode_packet(AVCodecContext *avctx, AVPacket *pkt)
+{
+    VVenCContext *s = avctx->priv_data;
+    int ret;
+
+    /* vvenc copies the input, so frames are fed until it has an access unit */
+    while (!s->encode_done) {
+        vvencYUVBuffer *pyuvbuf = NULL;
+        vvencYUVBuffer yuvbuf;
+
+        ret = ff_encode_get_frame(avctx, s->frame);
+        if (ret < 0 && ret != AVERROR_EOF)
+            return ret;
+        if (ret >= 0)
+            pyuvbuf = vvenc_wrap_frame(avctx, &yuvbuf, s->frame);
+
+        ret = vvenc_attach_payload(s);
+        if (ret < 0) {
+            av_frame_unref(s->frame);
             return ret;
+        }
 
-        memcpy(pkt->data, s->au->payload, s->au->payloadUsedSize);
+        ret = vvenc_encode(s->encoder, pyuvbuf, s->au, &s->encode_done);
+        av_frame_unref(s->frame);
+        if (ret != 0)
+            return AVERROR_EXTERNAL;
+        if (s->recon_error < 0)
+            return s->recon_error;
+
+        if (s->au->payloadUsedSize > 0) {
+            pkt->buf       = s->payload_buf;
+            s->payload_buf = NULL;
+            pkt->data      = pkt->buf->data;
+            pkt->size      = s->au->payloadUsedSize;
+            memset(pkt->data + pkt->size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+
+            if (s->au->ctsValid)
+                pkt->pts = s->au->cts;
+            if (s->au->dtsValid)
+                pkt->dts = s->au->dts;
+            pkt->flags |= AV_PKT_FLAG_KEY * s->au->rap;
+            return 0;
+        }
+    }
 
-        if (s->au->ctsValid)
-            pkt->pts = s->au->cts;
-        if (s->au->dtsValid)
-            pkt->dts = s->au->dts;
-        pkt->flags |= AV_PKT_FLAG_KEY * s->au->rap;
+    return AVERROR_EOF;
+}
 
-        *got_packet = 1;
-        return 0;
+static int vvenc_find_recon(const VVenCContext *s, int64_t pts)
+{
+    for (int i = 0; i < s->nb_recon; i++) {
+        if (s->recon[i]->pts == pts)
+            return i;
     }
+    return -1;
+}
 
-    return 0;
+/**
+ * Return the packets in coded order, each with its reconstructed picture.
+ * vvenc hands the pictures out in its own order once they are final, so
+ * the packets are held back until theirs is there. Once the encoder is
+ * flushed, a packet or a picture left without the other is an error.
+ */
+static int vvenc_receive_packet(AVCodecContext *avctx, AVPacket *pkt)
+{
+    VVenCContext *s = avctx->priv_data;
+    AVFrame *recon_frame = avctx->internal->recon_frame;
+    int ret;
+
+    if (!(avctx->flags & AV_CODEC_FLAG_RECON_FRAME))
+        return vvenc_encode_packet(avctx, pkt);
+
+    while (1) {
+        AVPacket *coded;
+
+        if (av_fifo_peek(s->pkt_fifo, &coded, 1, 0) >= 0) {
+            const int i = vvenc_find_recon(s, coded->pts);
+
+            if (i >= 0) {
+                av_fifo_drain2(s->pkt_fifo, 1);
+                av_packet_move_ref(pkt, coded);
+                av_packet_free(&coded);
+
+                av_frame_unref(recon_frame);
+                av_frame_move_ref(recon_frame, s->recon[i]);
+                av_frame_free(&s->recon[i]);
+                memmove(s->recon + i, s->recon + i + 1, (s->nb_recon - i - 1) * sizeof(*s->recon));
+                s->nb_recon--;
+                return 0;
+            }
+            /* all the pictures are out once the encoder is flushed */
+            if (s->encode_done) {
+                av_log(avctx, AV_LOG_ERROR, "No reconstructed picture for the packet with pts %"PRId64"\n",
+                       coded->pts);
+                return AVERROR_EXTERNAL;
+            }
+        }
+
+        coded = av_packet_alloc();
+        if (!coded)
+            return AVERROR(ENOMEM);
+        ret = vvenc_encode_packet(avctx, coded);
+        if (ret >= 0)
+            ret = av_fifo_write(s->pkt_fifo, &coded, 1);
+        if (ret < 0) {
+            av_packet_free(&coded);
+            if (ret == AVERROR_EOF && av_fifo_can_read(s->pkt_fifo))
+                continue;
+            if (ret == AVERROR_EOF && s->nb_recon) {
+                av_log(avctx, AV_LOG_ERROR, "%d reconstructed pictures without a packet\n", s->nb_recon);
+                return AVERROR_EXTERNAL;
+            }
+            return ret;
+        }
+    }
 }
 
 static const enum AVPixelFormat pix_fmts_vvenc[] = {
     AV_PIX_FMT_YUV420P10,
+    AV_PIX_FMT_YUV420P,
+    AV_PIX_FMT_NV12,
+    AV_PIX_FMT_P010,
     AV_PIX_FMT_NONE
 };
 
@@ -452,6 +837,10 @@ static const AVOption options[] = {
     { "period",       "set (intra) refresh period in seconds", OFFSET(intra_refresh_sec), AV_OPT_TYPE_INT,  {.i64 = 1},  1, INT_MAX, VE },
     { "vvenc-params", "set the vvenc configuration using a :-separated list of key=value parameters", OFFSET(vvenc_opts), AV_OPT_TYPE_DICT, { 0 }, 0, 0, VE },
     { "level",        "Specify level (as defined by Annex A)", OFFSET(level), AV_OPT_TYPE_STRING, {.str = NULL}, 0, 0, VE},
+    { "max_parallel_frames", "set the maximum number of frames encoded in parallel", OFFSET(max_parallel_frames), AV_OPT_TYPE_INT, {.i64 = -1}, -1, INT_MAX, VE },
+    { "wpp",          "enable wavefront parallel processing", OFFSET(wpp), AV_OPT_TYPE_BOOL, {.i64 = -1}, -1, 1, VE },
+    { "tiles",        "set the tile columns and rows as COLSxROWS", OFFSET(tiles), AV_OPT_TYPE_STRING, {.str = NULL}, 0, 0, VE },
+    { "lookahead",    "enable the rate control look-ahead", OFFSET(lookahead), AV_OPT_TYPE_BOOL, {.i64 = -1}, -1, 1, VE },
     { "tier",         "set vvc tier", OFFSET(tier), AV_OPT_TYPE_INT, {.i64 = 0},  0, 1, VE, "tier"},
     { "main",         "main", 0, AV_OPT_TYPE_CONST, {.i64 = 0}, INT_MIN, INT_MAX, VE, "tier"},
     { "high",         "high", 0, AV_OPT_TYPE_CONST, {.i64 = 1}, INT_MIN, INT_MAX, VE, "tier"},
@@ -476,15 +865,15 @@ const FFCodec ff_libvvenc_encoder = {
     CODEC_LONG_NAME("libvvenc H.266 / VVC"),
     .p.type         = AVMEDIA_TYPE_VIDEO,
     .p.id           = AV_CODEC_ID_VVC,
-    .p.capabilities = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_DELAY |
-                      AV_CODEC_CAP_OTHER_THREADS,
+    .p.capabilities = AV_CODEC_CAP_DELAY | AV_CODEC_CAP_OTHER_THREADS |
+                      AV_CODEC_CAP_ENCODER_RECON_FRAME,
     .p.profiles     = NULL_IF_CONFIG_SMALL(ff_vvc_profiles),
     .p.priv_class   = &class,
     .p.wrapper_name = "libvvenc",
     .priv_data_size = sizeof(VVenCContext),
     .p.pix_fmts     = pix_fmts_vvenc,
     .init           = vvenc_init,
-    FF_CODEC_ENCODE_CB(vvenc_frame),
+    FF_CODEC_RECEIVE_PACKET_CB(vvenc_receive_packet),
     .close          = vvenc_close,
     .defaults       = vvenc_defaults,
     .caps_internal  = FF_CODEC_CAP_INIT_CLEANUP | FF_CODEC_CAP_AUTO_THREADS
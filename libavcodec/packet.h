@@ -326,6 +326,14 @@ enum AVPacketSideDataType {
     */
     AV_PKT_DATA_AMBIENT_VIEWING_ENVIRONMENT,
 
+    /**
+     * The packet starts a gradual decoding refresh: decoding can start with
+     * it, and the decoded pictures are correct from the one this many pictures
+     * later in output order. The payload is a little-endian uint32_t, see
+     * AVCodecParserContext.recovery_distance.
+     */
+    AV_PKT_DATA_RECOVERY_POINT,
+
     /**
      * The number of side data types.
      * This is not part of the public API/ABI in the sense that it may
@@ -71,6 +71,7 @@ found:
     s->dts_ref_dts_delta    = INT_MIN;
     s->pts_dts_delta        = INT_MIN;
     s->format               = -1;
+    s->recovery_distance    = -1;
 
     return s;
 
@@ -188,7 +188,7 @@ struct FFRefStructPool {
     void (*free_entry_cb)(FFRefStructOpaque opaque, void *obj);
     void (*free_cb)(FFRefStructOpaque opaque);
 
-    int uninited;
+    atomic_int uninited;
     unsigned entry_flags;
     unsigned pool_flags;
 
@@ -202,11 +202,31 @@ struct FFRefStructPool {
      * to the corresponding FFRefStructPool.
      */
     RefCount *available_entries;
+    /**
+     * With FF_REFSTRUCT_POOL_FLAG_LOCK_FREE_RETURN, returned entries are
+     * pushed here without taking the mutex.  The list is only ever taken
+     * as a whole with the mutex held, which makes the pushes ABA-safe.
+     */
+    atomic_uintptr_t returned_entries;
     AVMutex mutex;
 };
 
+static void pool_free_entry(FFRefStructPool *pool, RefCount *ref);
+
+static void pool_free_entries(FFRefStructPool *pool, RefCount *entry)
+{
+    while (entry) {
+        void *next = entry->opaque.nc;
+        pool_free_entry(pool, entry);
+        entry = next;
+    }
+}
+
 static void pool_free(FFRefStructPool *pool)
 {
+    // entries returned without the mutex after the pool was uninited
+    pool_free_entries(pool, (RefCount*)atomic_exchange_explicit(&pool->returned_entries, 0,
+                                                                memory_order_acquire));
     ff_mutex_destroy(&pool->mutex);
     if (pool->free_cb)
         pool->free_cb(pool->opaque);
@@ -225,6 +245,20 @@ static void pool_return_entry(void *ref_)
     RefCount *ref = ref_;
     FFRefStructPool *pool = ref->opaque.nc;
 
+    if (pool->pool_flags & FF_REFSTRUCT_POOL_FLAG_LOCK_FREE_RETURN) {
+        if (!atomic_load_explicit(&pool->uninited, memory_order_relaxed)) {
+            uintptr_t head = atomic_load_explicit(&pool->returned_entries, memory_order_relaxed);
+            do {
+                ref->opaque.nc = (void*)head;
+            } while (!atomic_compare_exchange_weak_explicit(&pool->returned_entries, &head,
+                                                            (uintptr_t)ref,
+                                                            memory_order_release,
+                                                            memory_order_relaxed));
+            ref = NULL;
+        }
+        goto done;
+    }
+
     ff_mutex_lock(&pool->mutex);
     if (!pool->uninited) {
         ref->opaque.nc = pool->available_entries;
@@ -233,6 +267,7 @@ static void pool_return_entry(void *ref_)
     }
     ff_mutex_unlock(&pool->mutex);
 
+done:
     if (ref)
         pool_free_entry(pool, ref);
 
@@ -255,6 +290,9 @@ static int refstruct_pool_get_ext(void *datap, FFRefStructPool *pool)
 
     ff_mutex_lock(&pool->mutex);
     ff_assert(!pool->uninited);
+    if (!pool->available_entries)
+        pool->available_entries = (RefCount*)atomic_exchange_explicit(&pool->returned_entries, 0,
+                                                                      memory_order_acquire);
     if (pool->available_entries) {
         RefCount *ref = pool->available_entries;
         ret = get_userdata(ref);
@@ -320,16 +358,14 @@ static void refstruct_pool_uninit(FFRefStructOpaque unused, void *obj)
 
     ff_mutex_lock(&pool->mutex);
     ff_assert(!pool->uninited);
-    pool->uninited = 1;
+    atomic_store_explicit(&pool->uninited, 1, memory_order_relaxed);
     entry = pool->available_entries;
     pool->available_entries = NULL;
     ff_mutex_unlock(&pool->mutex);
 
-    while (entry) {
-        void *next = entry->opaque.nc;
-        pool_free_entry(pool, entry);
-        entry = next;
-    }
+    pool_free_entries(pool, entry);
+    pool_free_entries(pool, (RefCount*)atomic_exchange_explicit(&pool->returned_entries, 0,
+                                                                memory_order_acquire));
 }
 
 FFRefStructPool *ff_refstruct_pool_alloc(size_t size, unsigned flags)
@@ -374,6 +410,8 @@ FFRefStructPool *ff_refstruct_pool_alloc_ext_c(size_t size, unsigned flags,
     }
 
     atomic_init(&pool->refcount, 1);
+    atomic_init(&pool->uninited, 0);
+    atomic_init(&pool->returned_entries, 0);
 
     err = ff_mutex_init(&pool->mutex, NULL);
     if (err) {
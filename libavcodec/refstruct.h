@@ -219,6 +219,12 @@ typedef struct FFRefStructPool FFRefStructPool;
  * flag had been provided.
  */
 #define FF_REFSTRUCT_POOL_FLAG_ZERO_EVERY_TIME                       (1 << 18)
+/**
+ * If this flag is set, entries are returned to the pool without taking its
+ * mutex, only getting an entry does.  This is useful for pools whose
+ * entries are released from many threads.
+ */
+#define FF_REFSTRUCT_POOL_FLAG_LOCK_FREE_RETURN                      (1 << 19)
 
 /**
  * Equivalent to ff_refstruct_pool_alloc(size, flags, NULL, NULL, NULL, NULL, NULL)
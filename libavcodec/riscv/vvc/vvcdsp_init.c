@@ -0,0 +1,265 @@
+/*
+ * VVC DSP init for RISC-V
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include <stdint.h>
+
+#include "libavutil/attributes.h"
+#include "libavutil/common.h"
+#include "libavutil/cpu.h"
+#include "libavutil/riscv/cpu.h"
+#include "libavcodec/vvc/ctu.h"
+#include "libavcodec/vvc/dsp.h"
+
+#define RVV_PROTOTYPES(bd)                                                                      \
+void ff_vvc_avg_##bd##_rvv(uint8_t *dst, ptrdiff_t dst_stride,                                  \
+    const int16_t *src0, const int16_t *src1, int width, int height);                           \
+void ff_vvc_w_avg_##bd##_rvv(uint8_t *dst, ptrdiff_t dst_stride,                                \
+    const int16_t *src0, const int16_t *src1, int width, int height,                            \
+    uintptr_t w0_w1, uintptr_t offset_shift);                                                   \
+void ff_vvc_put_pixels_##bd##_rvv(int16_t *dst, const uint8_t *src, ptrdiff_t src_stride,       \
+    int height, const int8_t *hf, const int8_t *vf, int width);                                 \
+void ff_vvc_alf_filter_luma_row_##bd##_rvv(uint8_t *dst, const uint8_t *rows[7], int width,     \
+    const int16_t *filter, const int16_t *clip, int shift);                                     \
+void ff_vvc_alf_filter_chroma_row_##bd##_rvv(uint8_t *dst, const uint8_t *rows[7], int width,   \
+    const int16_t *filter, const int16_t *clip, int shift);                                     \
+void ff_vvc_alf_grad_row_##bd##_rvv(int *grad, const uint8_t *s0, const uint8_t *s1,            \
+    const uint8_t *s2, const uint8_t *s3, int points);                                          \
+
+RVV_PROTOTYPES(8)
+RVV_PROTOTYPES(10)
+RVV_PROTOTYPES(12)
+
+#define W_AVG_FUNC(bd)                                                                          \
+static void vvc_w_avg_##bd##_rvv(uint8_t *dst, const ptrdiff_t dst_stride,                      \
+    const int16_t *src0, const int16_t *src1, const int width, const int height,                \
+    const int denom, const int w0, const int w1, const int o0, const int o1)                    \
+{                                                                                               \
+    const int shift          = denom + FFMAX(3, 15 - bd);                                       \
+    const int offset         = ((o0 + o1) * (1 << (bd - 8)) + 1) * (1 << (shift - 1));          \
+    const uintptr_t w0_w1    = ((uintptr_t)w0 << 32) | (uint32_t)w1;                            \
+    const uintptr_t off_shft = ((uintptr_t)offset << 32) | (uint32_t)shift;                     \
+                                                                                                \
+    ff_vvc_w_avg_##bd##_rvv(dst, dst_stride, src0, src1, width, height, w0_w1, off_shft);       \
+}
+
+W_AVG_FUNC(8)
+W_AVG_FUNC(10)
+W_AVG_FUNC(12)
+
+// The p0 to p6 rows of the C filters after the virtual boundary padding, returns the shift.
+static int alf_get_rows(const uint8_t *rows[7], const uint8_t *src, const ptrdiff_t stride,
+    const int y, const int vb_pos, const int vb_above, const int vb_below)
+{
+    rows[0] = src;
+    rows[1] = src + stride;
+    rows[2] = src - stride;
+    rows[3] = src + 2 * stride;
+    rows[4] = src - 2 * stride;
+    rows[5] = src + 3 * stride;
+    rows[6] = src - 3 * stride;
+
+    if (y < vb_pos && y >= vb_above) {
+        if (y == vb_pos - 1)
+            rows[1] = rows[2] = rows[0];
+        if (y >= vb_pos - 2) {
+            rows[3] = rows[1];
+            rows[4] = rows[2];
+        }
+        if (y >= vb_pos - 3) {
+            rows[5] = rows[3];
+            rows[6] = rows[4];
+        }
+    } else if (y >= vb_pos && y <= vb_below) {
+        if (y == vb_pos)
+            rows[1] = rows[2] = rows[0];
+        if (y <= vb_pos + 1) {
+            rows[3] = rows[1];
+            rows[4] = rows[2];
+        }
+        if (y <= vb_pos + 2) {
+            rows[5] = rows[3];
+            rows[6] = rows[4];
+        }
+    }
+
+    return (y == vb_pos - 1 || y == vb_pos) ? 10 : 7;
+}
+
+static void alf_get_idx(int *class_idx, int *transpose_idx, const int *sum, const int ac, const int bd)
+{
+    static const int arg_var[] = {0, 1, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3, 4 };
+    const int vert = sum[0], horz = sum[1], diga0 = sum[2], diga1 = sum[3];
+    const int dir_hv = vert <= horz;
+    const int hv1    = FFMAX(vert, horz);
+    const int hv0    = FFMIN(vert, horz);
+    const int dir_d  = diga0 <= diga1;
+    const int d1     = FFMAX(diga0, diga1);
+    const int d0     = FFMIN(diga0, diga1);
+    const int dir1   = (uint64_t)d1 * hv0 <= (uint64_t)hv1 * d0;
+    const int hvd1   = dir1 ? hv1 : d1;
+    const int hvd0   = dir1 ? hv0 : d0;
+
+    *class_idx = arg_var[av_clip_uintp2((horz + vert) * ac >> (bd - 1), 4)];
+    if (hvd1 * 2 > 9 * hvd0)
+        *class_idx += ((dir1 << 1) + 2) * 5;
+    else if (hvd1 > 2 * hvd0)
+        *class_idx += ((dir1 << 1) + 1) * 5;
+
+    *transpose_idx = dir_d * 2 + dir_hv;
+}
+
+// Sums the gradients of each 4x4 block, the gradients are laid out as in the C version.
+static void alf_classify_blocks(int *class_idx, int *transpose_idx, const int *gradient_tmp,
+    const int width, const int height, const int vb_pos, const int bd)
+{
+    const int w       = width + ALF_GRADIENT_BORDER * 2;
+    const int size    = (ALF_BLOCK_SIZE + ALF_GRADIENT_BORDER * 2) / ALF_GRADIENT_STEP;
+    const int gstride = (w / ALF_GRADIENT_STEP) * ALF_NUM_DIR;
+
+    for (int y = 0; y < height; y += ALF_BLOCK_SIZE) {
+        int start = 0;
+        int end   = size;
+        int ac    = 2;
+        if (y + ALF_BLOCK_SIZE == vb_pos) {
+            end -= ALF_GRADIENT_BORDER / ALF_GRADIENT_STEP;
+            ac = 3;
+        } else if (y == vb_pos) {
+            start += ALF_GRADIENT_BORDER / ALF_GRADIENT_STEP;
+            ac = 3;
+        }
+        for (int x = 0; x < width; x += ALF_BLOCK_SIZE) {
+            const int *grad = gradient_tmp + (y / ALF_GRADIENT_STEP + start) * gstride +
+                (x / ALF_GRADIENT_STEP) * ALF_NUM_DIR;
+            int sum[ALF_NUM_DIR] = { 0 };
+
+            for (int i = start; i < end; i++) {
+                for (int j = 0; j < size * ALF_NUM_DIR; j += ALF_NUM_DIR) {
+                    sum[0] += grad[j + 0];
+                    sum[1] += grad[j + 1];
+                    sum[2] += grad[j + 2];
+                    sum[3] += grad[j + 3];
+                }
+                grad += gstride;
+            }
+            alf_get_idx(class_idx++, transpose_idx++, sum, ac, bd);
+        }
+    }
+}
+
+#define ALF_FUNCS(bd)                                                                           \
+static void vvc_alf_filter_luma_##bd##_rvv(uint8_t *dst, const ptrdiff_t dst_stride,            \
+    const uint8_t *src, const ptrdiff_t src_stride, const int width, const int height,          \
+    const int16_t *filter, const int16_t *clip, const int vb_pos)                               \
+{                                                                                               \
+    const int filter_stride = width / ALF_BLOCK_SIZE * ALF_NUM_COEFF_LUMA;                      \
+                                                                                                \
+    for (int y = 0; y < height; y++) {                                                          \
+        const uint8_t *rows[7];                                                                 \
+        const int offset = y / ALF_BLOCK_SIZE * filter_stride;                                  \
+        const int shift  = alf_get_rows(rows, src + y * src_stride, src_stride,                 \
+            y, vb_pos, vb_pos - 4, vb_pos + 3);                                                 \
+                                                                                                \
+        ff_vvc_alf_filter_luma_row_##bd##_rvv(dst + y * dst_stride, rows, width,                \
+            filter + offset, clip + offset, shift);                                             \
+    }                                                                                           \
+}                                                                                               \
+                                                                                                \
+static void vvc_alf_filter_chroma_##bd##_rvv(uint8_t *dst, const ptrdiff_t dst_stride,          \
+    const uint8_t *src, const ptrdiff_t src_stride, const int width, const int height,          \
+    const int16_t *filter, const int16_t *clip, const int vb_pos)                               \
+{                                                                                               \
+    for (int y = 0; y < height; y++) {                                                          \
+        const uint8_t *rows[7];                                                                 \
+        const int shift = alf_get_rows(rows, src + y * src_stride, src_stride,                  \
+            y, vb_pos, vb_pos - 2, vb_pos + 1);                                                 \
+                                                                                                \
+        ff_vvc_alf_filter_chroma_row_##bd##_rvv(dst + y * dst_stride, rows, width,              \
+            filter, clip, shift);                                                               \
+    }                                                                                           \
+}                                                                                               \
+                                                                                                \
+static void vvc_alf_classify_##bd##_rvv(int *class_idx, int *transpose_idx,                     \
+    const uint8_t *src, const ptrdiff_t src_stride, const int width, const int height,          \
+    const int vb_pos, int *gradient_tmp)                                                        \
+{                                                                                               \
+    const int h       = height + ALF_GRADIENT_BORDER * 2;                                       \
+    const int w       = width  + ALF_GRADIENT_BORDER * 2;                                       \
+    const int gstride = (w / ALF_GRADIENT_STEP) * ALF_NUM_DIR;                                  \
+    int *grad         = gradient_tmp;                                                           \
+                                                                                                \
+    src -= (ALF_GRADIENT_BORDER + 1) * src_stride + ALF_GRADIENT_BORDER * ((bd + 7) / 8);       \
+    for (int y = 0; y < h; y += ALF_GRADIENT_STEP) {                                            \
+        const uint8_t *s0 = src + y * src_stride;                                               \
+        const uint8_t *s1 = s0 + src_stride;                                                    \
+        const uint8_t *s2 = s1 + src_stride;                                                    \
+        const uint8_t *s3 = s2 + src_stride;                                                    \
+                                                                                                \
+        if (y == vb_pos)                                                                        \
+            s3 = s2;                                                                            \
+        else if (y == vb_pos + ALF_GRADIENT_BORDER)                                             \
+            s0 = s1;                                                                            \
+        ff_vvc_alf_grad_row_##bd##_rvv(grad, s0, s1, s2, s3, w / ALF_GRADIENT_STEP);            \
+        grad += gstride;                                                                        \
+    }                                                                                           \
+    alf_classify_blocks(class_idx, transpose_idx, gradient_tmp, width, height, vb_pos, bd);     \
+}
+
+ALF_FUNCS(8)
+ALF_FUNCS(10)
+ALF_FUNCS(12)
+
+#define RVV_INIT(bd) do {                                                    \
+    for (int i = 0; i < 7; i++) {                                            \
+        c->inter.put[0][i][0][0] = ff_vvc_put_pixels_##bd##_rvv;             \
+        c->inter.put[1][i][0][0] = ff_vvc_put_pixels_##bd##_rvv;             \
+        c->inter.put_bi[0][i][0][0] = NULL;                                  \
+        c->inter.put_bi[1][i][0][0] = NULL;                                  \
+    }                                                                        \
+    c->inter.avg            = ff_vvc_avg_##bd##_rvv;                         \
+    c->inter.w_avg          = vvc_w_avg_##bd##_rvv;                          \
+    c->alf.filter[LUMA]     = vvc_alf_filter_luma_##bd##_rvv;                \
+    c->alf.filter[CHROMA]   = vvc_alf_filter_chroma_##bd##_rvv;              \
+    c->alf.classify         = vvc_alf_classify_##bd##_rvv;                   \
+} while (0)
+
+av_cold void ff_vvc_dsp_init_riscv(VVCDSPContext *const c, const int bd, const int flags)
+{
+#if HAVE_RVV
+    // the luma filter works on one 4x4 block per vector, 4 x 32 bit sums need VLEN >= 128
+    if (!(flags & AV_CPU_FLAG_RVV_I32) || !ff_rv_vlen_least(128) || !(flags & AV_CPU_FLAG_RVB_ADDR))
+        return;
+
+    switch (bd) {
+    case 8:
+        RVV_INIT(8);
+        break;
+    case 10:
+        RVV_INIT(10);
+        break;
+    case 12:
+        RVV_INIT(12);
+        break;
+    default:
+        break;
+    }
+#endif
+}
@@ -19,12 +19,17 @@
  * License along with FFmpeg; if not, write to the Free Software
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
+#include "libavutil/thread.h"
 #include "libavcodec/cabac_functions.h"
 
 #include "cabac.h"
 #include "ctu.h"
 #include "data.h"
 
+#if ARCH_X86
+#   include "libavcodec/x86/vvc/cabac.h"
+#endif
+
 #define CABAC_MAX_BIN 31
 
 #define CNU 35
@@ -805,13 +810,113 @@ typedef struct ResidualCoding {
     int last_significant_coeff_y;
 } ResidualCoding;
 
+static void vvc_cabac_update_fast_end(VVCCabacContext *c)
+{
+    c->fast_end = c->epb_idx < c->nb_epb ? FFMIN(c->epb[c->epb_idx], c->size) : c->size;
+}
+
+static void vvc_cabac_refill(VVCCabacContext *c)
+{
+    uint32_t bits = 0;
+
+    if (c->pos + 4 <= c->fast_end) {
+        bits = AV_RB32(c->buf + c->pos);
+        c->pos += 4;
+    } else {
+        // two emulation prevention bytes are at least 3 bytes apart
+        for (int i = 0; i < 4; i++) {
+            if (c->epb_idx < c->nb_epb && c->pos == c->epb[c->epb_idx]) {
+                c->pos++;
+                c->epb_idx++;
+            }
+            bits = (bits << 8) | (c->pos < c->size ? c->buf[c->pos] : 0);
+            c->pos++;
+        }
+        vvc_cabac_update_fast_end(c);
+    }
+    c->value = (c->value << 32) | bits;
+    c->cnt  += 32;
+}
+
+// 9.3.2.5 Initialization process for the arithmetic decoding engine
+static int vvc_cabac_decoder_start(VVCCabacContext *c)
+{
+    while (c->epb_idx < c->nb_epb && c->epb[c->epb_idx] < c->pos)
+        c->epb_idx++;
+    vvc_cabac_update_fast_end(c);
+
+    c->value = 0;
+    c->cnt   = 0;
+    vvc_cabac_refill(c);
+    c->cnt  -= 9;
+    c->range = 510;
+
+    // ivlOffset 510 and 511 are not allowed
+    if ((c->value >> c->cnt) >= 510)
+        return AVERROR_INVALIDDATA;
+    return 0;
+}
+
+int ff_vvc_cabac_decoder_init(VVCCabacContext *c, const uint8_t *buf, const int start, const int end,
+    const int *epb, const int nb_epb)
+{
+    c->buf     = buf;
+    c->size    = end;
+    c->pos     = start;
+    c->epb     = epb;
+    c->nb_epb  = nb_epb;
+    c->epb_idx = 0;
+    return vvc_cabac_decoder_start(c);
+}
+
 static int cabac_reinit(VVCLocalContext *lc)
 {
-    return skip_bytes(&lc->ep->cc, 0) == NULL ? AVERROR_INVALIDDATA : 0;
+    VVCCabacContext *c = &lc->ep->cc;
+    size_t pos         = c->pos;
+
+    // step back to the byte after the one holding the last bit of ivlOffset,
+    // over the emulation prevention bytes dropped on the way
+    for (int i = 0; i < c->cnt >> 3; i++) {
+        pos--;
+        if (c->epb_idx && c->epb[c->epb_idx - 1] == pos) {
+            pos--;
+            c->epb_idx--;
+        }
+    }
+
+    if (pos > c->size)
+        return AVERROR_INVALIDDATA;
+    c->pos = pos;
+    return vvc_cabac_decoder_start(c);
+}
+
+// the initialised contexts of every init_type and slice qp, copied at each slice, tile and wpp row start
+static VVCCabacState cabac_init_states[3][64][VVC_CONTEXTS];
+
+static av_cold void cabac_init_states_init(void)
+{
+    for (int init_type = 0; init_type < FF_ARRAY_ELEMS(cabac_init_states); init_type++) {
+        for (int qp = 0; qp < FF_ARRAY_ELEMS(cabac_init_states[0]); qp++) {
+            for (int i = 0; i < VVC_CONTEXTS; i++) {
+                VVCCabacState *state = &cabac_init_states[init_type][qp][i];
+                const int init_value = init_values[init_type][i];
+                const int shift_idx  = init_values[3][i];
+                const int m = (init_value >> 3) - 4;
+                const int n = ((init_value & 7) * 18) + 1;
+                const int pre = av_clip(((m * (qp - 16)) >> 1) + n, 1, 127);
+
+                state->state[0] = pre << 3;
+                state->state[1] = pre << 7;
+                state->shift[0] = (shift_idx >> 2 ) + 2;
+                state->shift[1] = (shift_idx & 3 ) + 3 + state->shift[0];
+            }
+        }
+    }
 }
 
 static void cabac_init_state(VVCLocalContext *lc)
 {
+    static AVOnce init_once       = AV_ONCE_INIT;
     const VVCSPS *sps             = lc->fc->ps.sps;
     const H266RawSliceHeader *rsh = lc->sc->sh.r;
     const int qp                  = av_clip_uintp2(lc->sc->sh.slice_qp_y, 6);
@@ -819,24 +924,14 @@ static void cabac_init_state(VVCLocalContext *lc)
 
     av_assert0(VVC_CONTEXTS == SYNTAX_ELEMENT_LAST);
 
+    ff_thread_once(&init_once, cabac_init_states_init);
+
     ff_vvc_ep_init_stat_coeff(lc->ep, sps->bit_depth, sps->r->sps_persistent_rice_adaptation_enabled_flag);
 
     if (rsh->sh_cabac_init_flag && !IS_I(rsh))
         init_type ^= 3;
 
-    for (int i = 0; i < VVC_CONTEXTS; i++) {
-        VVCCabacState *state = &lc->ep->cabac_state[i];
-        const int init_value = init_values[init_type][i];
-        const int shift_idx  = init_values[3][i];
-        const int m = (init_value >> 3) - 4;
-        const int n = ((init_value & 7) * 18) + 1;
-        const int pre = av_clip(((m * (qp - 16)) >> 1) + n, 1, 127);
-
-        state->state[0] = pre << 3;
-        state->state[1] = pre << 7;
-        state->shift[0] = (shift_idx >> 2 ) + 2;
-        state->shift[1] = (shift_idx & 3 ) + 3 + state->shift[0];
-    }
+    memcpy(lc->ep->cabac_state, cabac_init_states[init_type][qp], sizeof(lc->ep->cabac_state));
 }
 
 int ff_vvc_cabac_init(VVCLocalContext *lc,
@@ -856,60 +951,112 @@ int ff_vvc_cabac_init(VVCLocalContext *lc,
     return ret;
 }
 
-//fixme
-static void vvc_refill2(CABACContext* c) {
-    int i;
-    unsigned x;
-#if !HAVE_FAST_CLZ
-    x = c->low ^ (c->low - 1);
-    i = 7 - ff_h264_norm_shift[x >> (CABAC_BITS - 1)];
-#else
-    i = ff_ctz(c->low) - CABAC_BITS;
-#endif
+// At least 16 bits are always left in value, enough for any bin or 16 bypass bins, so it is
+// refilled after the decoding instead of before.
+#define VVC_CABAC_REFILL(c) do {                                \
+    if ((c)->cnt < 16)                                          \
+        vvc_cabac_refill(c);                                    \
+} while (0)
 
-    x = -CABAC_MASK;
+#ifndef vvc_get_cabac_inline
+static av_always_inline int vvc_get_cabac_inline(VVCCabacContext *c, const int range_lps, const int val_mps)
+{
+    const unsigned range    = c->range - range_lps;
+    const uint64_t scaled   = (uint64_t)range << c->cnt;
+    const uint64_t lps_mask = -(uint64_t)(c->value >= scaled);
+    const unsigned r        = range + ((range_lps - range) & (unsigned)lps_mask);
+    const int shift         = ff_h264_norm_shift[r];
 
-#if CABAC_BITS == 16
-    x += (c->bytestream[0] << 9) + (c->bytestream[1] << 1);
-#else
-    x += c->bytestream[0] << 1;
-#endif
+    c->value -= scaled & lps_mask;
+    c->range  = r << shift;
+    c->cnt   -= shift;
 
-    c->low += x << i;
-#if !UNCHECKED_BITSTREAM_READER
-    if (c->bytestream < c->bytestream_end)
-#endif
-        c->bytestream += CABAC_BITS / 8;
+    return val_mps ^ (lps_mask & 1);
 }
+#endif
 
-static int inline vvc_get_cabac(CABACContext *c, VVCCabacState* base, const int ctx)
+// 9.3.4.3.2 Arithmetic decoding process for a binary decision
+static int inline vvc_get_cabac(VVCCabacContext *c, VVCCabacState* base, const int ctx)
 {
     VVCCabacState *s = base + ctx;
     const int qRangeIdx = c->range >> 5;
     const int pState = s->state[1] + (s->state[0] << 4);
     const int valMps = pState >> 14;
     const int RangeLPS = (qRangeIdx * ((valMps ? 32767 - pState : pState) >> 9 ) >> 1) + 4;
-    int bit, lps_mask;
+    const int bit = vvc_get_cabac_inline(c, RangeLPS, valMps);
 
-    c->range -= RangeLPS;
-    lps_mask = ((c->range<<(CABAC_BITS+1)) - c->low)>>31;
+    c->bins++;
+    VVC_CABAC_REFILL(c);
+    s->state[0] = s->state[0] - (s->state[0] >> s->shift[0]) + (1023 * bit >> s->shift[0]);
+    s->state[1] = s->state[1] - (s->state[1] >> s->shift[1]) + (16383 * bit >> s->shift[1]);
+    return bit;
+}
 
-    c->low -= (c->range<<(CABAC_BITS+1)) & lps_mask;
-    c->range += (RangeLPS - c->range) & lps_mask;
+#ifndef vvc_get_cabac_bypass_inline
+static av_always_inline int vvc_get_cabac_bypass_inline(VVCCabacContext *c)
+{
+    const uint64_t scaled = (uint64_t)c->range << --c->cnt;
+    const int bit         = c->value >= scaled;
 
-    bit = valMps ^ (lps_mask & 1);
+    c->value -= scaled & -(uint64_t)bit;
+    return bit;
+}
+#endif
 
-    lps_mask = ff_h264_norm_shift[c->range];
-    c->range <<= lps_mask;
-    c->low  <<= lps_mask;
+// 9.3.4.3.4 Bypass decoding process for binary decisions
+static av_always_inline int vvc_get_cabac_bypass(VVCCabacContext *c)
+{
+    const int bit = vvc_get_cabac_bypass_inline(c);
 
-    if (!(c->low & CABAC_MASK))
-        vvc_refill2(c);
-    s->state[0] = s->state[0] - (s->state[0] >> s->shift[0]) + (1023 * bit >> s->shift[0]);
-    s->state[1] = s->state[1] - (s->state[1] >> s->shift[1]) + (16383 * bit >> s->shift[1]);
+    c->bins++;
+    VVC_CABAC_REFILL(c);
     return bit;
 }
 
+// n bypass bins, the first one in the msb. They are the quotient of the offset with the next n bits
+// appended and the range, and the remainder is the new offset, so up to 16 bins need one division.
+// The division is slower than a couple of single bins.
+static av_always_inline unsigned vvc_get_cabac_bypass_bits(VVCCabacContext *c, int n)
+{
+    unsigned bins = 0;
+
+    c->bins += n;
+    while (n > 0) {
+        const int k = FFMIN(n, 16);
+        unsigned q  = 0;
+
+        if (k < 3) {
+            for (int i = 0; i < k; i++)
+                q = (q << 1) | vvc_get_cabac_bypass_inline(c);
+        } else {
+            const uint32_t y = c->value >> (c->cnt -= k);
+
+            // only a broken offset >= range gives a larger quotient
+            q         = FFMIN(y / c->range, (1u << k) - 1);
+            c->value -= (uint64_t)(q * c->range) << c->cnt;
+        }
+        VVC_CABAC_REFILL(c);
+        bins = (bins << k) | q;
+        n   -= k;
+    }
+    return bins;
+}
+
+// 9.3.4.3.5 Decoding process for binary decisions before termination
+static int vvc_get_cabac_terminate(VVCCabacContext *c)
+{
+    c->bins++;
+    c->range -= 2;
+    if (c->value >= (uint64_t)c->range << c->cnt)
+        return 1;
+    if (c->range < 256) {
+        c->range <<= 1;
+        c->cnt--;
+        VVC_CABAC_REFILL(c);
+    }
+    return 0;
+}
+
 #define GET_CABAC(ctx) vvc_get_cabac(&lc->ep->cc, lc->ep->cabac_state, ctx)
 
 //9.3.3.4 Truncated binary (TB) binarization process
@@ -918,31 +1065,28 @@ static int truncated_binary_decode(VVCLocalContext *lc, const int c_max)
     const int n = c_max + 1;
     const int k = av_log2(n);
     const int u = (1 << (k+1)) - n;
-    int v = 0;
-    for (int i = 0; i < k; i++)
-        v = (v << 1) | get_cabac_bypass(&lc->ep->cc);
+    int v = vvc_get_cabac_bypass_bits(&lc->ep->cc, k);
+
     if (v >= u) {
-        v = (v << 1) | get_cabac_bypass(&lc->ep->cc);
+        v = (v << 1) | vvc_get_cabac_bypass(&lc->ep->cc);
         v -= u;
     }
     return v;
 }
 
 // 9.3.3.6 Limited k-th order Exp-Golomb binarization process
-static int limited_kth_order_egk_decode(CABACContext *c, const int k, const int max_pre_ext_len, const int trunc_suffix_len)
+static int limited_kth_order_egk_decode(VVCCabacContext *c, const int k, const int max_pre_ext_len, const int trunc_suffix_len)
 {
     int pre_ext_len = 0;
     int escape_length;
-    int val = 0;
-    while ((pre_ext_len < max_pre_ext_len) && get_cabac_bypass(c))
+    int val;
+    while ((pre_ext_len < max_pre_ext_len) && vvc_get_cabac_bypass(c))
         pre_ext_len++;
     if (pre_ext_len == max_pre_ext_len)
         escape_length = trunc_suffix_len;
     else
         escape_length = pre_ext_len + k;
-    while (escape_length-- > 0) {
-        val = (val << 1) + get_cabac_bypass(c);
-    }
+    val  = vvc_get_cabac_bypass_bits(c, escape_length);
     val += ((1 << pre_ext_len) - 1) << k;
     return val;
 }
@@ -983,18 +1127,14 @@ int ff_vvc_sao_type_idx_decode(VVCLocalContext *lc)
     if (!GET_CABAC(SAO_TYPE_IDX))
         return SAO_NOT_APPLIED;
 
-    if (!get_cabac_bypass(&lc->ep->cc))
+    if (!vvc_get_cabac_bypass(&lc->ep->cc))
         return SAO_BAND;
     return SAO_EDGE;
 }
 
 int ff_vvc_sao_band_position_decode(VVCLocalContext *lc)
 {
-    int value = get_cabac_bypass(&lc->ep->cc);
-
-    for (int i = 0; i < 4; i++)
-        value = (value << 1) | get_cabac_bypass(&lc->ep->cc);
-    return value;
+    return vvc_get_cabac_bypass_bits(&lc->ep->cc, 5);
 }
 
 int ff_vvc_sao_offset_abs_decode(VVCLocalContext *lc)
@@ -1002,21 +1142,19 @@ int ff_vvc_sao_offset_abs_decode(VVCLocalContext *lc)
     int i = 0;
     const int length = (1 << (FFMIN(lc->fc->ps.sps->bit_depth, 10) - 5)) - 1;
 
-    while (i < length && get_cabac_bypass(&lc->ep->cc))
+    while (i < length && vvc_get_cabac_bypass(&lc->ep->cc))
         i++;
     return i;
 }
 
 int ff_vvc_sao_offset_sign_decode(VVCLocalContext *lc)
 {
-    return get_cabac_bypass(&lc->ep->cc);
+    return vvc_get_cabac_bypass(&lc->ep->cc);
 }
 
 int ff_vvc_sao_eo_class_decode(VVCLocalContext *lc)
 {
-    int ret = get_cabac_bypass(&lc->ep->cc) << 1;
-    ret    |= get_cabac_bypass(&lc->ep->cc);
-    return ret;
+    return vvc_get_cabac_bypass_bits(&lc->ep->cc, 2);
 }
 
 int ff_vvc_alf_ctb_flag(VVCLocalContext *lc, const int rx, const int ry, const int c_idx)
@@ -1076,7 +1214,7 @@ int ff_vvc_alf_ctb_cc_idc(VVCLocalContext *lc, const int rx, const int ry, const
     if (!GET_CABAC(inc))
         return 0;
     i++;
-    while (i < cc_filters_signalled && get_cabac_bypass(&lc->ep->cc))
+    while (i < cc_filters_signalled && vvc_get_cabac_bypass(&lc->ep->cc))
         i++;
     return i;
 }
@@ -1267,7 +1405,7 @@ int ff_vvc_intra_mip_flag(VVCLocalContext *lc, const uint8_t *intra_mip_flag)
 
 int ff_vvc_intra_mip_transposed_flag(VVCLocalContext *lc)
 {
-    return get_cabac_bypass(&lc->ep->cc);
+    return vvc_get_cabac_bypass(&lc->ep->cc);
 }
 
 int ff_vvc_intra_mip_mode(VVCLocalContext *lc)
@@ -1314,7 +1452,7 @@ int ff_vvc_intra_luma_not_planar_flag(VVCLocalContext *lc, const int intra_subpa
 int ff_vvc_intra_luma_mpm_idx(VVCLocalContext *lc)
 {
     int i;
-    for (i = 0; i < 4 && get_cabac_bypass(&lc->ep->cc); i++)
+    for (i = 0; i < 4 && vvc_get_cabac_bypass(&lc->ep->cc); i++)
         /* nothing */;
     return i;
 }
@@ -1333,14 +1471,14 @@ int ff_vvc_cclm_mode_idx(VVCLocalContext *lc)
 {
     if (!GET_CABAC(CCLM_MODE_IDX))
         return 0;
-    return get_cabac_bypass(&lc->ep->cc) + 1;
+    return vvc_get_cabac_bypass(&lc->ep->cc) + 1;
 }
 
 int ff_vvc_intra_chroma_pred_mode(VVCLocalContext *lc)
 {
     if (!GET_CABAC(INTRA_CHROMA_PRED_MODE))
         return 4;
-    return (get_cabac_bypass(&lc->ep->cc) << 1) | get_cabac_bypass(&lc->ep->cc);
+    return vvc_get_cabac_bypass_bits(&lc->ep->cc, 2);
 }
 
 int ff_vvc_general_merge_flag(VVCLocalContext *lc)
@@ -1370,7 +1508,7 @@ int ff_vvc_merge_subblock_idx(VVCLocalContext *lc, const int max_num_subblock_me
     int i;
     if (!GET_CABAC(MERGE_SUBBLOCK_IDX))
         return 0;
-    for (i = 1; i < max_num_subblock_merge_cand - 1 && get_cabac_bypass(&lc->ep->cc); i++)
+    for (i = 1; i < max_num_subblock_merge_cand - 1 && vvc_get_cabac_bypass(&lc->ep->cc); i++)
         /* nothing */;
     return i;
 }
@@ -1396,14 +1534,14 @@ static int mmvd_distance_idx_decode(VVCLocalContext *lc)
     int i;
     if (!GET_CABAC(MMVD_DISTANCE_IDX))
         return 0;
-    for (i = 1; i < 7 && get_cabac_bypass(&lc->ep->cc); i++)
+    for (i = 1; i < 7 && vvc_get_cabac_bypass(&lc->ep->cc); i++)
         /* nothing */;
     return i;
 }
 
 static int mmvd_direction_idx_decode(VVCLocalContext *lc)
 {
-    return (get_cabac_bypass(&lc->ep->cc) << 1) | get_cabac_bypass(&lc->ep->cc);
+    return vvc_get_cabac_bypass_bits(&lc->ep->cc, 2);
 }
 
 void ff_vvc_mmvd_offset_coding(VVCLocalContext *lc, Mv *mmvd_offset, const int ph_mmvd_fullpel_only_flag)
@@ -1443,19 +1581,14 @@ int ff_vvc_merge_idx(VVCLocalContext *lc)
     if (!GET_CABAC(MERGE_IDX))
         return 0;
 
-    for (i = 1; i < c_max && get_cabac_bypass(&lc->ep->cc); i++)
+    for (i = 1; i < c_max && vvc_get_cabac_bypass(&lc->ep->cc); i++)
         /* nothing */;
     return i;
 }
 
 int ff_vvc_merge_gpm_partition_idx(VVCLocalContext *lc)
 {
-    int i = 0;
-
-    for (int j = 0; j < 6; j++)
-        i = (i << 1) | get_cabac_bypass(&lc->ep->cc);
-
-    return i;
+    return vvc_get_cabac_bypass_bits(&lc->ep->cc, 6);
 }
 
 int ff_vvc_merge_gpm_idx(VVCLocalContext *lc, const int idx)
@@ -1466,7 +1599,7 @@ int ff_vvc_merge_gpm_idx(VVCLocalContext *lc, const int idx)
     if (!GET_CABAC(MERGE_IDX))
         return 0;
 
-    for (i = 1; i < c_max && get_cabac_bypass(&lc->ep->cc); i++)
+    for (i = 1; i < c_max && vvc_get_cabac_bypass(&lc->ep->cc); i++)
         /* nothing */;
 
     return i;
@@ -1517,7 +1650,7 @@ int ff_vvc_ref_idx_lx(VVCLocalContext *lc, const uint8_t nb_refs)
     while (i < max_ctx && GET_CABAC(REF_IDX_LX + i))
         i++;
     if (i == 2) {
-        while (i < c_max && get_cabac_bypass(&lc->ep->cc))
+        while (i < c_max && vvc_get_cabac_bypass(&lc->ep->cc))
             i++;
     }
     return i;
@@ -1540,7 +1673,7 @@ int ff_vvc_abs_mvd_minus2(VVCLocalContext *lc)
 
 int ff_vvc_mvd_sign_flag(VVCLocalContext *lc)
 {
-    return get_cabac_bypass(&lc->ep->cc);
+    return vvc_get_cabac_bypass(&lc->ep->cc);
 }
 
 int ff_vvc_mvp_lx_flag(VVCLocalContext *lc)
@@ -1593,7 +1726,7 @@ int ff_vvc_bcw_idx(VVCLocalContext *lc, const int no_backward_pred_flag)
     int i = 1;
     if (!GET_CABAC(BCW_IDX))
         return 0;
-    while (i < c_max && get_cabac_bypass(&lc->ep->cc))
+    while (i < c_max && vvc_get_cabac_bypass(&lc->ep->cc))
         i++;
     return i;
 }
@@ -1639,12 +1772,10 @@ int ff_vvc_cu_qp_delta_abs(VVCLocalContext *lc)
 
     // CuQpDeltaVal shall in the range of −( 32 + QpBdOffset / 2 ) to +( 31 + QpBdOffset / 2 )
     // so k = 6 should enough
-    for (k = 0; k < 6 && get_cabac_bypass(&lc->ep->cc); k++)
+    for (k = 0; k < 6 && vvc_get_cabac_bypass(&lc->ep->cc); k++)
         /* nothing */;
     i = (1 << k) - 1;
-    v = 0;
-    while (k--)
-        v = (v << 1) + get_cabac_bypass(&lc->ep->cc);
+    v = vvc_get_cabac_bypass_bits(&lc->ep->cc, k);
     v += i;
 
     return v + 5;
@@ -1652,7 +1783,7 @@ int ff_vvc_cu_qp_delta_abs(VVCLocalContext *lc)
 
 int ff_vvc_cu_qp_delta_sign_flag(VVCLocalContext *lc)
 {
-    return get_cabac_bypass(&lc->ep->cc);
+    return vvc_get_cabac_bypass(&lc->ep->cc);
 }
 
 int ff_vvc_cu_chroma_qp_offset_flag(VVCLocalContext *lc)
@@ -1707,11 +1838,8 @@ static av_always_inline int last_sig_coeff_suffix_decode(VVCLocalContext *lc,
     const int last_significant_coeff_y_prefix)
 {
     const int length = (last_significant_coeff_y_prefix >> 1) - 1;
-    int value = get_cabac_bypass(&lc->ep->cc);
 
-    for (int i = 1; i < length; i++)
-        value = (value << 1) | get_cabac_bypass(&lc->ep->cc);
-    return value;
+    return vvc_get_cabac_bypass_bits(&lc->ep->cc, length);
 }
 
 int ff_vvc_tu_joint_cbcr_residual_flag(VVCLocalContext *lc, const int tu_cb_coded_flag, const int tu_cr_coded_flag)
@@ -1817,13 +1945,14 @@ static int sb_coded_flag_decode(VVCLocalContext *lc, const uint8_t *sb_coded_fla
     return GET_CABAC(SB_CODED_FLAG + inc);
 }
 
-static int sig_coeff_flag_decode(VVCLocalContext *lc, const ResidualCoding* rc, const int xc, const int yc)
+// ts is set for the transform skip residual coding
+static av_always_inline int sig_coeff_flag_decode(VVCLocalContext *lc, const ResidualCoding* rc,
+    const int xc, const int yc, const int ts)
 {
-    const H266RawSliceHeader *rsh = lc->sc->sh.r;
     const TransformBlock *tb      = rc->tb;
     int inc;
 
-    if (tb->ts && !rsh->sh_ts_residual_coding_disabled_flag) {
+    if (ts) {
         const int local_num_sig = get_local_sum_ts(rc->sig_coeff_flag, tb->tb_width, tb->tb_height, xc, yc);
         inc = 60 + local_num_sig;
     } else {
@@ -1871,14 +2000,12 @@ static int abs_decode(VVCLocalContext *lc, const int c_rice_param)
     const VVCSPS *sps = lc->fc->ps.sps;
     const int MAX_BIN = 6;
     int prefix = 0;
-    int suffix = 0;
+    int suffix;
 
-    while (prefix < MAX_BIN && get_cabac_bypass(&lc->ep->cc))
+    while (prefix < MAX_BIN && vvc_get_cabac_bypass(&lc->ep->cc))
         prefix++;
     if (prefix < MAX_BIN) {
-        for (int i = 0; i < c_rice_param; i++) {
-            suffix = (suffix << 1) | get_cabac_bypass(&lc->ep->cc);
-        }
+        suffix = vvc_get_cabac_bypass_bits(&lc->ep->cc, c_rice_param);
     } else {
         suffix = limited_kth_order_egk_decode(&lc->ep->cc,
                                               c_rice_param + 1,
@@ -1914,7 +2041,12 @@ static int abs_remainder_ts_decode(VVCLocalContext *lc, const ResidualCoding* rc
 
 static int coeff_sign_flag_decode(VVCLocalContext *lc)
 {
-    return get_cabac_bypass(&lc->ep->cc);
+    return vvc_get_cabac_bypass(&lc->ep->cc);
+}
+
+static unsigned coeff_sign_flags_decode(VVCLocalContext *lc, const int nb)
+{
+    return vvc_get_cabac_bypass_bits(&lc->ep->cc, nb);
 }
 
 //9.3.4.2.10 Derivation process of ctxInc for the syntax element coeff_sign_flag for transform skip mode
@@ -2033,6 +2165,15 @@ static void init_residual_coding(const VVCLocalContext *lc, ResidualCoding *rc,
     rc->tb = tb;
 }
 
+static av_always_inline void add_sparse_coeff(TransformBlock *tb, const int off, const int level)
+{
+    if (tb->nb_coeffs < MAX_SPARSE_COEFFS) {
+        tb->coeff_pos[tb->nb_coeffs]   = off;
+        tb->coeff_level[tb->nb_coeffs] = level;
+    }
+    tb->nb_coeffs++;
+}
+
 static int residual_ts_coding_subblock(VVCLocalContext *lc, ResidualCoding* rc, const int i)
 {
     const CodingUnit *cu   = lc->cu;
@@ -2066,7 +2207,7 @@ static int residual_ts_coding_subblock(VVCLocalContext *lc, ResidualCoding* rc,
         abs_level_gtx_flag[n] = 0;
         last_scan_pos_pass1 = n;
         if (*sb_coded_flag && (n != rc->num_sb_coeff - 1 || !infer_sb_sig_coeff_flag)) {
-            *sig_coeff_flag = sig_coeff_flag_decode(lc, rc, xc, yc);
+            *sig_coeff_flag = sig_coeff_flag_decode(lc, rc, xc, yc, 1);
             rc->rem_bins_pass1--;
             if (*sig_coeff_flag)
                 infer_sb_sig_coeff_flag = 0;
@@ -2139,6 +2280,7 @@ static int residual_ts_coding_subblock(VVCLocalContext *lc, ResidualCoding* rc,
         }
         if (*abs_level) {
             tb->coeffs[off] = *coeff_sign_level * *abs_level;
+            add_sparse_coeff(tb, off, tb->coeffs[off]);
             tb->max_scan_x = FFMAX(xc, tb->max_scan_x);
             tb->max_scan_y = FFMAX(yc, tb->max_scan_y);
             tb->min_scan_x = FFMIN(xc, tb->min_scan_x);
@@ -2165,22 +2307,26 @@ static int hls_residual_ts_coding(VVCLocalContext *lc, TransformBlock *tb)
     return 0;
 }
 
-static inline int residual_coding_subblock(VVCLocalContext *lc, ResidualCoding *rc, const int i)
+// sb_4x4: the sub-block is 4x4, dep_quant: sh_dep_quant_used_flag, sign_hiding: sh_sign_data_hiding_used_flag
+static av_always_inline int residual_coding_subblock(VVCLocalContext *lc, ResidualCoding *rc, const int i,
+    const int sb_4x4, const int dep_quant, const int sign_hiding)
 {
-    const H266RawSliceHeader *rsh = lc->sc->sh.r;
     TransformBlock *tb            = rc->tb;
+    const int log2_sb_w           = sb_4x4 ? 2 : rc->log2_sb_w;
+    const int log2_sb_h           = sb_4x4 ? 2 : rc->log2_sb_h;
+    const int num_sb_coeff        = 1 << (log2_sb_w + log2_sb_h);
     int first_sig_scan_pos_sb, last_sig_scan_pos_sb;
     int first_pos_mode0, first_pos_mode1;
     int infer_sb_dc_sig_coeff_flag = 0;
     int n, sig_hidden_flag, sum = 0;
+    int nb_signs = 0;
+    unsigned signs;
     int abs_level_gt2_flag[MAX_SUB_BLOCK_SIZE * MAX_SUB_BLOCK_SIZE];
     const int start_qstate_sb = rc->qstate;
     const int xs = rc->sb_scan_x_off[i];
     const int ys = rc->sb_scan_y_off[i];
     uint8_t *sb_coded_flag = rc->sb_coded_flag + ys * rc->width_in_sbs + xs;
 
-
-    av_assert0(rc->num_sb_coeff <= MAX_SUB_BLOCK_SIZE * MAX_SUB_BLOCK_SIZE);
     if (i < rc->last_sub_block && i > 0) {
         *sb_coded_flag = sb_coded_flag_decode(lc, sb_coded_flag, rc, xs, ys);
         infer_sb_dc_sig_coeff_flag = 1;
@@ -2193,19 +2339,19 @@ static inline int residual_coding_subblock(VVCLocalContext *lc, ResidualCoding *
     if (!*sb_coded_flag)
         return 0;
 
-    first_sig_scan_pos_sb = rc->num_sb_coeff;
+    first_sig_scan_pos_sb = num_sb_coeff;
     last_sig_scan_pos_sb = -1;
-    first_pos_mode0 = (i == rc->last_sub_block ? rc->last_scan_pos : rc->num_sb_coeff -1);
+    first_pos_mode0 = (i == rc->last_sub_block ? rc->last_scan_pos : num_sb_coeff -1);
     first_pos_mode1 = first_pos_mode0;
     for (n = first_pos_mode0; n >= 0 && rc->rem_bins_pass1 >= 4; n--) {
-        const int xc   = (xs << rc->log2_sb_w) + rc->scan_x_off[n];
-        const int yc   = (ys << rc->log2_sb_h) + rc->scan_y_off[n];
+        const int xc   = (xs << log2_sb_w) + rc->scan_x_off[n];
+        const int yc   = (ys << log2_sb_h) + rc->scan_y_off[n];
         const int last = (xc == rc->last_significant_coeff_x && yc == rc->last_significant_coeff_y);
         int *abs_level_pass1 = rc->abs_level_pass1 + yc * tb->tb_width + xc;
         int *sig_coeff_flag  = rc->sig_coeff_flag + yc * tb->tb_width + xc;
 
         if ((n > 0 || !infer_sb_dc_sig_coeff_flag ) && !last) {
-            *sig_coeff_flag = sig_coeff_flag_decode(lc, rc, xc, yc);
+            *sig_coeff_flag = sig_coeff_flag_decode(lc, rc, xc, yc, 0);
             rc->rem_bins_pass1--;
             if (*sig_coeff_flag)
                 infer_sb_dc_sig_coeff_flag = 0;
@@ -2236,14 +2382,14 @@ static inline int residual_coding_subblock(VVCLocalContext *lc, ResidualCoding *
             abs_level_gt2_flag[n] = 0;
         }
 
-        if (rsh->sh_dep_quant_used_flag)
+        if (dep_quant)
             rc->qstate = qstate_translate_table[rc->qstate][*abs_level_pass1 & 1];
 
         first_pos_mode1 = n - 1;
     }
     for (n = first_pos_mode0; n > first_pos_mode1; n--) {
-        const int xc = (xs << rc->log2_sb_w) + rc->scan_x_off[n];
-        const int yc = (ys << rc->log2_sb_h) + rc->scan_y_off[n];
+        const int xc = (xs << log2_sb_w) + rc->scan_x_off[n];
+        const int yc = (ys << log2_sb_h) + rc->scan_y_off[n];
         const int *abs_level_pass1 = rc->abs_level_pass1 + yc * tb->tb_width + xc;
         int *abs_level             = rc->abs_level + yc * tb->tb_width + xc;
 
@@ -2255,8 +2401,8 @@ static inline int residual_coding_subblock(VVCLocalContext *lc, ResidualCoding *
         }
     }
     for (n = first_pos_mode1; n >= 0; n--) {
-        const int xc   = (xs << rc->log2_sb_w) + rc->scan_x_off[n];
-        const int yc   = (ys << rc->log2_sb_h) + rc->scan_y_off[n];
+        const int xc   = (xs << log2_sb_w) + rc->scan_x_off[n];
+        const int yc   = (ys << log2_sb_h) + rc->scan_y_off[n];
         int *abs_level = rc->abs_level + yc * tb->tb_width + xc;
 
         if (*sb_coded_flag) {
@@ -2268,27 +2414,37 @@ static inline int residual_coding_subblock(VVCLocalContext *lc, ResidualCoding *
                 last_sig_scan_pos_sb = n;
             first_sig_scan_pos_sb = n;
         }
-        if (rsh->sh_dep_quant_used_flag)
+        if (dep_quant)
             rc->qstate = qstate_translate_table[rc->qstate][*abs_level & 1];
     }
-    sig_hidden_flag = rsh->sh_sign_data_hiding_used_flag &&
+    sig_hidden_flag = sign_hiding &&
         (last_sig_scan_pos_sb - first_sig_scan_pos_sb > 3 ? 1 : 0);
 
-    if (rsh->sh_dep_quant_used_flag)
+    if (dep_quant)
         rc->qstate = start_qstate_sb;
-    n = (i == rc->last_sub_block ? rc->last_scan_pos : rc->num_sb_coeff -1);
+    n = (i == rc->last_sub_block ? rc->last_scan_pos : num_sb_coeff -1);
+
+    // the sign flags of the sub-block are consecutive bypass bins, in scan order from the msb
+    for (int m = n; m >= 0; m--) {
+        const int xc  = (xs << log2_sb_w) + rc->scan_x_off[m];
+        const int yc  = (ys << log2_sb_h) + rc->scan_y_off[m];
+        nb_signs     += rc->abs_level[yc * tb->tb_width + xc] > 0;
+    }
+    nb_signs -= sig_hidden_flag;
+    signs     = coeff_sign_flags_decode(lc, nb_signs);
+
     for (/* nothing */; n >= 0; n--) {
         int trans_coeff_level;
-        const int xc  = (xs << rc->log2_sb_w) + rc->scan_x_off[n];
-        const int yc  = (ys << rc->log2_sb_h) + rc->scan_y_off[n];
+        const int xc  = (xs << log2_sb_w) + rc->scan_x_off[n];
+        const int yc  = (ys << log2_sb_h) + rc->scan_y_off[n];
         const int off = yc * tb->tb_width + xc;
         const int *abs_level = rc->abs_level + off;
 
         if (*abs_level > 0) {
             int sign = 1;
             if (!sig_hidden_flag || (n != first_sig_scan_pos_sb))
-                sign = 1 - 2 * coeff_sign_flag_decode(lc);
-            if (rsh->sh_dep_quant_used_flag) {
+                sign = 1 - 2 * ((signs >> --nb_signs) & 1);
+            if (dep_quant) {
                 trans_coeff_level = (2 * *abs_level - (rc->qstate > 1)) * sign;
             } else {
                 trans_coeff_level = *abs_level * sign;
@@ -2299,16 +2455,39 @@ static inline int residual_coding_subblock(VVCLocalContext *lc, ResidualCoding *
                 }
             }
             tb->coeffs[off] = trans_coeff_level;
+            add_sparse_coeff(tb, off, trans_coeff_level);
             tb->max_scan_x = FFMAX(xc, tb->max_scan_x);
             tb->max_scan_y = FFMAX(yc, tb->max_scan_y);
+            tb->min_scan_x = FFMIN(xc, tb->min_scan_x);
+            tb->min_scan_y = FFMIN(yc, tb->min_scan_y);
         }
-        if (rsh->sh_dep_quant_used_flag)
+        if (dep_quant)
             rc->qstate = qstate_translate_table[rc->qstate][*abs_level & 1];
     }
 
     return 0;
 }
 
+#define RESIDUAL_CODING_SUBBLOCK(sb_4x4, dep_quant, sign_hiding)                                    \
+static int residual_coding_subblock_##sb_4x4##_##dep_quant##_##sign_hiding(VVCLocalContext *lc,     \
+    ResidualCoding *rc, const int i)                                                                \
+{                                                                                                   \
+    return residual_coding_subblock(lc, rc, i, sb_4x4, dep_quant, sign_hiding);                     \
+}
+
+// sign data hiding is not allowed with dependent quantization
+RESIDUAL_CODING_SUBBLOCK(0, 0, 0)
+RESIDUAL_CODING_SUBBLOCK(0, 0, 1)
+RESIDUAL_CODING_SUBBLOCK(0, 1, 0)
+RESIDUAL_CODING_SUBBLOCK(1, 0, 0)
+RESIDUAL_CODING_SUBBLOCK(1, 0, 1)
+RESIDUAL_CODING_SUBBLOCK(1, 1, 0)
+
+static int (*const residual_coding_subblocks[2][2][2])(VVCLocalContext *lc, ResidualCoding *rc, int i) = {
+    { { residual_coding_subblock_0_0_0, residual_coding_subblock_0_0_1 }, { residual_coding_subblock_0_1_0 } },
+    { { residual_coding_subblock_1_0_0, residual_coding_subblock_1_0_1 }, { residual_coding_subblock_1_1_0 } },
+};
+
 static void derive_last_scan_pos(ResidualCoding *rc)
 {
     int xc, yc, xs, ys;
@@ -2358,12 +2537,14 @@ static void last_significant_coeff_x_y_decode(ResidualCoding *rc, VVCLocalContex
 
 static int hls_residual_coding(VVCLocalContext *lc, TransformBlock *tb)
 {
-    const VVCSPS *sps        = lc->fc->ps.sps;
-    const CodingUnit *cu     = lc->cu;
-    const int log2_tb_width  = tb->log2_tb_width;
-    const int log2_tb_height = tb->log2_tb_height;
-    const int c_idx          = tb->c_idx;
+    const VVCSPS *sps             = lc->fc->ps.sps;
+    const H266RawSliceHeader *rsh = lc->sc->sh.r;
+    const CodingUnit *cu          = lc->cu;
+    const int log2_tb_width       = tb->log2_tb_width;
+    const int log2_tb_height      = tb->log2_tb_height;
+    const int c_idx               = tb->c_idx;
     int log2_zo_tb_width, log2_zo_tb_height;
+    int (*subblock)(VVCLocalContext *lc, ResidualCoding *rc, int i);
     ResidualCoding rc;
 
     if (sps->r->sps_mts_enabled_flag && cu->sbt_flag && !c_idx && log2_tb_width == 5 && log2_tb_height < 6)
@@ -2389,14 +2570,18 @@ static int hls_residual_coding(VVCLocalContext *lc, TransformBlock *tb)
     if ((rc.last_sub_block > 0 || rc.last_scan_pos > 0 ) && !c_idx)
         lc->parse.mts_dc_only = 0;
 
+    tb->min_scan_x = tb->min_scan_y = INT_MAX;
     memset(tb->coeffs, 0, tb->tb_width * tb->tb_height * sizeof(*tb->coeffs));
     memset(rc.abs_level, 0, tb->tb_width * tb->tb_height * sizeof(rc.abs_level[0]));
     memset(rc.sb_coded_flag, 0, rc.nb_sbs);
     memset(rc.abs_level_pass1, 0, tb->tb_width * tb->tb_height * sizeof(rc.abs_level_pass1[0]));
     memset(rc.sig_coeff_flag, 0, tb->tb_width * tb->tb_height * sizeof(rc.sig_coeff_flag[0]));
 
+    av_assert0(rc.num_sb_coeff <= MAX_SUB_BLOCK_SIZE * MAX_SUB_BLOCK_SIZE);
+    subblock = residual_coding_subblocks[rc.log2_sb_w == 2 && rc.log2_sb_h == 2]
+        [rsh->sh_dep_quant_used_flag][rsh->sh_sign_data_hiding_used_flag && !rsh->sh_dep_quant_used_flag];
     for (int i = rc.last_sub_block; i >= 0; i--) {
-        int ret = residual_coding_subblock(lc, &rc, i);
+        int ret = subblock(lc, &rc, i);
         if (ret < 0)
             return ret;
     }
@@ -2464,15 +2649,15 @@ int ff_vvc_mts_idx(VVCLocalContext *lc)
 
 int ff_vvc_end_of_slice_flag_decode(VVCLocalContext *lc)
 {
-    return get_cabac_terminate(&lc->ep->cc);
+    return vvc_get_cabac_terminate(&lc->ep->cc);
 }
 
 int ff_vvc_end_of_tile_one_bit(VVCLocalContext *lc)
 {
-    return get_cabac_terminate(&lc->ep->cc);
+    return vvc_get_cabac_terminate(&lc->ep->cc);
 }
 
 int ff_vvc_end_of_subset_one_bit(VVCLocalContext *lc)
 {
-    return get_cabac_terminate(&lc->ep->cc);
+    return vvc_get_cabac_terminate(&lc->ep->cc);
 }
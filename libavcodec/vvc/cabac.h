@@ -25,6 +25,13 @@
 
 #include "ctu.h"
 
+/**
+ * Start the arithmetic decoder at buf + start, the bytes from end on read as zeros.
+ * epb are the sorted positions of the nb_epb emulation prevention bytes left in buf,
+ * they are skipped when read.
+ */
+int ff_vvc_cabac_decoder_init(VVCCabacContext *c, const uint8_t *buf, int start, int end,
+    const int *epb, int nb_epb);
 int ff_vvc_cabac_init(VVCLocalContext *lc, int ctu_idx, int rx, int ry);
 
 //sao
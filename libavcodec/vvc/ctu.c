@@ -20,7 +20,7 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
-#include "libavcodec/refstruct.h"
+#include "libavutil/mem.h"
 
 #include "cabac.h"
 #include "ctu.h"
@@ -62,15 +62,12 @@ static void set_tb_pos(const VVCFrameContext *fc, const TransformBlock *tb)
 static void set_tb_tab(uint8_t *tab, uint8_t v, const VVCFrameContext *fc,
     const TransformBlock *tb)
 {
-    const int width  = tb->tb_width  << fc->ps.sps->hshift[tb->c_idx];
-    const int height = tb->tb_height << fc->ps.sps->vshift[tb->c_idx];
+    const int min_tu_width = fc->ps.pps->min_tu_width;
+    const int w            = FFMAX(1, (tb->tb_width  << fc->ps.sps->hshift[tb->c_idx]) >> MIN_TU_LOG2);
+    const int h            = FFMAX(1, (tb->tb_height << fc->ps.sps->vshift[tb->c_idx]) >> MIN_TU_LOG2);
+    const int off          = (tb->y0 >> MIN_TU_LOG2) * min_tu_width + (tb->x0 >> MIN_TU_LOG2);
 
-    for (int h = 0; h < height; h += MIN_TU_SIZE) {
-        const int y = (tb->y0 + h) >> MIN_TU_LOG2;
-        const int off = y * fc->ps.pps->min_tu_width + (tb->x0 >> MIN_TU_LOG2);
-        const int w = FFMAX(1, width >> MIN_TU_LOG2);
-        memset(tab + off, v, w);
-    }
+    ff_vvc_fill_rect(tab + off, min_tu_width, &v, 1, w, h);
 }
 
 // 8.7.1 Derivation process for quantization parameters
@@ -129,16 +126,9 @@ static void set_cb_tab(const VVCLocalContext *lc, uint8_t *tab, const uint8_t v)
     const int log2_min_cb_size  = fc->ps.sps->min_cb_log2_size_y;
     const int x_cb              = cu->x0 >> log2_min_cb_size;
     const int y_cb              = cu->y0 >> log2_min_cb_size;
-    const int cb_width          = cu->cb_width;
-    const int cb_height         = cu->cb_height;
-    int x                       = y_cb * pps->min_cb_width + x_cb;
-
-    for (int y = 0; y < (cb_height >> log2_min_cb_size); y++) {
-        const int width = cb_width >> log2_min_cb_size;
 
-        memset(&tab[x], v, width);
-        x += pps->min_cb_width;
-    }
+    ff_vvc_fill_rect(&tab[y_cb * pps->min_cb_width + x_cb], pps->min_cb_width, &v, 1,
+        cu->cb_width >> log2_min_cb_size, cu->cb_height >> log2_min_cb_size);
 }
 
 static int set_qp_y(VVCLocalContext *lc, const int x0, const int y0, const int has_qp_delta)
@@ -211,9 +201,68 @@ static void set_qp_c(VVCLocalContext *lc)
     }
 }
 
-static TransformUnit* alloc_tu(VVCFrameContext *fc, CodingUnit *cu)
+#define ARENA_BLOCK_SIZE (32 * 1024)
+
+typedef struct CTUArenaBlock {
+    struct CTUArenaBlock *next;
+    size_t used;
+    DECLARE_ALIGNED(16, uint8_t, data)[ARENA_BLOCK_SIZE];
+} CTUArenaBlock;
+
+static void *arena_alloc(CTUArena *a, size_t size)
+{
+    CTUArenaBlock *b = a->cur;
+    void *p;
+
+    size = FFALIGN(size, 16);
+    av_assert2(size <= ARENA_BLOCK_SIZE);
+    if (!b || b->used + size > sizeof(b->data)) {
+        CTUArenaBlock *next = b ? b->next : a->head;
+        if (!next) {
+            next = av_malloc(sizeof(*next));
+            if (!next)
+                return NULL;
+            next->next = NULL;
+            if (b)
+                b->next = next;
+            else
+                a->head = next;
+        }
+        next->used = 0;
+        a->cur = b = next;
+    }
+    p = b->data + b->used;
+    b->used += size;
+    return p;
+}
+
+// give back the tail of p, which must be the last allocation, past size
+static void arena_trim(CTUArena *a, void *p, size_t size)
 {
-    TransformUnit *tu = ff_refstruct_pool_get(fc->tu_pool);
+    CTUArenaBlock *b = a->cur;
+
+    av_assert2((uint8_t *)p >= b->data && (uint8_t *)p + size <= b->data + b->used);
+    b->used = (uint8_t *)p - b->data + FFALIGN(size, 16);
+}
+
+void ff_vvc_ctu_arena_reset(CTUArena *a)
+{
+    a->cur = NULL;
+}
+
+void ff_vvc_ctu_arena_free(CTUArena *a)
+{
+    while (a->head) {
+        CTUArenaBlock *b = a->head;
+        a->head = b->next;
+        av_free(b);
+    }
+    a->cur = NULL;
+}
+
+static TransformUnit* alloc_tu(VVCLocalContext *lc, CodingUnit *cu)
+{
+    TransformUnit *tu = arena_alloc(lc->arena, sizeof(*tu));
     if (!tu)
         return NULL;
 
@@ -228,9 +277,9 @@ static TransformUnit* alloc_tu(VVCFrameContext *fc, CodingUnit *cu)
     return tu;
 }
 
-static TransformUnit* add_tu(VVCFrameContext *fc, CodingUnit *cu, const int x0, const int y0, const int tu_width, const int tu_height)
+static TransformUnit* add_tu(VVCLocalContext *lc, CodingUnit *cu, const int x0, const int y0, const int tu_width, const int tu_height)
 {
-    TransformUnit *tu = alloc_tu(fc, cu);
+    TransformUnit *tu = alloc_tu(lc, cu);
 
     if (!tu)
         return NULL;
@@ -246,6 +295,12 @@ static TransformUnit* add_tu(VVCFrameContext *fc, CodingUnit *cu, const int x0,
     return tu;
 }
 
+// called once the blocks of tu, the last unit allocated, are added
+static void trim_tu(VVCLocalContext *lc, TransformUnit *tu)
+{
+    arena_trim(lc->arena, tu, offsetof(TransformUnit, tbs) + FFMAX(tu->nb_tbs, 1) * sizeof(*tu->tbs));
+}
+
 static TransformBlock* add_tb(TransformUnit *tu, VVCLocalContext *lc,
     const int x0, const int y0, const int tb_width, const int tb_height, const int c_idx)
 {
@@ -262,14 +317,35 @@ static TransformBlock* add_tb(TransformUnit *tu, VVCLocalContext *lc,
 
     tb->max_scan_x = tb->max_scan_y = 0;
     tb->min_scan_x = tb->min_scan_y = 0;
+    tb->nb_coeffs  = 0;
 
     tb->c_idx = c_idx;
     tb->ts = 0;
-    tb->coeffs = lc->coeffs;
-    lc->coeffs += tb_width * tb_height;
+    if (lc->coeffs16) {
+        tb->coeffs16 = lc->coeffs16;
+        tb->coeffs   = lc->tb_coeffs;
+        lc->coeffs16 += tb_width * tb_height;
+    } else {
+        tb->coeffs16 = NULL;
+        tb->coeffs   = lc->coeffs;
+        lc->coeffs  += tb_width * tb_height;
+    }
     return tb;
 }
 
+// levels of conforming streams are within CoeffMin and CoeffMax, which is 16 bits
+// unless extended precision is used
+static void store_coeffs16(TransformBlock *tb)
+{
+    if (tb->nb_coeffs <= MAX_SPARSE_COEFFS) {
+        for (int i = 0; i < tb->nb_coeffs; i++)
+            tb->coeff_level[i] = av_clip_int16(tb->coeff_level[i]);
+        return;
+    }
+    for (int i = 0; i < tb->tb_width * tb->tb_height; i++)
+        tb->coeffs16[i] = av_clip_int16(tb->coeffs[i]);
+}
+
 static uint8_t tu_y_coded_flag_decode(VVCLocalContext *lc, const int is_sbt_not_coded,
     const int sub_tu_index, const int is_isp, const int is_chroma_coded)
 {
@@ -317,7 +393,7 @@ static int hls_transform_unit(VVCLocalContext *lc, int x0, int y0,int tu_width,
     const VVCSPS *sps   = fc->ps.sps;
     const VVCPPS *pps   = fc->ps.pps;
     CodingUnit *cu      = lc->cu;
-    TransformUnit *tu   = add_tu(fc, cu, x0, y0, tu_width, tu_height);
+    TransformUnit *tu   = add_tu(lc, cu, x0, y0, tu_width, tu_height);
     const int min_cb_width      = pps->min_cb_width;
     const VVCTreeType tree_type = cu->tree_type;
     const int is_128            = cu->cb_width > 64 || cu->cb_height > 64;
@@ -369,6 +445,7 @@ static int hls_transform_unit(VVCLocalContext *lc, int x0, int y0,int tu_width,
             add_tb(tu, lc, xc, yc, wc >> hs, hc >> vs, CR);
         }
     }
+    trim_tu(lc, tu);
     if (sps->r->sps_joint_cbcr_enabled_flag && ((cu->pred_mode == MODE_INTRA &&
         (tu->coded_flag[CB] || tu->coded_flag[CR])) ||
         (tu->coded_flag[CB] && tu->coded_flag[CR])) &&
@@ -392,6 +469,8 @@ static int hls_transform_unit(VVCLocalContext *lc, int x0, int y0,int tu_width,
             ret = ff_vvc_residual_coding(lc, tb);
             if (ret < 0)
                 return ret;
+            if (tb->coeffs16)
+                store_coeffs16(tb);
             set_tb_tab(fc->tab.tu_coded_flag[tb->c_idx], tu->coded_flag[tb->c_idx], fc, tb);
         }
         if (tb->c_idx != CR)
@@ -502,7 +581,7 @@ static int skipped_transform_tree(VVCLocalContext *lc, int x0, int y0,int tu_wid
         else
             SKIPPED_TRANSFORM_TREE(x0, y0 + trafo_height);
     } else {
-        TransformUnit *tu    = add_tu(fc, lc->cu, x0, y0, tu_width, tu_height);
+        TransformUnit *tu    = add_tu(lc, lc->cu, x0, y0, tu_width, tu_height);
         const int has_chroma = sps->r->sps_chroma_format_idc && cu->tree_type != DUAL_TREE_LUMA;
         const int c_start    = cu->tree_type == DUAL_TREE_CHROMA ? CB : LUMA;
         const int c_end      = has_chroma ? VVC_MAX_SAMPLE_ARRAYS : CB;
@@ -514,6 +593,7 @@ static int skipped_transform_tree(VVCLocalContext *lc, int x0, int y0,int tu_wid
             if (i != CR)
                 set_tb_pos(fc, tb);
         }
+        trim_tu(lc, tu);
     }
 
     return 0;
@@ -675,11 +755,6 @@ static int get_cclm_enabled(const VVCLocalContext *lc, const int x0, const int y
     return enabled;
 }
 
-static int less(const void *a, const void *b)
-{
-    return *(const int*)a - *(const int*)b;
-}
-
 //8.4.2 Derivation process for luma intra prediction mode
 static enum IntraPredMode luma_intra_pred_mode(VVCLocalContext* lc, const int intra_subpartitions_mode_flag)
 {
@@ -781,7 +856,14 @@ static enum IntraPredMode luma_intra_pred_mode(VVCLocalContext* lc, const int in
         if (intra_luma_mpm_flag) {
             pred = cand[intra_luma_mpm_idx];
         } else {
-            qsort(cand, FF_ARRAY_ELEMS(cand), sizeof(cand[0]), less);
+            // there are only 5 candidates, an insertion sort is cheaper than qsort
+            for (int i = 1; i < FF_ARRAY_ELEMS(cand); i++) {
+                const int c = cand[i];
+                int j = i;
+                for (; j > 0 && cand[j - 1] > c; j--)
+                    cand[j] = cand[j - 1];
+                cand[j] = c;
+            }
             pred = intra_luma_mpm_remainder + 1;
             for (int i = 0; i < FF_ARRAY_ELEMS(cand); i++) {
                 if (pred >= cand[i])
@@ -1177,7 +1259,7 @@ static CodingUnit* alloc_cu(VVCLocalContext *lc, const int x0, const int y0)
     const int rx        = x0 >> sps->ctb_log2_size_y;
     const int ry        = y0 >> sps->ctb_log2_size_y;
     CTU *ctu            = fc->tab.ctus + ry * pps->ctb_width + rx;
-    CodingUnit *cu      = ff_refstruct_pool_get(fc->cu_pool);
+    CodingUnit *cu      = arena_alloc(lc->arena, sizeof(*cu));
 
     if (!cu)
         return NULL;
@@ -1232,14 +1314,32 @@ static CodingUnit* add_cu(VVCLocalContext *lc, const int x0, const int y0,
 static void set_cu_tabs(const VVCLocalContext *lc, const CodingUnit *cu)
 {
     const VVCFrameContext *fc   = lc->fc;
+    const int min_cb_width      = fc->ps.pps->min_cb_width;
+    const int log2_min_cb_size  = fc->ps.sps->min_cb_log2_size_y;
+    const int w                 = cu->cb_width  >> log2_min_cb_size;
+    const int h                 = cu->cb_height >> log2_min_cb_size;
+    const int off               = (cu->y0 >> log2_min_cb_size) * min_cb_width + (cu->x0 >> log2_min_cb_size);
     const TransformUnit *tu     = cu->tus.head;
+    uint8_t *tabs[3];
+    uint8_t vals[3];
+    int nb_tabs = 0;
 
     if (cu->tree_type != DUAL_TREE_CHROMA) {
-        set_cb_tab(lc, fc->tab.cpm[LUMA], cu->pred_mode);
-        set_cb_tab(lc, fc->tab.skip, cu->skip_flag);
+        tabs[nb_tabs] = fc->tab.cpm[LUMA];
+        vals[nb_tabs++] = cu->pred_mode;
+        tabs[nb_tabs] = fc->tab.skip;
+        vals[nb_tabs++] = cu->skip_flag;
+    }
+    if (fc->ps.sps->r->sps_chroma_format_idc && cu->tree_type != DUAL_TREE_LUMA) {
+        tabs[nb_tabs] = fc->tab.cpm[CHROMA];
+        vals[nb_tabs++] = cu->pred_mode;
+    }
+
+    // write the cu level tables row by row in one pass
+    for (int y = 0; y < h; y++) {
+        for (int i = 0; i < nb_tabs; i++)
+            memset(tabs[i] + off + y * min_cb_width, vals[i], w);
     }
-    if (fc->ps.sps->r->sps_chroma_format_idc && cu->tree_type != DUAL_TREE_LUMA)
-        set_cb_tab(lc, fc->tab.cpm[CHROMA], cu->pred_mode);
 
     while (tu) {
           for (int j = 0; j < tu->nb_tbs; j++) {
@@ -1819,6 +1919,9 @@ static int hls_coding_unit(VVCLocalContext *lc, int x0, int y0, int cb_width, in
     if (IS_I(rsh) && is_128)
         mode_type = MODE_TYPE_INTRA;
     cu->pred_mode = pred_mode_decode(lc, tree_type, mode_type);
+    // no unit is allocated after cu yet, so it can drop the prediction unit it does not use
+    if (cu->pred_mode == MODE_INTRA)
+        arena_trim(lc->arena, cu, offsetof(CodingUnit, pu));
 
     if (cu->pred_mode == MODE_INTRA && sps->r->sps_palette_enabled_flag && !is_128 && !cu->skip_flag &&
         mode_type != MODE_TYPE_INTER && ((cb_width * cb_height) >
@@ -2391,9 +2494,16 @@ static int pred_get_y(const int y0, const Mv *mv, const int height)
     return FFMAX(0, y0 + (mv->y >> 4) + height);
 }
 
-static void cu_get_max_y(const CodingUnit *cu, int max_y[2][VVC_MAX_REF_ENTRIES], const VVCFrameContext *fc)
+static int pred_get_x(const int x0, const Mv *mv, const int width)
+{
+    return FFMAX(0, x0 + (mv->x >> 4) + width);
+}
+
+static void cu_get_max_y(const CodingUnit *cu, CTU *ctu, const VVCFrameContext *fc)
 {
     const PredictionUnit *pu    = &cu->pu;
+    int (*max_y)[VVC_MAX_REF_ENTRIES] = ctu->max_y;
+    int (*max_x)[VVC_MAX_REF_ENTRIES] = ctu->max_x;
 
     if (pu->merge_gpm_flag) {
         for (int i = 0; i < FF_ARRAY_ELEMS(pu->gpm_mv); i++) {
@@ -2401,8 +2511,10 @@ static void cu_get_max_y(const CodingUnit *cu, int max_y[2][VVC_MAX_REF_ENTRIES]
             const int lx        = mvf->pred_flag - PF_L0;
             const int idx       = mvf->ref_idx[lx];
             const int y         = pred_get_y(cu->y0, mvf->mv + lx, cu->cb_height);
+            const int x         = pred_get_x(cu->x0, mvf->mv + lx, cu->cb_width);
 
             max_y[lx][idx]      = FFMAX(max_y[lx][idx], y);
+            max_x[lx][idx]      = FFMAX(max_x[lx][idx], x);
         }
     } else {
         const MotionInfo *mi    = &pu->mi;
@@ -2419,8 +2531,10 @@ static void cu_get_max_y(const CodingUnit *cu, int max_y[2][VVC_MAX_REF_ENTRIES]
                     if (mvf->pred_flag & mask) {
                         const int idx   = mvf->ref_idx[lx];
                         const int y     = pred_get_y(y0, mvf->mv + lx, sbh);
+                        const int x     = pred_get_x(x0, mvf->mv + lx, sbw);
 
                         max_y[lx][idx]  = FFMAX(max_y[lx][idx], y + max_dmvr_off);
+                        max_x[lx][idx]  = FFMAX(max_x[lx][idx], x + max_dmvr_off);
                     }
                 }
             }
@@ -2438,12 +2552,14 @@ static void ctu_get_pred(VVCLocalContext *lc, const int rs)
     if (IS_I(rsh))
         return;
 
-    for (int lx = 0; lx < 2; lx++)
+    for (int lx = 0; lx < 2; lx++) {
         memset(ctu->max_y[lx], -1, sizeof(ctu->max_y[0][0]) * rsh->num_ref_idx_active[lx]);
+        memset(ctu->max_x[lx], -1, sizeof(ctu->max_x[0][0]) * rsh->num_ref_idx_active[lx]);
+    }
 
     while (cu) {
         if (has_inter_luma(cu)) {
-            cu_get_max_y(cu, ctu->max_y, fc);
+            cu_get_max_y(cu, ctu, fc);
             ctu->has_dmvr |= cu->pu.dmvr_flag;
         }
         cu = cu->next;
@@ -2459,17 +2575,15 @@ int ff_vvc_coding_tree_unit(VVCLocalContext *lc,
     const VVCPPS *pps           = fc->ps.pps;
     const int x_ctb             = rx << sps->ctb_log2_size_y;
     const int y_ctb             = ry << sps->ctb_log2_size_y;
-    const int ctb_size          = 1 << sps->ctb_log2_size_y << sps->ctb_log2_size_y;
     EntryPoint* ep              = lc->ep;
     int ret;
 
     if (rx == pps->ctb_to_col_bd[rx]) {
-        ep->num_hmvp = 0;
-        ep->num_hmvp_ibc = 0;
+        ep->hmvp.num     = 0;
+        ep->hmvp_ibc.num = 0;
         ep->is_first_qg = ry == pps->ctb_to_row_bd[ry] || !ctu_idx;
     }
 
-    lc->coeffs = fc->tab.coeffs + rs * ctb_size * VVC_MAX_SAMPLE_ARRAYS;
     lc->cu     = NULL;
 
     ff_vvc_cabac_init(lc, ctu_idx, rx, ry);
@@ -2487,6 +2601,7 @@ void ff_vvc_decode_neighbour(VVCLocalContext *lc, const int x_ctb, const int y_c
 {
     VVCFrameContext *fc = lc->fc;
     const int ctb_size         = fc->ps.sps->ctb_size_y;
+    CTU *ctu                   = fc->tab.ctus + rs;
 
     lc->end_of_tiles_x = fc->ps.pps->width;
     lc->end_of_tiles_y = fc->ps.pps->height;
@@ -2513,6 +2628,27 @@ void ff_vvc_decode_neighbour(VVCLocalContext *lc, const int x_ctb, const int y_c
     lc->ctb_up_right_flag = lc->ctb_up_flag && (fc->ps.pps->ctb_to_col_bd[rx] == fc->ps.pps->ctb_to_col_bd[rx + 1]) &&
         (fc->ps.pps->ctb_to_row_bd[ry] == fc->ps.pps->ctb_to_row_bd[ry - 1]);
     lc->ctb_up_left_flag = lc->ctb_left_flag && lc->ctb_up_flag;
+
+    ctu->ctb_left_flag     = lc->ctb_left_flag;
+    ctu->ctb_up_flag       = lc->ctb_up_flag;
+    ctu->ctb_up_right_flag = lc->ctb_up_right_flag;
+    ctu->ctb_up_left_flag  = lc->ctb_up_left_flag;
+    ctu->boundary_flags    = lc->boundary_flags;
+    ctu->end_of_tiles_x    = lc->end_of_tiles_x;
+    ctu->end_of_tiles_y    = lc->end_of_tiles_y;
+}
+
+void ff_vvc_load_neighbour(VVCLocalContext *lc, const int rs)
+{
+    const CTU *ctu = lc->fc->tab.ctus + rs;
+
+    lc->ctb_left_flag     = ctu->ctb_left_flag;
+    lc->ctb_up_flag       = ctu->ctb_up_flag;
+    lc->ctb_up_right_flag = ctu->ctb_up_right_flag;
+    lc->ctb_up_left_flag  = ctu->ctb_up_left_flag;
+    lc->boundary_flags    = ctu->boundary_flags;
+    lc->end_of_tiles_x    = ctu->end_of_tiles_x;
+    lc->end_of_tiles_y    = ctu->end_of_tiles_y;
 }
 
 void ff_vvc_set_neighbour_available(VVCLocalContext *lc,
@@ -2530,24 +2666,10 @@ void ff_vvc_set_neighbour_available(VVCLocalContext *lc,
     lc->na.cand_up_right = lc->na.cand_up_right_sap && (x0 + w) < lc->end_of_tiles_x;
 }
 
+// the units themselves are released with the arena they were allocated from
 void ff_vvc_ctu_free_cus(CTU *ctu)
 {
-    CodingUnit **cus  = &ctu->cus;
-    while (*cus) {
-        CodingUnit *cu          = *cus;
-        TransformUnit **head    = &cu->tus.head;
-
-        *cus = cu->next;
-
-        while (*head) {
-            TransformUnit *tu = *head;
-            *head = tu->next;
-            ff_refstruct_unref(&tu);
-        }
-        cu->tus.tail = NULL;
-
-        ff_refstruct_unref(&cu);
-    }
+    ctu->cus = NULL;
 }
 
 int ff_vvc_get_qPy(const VVCFrameContext *fc, const int xc, const int yc)
@@ -23,7 +23,9 @@
 #ifndef AVCODEC_VVC_CTU_H
 #define AVCODEC_VVC_CTU_H
 
-#include "libavcodec/cabac.h"
+#include <string.h>
+
+#include "libavutil/common.h"
 #include "libavutil/mem_internal.h"
 
 #include "dec.h"
@@ -42,6 +44,8 @@
 #define MAX_TB_SIZE             64
 #define MIN_TU_SIZE             4
 #define MAX_TUS_IN_CU           64
+#define MAX_SPARSE_COEFFS       4
+#define MIN_ISP_PRED_WIDTH      4
 
 #define MAX_QP                  63
 
@@ -84,6 +88,9 @@
 #define ALF_GRADIENT_SIZE       ((MAX_CU_SIZE + ALF_GRADIENT_BORDER * 2) / ALF_GRADIENT_STEP)
 #define ALF_NUM_DIR             4
 
+#define ALF_MAX_BLOCKS_IN_CTU   (MAX_CTU_SIZE * MAX_CTU_SIZE / ALF_BLOCK_SIZE / ALF_BLOCK_SIZE)
+#define ALF_MAX_FILTER_SIZE     (ALF_MAX_BLOCKS_IN_CTU * ALF_NUM_COEFF_LUMA)
+
 
 /**
  * Value of the luma sample at position (x, y) in the 2D array tab.
@@ -159,6 +166,13 @@ typedef struct TransformBlock {
     int bd_offset;
 
     int *coeffs;
+    int16_t *coeffs16;      ///< parsed levels if they fit in 16 bits, coeffs is a scratch buffer then
+
+    // the non-zero levels in parsing order, only stored if there are at most MAX_SPARSE_COEFFS of them,
+    // coeffs16 is not written then
+    int nb_coeffs;
+    int coeff_pos[MAX_SPARSE_COEFFS];       ///< y * tb_width + x
+    int coeff_level[MAX_SPARSE_COEFFS];
 } TransformBlock;
 
 typedef enum VVCTreeType {
@@ -177,9 +191,11 @@ typedef struct TransformUnit {
 
     uint8_t coded_flag[VVC_MAX_SAMPLE_ARRAYS];          ///< tu_y_coded_flag, tu_cb_coded_flag, tu_cr_coded_flag
     uint8_t nb_tbs;
-    TransformBlock tbs[VVC_MAX_SAMPLE_ARRAYS];
 
-    struct TransformUnit *next;                         ///< RefStruct reference
+    struct TransformUnit *next;
+
+    // last, the units are allocated with room for their nb_tbs blocks only
+    TransformBlock tbs[VVC_MAX_SAMPLE_ARRAYS];
 } TransformUnit;
 
 typedef enum PredMode {
@@ -204,6 +220,17 @@ typedef struct MvField {
     uint8_t ciip_flag;              ///< ciip_flag
 } MvField;
 
+/**
+ * The motion of an 8x8 block of a collocated picture, as 8.5.2.12 reads it.
+ * Per list: bit 0 predFlagLXCol, bit 1 the reference is long term, bits 2-9
+ * the POC distance to the reference clipped to int8, bits 10-20 and 21-31
+ * the compressed (8.5.2.15) horizontal and vertical motion, each a 7-bit
+ * mantissa above a 4-bit exponent.  Zero for intra.
+ */
+typedef struct ColMvField {
+    uint32_t lx[2];
+} ColMvField;
+
 typedef struct DMVRInfo {
     DECLARE_ALIGNED(8, Mv, mv)[2];  ///< mvL0, vvL1
     uint8_t dmvr_enabled;
@@ -317,30 +344,61 @@ typedef struct CodingUnit {
     int apply_lfnst_flag[VVC_MAX_SAMPLE_ARRAYS];    ///< ApplyLfnstFlag[]
 
     struct {
-        TransformUnit *head;                        ///< RefStruct reference
-        TransformUnit *tail;                        ///< RefStruct reference
+        TransformUnit *head;
+        TransformUnit *tail;
     } tus;
 
     int8_t qp[4];                                   ///< QpY, Qp′Cb, Qp′Cr, Qp′CbCr
 
-    PredictionUnit pu;
+    struct CodingUnit *next;
 
-    struct CodingUnit *next;                        ///< RefStruct reference
+    // last, intra coding units are allocated without it
+    PredictionUnit pu;
 } CodingUnit;
 
 typedef struct CTU {
     CodingUnit *cus;
     int max_y[2][VVC_MAX_REF_ENTRIES];
+    int max_x[2][VVC_MAX_REF_ENTRIES];
     int max_y_idx[2];
     int has_dmvr;
+    uint8_t has_bs[2];      ///< a boundary strength of the horizontal, vertical edges is not 0
+
+    // the neighbourhood of the ctu, computed when it is parsed and reloaded by the later stages
+    uint8_t ctb_left_flag;
+    uint8_t ctb_up_flag;
+    uint8_t ctb_up_right_flag;
+    uint8_t ctb_up_left_flag;
+    uint8_t boundary_flags;
+    int end_of_tiles_x;
+    int end_of_tiles_y;
 } CTU;
 
-typedef struct ReconstructedArea {
-    int x;
-    int y;
-    int w;
-    int h;
-} ReconstructedArea;
+/**
+ * Bump allocator for the coding and transform units of a CTU. All units are
+ * released at once by ff_vvc_ctu_arena_reset(), which keeps the memory for the
+ * next CTU.
+ */
+typedef struct CTUArena {
+    struct CTUArenaBlock *head;
+    struct CTUArenaBlock *cur;
+} CTUArena;
+
+// The arithmetic decoder. value holds the 9 bit ivlOffset followed by the cnt bits which are
+// read but not consumed yet, so renormalization only changes cnt and the refill is 32 bits.
+typedef struct VVCCabacContext {
+    uint64_t value;
+    int cnt;
+    unsigned range;                                 ///< ivlCurrRange
+    const uint8_t *buf;
+    size_t size;
+    size_t pos;                                     ///< bytes read into value, zeros past size
+    const int *epb;                                 ///< positions of the emulation prevention bytes left in buf
+    int nb_epb;
+    int epb_idx;                                    ///< the next one from pos on
+    size_t fast_end;                                ///< bytes before it can be read without checking for epb or size
+    unsigned bins;                                  ///< bins decoded, for the ctu statistics
+} VVCCabacContext;
 
 typedef struct VVCCabacState {
     uint16_t state[2];
@@ -349,23 +407,35 @@ typedef struct VVCCabacState {
 
 // VVC_CONTEXTS matched with SYNTAX_ELEMENT_LAST, it's checked by cabac_init_state.
 #define VVC_CONTEXTS 378
+/**
+ * A history-based motion vector candidate list, a ring of the candidates
+ * from the oldest, so that dropping the oldest moves nothing.
+ */
+typedef struct HMVPList {
+    MvField  cands[MAX_NUM_HMVP_CANDS];
+    uint64_t keys[MAX_NUM_HMVP_CANDS];              ///< the motion of cands in one word, see update_hmvp()
+    int      start;                                 ///< index of the oldest candidate
+    int      num;                                   ///< NumHmvpCand
+} HMVPList;
+
+// The entry points are parsed by different threads, so each one starts a cache line,
+// with the fields read by the other threads in the first one.
 typedef struct EntryPoint {
-    int8_t qp_y;                                    ///< QpY
+    DECLARE_ALIGNED(ALIGN_64, int, ctu_start);
+    int ctu_end;
+
+    DECLARE_ALIGNED(ALIGN_64, int8_t, qp_y);        ///< QpY
 
     int stat_coeff[VVC_MAX_SAMPLE_ARRAYS];          ///< StatCoeff
 
     VVCCabacState cabac_state[VVC_CONTEXTS];
-    CABACContext cc;
-
-    int ctu_start;
-    int ctu_end;
+    VVCCabacContext cc;
 
     uint8_t is_first_qg;                            // first quantization group
+    uint8_t lost;                                   ///< the cabac decoder did not start or a ctu failed to parse, the next ctus are concealed
 
-    MvField hmvp[MAX_NUM_HMVP_CANDS];               ///< HmvpCandList
-    int     num_hmvp;                               ///< NumHmvpCand
-    MvField hmvp_ibc[MAX_NUM_HMVP_CANDS];           ///< HmvpIbcCandList
-    int     num_hmvp_ibc;                           ///< NumHmvpIbcCand
+    HMVPList hmvp;                                  ///< HmvpCandList
+    HMVPList hmvp_ibc;                              ///< HmvpIbcCandList
 } EntryPoint;
 
 typedef struct VVCLocalContext {
@@ -376,16 +446,48 @@ typedef struct VVCLocalContext {
     int     end_of_tiles_x;
     int     end_of_tiles_y;
 
-    /* *2 for high bit depths */
-    DECLARE_ALIGNED(32, uint8_t, edge_emu_buffer)[EDGE_EMU_BUFFER_STRIDE * EDGE_EMU_BUFFER_STRIDE * 2];
-    DECLARE_ALIGNED(32, int16_t, tmp)[MAX_PB_SIZE * MAX_PB_SIZE];
-    DECLARE_ALIGNED(32, int16_t, tmp1)[MAX_PB_SIZE * MAX_PB_SIZE];
-    DECLARE_ALIGNED(32, int16_t, tmp2)[MAX_PB_SIZE * MAX_PB_SIZE];
-    DECLARE_ALIGNED(32, uint8_t, ciip_tmp)[MAX_PB_SIZE * MAX_PB_SIZE * 2];
-    DECLARE_ALIGNED(32, uint8_t, sao_buffer)[(MAX_CTU_SIZE + 2 * SAO_PADDING_SIZE) * EDGE_EMU_BUFFER_STRIDE * 2];
-    DECLARE_ALIGNED(32, uint8_t, alf_buffer_luma)[(MAX_CTU_SIZE + 2 * ALF_PADDING_SIZE) * EDGE_EMU_BUFFER_STRIDE * 2];
-    DECLARE_ALIGNED(32, uint8_t, alf_buffer_chroma)[(MAX_CTU_SIZE + 2 * ALF_PADDING_SIZE) * EDGE_EMU_BUFFER_STRIDE * 2];
-    DECLARE_ALIGNED(32, int32_t, alf_gradient_tmp)[ALF_GRADIENT_SIZE * ALF_GRADIENT_SIZE * ALF_NUM_DIR];
+    /*
+     * Scratch space, only valid within one task stage. A worker runs one stage
+     * at a time, so the buffers of different stages share memory.
+     */
+    union {
+        // parse
+        struct {
+            // residual coding output before it is stored to coeffs16
+            DECLARE_ALIGNED(32, int, tb_coeffs)[MAX_TB_SIZE * MAX_TB_SIZE];
+        };
+
+        // inter prediction, and CIIP in reconstruction
+        struct {
+            /* *2 for high bit depths */
+            DECLARE_ALIGNED(32, uint8_t, edge_emu_buffer)[EDGE_EMU_BUFFER_STRIDE * EDGE_EMU_BUFFER_STRIDE * 2];
+            DECLARE_ALIGNED(32, int16_t, tmp)[MAX_PB_SIZE * MAX_PB_SIZE];
+            DECLARE_ALIGNED(32, int16_t, tmp1)[MAX_PB_SIZE * MAX_PB_SIZE];
+            DECLARE_ALIGNED(32, int16_t, tmp2)[MAX_PB_SIZE * MAX_PB_SIZE];
+            DECLARE_ALIGNED(32, uint8_t, ciip_tmp)[MAX_PB_SIZE * MAX_PB_SIZE * 2];
+        };
+
+        // intra sub-partitions in reconstruction
+        struct {
+            // residuals of the vertical partitions sharing a prediction, one after the other
+            DECLARE_ALIGNED(32, int, isp_residual)[MIN_ISP_PRED_WIDTH * MAX_TB_SIZE];
+            int isp_coded;                      ///< isp_residual is set for the current prediction
+        };
+
+        // sao
+        struct {
+            DECLARE_ALIGNED(32, uint8_t, sao_buffer)[(MAX_CTU_SIZE + 2 * SAO_PADDING_SIZE) * EDGE_EMU_BUFFER_STRIDE * 2];
+        };
+
+        // alf
+        struct {
+            DECLARE_ALIGNED(32, uint8_t, alf_buffer_luma)[(MAX_CTU_SIZE + 2 * ALF_PADDING_SIZE) * EDGE_EMU_BUFFER_STRIDE * 2];
+            DECLARE_ALIGNED(32, uint8_t, alf_buffer_chroma)[(MAX_CTU_SIZE + 2 * ALF_PADDING_SIZE) * EDGE_EMU_BUFFER_STRIDE * 2];
+            DECLARE_ALIGNED(32, int32_t, alf_gradient_tmp)[ALF_GRADIENT_SIZE * ALF_GRADIENT_SIZE * ALF_NUM_DIR];
+            DECLARE_ALIGNED(32, int16_t, alf_coeff)[ALF_MAX_FILTER_SIZE];
+            DECLARE_ALIGNED(32, int16_t, alf_clip)[ALF_MAX_FILTER_SIZE];
+        };
+    };
 
     struct {
         int sbt_num_fourths_tb0;                ///< SbtNumFourthsTb0
@@ -414,8 +516,10 @@ typedef struct VVCLocalContext {
     } lmcs;
 
     CodingUnit *cu;
-    ReconstructedArea ras[2][MAX_PARTS_IN_CTU];
-    int num_ras[2];
+    // In decoding order, the reconstructed samples of each row of a CTU are a left prefix of it and
+    // those of each column a top prefix, so they are tracked by their ends, in samples of the channel type.
+    uint8_t recon_right[2][MAX_CTU_SIZE];   ///< end of the reconstructed part of each row of the CTU
+    uint8_t recon_bottom[2][MAX_CTU_SIZE];  ///< end of the reconstructed part of each column of the CTU
 
     NeighbourAvailable na;
 
@@ -433,6 +537,12 @@ typedef struct VVCLocalContext {
     VVCFrameContext *fc;
     EntryPoint *ep;
     int *coeffs;
+    int16_t *coeffs16;
+    CTUArena *arena;                ///< units of the CTU being parsed
+
+    struct VVCTask *continuation;   ///< a task made ready by the running one, run next by the same worker
+    int waiter;                     ///< the context of the thread in ff_vvc_frame_wait(), which runs short tasks only
+    int trace_id;                   ///< given on the first traced task, 0 before, see trace_add()
 } VVCLocalContext;
 
 typedef struct VVCAllowedSplit {
@@ -471,7 +581,8 @@ typedef struct VVCRect {
 } VVCRect;
 
 /**
- * parse a CTU
+ * parse a CTU, lc->coeffs or lc->coeffs16 must point to the coefficient slot of the CTU,
+ * and lc->arena to the arena its units are allocated from
  * @param lc local context for CTU
  * @param ctb_idx CTB(CTU) address in the current slice
  * @param rs raster order for the CTU.
@@ -483,9 +594,41 @@ int ff_vvc_coding_tree_unit(VVCLocalContext *lc, int ctu_idx, int rs, int rx, in
 
 //utils
 void ff_vvc_set_neighbour_available(VVCLocalContext *lc, int x0, int y0, int w, int h);
+/**
+ * Set the tile, slice and subpicture neighbourhood of a ctu in lc and keep it in
+ * its CTU entry. Called by the parse stage.
+ */
 void ff_vvc_decode_neighbour(VVCLocalContext *lc, int x_ctb, int y_ctb, int rx, int ry, int rs);
+// set the neighbourhood of the ctu in lc again, for the stages after parse
+void ff_vvc_load_neighbour(VVCLocalContext *lc, int rs);
 void ff_vvc_ctu_free_cus(CTU *ctu);
+void ff_vvc_ctu_arena_reset(CTUArena *a);
+void ff_vvc_ctu_arena_free(CTUArena *a);
 int ff_vvc_get_qPy(const VVCFrameContext *fc, int xc, int yc);
 void ff_vvc_ep_init_stat_coeff(EntryPoint *ep, int bit_depth, int persistent_rice_adaptation_enabled_flag);
 
+/**
+ * Fill a w x h rectangle of a side table with the element val of elem_size
+ * bytes. The first row is built by doubling copies of val, the other rows are
+ * row copies, so a large block costs a few wide stores per row rather than
+ * one store per element.
+ * @param stride row stride in bytes
+ */
+static av_always_inline void ff_vvc_fill_rect(void *dst, const ptrdiff_t stride,
+    const void *val, const size_t elem_size, const int w, const int h)
+{
+    const size_t row = w * elem_size;
+    uint8_t *d       = dst;
+
+    if (elem_size == 1) {
+        memset(d, *(const uint8_t *)val, row);
+    } else {
+        memcpy(d, val, elem_size);
+        for (size_t n = elem_size; n < row; n <<= 1)
+            memcpy(d + n, d, FFMIN(n, row - n));
+    }
+    for (int y = 1; y < h; y++)
+        memcpy(d + y * stride, d, row);
+}
+
 #endif // AVCODEC_VVC_CTU_H
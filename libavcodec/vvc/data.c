@@ -1732,6 +1732,26 @@ const uint8_t ff_vvc_alf_aps_class_to_filt_map[25] = {
     0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24,
 };
 
+// tx = (16384 + (Abs(td) >> 1)) / td of 8.5.2.12 and 8.5.2.7 for td = -128..127, 0 for td = 0
+const int16_t ff_vvc_mv_scale_tx[256] = {
+      -128,   -129,   -130,   -131,   -132,   -133,   -134,   -135,   -137,   -138,   -139,   -140,   -141,   -142,   -144,   -145,
+      -146,   -148,   -149,   -150,   -152,   -153,   -155,   -156,   -158,   -159,   -161,   -162,   -164,   -165,   -167,   -169,
+      -171,   -172,   -174,   -176,   -178,   -180,   -182,   -184,   -186,   -188,   -191,   -193,   -195,   -197,   -200,   -202,
+      -205,   -207,   -210,   -213,   -216,   -218,   -221,   -224,   -228,   -231,   -234,   -237,   -241,   -245,   -248,   -252,
+      -256,   -260,   -264,   -269,   -273,   -278,   -282,   -287,   -293,   -298,   -303,   -309,   -315,   -321,   -328,   -334,
+      -341,   -349,   -356,   -364,   -372,   -381,   -390,   -400,   -410,   -420,   -431,   -443,   -455,   -468,   -482,   -496,
+      -512,   -529,   -546,   -565,   -585,   -607,   -630,   -655,   -683,   -712,   -745,   -780,   -819,   -862,   -910,   -964,
+     -1024,  -1092,  -1170,  -1260,  -1365,  -1489,  -1638,  -1820,  -2048,  -2341,  -2731,  -3277,  -4096,  -5461,  -8192, -16384,
+         0,  16384,   8192,   5461,   4096,   3277,   2731,   2341,   2048,   1820,   1638,   1489,   1365,   1260,   1170,   1092,
+      1024,    964,    910,    862,    819,    780,    745,    712,    683,    655,    630,    607,    585,    565,    546,    529,
+       512,    496,    482,    468,    455,    443,    431,    420,    410,    400,    390,    381,    372,    364,    356,    349,
+       341,    334,    328,    321,    315,    309,    303,    298,    293,    287,    282,    278,    273,    269,    264,    260,
+       256,    252,    248,    245,    241,    237,    234,    231,    228,    224,    221,    218,    216,    213,    210,    207,
+       205,    202,    200,    197,    195,    193,    191,    188,    186,    184,    182,    180,    178,    176,    174,    172,
+       171,    169,    167,    165,    164,    162,    161,    159,    158,    156,    155,    153,    152,    150,    149,    148,
+       146,    145,    144,    142,    141,    140,    139,    138,    137,    135,    134,    133,    132,    131,    130,    129,
+};
+
 const int8_t ff_vvc_inter_luma_filters[VVC_INTER_LUMA_FILTER_TYPES][VVC_INTER_LUMA_FACTS][VVC_INTER_LUMA_TAPS] = {
     {
         //1x, hpelIfIdx == 0, Table 27
@@ -79,6 +79,8 @@ extern const int16_t  ff_vvc_alf_fix_filt_coeff[64][12];
 extern const uint8_t ff_vvc_alf_class_to_filt_map[16][25];
 extern const uint8_t ff_vvc_alf_aps_class_to_filt_map[25];
 
+extern const int16_t ff_vvc_mv_scale_tx[256];           ///< indexed by td + 128
+
 const uint8_t* ff_vvc_get_mip_matrix(const int size_id, const int mode_idx);
 
 #endif /* AVCODEC_VVC_DATA_H */
@@ -22,13 +22,22 @@
  */
 #include "libavcodec/codec_internal.h"
 #include "libavcodec/decode.h"
+#include "libavcodec/hwaccel_internal.h"
+#include "libavcodec/internal.h"
 #include "libavcodec/profiles.h"
 #include "libavcodec/refstruct.h"
 #include "libavutil/cpu.h"
+#include "libavutil/executor.h"
+#include "libavutil/film_grain_params.h"
 #include "libavutil/mem.h"
+#include "libavutil/motion_vector.h"
+#include "libavutil/opt.h"
 #include "libavutil/thread.h"
+#include "libavutil/video_coding_stats.h"
+#include "libavutil/video_enc_params.h"
 
 #include "dec.h"
+#include "cabac.h"
 #include "ctu.h"
 #include "data.h"
 #include "refs.h"
@@ -47,6 +56,14 @@ typedef struct TabList {
 
     int zero;
     int realloc;
+    int huge;
+
+    // raster grid of the tables, each ctu zeroes its own area of them when
+    // it is parsed instead of clearing the whole picture in frame_start()
+    int lazy;
+    int log2_unit;
+    int width;
+    int height;
 } TabList;
 
 #define TL_ADD(t, s) do {                                \
@@ -61,6 +78,16 @@ static void tl_init(TabList *l, const int zero, const int realloc)
     l->nb_tabs = 0;
     l->zero = zero;
     l->realloc = realloc;
+    l->huge = 0;
+    l->lazy = 0;
+}
+
+static void tl_init_lazy(TabList *l, const int log2_unit, const int width, const int height)
+{
+    l->lazy      = 1;
+    l->log2_unit = log2_unit;
+    l->width     = width;
+    l->height    = height;
 }
 
 static int tl_free(TabList *l)
@@ -78,11 +105,13 @@ static int tl_create(TabList *l)
 
         for (int i = 0; i < l->nb_tabs; i++) {
             Tab *t = l->tabs + i;
-            *t->tab = l->zero ? av_mallocz(t->size) : av_malloc(t->size);
+            *t->tab = l->huge ? av_malloc_huge(t->size) : av_malloc(t->size);
             if (!*t->tab)
                 return AVERROR(ENOMEM);
+            if (l->zero)
+                memset(*t->tab, 0, t->size);
         }
-    } else if (l->zero) {
+    } else if (l->zero && !l->lazy) {
         for (int i = 0; i < l->nb_tabs; i++) {
             Tab *t = l->tabs + i;
             memset(*t->tab, 0, t->size);
@@ -91,6 +120,28 @@ static int tl_create(TabList *l)
     return 0;
 }
 
+static void tl_reset_ctu(TabList *l, const VVCFrameContext *fc, const int rx, const int ry)
+{
+    const int log2_ctb_size = fc->ps.sps->ctb_log2_size_y;
+    const int shift         = log2_ctb_size - l->log2_unit;
+    const int x0            = rx << shift;
+    const int y0            = ry << shift;
+    const int x_end         = FFMIN(l->width,  (rx + 1) << shift);
+    const int y_end         = FFMIN(l->height, (ry + 1) << shift);
+
+    if (!l->zero || !l->lazy)
+        return;
+
+    for (int i = 0; i < l->nb_tabs; i++) {
+        const Tab *t      = l->tabs + i;
+        const size_t unit = t->size / ((size_t)l->width * l->height);
+        uint8_t *tab      = *t->tab;
+
+        for (int y = y0; y < y_end; y++)
+            memset(tab + (y * l->width + x0) * unit, 0, (x_end - x0) * unit);
+    }
+}
+
 static void ctu_tl_init(TabList *l, VVCFrameContext *fc)
 {
     const VVCPPS *pps   = fc->ps.pps;
@@ -98,6 +149,8 @@ static void ctu_tl_init(TabList *l, VVCFrameContext *fc)
     const int changed   = fc->tab.sz.ctu_count != ctu_count;
 
     tl_init(l, 1, changed);
+    if (pps)
+        tl_init_lazy(l, fc->ps.sps->ctb_log2_size_y, pps->ctb_width, pps->ctb_height);
 
     TL_ADD(deblock, ctu_count);
     TL_ADD(sao,     ctu_count);
@@ -105,32 +158,54 @@ static void ctu_tl_init(TabList *l, VVCFrameContext *fc)
     TL_ADD(ctus,    ctu_count);
 }
 
+// the coefficients of a ctu are only needed from parse to reconstruction,
+// so a few rows of slots are enough when parsing does not run far ahead
+static int coeff_slots(const VVCFrameContext *fc)
+{
+    const VVCPPS *pps = fc->ps.pps;
+
+    if (!pps)
+        return 0;
+    if (!fc->coeff_rows)
+        return pps->ctb_count;
+    return FFMIN(pps->ctb_count, fc->coeff_rows * pps->ctb_width);
+}
+
 static void ctu_nz_tl_init(TabList *l, VVCFrameContext *fc)
 {
     const VVCSPS *sps   = fc->ps.sps;
     const VVCPPS *pps   = fc->ps.pps;
     const int ctu_size  = sps ? (1 << sps->ctb_log2_size_y << sps->ctb_log2_size_y) : 0;
     const int ctu_count = pps ? pps->ctb_count : 0;
-    const int changed   = fc->tab.sz.ctu_count != ctu_count || fc->tab.sz.ctu_size != ctu_size;
+    const int slots     = coeff_slots(fc);
+    const int coeffs16  = sps ? sps->log2_transform_range == 15 : 0;
+    const int changed   = fc->tab.sz.ctu_count != ctu_count || fc->tab.sz.ctu_size != ctu_size ||
+        fc->tab.sz.coeff_slots != slots || fc->tab.sz.coeffs16 != coeffs16;
 
     tl_init(l, 0, changed);
     TL_ADD(slice_idx, ctu_count);
-    TL_ADD(coeffs,    ctu_count * ctu_size * VVC_MAX_SAMPLE_ARRAYS);
+    TL_ADD(coeffs,    coeffs16 ? 0 : slots * ctu_size * VVC_MAX_SAMPLE_ARRAYS);
+    TL_ADD(coeffs16,  coeffs16 ? slots * ctu_size * VVC_MAX_SAMPLE_ARRAYS : 0);
 }
 
 static void min_cb_tl_init(TabList *l, VVCFrameContext *fc)
 {
     const VVCPPS *pps            = fc->ps.pps;
     const int pic_size_in_min_cb = pps ? pps->min_cb_width * pps->min_cb_height : 0;
-    const int changed            = fc->tab.sz.pic_size_in_min_cb != pic_size_in_min_cb;
+    const int intra_only         = fc->ps.sps ? fc->ps.sps->intra_only : 0;
+    const int changed            = fc->tab.sz.pic_size_in_min_cb != pic_size_in_min_cb ||
+        fc->tab.sz.intra_only != intra_only;
 
     tl_init(l, 1, changed);
+    if (pps)
+        tl_init_lazy(l, fc->ps.sps->min_cb_log2_size_y, pps->min_cb_width, pps->min_cb_height);
 
     TL_ADD(skip, pic_size_in_min_cb);
     TL_ADD(imf,  pic_size_in_min_cb);
     TL_ADD(imtf, pic_size_in_min_cb);
     TL_ADD(imm,  pic_size_in_min_cb);
     TL_ADD(ipm,  pic_size_in_min_cb);
+    TL_ADD(qp[LUMA], pic_size_in_min_cb);
 
     for (int i = LUMA; i <= CHROMA; i++) {
         TL_ADD(cb_pos_x[i],  pic_size_in_min_cb);
@@ -139,8 +214,14 @@ static void min_cb_tl_init(TabList *l, VVCFrameContext *fc)
         TL_ADD(cb_height[i], pic_size_in_min_cb);
         TL_ADD(cqt_depth[i], pic_size_in_min_cb);
         TL_ADD(cpm[i],       pic_size_in_min_cb);
-        TL_ADD(cp_mv[i],     pic_size_in_min_cb * MAX_CONTROL_POINTS);
+        TL_ADD(cp_mv[i],     intra_only ? 0 : pic_size_in_min_cb * MAX_CONTROL_POINTS);
     };
+
+    // the motion vectors of the intra only sequences are block vectors, without subblocks,
+    // the subblock flags are set per cu, on the min cb grid
+    TL_ADD(msf, intra_only ? 0 : pic_size_in_min_cb);
+    TL_ADD(iaf, intra_only ? 0 : pic_size_in_min_cb);
+    TL_ADD(mmi, intra_only ? 0 : pic_size_in_min_cb);
 }
 
 static void min_pu_tl_init(TabList *l, VVCFrameContext *fc)
@@ -150,11 +231,11 @@ static void min_pu_tl_init(TabList *l, VVCFrameContext *fc)
     const int changed            = fc->tab.sz.pic_size_in_min_pu != pic_size_in_min_pu;
 
     tl_init(l, 1, changed);
+    if (pps)
+        tl_init_lazy(l, MIN_PU_LOG2, pps->min_pu_width, pps->min_pu_height);
 
-    TL_ADD(msf, pic_size_in_min_pu);
-    TL_ADD(iaf, pic_size_in_min_pu);
-    TL_ADD(mmi, pic_size_in_min_pu);
     TL_ADD(mvf, pic_size_in_min_pu);
+    TL_ADD(pf,  pic_size_in_min_pu);
 }
 
 static void min_tu_tl_init(TabList *l, VVCFrameContext *fc)
@@ -164,6 +245,8 @@ static void min_tu_tl_init(TabList *l, VVCFrameContext *fc)
     const int changed            = fc->tab.sz.pic_size_in_min_tu != pic_size_in_min_tu;
 
     tl_init(l, 1, changed);
+    if (pps)
+        tl_init_lazy(l, MIN_TU_LOG2, pps->min_tu_width, pps->min_tu_height);
 
     TL_ADD(tu_joint_cbcr_residual_flag, pic_size_in_min_tu);
     for (int i = LUMA; i <= CHROMA; i++) {
@@ -174,10 +257,11 @@ static void min_tu_tl_init(TabList *l, VVCFrameContext *fc)
         TL_ADD(pcmf[i],      pic_size_in_min_tu);
     }
 
-    for (int i = 0; i < VVC_MAX_SAMPLE_ARRAYS; i++) {
+    for (int i = 0; i < VVC_MAX_SAMPLE_ARRAYS; i++)
         TL_ADD(tu_coded_flag[i], pic_size_in_min_tu);
-        TL_ADD(qp[i],            pic_size_in_min_tu);
-    }
+    // the luma qp is set per cu, on the min cb grid
+    for (int i = CB; i < VVC_MAX_SAMPLE_ARRAYS; i++)
+        TL_ADD(qp[i], pic_size_in_min_tu);
 }
 
 static void bs_tl_init(TabList *l, VVCFrameContext *fc)
@@ -190,6 +274,8 @@ static void bs_tl_init(TabList *l, VVCFrameContext *fc)
         fc->tab.sz.bs_height != bs_height;
 
     tl_init(l, 1, changed);
+    if (pps)
+        tl_init_lazy(l, 2, bs_width, bs_height);
 
     for (int i = 0; i < 2; i++) {
         for (int j = 0; j < VVC_MAX_SAMPLE_ARRAYS; j++)
@@ -210,23 +296,27 @@ static void pixel_buffer_nz_tl_init(TabList *l, VVCFrameContext *fc)
     const int chroma_idc = sps ? sps->r->sps_chroma_format_idc : 0;
     const int ps         = sps ? sps->pixel_shift : 0;
     const int c_end      = chroma_idc ? VVC_MAX_SAMPLE_ARRAYS : 1;
+    const int has_sao    = sps ? sps->r->sps_sao_enabled_flag : 0;
+    const int has_alf    = sps ? sps->r->sps_alf_enabled_flag : 0;
     const int changed    = fc->tab.sz.chroma_format_idc != chroma_idc ||
         fc->tab.sz.width != width || fc->tab.sz.height != height ||
         fc->tab.sz.ctu_width != ctu_width || fc->tab.sz.ctu_height != ctu_height ||
-        fc->tab.sz.pixel_shift != ps;
+        fc->tab.sz.pixel_shift != ps ||
+        fc->tab.sz.has_sao != has_sao || fc->tab.sz.has_alf != has_alf;
 
     tl_init(l, 0, changed);
 
+    // the borders are only saved and read by the filters the sps enables
     for (int c_idx = 0; c_idx < c_end; c_idx++) {
-        const int w = width  >> (sps ? sps->hshift[c_idx] : 0);
-        const int h = height >> (sps ? sps->vshift[c_idx] : 0);
+        const int w = has_sao ? width  >> sps->hshift[c_idx] : 0;
+        const int h = has_sao ? height >> sps->vshift[c_idx] : 0;
         TL_ADD(sao_pixel_buffer_h[c_idx], (w * 2 * ctu_height) << ps);
         TL_ADD(sao_pixel_buffer_v[c_idx], (h * 2 * ctu_width)  << ps);
     }
 
     for (int c_idx = 0; c_idx < c_end; c_idx++) {
-        const int w = width  >> (sps ? sps->hshift[c_idx] : 0);
-        const int h = height >> (sps ? sps->vshift[c_idx] : 0);
+        const int w = has_alf ? width  >> sps->hshift[c_idx] : 0;
+        const int h = has_alf ? height >> sps->vshift[c_idx] : 0;
         const int border_pixels = c_idx ? ALF_BORDER_CHROMA : ALF_BORDER_LUMA;
         for (int i = 0; i < 2; i++) {
             TL_ADD(alf_pixel_buffer_h[c_idx][i], (w * border_pixels * ctu_height) << ps);
@@ -274,66 +364,123 @@ static void ibc_tl_init(TabList *l, VVCFrameContext *fc)
     const int changed    = fc->tab.sz.chroma_format_idc != chroma_idc ||
         fc->tab.sz.ctu_height != ctu_height ||
         fc->tab.sz.ctu_size != ctu_size ||
-        fc->tab.sz.pixel_shift != ps;
+        fc->tab.sz.pixel_shift != ps ||
+        fc->tab.sz.has_ibc != has_ibc;
 
     fc->tab.sz.ibc_buffer_width = ctu_size ? 2 * MAX_CTU_SIZE * MAX_CTU_SIZE / ctu_size : 0;
 
     tl_init(l, has_ibc, changed);
 
+    // without ibc in the sps nothing predicts from the virtual buffer
     for (int i = LUMA; i < VVC_MAX_SAMPLE_ARRAYS; i++) {
         const int hs = sps ? sps->hshift[i] : 0;
         const int vs = sps ? sps->vshift[i] : 0;
-        TL_ADD(ibc_vir_buf[i], fc->tab.sz.ibc_buffer_width * ctu_size * ctu_height << ps >> hs >> vs);
+        TL_ADD(ibc_vir_buf[i], has_ibc ? fc->tab.sz.ibc_buffer_width * ctu_size * ctu_height << ps >> hs >> vs : 0);
     }
 }
 
 typedef void (*tl_init_fn)(TabList *l, VVCFrameContext *fc);
 
+static const tl_init_fn tl_inits[] = {
+    ctu_tl_init,
+    ctu_nz_tl_init,
+    min_cb_tl_init,
+    min_pu_tl_init,
+    min_tu_tl_init,
+    bs_tl_init,
+    pixel_buffer_nz_tl_init,
+    msm_tl_init,
+    ispmf_tl_init,
+    ibc_tl_init,
+};
+
 static int frame_context_for_each_tl(VVCFrameContext *fc, int (*unary_fn)(TabList *l))
 {
+    for (int i = 0; i < FF_ARRAY_ELEMS(tl_inits); i++) {
+        TabList l;
+        int ret;
+
+        tl_inits[i](&l, fc);
+        l.huge = fc->huge_pages;
+        ret = unary_fn(&l);
+        if (ret < 0)
+            return ret;
+    }
+    return 0;
+}
+
+// called after tl_create(), so the sizes match the allocations
+static void frame_context_tl_bytes(VVCFrameContext *fc)
+{
+    fc->tab.sz.tables_bytes = 0;
+    fc->tab.sz.coeffs_bytes = 0;
+
+    for (int i = 0; i < FF_ARRAY_ELEMS(tl_inits); i++) {
+        TabList l;
+
+        tl_inits[i](&l, fc);
+        for (int j = 0; j < l.nb_tabs; j++) {
+            const Tab *t = l.tabs + j;
+
+            if (t->tab == (void **)&fc->tab.coeffs || t->tab == (void **)&fc->tab.coeffs16)
+                fc->tab.sz.coeffs_bytes += t->size;
+            else
+                fc->tab.sz.tables_bytes += t->size;
+        }
+    }
+}
+
+void ff_vvc_ctu_tabs_reset(VVCFrameContext *fc, const int rx, const int ry)
+{
+    // the lists set up with tl_init_lazy()
     const tl_init_fn init[] = {
         ctu_tl_init,
-        ctu_nz_tl_init,
         min_cb_tl_init,
         min_pu_tl_init,
         min_tu_tl_init,
         bs_tl_init,
-        pixel_buffer_nz_tl_init,
-        msm_tl_init,
-        ispmf_tl_init,
-        ibc_tl_init,
     };
 
     for (int i = 0; i < FF_ARRAY_ELEMS(init); i++) {
         TabList l;
-        int ret;
 
         init[i](&l, fc);
-        ret = unary_fn(&l);
-        if (ret < 0)
-            return ret;
-    }
-    return 0;
-}
-
-static void free_cus(VVCFrameContext *fc)
-{
-    if (fc->tab.ctus) {
-        for (int i = 0; i < fc->tab.sz.ctu_count; i++)
-            ff_vvc_ctu_free_cus(fc->tab.ctus + i);
+        tl_reset_ctu(&l, fc, rx, ry);
     }
 }
 
 static void pic_arrays_free(VVCFrameContext *fc)
 {
-    free_cus(fc);
     frame_context_for_each_tl(fc, tl_free);
     ff_refstruct_pool_uninit(&fc->rpl_tab_pool);
     ff_refstruct_pool_uninit(&fc->tab_dmvr_mvf_pool);
+    ff_refstruct_pool_uninit(&fc->tab_col_mvf_pool);
+    ff_refstruct_pool_uninit(&fc->rpl_pool);
+    fc->rpl_tab_pool_size      = 0;
+    fc->tab_dmvr_mvf_pool_size = 0;
+    fc->tab_col_mvf_pool_size  = 0;
+    fc->rpl_pool_size          = 0;
 
     memset(&fc->tab.sz, 0, sizeof(fc->tab.sz));
 }
 
+// replace the pool only when its entries are too small for the current picture,
+// frames still holding entries of the old pool keep it alive
+static int pool_reserve(FFRefStructPool **pool, size_t *pool_size, const size_t size)
+{
+    if (*pool && *pool_size >= size)
+        return 0;
+
+    ff_refstruct_pool_uninit(pool);
+    *pool_size = 0;
+    *pool = ff_refstruct_pool_alloc(size, FF_REFSTRUCT_POOL_FLAG_LOCK_FREE_RETURN);
+    if (!*pool)
+        return AVERROR(ENOMEM);
+    *pool_size = size;
+
+    return 0;
+}
+
 static int pic_arrays_init(VVCContext *s, VVCFrameContext *fc)
 {
     const VVCSPS *sps            = fc->ps.sps;
@@ -342,31 +489,45 @@ static int pic_arrays_init(VVCContext *s, VVCFrameContext *fc)
     const int pic_size_in_min_pu = pps->min_pu_width * pps->min_pu_height;
     int ret;
 
-    free_cus(fc);
-
+    // no walk over the ctus of the last picture: their units went back to the arenas with
+    // the coefficient slots, and the ctu entries are cleared when the ctus are parsed
     ret = frame_context_for_each_tl(fc, tl_create);
     if (ret < 0)
         return ret;
+    frame_context_tl_bytes(fc);
 
     memset(fc->tab.slice_idx, -1, sizeof(*fc->tab.slice_idx) * ctu_count);
 
-    if (fc->tab.sz.ctu_count != ctu_count) {
-        ff_refstruct_pool_uninit(&fc->rpl_tab_pool);
-        fc->rpl_tab_pool = ff_refstruct_pool_alloc(ctu_count * sizeof(RefPicListTab), 0);
-        if (!fc->rpl_tab_pool)
-            return AVERROR(ENOMEM);
-    }
+    // the pictures of an intra only sequence have no reference lists nor motion for later pictures
+    if (sps->intra_only)
+        goto done;
 
-    if (fc->tab.sz.pic_size_in_min_pu != pic_size_in_min_pu) {
-        ff_refstruct_pool_uninit(&fc->tab_dmvr_mvf_pool);
-        fc->tab_dmvr_mvf_pool = ff_refstruct_pool_alloc(
-            pic_size_in_min_pu * sizeof(MvField), FF_REFSTRUCT_POOL_FLAG_ZERO_EVERY_TIME);
-        if (!fc->tab_dmvr_mvf_pool)
-            return AVERROR(ENOMEM);
+    ret = pool_reserve(&fc->rpl_tab_pool, &fc->rpl_tab_pool_size, ctu_count * sizeof(RefPicListTab *));
+    if (ret < 0)
+        return ret;
+
+    ret = pool_reserve(&fc->tab_dmvr_mvf_pool, &fc->tab_dmvr_mvf_pool_size, pic_size_in_min_pu * sizeof(MvField));
+    if (ret < 0)
+        return ret;
+
+    if (sps->r->sps_temporal_mvp_enabled_flag) {
+        ret = pool_reserve(&fc->tab_col_mvf_pool, &fc->tab_col_mvf_pool_size,
+            AV_CEIL_RSHIFT(pps->width, COL_MV_LOG2) * AV_CEIL_RSHIFT(pps->height, COL_MV_LOG2) * sizeof(ColMvField));
+        if (ret < 0)
+            return ret;
     }
 
+    // round up, so a varying number of slices does not replace the pool every time
+    ret = pool_reserve(&fc->rpl_pool, &fc->rpl_pool_size,
+        (1 << av_ceil_log2(FFMAX(s->current_frame.nb_units, 1))) * sizeof(RefPicListTab));
+    if (ret < 0)
+        return ret;
+
+done:
     fc->tab.sz.ctu_count          = pps->ctb_count;
     fc->tab.sz.ctu_size           = 1 << sps->ctb_log2_size_y << sps->ctb_log2_size_y;
+    fc->tab.sz.coeff_slots        = coeff_slots(fc);
+    fc->tab.sz.coeffs16           = sps->log2_transform_range == 15;
     fc->tab.sz.pic_size_in_min_cb = pps->min_cb_width * pps->min_cb_height;
     fc->tab.sz.pic_size_in_min_pu = pic_size_in_min_pu;
     fc->tab.sz.pic_size_in_min_tu = pps->min_tu_width * pps->min_tu_height;
@@ -378,6 +539,10 @@ static int pic_arrays_init(VVCContext *s, VVCFrameContext *fc)
     fc->tab.sz.pixel_shift        = sps->pixel_shift;
     fc->tab.sz.bs_width           = (fc->ps.pps->width >> 2) + 1;
     fc->tab.sz.bs_height          = (fc->ps.pps->height >> 2) + 1;
+    fc->tab.sz.has_sao            = sps->r->sps_sao_enabled_flag;
+    fc->tab.sz.has_alf            = sps->r->sps_alf_enabled_flag;
+    fc->tab.sz.intra_only         = sps->intra_only;
+    fc->tab.sz.has_ibc            = sps->r->sps_ibc_enabled_flag;
 
     return 0;
 }
@@ -426,21 +591,16 @@ static void smvd_ref_idx(const VVCFrameContext *fc, SliceContext *sc)
     }
 }
 
-static void eps_free(SliceContext *slice)
-{
-    av_freep(&slice->eps);
-    slice->nb_eps = 0;
-}
-
 static void slices_free(VVCFrameContext *fc)
 {
     if (fc->slices) {
         for (int i = 0; i < fc->nb_slices_allocated; i++) {
             SliceContext *slice = fc->slices[i];
             if (slice) {
-                ff_refstruct_unref(&slice->ref);
+                av_buffer_unref(&slice->data_ref);
                 ff_refstruct_unref(&slice->sh.r);
-                eps_free(slice);
+                ff_refstruct_unref(&slice->rsh);
+                av_freep(&slice->epb);
                 av_free(slice);
             }
         }
@@ -448,9 +608,12 @@ static void slices_free(VVCFrameContext *fc)
     }
     fc->nb_slices_allocated = 0;
     fc->nb_slices = 0;
+
+    av_freep(&fc->eps);
+    fc->nb_eps_allocated = 0;
 }
 
-static int slices_realloc(VVCFrameContext *fc)
+static int slices_realloc(VVCContext *s, VVCFrameContext *fc)
 {
     void *p;
     const int size = (fc->nb_slices_allocated + 1) * 3 / 2;
@@ -458,6 +621,10 @@ static int slices_realloc(VVCFrameContext *fc)
     if (fc->nb_slices < fc->nb_slices_allocated)
         return 0;
 
+    // the started tasks look up the slices of their neighbours
+    if (fc->nb_slices)
+        ff_vvc_frame_pause(s, fc);
+
     p = av_realloc_array(fc->slices, size, sizeof(*fc->slices));
     if (!p)
         return AVERROR(ENOMEM);
@@ -476,56 +643,75 @@ static int slices_realloc(VVCFrameContext *fc)
     return 0;
 }
 
-static void ep_init_cabac_decoder(SliceContext *sc, const int index,
-    const H2645NAL *nal, GetBitContext *gb, const CodedBitstreamUnit *unit)
+// The entry points of all the slices of a frame share one pool, which only grows
+static int eps_alloc(VVCContext *s, VVCFrameContext *fc, SliceContext *sc, const int nb_eps)
 {
-    const H266RawSlice *slice     = unit->content_ref;
-    const H266RawSliceHeader *rsh = sc->sh.r;
-    EntryPoint *ep                = sc->eps + index;
-    int size;
-
-    if (index < rsh->num_entry_points) {
-        int skipped = 0;
-        int64_t start =  (gb->index >> 3);
-        int64_t end = start + rsh->sh_entry_point_offset_minus1[index] + 1;
-        while (skipped < nal->skipped_bytes && nal->skipped_bytes_pos[skipped] <= start + slice->header_size) {
-            skipped++;
-        }
-        while (skipped < nal->skipped_bytes && nal->skipped_bytes_pos[skipped] <= end + slice->header_size) {
-            end--;
-            skipped++;
+    const SliceContext *last = fc->nb_slices ? fc->slices[fc->nb_slices - 1] : NULL;
+    const int start          = last ? last->eps + last->nb_eps - fc->eps : 0;
+
+    if (start + nb_eps > fc->nb_eps_allocated) {
+        const int size = FFMAX(start + nb_eps, fc->nb_eps_allocated * 3 / 2);
+        // not av_realloc(), which would not keep the cache line alignment
+        EntryPoint *eps;
+
+        if (fc->nb_slices)
+            ff_vvc_frame_pause(s, fc);
+        eps = av_malloc_array(size, sizeof(*fc->eps));
+        if (!eps)
+            return AVERROR(ENOMEM);
+        if (start)
+            memcpy(eps, fc->eps, start * sizeof(*eps));
+        av_free(fc->eps);
+
+        // the entry points of the previous slices moved along
+        fc->eps = eps;
+        for (int i = 0; i < fc->nb_slices; i++) {
+            fc->slices[i]->eps = eps;
+            eps += fc->slices[i]->nb_eps;
         }
-        size = end - start;
-        size = av_clip(size, 0, get_bits_left(gb) / 8);
-    } else {
-        size = get_bits_left(gb) / 8;
+        fc->nb_eps_allocated = size;
+        if (fc->nb_slices && !s->avctx->hwaccel)
+            ff_vvc_frame_eps_moved(fc);
     }
-    av_assert0(gb->buffer + get_bits_count(gb) / 8 + size <= gb->buffer_end);
-    ff_init_cabac_decoder (&ep->cc, gb->buffer + get_bits_count(gb) / 8, size);
-    skip_bits(gb, size * 8);
+    sc->eps    = fc->eps + start;
+    sc->nb_eps = nb_eps;
+
+    return 0;
+}
+
+static int ep_init_cabac_decoder(const VVCContext *s, SliceContext *sc, const int index, int *start)
+{
+    const H266RawSliceHeader *rsh = sc->sh.r;
+    EntryPoint *ep                = sc->eps + index;
+    const int left                = sc->data_size - *start;
+    int size                      = left;
+    int ret;
+
+    // the offsets count the emulation prevention bytes, which are still in the slice data
+    if (index < rsh->num_entry_points)
+        size = FFMIN(rsh->sh_entry_point_offset_minus1[index] + 1LL, left);
+    ret = ff_vvc_cabac_decoder_init(&ep->cc, sc->data, *start, *start + size, sc->epb, sc->nb_epb);
+    *start += size;
+
+    // with concealment, only the ctus of this entry point are lost
+    ep->lost = ret < 0;
+    if (ret < 0 && !s->conceal)
+        return ret;
+    return 0;
 }
 
-static int slice_init_entry_points(SliceContext *sc,
-    VVCFrameContext *fc, const H2645NAL *nal, const CodedBitstreamUnit *unit)
+static int slice_init_entry_points(VVCContext *s, SliceContext *sc, VVCFrameContext *fc)
 {
     const VVCSH *sh           = &sc->sh;
-    const H266RawSlice *slice = unit->content_ref;
     int nb_eps                = sh->r->num_entry_points + 1;
     int ctu_addr              = 0;
-    GetBitContext gb;
+    int start                 = 0;
     int ret;
 
-    if (sc->nb_eps != nb_eps) {
-        eps_free(sc);
-        sc->eps = av_calloc(nb_eps, sizeof(*sc->eps));
-        if (!sc->eps)
-            return AVERROR(ENOMEM);
-        sc->nb_eps = nb_eps;
-    }
-
-    ret = init_get_bits8(&gb, slice->data, slice->data_size);
+    ret = eps_alloc(s, fc, sc, nb_eps);
     if (ret < 0)
         return ret;
+
     for (int i = 0; i < sc->nb_eps; i++)
     {
         EntryPoint *ep = sc->eps + i;
@@ -538,7 +724,9 @@ static int slice_init_entry_points(SliceContext *sc,
             fc->tab.slice_idx[rs] = sc->slice_idx;
         }
 
-        ep_init_cabac_decoder(sc, i, nal, &gb, unit);
+        ret = ep_init_cabac_decoder(s, sc, i, &start);
+        if (ret < 0)
+            return ret;
 
         if (i + 1 < sc->nb_eps)
             ctu_addr = sh->entry_point_start_ctu[i];
@@ -554,6 +742,26 @@ static VVCFrameContext* get_frame_context(const VVCContext *s, const VVCFrameCon
     return s->fcs + idx;
 }
 
+// the state of a picture that may differ between the frame contexts referencing it
+static void copy_frame_props(VVCFrame *dst, const VVCFrame *src)
+{
+    dst->nb_rpl_elems = src->nb_rpl_elems;
+
+    dst->poc = src->poc;
+    dst->ctb_count = src->ctb_count;
+
+    dst->scaling_win = src->scaling_win;
+    dst->ref_width   = src->ref_width;
+    dst->ref_height  = src->ref_height;
+    dst->padding      = src->padding;
+    dst->padding_wrap = src->padding_wrap;
+
+    dst->flags = src->flags;
+    dst->sequence = src->sequence;
+
+    dst->collocated_ref = NULL;
+}
+
 static int ref_frame(VVCFrame *dst, const VVCFrame *src)
 {
     int ret;
@@ -562,37 +770,43 @@ static int ref_frame(VVCFrame *dst, const VVCFrame *src)
     if (ret < 0)
         return ret;
 
+    if (src->output->buf[0]) {
+        ret = av_frame_ref(dst->output, src->output);
+        if (ret < 0)
+            return ret;
+    }
+
     ff_refstruct_replace(&dst->sps, src->sps);
     ff_refstruct_replace(&dst->pps, src->pps);
 
     ff_refstruct_replace(&dst->progress, src->progress);
+    ff_refstruct_replace(&dst->rpr_cache, src->rpr_cache);
 
     ff_refstruct_replace(&dst->tab_dmvr_mvf, src->tab_dmvr_mvf);
+    ff_refstruct_replace(&dst->tab_col_mvf, src->tab_col_mvf);
 
     ff_refstruct_replace(&dst->rpl_tab, src->rpl_tab);
     ff_refstruct_replace(&dst->rpl, src->rpl);
-    dst->nb_rpl_elems = src->nb_rpl_elems;
-
-    dst->poc = src->poc;
-    dst->ctb_count = src->ctb_count;
 
-    dst->scaling_win = src->scaling_win;
-    dst->ref_width   = src->ref_width;
-    dst->ref_height  = src->ref_height;
+    ff_refstruct_replace(&dst->hwaccel_picture_private, src->hwaccel_picture_private);
+    ff_refstruct_replace(&dst->stage_stats, src->stage_stats);
 
-    dst->flags = src->flags;
-    dst->sequence = src->sequence;
+    copy_frame_props(dst, src);
 
     return 0;
 }
 
+static void output_unref(VVCFrameContext *fc)
+{
+    av_frame_unref(fc->output_frame);
+    ff_refstruct_unref(&fc->output_progress);
+    ff_refstruct_unref(&fc->output_stats);
+}
+
 static av_cold void frame_context_free(VVCFrameContext *fc)
 {
     slices_free(fc);
 
-    ff_refstruct_pool_uninit(&fc->tu_pool);
-    ff_refstruct_pool_uninit(&fc->cu_pool);
-
     for (int i = 0; i < FF_ARRAY_ELEMS(fc->DPB); i++) {
         ff_vvc_unref_frame(fc, &fc->DPB[i], ~0);
         av_frame_free(&fc->DPB[i].frame);
@@ -600,32 +814,130 @@ static av_cold void frame_context_free(VVCFrameContext *fc)
 
     ff_vvc_frame_thread_free(fc);
     pic_arrays_free(fc);
+    output_unref(fc);
     av_frame_free(&fc->output_frame);
+    for (int i = 0; i < FF_ARRAY_ELEMS(fc->DPB); i++)
+        av_frame_free(&fc->DPB[i].output);
     ff_vvc_frame_ps_free(&fc->ps);
 }
 
-static av_cold int frame_context_init(VVCFrameContext *fc, AVCodecContext *avctx)
+static av_cold void frame_context_init(VVCFrameContext *fc, AVCodecContext *avctx)
 {
+    const VVCContext *s = avctx->priv_data;
 
-    fc->log_ctx = avctx;
-
-    fc->output_frame = av_frame_alloc();
-    if (!fc->output_frame)
-        return AVERROR(ENOMEM);
+    fc->log_ctx    = avctx;
+    // the replay runs the reconstruction again once the frame is done
+    fc->coeff_rows = s->replay ? 0 : s->coeff_rows;
+    fc->huge_pages = s->huge_pages;
+}
 
+// the frames of a frame context are allocated when it decodes its first picture,
+// a decoder opened for a few pictures does not set up all the frames in flight
+static int frame_context_alloc_frames(VVCFrameContext *fc)
+{
     for (int j = 0; j < FF_ARRAY_ELEMS(fc->DPB); j++) {
-        fc->DPB[j].frame = av_frame_alloc();
         if (!fc->DPB[j].frame)
+            fc->DPB[j].frame  = av_frame_alloc();
+        if (!fc->DPB[j].output)
+            fc->DPB[j].output = av_frame_alloc();
+        if (!fc->DPB[j].frame || !fc->DPB[j].output)
             return AVERROR(ENOMEM);
     }
-    fc->cu_pool = ff_refstruct_pool_alloc(sizeof(CodingUnit), 0);
-    if (!fc->cu_pool)
-        return AVERROR(ENOMEM);
 
-    fc->tu_pool = ff_refstruct_pool_alloc(sizeof(TransformUnit), 0);
-    if (!fc->tu_pool)
+    // allocated last, it marks the frame context as set up
+    fc->output_frame = av_frame_alloc();
+    if (!fc->output_frame)
         return AVERROR(ENOMEM);
+    return 0;
+}
+
+static int64_t frame_bytes(const VVCFrameContext *fc, const VVCFrame *frame)
+{
+    const AVFrame *f = frame->frame;
+    int64_t bytes    = 0;
+
+    if (!f->buf[0])
+        return 0;
+
+    for (int i = 0; i < FF_ARRAY_ELEMS(f->buf) && f->buf[i]; i++)
+        bytes += f->buf[i]->size;
+    for (int i = 0; i < FF_ARRAY_ELEMS(frame->output->buf) && frame->output->buf[i]; i++)
+        bytes += frame->output->buf[i]->size;
+
+    if (frame->tab_col_mvf)
+        bytes += fc->tab_col_mvf_pool_size;
+
+    return bytes + fc->tab_dmvr_mvf_pool_size + fc->rpl_tab_pool_size + fc->rpl_pool_size;
+}
+
+static void memory_usage_update(VVCContext *s, const VVCFrameContext *fc)
+{
+    s->memory_tables = 0;
+    s->memory_coeffs = 0;
+    for (int i = 0; i < s->nb_fcs_allocated; i++) {
+        s->memory_tables += s->fcs[i].tab.sz.tables_bytes;
+        s->memory_coeffs += s->fcs[i].tab.sz.coeffs_bytes;
+    }
+
+    // the dpb of the current frame holds its references and the frames waiting for output
+    s->memory_dpb = 0;
+    for (int i = 0; i < FF_ARRAY_ELEMS(fc->DPB); i++)
+        s->memory_dpb += frame_bytes(fc, &fc->DPB[i]);
+
+    s->memory_threads = (int64_t)(s->nb_local_contexts + !!s->wait_lc) * sizeof(VVCLocalContext);
+    s->memory_total   = s->memory_tables + s->memory_coeffs + s->memory_dpb + s->memory_threads;
+}
+
+// frame contexts after fc have not been used yet while the first nb_fcs frames are decoded
+static int64_t memory_projected(const VVCContext *s, const VVCFrameContext *fc)
+{
+    const int unused = s->nb_frames < s->nb_fcs ? s->nb_fcs - 1 - s->nb_frames : 0;
+
+    return s->memory_total + unused * (int64_t)(fc->tab.sz.tables_bytes + fc->tab.sz.coeffs_bytes);
+}
 
+static int memory_budget(VVCContext *s, VVCFrameContext *fc)
+{
+    int ret;
+
+    memory_usage_update(s, fc);
+    if (!s->max_memory || memory_projected(s, fc) <= s->max_memory)
+        return 0;
+
+    // bounding the coefficients costs the least parallelism, try it first
+    if (fc->coeff_rows != 1 && !s->replay) {
+        for (int i = 0; i < s->nb_fcs_allocated; i++)
+            s->fcs[i].coeff_rows = 1;
+        ret = pic_arrays_init(s, fc);
+        if (ret < 0)
+            return ret;
+        memory_usage_update(s, fc);
+        av_log(s->avctx, AV_LOG_VERBOSE, "max_memory: keeping 1 ctu row of coefficients.\n");
+        if (memory_projected(s, fc) <= s->max_memory)
+            return 0;
+    }
+
+    // lower the frame delay, which is only possible before the frame contexts wrap around
+    if (s->nb_frames < s->nb_fcs) {
+        const int64_t per_fc = fc->tab.sz.tables_bytes + fc->tab.sz.coeffs_bytes;
+        const int64_t spare  = s->max_memory - s->memory_total;
+        const int64_t extra  = per_fc && spare > 0 ? spare / per_fc : 0;
+        const int nb_fcs     = s->nb_frames + 1 + FFMIN(extra, s->nb_fcs);
+
+        if (nb_fcs < s->nb_fcs) {
+            av_log(s->avctx, AV_LOG_VERBOSE, "max_memory: decoding %d frames in parallel instead of %d.\n",
+                nb_fcs, s->nb_fcs);
+            s->nb_fcs = nb_fcs;
+        }
+        if (memory_projected(s, fc) <= s->max_memory)
+            return 0;
+    }
+
+    if (!s->over_budget) {
+        av_log(s->avctx, AV_LOG_WARNING, "max_memory of %"PRId64" bytes exceeded, %"PRId64" bytes in use.\n",
+            s->max_memory, s->memory_total);
+        s->over_budget = 1;
+    }
     return 0;
 }
 
@@ -639,9 +951,18 @@ static int frame_context_setup(VVCFrameContext *fc, VVCContext *s)
     if (s->nb_frames && s->nb_fcs > 1) {
         VVCFrameContext *prev = get_frame_context(s, fc, -1);
         for (int i = 0; i < FF_ARRAY_ELEMS(fc->DPB); i++) {
-            ff_vvc_unref_frame(fc, &fc->DPB[i], ~0);
-            if (prev->DPB[i].frame->buf[0]) {
-                ret = ref_frame(&fc->DPB[i], &prev->DPB[i]);
+            VVCFrame *dst       = &fc->DPB[i];
+            const VVCFrame *src = &prev->DPB[i];
+
+            // the progress is allocated per picture, so a slot still holding the same picture
+            // keeps its references and only takes the marking of the previous frame context
+            if (src->frame->buf[0] && dst->frame->buf[0] && dst->progress == src->progress) {
+                copy_frame_props(dst, src);
+                continue;
+            }
+            ff_vvc_unref_frame(fc, dst, ~0);
+            if (src->frame->buf[0]) {
+                ret = ref_frame(dst, src);
                 if (ret < 0)
                     return ret;
             }
@@ -656,150 +977,755 @@ static int frame_context_setup(VVCFrameContext *fc, VVCContext *s)
     ret = pic_arrays_init(s, fc);
     if (ret < 0)
         return ret;
-    ff_vvc_dsp_init(&fc->vvcdsp, fc->ps.sps->bit_depth);
+    ret = memory_budget(s, fc);
+    if (ret < 0)
+        return ret;
+    ff_vvc_dsp_init_cpu(&fc->vvcdsp, fc->ps.sps->bit_depth, s->cpu_flags);
+    if (s->dsp_report && s->dsp_reported_bit_depth != fc->ps.sps->bit_depth) {
+        ff_vvc_dsp_log(s->avctx, AV_LOG_INFO, fc->ps.sps->bit_depth, s->cpu_flags);
+        s->dsp_reported_bit_depth = fc->ps.sps->bit_depth;
+    }
     ff_videodsp_init(&fc->vdsp, fc->ps.sps->bit_depth);
     return 0;
 }
 
-static int frame_start(VVCContext *s, VVCFrameContext *fc, SliceContext *sc)
+// the frame returned for ref, which carries the side data
+static AVFrame *output_of(const VVCFrame *ref)
 {
-    const VVCPH *ph                 = &fc->ps.ph;
-    const H266RawSliceHeader *rsh   = sc->sh.r;
-    int ret;
-
-    // 8.3.1 Decoding process for picture order count
-    if (!s->temporal_id && !ph->r->ph_non_ref_pic_flag && !(IS_RASL(s) || IS_RADL(s)))
-        s->poc_tid0 = ph->poc;
+    return ref->output->buf[0] ? ref->output : ref->frame;
+}
 
-    if ((ret = ff_vvc_set_new_ref(s, fc, &fc->frame)) < 0)
-        goto fail;
+static int ctu_stats_init(const VVCContext *s, VVCFrameContext *fc)
+{
+    const VVCSPS *sps = fc->ps.sps;
+    const VVCPPS *pps = fc->ps.pps;
 
-    if (!IS_IDR(s))
-        ff_vvc_bump_frame(s, fc);
+    fc->ctu_stats = NULL;
+    if ((!s->parse_only && !s->ctu_stats) || s->avctx->hwaccel)
+        return 0;
 
-    av_frame_unref(fc->output_frame);
+    fc->ctu_stats = av_video_coding_stats_create_side_data(output_of(fc->ref), pps->ctb_count);
+    if (!fc->ctu_stats)
+        return AVERROR(ENOMEM);
 
-    if ((ret = ff_vvc_output_frame(s, fc, fc->output_frame,rsh->sh_no_output_of_prior_pics_flag, 0)) < 0)
-        goto fail;
+    for (int rs = 0; rs < pps->ctb_count; rs++) {
+        AVVideoCodingBlockStats *b = av_video_coding_stats_block(fc->ctu_stats, rs);
 
-    if ((ret = ff_vvc_frame_rpl(s, fc, sc)) < 0)
-        goto fail;
+        b->src_x = (rs % pps->ctb_width) << sps->ctb_log2_size_y;
+        b->src_y = (rs / pps->ctb_width) << sps->ctb_log2_size_y;
+        b->w     = FFMIN(sps->ctb_size_y, pps->width  - b->src_x);
+        b->h     = FFMIN(sps->ctb_size_y, pps->height - b->src_y);
+    }
 
-    if ((ret = ff_vvc_frame_thread_init(fc)) < 0)
-        goto fail;
     return 0;
-fail:
-    if (fc->ref)
-        ff_vvc_unref_frame(fc, fc->ref, ~0);
-    fc->ref = NULL;
-    return ret;
 }
 
-static int slice_start(SliceContext *sc, VVCContext *s, VVCFrameContext *fc,
-    const CodedBitstreamUnit *unit, const int is_first_slice)
+static int mvf_equal(const MvField *a, const MvField *b)
 {
-    VVCSH *sh = &sc->sh;
-    int ret;
+    return a->pred_flag == b->pred_flag &&
+           a->ref_idx[0] == b->ref_idx[0] && a->mv[0].x == b->mv[0].x && a->mv[0].y == b->mv[0].y &&
+           a->ref_idx[1] == b->ref_idx[1] && a->mv[1].x == b->mv[1].x && a->mv[1].y == b->mv[1].y;
+}
 
-    ret = ff_vvc_decode_sh(sh, &fc->ps, unit);
-    if (ret < 0)
-        return ret;
+// whether the luma coding block of the min cb idx starts there, and its position in luma samples
+static int cb_start(const VVCFrameContext *fc, const int x_cb, const int y_cb, int *x0, int *y0)
+{
+    const int log2_min_cb_size = fc->ps.sps->min_cb_log2_size_y;
+    const int idx              = y_cb * fc->ps.pps->min_cb_width + x_cb;
 
-    ff_refstruct_replace(&sc->ref, unit->content_ref);
+    *x0 = fc->tab.cb_pos_x[LUMA][idx];
+    *y0 = fc->tab.cb_pos_y[LUMA][idx];
+    return *x0 == x_cb << log2_min_cb_size && *y0 == y_cb << log2_min_cb_size;
+}
 
-    if (is_first_slice) {
-        ret = frame_start(s, fc, sc);
-        if (ret < 0)
-            return ret;
-    } else if (fc->ref) {
-        if (!IS_I(sh->r)) {
-            ret = ff_vvc_slice_rpl(s, fc, sc);
-            if (ret < 0) {
-                av_log(fc->log_ctx, AV_LOG_WARNING,
-                       "Error constructing the reference lists for the current slice.\n");
-                return ret;
+// one vector per list for each inter coding unit, or for each of its 4x4 blocks if their
+// motion differs, e.g. with affine or dmvr. Only counts them if mvs is NULL.
+static int export_mvs(const VVCFrameContext *fc, AVMotionVector *mvs)
+{
+    const VVCPPS *pps    = fc->ps.pps;
+    const VVCFrame *cur  = fc->ref;
+    const int pu_stride  = pps->min_pu_width;
+    int nb_mvs = 0;
+
+    for (int y_cb = 0; y_cb < pps->min_cb_height; y_cb++) {
+        for (int x_cb = 0; x_cb < pps->min_cb_width; x_cb++) {
+            const int idx = y_cb * pps->min_cb_width + x_cb;
+            const MvField *first;
+            const RefPicList *rpl;
+            int x0, y0, w, h, bw, bh;
+
+            if (fc->tab.cpm[LUMA][idx] != MODE_INTER || !cb_start(fc, x_cb, y_cb, &x0, &y0))
+                continue;
+
+            w     = fc->tab.cb_width[LUMA][idx];
+            h     = fc->tab.cb_height[LUMA][idx];
+            first = cur->tab_dmvr_mvf + (y0 >> MIN_PU_LOG2) * pu_stride + (x0 >> MIN_PU_LOG2);
+            bw    = w;
+            bh    = h;
+            for (int y = 0; y < h >> MIN_PU_LOG2 && bw == w; y++) {
+                for (int x = 0; x < w >> MIN_PU_LOG2; x++) {
+                    if (!mvf_equal(first, first + y * pu_stride + x)) {
+                        bw = bh = MIN_PU_SIZE;
+                        break;
+                    }
+                }
+            }
+
+            rpl = ff_vvc_get_ref_list(fc, cur, x0, y0);
+            for (int y = 0; y < h; y += bh) {
+                for (int x = 0; x < w; x += bw) {
+                    const MvField *mvf = first + (y >> MIN_PU_LOG2) * pu_stride + (x >> MIN_PU_LOG2);
+
+                    for (int lx = 0; lx < 2; lx++) {
+                        AVMotionVector *mv;
+
+                        if (!(mvf->pred_flag & (PF_L0 << lx)))
+                            continue;
+                        if (mvs) {
+                            mv               = mvs + nb_mvs;
+                            mv->source       = rpl[lx].refs[mvf->ref_idx[lx]].poc < cur->poc ? -1 : 1;
+                            mv->w            = bw;
+                            mv->h            = bh;
+                            mv->dst_x        = x0 + x + bw / 2;
+                            mv->dst_y        = y0 + y + bh / 2;
+                            mv->motion_x     = mvf->mv[lx].x;
+                            mv->motion_y     = mvf->mv[lx].y;
+                            mv->motion_scale = 16;
+                            mv->src_x        = mv->dst_x + mv->motion_x / 16;
+                            mv->src_y        = mv->dst_y + mv->motion_y / 16;
+                            mv->flags        = 0;
+                        }
+                        nb_mvs++;
+                    }
+                }
             }
         }
-    } else {
-        av_log(fc->log_ctx, AV_LOG_ERROR, "First slice in a frame missing.\n");
-        return ret;
     }
 
-    if (!IS_I(sh->r))
-        smvd_ref_idx(fc, sc);
-
-    return 0;
+    return nb_mvs;
 }
 
-static void export_frame_params(VVCContext *s, const VVCFrameContext *fc)
+// one block per luma coding unit, only counts them if par is NULL
+static int export_enc_params(const VVCFrameContext *fc, AVVideoEncParams *par)
 {
-    AVCodecContext *c = s->avctx;
-    const VVCSPS *sps = fc->ps.sps;
     const VVCPPS *pps = fc->ps.pps;
+    int nb_blocks = 0;
+
+    for (int y_cb = 0; y_cb < pps->min_cb_height; y_cb++) {
+        for (int x_cb = 0; x_cb < pps->min_cb_width; x_cb++) {
+            const int idx = y_cb * pps->min_cb_width + x_cb;
+            int x0, y0;
+
+            if (!cb_start(fc, x_cb, y_cb, &x0, &y0))
+                continue;
+            if (par) {
+                AVVideoBlockParams *b = av_video_enc_params_block(par, nb_blocks);
+
+                b->src_x    = x0;
+                b->src_y    = y0;
+                b->w        = fc->tab.cb_width[LUMA][idx];
+                b->h        = fc->tab.cb_height[LUMA][idx];
+                b->delta_qp = fc->tab.qp[LUMA][idx] - par->qp;
+            }
+            nb_blocks++;
+        }
+    }
 
-    c->pix_fmt      = sps->pix_fmt;
-    c->coded_width  = pps->width;
-    c->coded_height = pps->height;
-    c->width        = pps->width  - ((pps->r->pps_conf_win_left_offset + pps->r->pps_conf_win_right_offset) << sps->hshift[CHROMA]);
-    c->height       = pps->height - ((pps->r->pps_conf_win_top_offset + pps->r->pps_conf_win_bottom_offset) << sps->vshift[CHROMA]);
+    return nb_blocks;
 }
 
-static int frame_setup(VVCFrameContext *fc, VVCContext *s)
+int ff_vvc_export_side_data(VVCContext *s, VVCFrameContext *fc)
 {
-    int ret = ff_vvc_decode_frame_ps(&fc->ps, s);
-    if (ret < 0)
-        return ret;
+    AVFrame *frame = output_of(fc->ref);
 
-    ret = frame_context_setup(fc, s);
-    if (ret < 0)
-        return ret;
+    if (s->avctx->export_side_data & AV_CODEC_EXPORT_DATA_MVS) {
+        const int nb_mvs = export_mvs(fc, NULL);
 
-    export_frame_params(s, fc);
-    return ret;
-}
+        if (nb_mvs) {
+            AVFrameSideData *sd = av_frame_new_side_data(frame, AV_FRAME_DATA_MOTION_VECTORS,
+                                                         nb_mvs * sizeof(AVMotionVector));
+            if (!sd)
+                return AVERROR(ENOMEM);
+            export_mvs(fc, (AVMotionVector *)sd->data);
+        }
+    }
+
+    if (s->avctx->export_side_data & AV_CODEC_EXPORT_DATA_VIDEO_ENC_PARAMS) {
+        const H266RawPPS *rpps = fc->ps.pps->r;
+        AVVideoEncParams *par  = av_video_enc_params_create_side_data(frame, AV_VIDEO_ENC_PARAMS_H266,
+                                                                      export_enc_params(fc, NULL));
+        if (!par)
+            return AVERROR(ENOMEM);
+
+        par->qp             = 26 + rpps->pps_init_qp_minus26;
+        par->delta_qp[1][0] = par->delta_qp[1][1] = rpps->pps_cb_qp_offset;
+        par->delta_qp[2][0] = par->delta_qp[2][1] = rpps->pps_cr_qp_offset;
+        export_enc_params(fc, par);
+    }
+
+    return 0;
+}
+
+// whether the picture is discarded at the given AVDiscard level, judged by its first slice
+static int is_discarded(const VVCContext *s, const VVCFrameContext *fc,
+    const H266RawSliceHeader *rsh, const enum AVDiscard skip)
+{
+    const H266RawPictureHeader *ph = fc->ps.ph.r;
+
+    return skip >= AVDISCARD_ALL ||
+        (skip >= AVDISCARD_NONKEY   && !IS_IRAP(s)) ||
+        (skip >= AVDISCARD_NONINTRA && ph->ph_inter_slice_allowed_flag) ||
+        (skip >= AVDISCARD_BIDIR    && rsh->sh_slice_type == VVC_SLICE_TYPE_B) ||
+        (skip >= AVDISCARD_NONREF   && ph->ph_non_ref_pic_flag);
+}
+
+// The pictures not output and not referenced by any picture that is, after a CRA or GDR
+// with NoOutputBeforeRecoveryFlag, e.g. after a seek: its RASL pictures, which only other
+// RASL pictures reference, and the non reference pictures before the recovery point.
+static int is_unused(const VVCContext *s, const VVCFrameContext *fc)
+{
+    if (!s->no_output_before_recovery_flag)
+        return 0;
+    return IS_RASL(s) || (!GDR_IS_RECOVERED(s) && fc->ps.ph.r->ph_non_ref_pic_flag);
+}
+
+// whether the picture of a is needed before the one of b, the order is strict
+static int needed_before(const VVCContext *s, const VVCFrameContext *a, const VVCFrameContext *b)
+{
+    const int seq = (int8_t)(a->sequence - b->sequence);
+
+    if (s->priority == VVC_PRIORITY_DEADLINE &&
+        a->deadline != AV_NOPTS_VALUE && b->deadline != AV_NOPTS_VALUE && a->deadline != b->deadline)
+        return a->deadline < b->deadline;
+    if (seq)
+        return seq < 0;
+    if (a->poc != b->poc)
+        return a->poc < b->poc;
+    return a->decode_order < b->decode_order;
+}
+
+// count the frames in flight needed before fc, and count fc in the ranks of the ones after it
+static void frame_rank(VVCContext *s, VVCFrameContext *fc)
+{
+    int rank = 0;
+
+    if (s->priority == VVC_PRIORITY_DECODE || s->avctx->hwaccel)
+        return;
+
+    fc->deadline = fc->ref->frame->pts;
+    fc->poc      = fc->ref->poc;
+    fc->sequence = fc->ref->sequence;
+    for (int i = 0; i < s->nb_delayed; i++) {
+        VVCFrameContext *other = get_frame_context(s, s->fcs, s->nb_frames - s->nb_delayed + i);
+
+        if (needed_before(s, other, fc))
+            rank++;
+        else
+            atomic_fetch_add(&other->rank, 1);
+    }
+    atomic_store(&fc->rank, rank);
+    fc->ranked = 1;
+}
+
+// fc is no longer in flight
+static void frame_unrank(VVCContext *s, VVCFrameContext *fc)
+{
+    if (!fc->ranked)
+        return;
+
+    for (int i = 0; i < s->nb_delayed; i++) {
+        VVCFrameContext *other = get_frame_context(s, s->fcs, s->nb_frames - s->nb_delayed + i);
+
+        if (other != fc && other->ranked && needed_before(s, fc, other))
+            atomic_fetch_sub(&other->rank, 1);
+    }
+    fc->ranked = 0;
+}
+
+static int frame_start(VVCContext *s, VVCFrameContext *fc, SliceContext *sc)
+{
+    const VVCPH *ph                 = &fc->ps.ph;
+    const H266RawSliceHeader *rsh   = sc->sh.r;
+    int ret;
+
+    // 8.3.1 Decoding process for picture order count
+    if (!s->temporal_id && !ph->r->ph_non_ref_pic_flag && !(IS_RASL(s) || IS_RADL(s)))
+        s->poc_tid0 = ph->poc;
+
+    fc->skip_loop_filter = is_discarded(s, fc, rsh, s->avctx->skip_loop_filter);
+    fc->skip_idct        = is_discarded(s, fc, rsh, s->avctx->skip_idct);
+    fc->gray             = CONFIG_GRAY && (s->avctx->flags & AV_CODEC_FLAG_GRAY) &&
+                           !s->avctx->hwaccel && fc->ps.sps->r->sps_chroma_format_idc;
+
+    if ((ret = ff_vvc_set_new_ref(s, fc, &fc->frame)) < 0)
+        goto fail;
+
+    if ((ret = ff_vvc_sei_to_frame(output_of(fc->ref), &s->sei, s->avctx, fc->ps.sps, ph->poc)) < 0)
+        goto fail;
+
+    if (s->stage_totals) {
+        fc->ref->stage_stats = ff_vvc_stage_stats_alloc(s);
+        if (!fc->ref->stage_stats) {
+            ret = AVERROR(ENOMEM);
+            goto fail;
+        }
+    }
+
+    if ((ret = ctu_stats_init(s, fc)) < 0)
+        goto fail;
+
+    if (!IS_IDR(s))
+        ff_vvc_bump_frame(s, fc);
+
+    output_unref(fc);
+
+    if ((ret = ff_vvc_output_frame(s, fc, fc->output_frame, &fc->output_progress,
+            rsh->sh_no_output_of_prior_pics_flag, 0)) < 0)
+        goto fail;
+
+    if ((ret = ff_vvc_frame_rpl(s, fc, sc)) < 0)
+        goto fail;
+
+    if (s->avctx->hwaccel)
+        ret = FF_HW_CALL(s->avctx, start_frame, NULL, 0);
+    else
+        ret = ff_vvc_frame_thread_init(s, fc);
+    if (ret < 0)
+        goto fail;
+    frame_rank(s, fc);
+    return 0;
+fail:
+    if (fc->ref)
+        ff_vvc_unref_frame(fc, fc->ref, ~0);
+    fc->ref = NULL;
+    return ret;
+}
+
+static int slice_start(SliceContext *sc, VVCContext *s, VVCFrameContext *fc,
+    const H266RawSliceHeader *rsh, const int is_first_slice)
+{
+    VVCSH *sh = &sc->sh;
+    int ret;
+
+    ret = ff_vvc_decode_sh(sh, &fc->ps, rsh);
+    if (ret < 0)
+        return ret;
+
+    // the tables and the reference lists of the inter slices are not set up
+    if (fc->ps.sps->intra_only && !IS_I(rsh)) {
+        av_log(fc->log_ctx, AV_LOG_ERROR, "Inter slice in an intra only sequence.\n");
+        return AVERROR_INVALIDDATA;
+    }
+
+    if (is_first_slice) {
+        ret = frame_start(s, fc, sc);
+        if (ret < 0)
+            return ret;
+    } else if (fc->ref) {
+        if (!IS_I(sh->r)) {
+            ret = ff_vvc_slice_rpl(s, fc, sc);
+            if (ret < 0) {
+                av_log(fc->log_ctx, AV_LOG_WARNING,
+                       "Error constructing the reference lists for the current slice.\n");
+                return ret;
+            }
+        }
+    } else {
+        av_log(fc->log_ctx, AV_LOG_ERROR, "First slice in a frame missing.\n");
+        return ret;
+    }
+
+    if (!IS_I(sh->r))
+        smvd_ref_idx(fc, sc);
+
+    return 0;
+}
+
+static enum AVPixelFormat get_output_format(const VVCContext *s, const VVCSPS *sps)
+{
+    static const enum AVPixelFormat semi_planar[][3] = {
+        { AV_PIX_FMT_NV12, AV_PIX_FMT_NV16, AV_PIX_FMT_NV24 },
+        { AV_PIX_FMT_P010, AV_PIX_FMT_P210, AV_PIX_FMT_P410 },
+        { AV_PIX_FMT_P012, AV_PIX_FMT_P212, AV_PIX_FMT_P412 },
+    };
+    const int chroma_format_idc = sps->r->sps_chroma_format_idc;
+
+    if (!s->semi_planar || s->parse_only || !chroma_format_idc)
+        return sps->pix_fmt;
+    return semi_planar[(sps->bit_depth - 8) >> 1][chroma_format_idc - 1];
+}
+
+static enum AVPixelFormat get_format(AVCodecContext *avctx, const enum AVPixelFormat sw_pix_fmt)
+{
+#define HWACCEL_MAX 0
+    enum AVPixelFormat pix_fmts[HWACCEL_MAX + 2], *fmt = pix_fmts;
+
+    *fmt++ = sw_pix_fmt;
+    *fmt   = AV_PIX_FMT_NONE;
+
+    return ff_get_format(avctx, pix_fmts);
+}
+
+static int export_frame_params(VVCContext *s, const VVCFrameContext *fc)
+{
+    AVCodecContext *c = s->avctx;
+    const VVCSPS *sps = fc->ps.sps;
+    const VVCPPS *pps = fc->ps.pps;
+    const enum AVPixelFormat sw_pix_fmt = get_output_format(s, sps);
+
+    // the hwaccel surfaces are sized for the largest picture, so RPR keeps the negotiated format
+    if (s->pix_fmt == AV_PIX_FMT_NONE || c->sw_pix_fmt != sw_pix_fmt ||
+        s->max_width  != sps->r->sps_pic_width_max_in_luma_samples ||
+        s->max_height != sps->r->sps_pic_height_max_in_luma_samples) {
+        c->coded_width  = sps->r->sps_pic_width_max_in_luma_samples;
+        c->coded_height = sps->r->sps_pic_height_max_in_luma_samples;
+        s->pix_fmt      = get_format(c, sw_pix_fmt);
+        if (s->pix_fmt < 0)
+            return AVERROR_INVALIDDATA;
+        s->max_width    = c->coded_width;
+        s->max_height   = c->coded_height;
+    }
+    s->lowres = !c->hwaccel && !s->parse_only ? c->lowres : 0;
+
+    c->pix_fmt      = s->pix_fmt;
+    c->coded_width  = pps->width;
+    c->coded_height = pps->height;
+    c->width        = pps->width  - ((pps->r->pps_conf_win_left_offset + pps->r->pps_conf_win_right_offset) << sps->hshift[CHROMA]);
+    c->height       = pps->height - ((pps->r->pps_conf_win_top_offset + pps->r->pps_conf_win_bottom_offset) << sps->vshift[CHROMA]);
+    c->width        = AV_CEIL_RSHIFT(c->width,  s->lowres);
+    c->height       = AV_CEIL_RSHIFT(c->height, s->lowres);
+
+    return 0;
+}
+
+// The executor is allocated with the first picture, so opening a decoder spawns no
+// thread. It runs no more threads than the pictures of the current sequence have
+// ctus, and a sequence of another resolution resizes it.
+static int executor_update(VVCContext *s, const VVCFrameContext *fc)
+{
+    const VVCSPS *sps   = fc->ps.sps;
+    const int ctb_count = AV_CEIL_RSHIFT(sps->r->sps_pic_width_max_in_luma_samples,  sps->ctb_log2_size_y) *
+                          AV_CEIL_RSHIFT(sps->r->sps_pic_height_max_in_luma_samples, sps->ctb_log2_size_y);
+    const int thread_count = av_clip(ctb_count, 1, FFMAX(s->thread_count, 1));
+
+    if (!s->executor) {
+        s->executor = ff_vvc_executor_alloc(s, s->thread_count);
+        if (!s->executor)
+            return AVERROR(ENOMEM);
+        s->nb_local_contexts = s->shared_threads ? av_cpu_count() : FFMAX(s->thread_count, 1);
+    }
+
+    // the shared executor serves other decoders too
+    if (s->thread_count && !s->shared_threads && thread_count != s->nb_local_contexts) {
+        const int ret = av_executor_set_thread_count(s->executor, thread_count);
+        if (ret < 0)
+            return ret;
+        s->nb_local_contexts = thread_count;
+    }
+
+    return 0;
+}
+
+// The shared executor is kept busy by the frames of all its decoders, so each of them
+// only needs its share of the threads in flight. For the small pictures of a fan-in of
+// many streams, this saves the tables and frames of most frame contexts. The frame delay
+// can only be lowered before the frame contexts wrap around, like in memory_budget().
+static void frame_delay_share(VVCContext *s, const VVCFrameContext *fc)
+{
+    const VVCPPS *pps = fc->ps.pps;
+    int nb_users, share, parallel, nb_fcs;
+
+    if (!s->shared_threads || s->max_frame_delay || s->nb_frames >= s->nb_fcs)
+        return;
+    nb_users = ff_vvc_executor_nb_users(s->executor);
+    if (nb_users < 2)
+        return;
+
+    // the ctus of a wavefront run two apart, and frames waiting for reference
+    // progress leave threads idle, see frame_delay()
+    share    = (s->nb_local_contexts + nb_users - 1) / nb_users;
+    parallel = FFMAX(FFMIN((pps->ctb_width + 1) / 2, pps->ctb_height), 1);
+    nb_fcs   = FFMAX(2 * ((share + parallel - 1) / parallel), s->nb_frames + 1);
+    nb_fcs   = FFMAX(nb_fcs, 2);
+
+    if (nb_fcs < s->nb_fcs) {
+        av_log(s->avctx, AV_LOG_VERBOSE, "shared_threads: decoding %d frames in parallel instead of %d "
+            "with %d decoders.\n", nb_fcs, s->nb_fcs, nb_users);
+        s->nb_fcs = nb_fcs;
+    }
+}
+
+static int frame_setup(VVCFrameContext *fc, VVCContext *s)
+{
+    int ret = ff_vvc_decode_frame_ps(&fc->ps, s);
+    if (ret < 0)
+        return ret;
+
+    ret = executor_update(s, fc);
+    if (ret < 0)
+        return ret;
+    frame_delay_share(s, fc);
+
+    ret = frame_context_setup(fc, s);
+    if (ret < 0)
+        return ret;
+
+    return export_frame_params(s, fc);
+}
+
+// the NAL units keep their emulation prevention bytes, see H2645NAL.escaped
+static int unescape_nal(uint8_t *dst, const uint8_t *src, const size_t size, const H2645NAL *nal)
+{
+    size_t pos = 0;
+    uint8_t *p = dst;
+
+    for (int i = 0; i < nal->skipped_bytes && nal->skipped_bytes_pos[i] < size; i++) {
+        const int epb = nal->skipped_bytes_pos[i];
+        memcpy(p, src + pos, epb - pos);
+        p  += epb - pos;
+        pos = epb + 1;
+    }
+    memcpy(p, src + pos, size - pos);
+    p += size - pos;
+    memset(p, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+
+    return p - dst;
+}
+
+// the position in the escaped NAL unit of a byte at pos once unescaped
+static size_t escaped_pos(const H2645NAL *nal, const size_t pos)
+{
+    int n = 0;
+
+    while (n < nal->skipped_bytes && nal->skipped_bytes_pos[n] - n <= pos)
+        n++;
+    return pos + n;
+}
+
+static int slice_header_escaped(const H2645NAL *nal, const size_t header_size)
+{
+    return nal->skipped_bytes && nal->skipped_bytes_pos[0] < header_size;
+}
+
+static int slice_init_data(SliceContext *sc, const H2645NAL *nal,
+    const uint8_t *data, const size_t size, const size_t header_size)
+{
+    int i = 0;
+
+    if (header_size >= size)
+        return AVERROR_INVALIDDATA;
+
+    sc->data      = data + header_size;
+    sc->data_size = size - header_size;
+
+    while (i < nal->skipped_bytes && nal->skipped_bytes_pos[i] < header_size)
+        i++;
+    sc->nb_epb = nal->skipped_bytes - i;
+    if (sc->nb_epb > sc->epb_size / sizeof(*sc->epb)) {
+        void *p = av_fast_realloc(sc->epb, &sc->epb_size, sc->nb_epb * sizeof(*sc->epb));
+        if (!p) {
+            sc->nb_epb = 0;
+            return AVERROR(ENOMEM);
+        }
+        sc->epb = p;
+    }
+    for (int j = 0; j < sc->nb_epb; j++)
+        sc->epb[j] = nal->skipped_bytes_pos[i + j] - header_size;
+
+    return 0;
+}
+
+// Reads the slice header with CBS, for the syntax ff_vvc_read_sh() does not handle.
+static int slice_read_header_cbs(VVCContext *s, SliceContext *sc, const H2645NAL *nal,
+    CodedBitstreamUnit *unit)
+{
+    const uint8_t *data = unit->data;
+    const size_t size   = unit->data_size;
+    const H266RawSlice *slice;
+    size_t header_size;
+    int ret;
+
+    ret = av_buffer_replace(&sc->data_ref, unit->data_ref);
+    if (ret < 0)
+        return ret;
+
+    ret = ff_cbs_read_unit(s->cbc, unit);
+    if (ret >= 0) {
+        slice = unit->content;
+        if (!slice_header_escaped(nal, slice->header_size))
+            return slice_init_data(sc, nal, data, size, slice->header_size);
+    } else if (!nal->skipped_bytes) {
+        return ret;
+    }
+
+    // CBS needs the slice header without the emulation prevention bytes, the
+    // slice data is still read from the escaped NAL unit
+    {
+        AVBufferRef *rbsp = av_buffer_alloc(size + AV_INPUT_BUFFER_PADDING_SIZE);
+        if (!rbsp)
+            return AVERROR(ENOMEM);
+        av_buffer_unref(&unit->data_ref);
+        unit->data_ref  = rbsp;
+        unit->data      = rbsp->data;
+        unit->data_size = unescape_nal(rbsp->data, data, size, nal);
+    }
+    ret = ff_cbs_read_unit(s->cbc, unit);
+    if (ret < 0)
+        return ret;
+    slice       = unit->content;
+    header_size = escaped_pos(nal, slice->header_size);
+
+    return slice_init_data(sc, nal, data, size, header_size);
+}
+
+static int slice_read_header(VVCContext *s, SliceContext *sc, const VVCFrameContext *fc,
+    const H2645NAL *nal, const CodedBitstreamUnit *unit)
+{
+    size_t header_size;
+    int ret;
+
+    if (!sc->rsh) {
+        sc->rsh = ff_refstruct_allocz(sizeof(*sc->rsh));
+        if (!sc->rsh)
+            return AVERROR(ENOMEM);
+    }
+
+    ret = ff_vvc_read_sh(sc->rsh, &header_size, &fc->ps, unit->data, unit->data_size);
+    if (ret >= 0 ? slice_header_escaped(nal, header_size) : ret != AVERROR(EAGAIN) && nal->skipped_bytes) {
+        // an emulation prevention byte may be in the header, read it again without them
+        av_fast_padded_malloc(&s->sh_buf, &s->sh_buf_size, unit->data_size);
+        if (!s->sh_buf)
+            return AVERROR(ENOMEM);
+        ret = unescape_nal(s->sh_buf, unit->data, unit->data_size, nal);
+        ret = ff_vvc_read_sh(sc->rsh, &header_size, &fc->ps, s->sh_buf, ret);
+        header_size = escaped_pos(nal, header_size);
+    }
+    if (ret < 0)
+        return ret;
+
+    ret = av_buffer_replace(&sc->data_ref, unit->data_ref);
+    if (ret < 0)
+        return ret;
+
+    return slice_init_data(sc, nal, unit->data, unit->data_size, header_size);
+}
+
+// whether the slice belongs to a subpicture left out of subpic_ids
+static int is_subpic_skipped(VVCContext *s, const VVCFrameContext *fc, const SliceContext *sc)
+{
+    const H266RawSPS *rsps = fc->ps.sps->r;
+    const int subpic_id    = fc->ps.pps->r->sub_pic_id_val[sc->sh.r->curr_subpic_idx];
 
-static int decode_slice(VVCContext *s, VVCFrameContext *fc, const H2645NAL *nal, const CodedBitstreamUnit *unit)
+    if (!s->nb_subpic_ids || !rsps->sps_num_subpics_minus1)
+        return 0;
+
+    for (int i = 0; i < s->nb_subpic_ids; i++) {
+        if (s->subpic_ids[i] == subpic_id)
+            return 0;
+    }
+
+    // the decoded subpictures must neither predict from nor filter across the skipped ones
+    for (int i = 0; i <= rsps->sps_num_subpics_minus1; i++) {
+        if (!rsps->sps_subpic_treated_as_pic_flag[i] || rsps->sps_loop_filter_across_subpic_enabled_flag[i]) {
+            if (!s->subpics_dependent) {
+                av_log(s->avctx, AV_LOG_WARNING, "subpic_ids: the subpictures are not independent, decoding all of them.\n");
+                s->subpics_dependent = 1;
+            }
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int decode_slice(VVCContext *s, VVCFrameContext *fc, const H2645NAL *nal, CodedBitstreamUnit *unit)
 {
     int ret;
     SliceContext *sc;
+    const H266RawSliceHeader *rsh;
     const int is_first_slice = !fc->nb_slices;
 
-    ret = slices_realloc(fc);
+    if (fc->skip_picture)
+        return 0;
+
+    ret = slices_realloc(s, fc);
     if (ret < 0)
         return ret;
 
     sc = fc->slices[fc->nb_slices];
 
     s->vcl_unit_type = nal->type;
+
+    // frame_setup() needs the picture header, so a slice header holding it is read first
+    if (unit->data_size > 2 && (unit->data[2] & 0x80)) {
+        ret = slice_read_header_cbs(s, sc, nal, unit);
+        if (ret < 0)
+            return ret;
+    }
+
     if (is_first_slice) {
         ret = frame_setup(fc, s);
         if (ret < 0)
             return ret;
     }
 
-    ret = slice_start(sc, s, fc, unit, is_first_slice);
-    if (ret < 0)
-        return ret;
+    // every slice holds at least one CTU, more slices can only repeat the same ones
+    if (fc->nb_slices >= (s->max_slices ? FFMIN(s->max_slices, fc->ps.pps->ctb_count) : fc->ps.pps->ctb_count)) {
+        av_log(fc->log_ctx, AV_LOG_ERROR, "Too many slices in the picture, more than %d.\n", fc->nb_slices);
+        return AVERROR_INVALIDDATA;
+    }
+
+    if (!unit->content) {
+        ret = slice_read_header(s, sc, fc, nal, unit);
+        if (ret == AVERROR(EAGAIN))
+            ret = slice_read_header_cbs(s, sc, nal, unit);
+        if (ret < 0)
+            return ret;
+    }
+    rsh = unit->content ? unit->content_ref : sc->rsh;
 
-    ret = slice_init_entry_points(sc, fc, nal, unit);
+    if (is_first_slice && (is_discarded(s, fc, rsh, s->avctx->skip_frame) || is_unused(s, fc))) {
+        fc->skip_picture = 1;
+        return 0;
+    }
+
+    ret = slice_start(sc, s, fc, rsh, is_first_slice);
     if (ret < 0)
         return ret;
+
+    // the hwaccel finds this slice at fc->slices[fc->nb_slices]
+    if (s->avctx->hwaccel) {
+        ret = FF_HW_CALL(s->avctx, decode_slice, nal->raw_data, nal->raw_size);
+        if (ret < 0)
+            return ret;
+    } else {
+        sc->skipped = is_subpic_skipped(s, fc, sc);
+
+        ret = slice_init_entry_points(s, sc, fc);
+        if (ret < 0)
+            return ret;
+    }
     fc->nb_slices++;
 
+    // the previous slices are final, their ctus are decoded while the next nal units are read
+    if (!s->avctx->hwaccel)
+        return ff_vvc_frame_submit_slices(s, fc);
+
     return 0;
 }
 
-static int decode_nal_unit(VVCContext *s, VVCFrameContext *fc, const H2645NAL *nal, const CodedBitstreamUnit *unit)
+static int decode_nal_unit(VVCContext *s, VVCFrameContext *fc, const H2645NAL *nal, CodedBitstreamUnit *unit)
 {
     int  ret;
 
     s->temporal_id = nal->temporal_id;
 
-    if (nal->nuh_layer_id > 0) {
-        avpriv_report_missing_feature(fc->log_ctx,
-                "Decoding of multilayer bitstreams");
-        return AVERROR_PATCHWELCOME;
-    }
+    // a sublayer is only referenced by itself and the ones above, so they are dropped together
+    if (s->temporal_id > s->max_temporal_layer && unit->type != VVC_VPS_NUT && unit->type != VVC_SPS_NUT)
+        return 0;
+
+    // only the base layer is decoded, the units of the other layers were not decomposed
+    if (nal->nuh_layer_id > 0)
+        return 0;
 
     switch (unit->type) {
     case VVC_VPS_NUT:
@@ -825,6 +1751,28 @@ static int decode_nal_unit(VVCContext *s, VVCFrameContext *fc, const H2645NAL *n
         if (ret < 0)
             return ret;
         break;
+    case VVC_PREFIX_SEI_NUT:
+        // the messages apply to the picture of the access unit, the suffix ones are not used
+        ret = ff_vvc_sei_decode(&s->sei, unit->content, fc->log_ctx);
+        if (ret < 0) {
+            av_log(fc->log_ctx, AV_LOG_WARNING, "Error decoding SEI.\n");
+            if (s->avctx->err_recognition & AV_EF_EXPLODE)
+                return ret;
+        }
+        break;
+    case VVC_SUFFIX_SEI_NUT:
+        // a hash of samples not reconstructed or not filtered would not match
+        if ((s->avctx->err_recognition & AV_EF_CRCCHECK) && fc->ref && !fc->skip_picture &&
+            !s->avctx->hwaccel && !s->parse_only && !fc->skip_loop_filter && !fc->skip_idct && !fc->gray &&
+            unit->content) {
+            const SEIRawDecodedPictureHash *dph = ff_vvc_sei_picture_hash(unit->content);
+
+            if (dph) {
+                fc->picture_hash     = *dph;
+                fc->has_picture_hash = 1;
+            }
+        }
+        break;
     }
 
     return 0;
@@ -839,8 +1787,13 @@ static int decode_nal_units(VVCContext *s, VVCFrameContext *fc, AVPacket *avpkt)
     s->last_eos = s->eos;
     s->eos = 0;
 
-    ff_cbs_fragment_reset(frame);
-    ret = ff_cbs_read_packet(s->cbc, frame, avpkt);
+    // without avpkt, the nal units were read ahead by the executor
+    if (avpkt) {
+        ff_cbs_fragment_reset(frame);
+        ret = ff_cbs_read_packet(s->cbc, frame, avpkt);
+    } else {
+        ret = ff_vvc_packet_read_wait(s);
+    }
     if (ret < 0) {
         av_log(s->avctx, AV_LOG_ERROR, "Failed to read packet.\n");
         return ret;
@@ -848,7 +1801,7 @@ static int decode_nal_units(VVCContext *s, VVCFrameContext *fc, AVPacket *avpkt)
     /* decode the NAL units */
     for (int i = 0; i < frame->nb_units; i++) {
         const H2645NAL *nal            = h266->common.read_packet.nals + i;
-        const CodedBitstreamUnit *unit = frame->units + i;
+        CodedBitstreamUnit *unit       = frame->units + i;
 
         if (unit->type == VVC_EOB_NUT || unit->type == VVC_EOS_NUT) {
             if (eos_at_start)
@@ -867,7 +1820,10 @@ static int decode_nal_units(VVCContext *s, VVCFrameContext *fc, AVPacket *avpkt)
     return 0;
 
 fail:
-    if (fc->ref)
+    // the submitted slices may still run
+    if (fc->ref && !s->avctx->hwaccel && fc->nb_slices)
+        ff_vvc_frame_wait(s, fc);
+    else if (fc->ref)
         ff_vvc_report_frame_finished(fc->ref);
     return ret;
 }
@@ -885,102 +1841,261 @@ static int set_output_format(const VVCContext *s, const AVFrame *output)
     return 0;
 }
 
-static int wait_delayed_frame(VVCContext *s, AVFrame *output, int *got_output)
+// the grain is synthesized on a copy of the output picture, the reference keeps the decoded samples
+static int apply_film_grain(VVCContext *s, AVFrame *output)
 {
-    VVCFrameContext *delayed = get_frame_context(s, s->fcs, s->nb_frames - s->nb_delayed);
-    int ret                  = ff_vvc_frame_wait(s, delayed);
+    AVCodecContext *c = s->avctx;
+    const AVFilmGrainParams *fgp;
+    AVFrame *grain;
+    int ret;
+
+    if (!av_frame_get_side_data(output, AV_FRAME_DATA_FILM_GRAIN_PARAMS) ||
+        (c->export_side_data & AV_CODEC_EXPORT_DATA_FILM_GRAIN))
+        return 0;
+
+    fgp = av_film_grain_params_select(output);
+    if (c->hwaccel || !fgp || fgp->type != AV_FILM_GRAIN_PARAMS_H274 ||
+        !ff_h274_film_grain_params_supported(fgp->codec.h274.model_id, output->format)) {
+        if (!c->hwaccel)
+            av_log_once(c, AV_LOG_WARNING, AV_LOG_DEBUG, &s->film_grain_warning_shown,
+                        "Unsupported film grain parameters. Ignoring film grain.\n");
+        av_frame_remove_side_data(output, AV_FRAME_DATA_FILM_GRAIN_PARAMS);
+        return 0;
+    }
+
+    grain = av_frame_alloc();
+    if (!grain)
+        return AVERROR(ENOMEM);
+    grain->format = output->format;
+    grain->width  = output->width;
+    grain->height = output->height;
+
+    ret = ff_get_buffer(c, grain, 0);
+    if (ret >= 0)
+        ret = ff_h274_apply_film_grain(grain, output, &s->h274db, fgp);
+    if (ret >= 0)
+        ret = av_frame_copy_props(grain, output);
+    if (ret >= 0) {
+        av_frame_remove_side_data(grain, AV_FRAME_DATA_FILM_GRAIN_PARAMS);
+        av_frame_unref(output);
+        av_frame_move_ref(output, grain);
+    }
+    av_frame_free(&grain);
+
+    return ret;
+}
+
+static int take_output(VVCContext *s, VVCFrameContext *fc, AVFrame *output)
+{
+    int ret = 0;
+
+    av_frame_move_ref(output, fc->output_frame);
+    // the picture may have been bumped before its ctus were concealed
+    if (ff_vvc_progress_concealed(fc->output_progress))
+        output->decode_error_flags |= FF_DECODE_ERROR_CONCEALMENT_ACTIVE;
+    if (fc->output_stats)
+        ret = ff_vvc_stage_stats_export(output, fc->output_stats);
+    output_unref(fc);
+    if (ret < 0)
+        return ret;
+
+    ret = apply_film_grain(s, output);
+    if (ret < 0)
+        return ret;
+
+    return set_output_format(s, output);
+}
 
-    if (!ret && delayed->output_frame->buf[0] && output) {
-        av_frame_move_ref(output, delayed->output_frame);
-        ret = set_output_format(s, output);
-        if (!ret)
-            *got_output = 1;
+// the frame bumped by the oldest frame context still holding one, if all its pixels are final
+static VVCFrameContext *get_finished_output(VVCContext *s)
+{
+    // the replay of a picture runs once its frame context is waited for, its times are exported after it
+    if (s->replay)
+        return NULL;
+    for (int i = s->nb_delayed; i > 0; i--) {
+        VVCFrameContext *fc = get_frame_context(s, s->fcs, s->nb_frames - i);
+
+        if (fc->output_frame->buf[0])
+            return ff_vvc_progress_finished(fc->output_progress) ? fc : NULL;
     }
+    return NULL;
+}
+
+// wait for the oldest frame context, all the frames it can bump are final afterwards
+static int wait_delayed_frame(VVCContext *s, VVCFrameContext **delayed)
+{
+    VVCFrameContext *fc = get_frame_context(s, s->fcs, s->nb_frames - s->nb_delayed);
+    int ret             = s->avctx->hwaccel ? 0 : ff_vvc_frame_wait(s, fc);
+
+    frame_unrank(s, fc);
     s->nb_delayed--;
+    atomic_store(&s->oldest_decode_order, s->nb_frames - s->nb_delayed);
+
+    // a later frame context took its own references to the pictures at setup, so the ones
+    // this finished context holds go now rather than when it is reused; its bumped frame
+    // is referenced by output_frame
+    if (s->nb_delayed && ret >= 0) {
+        ff_vvc_flush_dpb(fc);
+        fc->ref = NULL;
+    }
+
+    if (ret < 0 || !fc->output_frame->buf[0]) {
+        output_unref(fc);
+        fc = NULL;
+    }
+    *delayed = fc;
 
     return ret;
 }
 
-static int submit_frame(VVCContext *s, VVCFrameContext *fc, AVFrame *output, int *got_output)
+static int submit_frame(VVCContext *s, VVCFrameContext *fc)
 {
-    int ret = ff_vvc_frame_submit(s, fc);
+    int ret;
 
-    if (ret < 0) {
+    if (s->avctx->hwaccel) {
+        // the picture is final once the hwaccel has it, the frame context is not waited for
+        ret = FF_HW_SIMPLE_CALL(s->avctx, end_frame);
         ff_vvc_report_frame_finished(fc->ref);
-        return ret;
+        if (ret < 0) {
+            av_log(s->avctx, AV_LOG_ERROR,
+                   "hardware accelerator failed to decode picture\n");
+            return ret;
+        }
+    } else {
+        ret = ff_vvc_frame_submit(s, fc);
+        if (ret < 0) {
+            ff_vvc_frame_wait(s, fc);
+            frame_unrank(s, fc);
+            return ret;
+        }
     }
 
     s->nb_frames++;
     s->nb_delayed++;
 
-    if (s->nb_delayed >= s->nb_fcs) {
-        if ((ret = wait_delayed_frame(s, output, got_output)) < 0)
-            return ret;
-    }
     return 0;
 }
 
-static int get_decoded_frame(VVCContext *s, AVFrame *output, int *got_output)
+static int get_decoded_frame(VVCContext *s, AVFrame *output)
 {
-    int ret;
     while (s->nb_delayed) {
-        if ((ret = wait_delayed_frame(s, output, got_output)) < 0)
+        VVCFrameContext *delayed;
+        int ret = wait_delayed_frame(s, &delayed);
+
+        if (ret < 0)
             return ret;
-        if (*got_output)
-            return 0;
+        if (delayed)
+            return take_output(s, delayed, output);
     }
     if (s->nb_frames) {
         //we still have frames cached in dpb.
         VVCFrameContext *last = get_frame_context(s, s->fcs, s->nb_frames - 1);
+        int ret = ff_vvc_output_frame(s, last, last->output_frame, &last->output_progress, 0, 1);
 
-        ret = ff_vvc_output_frame(s, last, output, 0, 1);
         if (ret < 0)
             return ret;
-        if (ret) {
-            *got_output = ret;
-            if ((ret = set_output_format(s, output)) < 0)
-                return ret;
-        }
+        if (ret)
+            return take_output(s, last, output);
     }
-    return 0;
+    return AVERROR_EOF;
 }
 
-static int vvc_decode_frame(AVCodecContext *avctx, AVFrame *output,
-    int *got_output, AVPacket *avpkt)
+static int decode_packet(VVCContext *s, AVPacket *avpkt)
 {
-    VVCContext *s = avctx->priv_data;
-    VVCFrameContext *fc;
+    VVCFrameContext *fc = get_frame_context(s, s->fcs, s->nb_frames);
     int ret;
 
-    if (!avpkt->size)
-        return get_decoded_frame(s, output, got_output);
-
-    fc = get_frame_context(s, s->fcs, s->nb_frames);
+    if (!fc->output_frame) {
+        ret = frame_context_alloc_frames(fc);
+        if (ret < 0)
+            return ret;
+    }
 
     fc->nb_slices = 0;
+    fc->skip_picture = 0;
+    fc->has_picture_hash = 0;
     fc->decode_order = s->nb_frames;
 
     ret = decode_nal_units(s, fc, avpkt);
-    if (ret < 0)
+    if (ret < 0) {
+        frame_unrank(s, fc);
         return ret;
+    }
 
-    if (!fc->ft)
-        return avpkt->size;
+    if (!fc->nb_slices) {
+        frame_unrank(s, fc);
+        return 0;
+    }
 
-    ret = submit_frame(s, fc, output, got_output);
-    if (ret < 0)
-        return ret;
+    return submit_frame(s, fc);
+}
+
+static int vvc_receive_frame(AVCodecContext *avctx, AVFrame *output)
+{
+    VVCContext *s = avctx->priv_data;
+    AVPacket *pkt = avctx->internal->in_pkt;
+    int ret;
+
+    while (1) {
+        VVCFrameContext *fc = get_finished_output(s);
+
+        // a frame is returned as soon as it is final, earlier frame contexts may still be running
+        if (fc)
+            return take_output(s, fc, output);
+
+        if (s->nb_delayed >= s->nb_fcs) {
+            // no free frame context, the oldest one has to finish before the next packet
+            ret = wait_delayed_frame(s, &fc);
+            if (ret < 0)
+                return ret;
+            if (fc)
+                return take_output(s, fc, output);
+            continue;
+        }
+
+        if (ff_vvc_packet_read_pending(s)) {
+            ret = decode_packet(s, NULL);
+        } else {
+            ret = ff_decode_get_packet(avctx, pkt);
+            if (ret == AVERROR_EOF)
+                return get_decoded_frame(s, output);
+            if (ret < 0)
+                return ret;
 
-    return avpkt->size;
+            ret = decode_packet(s, pkt);
+            av_packet_unref(pkt);
+        }
+        if (ret < 0)
+            return ret;
+
+        // the next packet is read while the frames finished meanwhile are returned
+        if (s->read && s->executor) {
+            ret = ff_decode_get_packet(avctx, pkt);
+            if (!ret)
+                ff_vvc_packet_read_start(s, pkt);
+            else if (ret != AVERROR(EAGAIN) && ret != AVERROR_EOF)
+                return ret;
+        }
+    }
 }
 
 static av_cold void vvc_decode_flush(AVCodecContext *avctx)
 {
-    VVCContext *s  = avctx->priv_data;
-    int got_output = 0;
+    VVCContext *s = avctx->priv_data;
+
+    // drop the packet read ahead
+    if (ff_vvc_packet_read_pending(s)) {
+        ff_vvc_packet_read_wait(s);
+        ff_cbs_fragment_reset(&s->current_frame);
+    }
 
-    while (s->nb_delayed)
-        wait_delayed_frame(s, NULL, &got_output);
+    while (s->nb_delayed) {
+        VVCFrameContext *delayed;
+
+        wait_delayed_frame(s, &delayed);
+        if (delayed)
+            output_unref(delayed);
+    }
 
     if (s->fcs) {
         VVCFrameContext *last = get_frame_context(s, s->fcs, s->nb_frames - 1);
@@ -988,23 +2103,37 @@ static av_cold void vvc_decode_flush(AVCodecContext *avctx)
     }
 
     s->ps.sps_id_used = 0;
+    ff_vvc_sei_reset(&s->sei);
 
     s->eos = 1;
+
+    if (FF_HW_HAS_CB(avctx, flush))
+        FF_HW_SIMPLE_CALL(avctx, flush);
 }
 
 static av_cold int vvc_decode_free(AVCodecContext *avctx)
 {
     VVCContext *s = avctx->priv_data;
 
-    ff_cbs_fragment_free(&s->current_frame);
     vvc_decode_flush(avctx);
+    ff_vvc_packet_read_free(s);
+    ff_cbs_fragment_free(&s->current_frame);
+    av_freep(&s->sh_buf);
+    av_buffer_pool_uninit(&s->dpb_pool);
+    ff_vvc_trace_uninit(s);
+    ff_vvc_executor_stats_log(s);
     ff_vvc_executor_free(&s->executor);
+    av_freep(&s->wait_lc);
     if (s->fcs) {
-        for (int i = 0; i < s->nb_fcs; i++)
+        for (int i = 0; i < s->nb_fcs_allocated; i++)
             frame_context_free(s->fcs + i);
         av_free(s->fcs);
     }
+    ff_vvc_stage_stats_uninit(s);
+    av_freep(&s->replay_lc);
+    av_frame_free(&s->replay_frame);
     ff_vvc_ps_uninit(&s->ps);
+    ff_vvc_sei_reset(&s->sei);
     ff_cbs_close(&s->cbc);
 
     return 0;
@@ -1016,45 +2145,123 @@ static av_cold void init_default_scale_m(void)
 }
 
 #define VVC_MAX_DELAYED_FRAMES 16
+#define VVC_MAX_FRAME_DELAY    64
+
+static int frame_delay(const VVCContext *s, const int cpu_count)
+{
+    if ((s->avctx->flags & AV_CODEC_FLAG_LOW_DELAY) || s->deterministic)
+        return 1;
+    if (s->max_frame_delay)
+        return s->max_frame_delay;
+    // frames waiting for reference progress leave threads idle, so keep more of them in flight
+    if (s->throughput)
+        return FFMIN(2 * cpu_count, VVC_MAX_FRAME_DELAY);
+    return FFMIN(cpu_count, VVC_MAX_DELAYED_FRAMES);
+}
+
+// the units decode_nal_unit() reads the content of, the suffix sei is only used for the picture hash
+static const CodedBitstreamUnitType decompose_unit_types[] = {
+    VVC_VPS_NUT,
+    VVC_SPS_NUT,
+    VVC_PPS_NUT,
+    VVC_PREFIX_APS_NUT,
+    VVC_SUFFIX_APS_NUT,
+    VVC_PH_NUT,
+    VVC_PREFIX_SEI_NUT,
+    VVC_SUFFIX_SEI_NUT,
+};
+
 static av_cold int vvc_decode_init(AVCodecContext *avctx)
 {
     VVCContext *s                  = avctx->priv_data;
     static AVOnce init_static_once = AV_ONCE_INIT;
+    CodedBitstreamH266Context *h266;
     const int cpu_count            = av_cpu_count();
     const int delayed              = FFMIN(cpu_count, VVC_MAX_DELAYED_FRAMES);
     int thread_count               = avctx->thread_count ? avctx->thread_count : delayed;
     int ret;
 
     s->avctx = avctx;
+    avctx->internal->huge_pages = s->huge_pages;
+
+    s->cpu_flags = av_get_cpu_flags();
+    if (s->cpuflags) {
+        unsigned flags = s->cpu_flags;
+
+        ret = av_parse_cpu_caps(&flags, s->cpuflags);
+        if (ret < 0) {
+            av_log(avctx, AV_LOG_ERROR, "Invalid cpuflags: %s\n", s->cpuflags);
+            return ret;
+        }
+        // only the instruction sets of the cpu can be used
+        s->cpu_flags &= flags;
+    }
 
     ret = ff_cbs_init(&s->cbc, AV_CODEC_ID_VVC, avctx);
     if (ret)
         return ret;
 
+    // the slices are read by decode_slice(), keeping their emulation prevention bytes;
+    // the units of the enhancement layers are only split
+    s->cbc->decompose_unit_types    = decompose_unit_types;
+    s->cbc->nb_decompose_unit_types = FF_ARRAY_ELEMS(decompose_unit_types) -
+                                      !(avctx->err_recognition & AV_EF_CRCCHECK);
+    h266 = s->cbc->priv_data;
+    h266->common.read_packet.keep_vcl_escapes = 1;
+    h266->skip_layers = ~UINT64_C(1);
+
     if (avctx->extradata_size > 0 && avctx->extradata) {
         ret = ff_cbs_read_extradata_from_codec(s->cbc, &s->current_frame, avctx);
         if (ret < 0)
             return ret;
     }
 
-    s->nb_fcs = (avctx->flags & AV_CODEC_FLAG_LOW_DELAY) ? 1 : delayed;
+    s->nb_fcs = frame_delay(s, cpu_count);
     s->fcs = av_calloc(s->nb_fcs, sizeof(*s->fcs));
     if (!s->fcs)
         return AVERROR(ENOMEM);
+    s->nb_fcs_allocated = s->nb_fcs;
+
+    for (int i = 0; i < s->nb_fcs; i++)
+        frame_context_init(s->fcs + i, avctx);
+
+    if (s->deterministic) {
+        if (s->shared_threads)
+            av_log(avctx, AV_LOG_WARNING, "shared_threads is ignored with deterministic\n");
+        s->shared_threads = 0;
+        thread_count      = 0;
+    }
+    if (thread_count == 1)
+        thread_count = 0;
+    s->thread_count = thread_count;
+    if (thread_count || s->shared_threads) {
+        s->wait_lc = av_mallocz(sizeof(*s->wait_lc));
+        if (!s->wait_lc)
+            return AVERROR(ENOMEM);
+        s->wait_lc->waiter = 1;
 
-    for (int i = 0; i < s->nb_fcs; i++) {
-        VVCFrameContext *fc = s->fcs + i;
-        ret = frame_context_init(fc, avctx);
+        ret = ff_vvc_packet_read_init(s);
         if (ret < 0)
             return ret;
     }
 
-    if (thread_count == 1)
-        thread_count = 0;
-    s->executor = ff_vvc_executor_alloc(s, thread_count);
-    if (!s->executor)
-        return AVERROR(ENOMEM);
+    ret = ff_vvc_trace_init(s, s->shared_threads ? cpu_count : thread_count);
+    if (ret < 0)
+        return ret;
+
+    if (s->replay) {
+        s->stage_stats  = 1;
+        s->replay_lc    = av_mallocz(sizeof(*s->replay_lc));
+        s->replay_frame = av_frame_alloc();
+        if (!s->replay_lc || !s->replay_frame)
+            return AVERROR(ENOMEM);
+    }
+
+    ret = ff_vvc_stage_stats_init(s);
+    if (ret < 0)
+        return ret;
 
+    s->pix_fmt = AV_PIX_FMT_NONE;
     s->eos = 1;
     GDR_SET_RECOVERED(s);
     ff_thread_once(&init_static_once, init_default_scale_m);
@@ -1062,18 +2269,106 @@ static av_cold int vvc_decode_init(AVCodecContext *avctx)
     return 0;
 }
 
+#define OFFSET(x) offsetof(VVCContext, x)
+#define PAR (AV_OPT_FLAG_DECODING_PARAM | AV_OPT_FLAG_VIDEO_PARAM)
+#define EXP (AV_OPT_FLAG_DECODING_PARAM | AV_OPT_FLAG_VIDEO_PARAM | AV_OPT_FLAG_EXPORT | AV_OPT_FLAG_READONLY)
+
+static const AVOption options[] = {
+    { "thread_affinity", "Pin threads to cpus and keep each frame on one NUMA node", OFFSET(thread_affinity),
+        AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, PAR },
+    { "shared_threads", "Share one thread pool between all decoders of the process", OFFSET(shared_threads),
+        AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, PAR },
+    { "deterministic", "Run the tasks on the calling thread in a fixed order, for reproducible timings", OFFSET(deterministic),
+        AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, PAR },
+    { "priority", "Order of the frames in flight for the tasks", OFFSET(priority),
+        AV_OPT_TYPE_INT, {.i64 = VVC_PRIORITY_DECODE}, VVC_PRIORITY_DECODE, VVC_PRIORITY_DEADLINE, PAR, .unit = "priority" },
+        { "decode",   "First decoded first",                               0, AV_OPT_TYPE_CONST, {.i64 = VVC_PRIORITY_DECODE},   0, 0, PAR, .unit = "priority" },
+        { "output",   "First output first",                                0, AV_OPT_TYPE_CONST, {.i64 = VVC_PRIORITY_OUTPUT},   0, 0, PAR, .unit = "priority" },
+        { "deadline", "Lowest pts first, in output order without a pts",   0, AV_OPT_TYPE_CONST, {.i64 = VVC_PRIORITY_DEADLINE}, 0, 0, PAR, .unit = "priority" },
+    { "max_frame_delay", "Number of frames decoded in parallel (0 = auto)", OFFSET(max_frame_delay),
+        AV_OPT_TYPE_INT, {.i64 = 0}, 0, VVC_MAX_FRAME_DELAY, PAR },
+    { "throughput", "Keep as many frames in flight as reference progress allows", OFFSET(throughput),
+        AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, PAR },
+    { "filter_batch", "Number of adjacent CTUs in a row each loop filter task processes", OFFSET(filter_batch),
+        AV_OPT_TYPE_INT, {.i64 = 1}, 1, 64, PAR },
+    { "coeff_rows", "CTU rows of coefficients kept between parse and reconstruction (0 = whole frame)", OFFSET(coeff_rows),
+        AV_OPT_TYPE_INT, {.i64 = 4}, 0, INT_MAX, PAR },
+    { "max_memory", "Memory budget in bytes, met by bounding coefficients and frame delay (0 = unlimited)", OFFSET(max_memory),
+        AV_OPT_TYPE_INT64, {.i64 = 0}, 0, INT64_MAX, PAR },
+    { "huge_pages", "Back the large per picture tables and the picture pool with huge pages", OFFSET(huge_pages),
+        AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, PAR },
+    { "memory_tables", "Bytes used by the per picture tables", OFFSET(memory_tables),
+        AV_OPT_TYPE_INT64, {.i64 = 0}, 0, INT64_MAX, EXP },
+    { "memory_coeffs", "Bytes used by the coefficient buffers", OFFSET(memory_coeffs),
+        AV_OPT_TYPE_INT64, {.i64 = 0}, 0, INT64_MAX, EXP },
+    { "memory_dpb", "Bytes used by the pictures of the DPB", OFFSET(memory_dpb),
+        AV_OPT_TYPE_INT64, {.i64 = 0}, 0, INT64_MAX, EXP },
+    { "memory_threads", "Bytes used by the thread local contexts", OFFSET(memory_threads),
+        AV_OPT_TYPE_INT64, {.i64 = 0}, 0, INT64_MAX, EXP },
+    { "memory_total", "Bytes used by the decoder", OFFSET(memory_total),
+        AV_OPT_TYPE_INT64, {.i64 = 0}, 0, INT64_MAX, EXP },
+    { "trace_file", "Write a Chrome trace of the decoding tasks to this file", OFFSET(trace_file),
+        AV_OPT_TYPE_STRING, {.str = NULL}, 0, 0, PAR },
+    { "trace_size", "Number of trace events kept per thread", OFFSET(trace_size),
+        AV_OPT_TYPE_INT, {.i64 = 1 << 16}, 1, 1 << 24, PAR },
+    { "stage_stats", "Time the stages of the task pipeline, export them as frame metadata and log a summary at close", OFFSET(stage_stats),
+        AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, PAR },
+    { "replay", "Run the stages after the parse again this many times on each frame and time them, implies stage_stats", OFFSET(replay),
+        AV_OPT_TYPE_INT, {.i64 = 0}, 0, INT_MAX, PAR },
+    { "replay_stages", "Stages timed by replay", OFFSET(replay_stages),
+        AV_OPT_TYPE_FLAGS, {.i64 = VVC_REPLAY_ALL}, 0, VVC_REPLAY_ALL, PAR, .unit = "replay_stages" },
+        { "inter",   "Inter prediction",                          0, AV_OPT_TYPE_CONST, {.i64 = VVC_REPLAY_INTER},   0, 0, PAR, .unit = "replay_stages" },
+        { "recon",   "Intra prediction and residuals",            0, AV_OPT_TYPE_CONST, {.i64 = VVC_REPLAY_RECON},   0, 0, PAR, .unit = "replay_stages" },
+        { "lmcs",    "Inverse luma mapping",                      0, AV_OPT_TYPE_CONST, {.i64 = VVC_REPLAY_LMCS},    0, 0, PAR, .unit = "replay_stages" },
+        { "deblock", "Deblocking, both directions",               0, AV_OPT_TYPE_CONST, {.i64 = VVC_REPLAY_DEBLOCK}, 0, 0, PAR, .unit = "replay_stages" },
+        { "sao",     "Sample adaptive offset",                    0, AV_OPT_TYPE_CONST, {.i64 = VVC_REPLAY_SAO},     0, 0, PAR, .unit = "replay_stages" },
+        { "alf",     "Adaptive loop filter",                      0, AV_OPT_TYPE_CONST, {.i64 = VVC_REPLAY_ALF},     0, 0, PAR, .unit = "replay_stages" },
+    { "parse_only", "Only parse the slices and export per CTU syntax statistics as side data", OFFSET(parse_only),
+        AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, PAR },
+    { "ctu_stats", "Export per CTU syntax statistics and timings as side data", OFFSET(ctu_stats),
+        AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, PAR },
+    { "pad_refs", "Allocate the pictures with guard bands, so motion compensation next to the edges reads them in place", OFFSET(pad_refs),
+        AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, PAR },
+    { "rpr_cache", "Predict from rescaled copies of the references when their resolution differs", OFFSET(rpr_cache),
+        AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, PAR },
+    { "max_temporal_layer", "Highest temporal sublayer decoded, the pictures of higher ones are dropped", OFFSET(max_temporal_layer),
+        AV_OPT_TYPE_INT, {.i64 = VVC_MAX_SUBLAYERS - 1}, 0, VVC_MAX_SUBLAYERS - 1, PAR },
+    { "semi_planar", "Output the frames with interleaved chroma, as NV12, P010 and their 4:2:2 and 4:4:4 variants", OFFSET(semi_planar),
+        AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, PAR },
+    { "max_slices", "Maximum number of slices per picture (0 = one per CTU)", OFFSET(max_slices),
+        AV_OPT_TYPE_INT, {.i64 = 0}, 0, INT_MAX, PAR },
+    { "cpuflags", "CPU flags of the DSP functions, as for the cpuflags option of ffmpeg, limited to the ones of the CPU", OFFSET(cpuflags),
+        AV_OPT_TYPE_STRING, {.str = NULL}, 0, 0, PAR },
+    { "dsp_report", "Log the instruction set of the DSP functions selected for each bit depth", OFFSET(dsp_report),
+        AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, PAR },
+    { "subpic_ids", "Subpicture IDs to decode, the others are left untouched (empty = all)", OFFSET(subpic_ids),
+        AV_OPT_TYPE_UINT | AV_OPT_TYPE_FLAG_ARRAY, {.arr = NULL}, 0, UINT16_MAX, PAR },
+    { "conceal", "Conceal the CTUs that fail to decode and keep decoding the rest of the frame", OFFSET(conceal),
+        AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, PAR },
+    { NULL },
+};
+
+static const AVClass vvc_decoder_class = {
+    .class_name = "VVC decoder",
+    .item_name  = av_default_item_name,
+    .option     = options,
+    .version    = LIBAVUTIL_VERSION_INT,
+};
+
 const FFCodec ff_vvc_decoder = {
     .p.name         = "vvc",
     .p.long_name    = NULL_IF_CONFIG_SMALL("VVC (Versatile Video Coding)"),
     .p.type         = AVMEDIA_TYPE_VIDEO,
     .p.id           = AV_CODEC_ID_VVC,
     .priv_data_size = sizeof(VVCContext),
+    .p.priv_class   = &vvc_decoder_class,
     .init           = vvc_decode_init,
     .close          = vvc_decode_free,
-    FF_CODEC_DECODE_CB(vvc_decode_frame),
+    FF_CODEC_RECEIVE_FRAME_CB(vvc_receive_frame),
     .flush          = vvc_decode_flush,
+    .p.max_lowres   = 2,
     .p.capabilities = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_DELAY | AV_CODEC_CAP_OTHER_THREADS |
-                      AV_CODEC_CAP_EXPERIMENTAL,
+                      AV_CODEC_CAP_DRAW_HORIZ_BAND | AV_CODEC_CAP_EXPERIMENTAL,
     .caps_internal  = FF_CODEC_CAP_EXPORTS_CROPPING | FF_CODEC_CAP_INIT_CLEANUP |
                       FF_CODEC_CAP_AUTO_THREADS,
     .p.profiles     = NULL_IF_CONFIG_SMALL(ff_vvc_profiles),
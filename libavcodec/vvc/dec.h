@@ -24,11 +24,15 @@
 #ifndef AVCODEC_VVC_DEC_H
 #define AVCODEC_VVC_DEC_H
 
+#include <stdatomic.h>
+
+#include "libavcodec/h274.h"
 #include "libavcodec/videodsp.h"
 #include "libavcodec/vvc.h"
 
 #include "ps.h"
 #include "dsp.h"
+#include "sei.h"
 
 #define LUMA                    0
 #define CHROMA                  1
@@ -38,6 +42,7 @@
 
 #define MIN_TU_LOG2             2                       ///< MinTbLog2SizeY
 #define MIN_PU_LOG2             2
+#define COL_MV_LOG2             3                       ///< the collocated motion is read for 8x8 blocks, 8.5.2.11
 
 #define L0                      0
 #define L1                      1
@@ -70,10 +75,14 @@ typedef struct VVCWindow {
 
 typedef struct VVCFrame {
     struct AVFrame *frame;
+    struct AVFrame *output;                     ///< semi planar or downscaled copy of frame returned instead of it,
+                                                ///< see ff_vvc_output_ctu()
+    int lowres;                                 ///< log2 of the downscaling of output, see AVCodecContext.lowres
 
     const VVCSPS *sps;                          ///< RefStruct reference
     const VVCPPS *pps;                          ///< RefStruct reference
     struct MvField *tab_dmvr_mvf;               ///< RefStruct reference
+    struct ColMvField *tab_col_mvf;             ///< RefStruct reference, the motion as collocated picture, NULL without TMVP
     RefPicListTab **rpl_tab;                    ///< RefStruct reference
     RefPicListTab  *rpl;                        ///< RefStruct reference
     int nb_rpl_elems;
@@ -88,9 +97,17 @@ typedef struct VVCFrame {
     int ref_width;                              ///< CurrPicScalWinWidthL
     int ref_height;                             ///< CurrPicScalWinHeightL
 
+    int padding;                                ///< luma samples allocated around the picture, see ff_vvc_pad_frame()
+    int padding_wrap;                           ///< the wraparound offset in luma samples the left and right guard bands
+                                                ///< are filled with, 0 if they repeat the edge samples
+
     struct VVCFrame *collocated_ref;
 
     struct FrameProgress *progress;             ///< RefStruct reference
+    struct VVCRPRCache *rpr_cache;              ///< RefStruct reference, the picture rescaled for RPR, see inter.c
+
+    void *hwaccel_picture_private;              ///< RefStruct reference
+    struct VVCStageStats *stage_stats;          ///< RefStruct reference, the task timing of the picture, see thread.c
 
     /**
      * A sequence counter, so that old frames are output first
@@ -109,7 +126,16 @@ typedef struct SliceContext {
     struct EntryPoint *eps;
     int nb_eps;
     RefPicList *rpl;
-    void *ref;                      ///< RefStruct reference, backing slice data
+    H266RawSliceHeader *rsh;        ///< RefStruct reference, the slice header read without CBS
+    int skipped;                    ///< of a subpicture that is not selected, its ctus are not decoded
+
+    const uint8_t *data;            ///< slice data, still holding the emulation prevention bytes
+    int data_size;
+    AVBufferRef *data_ref;          ///< backing data above
+
+    int *epb;                       ///< positions of the emulation prevention bytes left in the slice data
+    int nb_epb;
+    unsigned int epb_size;
 } SliceContext;
 
 typedef struct VVCFrameContext {
@@ -120,6 +146,8 @@ typedef struct VVCFrameContext {
 
     struct AVFrame *frame;
     struct AVFrame *output_frame;
+    struct FrameProgress *output_progress;  ///< RefStruct reference, the progress of output_frame
+    struct VVCStageStats *output_stats;     ///< RefStruct reference, the stage stats of output_frame
 
     VVCFrameParamSets ps;
 
@@ -127,8 +155,14 @@ typedef struct VVCFrameContext {
     int nb_slices;
     int nb_slices_allocated;
 
+    struct EntryPoint *eps;         ///< the entry points of all the slices, SliceContext.eps points into it
+    int nb_eps_allocated;
+
     VVCFrame *ref;
 
+    SEIRawDecodedPictureHash picture_hash;
+    int has_picture_hash;           ///< picture_hash is checked once the pixels of ref are final
+
     VVCDSPContext vvcdsp;
     VideoDSPContext vdsp;
 
@@ -136,11 +170,32 @@ typedef struct VVCFrameContext {
 
     uint64_t decode_order;
 
+    /* with the output and deadline priorities, when the frame is needed among the frames in flight */
+    int64_t deadline;               ///< pts of the picture
+    int poc;
+    uint16_t sequence;              ///< VVCContext.seq_decode of the picture
+    int ranked;                     ///< counted in the ranks of the other frames in flight
+    atomic_int rank;                ///< frames in flight needed before this one
+
+    int skip_picture;               ///< the slices of the picture are dropped, see AVCodecContext.skip_frame
+    int skip_loop_filter;           ///< the deblocking, SAO and ALF stages do not run
+    int skip_idct;                  ///< the residuals are not added to the predictions
+    int gray;                       ///< only the luma samples are reconstructed and filtered, see AV_CODEC_FLAG_GRAY
+
+    /* the pools only grow, they are kept across resolution changes */
     struct FFRefStructPool *tab_dmvr_mvf_pool;
+    struct FFRefStructPool *tab_col_mvf_pool;
     struct FFRefStructPool *rpl_tab_pool;
+    struct FFRefStructPool *rpl_pool;
+    size_t tab_dmvr_mvf_pool_size;
+    size_t tab_col_mvf_pool_size;
+    size_t rpl_tab_pool_size;
+    size_t rpl_pool_size;
 
-    struct FFRefStructPool *cu_pool;
-    struct FFRefStructPool *tu_pool;
+    int coeff_rows;                                     ///< ctu rows of coefficients kept, 0 for all
+    int huge_pages;                                     ///< back the large tables with huge pages
+
+    struct AVVideoCodingStats *ctu_stats;               ///< side data of frame with parse_only or ctu_stats
 
     struct {
         int16_t *slice_idx;
@@ -169,6 +224,7 @@ typedef struct VVCFrameContext {
         uint8_t *mmi;                                   ///< MotionModelIdc[][]
         struct Mv      *cp_mv[2];                       ///< CpMvLX[][][][MAX_CONTROL_POINTS];
         struct MvField *mvf;                            ///< MvDmvrL0, MvDmvrL1
+        uint8_t *pf;                                    ///< PredFlag of mvf, a dense plane for neighbour and deblocking checks
 
         uint8_t *tu_coded_flag[VVC_MAX_SAMPLE_ARRAYS];  ///< tu_y_coded_flag[][],  tu_cb_coded_flag[][],  tu_cr_coded_flag[][]
         uint8_t *tu_joint_cbcr_residual_flag;           ///< tu_joint_cbcr_residual_flag[][]
@@ -188,6 +244,7 @@ typedef struct VVCFrameContext {
         uint8_t *alf_pixel_buffer_v[VVC_MAX_SAMPLE_ARRAYS][2];
 
         int         *coeffs;
+        int16_t     *coeffs16;                          ///< used instead of coeffs if the levels fit
         struct CTU  *ctus;
 
         uint8_t *ibc_vir_buf[VVC_MAX_SAMPLE_ARRAYS];    ///< IbcVirBuf[]
@@ -208,17 +265,51 @@ typedef struct VVCFrameContext {
             int bs_width;
             int bs_height;
             int ibc_buffer_width;       ///< IbcBufWidth
+            int coeff_slots;            ///< ctus the coeffs table has room for
+            int coeffs16;               ///< levels are stored in coeffs16
+            int has_sao;                ///< the sao border buffers are allocated
+            int has_alf;                ///< the alf border buffers are allocated
+            int has_ibc;                ///< the ibc virtual buffer is allocated
+            int intra_only;             ///< the affine and subblock tables are not allocated
+            size_t tables_bytes;        ///< allocated for the tables, without the coefficients
+            size_t coeffs_bytes;        ///< allocated for the coefficients
         } sz;
     } tab;
 } VVCFrameContext;
 
+// the frames in flight whose tasks go first
+enum VVCPriority {
+    VVC_PRIORITY_DECODE,            ///< the first decoded
+    VVC_PRIORITY_OUTPUT,            ///< the first output, by picture order count
+    VVC_PRIORITY_DEADLINE,          ///< the lowest pts, by output order without one
+};
+
+// the stages timed by the replay option
+enum VVCReplayStage {
+    VVC_REPLAY_INTER   = 1 << 0,
+    VVC_REPLAY_RECON   = 1 << 1,    ///< with the chroma of dual tree intra frames
+    VVC_REPLAY_LMCS    = 1 << 2,
+    VVC_REPLAY_DEBLOCK = 1 << 3,    ///< both directions
+    VVC_REPLAY_SAO     = 1 << 4,
+    VVC_REPLAY_ALF     = 1 << 5,
+    VVC_REPLAY_ALL     = (1 << 6) - 1,
+};
+
 typedef struct VVCContext {
+    const struct AVClass *c;  // needed by private avoptions
     struct AVCodecContext *avctx;
 
     CodedBitstreamContext *cbc;
     CodedBitstreamFragment current_frame;
 
+    uint8_t *sh_buf;                ///< a slice header without its emulation prevention bytes
+    unsigned int sh_buf_size;
+
     VVCParamSets ps;
+    VVCSEI sei;
+
+    H274FilmGrainDatabase h274db;
+    int film_grain_warning_shown;
 
     int temporal_id;        ///< temporal_id_plus1 - 1
     int poc_tid0;
@@ -237,13 +328,88 @@ typedef struct VVCContext {
     uint16_t seq_decode;
     uint16_t seq_output;
 
-    struct AVExecutor *executor;
+    enum AVPixelFormat pix_fmt; ///< negotiated by get_format(), AV_PIX_FMT_NONE before the first picture
+    int max_width;              ///< sps_pic_width_max_in_luma_samples pix_fmt was negotiated for
+    int max_height;             ///< sps_pic_height_max_in_luma_samples pix_fmt was negotiated for
+
+    struct AVExecutor *executor;    ///< allocated with the first picture
+    int thread_count;               ///< worker threads asked for, the executor may have fewer
 
     VVCFrameContext *fcs;
     int nb_fcs;
+    int nb_fcs_allocated;   ///< nb_fcs can be lowered by max_memory
+    int nb_local_contexts;  ///< of the executor
+    struct VVCLocalContext *wait_lc;    ///< runs tasks in ff_vvc_frame_wait(), NULL without worker threads
+    struct VVCPacketRead *read;         ///< reads the next packet while the caller returns frames, NULL without worker threads
 
     uint64_t nb_frames;     ///< processed frames
     int nb_delayed;         ///< delayed frames
+
+    atomic_uint oldest_decode_order;    ///< low bits of the oldest frame in flight, for task priority
+
+    int max_frame_delay;    ///< AVOption, frames in flight, 0 for auto
+    int throughput;         ///< AVOption, favour frames per second over latency
+    int thread_affinity;    ///< AVOption, pin threads and keep frames on one NUMA node
+    int shared_threads;     ///< AVOption, use the process wide executor
+    int deterministic;      ///< AVOption, one frame at a time on the caller's thread, ctu rows in raster order
+    int priority;           ///< AVOption, VVCPriority, the order of the frames in flight for the tasks
+    int filter_batch;       ///< AVOption, ctus per loop filter task
+    int coeff_rows;         ///< AVOption, ctu rows of coefficients kept between parse and reconstruction
+    int64_t max_memory;     ///< AVOption, memory budget in bytes, 0 for unlimited
+    int over_budget;        ///< max_memory could not be met, warned once
+    int huge_pages;         ///< AVOption, back the large tables and picture pools with huge pages
+
+    /* exported AVOptions, updated when a frame starts */
+    int64_t memory_tables;  ///< per picture tables of all frame contexts
+    int64_t memory_coeffs;  ///< coefficient slots of all frame contexts
+    int64_t memory_dpb;     ///< pictures and side data of the current dpb
+    int64_t memory_threads; ///< executor local contexts
+    int64_t memory_total;
+
+    char *trace_file;       ///< AVOption, write a Chrome trace of the task pipeline here
+    int trace_size;         ///< AVOption, events kept per thread
+    struct VVCTrace *trace;
+
+    int stage_stats;        ///< AVOption, time the stages of the task pipeline
+    struct VVCStageStats *stage_totals;
+
+    int replay;             ///< AVOption, times the stages after the parse run again on each frame
+    int replay_stages;      ///< AVOption, VVCReplayStage flags, the stages timed by the replay
+    struct VVCLocalContext *replay_lc;
+    AVFrame *replay_frame;  ///< the scratch picture the replay writes
+
+    int parse_only;         ///< AVOption, only run the parse stage and export per ctu syntax statistics
+    int ctu_stats;          ///< AVOption, export per ctu syntax statistics and timings when decoding
+    int pad_refs;           ///< AVOption, allocate the pictures with guard bands read by motion compensation
+    int rpr_cache;          ///< AVOption, keep rescaled copies of the references predicted with RPR
+    int max_temporal_layer; ///< AVOption, the nal units of higher temporal sublayers are dropped
+    char *cpuflags;         ///< AVOption, av_parse_cpu_caps() string applied to the cpu flags of the dsp
+    int cpu_flags;          ///< the flags ff_vvc_dsp_init_cpu() is called with
+    int dsp_report;         ///< AVOption, log the kernels selected for each bit depth
+    int dsp_reported_bit_depth;
+    int max_slices;         ///< AVOption, the pictures with more slices are rejected, 0 = one per CTU
+    unsigned *subpic_ids;   ///< AVOption, the subpictures decoded, all if empty
+    unsigned nb_subpic_ids;
+    int subpics_dependent;  ///< subpic_ids could not be honoured, warned once
+    int semi_planar;        ///< AVOption, output NV12, P010 and the like, the dpb itself stays planar
+    int lowres;             ///< AVCodecContext.lowres in effect, 0 with a hwaccel or parse_only
+    int conceal;            ///< AVOption, conceal the ctus that fail to decode rather than failing the frame
+
+    struct AVBufferPool *dpb_pool;  ///< planar pictures of the dpb when they are not output
+    size_t dpb_pool_size;
 }  VVCContext ;
 
+/**
+ * Zero the area of a ctu in the per picture tables that are not cleared in
+ * frame_start(). Called by the parse task of the ctu, before it writes them.
+ */
+void ff_vvc_ctu_tabs_reset(VVCFrameContext *fc, int rx, int ry);
+
+/**
+ * Attach the motion vectors and the QPs of a finished picture to its frame,
+ * as requested by AVCodecContext.export_side_data. Called once all its ctus
+ * are reconstructed, before it can be output.
+ */
+int ff_vvc_export_side_data(VVCContext *s, VVCFrameContext *fc);
+
 #endif /* AVCODEC_VVC_DEC_H */
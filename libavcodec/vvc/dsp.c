@@ -20,6 +20,9 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include "libavutil/bprint.h"
+#include "libavutil/cpu.h"
+
 #include "dsp.h"
 #include "ctu.h"
 #include "itx_1d.h"
@@ -64,6 +67,16 @@ static int vvc_sad(const int16_t *src0, const int16_t *src1, int dx, int dy,
     return sad;
 }
 
+static void vvc_sad_5x5(int *sad, const int16_t *src0, const int16_t *src1,
+    const int block_w, const int block_h)
+{
+    for (int dy = 0; dy < 5; dy++) {
+        for (int dx = 0; dx < 5; dx++)
+            sad[dx] = vvc_sad(src0, src1, dx, dy, block_w, block_h);
+        sad += 5;
+    }
+}
+
 typedef struct IntraEdgeParams {
     uint8_t* top;
     uint8_t* left;
@@ -75,6 +88,49 @@ typedef struct IntraEdgeParams {
     uint16_t filtered_top_array[6 * MAX_TB_SIZE + 5];
 } IntraEdgeParams;
 
+static void itx_2d(int *coeffs, const int log2_w, const int log2_h, const enum TxType trh, const enum TxType trv,
+    const size_t nzw, const size_t nzh, const int shift, const int log2_transform_range)
+{
+    static const vvc_itx_1d_fn itx[N_TX_TYPE][N_TX_SIZE] = {
+        [DCT2] = { ff_vvc_inv_dct2_2, ff_vvc_inv_dct2_4, ff_vvc_inv_dct2_8,
+                   ff_vvc_inv_dct2_16, ff_vvc_inv_dct2_32, ff_vvc_inv_dct2_64 },
+        [DST7] = { NULL, ff_vvc_inv_dst7_4, ff_vvc_inv_dst7_8, ff_vvc_inv_dst7_16, ff_vvc_inv_dst7_32 },
+        [DCT8] = { NULL, ff_vvc_inv_dct8_4, ff_vvc_inv_dct8_8, ff_vvc_inv_dct8_16, ff_vvc_inv_dct8_32 },
+    };
+    const int w   = 1 << log2_w;
+    const int h   = 1 << log2_h;
+    const int add = 1 << (shift - 1);
+
+    for (int x = 0; x < nzw; x++)
+        itx[trv][log2_h - 1](coeffs + x, w, nzh);
+
+    for (int y = 0; y < h; y++) {
+        int *p = coeffs + y * w;
+        for (int x = 0; x < nzw; x++)
+            p[x] = av_clip_intp2((p[x] + 64) >> 7, log2_transform_range);
+        memset(p + nzw, 0, sizeof(*p) * (w - nzw));
+    }
+
+    for (int y = 0; y < h; y++)
+        itx[trh][log2_w - 1](coeffs + y * w, 1, nzw);
+
+    for (int i = 0; i < w * h; i++)
+        coeffs[i] = (coeffs[i] + add) >> shift;
+}
+
+static void dequant_flat(int *coeffs, const ptrdiff_t stride, const int width, const int height,
+    const int64_t scale, const int shift, const int log2_transform_range)
+{
+    const int64_t add = (1 << shift) >> 1;
+
+    // a zero level scales to zero, so there is no need to test for it
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++)
+            coeffs[x] = av_clip_intp2((coeffs[x] * scale + add) >> shift, log2_transform_range);
+        coeffs += stride;
+    }
+}
+
 #define PROF_BORDER_EXT         1
 #define PROF_BLOCK_SIZE         (AFFINE_MIN_BLOCK_SIZE + PROF_BORDER_EXT * 2)
 #define BDOF_BORDER_EXT         1
@@ -95,7 +151,7 @@ typedef struct IntraEdgeParams {
 #include "dsp_template.c"
 #undef BIT_DEPTH
 
-void ff_vvc_dsp_init(VVCDSPContext *vvcdsp, int bit_depth)
+void ff_vvc_dsp_init_cpu(VVCDSPContext *vvcdsp, int bit_depth, int cpu_flags)
 {
 #undef FUNC
 #define FUNC(a, depth) a ## _ ## depth
@@ -121,7 +177,121 @@ void ff_vvc_dsp_init(VVCDSPContext *vvcdsp, int bit_depth)
         break;
     }
 
-#if ARCH_X86
-    ff_vvc_dsp_init_x86(vvcdsp, bit_depth);
+#if ARCH_AARCH64
+    ff_vvc_dsp_init_aarch64(vvcdsp, bit_depth, cpu_flags);
+#elif ARCH_RISCV
+    ff_vvc_dsp_init_riscv(vvcdsp, bit_depth, cpu_flags);
+#elif ARCH_X86
+    ff_vvc_dsp_init_x86(vvcdsp, bit_depth, cpu_flags);
+#endif
+}
+
+void ff_vvc_dsp_init(VVCDSPContext *vvcdsp, int bit_depth)
+{
+    ff_vvc_dsp_init_cpu(vvcdsp, bit_depth, av_get_cpu_flags());
+}
+
+typedef void (*DSPFunc)(void);
+
+typedef struct DSPMember {
+    const char *name;
+    size_t offset;
+    size_t nb_funcs;
+} DSPMember;
+
+#define MEMBER(m) { #m, offsetof(VVCDSPContext, m), sizeof(((VVCDSPContext *)0)->m) / sizeof(DSPFunc) }
+
+static const DSPMember dsp_members[] = {
+    MEMBER(inter.put),                  MEMBER(inter.put_uni),          MEMBER(inter.put_uni_w),
+    MEMBER(inter.put_bi),               MEMBER(inter.put_scaled),       MEMBER(inter.put_uni_scaled),
+    MEMBER(inter.put_uni_w_scaled),     MEMBER(inter.avg),              MEMBER(inter.avg_pixels),
+    MEMBER(inter.w_avg),                MEMBER(inter.put_ciip),         MEMBER(inter.put_gpm),
+    MEMBER(inter.fetch_samples),        MEMBER(inter.bdof_fetch_samples),
+    MEMBER(inter.prof_grad_filter),     MEMBER(inter.apply_prof),       MEMBER(inter.apply_prof_uni),
+    MEMBER(inter.apply_prof_uni_w),     MEMBER(inter.apply_bdof),       MEMBER(inter.sad),
+    MEMBER(inter.sad_5x5),              MEMBER(inter.dmvr),
+    MEMBER(intra.intra_cclm_pred),      MEMBER(intra.cclm_luma_downsample),
+    MEMBER(intra.cclm_linear_pred),     MEMBER(intra.lmcs_scale_chroma), MEMBER(intra.intra_pred),
+    MEMBER(intra.pred_planar),          MEMBER(intra.pred_mip),         MEMBER(intra.pred_dc),
+    MEMBER(intra.pred_v),               MEMBER(intra.pred_h),           MEMBER(intra.pred_angular_v),
+    MEMBER(intra.pred_angular_h),
+    MEMBER(itx.add_residual),           MEMBER(itx.add_residual_dc),    MEMBER(itx.add_residual_isp),
+    MEMBER(itx.add_residual_joint),     MEMBER(itx.pred_residual_joint), MEMBER(itx.itx),
+    MEMBER(itx.itx_2d),                 MEMBER(itx.transform_bdpcm),    MEMBER(itx.lfnst),
+    MEMBER(itx.dequant_flat),
+    MEMBER(lmcs.filter),                MEMBER(lmcs.scale_chroma_residual),
+    MEMBER(lf.ladf_level),              MEMBER(lf.filter_luma),         MEMBER(lf.filter_chroma),
+    MEMBER(sao.band_filter),            MEMBER(sao.edge_filter),        MEMBER(sao.edge_restore),
+    MEMBER(alf.filter),                 MEMBER(alf.filter_cc),          MEMBER(alf.classify),
+};
+
+// the instruction sets the arch init functions test, from the oldest
+static const struct {
+    const char *name;
+    int flag;
+} dsp_isas[] = {
+#if ARCH_AARCH64
+    { "NEON",      AV_CPU_FLAG_NEON      },
+#elif ARCH_RISCV
+    { "RVV",       AV_CPU_FLAG_RVV_I32   },
+#elif ARCH_X86
+    { "SSE4",      AV_CPU_FLAG_SSE4      },
+    { "AVX2",      AV_CPU_FLAG_AVX2      },
+    { "AVX512ICL", AV_CPU_FLAG_AVX512ICL },
 #endif
+    { NULL },
+};
+
+#define NB_DSP_ISAS (FF_ARRAY_ELEMS(dsp_isas) - 1)
+
+static DSPFunc dsp_func(const VVCDSPContext *c, const DSPMember *m, const int i)
+{
+    return ((const DSPFunc *)((const uint8_t *)c + m->offset))[i];
+}
+
+void ff_vvc_dsp_log(void *log_ctx, const int level, const int bit_depth, const int cpu_flags)
+{
+    // isa[0] is C, isa[i] can use dsp_isas[i - 1] and the older ones, the last one all cpu_flags
+    VVCDSPContext isa[NB_DSP_ISAS + 1];
+    int later_flags = 0;
+
+    if (av_log_get_level() < level)
+        return;
+
+    for (int i = NB_DSP_ISAS; i > 0; i--) {
+        ff_vvc_dsp_init_cpu(&isa[i], bit_depth, cpu_flags & ~later_flags);
+        later_flags |= dsp_isas[i - 1].flag;
+    }
+    ff_vvc_dsp_init_cpu(&isa[0], bit_depth, 0);
+
+    av_log(log_ctx, level, "VVC DSP functions for %d bit, cpu flags 0x%x:\n", bit_depth, cpu_flags);
+    for (int m = 0; m < FF_ARRAY_ELEMS(dsp_members); m++) {
+        const DSPMember *dm = &dsp_members[m];
+        int count[NB_DSP_ISAS + 1] = { 0 };
+        int nb_unset = 0;
+        AVBPrint bp;
+
+        for (int f = 0; f < dm->nb_funcs; f++) {
+            const DSPFunc func = dsp_func(&isa[NB_DSP_ISAS], dm, f);
+            int i = 0;
+
+            if (!func) {
+                nb_unset++;
+                continue;
+            }
+            while (i < NB_DSP_ISAS && dsp_func(&isa[i], dm, f) != func)
+                i++;
+            count[i]++;
+        }
+
+        av_bprint_init(&bp, 0, AV_BPRINT_SIZE_AUTOMATIC);
+        for (int i = 0; i <= NB_DSP_ISAS; i++) {
+            if (count[i])
+                av_bprintf(&bp, " %s %d", i ? dsp_isas[i - 1].name : "C", count[i]);
+        }
+        if (nb_unset)
+            av_bprintf(&bp, " unset %d", nb_unset);
+        av_log(log_ctx, level, "  %-28s%s\n", dm->name, bp.str);
+        av_bprint_finalize(&bp, NULL);
+    }
 }
@@ -57,6 +57,12 @@ typedef struct VVCInterDSPContext {
         uint8_t *dst, ptrdiff_t dst_stride, const uint8_t *src, ptrdiff_t src_stride, int height,
         int denom, int wx, int ox, const int8_t *hf, const int8_t *vf, int width);
 
+    // the prediction of src as put, averaged with the one of the other reference in src0 as avg,
+    // NULL where put and avg are faster
+    void (*put_bi[2 /* luma, chroma */][7 /* log2(width) - 1 */][2 /* int, frac */][2 /* int, frac */])(
+        uint8_t *dst, ptrdiff_t dst_stride, const int16_t *src0, const uint8_t *src, ptrdiff_t src_stride,
+        int height, const int8_t *hf, const int8_t *vf, int width);
+
     void (*put_scaled[2 /* luma, chroma */][7 /* log2(width) - 1 */])(
         int16_t *dst, const uint8_t *src, ptrdiff_t src_stride, int src_height,
         int x, int y, int dx, int dy, int height, const int8_t *hf, const int8_t *vf, int width);
@@ -73,6 +79,10 @@ typedef struct VVCInterDSPContext {
     void (*avg)(uint8_t *dst, ptrdiff_t dst_stride,
         const int16_t *src0, const int16_t *src1, int width, int height);
 
+    // avg of the predictions of two integer vectors, from the reference samples
+    void (*avg_pixels)(uint8_t *dst, ptrdiff_t dst_stride, const uint8_t *src0, ptrdiff_t src0_stride,
+        const uint8_t *src1, ptrdiff_t src1_stride, int width, int height);
+
     void (*w_avg)(uint8_t *_dst, const ptrdiff_t _dst_stride,
         const int16_t *src0, const int16_t *src1, int width, int height,
         int denom, int w0, int w1, int o0, int o1);
@@ -100,6 +110,8 @@ typedef struct VVCInterDSPContext {
     void (*apply_bdof)(uint8_t *dst, ptrdiff_t dst_stride, int16_t *src0, int16_t *src1, int block_w, int block_h);
 
     int (*sad)(const int16_t *src0, const int16_t *src1, int dx, int dy, int block_w, int block_h);
+    // sad[dy * 5 + dx] = sad(src0, src1, dx, dy, block_w, block_h) for the whole 5x5 search range
+    void (*sad_5x5)(int *sad, const int16_t *src0, const int16_t *src1, int block_w, int block_h);
     void (*dmvr[2][2])(int16_t *dst, const uint8_t *src, ptrdiff_t src_stride, int height,
         intptr_t mx, intptr_t my, int width);
 } VVCInterDSPContext;
@@ -108,6 +120,10 @@ struct VVCLocalContext;
 
 typedef struct VVCIntraDSPContext {
     void (*intra_cclm_pred)(const struct VVCLocalContext *lc, int x0, int y0, int w, int h);
+    // the subsampled luma of a 4:2:2 (vs == 0) or 4:2:0 chroma block, dsy has a stride of w
+    void (*cclm_luma_downsample)(uint8_t *dsy, const uint8_t *src, ptrdiff_t stride, int w, int h,
+        int vs, int avail_t, int avail_l, int collocated);
+    void (*cclm_linear_pred)(uint8_t *src, ptrdiff_t stride, const uint8_t *dsy, int w, int h, int a, int b, int k);
     void (*lmcs_scale_chroma)(struct VVCLocalContext *lc, int *dst, const int *coeff, int w, int h, int x0_cu, int y0_cu);
     void (*intra_pred)(const struct VVCLocalContext *lc, int x0, int y0, int w, int h, int c_idx);
     void (*pred_planar)(uint8_t *src, const uint8_t *top, const uint8_t *left, int w, int h, ptrdiff_t stride);
@@ -124,17 +140,55 @@ typedef struct VVCIntraDSPContext {
 
 typedef struct VVCItxDSPContext {
     void (*add_residual)(uint8_t *dst, const int *res, int width, int height, ptrdiff_t stride);
+    // add_residual of a residual that is dc everywhere
+    void (*add_residual_dc)(uint8_t *dst, int dc, int width, int height, ptrdiff_t stride);
+    // add_residual of the 4 x height prediction shared by the intra sub-partitions of width 1 << i,
+    // whose residuals follow each other in res
+    void (*add_residual_isp[2])(uint8_t *dst, const int *res, int height, ptrdiff_t stride);
     void (*add_residual_joint)(uint8_t *dst, const int *res, int width, int height, ptrdiff_t stride, int c_sign, int shift);
     void (*pred_residual_joint)(int *buf, int width, int height, int c_sign, int shift);
 
     void (*itx[N_TX_TYPE][N_TX_SIZE])(int *coeffs, ptrdiff_t step, size_t nz);
+    // vertical pass over the first nzw columns, clip to log2_transform_range, horizontal pass, round by shift
+    void (*itx_2d)(int *coeffs, int log2_w, int log2_h, enum TxType trh, enum TxType trv,
+        size_t nzw, size_t nzh, int shift, int log2_transform_range);
     void (*transform_bdpcm)(int *coeffs, int width, int height, int vertical, int log2_transform_range);
+    // 8.7.3 scaling of a width x height region with a flat scaling matrix: scale includes m = 16
+    void (*dequant_flat)(int *coeffs, ptrdiff_t stride, int width, int height, int64_t scale, int shift,
+        int log2_transform_range);
+    void (*lfnst)(int *v, const int *u, int no_zero_size, int n_tr_s,
+        int pred_mode_intra, int lfnst_idx, int log2_transform_range);
 } VVCItxDSPContext;
 
 typedef struct VVCLMCSDSPContext {
     void (*filter)(uint8_t *dst, ptrdiff_t dst_stride, int width, int height, const void *lut);
+    void (*scale_chroma_residual)(int *dst, const int *coeff, int width, int height, int chroma_scale);
 } VVCLMCSDSPContext;
 
+enum VVCLFMode {
+    VVC_LF_NONE,
+    VVC_LF_WEAK,
+    VVC_LF_STRONG,
+    VVC_LF_LARGE,
+    VVC_LF_ONE_SIDE,
+};
+
+/**
+ * Per line deblocking decisions for the 8 lines of a filter_luma or filter_chroma call,
+ * used by the SIMD filters. The masks are 0 or -1. The layout is shared with the asm.
+ */
+typedef struct VVCLFLanes {
+    int16_t tc[8];
+    int16_t filter_p[8];
+    int16_t filter_q[8];
+    int16_t weak[8];
+    int16_t weak_p1[8];
+    int16_t weak_q1[8];
+    int16_t strong[8];
+    int16_t one_side[8];
+    int modes;              ///< bitmask of 1 << enum VVCLFMode, 0 if nothing is left to filter
+} VVCLFLanes;
+
 typedef struct VVCLFDSPContext {
     int (*ladf_level[2 /* h, v */])(const uint8_t *pix, ptrdiff_t stride);
 
@@ -164,8 +218,6 @@ typedef struct VVCALFDSPContext {
 
     void (*classify)(int *class_idx, int *transpose_idx, const uint8_t *src, ptrdiff_t src_stride, int width, int height,
         int vb_pos, int *gradient_tmp);
-    void (*recon_coeff_and_clip)(int16_t *coeff, int16_t *clip, const int *class_idx, const int *transpose_idx, int size,
-        const int16_t *coeff_set, const uint8_t *clip_idx_set, const uint8_t *class_to_filt);
 } VVCALFDSPContext;
 
 typedef struct VVCDSPContext {
@@ -180,6 +232,36 @@ typedef struct VVCDSPContext {
 
 void ff_vvc_dsp_init(VVCDSPContext *hpc, int bit_depth);
 
-void ff_vvc_dsp_init_x86(VVCDSPContext *hpc, const int bit_depth);
+/**
+ * ff_vvc_dsp_init() with the given cpu flags instead of av_get_cpu_flags()
+ */
+void ff_vvc_dsp_init_cpu(VVCDSPContext *hpc, int bit_depth, int cpu_flags);
+
+/**
+ * Log which instruction set each group of kernels ff_vvc_dsp_init_cpu()
+ * selects for bit_depth and cpu_flags, one line per member of VVCDSPContext.
+ */
+void ff_vvc_dsp_log(void *log_ctx, int level, int bit_depth, int cpu_flags);
+
+void ff_vvc_dsp_init_aarch64(VVCDSPContext *hpc, const int bit_depth, const int cpu_flags);
+void ff_vvc_dsp_init_riscv(VVCDSPContext *hpc, const int bit_depth, const int cpu_flags);
+void ff_vvc_dsp_init_x86(VVCDSPContext *hpc, const int bit_depth, const int cpu_flags);
+
+/**
+ * Make the deblocking decisions of a filter_luma or filter_chroma call and fill l.
+ * Luma segments that need the long filter are filtered in place.
+ * @return l->modes
+ */
+#define LF_LANES_PROTOTYPES(bd)                                                                           \
+int ff_vvc_lf_luma_lanes_ ## bd(VVCLFLanes *l, uint8_t *pix, ptrdiff_t xstride, ptrdiff_t ystride,       \
+    const int32_t *beta, const int32_t *tc, const uint8_t *no_p, const uint8_t *no_q,                    \
+    const uint8_t *max_len_p, const uint8_t *max_len_q, int hor_ctu_edge);                               \
+int ff_vvc_lf_chroma_lanes_ ## bd(VVCLFLanes *l, uint8_t *pix, ptrdiff_t xstride, ptrdiff_t ystride,     \
+    const int32_t *beta, const int32_t *tc, const uint8_t *no_p, const uint8_t *no_q,                    \
+    const uint8_t *max_len_p, const uint8_t *max_len_q, int shift);
+
+LF_LANES_PROTOTYPES(8)
+LF_LANES_PROTOTYPES(10)
+LF_LANES_PROTOTYPES(12)
 
 #endif /* AVCODEC_VVC_DSP_H */
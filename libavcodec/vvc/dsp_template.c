@@ -45,6 +45,45 @@ static void FUNC(add_residual)(uint8_t *_dst, const int *res,
     }
 }
 
+static av_always_inline void FUNC(add_residual_isp)(uint8_t *_dst, const int *res,
+    const int w, const int h, const ptrdiff_t _stride)
+{
+    pixel *dst          = (pixel *)_dst;
+
+    const int stride    = _stride / sizeof(pixel);
+
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < 4; x++)
+            dst[x] = av_clip_pixel(dst[x] + res[(x / w) * w * h + x % w]);
+        res += w;
+        dst += stride;
+    }
+}
+
+static void FUNC(add_residual_isp_1)(uint8_t *dst, const int *res, const int h, const ptrdiff_t stride)
+{
+    FUNC(add_residual_isp)(dst, res, 1, h, stride);
+}
+
+static void FUNC(add_residual_isp_2)(uint8_t *dst, const int *res, const int h, const ptrdiff_t stride)
+{
+    FUNC(add_residual_isp)(dst, res, 2, h, stride);
+}
+
+static void FUNC(add_residual_dc)(uint8_t *_dst, const int dc,
+    const int w, const int h, const ptrdiff_t _stride)
+{
+    pixel *dst          = (pixel *)_dst;
+
+    const int stride    = _stride / sizeof(pixel);
+
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++)
+            dst[x] = av_clip_pixel(dst[x] + dc);
+        dst += stride;
+    }
+}
+
 static void FUNC(add_residual_joint)(uint8_t *_dst, const int *res,
     const int w, const int h, const ptrdiff_t _stride, const int c_sign, const int shift)
 {
@@ -106,9 +145,15 @@ static void FUNC(ff_vvc_itx_dsp_init)(VVCItxDSPContext *const itx)
         VVC_ITX(TYPE, type, 32);
 
     itx->add_residual                = FUNC(add_residual);
+    itx->add_residual_dc             = FUNC(add_residual_dc);
+    itx->add_residual_isp[0]         = FUNC(add_residual_isp_1);
+    itx->add_residual_isp[1]         = FUNC(add_residual_isp_2);
     itx->add_residual_joint          = FUNC(add_residual_joint);
     itx->pred_residual_joint         = FUNC(pred_residual_joint);
     itx->transform_bdpcm             = FUNC(transform_bdpcm);
+    itx->itx_2d                      = itx_2d;
+    itx->dequant_flat                = dequant_flat;
+    itx->lfnst                       = ff_vvc_inv_lfnst_1d;
     VVC_ITX(DCT2, dct2, 2)
     VVC_ITX(DCT2, dct2, 64)
     VVC_ITX_COMMON(DCT2, dct2)
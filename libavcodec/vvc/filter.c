@@ -25,6 +25,7 @@
 #include "ctu.h"
 #include "data.h"
 #include "filter.h"
+#include "mvs.h"
 #include "refs.h"
 
 #define LEFT        0
@@ -59,6 +60,9 @@ static const uint8_t betatable[64] = {
 // One vertical and one horizontal virtual boundary in a CTU at most. The CTU will be divided into 4 subblocks.
 #define MAX_VBBS 4
 
+#define LMCS_DEFERRED_COLS 4
+#define LMCS_DEFERRED_ROWS 1
+
 static int get_virtual_boundary(const VVCFrameContext *fc, const int ctu_pos, const int vertical)
 {
     const VVCSPS *sps    = fc->ps.sps;
@@ -158,7 +162,7 @@ static void sao_copy_ctb_to_hv(VVCLocalContext *lc, const int rx, const int ry,
     const int x0         = rx << fc->ps.sps->ctb_log2_size_y;
     const int y0         = ry << fc->ps.sps->ctb_log2_size_y;
 
-    for (int c_idx = 0; c_idx < (fc->ps.sps->r->sps_chroma_format_idc ? 3 : 1); c_idx++) {
+    for (int c_idx = 0; c_idx < (fc->ps.sps->r->sps_chroma_format_idc && !fc->gray ? 3 : 1); c_idx++) {
         const int x                = x0 >> fc->ps.sps->hshift[c_idx];
         const int y                = y0 >> fc->ps.sps->vshift[c_idx];
         const ptrdiff_t src_stride = fc->frame->linesize[c_idx];
@@ -311,13 +315,34 @@ static void sao_restore_vb(uint8_t *dst, ptrdiff_t dst_stride, const uint8_t *sr
     av_image_copy_plane(dst, dst_stride, src, src_stride, w << ps, h);
 }
 
+int ff_vvc_sao_needed(const VVCFrameContext *fc, const int rx, const int ry)
+{
+    const SAOParams *sao = &CTB(fc->tab.sao, rx, ry);
+
+    for (int c_idx = 0; c_idx < (fc->ps.sps->r->sps_chroma_format_idc && !fc->gray ? 3 : 1); c_idx++) {
+        if (sao->type_idx[c_idx] != SAO_NOT_APPLIED)
+            return 1;
+    }
+    return 0;
+}
+
 void ff_vvc_sao_filter(VVCLocalContext *lc, int x0, int y0)
 {
     VVCFrameContext *fc  = lc->fc;
     const VVCSPS *sps    = fc->ps.sps;
     const int rx         = x0 >> sps->ctb_log2_size_y;
     const int ry         = y0 >> sps->ctb_log2_size_y;
-    const int edges[4]   = { !rx, !ry, rx == fc->ps.pps->ctb_width - 1, ry == fc->ps.pps->ctb_height - 1 };
+    const VVCPPS *pps    = fc->ps.pps;
+    const int edges[4]   = { !rx, !ry, rx == pps->ctb_width - 1, ry == pps->ctb_height - 1 };
+    // the borders of the other tiles are not read when the filters do not cross them, their stages
+    // are not ordered with this one, and the samples next to them are restored anyway
+    const int no_tile    = pps->r->num_tiles_in_pic > 1 && !pps->r->pps_loop_filter_across_tiles_enabled_flag;
+    const int copy_edges[4] = {
+        edges[LEFT]   || (no_tile && pps->ctb_to_col_bd[rx] == rx),
+        edges[TOP]    || (no_tile && pps->ctb_to_row_bd[ry] == ry),
+        edges[RIGHT]  || (no_tile && pps->ctb_to_col_bd[rx] != pps->ctb_to_col_bd[rx + 1]),
+        edges[BOTTOM] || (no_tile && pps->ctb_to_row_bd[ry] != pps->ctb_to_row_bd[ry + 1]),
+    };
     const SAOParams *sao = &CTB(fc->tab.sao, rx, ry);
     // flags indicating unfilterable edges
     uint8_t vert_edge[]  = { 0, 0 };
@@ -332,7 +357,7 @@ void ff_vvc_sao_filter(VVCLocalContext *lc, int x0, int y0)
 
     sao_get_edges(vert_edge, horiz_edge, diag_edge, &restore, lc, edges, rx, ry);
 
-    for (int c_idx = 0; c_idx < (sps->r->sps_chroma_format_idc ? 3 : 1); c_idx++) {
+    for (int c_idx = 0; c_idx < (sps->r->sps_chroma_format_idc && !fc->gray ? 3 : 1); c_idx++) {
         static const uint8_t sao_tab[16] = { 0, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8 };
         const ptrdiff_t src_stride       = fc->frame->linesize[c_idx];
         uint8_t *src                     = POS(c_idx, x0, y0);
@@ -354,7 +379,7 @@ void ff_vvc_sao_filter(VVCLocalContext *lc, int x0, int y0)
                 const ptrdiff_t dst_stride = 2 * MAX_PB_SIZE + AV_INPUT_BUFFER_PADDING_SIZE;
                 uint8_t *dst               = lc->sao_buffer + dst_stride + AV_INPUT_BUFFER_PADDING_SIZE;
 
-                sao_extends_edges(dst, dst_stride, src, src_stride, width, height, fc, x0, y0, rx, ry, edges, c_idx);
+                sao_extends_edges(dst, dst_stride, src, src_stride, width, height, fc, x0, y0, rx, ry, copy_edges, c_idx);
 
                 fc->vvcdsp.sao.edge_filter[tab](src, dst, src_stride, sao->offset_val[c_idx],
                     sao->eo_class[c_idx], width, height);
@@ -449,6 +474,12 @@ static int boundary_strength(const VVCLocalContext *lc, const MvField *curr, con
     return 1;
 }
 
+// merge subblock or affine, the tables are not allocated for intra only sequences
+static av_always_inline int has_subblock_motion(const VVCFrameContext *fc, const int off)
+{
+    return !fc->tab.sz.intra_only && (fc->tab.msf[off] || fc->tab.iaf[off]);
+}
+
 //part of 8.8.3.3 Derivation process of transform block boundary
 static void derive_max_filter_length_luma(const VVCFrameContext *fc, const int qx, const int qy,
                                           const int is_intra, const int has_subblock, const int vertical, uint8_t *max_len_p, uint8_t *max_len_q)
@@ -471,11 +502,12 @@ static void derive_max_filter_length_luma(const VVCFrameContext *fc, const int q
     }
     if (has_subblock)
         *max_len_q = FFMIN(5, *max_len_q);
-    if (fc->tab.msf[off_p] || fc->tab.iaf[off_p])
+    if (has_subblock_motion(fc, off_p))
         *max_len_p = FFMIN(5, *max_len_p);
 }
 
-static void vvc_deblock_subblock_bs(const VVCLocalContext *lc,
+// returns whether a boundary strength is not 0
+static int vvc_deblock_subblock_bs(const VVCLocalContext *lc,
     const int cb, int x0, int y0, int width, int height, const int vertical)
 {
     const VVCFrameContext  *fc = lc->fc;
@@ -484,6 +516,7 @@ static void vvc_deblock_subblock_bs(const VVCLocalContext *lc,
     int stridea                = fc->ps.pps->min_pu_width;
     int strideb                = 1;
     const int log2_min_pu_size = MIN_PU_LOG2;
+    int has_bs                 = 0;
 
     if (!vertical) {
         FFSWAP(int, x0, y0);
@@ -510,6 +543,7 @@ static void vvc_deblock_subblock_bs(const VVCLocalContext *lc,
                 FFSWAP(int, x, y);
 
             TAB_BS(fc->tab.bs[vertical][LUMA], x, y) = bs;
+            has_bs |= bs;
 
             if (i == 4 || i == width - 4)
                 max_len_p = max_len_q = 1;
@@ -522,6 +556,7 @@ static void vvc_deblock_subblock_bs(const VVCLocalContext *lc,
             TAB_MAX_LEN(fc->tab.max_len_q[vertical], x, y) = max_len_q;
         }
     }
+    return has_bs;
 }
 
 static av_always_inline int deblock_bs(const VVCLocalContext *lc,
@@ -605,28 +640,25 @@ static int deblock_is_boundary(const VVCLocalContext *lc, const int boundary,
     return boundary;
 }
 
-static void vvc_deblock_bs_luma(const VVCLocalContext *lc,
+static int vvc_deblock_bs_luma(const VVCLocalContext *lc,
     const int x0, const int y0, const int width, const int height, const int rs, const int vertical)
 {
     const VVCFrameContext *fc  = lc->fc;
-    const MvField *tab_mvf     = fc->tab.mvf;
     const int mask             = LUMA_GRID - 1;
-    const int log2_min_pu_size = MIN_PU_LOG2;
-    const int min_pu_width     = fc->ps.pps->min_pu_width;
     const int min_cb_log2      = fc->ps.sps->min_cb_log2_size_y;
     const int min_cb_width     = fc->ps.pps->min_cb_width;
     const int pos              = vertical ? x0 : y0;
     const int off_q            = (y0 >> min_cb_log2) * min_cb_width + (x0 >> min_cb_log2);
     const int cb               = (vertical ? fc->tab.cb_pos_x : fc->tab.cb_pos_y )[LUMA][off_q];
-    const int is_intra         = tab_mvf[(y0 >> log2_min_pu_size) * min_pu_width +
-            (x0 >> log2_min_pu_size)].pred_flag == PF_INTRA;
+    const int is_intra         = ff_vvc_get_pred_flag(fc, x0, y0) == PF_INTRA;
+    int has_bs                 = 0;
 
     if (deblock_is_boundary(lc, pos > 0 && !(pos & mask), pos, rs, vertical)) {
         const int is_vb         = is_virtual_boundary(fc, pos, vertical);
         const int size          = vertical ? height : width;
         const int off           = cb - pos;
         const int cb_size       = (vertical ? fc->tab.cb_width : fc->tab.cb_height)[LUMA][off_q];
-        const int has_sb        = !is_intra && (fc->tab.msf[off_q] || fc->tab.iaf[off_q]) && cb_size > 8;
+        const int has_sb        = !is_intra && has_subblock_motion(fc, off_q) && cb_size > 8;
         const int flag          = vertical ? BOUNDARY_LEFT_SLICE : BOUNDARY_UPPER_SLICE;
         const RefPicList *rpl_p =
             (lc->boundary_flags & flag) ? ff_vvc_get_ref_list(fc, fc->ref, x0 - vertical, y0 - !vertical) : lc->sc->rpl;
@@ -638,6 +670,7 @@ static void vvc_deblock_bs_luma(const VVCLocalContext *lc,
             const int bs = is_vb ? 0 : deblock_bs(lc, x - vertical, y - !vertical, x, y, rpl_p, LUMA, off, has_sb);
 
             TAB_BS(fc->tab.bs[vertical][LUMA], x, y) = bs;
+            has_bs |= bs;
 
             derive_max_filter_length_luma(fc, x, y, is_intra, has_sb, vertical, &max_len_p, &max_len_q);
             TAB_MAX_LEN(fc->tab.max_len_p[vertical], x, y) = max_len_p;
@@ -646,18 +679,20 @@ static void vvc_deblock_bs_luma(const VVCLocalContext *lc,
     }
 
     if (!is_intra) {
-        if (fc->tab.msf[off_q] || fc->tab.iaf[off_q])
-            vvc_deblock_subblock_bs(lc, cb, x0, y0, width, height, vertical);
+        if (has_subblock_motion(fc, off_q))
+            has_bs |= vvc_deblock_subblock_bs(lc, cb, x0, y0, width, height, vertical);
     }
+    return has_bs;
 }
 
-static void vvc_deblock_bs_chroma(const VVCLocalContext *lc,
+static int vvc_deblock_bs_chroma(const VVCLocalContext *lc,
     const int x0, const int y0, const int width, const int height, const int rs, const int vertical)
 {
     const VVCFrameContext *fc = lc->fc;
     const int shift           = (vertical ? fc->ps.sps->hshift : fc->ps.sps->vshift)[CHROMA];
     const int mask            = (CHROMA_GRID << shift) - 1;
     const int pos             = vertical ? x0 : y0;
+    int has_bs                = 0;
 
     if (deblock_is_boundary(lc, pos > 0 && !(pos & mask), pos, rs, vertical)) {
         const int is_vb = is_virtual_boundary(fc, pos, vertical);
@@ -670,39 +705,82 @@ static void vvc_deblock_bs_chroma(const VVCLocalContext *lc,
                 const int bs = is_vb ? 0 : deblock_bs(lc, x - vertical, y - !vertical, x, y, NULL, c_idx, 0, 0);
 
                 TAB_BS(fc->tab.bs[vertical][c_idx], x, y) = bs;
+                has_bs |= bs;
             }
         }
     }
+    return has_bs;
 }
 
-typedef void (*deblock_bs_fn)(const VVCLocalContext *lc, const int x0, const int y0,
+typedef int (*deblock_bs_fn)(const VVCLocalContext *lc, const int x0, const int y0,
     const int width, const int height, const int rs, const int vertical);
 
-static void vvc_deblock_bs(const VVCLocalContext *lc, const int x0, const int y0, const int rs, const int vertical)
+// returns whether a boundary strength of the ctu is not 0
+static av_always_inline int vvc_deblock_bs(const VVCLocalContext *lc, const int x0, const int y0, const int rs,
+    const int vertical, const int log2_ctb_size, const int chroma_format_idc)
 {
     const VVCFrameContext *fc = lc->fc;
-    const VVCSPS *sps  = fc->ps.sps;
     const VVCPPS *pps  = fc->ps.pps;
-    const int ctb_size = sps->ctb_size_y;
+    const int ctb_size = 1 << log2_ctb_size;
     const int x_end    = FFMIN(x0 + ctb_size, pps->width) >> MIN_TU_LOG2;
     const int y_end    = FFMIN(y0 + ctb_size, pps->height) >> MIN_TU_LOG2;
     deblock_bs_fn deblock_bs[] = {
         vvc_deblock_bs_luma, vvc_deblock_bs_chroma
     };
+    int has_bs = 0;
 
-    for (int is_chroma = 0; is_chroma <= 1; is_chroma++) {
-        const int hs = sps->hshift[is_chroma];
-        const int vs = sps->vshift[is_chroma];
+    for (int is_chroma = 0; is_chroma <= !!chroma_format_idc; is_chroma++) {
+        const int hs = is_chroma && (chroma_format_idc == 1 || chroma_format_idc == 2);
+        const int vs = is_chroma && chroma_format_idc == 1;
         for (int y = y0 >> MIN_TU_LOG2; y < y_end; y++) {
             for (int x = x0 >> MIN_TU_LOG2; x < x_end; x++) {
                 const int off = y * fc->ps.pps->min_tu_width + x;
                 if ((fc->tab.tb_pos_x0[is_chroma][off] >> MIN_TU_LOG2) == x && (fc->tab.tb_pos_y0[is_chroma][off] >> MIN_TU_LOG2) == y) {
-                    deblock_bs[is_chroma](lc, x << MIN_TU_LOG2, y << MIN_TU_LOG2,
+                    has_bs |= deblock_bs[is_chroma](lc, x << MIN_TU_LOG2, y << MIN_TU_LOG2,
                         fc->tab.tb_width[is_chroma][off] << hs, fc->tab.tb_height[is_chroma][off] << vs, rs, vertical);
                 }
             }
         }
     }
+    return has_bs;
+}
+
+#define DEBLOCK_BS_FUNC(log2_ctb_size, chroma_format_idc)                                          \
+static int vvc_deblock_bs_ ## log2_ctb_size ## _ ## chroma_format_idc(const VVCLocalContext *lc,     \
+    const int x0, const int y0, const int rs, const int vertical)                                   \
+{                                                                                                   \
+    return vvc_deblock_bs(lc, x0, y0, rs, vertical, log2_ctb_size, chroma_format_idc);             \
+}
+
+#define DEBLOCK_BS_FUNCS(log2_ctb_size)                                                             \
+    DEBLOCK_BS_FUNC(log2_ctb_size, 0)                                                               \
+    DEBLOCK_BS_FUNC(log2_ctb_size, 1)                                                               \
+    DEBLOCK_BS_FUNC(log2_ctb_size, 2)                                                               \
+    DEBLOCK_BS_FUNC(log2_ctb_size, 3)
+
+DEBLOCK_BS_FUNCS(5)
+DEBLOCK_BS_FUNCS(6)
+DEBLOCK_BS_FUNCS(7)
+
+#define DEBLOCK_BS_FUNCS_ENTRY(log2_ctb_size) {                                                     \
+    vvc_deblock_bs_ ## log2_ctb_size ## _0, vvc_deblock_bs_ ## log2_ctb_size ## _1,                 \
+    vvc_deblock_bs_ ## log2_ctb_size ## _2, vvc_deblock_bs_ ## log2_ctb_size ## _3,                 \
+}
+
+void ff_vvc_deblock_bs(const VVCLocalContext *lc, const int rx, const int ry, const int rs, const int vertical)
+{
+    // instantiated per ctb size and chroma format, so the loops over the tu grid and the chroma
+    // shifts are constants, and a monochrome stream skips the chroma pass
+    static int (* const deblock_bs[3][4])(const VVCLocalContext *lc, int x0, int y0, int rs, int vertical) = {
+        DEBLOCK_BS_FUNCS_ENTRY(5), DEBLOCK_BS_FUNCS_ENTRY(6), DEBLOCK_BS_FUNCS_ENTRY(7),
+    };
+    const VVCSPS *sps       = lc->fc->ps.sps;
+    const int log2_ctb_size = sps->ctb_log2_size_y;
+    CTU *ctu                = lc->fc->tab.ctus + rs;
+
+    av_assert2(log2_ctb_size >= 5 && log2_ctb_size <= 7);
+    ctu->has_bs[vertical] = deblock_bs[log2_ctb_size - 5][sps->r->sps_chroma_format_idc](lc,
+        rx << log2_ctb_size, ry << log2_ctb_size, rs, vertical);
 }
 
 //part of 8.8.3.3 Derivation process of transform block boundary
@@ -780,12 +858,14 @@ static int get_qp(const VVCFrameContext *fc, const uint8_t *src, const int x, co
     return get_qp_c(fc, x, y, c_idx, vertical);
 }
 
-static void vvc_deblock(const VVCLocalContext *lc, int x0, int y0, const int rs, const int vertical)
+// log2_ctb_size is a constant in each instance, so the ctu loops get fixed bounds
+static av_always_inline void vvc_deblock(const VVCLocalContext *lc, int x0, int y0, const int rs,
+    const int vertical, const int log2_ctb_size)
 {
     VVCFrameContext *fc    = lc->fc;
     const VVCSPS *sps      = fc->ps.sps;
-    const int c_end        = sps->r->sps_chroma_format_idc ? VVC_MAX_SAMPLE_ARRAYS : 1;
-    const int ctb_size     = fc->ps.sps->ctb_size_y;
+    const int c_end        = sps->r->sps_chroma_format_idc && !fc->gray ? VVC_MAX_SAMPLE_ARRAYS : 1;
+    const int ctb_size     = 1 << log2_ctb_size;
     const DBParams *params = fc->tab.deblock + rs;
     int x_end              = FFMIN(x0 + ctb_size, fc->ps.pps->width);
     int y_end              = FFMIN(y0 + ctb_size, fc->ps.pps->height);
@@ -794,8 +874,6 @@ static void vvc_deblock(const VVCLocalContext *lc, int x0, int y0, const int rs,
     const uint8_t no_p[4]  = { 0 };
     const uint8_t no_q[4]  = { 0 } ;
 
-    vvc_deblock_bs(lc, x0, y0, rs, vertical);
-
     if (!vertical) {
         FFSWAP(int, x_end, y_end);
         FFSWAP(int, x0, y0);
@@ -845,14 +923,31 @@ static void vvc_deblock(const VVCLocalContext *lc, int x0, int y0, const int rs,
     }
 }
 
+static av_always_inline void vvc_deblock_ctb_size(const VVCLocalContext *lc, const int x0, const int y0,
+    const int rs, const int vertical)
+{
+    switch (lc->fc->ps.sps->ctb_log2_size_y) {
+    case 5:
+        vvc_deblock(lc, x0, y0, rs, vertical, 5);
+        break;
+    case 6:
+        vvc_deblock(lc, x0, y0, rs, vertical, 6);
+        break;
+    default:
+        av_assert2(lc->fc->ps.sps->ctb_log2_size_y == 7);
+        vvc_deblock(lc, x0, y0, rs, vertical, 7);
+        break;
+    }
+}
+
 void ff_vvc_deblock_vertical(const VVCLocalContext *lc, const int x0, const int y0, const int rs)
 {
-    vvc_deblock(lc, x0, y0, rs, 1);
+    vvc_deblock_ctb_size(lc, x0, y0, rs, 1);
 }
 
 void ff_vvc_deblock_horizontal(const VVCLocalContext *lc, const int x0, const int y0, const int rs)
 {
-    vvc_deblock(lc, x0, y0, rs, 0);
+    vvc_deblock_ctb_size(lc, x0, y0, rs, 0);
 }
 
 static void alf_copy_border(uint8_t *dst, const uint8_t *src,
@@ -989,37 +1084,27 @@ static void alf_prepare_buffer(VVCFrameContext *fc, uint8_t *_dst, const uint8_t
     alf_fill_border_v(dst, dst_stride, src,  dst - (1 << ps), border_pixels, height, ps, edges, edges[RIGHT]);
 }
 
-#define ALF_MAX_BLOCKS_IN_CTU   (MAX_CTU_SIZE * MAX_CTU_SIZE / ALF_BLOCK_SIZE / ALF_BLOCK_SIZE)
-#define ALF_MAX_FILTER_SIZE     (ALF_MAX_BLOCKS_IN_CTU * ALF_NUM_COEFF_LUMA)
-
 static void alf_get_coeff_and_clip(VVCLocalContext *lc, int16_t *coeff, int16_t *clip,
     const uint8_t *src, ptrdiff_t src_stride, int width, int height, int vb_pos, const ALFParams *alf)
 {
     const VVCFrameContext *fc     = lc->fc;
     const H266RawSliceHeader *rsh = lc->sc->sh.r;
-    uint8_t fixed_clip_set[ALF_NUM_FILTERS_LUMA][ALF_NUM_COEFF_LUMA] = { 0 };
-    const int16_t *coeff_set;
-    const uint8_t *clip_idx_set;
-    const uint8_t *class_to_filt;
     const int size = width * height / ALF_BLOCK_SIZE / ALF_BLOCK_SIZE;
+    const VVCALFLumaFilters *f;
     int class_idx[ALF_MAX_BLOCKS_IN_CTU];
     int transpose_idx[ALF_MAX_BLOCKS_IN_CTU];
 
-    if (alf->ctb_filt_set_idx_y < 16) {
-        coeff_set         = &ff_vvc_alf_fix_filt_coeff[0][0];
-        clip_idx_set      = &fixed_clip_set[0][0];
-        class_to_filt     = ff_vvc_alf_class_to_filt_map[alf->ctb_filt_set_idx_y];
-    } else {
-        const int id      = rsh->sh_alf_aps_id_luma[alf->ctb_filt_set_idx_y - 16];
-        const VVCALF *aps = fc->ps.alf_list[id];
-        coeff_set         = &aps->luma_coeff[0][0];
-        clip_idx_set      = &aps->luma_clip_idx[0][0];
-        class_to_filt     = ff_vvc_alf_aps_class_to_filt_map;
-    }
+    if (alf->ctb_filt_set_idx_y < ALF_NUM_FIXED_FILTER_SETS)
+        f = &fc->ps.alf_fixed[alf->ctb_filt_set_idx_y];
+    else
+        f = &fc->ps.alf_luma[rsh->sh_alf_aps_id_luma[alf->ctb_filt_set_idx_y - ALF_NUM_FIXED_FILTER_SETS]];
+
     fc->vvcdsp.alf.classify(class_idx, transpose_idx, src, src_stride, width, height,
         vb_pos, lc->alf_gradient_tmp);
-    fc->vvcdsp.alf.recon_coeff_and_clip(coeff, clip, class_idx, transpose_idx, size,
-        coeff_set, clip_idx_set, class_to_filt);
+    for (int i = 0; i < size; i++) {
+        memcpy(coeff + i * ALF_NUM_COEFF_LUMA, f->coeff[class_idx[i]][transpose_idx[i]], sizeof(f->coeff[0][0]));
+        memcpy(clip  + i * ALF_NUM_COEFF_LUMA, f->clip [class_idx[i]][transpose_idx[i]], sizeof(f->clip[0][0]));
+    }
 }
 
 static void alf_filter_luma(VVCLocalContext *lc, uint8_t *dst, const uint8_t *src,
@@ -1028,11 +1113,8 @@ static void alf_filter_luma(VVCLocalContext *lc, uint8_t *dst, const uint8_t *sr
 {
     const VVCFrameContext *fc = lc->fc;
     int vb_pos                = _vb_pos - y0;
-    int16_t *coeff            = (int16_t*)lc->tmp;
-    int16_t *clip             = (int16_t *)lc->tmp1;
-
-    av_assert0(ALF_MAX_FILTER_SIZE <= sizeof(lc->tmp));
-    av_assert0(ALF_MAX_FILTER_SIZE * sizeof(int16_t) <= sizeof(lc->tmp1));
+    int16_t *coeff            = lc->alf_coeff;
+    int16_t *clip             = lc->alf_clip;
 
     alf_get_coeff_and_clip(lc, coeff, clip, src, src_stride, width, height, vb_pos, alf);
     fc->vvcdsp.alf.filter[LUMA](dst, dst_stride, src, src_stride, width, height, coeff, clip, vb_pos);
@@ -1086,7 +1168,7 @@ void ff_vvc_alf_copy_ctu_to_hv(VVCLocalContext* lc, const int x0, const int y0)
     const int rx         = x0 >> fc->ps.sps->ctb_log2_size_y;
     const int ry         = y0 >> fc->ps.sps->ctb_log2_size_y;
     const int ctb_size_y = fc->ps.sps->ctb_size_y;
-    const int c_end      = fc->ps.sps->r->sps_chroma_format_idc ? VVC_MAX_SAMPLE_ARRAYS : 1;
+    const int c_end      = fc->ps.sps->r->sps_chroma_format_idc && !fc->gray ? VVC_MAX_SAMPLE_ARRAYS : 1;
 
     for (int c_idx = 0; c_idx < c_end; c_idx++) {
         const int hs     = fc->ps.sps->hshift[c_idx];
@@ -1184,6 +1266,14 @@ static void alf_get_subblocks(const VVCLocalContext *lc, VVCRect sbs[MAX_VBBS],
     *nb_sbs = i;
 }
 
+int ff_vvc_alf_needed(const VVCFrameContext *fc, const int rx, const int ry)
+{
+    const ALFParams *alf = &CTB(fc->tab.alf, rx, ry);
+
+    return alf->ctb_flag[LUMA] || alf->ctb_flag[CB] || alf->ctb_flag[CR] ||
+        alf->ctb_cc_idc[0] || alf->ctb_cc_idc[1];
+}
+
 void ff_vvc_alf_filter(VVCLocalContext *lc, const int x0, const int y0)
 {
     VVCFrameContext *fc     = lc->fc;
@@ -1193,7 +1283,7 @@ void ff_vvc_alf_filter(VVCLocalContext *lc, const int x0, const int y0)
     const int ps            = sps->pixel_shift;
     const int padded_stride = EDGE_EMU_BUFFER_STRIDE << ps;
     const int padded_offset = padded_stride * ALF_PADDING_SIZE + (ALF_PADDING_SIZE << ps);
-    const int c_end         = sps->r->sps_chroma_format_idc ? VVC_MAX_SAMPLE_ARRAYS : 1;
+    const int c_end         = sps->r->sps_chroma_format_idc && !fc->gray ? VVC_MAX_SAMPLE_ARRAYS : 1;
     const int ctu_end       = y0 + sps->ctb_size_y;
     const ALFParams *alf    = &CTB(fc->tab.alf, rx, ry);
     int sb_edges[MAX_VBBS][MAX_EDGES], nb_sbs;
@@ -1202,7 +1292,16 @@ void ff_vvc_alf_filter(VVCLocalContext *lc, const int x0, const int y0)
     alf_get_subblocks(lc, sbs, sb_edges, &nb_sbs, x0, y0, rx, ry);
 
     for (int i = 0; i < nb_sbs; i++) {
-        const VVCRect *sb = sbs + i;
+        const VVCRect *sb   = sbs + i;
+        uint8_t *luma       = lc->alf_buffer_luma + padded_offset;
+
+        // The padded luma window holds the samples before luma ALF. It is prepared once and both the
+        // luma filter and the CC-ALF of Cb and Cr read it; only the luma filter needs the classification.
+        if (alf->ctb_flag[LUMA] || (c_end > 1 && (alf->ctb_cc_idc[0] || alf->ctb_cc_idc[1]))) {
+            alf_prepare_buffer(fc, luma, POS(LUMA, sb->l, sb->t), sb->l, sb->t, rx, ry, sb->r - sb->l, sb->b - sb->t,
+                padded_stride, fc->frame->linesize[LUMA], LUMA, sb_edges[i]);
+        }
+
         for (int c_idx = 0; c_idx < c_end; c_idx++) {
             const int hs         = fc->ps.sps->hshift[c_idx];
             const int vs         = fc->ps.sps->vshift[c_idx];
@@ -1212,25 +1311,22 @@ void ff_vvc_alf_filter(VVCLocalContext *lc, const int x0, const int y0)
             const int height     = (sb->b - sb->t) >> vs;
             const int src_stride = fc->frame->linesize[c_idx];
             uint8_t *src         = POS(c_idx, sb->l, sb->t);
-            uint8_t *padded;
 
-            if (alf->ctb_flag[c_idx] || (!c_idx && (alf->ctb_cc_idc[0] || alf->ctb_cc_idc[1]))) {
-                padded = (c_idx ? lc->alf_buffer_chroma : lc->alf_buffer_luma) + padded_offset;
-                alf_prepare_buffer(fc, padded, src, x, y, rx, ry, width, height,
-                    padded_stride, src_stride, c_idx, sb_edges[i]);
-            }
             if (alf->ctb_flag[c_idx]) {
                 if (!c_idx)  {
-                    alf_filter_luma(lc, src, padded, src_stride, padded_stride, x, y,
+                    alf_filter_luma(lc, src, luma, src_stride, padded_stride, x, y,
                         width, height, ctu_end - ALF_VB_POS_ABOVE_LUMA, alf);
                 } else {
+                    uint8_t *padded = lc->alf_buffer_chroma + padded_offset;
+
+                    alf_prepare_buffer(fc, padded, src, x, y, rx, ry, width, height,
+                        padded_stride, src_stride, c_idx, sb_edges[i]);
                     alf_filter_chroma(lc, src, padded, src_stride, padded_stride, c_idx,
                         width, height, ((ctu_end - sb->t) >> vs) - ALF_VB_POS_ABOVE_CHROMA, alf);
                 }
             }
             if (c_idx && alf->ctb_cc_idc[c_idx - 1]) {
-                padded = lc->alf_buffer_luma + padded_offset;
-                alf_filter_cc(lc, src, padded, src_stride, padded_stride, c_idx,
+                alf_filter_cc(lc, src, luma, src_stride, padded_stride, c_idx,
                     width, height, hs, vs, ctu_end - sb->t - ALF_VB_POS_ABOVE_LUMA, alf);
             }
         }
@@ -1238,14 +1334,49 @@ void ff_vvc_alf_filter(VVCLocalContext *lc, const int x0, const int y0)
 }
 
 
-void ff_vvc_lmcs_filter(const VVCLocalContext *lc, const int x, const int y)
+static void lmcs_filter(const VVCLocalContext *lc, const int x, const int y, const int width, const int height)
+{
+    const VVCFrameContext *fc = lc->fc;
+
+    if (width > 0 && height > 0)
+        fc->vvcdsp.lmcs.filter(POS(LUMA, x, y), fc->frame->linesize[LUMA], width, height, &fc->ps.lmcs.inv_lut);
+}
+
+// The reconstruction of the ctus right of and below a ctu references its right and bottom samples in the
+// mapped domain, intra prediction with multiple reference lines up to 4 columns, and only 1 row since the
+// lines are not used at the top of a ctu. These are left to ff_vvc_lmcs_filter, the rest is mapped while
+// the ctu is still in cache.
+static void lmcs_get_deferred(const VVCLocalContext *lc, const int x, const int y, int *width, int *height,
+    int *cols, int *rows)
 {
-    const SliceContext *sc = lc->sc;
     const VVCFrameContext *fc = lc->fc;
-    const int ctb_size = fc->ps.sps->ctb_size_y;
-    const int width    = FFMIN(fc->ps.pps->width  - x, ctb_size);
-    const int height   = FFMIN(fc->ps.pps->height - y, ctb_size);
-    uint8_t *data      = POS(LUMA, x, y);
-    if (sc->sh.r->sh_lmcs_used_flag)
-        fc->vvcdsp.lmcs.filter(data, fc->frame->linesize[LUMA], width, height, &fc->ps.lmcs.inv_lut);
+    const int ctb_size        = fc->ps.sps->ctb_size_y;
+
+    *width  = FFMIN(fc->ps.pps->width  - x, ctb_size);
+    *height = FFMIN(fc->ps.pps->height - y, ctb_size);
+    *cols   = x + ctb_size < fc->ps.pps->width  ? LMCS_DEFERRED_COLS : 0;
+    *rows   = y + ctb_size < fc->ps.pps->height ? LMCS_DEFERRED_ROWS : 0;
+}
+
+void ff_vvc_lmcs_filter_recon(const VVCLocalContext *lc, const int x, const int y)
+{
+    int width, height, cols, rows;
+
+    if (!lc->sc->sh.r->sh_lmcs_used_flag)
+        return;
+
+    lmcs_get_deferred(lc, x, y, &width, &height, &cols, &rows);
+    lmcs_filter(lc, x, y, width - cols, height - rows);
+}
+
+void ff_vvc_lmcs_filter(const VVCLocalContext *lc, const int x, const int y)
+{
+    int width, height, cols, rows;
+
+    if (!lc->sc->sh.r->sh_lmcs_used_flag)
+        return;
+
+    lmcs_get_deferred(lc, x, y, &width, &height, &cols, &rows);
+    lmcs_filter(lc, x + width - cols, y, cols, height);
+    lmcs_filter(lc, x, y + height - rows, width - cols, rows);
 }
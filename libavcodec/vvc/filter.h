@@ -26,13 +26,35 @@
 #include "dec.h"
 
 /**
- * lmcs filter for the CTU
+ * lmcs filter for the CTU, the part that is not referenced by the reconstruction
+ * of the CTUs right of and below it. Called once the CTU is reconstructed.
+ * @param lc local context for CTU
+ * @param x0 x position for the CTU
+ * @param y0 y position for the CTU
+ */
+void ff_vvc_lmcs_filter_recon(const VVCLocalContext *lc, const int x0, const int y0);
+
+/**
+ * lmcs filter for the CTU, the right columns and bottom rows left by
+ * ff_vvc_lmcs_filter_recon. Needs the CTUs right, below and right below reconstructed.
  * @param lc local context for CTU
  * @param x0 x position for the CTU
  * @param y0 y position for the CTU
  */
 void ff_vvc_lmcs_filter(const VVCLocalContext *lc, const int x0, const int y0);
 
+/**
+ * Derive the boundary strengths and the maximum filter lengths of the edges in
+ * the CTU. Needs the CTU left of it parsed for the vertical edges, the one
+ * above it for the horizontal ones.
+ * @param lc local context for CTU
+ * @param rx x position of the CTU in CTUs
+ * @param ry y position of the CTU in CTUs
+ * @param rs raster position for the CTU
+ * @param vertical 1 for the vertical edges, 0 for the horizontal ones
+ */
+void ff_vvc_deblock_bs(const VVCLocalContext *lc, int rx, int ry, int rs, int vertical);
+
 /**
  * vertical deblock filter for the CTU
  * @param lc local context for CTU
@@ -51,6 +73,14 @@ void ff_vvc_deblock_vertical(const VVCLocalContext *lc, int x0, int y0, int rs);
  */
 void ff_vvc_deblock_horizontal(const VVCLocalContext *lc, int x0, int y0, int rs);
 
+/**
+ * Whether SAO changes a sample of the CTU.
+ * @param fc frame context
+ * @param rx x position of the CTU in CTUs
+ * @param ry y position of the CTU in CTUs
+ */
+int ff_vvc_sao_needed(const VVCFrameContext *fc, int rx, int ry);
+
 /**
  * sao filter for the CTU
  * @param lc local context for CTU
@@ -62,6 +92,14 @@ void ff_vvc_sao_filter(VVCLocalContext *lc, const int x0, const int y0);
 void ff_vvc_sao_copy_ctb_to_hv(VVCLocalContext* lc, int rx, int ry, int last_row);
 void ff_vvc_alf_copy_ctu_to_hv(VVCLocalContext* lc, int x0, int y0);
 
+/**
+ * Whether ALF or CC-ALF changes a sample of the CTU.
+ * @param fc frame context
+ * @param rx x position of the CTU in CTUs
+ * @param ry y position of the CTU in CTUs
+ */
+int ff_vvc_alf_needed(const VVCFrameContext *fc, int rx, int ry);
+
 /**
  * alf filter for the CTU
  * @param lc local context for CTU
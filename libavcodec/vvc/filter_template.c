@@ -35,6 +35,20 @@ static void FUNC(lmcs_filter_luma)(uint8_t *_dst, ptrdiff_t dst_stride, const in
     }
 }
 
+// 8.7.5.3 Picture reconstruction with luma dependent chroma residual scaling process for chroma samples
+static void FUNC(lmcs_scale_chroma_residual)(int *dst, const int *coeff, const int width, const int height,
+    const int chroma_scale)
+{
+    for (int i = 0; i < width * height; i++) {
+        const int c = av_clip_intp2(coeff[i], BIT_DEPTH);
+
+        if (c > 0)
+            dst[i] = (c * chroma_scale + (1 << 10)) >> 11;
+        else
+            dst[i] = -((-c * chroma_scale + (1 << 10)) >> 11);
+    }
+}
+
 static av_always_inline int16_t FUNC(alf_clip)(pixel curr, pixel v0, pixel v1, int16_t clip)
 {
     return av_clip(v0 - curr, -clip, clip) + av_clip(v1 - curr, -clip, clip);
@@ -380,33 +394,6 @@ static void FUNC(alf_classify)(int *class_idx, int *transpose_idx,
 
 }
 
-static void FUNC(alf_recon_coeff_and_clip)(int16_t *coeff, int16_t *clip,
-    const int *class_idx, const int *transpose_idx, const int size,
-    const int16_t *coeff_set, const uint8_t *clip_idx_set, const uint8_t *class_to_filt)
-{
-    const static int index[][ALF_NUM_COEFF_LUMA] = {
-        { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 },
-        { 9, 4, 10, 8, 1, 5, 11, 7, 3, 0, 2, 6 },
-        { 0, 3, 2, 1, 8, 7, 6, 5, 4, 9, 10, 11 },
-        { 9, 8, 10, 4, 3, 7, 11, 5, 1, 0, 2, 6 },
-    };
-
-    const int16_t clip_set[] = {
-        1 << BIT_DEPTH, 1 << (BIT_DEPTH - 3), 1 << (BIT_DEPTH - 5), 1 << (BIT_DEPTH - 7)
-    };
-
-    for (int i = 0; i < size; i++) {
-        const int16_t  *src_coeff = coeff_set + class_to_filt[class_idx[i]] * ALF_NUM_COEFF_LUMA;
-        const uint8_t *clip_idx  = clip_idx_set + class_idx[i] * ALF_NUM_COEFF_LUMA;
-
-        for (int j = 0; j < ALF_NUM_COEFF_LUMA; j++) {
-            const int idx = index[transpose_idx[i]][j];
-            *coeff++ = src_coeff[idx];
-            *clip++  = clip_set[clip_idx[idx]];
-        }
-    }
-}
-
 #undef ALF_DIR_HORZ
 #undef ALF_DIR_VERT
 #undef ALF_DIR_DIGA0
@@ -543,6 +530,86 @@ static void FUNC(loop_filter_luma_large)(pixel *pix, const ptrdiff_t xstride, co
     }
 }
 
+// decision for the 4 lines of one luma edge segment, max_len_p/q are updated for the long filter
+static enum VVCLFMode FUNC(luma_decision)(const pixel *pix, const ptrdiff_t xstride, const ptrdiff_t ystride,
+    const int beta, const int tc, int *_max_len_p, int *_max_len_q, int *nd_p, int *nd_q, const int hor_ctu_edge)
+{
+    const int dp0  = abs(P2 - 2 * P1 + P0);
+    const int dq0  = abs(Q2 - 2 * Q1 + Q0);
+    const int dp3  = abs(TP2 - 2 * TP1 + TP0);
+    const int dq3  = abs(TQ2 - 2 * TQ1 + TQ0);
+    const int d0   = dp0 + dq0;
+    const int d3   = dp3 + dq3;
+    const int tc25 = ((tc * 5 + 1) >> 1);
+
+    int max_len_p  = *_max_len_p;
+    int max_len_q  = *_max_len_q;
+
+    const int large_p = (max_len_p > 3 && !hor_ctu_edge);
+    const int large_q = max_len_q > 3;
+
+    const int beta_3  = beta >> 3;
+    const int beta_2  = beta >> 2;
+
+    if (large_p || large_q) {
+        const int dp0l = large_p ? ((dp0 + abs(P5 - 2 * P4 + P3) + 1) >> 1) : dp0;
+        const int dq0l = large_q ? ((dq0 + abs(Q5 - 2 * Q4 + Q3) + 1) >> 1) : dq0;
+        const int dp3l = large_p ? ((dp3 + abs(TP5 - 2 * TP4 + TP3) + 1) >> 1) : dp3;
+        const int dq3l = large_q ? ((dq3 + abs(TQ5 - 2 * TQ4 + TQ3) + 1) >> 1) : dq3;
+        const int d0l = dp0l + dq0l;
+        const int d3l = dp3l + dq3l;
+        const int beta53 = beta * 3 >> 5;
+        const int beta_4 = beta >> 4;
+        max_len_p = large_p ? max_len_p : 3;
+        max_len_q = large_q ? max_len_q : 3;
+
+        if (d0l + d3l < beta) {
+            const int sp0l = abs(P3 - P0) + (max_len_p == 7 ? abs(P7 - P6 - P5 + P4) : 0);
+            const int sq0l = abs(Q0 - Q3) + (max_len_q == 7 ? abs(Q4 - Q5 - Q6 + Q7) : 0);
+            const int sp3l = abs(TP3 - TP0) + (max_len_p == 7 ? abs(TP7 - TP6 - TP5 + TP4) : 0);
+            const int sq3l = abs(TQ0 - TQ3) + (max_len_q == 7 ? abs(TQ4 - TQ5 - TQ6 + TQ7) : 0);
+            const int sp0 = large_p ? ((sp0l + abs(P3 -   P(max_len_p)) + 1) >> 1) : sp0l;
+            const int sp3 = large_p ? ((sp3l + abs(TP3 - TP(max_len_p)) + 1) >> 1) : sp3l;
+            const int sq0 = large_q ? ((sq0l + abs(Q3 -   Q(max_len_q)) + 1) >> 1) : sq0l;
+            const int sq3 = large_q ? ((sq3l + abs(TQ3 - TQ(max_len_q)) + 1) >> 1) : sq3l;
+            if (sp0 + sq0 < beta53 && abs(P0 - Q0) < tc25 &&
+                sp3 + sq3 < beta53 && abs(TP0 - TQ0) < tc25 &&
+                (d0l << 1) < beta_4 && (d3l << 1) < beta_4) {
+                *_max_len_p = max_len_p;
+                *_max_len_q = max_len_q;
+                return VVC_LF_LARGE;
+            }
+        }
+    }
+    if (d0 + d3 < beta) {
+        if (max_len_p > 2 && max_len_q > 2 &&
+            abs(P3 - P0) + abs(Q3 - Q0) < beta_3 && abs(P0 - Q0) < tc25 &&
+            abs(TP3 - TP0) + abs(TQ3 - TQ0) < beta_3 && abs(TP0 - TQ0) < tc25 &&
+            (d0 << 1) < beta_2 && (d3 << 1) < beta_2) {
+            return VVC_LF_STRONG;
+        }
+        *nd_p = 1;
+        *nd_q = 1;
+        if (max_len_p > 1 && max_len_q > 1) {
+            if (dp0 + dp3 < ((beta + (beta >> 1)) >> 3))
+                *nd_p = 2;
+            if (dq0 + dq3 < ((beta + (beta >> 1)) >> 3))
+                *nd_q = 2;
+        }
+        return VVC_LF_WEAK;
+    }
+    return VVC_LF_NONE;
+}
+
+static av_always_inline int FUNC(scale_tc)(const int32_t tc)
+{
+#if BIT_DEPTH < 10
+    return (tc + (1 << (9 - BIT_DEPTH))) >> (10 - BIT_DEPTH);
+#else
+    return tc << (BIT_DEPTH - 10);
+#endif
+}
+
 static void FUNC(vvc_loop_filter_luma)(uint8_t* _pix, ptrdiff_t _xstride, ptrdiff_t _ystride,
     const int32_t *_beta, const int32_t *_tc, const uint8_t *_no_p, const uint8_t *_no_q,
     const uint8_t *_max_len_p, const uint8_t *_max_len_q, const int hor_ctu_edge)
@@ -551,83 +618,77 @@ static void FUNC(vvc_loop_filter_luma)(uint8_t* _pix, ptrdiff_t _xstride, ptrdif
     const ptrdiff_t ystride = _ystride / sizeof(pixel);
 
     for (int i = 0; i < 2; i++) {
-#if BIT_DEPTH < 10
-        const int tc    = (_tc[i] + (1 << (9 - BIT_DEPTH))) >> (10 - BIT_DEPTH);
-#else
-        const int tc    = _tc[i] << (BIT_DEPTH - 10);
-#endif
+        const int tc = FUNC(scale_tc)(_tc[i]);
+
         if (tc) {
             pixel* pix     = (pixel*)_pix + i * 4 * ystride;
-            const int dp0  = abs(P2 - 2 * P1 + P0);
-            const int dq0  = abs(Q2 - 2 * Q1 + Q0);
-            const int dp3  = abs(TP2 - 2 * TP1 + TP0);
-            const int dq3  = abs(TQ2 - 2 * TQ1 + TQ0);
-            const int d0   = dp0 + dq0;
-            const int d3   = dp3 + dq3;
-            const int tc25 = ((tc * 5 + 1) >> 1);
-
             const int no_p = _no_p[i];
             const int no_q = _no_q[i];
-
+            const int beta = _beta[i] << BIT_DEPTH - 8;
             int max_len_p  = _max_len_p[i];
             int max_len_q  = _max_len_q[i];
-
-            const int large_p = (max_len_p > 3 && !hor_ctu_edge);
-            const int large_q = max_len_q > 3;
-
-            const int beta    = _beta[i] << BIT_DEPTH - 8;
-            const int beta_3  = beta >> 3;
-            const int beta_2  = beta >> 2;
-
-            if (large_p || large_q) {
-                const int dp0l = large_p ? ((dp0 + abs(P5 - 2 * P4 + P3) + 1) >> 1) : dp0;
-                const int dq0l = large_q ? ((dq0 + abs(Q5 - 2 * Q4 + Q3) + 1) >> 1) : dq0;
-                const int dp3l = large_p ? ((dp3 + abs(TP5 - 2 * TP4 + TP3) + 1) >> 1) : dp3;
-                const int dq3l = large_q ? ((dq3 + abs(TQ5 - 2 * TQ4 + TQ3) + 1) >> 1) : dq3;
-                const int d0l = dp0l + dq0l;
-                const int d3l = dp3l + dq3l;
-                const int beta53 = beta * 3 >> 5;
-                const int beta_4 = beta >> 4;
-                max_len_p = large_p ? max_len_p : 3;
-                max_len_q = large_q ? max_len_q : 3;
-
-                if (d0l + d3l < beta) {
-                    const int sp0l = abs(P3 - P0) + (max_len_p == 7 ? abs(P7 - P6 - P5 + P4) : 0);
-                    const int sq0l = abs(Q0 - Q3) + (max_len_q == 7 ? abs(Q4 - Q5 - Q6 + Q7) : 0);
-                    const int sp3l = abs(TP3 - TP0) + (max_len_p == 7 ? abs(TP7 - TP6 - TP5 + TP4) : 0);
-                    const int sq3l = abs(TQ0 - TQ3) + (max_len_q == 7 ? abs(TQ4 - TQ5 - TQ6 + TQ7) : 0);
-                    const int sp0 = large_p ? ((sp0l + abs(P3 -   P(max_len_p)) + 1) >> 1) : sp0l;
-                    const int sp3 = large_p ? ((sp3l + abs(TP3 - TP(max_len_p)) + 1) >> 1) : sp3l;
-                    const int sq0 = large_q ? ((sq0l + abs(Q3 -   Q(max_len_q)) + 1) >> 1) : sq0l;
-                    const int sq3 = large_q ? ((sq3l + abs(TQ3 - TQ(max_len_q)) + 1) >> 1) : sq3l;
-                    if (sp0 + sq0 < beta53 && abs(P0 - Q0) < tc25 &&
-                        sp3 + sq3 < beta53 && abs(TP0 - TQ0) < tc25 &&
-                        (d0l << 1) < beta_4 && (d3l << 1) < beta_4) {
-                        FUNC(loop_filter_luma_large)(pix, xstride, ystride, tc, no_p, no_q, max_len_p, max_len_q);
-                        continue;
-                    }
-                }
+            int nd_p, nd_q;
+
+            switch (FUNC(luma_decision)(pix, xstride, ystride, beta, tc, &max_len_p, &max_len_q, &nd_p, &nd_q, hor_ctu_edge)) {
+            case VVC_LF_LARGE:
+                FUNC(loop_filter_luma_large)(pix, xstride, ystride, tc, no_p, no_q, max_len_p, max_len_q);
+                break;
+            case VVC_LF_STRONG:
+                FUNC(loop_filter_luma_strong)(pix, xstride, ystride, tc, tc << 1, tc * 3, no_p, no_q);
+                break;
+            case VVC_LF_WEAK:
+                FUNC(loop_filter_luma_weak)(pix, xstride, ystride, tc, beta, no_p, no_q, nd_p, nd_q);
+                break;
+            default:
+                break;
             }
-            if (d0 + d3 < beta) {
-                if (max_len_p > 2 && max_len_q > 2 &&
-                    abs(P3 - P0) + abs(Q3 - Q0) < beta_3 && abs(P0 - Q0) < tc25 &&
-                    abs(TP3 - TP0) + abs(TQ3 - TQ0) < beta_3 && abs(TP0 - TQ0) < tc25 &&
-                    (d0 << 1) < beta_2 && (d3 << 1) < beta_2) {
-                    FUNC(loop_filter_luma_strong)(pix, xstride, ystride, tc, tc << 1, tc * 3, no_p, no_q);
+        }
+    }
+}
+
+#define LANES_SET(field, start, n, v) do {          \
+    for (int k = (start); k < (start) + (n); k++)    \
+        l->field[k] = (v);                           \
+} while (0)
+
+int FUNC(ff_vvc_lf_luma_lanes)(VVCLFLanes *l, uint8_t *_pix, const ptrdiff_t _xstride, const ptrdiff_t _ystride,
+    const int32_t *_beta, const int32_t *_tc, const uint8_t *_no_p, const uint8_t *_no_q,
+    const uint8_t *_max_len_p, const uint8_t *_max_len_q, const int hor_ctu_edge)
+{
+    const ptrdiff_t xstride = _xstride / sizeof(pixel);
+    const ptrdiff_t ystride = _ystride / sizeof(pixel);
+
+    memset(l, 0, sizeof(*l));
+    for (int i = 0; i < 2; i++) {
+        const int tc = FUNC(scale_tc)(_tc[i]);
+
+        if (tc) {
+            pixel *pix     = (pixel *)_pix + i * 4 * ystride;
+            const int beta = _beta[i] << BIT_DEPTH - 8;
+            int max_len_p  = _max_len_p[i];
+            int max_len_q  = _max_len_q[i];
+            int nd_p, nd_q;
+            const enum VVCLFMode mode = FUNC(luma_decision)(pix, xstride, ystride, beta, tc,
+                &max_len_p, &max_len_q, &nd_p, &nd_q, hor_ctu_edge);
+
+            if (mode == VVC_LF_LARGE) {
+                FUNC(loop_filter_luma_large)(pix, xstride, ystride, tc, _no_p[i], _no_q[i], max_len_p, max_len_q);
+            } else if (mode != VVC_LF_NONE) {
+                l->modes |= 1 << mode;
+                LANES_SET(tc,       i * 4, 4, tc);
+                LANES_SET(filter_p, i * 4, 4, -!_no_p[i]);
+                LANES_SET(filter_q, i * 4, 4, -!_no_q[i]);
+                if (mode == VVC_LF_STRONG) {
+                    LANES_SET(strong, i * 4, 4, -1);
                 } else {
-                    int nd_p = 1;
-                    int nd_q = 1;
-                    if (max_len_p > 1 && max_len_q > 1) {
-                        if (dp0 + dp3 < ((beta + (beta >> 1)) >> 3))
-                            nd_p = 2;
-                        if (dq0 + dq3 < ((beta + (beta >> 1)) >> 3))
-                            nd_q = 2;
-                    }
-                    FUNC(loop_filter_luma_weak)(pix, xstride, ystride, tc, beta, no_p, no_q, nd_p, nd_q);
+                    LANES_SET(weak,    i * 4, 4, -1);
+                    LANES_SET(weak_p1, i * 4, 4, -(nd_p > 1));
+                    LANES_SET(weak_q1, i * 4, 4, -(nd_q > 1));
                 }
             }
         }
     }
+    return l->modes;
 }
 
 static void FUNC(loop_filter_chroma_strong)(pixel *pix, const ptrdiff_t xstride, const ptrdiff_t ystride,
@@ -678,6 +739,57 @@ static void FUNC(loop_filter_chroma_strong_one_side)(pixel *pix, const ptrdiff_t
     }
 }
 
+// decision for one chroma edge segment of 2 or 4 lines
+static enum VVCLFMode FUNC(chroma_decision)(const pixel *pix, const ptrdiff_t xstride, const ptrdiff_t ystride,
+    const int beta, const int tc, int max_len_p, int max_len_q, const int shift)
+{
+    const int beta_3 = beta >> 3;
+    const int beta_2 = beta >> 2;
+    const int tc25   = ((tc * 5 + 1) >> 1);
+
+    if (!max_len_p || !max_len_q)
+        return VVC_LF_NONE;
+
+    if (max_len_q == 3){
+        const int p1n  = shift ? FP1 : TP1;
+        const int p2n = max_len_p == 1 ? p1n : (shift ? FP2 : TP2);
+        const int p0n  = shift ? FP0 : TP0;
+        const int q0n  = shift ? FQ0 : TQ0;
+        const int q1n  = shift ? FQ1 : TQ1;
+        const int q2n  = shift ? FQ2 : TQ2;
+        const int p3   = max_len_p == 1 ? P1 : P3;
+        const int p2   = max_len_p == 1 ? P1 : P2;
+        const int p1   = P1;
+        const int p0   = P0;
+        const int dp0  = abs(p2 - 2 * p1 + p0);
+        const int dq0  = abs(Q2 - 2 * Q1 + Q0);
+
+        const int dp1 = abs(p2n - 2 * p1n + p0n);
+        const int dq1 = abs(q2n - 2 * q1n + q0n);
+        const int d0  = dp0 + dq0;
+        const int d1  = dp1 + dq1;
+
+        if (d0 + d1 < beta) {
+            const int p3n = max_len_p == 1 ? p1n : (shift ? FP3 : TP3);
+            const int q3n = shift ? FQ3 : TQ3;
+            const int dsam0 = (d0 << 1) < beta_2 && (abs(p3 - p0) + abs(Q0 - Q3)     < beta_3) &&
+                abs(p0 - Q0)   < tc25;
+            const int dsam1 = (d1 << 1) < beta_2 && (abs(p3n - p0n) + abs(q0n - q3n) < beta_3) &&
+                abs(p0n - q0n) < tc25;
+            if (!dsam0 || !dsam1)
+                max_len_p = max_len_q = 1;
+        } else {
+            max_len_p = max_len_q = 1;
+        }
+    }
+
+    if (max_len_p == 3 && max_len_q == 3)
+        return VVC_LF_STRONG;
+    if (max_len_q == 3)
+        return VVC_LF_ONE_SIDE;
+    return VVC_LF_WEAK;
+}
+
 static void FUNC(vvc_loop_filter_chroma)(uint8_t *_pix, const ptrdiff_t  _xstride, const ptrdiff_t _ystride,
     const int32_t *_beta, const int32_t *_tc, const uint8_t *_no_p, const uint8_t *_no_q,
     const uint8_t *_max_len_p, const uint8_t *_max_len_q, const int shift)
@@ -688,71 +800,68 @@ static void FUNC(vvc_loop_filter_chroma)(uint8_t *_pix, const ptrdiff_t  _xstrid
     const int end           = 8 / size;         // 8 samples a loop
 
     for (int i = 0; i < end; i++) {
-#if BIT_DEPTH < 10
-        const int tc = (_tc[i] + (1 << (9 - BIT_DEPTH))) >> (10 - BIT_DEPTH);
-#else
-        const int tc = _tc[i] << (BIT_DEPTH - 10);
-#endif
+        const int tc = FUNC(scale_tc)(_tc[i]);
+
         if (tc) {
             pixel *pix         = (pixel *)_pix + i * size * ystride;
             const uint8_t no_p = _no_p[i];
             const uint8_t no_q = _no_q[i];
-
             const int beta     = _beta[i] << (BIT_DEPTH - 8);
-            const int beta_3   = beta >> 3;
-            const int beta_2   = beta >> 2;
 
-            const int tc25     = ((tc * 5 + 1) >> 1);
+            switch (FUNC(chroma_decision)(pix, xstride, ystride, beta, tc, _max_len_p[i], _max_len_q[i], shift)) {
+            case VVC_LF_STRONG:
+                FUNC(loop_filter_chroma_strong)(pix, xstride, ystride, size, tc, no_p, no_q);
+                break;
+            case VVC_LF_ONE_SIDE:
+                FUNC(loop_filter_chroma_strong_one_side)(pix, xstride, ystride, size, tc, no_p, no_q);
+                break;
+            case VVC_LF_WEAK:
+                FUNC(loop_filter_chroma_weak)(pix, xstride, ystride, size, tc, no_p, no_q);
+                break;
+            default:
+                break;
+            }
+        }
+    }
+}
 
-            uint8_t max_len_p  = _max_len_p[i];
-            uint8_t max_len_q  = _max_len_q[i];
+int FUNC(ff_vvc_lf_chroma_lanes)(VVCLFLanes *l, uint8_t *_pix, const ptrdiff_t _xstride, const ptrdiff_t _ystride,
+    const int32_t *_beta, const int32_t *_tc, const uint8_t *_no_p, const uint8_t *_no_q,
+    const uint8_t *_max_len_p, const uint8_t *_max_len_q, const int shift)
+{
+    const ptrdiff_t xstride = _xstride / sizeof(pixel);
+    const ptrdiff_t ystride = _ystride / sizeof(pixel);
+    const int size          = shift ? 2 : 4;
+    const int end           = 8 / size;
 
-            if (!max_len_p || !max_len_q)
-                continue;
+    memset(l, 0, sizeof(*l));
+    for (int i = 0; i < end; i++) {
+        const int tc = FUNC(scale_tc)(_tc[i]);
 
-            if (max_len_q == 3){
-                const int p1n  = shift ? FP1 : TP1;
-                const int p2n = max_len_p == 1 ? p1n : (shift ? FP2 : TP2);
-                const int p0n  = shift ? FP0 : TP0;
-                const int q0n  = shift ? FQ0 : TQ0;
-                const int q1n  = shift ? FQ1 : TQ1;
-                const int q2n  = shift ? FQ2 : TQ2;
-                const int p3   = max_len_p == 1 ? P1 : P3;
-                const int p2   = max_len_p == 1 ? P1 : P2;
-                const int p1   = P1;
-                const int p0   = P0;
-                const int dp0  = abs(p2 - 2 * p1 + p0);
-                const int dq0  = abs(Q2 - 2 * Q1 + Q0);
-
-                const int dp1 = abs(p2n - 2 * p1n + p0n);
-                const int dq1 = abs(q2n - 2 * q1n + q0n);
-                const int d0  = dp0 + dq0;
-                const int d1  = dp1 + dq1;
-
-                if (d0 + d1 < beta) {
-                    const int p3n = max_len_p == 1 ? p1n : (shift ? FP3 : TP3);
-                    const int q3n = shift ? FQ3 : TQ3;
-                    const int dsam0 = (d0 << 1) < beta_2 && (abs(p3 - p0) + abs(Q0 - Q3)     < beta_3) &&
-                        abs(p0 - Q0)   < tc25;
-                    const int dsam1 = (d1 << 1) < beta_2 && (abs(p3n - p0n) + abs(q0n - q3n) < beta_3) &&
-                        abs(p0n - q0n) < tc25;
-                    if (!dsam0 || !dsam1)
-                        max_len_p = max_len_q = 1;
-                } else {
-                    max_len_p = max_len_q = 1;
-                }
+        if (tc) {
+            const pixel *pix = (pixel *)_pix + i * size * ystride;
+            const enum VVCLFMode mode = FUNC(chroma_decision)(pix, xstride, ystride, _beta[i] << (BIT_DEPTH - 8),
+                tc, _max_len_p[i], _max_len_q[i], shift);
+
+            if (mode != VVC_LF_NONE) {
+                l->modes |= 1 << mode;
+                LANES_SET(tc,       i * size, size, tc);
+                LANES_SET(filter_p, i * size, size, -!_no_p[i]);
+                LANES_SET(filter_q, i * size, size, -!_no_q[i]);
+                if (mode == VVC_LF_STRONG)
+                    LANES_SET(strong,   i * size, size, -1);
+                else if (mode == VVC_LF_ONE_SIDE)
+                    LANES_SET(one_side, i * size, size, -1);
+                else
+                    LANES_SET(weak,     i * size, size, -1);
             }
-
-            if (max_len_p == 3 && max_len_q == 3)
-                FUNC(loop_filter_chroma_strong)(pix, xstride, ystride, size, tc, no_p, no_q);
-            else if (max_len_q == 3)
-                FUNC(loop_filter_chroma_strong_one_side)(pix, xstride, ystride, size, tc, no_p, no_q);
-            else
-                FUNC(loop_filter_chroma_weak)(pix, xstride, ystride, size, tc, no_p, no_q);
         }
     }
+    return l->modes;
 }
 
+#undef LANES_SET
+
 static void FUNC(vvc_h_loop_filter_chroma)(uint8_t *pix, ptrdiff_t stride,
     const int32_t *beta, const int32_t *tc, const uint8_t *no_p, const uint8_t *no_q,
     const uint8_t *max_len_p, const uint8_t *max_len_q, int shift)
@@ -839,7 +948,8 @@ static int FUNC(vvc_v_loop_ladf_level)(const uint8_t *pix, ptrdiff_t stride)
 
 static void FUNC(ff_vvc_lmcs_dsp_init)(VVCLMCSDSPContext *const lmcs)
 {
-    lmcs->filter = FUNC(lmcs_filter_luma);
+    lmcs->filter                = FUNC(lmcs_filter_luma);
+    lmcs->scale_chroma_residual = FUNC(lmcs_scale_chroma_residual);
 }
 
 static void FUNC(ff_vvc_lf_dsp_init)(VVCLFDSPContext *const lf)
@@ -868,5 +978,4 @@ static void FUNC(ff_vvc_alf_dsp_init)(VVCALFDSPContext *const alf)
     alf->filter[CHROMA]  = FUNC(alf_filter_chroma);
     alf->filter_cc       = FUNC(alf_filter_cc);
     alf->classify        = FUNC(alf_classify);
-    alf->recon_coeff_and_clip = FUNC(alf_recon_coeff_and_clip);
 }
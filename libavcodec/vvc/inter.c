@@ -19,10 +19,17 @@
  * License along with FFmpeg; if not, write to the Free Software
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
+#include <stdatomic.h>
+
 #include "libavutil/frame.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/mem.h"
+#include "libavutil/thread.h"
+#include "libavcodec/refstruct.h"
 
 #include "data.h"
 #include "inter.h"
+#include "intra.h"
 #include "mvs.h"
 #include "refs.h"
 
@@ -57,8 +64,36 @@ static void clip_to_subpic(int *x_off, int *y_off, int *pic_width, int *pic_heig
     *pic_height = b - t;
 }
 
+// Whether the block and the samples around it needed by the filter are within the filled guard
+// bands of the reference, in which case they are read in place. wrap is the horizontal wraparound
+// offset the block is read with, which the left and right guard bands must have been filled with.
+// Subpictures treated as pictures are padded at their own edges, which the guard bands of the
+// picture don't cover.
+static int in_padding(const VVCFrame *src_frame, const VVCRect *subpic, const int is_chroma, const int wrap,
+    const int x_off, const int y_off, const int block_w, const int block_h,
+    const int extra_before, const int extra_after)
+{
+    const VVCSPS *sps    = src_frame->sps;
+    const VVCPPS *pps    = src_frame->pps;
+    const int pad_x      = src_frame->padding >> sps->hshift[is_chroma];
+    const int pad_y      = src_frame->padding >> sps->vshift[is_chroma];
+    const int pic_width  = pps->width  >> sps->hshift[is_chroma];
+    const int pic_height = pps->height >> sps->vshift[is_chroma];
+
+    if (!pad_x || subpic->l || subpic->t || subpic->r != pic_width || subpic->b != pic_height)
+        return 0;
+
+    if (src_frame->padding_wrap >> sps->hshift[is_chroma] != wrap &&
+        (x_off - extra_before < 0 || x_off + block_w + extra_after > pic_width))
+        return 0;
+
+    return x_off - extra_before >= -pad_x && x_off + block_w + extra_after <= pic_width  + pad_x &&
+           y_off - extra_before >= -pad_y && y_off + block_h + extra_after <= pic_height + pad_y &&
+           ff_vvc_frame_padded(src_frame);
+}
+
 static void emulated_edge_no_wrap(const VVCLocalContext *lc, uint8_t *dst,
-    const uint8_t **src, ptrdiff_t *src_stride,
+    const uint8_t **src, ptrdiff_t *src_stride, const VVCFrame *src_frame, const int is_chroma,
     int x_off, int y_off, const int block_w, const int block_h,
     const int extra_before, const int extra_after,
     const VVCRect *subpic, const VVCRect *sb, const int dmvr_clip)
@@ -79,6 +114,9 @@ static void emulated_edge_no_wrap(const VVCLocalContext *lc, uint8_t *dst,
         const int offset                = extra_before * *src_stride     + (extra_before << ps);
         const int buf_offset            = extra_before * edge_emu_stride + (extra_before << ps);
 
+        if (!dmvr_clip && in_padding(src_frame, subpic, is_chroma, 0, x_off, y_off, block_w, block_h, extra_before, extra_after))
+            return;
+
         fc->vdsp.emulated_edge_mc(dst, *src - offset, edge_emu_stride, *src_stride,
             block_w + extra, block_h + extra, x_off - extra_before, y_off - extra_before,
             pic_width, pic_height);
@@ -139,19 +177,24 @@ static void emulated_edge(const VVCLocalContext *lc, uint8_t *dst,
     subpic_get_rect(&subpic, src_frame, subpic_idx, is_chroma);
 
     if (!wrap_enabled || (dmvr_left >= 0 && dmvr_right <= pic_width)) {
-        emulated_edge_no_wrap(lc, dst, src, src_stride,
+        emulated_edge_no_wrap(lc, dst, src, src_stride, src_frame, is_chroma,
             x_off, y_off, block_w, block_h, extra_before, extra_after, &subpic, &sb, dmvr_clip);
         return;
     }
+    if (!dmvr_clip && in_padding(src_frame, &subpic, is_chroma, wrap,
+            x_off, y_off, block_w, block_h, extra_before, extra_after)) {
+        *src += y_off * *src_stride + (x_off * (1 << ps));
+        return;
+    }
     if (dmvr_right <= 0) {
         sb_wrap(&sb, wrap);
-        emulated_edge_no_wrap(lc, dst, src, src_stride,
+        emulated_edge_no_wrap(lc, dst, src, src_stride, src_frame, is_chroma,
             x_off + wrap, y_off, block_w, block_h, extra_before, extra_after, &subpic, &sb, dmvr_clip);
         return;
     }
     if (dmvr_left >= pic_width) {
         sb_wrap(&sb, -wrap);
-        emulated_edge_no_wrap(lc, dst, src, src_stride,
+        emulated_edge_no_wrap(lc, dst, src, src_stride, src_frame, is_chroma,
             x_off - wrap, y_off, block_w, block_h, extra_before, extra_after, &subpic, &sb, dmvr_clip);
         return;
     }
@@ -325,6 +368,13 @@ static void mc_bi(VVCLocalContext *lc, uint8_t *dst, const ptrdiff_t dst_stride,
     const int weight_flag     = derive_weight(&denom, &w0, &w1, &o0, &o1, lc, mvf, c_idx, pu->dmvr_flag);
     const int is_chroma       = !!c_idx;
     const int hpel_if_idx     = is_chroma ? 0 : pu->mi.hpel_if_idx;
+    // the second prediction can be averaged into dst as it is filtered
+    const int fuse            = !sb_bdof_flag && !weight_flag;
+    // or, for integer vectors, both are averaged from the reference samples
+    const int int_pel         = fuse && !av_zero_extend(mvf->mv[L0].x | mvf->mv[L1].x, 4 + hs) &&
+                                    !av_zero_extend(mvf->mv[L0].y | mvf->mv[L1].y, 4 + vs);
+    const uint8_t *src0       = NULL;
+    ptrdiff_t src0_stride     = 0;
 
     for (int i = L0; i <= L1; i++) {
         const Mv *mv           = mvf->mv + i;
@@ -347,6 +397,25 @@ static void mc_bi(VVCLocalContext *lc, uint8_t *dst, const ptrdiff_t dst_stride,
         } else {
             MC_EMULATED_EDGE(lc->edge_emu_buffer, &src, &src_stride, ox, oy);
         }
+        if (int_pel) {
+            const uint8_t *in_place = ref->frame->data[c_idx] + oy * src_stride + ox * (1 << fc->ps.sps->pixel_shift);
+
+            // the samples of L0 are kept if they are read in place, the emulated edge of L1 reuses the buffer
+            if (i == L0 && src == in_place) {
+                src0        = src;
+                src0_stride = src_stride;
+                continue;
+            }
+            if (src0) {
+                fc->vvcdsp.inter.avg_pixels(dst, dst_stride, src0, src0_stride, src, src_stride, block_w, block_h);
+                return;
+            }
+        }
+        if (i == L1 && fuse && fc->vvcdsp.inter.put_bi[is_chroma][idx][!!my][!!mx]) {
+            fc->vvcdsp.inter.put_bi[is_chroma][idx][!!my][!!mx](dst, dst_stride, tmp[L0],
+                src, src_stride, block_h, hf, vf, block_w);
+            return;
+        }
         fc->vvcdsp.inter.put[is_chroma][idx][!!my][!!mx](tmp[i],  src, src_stride, block_h, hf, vf, block_w);
         if (sb_bdof_flag)
             fc->vvcdsp.inter.bdof_fetch_samples(tmp[i], src, src_stride, mx, my, block_w, block_h);
@@ -418,6 +487,254 @@ static void emulated_edge_scaled(VVCLocalContext *lc, const uint8_t **src, ptrdi
     MC_EMULATED_EDGE(lc->edge_emu_buffer, src, src_stride, x_off, y_off);
 }
 
+// A reference rescaled to the size of the pictures predicted from it, holding the intermediate
+// samples put_scaled derives at each position for a zero motion vector. When a sample of the
+// current picture steps the reference position by a whole multiple of the position precision,
+// a block with an integer motion vector reads the positions of the block it is moved to, so the
+// copy predicts it bit exactly. The first picture using the reference sets it up for its size and
+// scaling window, and fills it one CTU row at a time as the rows are first needed.
+typedef struct RPRCacheKey {
+    int scale[2];
+    int left_offset;
+    int top_offset;
+    int width;
+    int height;
+    int ctb_log2_size;
+    int chroma_format_idc;
+    int bit_depth;
+    int collocated[2];
+} RPRCacheKey;
+
+typedef struct VVCRPRCache {
+    AVMutex lock;
+    int has_lock;
+
+    atomic_int ready;               ///< the key and the planes below are set
+    RPRCacheKey key;
+
+    int nb_planes;
+    int nb_rows;                    ///< CTU rows of the current picture
+    int16_t *buf;
+    int16_t *plane[VVC_MAX_SAMPLE_ARRAYS];
+    ptrdiff_t stride[VVC_MAX_SAMPLE_ARRAYS];
+    int width[VVC_MAX_SAMPLE_ARRAYS];
+    int height[VVC_MAX_SAMPLE_ARRAYS];
+    int x_start[VVC_MAX_SAMPLE_ARRAYS]; ///< the first columns and rows with a positive reference position
+    int y_start[VVC_MAX_SAMPLE_ARRAYS];
+    atomic_int *row_done;           ///< nb_rows per plane
+} VVCRPRCache;
+
+static void rpr_cache_free(FFRefStructOpaque unused, void *obj)
+{
+    VVCRPRCache *cache = obj;
+
+    av_freep(&cache->buf);
+    av_freep(&cache->row_done);
+    if (cache->has_lock)
+        ff_mutex_destroy(&cache->lock);
+}
+
+VVCRPRCache *ff_vvc_rpr_cache_alloc(void)
+{
+    VVCRPRCache *cache = ff_refstruct_alloc_ext(sizeof(*cache), 0, NULL, rpr_cache_free);
+
+    if (cache) {
+        cache->has_lock = !ff_mutex_init(&cache->lock, NULL);
+        if (!cache->has_lock)
+            ff_refstruct_unref(&cache);
+    }
+    return cache;
+}
+
+// whether the reference position of the next sample is SCALED_STEP() further exactly
+static int rpr_cache_linear(const int scale, const int shift, const int is_chroma)
+{
+    return (scale << (4 + shift)) == SCALED_STEP(scale) << (8 + is_chroma);
+}
+
+static int rpr_cache_init(const VVCLocalContext *lc, VVCRPRCache *cache, const VVCRefPic *refp)
+{
+    const VVCFrameContext *fc = lc->fc;
+    const VVCSPS *sps         = fc->ps.sps;
+    const int nb_planes       = sps->r->sps_chroma_format_idc ? 3 : 1;
+    const Mv zero             = { 0 };
+    RPRCacheKey key           = { 0 };
+    int ret                   = 0;
+    size_t size               = 0;
+
+    key.scale[0]          = refp->scale[0];
+    key.scale[1]          = refp->scale[1];
+    key.left_offset       = fc->ref->scaling_win.left_offset;
+    key.top_offset        = fc->ref->scaling_win.top_offset;
+    key.width             = fc->ps.pps->width;
+    key.height            = fc->ps.pps->height;
+    key.ctb_log2_size     = sps->ctb_log2_size_y;
+    key.chroma_format_idc = sps->r->sps_chroma_format_idc;
+    key.bit_depth         = sps->bit_depth;
+    key.collocated[0]     = sps->r->sps_chroma_horizontal_collocated_flag;
+    key.collocated[1]     = sps->r->sps_chroma_vertical_collocated_flag;
+
+    if (atomic_load(&cache->ready))
+        return !memcmp(&key, &cache->key, sizeof(key));
+
+    for (int c_idx = 0; c_idx < nb_planes; c_idx++) {
+        const int is_chroma = !!c_idx;
+        if (!rpr_cache_linear(key.scale[0], sps->hshift[c_idx], is_chroma) ||
+            !rpr_cache_linear(key.scale[1], sps->vshift[c_idx], is_chroma))
+            return 0;
+    }
+
+    ff_mutex_lock(&cache->lock);
+    if (atomic_load(&cache->ready)) {
+        ret = !memcmp(&key, &cache->key, sizeof(key));
+        goto end;
+    }
+
+    cache->nb_planes = nb_planes;
+    cache->nb_rows   = (key.height + (1 << key.ctb_log2_size) - 1) >> key.ctb_log2_size;
+    for (int c_idx = 0; c_idx < nb_planes; c_idx++) {
+        const int is_chroma = !!c_idx;
+        const int hs        = sps->hshift[c_idx];
+        const int vs        = sps->vshift[c_idx];
+        const int addx      = SCALED_CHROMA_ADDIN(key.scale[0], key.collocated[0]);
+        const int addy      = SCALED_CHROMA_ADDIN(key.scale[1], key.collocated[1]);
+        int x = 0, y = 0;
+
+        cache->width[c_idx]  = key.width  >> hs;
+        cache->height[c_idx] = key.height >> vs;
+        cache->stride[c_idx] = FFALIGN(cache->width[c_idx], 32);
+
+        // the positions left of and above the scaling window round towards zero the other way
+        while (x < cache->width[c_idx] && SCALED_REF_SB(x, key.left_offset, zero.x, key.scale[0], addx, hs) < 0)
+            x++;
+        while (y < cache->height[c_idx] && SCALED_REF_SB(y, key.top_offset, zero.y, key.scale[1], addy, vs) < 0)
+            y++;
+        // the blocks are split into widths put_scaled is selected by
+        cache->x_start[c_idx] = FFALIGN(x, 4);
+        cache->y_start[c_idx] = y;
+        size += cache->stride[c_idx] * cache->height[c_idx];
+    }
+
+    cache->buf      = av_malloc_array(size, sizeof(*cache->buf));
+    cache->row_done = av_calloc(nb_planes * cache->nb_rows, sizeof(*cache->row_done));
+    if (!cache->buf || !cache->row_done) {
+        av_freep(&cache->buf);
+        av_freep(&cache->row_done);
+        goto end;
+    }
+    for (int i = 0; i < nb_planes * cache->nb_rows; i++)
+        atomic_init(&cache->row_done[i], 0);
+    cache->plane[0] = cache->buf;
+    for (int c_idx = 1; c_idx < nb_planes; c_idx++)
+        cache->plane[c_idx] = cache->plane[c_idx - 1] + cache->stride[c_idx - 1] * cache->height[c_idx - 1];
+
+    cache->key = key;
+    atomic_store(&cache->ready, 1);
+    ret = 1;
+end:
+    ff_mutex_unlock(&cache->lock);
+    return ret;
+}
+
+// Fills a CTU row of a plane of the cache, if the reference rows it reads are final.
+// lc->tmp2 is used as the destination of put_scaled, the others may hold predictions.
+static int rpr_cache_build_row(VVCLocalContext *lc, VVCRPRCache *cache, const VVCRefPic *refp,
+    const int c_idx, const int row)
+{
+    const VVCFrameContext *fc = lc->fc;
+    const VVCFrame *ref       = refp->ref;
+    const int is_chroma       = !!c_idx;
+    const int vs              = fc->ps.sps->vshift[c_idx];
+    const int ctb_size        = 1 << (cache->key.ctb_log2_size - vs);
+    const int y0              = FFMAX(row * ctb_size, cache->y_start[c_idx]);
+    const int y1              = FFMIN((row + 1) * ctb_size, cache->height[c_idx]);
+    const int8_t *hf          = inter_filter_scaled(refp->scale[0], is_chroma, 0);
+    const int8_t *vf          = inter_filter_scaled(refp->scale[1], is_chroma, 0);
+    atomic_int *done          = &cache->row_done[c_idx * cache->nb_rows + row];
+    const Mv zero             = { 0 };
+    int ret                   = 1;
+
+    if (atomic_load(done))
+        return 1;
+
+    ff_mutex_lock(&cache->lock);
+    if (atomic_load(done))
+        goto end;
+
+    if (y0 < y1) {
+        int x, y, dx, dy;
+
+        scaled_ref_pos_and_step(lc, refp, &zero, cache->x_start[c_idx], y1 - 1, c_idx, &x, &y, &dx, &dy);
+        y = (SCALED_INT(y) + (is_chroma ? CHROMA_EXTRA_AFTER : LUMA_EXTRA_AFTER)) << vs;
+        if (!ff_vvc_check_progress(ref, VVC_PROGRESS_PIXEL, FFMIN(y, ref->pps->height - 1))) {
+            ret = 0;
+            goto end;
+        }
+    }
+
+    for (int y_off = y0; y_off < y1; y_off += MAX_PB_SIZE) {
+        const int h = FFMIN(y1 - y_off, MAX_PB_SIZE);
+        for (int x_off = cache->x_start[c_idx]; x_off < cache->width[c_idx]; ) {
+            const int w           = FFMIN(1 << av_log2(cache->width[c_idx] - x_off), MAX_PB_SIZE);
+            const uint8_t *src    = ref->frame->data[c_idx];
+            ptrdiff_t src_stride  = ref->frame->linesize[c_idx];
+            int16_t *dst          = cache->plane[c_idx] + y_off * cache->stride[c_idx] + x_off;
+            int x, y, dx, dy, src_height;
+
+            scaled_ref_pos_and_step(lc, refp, &zero, x_off, y_off, c_idx, &x, &y, &dx, &dy);
+            emulated_edge_scaled(lc, &src, &src_stride, &src_height, ref, x, y, dx, dy, w, h, is_chroma);
+            fc->vvcdsp.inter.put_scaled[is_chroma][av_log2(w) - 1](lc->tmp2, src, src_stride, src_height,
+                x, y, dx, dy, h, hf, vf, w);
+            for (int i = 0; i < h; i++)
+                memcpy(dst + i * cache->stride[c_idx], lc->tmp2 + i * MAX_PB_SIZE, w * sizeof(*dst));
+            x_off += w;
+        }
+    }
+    atomic_store(done, 1);
+end:
+    ff_mutex_unlock(&cache->lock);
+    return ret;
+}
+
+// Copies the intermediate prediction of a block of a non affine coding unit from the rescaled
+// reference, if it has an integer motion vector and the cache has been set up for this picture.
+static int rpr_cache_pred(VVCLocalContext *lc, int16_t *dst, const VVCRefPic *refp, const Mv *mv,
+    const int x_off, const int y_off, const int block_w, const int block_h, const int c_idx)
+{
+    VVCRPRCache *cache   = refp->ref->rpr_cache;
+    const VVCSPS *sps    = lc->fc->ps.sps;
+    const int hs         = sps->hshift[c_idx];
+    const int vs         = sps->vshift[c_idx];
+    const int x          = x_off + (mv->x >> (4 + hs));
+    const int y          = y_off + (mv->y >> (4 + vs));
+    VVCRect subpic;
+
+    if (!cache || lc->cu->pu.inter_affine_flag ||
+        av_zero_extend(mv->x, 4 + hs) || av_zero_extend(mv->y, 4 + vs))
+        return 0;
+
+    // the samples are clipped to the reference picture, not to a subpicture of it
+    subpic_get_rect(&subpic, refp->ref, lc->sc->sh.r->curr_subpic_idx, !!c_idx);
+    if (subpic.l || subpic.t || subpic.r != refp->ref->pps->width >> hs || subpic.b != refp->ref->pps->height >> vs)
+        return 0;
+
+    if (!rpr_cache_init(lc, cache, refp))
+        return 0;
+
+    if (x < cache->x_start[c_idx] || y < cache->y_start[c_idx] ||
+        x + block_w > cache->width[c_idx] || y + block_h > cache->height[c_idx])
+        return 0;
+
+    for (int row = y >> (cache->key.ctb_log2_size - vs); row <= (y + block_h - 1) >> (cache->key.ctb_log2_size - vs); row++) {
+        if (!rpr_cache_build_row(lc, cache, refp, c_idx, row))
+            return 0;
+    }
+
+    for (int i = 0; i < block_h; i++)
+        memcpy(dst + i * MAX_PB_SIZE, cache->plane[c_idx] + (y + i) * cache->stride[c_idx] + x, block_w * sizeof(*dst));
+    return 1;
+}
+
 static void mc_scaled(VVCLocalContext *lc, int16_t *dst, const VVCRefPic *refp, const Mv *mv,
     int x_off, int y_off, const int block_w, const int block_h, const int c_idx)
 {
@@ -432,6 +749,9 @@ static void mc_scaled(VVCLocalContext *lc, int16_t *dst, const VVCRefPic *refp,
     const int8_t *vf          = INTER_FILTER_SCALED(refp->scale[1]);
     int x, y, dx, dy, src_height;
 
+    if (rpr_cache_pred(lc, dst, refp, mv, x_off, y_off, block_w, block_h, c_idx))
+        return;
+
     scaled_ref_pos_and_step(lc, refp, mv, x_off, y_off, c_idx, &x, &y, &dx, &dy);
     emulated_edge_scaled(lc, &src, &src_stride, &src_height, refp->ref, x, y, dx, dy, block_w, block_h, is_chroma);
     fc->vvcdsp.inter.put_scaled[is_chroma][idx](dst, src, src_stride, src_height, x, y, dx, dy, block_h, hf, vf, block_w);
@@ -451,12 +771,20 @@ static void mc_uni_scaled(VVCLocalContext *lc, uint8_t *dst, const ptrdiff_t dst
     const int idx             = av_log2(block_w) - 1;
     const int8_t *hf          = INTER_FILTER_SCALED(refp->scale[0]);
     const int8_t *vf          = INTER_FILTER_SCALED(refp->scale[1]);
-    int denom, wx, ox, x, y, dx, dy, src_height;
+    int denom, wx, ox;
+    const int weight_flag     = derive_weight_uni(&denom, &wx, &ox, lc, mvf, c_idx);
+    int x, y, dx, dy, src_height;
+
+    // an avg of the intermediate samples with themselves rounds them like put_uni_scaled
+    if (!weight_flag && rpr_cache_pred(lc, lc->tmp, refp, mv, x_off, y_off, block_w, block_h, c_idx)) {
+        fc->vvcdsp.inter.avg(dst, dst_stride, lc->tmp, lc->tmp, block_w, block_h);
+        return;
+    }
 
     scaled_ref_pos_and_step(lc, refp, mv, x_off, y_off, c_idx, &x, &y, &dx, &dy);
     emulated_edge_scaled(lc, &src, &src_stride, &src_height, refp->ref, x, y, dx, dy, block_w, block_h, is_chroma);
 
-    if (derive_weight_uni(&denom, &wx, &ox, lc, mvf, c_idx)) {
+    if (weight_flag) {
         fc->vvcdsp.inter.put_uni_w_scaled[is_chroma][idx](dst, dst_stride, src, src_stride, src_height,
             x, y, dx, dy, block_h, denom, wx, ox, hf, vf, block_w);
     } else {
@@ -617,7 +945,7 @@ static void pred_gpm_blk(VVCLocalContext *lc)
     const uint8_t mirror_type = ff_vvc_gpm_angle_to_mirror[angle_idx];
     const uint8_t *weights;
 
-    const int c_end = fc->ps.sps->r->sps_chroma_format_idc ? 3 : 1;
+    const int c_end = fc->ps.sps->r->sps_chroma_format_idc && !fc->gray ? 3 : 1;
 
     int16_t *tmp[2] = {lc->tmp, lc->tmp1};
 
@@ -669,13 +997,12 @@ static int ciip_derive_intra_weight(const VVCLocalContext *lc, const int x0, con
     const int y0b             = av_zero_extend(y0, sps->ctb_log2_size_y);
     const int available_l     = lc->ctb_left_flag || x0b;
     const int available_u     = lc->ctb_up_flag || y0b;
-    const int min_pu_width    = fc->ps.pps->min_pu_width;
     int w                     = 1;
 
-    if (available_u &&fc->tab.mvf[((y0 - 1) >> MIN_PU_LOG2) * min_pu_width + ((x0 - 1 + width)>> MIN_PU_LOG2)].pred_flag == PF_INTRA)
+    if (available_u && ff_vvc_get_pred_flag(fc, x0 - 1 + width, y0 - 1) == PF_INTRA)
         w++;
 
-    if (available_l && fc->tab.mvf[((y0 - 1 + height)>> MIN_PU_LOG2) * min_pu_width + ((x0 - 1) >> MIN_PU_LOG2)].pred_flag == PF_INTRA)
+    if (available_l && ff_vvc_get_pred_flag(fc, x0 - 1, y0 - 1 + height) == PF_INTRA)
         w++;
 
     return w;
@@ -685,7 +1012,7 @@ static void pred_regular(VVCLocalContext *lc, const MvField *mvf, const MvField
     const int x0, const int y0, const int sbw, const int sbh, const int sb_bdof_flag, const int c_start)
 {
     const VVCFrameContext *fc = lc->fc;
-    const int c_end           = fc->ps.sps->r->sps_chroma_format_idc ? CR : LUMA;
+    const int c_end           = fc->ps.sps->r->sps_chroma_format_idc && !fc->gray ? CR : LUMA;
     VVCRefPic *refp[2];
 
     if (pred_get_refs(lc, refp, mvf) < 0)
@@ -778,12 +1105,31 @@ static int parametric_mv_refine(const int *sad, const int stride)
 }
 
 #define SAD_ARRAY_SIZE 5
+#define DMVR_SR_RANGE 2
+
+// the bilinear samples of the w x h part at (x, y) of the DMVR search area, at the same offset in dst
+static void dmvr_fetch(VVCLocalContext *lc, int16_t *dst, const VVCFrame *ref, const Mv *mv,
+    const int x_off, const int y_off, const int x, const int y, const int pred_w, const int pred_h)
+{
+    const VVCFrameContext *fc = lc->fc;
+    const int mx              = mv->x & 0xf;
+    const int my              = mv->y & 0xf;
+    const int ox              = x_off + (mv->x >> 4) - DMVR_SR_RANGE + x;
+    const int oy              = y_off + (mv->y >> 4) - DMVR_SR_RANGE + y;
+    ptrdiff_t src_stride      = ref->frame->linesize[LUMA];
+    const uint8_t *src        = ref->frame->data[LUMA];
+    const int wrap_enabled    = fc->ps.pps->r->pps_ref_wraparound_enabled_flag;
+
+    MC_EMULATED_EDGE_BILINEAR(lc->edge_emu_buffer, &src, &src_stride, ox, oy);
+    fc->vvcdsp.inter.dmvr[!!my][!!mx](dst + y * MAX_PB_SIZE + x, src, src_stride, pred_h, mx, my, pred_w);
+}
+
 //8.5.3 Decoder-side motion vector refinement process
 static void dmvr_mv_refine(VVCLocalContext *lc, MvField *mvf, MvField *orig_mv, int *sb_bdof_flag,
     const VVCFrame *ref0, const VVCFrame *ref1, const int x_off, const int y_off, const int block_w, const int block_h)
 {
     const VVCFrameContext *fc = lc->fc;
-    const int sr_range        = 2;
+    const int sr_range        = DMVR_SR_RANGE;
     const VVCFrame *refs[]    = { ref0, ref1 };
     int16_t *tmp[]            = { lc->tmp, lc->tmp1 };
     int sad[SAD_ARRAY_SIZE][SAD_ARRAY_SIZE];
@@ -792,39 +1138,37 @@ static void dmvr_mv_refine(VVCLocalContext *lc, MvField *mvf, MvField *orig_mv,
     *orig_mv = *mvf;
     min_dx = min_dy = dx = dy = 2;
 
-    for (int i = L0; i <= L1; i++) {
-        const int pred_w        = block_w + 2 * sr_range;
-        const int pred_h        = block_h + 2 * sr_range;
-        const Mv *mv            = mvf->mv + i;
-        const int mx            = mv->x & 0xf;
-        const int my            = mv->y & 0xf;
-        const int ox            = x_off + (mv->x >> 4) - sr_range;
-        const int oy            = y_off + (mv->y >> 4) - sr_range;
-        const VVCFrame *ref     = refs[i];
-        ptrdiff_t src_stride    = ref->frame->linesize[LUMA];
-        const uint8_t *src      = ref->frame->data[LUMA];
-        const int wrap_enabled  = fc->ps.pps->r->pps_ref_wraparound_enabled_flag;
-
-        MC_EMULATED_EDGE_BILINEAR(lc->edge_emu_buffer, &src, &src_stride, ox, oy);
-        fc->vvcdsp.inter.dmvr[!!my][!!mx](tmp[i], src, src_stride, pred_h, mx, my, pred_w);
-    }
+    // the center cost decides whether the rest of the search area is needed at all
+    for (int i = L0; i <= L1; i++)
+        dmvr_fetch(lc, tmp[i], refs[i], mvf->mv + i, x_off, y_off, sr_range, sr_range, block_w, block_h);
 
     min_sad = fc->vvcdsp.inter.sad(tmp[L0], tmp[L1], dx, dy, block_w, block_h);
     min_sad -= min_sad >> 2;
-    sad[dy][dx] = min_sad;
 
     if (min_sad >= block_w * block_h) {
+        const int pred_w = block_w + 2 * sr_range;
         int dmv[2];
-        // 8.5.3.4 Array entry selection process
+
+        // the rows above and below the center and the columns left and right of it, the side
+        // columns are as wide as the filters need, which refetches two columns of the center
+        for (int i = L0; i <= L1; i++) {
+            const Mv *mv = mvf->mv + i;
+            dmvr_fetch(lc, tmp[i], refs[i], mv, x_off, y_off, 0, 0, pred_w, sr_range);
+            dmvr_fetch(lc, tmp[i], refs[i], mv, x_off, y_off, 0, sr_range + block_h, pred_w, sr_range);
+            dmvr_fetch(lc, tmp[i], refs[i], mv, x_off, y_off, 0, sr_range, 2 * sr_range, block_h);
+            dmvr_fetch(lc, tmp[i], refs[i], mv, x_off, y_off, block_w, sr_range, 2 * sr_range, block_h);
+        }
+
+        fc->vvcdsp.inter.sad_5x5(&sad[0][0], lc->tmp, lc->tmp1, block_w, block_h);
+        sad[dy][dx] = min_sad;
+
+        // 8.5.3.4 Array entry selection process, the center keeps its biased cost
         for (dy = 0; dy < SAD_ARRAY_SIZE; dy++) {
             for (dx = 0; dx < SAD_ARRAY_SIZE; dx++) {
-                if (dx != sr_range || dy != sr_range) {
-                    sad[dy][dx] = fc->vvcdsp.inter.sad(lc->tmp, lc->tmp1, dx, dy, block_w, block_h);
-                    if (sad[dy][dx] < min_sad) {
-                        min_sad = sad[dy][dx];
-                        min_dx = dx;
-                        min_dy = dy;
-                    }
+                if (sad[dy][dx] < min_sad) {
+                    min_sad = sad[dy][dx];
+                    min_dx = dx;
+                    min_dy = dy;
                 }
             }
         }
@@ -879,6 +1223,45 @@ static void derive_sb_mv(VVCLocalContext *lc, MvField *mv, MvField *orig_mv, int
     }
 }
 
+static int same_motion(const MvField *a, const MvField *b)
+{
+    if (a->pred_flag != b->pred_flag || a->hpel_if_idx != b->hpel_if_idx || a->bcw_idx != b->bcw_idx)
+        return 0;
+    for (int i = L0; i <= L1; i++) {
+        if ((a->pred_flag & (PF_L0 << i)) &&
+            (a->ref_idx[i] != b->ref_idx[i] || a->mv[i].x != b->mv[i].x || a->mv[i].y != b->mv[i].y))
+            return 0;
+    }
+    return 1;
+}
+
+// The number of subblocks from sbx on, in the row at y, which have the motion of mv and are
+// predicted as one block. It is a power of 2 sbx is a multiple of, so the width stays one the
+// DSP functions are selected by. The positions in scaled references are derived per subblock.
+static int sb_run_length(const VVCLocalContext *lc, const MvField *mv, const int x0, const int y,
+    const int sbw, const int sbx, const int num_sb_x)
+{
+    const VVCFrameContext *fc = lc->fc;
+    VVCRefPic *refp[2];
+    int n = 1;
+
+    if (pred_get_refs(lc, refp, mv) < 0)
+        return 1;
+    for (int i = L0; i <= L1; i++) {
+        if ((mv->pred_flag & (PF_L0 << i)) && refp[i]->is_scaled)
+            return 1;
+    }
+
+    while (!(sbx & n) && sbx + 2 * n <= num_sb_x) {
+        for (int i = sbx + n; i < sbx + 2 * n; i++) {
+            if (!same_motion(mv, ff_vvc_get_mvf(fc, x0 + i * sbw, y)))
+                return n;
+        }
+        n *= 2;
+    }
+    return n;
+}
+
 static void pred_regular_blk(VVCLocalContext *lc, const int skip_ciip)
 {
     const CodingUnit *cu = lc->cu;
@@ -886,6 +1269,7 @@ static void pred_regular_blk(VVCLocalContext *lc, const int skip_ciip)
     const MotionInfo *mi = &pu->mi;
     MvField mv, orig_mv;
     int sbw, sbh, sb_bdof_flag = 0;
+    int batch;
 
     if (cu->ciip_flag && skip_ciip)
         return;
@@ -893,8 +1277,11 @@ static void pred_regular_blk(VVCLocalContext *lc, const int skip_ciip)
     sbw = cu->cb_width / mi->num_sb_x;
     sbh = cu->cb_height / mi->num_sb_y;
 
+    // the subblocks of SbTMVP often share their motion, refined or CIIP blocks don't
+    batch = !pu->dmvr_flag && !pu->bdof_flag && !cu->ciip_flag;
+
     for (int sby = 0; sby < mi->num_sb_y; sby++) {
-        for (int sbx = 0; sbx < mi->num_sb_x; sbx++) {
+        for (int sbx = 0, n = 1; sbx < mi->num_sb_x; sbx += n) {
             const int x0 = cu->x0 + sbx * sbw;
             const int y0 = cu->y0 + sby * sbh;
 
@@ -902,7 +1289,8 @@ static void pred_regular_blk(VVCLocalContext *lc, const int skip_ciip)
                 ff_vvc_set_neighbour_available(lc, x0, y0, sbw, sbh);
 
             derive_sb_mv(lc, &mv, &orig_mv, &sb_bdof_flag, x0, y0, sbw, sbh);
-            pred_regular(lc, &mv, &orig_mv, x0, y0, sbw, sbh, sb_bdof_flag, LUMA);
+            n = batch ? sb_run_length(lc, &mv, cu->x0, y0, sbw, sbx, mi->num_sb_x) : 1;
+            pred_regular(lc, &mv, &orig_mv, x0, y0, n * sbw, sbh, sb_bdof_flag, LUMA);
         }
     }
 }
@@ -938,9 +1326,11 @@ static void pred_affine_blk(VVCLocalContext *lc)
     const int hs              = fc->ps.sps->hshift[1];
     const int vs              = fc->ps.sps->vshift[1];
     const int dst_stride      = fc->frame->linesize[LUMA];
+    // without PROF, the luma of the subblocks sharing their motion is predicted as one block
+    const int batch           = !pu->cb_prof_flag[L0] && !pu->cb_prof_flag[L1];
 
     for (int sby = 0; sby < mi->num_sb_y; sby++) {
-        for (int sbx = 0; sbx < mi->num_sb_x; sbx++) {
+        for (int sbx = 0, n = 1; sbx < mi->num_sb_x; sbx += n) {
             const int x = x0 + sbx * sbw;
             const int y = y0 + sby * sbh;
 
@@ -951,27 +1341,30 @@ static void pred_affine_blk(VVCLocalContext *lc)
             if (pred_get_refs(lc, refp, mv) < 0)
                 return;
 
+            n = batch ? sb_run_length(lc, mv, x0, y, sbw, sbx, mi->num_sb_x) : 1;
             if (mi->pred_flag != PF_BI) {
                 const int lx = mi->pred_flag - PF_L0;
                 if (refp[lx]->is_scaled) {
-                    mc_uni_scaled(lc, dst0, dst_stride, refp[lx], mv, x, y, sbw, sbh, LUMA);
+                    mc_uni_scaled(lc, dst0, dst_stride, refp[lx], mv, x, y, n * sbw, sbh, LUMA);
                 } else {
                     luma_prof_uni(lc, dst0, dst_stride, refp[lx]->ref,
-                        mv, x, y, sbw, sbh, pu->cb_prof_flag[lx],
+                        mv, x, y, n * sbw, sbh, pu->cb_prof_flag[lx],
                         pu->diff_mv_x[lx], pu->diff_mv_y[lx]);
                 }
             } else {
-                luma_prof_bi(lc, dst0, dst_stride, refp[L0], refp[L1], mv, x, y, sbw, sbh);
+                luma_prof_bi(lc, dst0, dst_stride, refp[L0], refp[L1], mv, x, y, n * sbw, sbh);
             }
-            if (fc->ps.sps->r->sps_chroma_format_idc) {
-                if (!av_zero_extend(sby, vs) && !av_zero_extend(sbx, hs)) {
-                    MvField mvc;
-
-                    derive_affine_mvc(&mvc, fc, mv, x, y, sbw, sbh);
-                    pred_regular(lc, &mvc, NULL, x, y, sbw << hs, sbh << vs, 0, CB);
+            if (fc->ps.sps->r->sps_chroma_format_idc && !fc->gray && !av_zero_extend(sby, vs)) {
+                for (int i = sbx; i < sbx + n; i++) {
+                    if (!av_zero_extend(i, hs)) {
+                        const int xc = x0 + i * sbw;
+                        MvField mvc;
+
+                        derive_affine_mvc(&mvc, fc, ff_vvc_get_mvf(fc, xc, y), xc, y, sbw, sbh);
+                        pred_regular(lc, &mvc, NULL, xc, y, sbw << hs, sbh << vs, 0, CB);
+                    }
                 }
             }
-
         }
     }
 }
@@ -1000,6 +1393,40 @@ static int has_inter_luma(const CodingUnit *cu)
     return (cu->pred_mode == MODE_INTER || cu->pred_mode == MODE_SKIP) && cu->tree_type != DUAL_TREE_CHROMA;
 }
 
+// Prefetches the reference rows of the vectors at the top left of cu, so they are loading while
+// the previous CU is predicted
+static void prefetch_inter(const VVCLocalContext *lc, const CodingUnit *cu)
+{
+    const VVCFrameContext *fc = lc->fc;
+    const VVCSPS *sps         = fc->ps.sps;
+    const int c_end           = sps->r->sps_chroma_format_idc && !fc->gray ? CR : LUMA;
+    const MvField *mvf        = ff_vvc_get_mvf(fc, cu->x0, cu->y0);
+    VVCRefPic *refp[2];
+
+    if (pred_get_refs(lc, refp, mvf) < 0)
+        return;
+
+    for (int i = L0; i <= L1; i++) {
+        const VVCFrame *ref;
+
+        if (!(mvf->pred_flag & (PF_L0 << i)) || refp[i]->is_scaled)
+            continue;
+        ref = refp[i]->ref;
+        for (int c_idx = LUMA; c_idx <= c_end; c_idx++) {
+            const int hs               = sps->hshift[c_idx];
+            const int vs               = sps->vshift[c_idx];
+            const int width            = ref->pps->width  >> hs;
+            const int height           = ref->pps->height >> vs;
+            const ptrdiff_t linesize   = ref->frame->linesize[c_idx];
+            const int x                = av_clip((cu->x0 >> hs) + (mvf->mv[i].x >> (4 + hs)), 0, width - 1);
+            const int y                = av_clip((cu->y0 >> vs) + (mvf->mv[i].y >> (4 + vs)), 0, height - 1);
+
+            fc->vdsp.prefetch(ref->frame->data[c_idx] + y * linesize + (x << sps->pixel_shift), linesize,
+                FFMIN(cu->cb_height >> vs, height - y));
+        }
+    }
+}
+
 int ff_vvc_predict_inter(VVCLocalContext *lc, const int rs)
 {
     const VVCFrameContext *fc = lc->fc;
@@ -1008,8 +1435,12 @@ int ff_vvc_predict_inter(VVCLocalContext *lc, const int rs)
 
     while (cu) {
         lc->cu = cu;
-        if (has_inter_luma(cu))
+        if (cu->next && has_inter_luma(cu->next))
+            prefetch_inter(lc, cu->next);
+        if (has_inter_luma(cu)) {
             predict_inter(lc);
+            ff_vvc_reconstruct_inter(lc);
+        }
         cu = cu->next;
     }
 
@@ -1024,4 +1455,44 @@ void ff_vvc_predict_ciip(VVCLocalContext *lc)
     pred_regular_blk(lc, 0);
 }
 
+void ff_vvc_conceal_ctu(VVCLocalContext *lc, const VVCFrame *ref, const int x0, const int y0)
+{
+    const VVCFrameContext *fc = lc->fc;
+    const VVCSPS *sps         = fc->ps.sps;
+    const VVCPPS *pps         = fc->ps.pps;
+    const int ctb_size        = 1 << sps->ctb_log2_size_y;
+    const int ps              = sps->pixel_shift;
+    const int grey            = 1 << (sps->bit_depth - 1);
+
+    for (int c_idx = 0; c_idx < (sps->r->sps_chroma_format_idc ? 3 : 1); c_idx++) {
+        const int hs              = sps->hshift[c_idx];
+        const int vs              = sps->vshift[c_idx];
+        const int x               = x0 >> hs;
+        const int y               = y0 >> vs;
+        const int width           = (FFMIN(ctb_size, pps->width  - x0) + (1 << hs) - 1) >> hs;
+        const int height          = (FFMIN(ctb_size, pps->height - y0) + (1 << vs) - 1) >> vs;
+        const ptrdiff_t dst_stride = fc->frame->linesize[c_idx];
+        uint8_t *dst              = fc->frame->data[c_idx] + y * dst_stride + (x << ps);
+
+        if (ref) {
+            const ptrdiff_t src_stride = ref->frame->linesize[c_idx];
+            const uint8_t *src         = ref->frame->data[c_idx] + y * src_stride + (x << ps);
+
+            for (int i = 0; i < height; i++)
+                memcpy(dst + i * dst_stride, src + i * src_stride, width << ps);
+        } else {
+            for (int i = 0; i < height; i++) {
+                uint8_t *row = dst + i * dst_stride;
+
+                if (ps) {
+                    for (int j = 0; j < width; j++)
+                        AV_WN16(row + 2 * j, grey);
+                } else {
+                    memset(row, grey, width);
+                }
+            }
+        }
+    }
+}
+
 #undef POS
@@ -39,4 +39,21 @@ int ff_vvc_predict_inter(VVCLocalContext *lc, int rs);
  */
 void ff_vvc_predict_ciip(VVCLocalContext *lc);
 
+/**
+ * Conceal a CTU that failed to decode, with the colocated area of a reference
+ * picture of the same size, or with mid grey if there is none
+ * @param lc  local context for CTU
+ * @param ref the reference picture, may be NULL
+ * @param x0  luma x of the CTU
+ * @param y0  luma y of the CTU
+ */
+void ff_vvc_conceal_ctu(VVCLocalContext *lc, const VVCFrame *ref, int x0, int y0);
+
+/**
+ * Allocate the empty cache of the rescaled copy of a picture, which is set up
+ * by the first picture predicted from it with reference picture resampling.
+ * @return a RefStruct reference, NULL on allocation failure
+ */
+struct VVCRPRCache *ff_vvc_rpr_cache_alloc(void);
+
 #endif // AVCODEC_VVC_INTER_H
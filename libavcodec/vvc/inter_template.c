@@ -114,15 +114,15 @@ static void FUNC(put_uni_chroma_scaled)(uint8_t *_dst, const ptrdiff_t _dst_stri
 
 static void av_always_inline FUNC(put_uni_w_scaled)(uint8_t *_dst, const ptrdiff_t _dst_stride,
     const uint8_t *const _src, ptrdiff_t _src_stride, const int src_height,
-    const int _x, const int _y, const int dx, const int dy, const int denom, const int wx, const int _ox,
-    const int height, const int8_t *hf, const int8_t *vf, const int width, const int is_chroma)
+    const int _x, const int _y, const int dx, const int dy, const int height, const int denom, const int wx,
+    const int _ox, const int8_t *hf, const int8_t *vf, const int width, const int is_chroma)
 {
     int16_t tmp_array[TMP_STRIDE * MAX_PB_SIZE];
     int16_t *tmp                 = tmp_array;
     pixel *dst                   = (pixel*)_dst;
     const ptrdiff_t dst_stride   = _dst_stride / sizeof(pixel);
     const ptrdiff_t src_stride   = _src_stride / sizeof(pixel);
-    const int shift              = FFMAX(2, 14 - BIT_DEPTH);
+    const int shift              = denom + FFMAX(2, 14 - BIT_DEPTH);
     const int offset             = 1 << (shift - 1);
     const int ox                 = _ox * (1 << (BIT_DEPTH - 8));
     const int taps               = is_chroma ? VVC_INTER_CHROMA_TAPS : VVC_INTER_LUMA_TAPS;
@@ -165,22 +165,94 @@ static void av_always_inline FUNC(put_uni_w_scaled)(uint8_t *_dst, const ptrdiff
 
 static void FUNC(put_uni_luma_w_scaled)(uint8_t *_dst, const ptrdiff_t _dst_stride,
     const uint8_t *_src, ptrdiff_t _src_stride, const int src_height,
-    const int x, const int y, const int dx, const int dy, const int denom, const int wx, const int ox,
-    const int height, const int8_t *hf, const int8_t *vf, const int width)
+    const int x, const int y, const int dx, const int dy, const int height, const int denom, const int wx,
+    const int ox, const int8_t *hf, const int8_t *vf, const int width)
 {
-    FUNC(put_uni_w_scaled)(_dst, _dst_stride, _src, _src_stride, src_height, x, y, dx, dy, denom, wx, ox, height, hf, vf, width, 0);
+    FUNC(put_uni_w_scaled)(_dst, _dst_stride, _src, _src_stride, src_height, x, y, dx, dy, height, denom, wx, ox, hf, vf, width, 0);
 }
 
 static void FUNC(put_uni_chroma_w_scaled)(uint8_t *_dst, const ptrdiff_t _dst_stride,
     const uint8_t *_src, ptrdiff_t _src_stride, const int src_height,
-    const int x, const int y, const int dx, const int dy, const int denom, const int wx, const int ox,
-    const int height, const int8_t *hf, const int8_t *vf, const int width)
+    const int x, const int y, const int dx, const int dy, const int height, const int denom, const int wx,
+    const int ox, const int8_t *hf, const int8_t *vf, const int width)
 {
-    FUNC(put_uni_w_scaled)(_dst, _dst_stride, _src, _src_stride, src_height, x, y, dx, dy,  denom, wx, ox, height, hf, vf, width, 1);
+    FUNC(put_uni_w_scaled)(_dst, _dst_stride, _src, _src_stride, src_height, x, y, dx, dy, height, denom, wx, ox, hf, vf, width, 1);
 }
 
 #undef TMP_STRIDE
 
+// The prediction of src as put computes it, averaged with src0 as avg does
+static void av_always_inline FUNC(put_bi)(uint8_t *_dst, const ptrdiff_t _dst_stride,
+    const int16_t *src0, const uint8_t *_src, const ptrdiff_t _src_stride, const int height,
+    const int8_t *hf, const int8_t *vf, const int width, const int is_chroma, const int h, const int v)
+{
+    int16_t tmp_array[(MAX_PB_SIZE + LUMA_EXTRA) * MAX_PB_SIZE];
+    pixel *dst                  = (pixel *)_dst;
+    const pixel *src            = (const pixel *)_src;
+    const ptrdiff_t dst_stride  = _dst_stride / sizeof(pixel);
+    const ptrdiff_t src_stride  = _src_stride / sizeof(pixel);
+    const int extra_before      = is_chroma ? CHROMA_EXTRA_BEFORE : LUMA_EXTRA_BEFORE;
+    const int extra             = is_chroma ? CHROMA_EXTRA : LUMA_EXTRA;
+    const int shift             = FFMAX(3, 15 - BIT_DEPTH);
+    const int offset            = 1 << (shift - 1);
+    const int16_t *tmp          = tmp_array + extra_before * MAX_PB_SIZE;
+    const int8_t *filter;
+
+#define BI_FILTER(src, stride) (is_chroma ? CHROMA_FILTER(src, stride) : LUMA_FILTER(src, stride))
+    if (h && v) {
+        const pixel *s = src - extra_before * src_stride;
+        int16_t *t     = tmp_array;
+
+        filter = hf;
+        for (int y = 0; y < height + extra; y++) {
+            for (int x = 0; x < width; x++)
+                t[x] = BI_FILTER(s, 1) >> (BIT_DEPTH - 8);
+            s += src_stride;
+            t += MAX_PB_SIZE;
+        }
+    }
+
+    filter = v ? vf : hf;
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            int val;
+            if (h && v)
+                val = BI_FILTER(tmp, MAX_PB_SIZE) >> 6;
+            else if (v)
+                val = BI_FILTER(src, src_stride) >> (BIT_DEPTH - 8);
+            else if (h)
+                val = BI_FILTER(src, 1) >> (BIT_DEPTH - 8);
+            else
+                val = src[x] << (14 - BIT_DEPTH);
+            dst[x] = av_clip_pixel((src0[x] + val + offset) >> shift);
+        }
+        src  += src_stride;
+        tmp  += MAX_PB_SIZE;
+        src0 += MAX_PB_SIZE;
+        dst  += dst_stride;
+    }
+#undef BI_FILTER
+}
+
+#define PUT_BI(name, is_chroma, h, v)                                                              \
+static void FUNC(put_bi_##name)(uint8_t *dst, const ptrdiff_t dst_stride, const int16_t *src0,    \
+    const uint8_t *src, const ptrdiff_t src_stride, const int height,                              \
+    const int8_t *hf, const int8_t *vf, const int width)                                           \
+{                                                                                                  \
+    FUNC(put_bi)(dst, dst_stride, src0, src, src_stride, height, hf, vf, width, is_chroma, h, v);  \
+}
+
+PUT_BI(luma_pixels,   0, 0, 0)
+PUT_BI(luma_h,        0, 1, 0)
+PUT_BI(luma_v,        0, 0, 1)
+PUT_BI(luma_hv,       0, 1, 1)
+PUT_BI(chroma_pixels, 1, 0, 0)
+PUT_BI(chroma_h,      1, 1, 0)
+PUT_BI(chroma_v,      1, 0, 1)
+PUT_BI(chroma_hv,     1, 1, 1)
+
+#undef PUT_BI
+
 static void FUNC(avg)(uint8_t *_dst, const ptrdiff_t _dst_stride,
     const int16_t *src0, const int16_t *src1, const int width, const int height)
 {
@@ -198,6 +270,27 @@ static void FUNC(avg)(uint8_t *_dst, const ptrdiff_t _dst_stride,
     }
 }
 
+// avg of the put_pixels of both, the rounding offset of avg is one unit of their shift
+static void FUNC(avg_pixels)(uint8_t *_dst, const ptrdiff_t _dst_stride,
+    const uint8_t *_src0, const ptrdiff_t _src0_stride, const uint8_t *_src1, const ptrdiff_t _src1_stride,
+    const int width, const int height)
+{
+    pixel *dst                  = (pixel *)_dst;
+    const pixel *src0           = (const pixel *)_src0;
+    const pixel *src1           = (const pixel *)_src1;
+    const ptrdiff_t dst_stride  = _dst_stride / sizeof(pixel);
+    const ptrdiff_t src0_stride = _src0_stride / sizeof(pixel);
+    const ptrdiff_t src1_stride = _src1_stride / sizeof(pixel);
+
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++)
+            dst[x] = (src0[x] + src1[x] + 1) >> 1;
+        src0 += src0_stride;
+        src1 += src1_stride;
+        dst  += dst_stride;
+    }
+}
+
 static void FUNC(w_avg)(uint8_t *_dst, const ptrdiff_t _dst_stride,
     const int16_t *src0, const int16_t *src1, const int width, const int height,
     const int denom, const int w0, const int w1, const int o0, const int o1)
@@ -593,6 +686,10 @@ static void FUNC(dmvr_hv)(int16_t *dst, const uint8_t *_src, const ptrdiff_t _sr
         PEL_FUNC(put, C, 1, 0, put_##c##_v);                                    \
         PEL_FUNC(put, C, 1, 1, put_##c##_hv);                                   \
         DIR_FUNCS(uni, C, c);                                                   \
+        PEL_FUNC(put_bi, C, 0, 0, put_bi_##c##_pixels);                         \
+        PEL_FUNC(put_bi, C, 0, 1, put_bi_##c##_h);                              \
+        PEL_FUNC(put_bi, C, 1, 0, put_bi_##c##_v);                              \
+        PEL_FUNC(put_bi, C, 1, 1, put_bi_##c##_hv);                             \
 
 static void FUNC(ff_vvc_inter_dsp_init)(VVCInterDSPContext *const inter)
 {
@@ -609,6 +706,7 @@ static void FUNC(ff_vvc_inter_dsp_init)(VVCInterDSPContext *const inter)
     }
 
     inter->avg                  = FUNC(avg);
+    inter->avg_pixels           = FUNC(avg_pixels);
     inter->w_avg                = FUNC(w_avg);
 
     inter->dmvr[0][0]           = FUNC(dmvr);
@@ -627,6 +725,7 @@ static void FUNC(ff_vvc_inter_dsp_init)(VVCInterDSPContext *const inter)
     inter->apply_bdof           = FUNC(apply_bdof);
     inter->prof_grad_filter     = FUNC(prof_grad_filter);
     inter->sad                  = vvc_sad;
+    inter->sad_5x5              = vvc_sad_5x5;
 }
 
 #undef FUNCS
@@ -82,8 +82,8 @@ static void ilfnst_transform(const VVCLocalContext *lc, TransformBlock *tb)
         int yc = ff_vvc_diag_scan_y[2][2][x];
         u[x] = tb->coeffs[w * yc + xc];
     }
-    ff_vvc_inv_lfnst_1d(v, u, non_zero_size, n_lfnst_out_size, pred_mode_intra,
-                        cu->lfnst_idx, sps->log2_transform_range);
+    lc->fc->vvcdsp.itx.lfnst(v, u, non_zero_size, n_lfnst_out_size, pred_mode_intra,
+        cu->lfnst_idx, sps->log2_transform_range);
     if (transpose) {
         int *dst = tb->coeffs;
         const int *src = v;
@@ -186,24 +186,18 @@ static void add_residual_for_joint_coding_chroma(VVCLocalContext *lc,
     }
 }
 
-static int add_reconstructed_area(VVCLocalContext *lc, const int ch_type, const int x0, const int y0, const int w, const int h)
+static void add_reconstructed_area(VVCLocalContext *lc, const int ch_type, const int x0, const int y0, const int w, const int h)
 {
-    const VVCSPS *sps       = lc->fc->ps.sps;
-    const int hs = sps->hshift[ch_type];
-    const int vs = sps->vshift[ch_type];
-    ReconstructedArea *a;
-
-    if (lc->num_ras[ch_type] >= FF_ARRAY_ELEMS(lc->ras[ch_type]))
-        return AVERROR_INVALIDDATA;
-
-    a = &lc->ras[ch_type][lc->num_ras[ch_type]];
-    a->x = x0 >> hs;
-    a->y = y0 >> vs;
-    a->w = w >> hs;
-    a->h = h >> vs;
-    lc->num_ras[ch_type]++;
-
-    return 0;
+    const VVCSPS *sps = lc->fc->ps.sps;
+    const int hs      = sps->hshift[ch_type];
+    const int vs      = sps->vshift[ch_type];
+    const int x       = av_zero_extend(x0, sps->ctb_log2_size_y) >> hs;
+    const int y       = av_zero_extend(y0, sps->ctb_log2_size_y) >> vs;
+    uint8_t *right    = lc->recon_right[ch_type] + y;
+    uint8_t *bottom   = lc->recon_bottom[ch_type] + x;
+
+    memset(right,  x + (w >> hs), h >> vs);
+    memset(bottom, y + (h >> vs), w >> hs);
 }
 
 static void add_tu_area(const TransformUnit *tu, int *x0, int *y0, int *w, int *h)
@@ -214,7 +208,6 @@ static void add_tu_area(const TransformUnit *tu, int *x0, int *y0, int *w, int *
     *h = tu->height;
 }
 
-#define MIN_ISP_PRED_WIDTH 4
 static int get_luma_predict_unit(const CodingUnit *cu, const TransformUnit *tu, const int idx, int *x0, int *y0, int *w, int *h)
 {
     int has_luma = 1;
@@ -274,20 +267,6 @@ static void predict_intra(VVCLocalContext *lc, const TransformUnit *tu, const in
     }
 }
 
-static void scale_clip(int *coeff, const int nzw, const int w, const int h,
-    const int shift, const int log2_transform_range)
-{
-    const int add = 1 << (shift - 1);
-    for (int y = 0; y < h; y++) {
-        int *p = coeff + y * w;
-        for (int x = 0; x < nzw; x++) {
-            *p = av_clip_intp2((*p + add) >> shift, log2_transform_range);
-            p++;
-        }
-        memset(p, 0, sizeof(*p) * (w - nzw));
-    }
-}
-
 static void scale(int *out, const int *in, const int w, const int h, const int shift)
 {
     const int add = 1 << (shift - 1);
@@ -423,7 +402,8 @@ static av_always_inline int scale_coeff(const TransformBlock *tb, int coeff,
     return coeff;
 }
 
-static void dequant(const VVCLocalContext *lc, const TransformUnit *tu, TransformBlock *tb)
+// sparse: only the levels of the coefficient list are non-zero
+static void dequant(const VVCLocalContext *lc, const TransformUnit *tu, TransformBlock *tb, const int sparse)
 {
     uint8_t tmp[MAX_TB_SIZE * MAX_TB_SIZE];
     const H266RawSliceHeader *rsh   = lc->sc->sh.r;
@@ -434,6 +414,38 @@ static void dequant(const VVCLocalContext *lc, const TransformUnit *tu, Transfor
     derive_qp(lc, tu, tb);
     scale = derive_scale(tb, rsh->sh_dep_quant_used_flag);
 
+    // without a scaling list all the levels share one scale
+    if (scale_m == ff_vvc_default_scale_m) {
+        const int64_t flat_scale = (int64_t)scale * 16;
+
+        if (sparse) {
+            for (int i = 0; i < tb->nb_coeffs; i++) {
+                int *coeff = tb->coeffs + tb->coeff_pos[i];
+
+                *coeff = av_clip_intp2((*coeff * flat_scale + tb->bd_offset) >> tb->bd_shift, sps->log2_transform_range);
+            }
+        } else {
+            lc->fc->vvcdsp.itx.dequant_flat(tb->coeffs + tb->min_scan_y * tb->tb_width + tb->min_scan_x,
+                tb->tb_width, tb->max_scan_x - tb->min_scan_x + 1, tb->max_scan_y - tb->min_scan_y + 1,
+                flat_scale, tb->bd_shift, sps->log2_transform_range);
+        }
+        return;
+    }
+
+    if (sparse) {
+        // scale_m covers the bounding box of the levels
+        const int nzw = tb->max_scan_x - tb->min_scan_x + 1;
+
+        for (int i = 0; i < tb->nb_coeffs; i++) {
+            const int x = (tb->coeff_pos[i] & (tb->tb_width - 1)) - tb->min_scan_x;
+            const int y = (tb->coeff_pos[i] >> tb->log2_tb_width) - tb->min_scan_y;
+            int *coeff  = tb->coeffs + tb->coeff_pos[i];
+
+            *coeff = scale_coeff(tb, *coeff, scale, scale_m[y * nzw + x], sps->log2_transform_range);
+        }
+        return;
+    }
+
     for (int y = tb->min_scan_y; y <= tb->max_scan_y; y++) {
         for (int x = tb->min_scan_x; x <= tb->max_scan_x; x++) {
             int *coeff = tb->coeffs + y * tb->tb_width + x;
@@ -447,33 +459,44 @@ static void dequant(const VVCLocalContext *lc, const TransformUnit *tu, Transfor
 
 //transmatrix[0][0]
 #define DCT_A 64
-static void itx_2d(const VVCFrameContext *fc, TransformBlock *tb, const enum TxType trh, const enum TxType trv)
+// the first basis function of DCT2 is DCT_A for all sizes, so the transform of the DC level is flat
+static int itx_dc(const VVCFrameContext *fc, const TransformBlock *tb, const enum TxType trh, const enum TxType trv,
+    int *dc)
 {
     const VVCSPS *sps   = fc->ps.sps;
     const int w         = tb->tb_width;
     const int h         = tb->tb_height;
     const size_t nzw    = tb->max_scan_x + 1;
     const size_t nzh    = tb->max_scan_y + 1;
-    const int shift[]   = { 7, 5 + sps->log2_transform_range - sps->bit_depth };
 
-    if (w == h && nzw == 1 && nzh == 1 && trh == DCT2 && trv == DCT2) {
-        const int add[] = { 1 << (shift[0] - 1), 1 << (shift[1] - 1) };
-        const int t     = (tb->coeffs[0] * DCT_A + add[0]) >> shift[0];
-        const int dc    = (t * DCT_A + add[1]) >> shift[1];
+    if (w > 1 && h > 1) {
+        const int shift[] = { 7, 5 + sps->log2_transform_range - sps->bit_depth };
+        int t;
 
-        for (int i = 0; i < w * h; i++)
-            tb->coeffs[i] = dc;
+        if (nzw != 1 || nzh != 1 || trh != DCT2 || trv != DCT2)
+            return 0;
+        t   = (tb->coeffs[0] * DCT_A + (1 << (shift[0] - 1))) >> shift[0];
+        *dc = (t * DCT_A + (1 << (shift[1] - 1))) >> shift[1];
+    } else {
+        const int shift = 6 + sps->log2_transform_range - sps->bit_depth;
 
-        return;
+        if ((w == 1 || nzw != 1 || trh != DCT2) && (h == 1 || nzh != 1 || trv != DCT2))
+            return 0;
+        *dc = (tb->coeffs[0] * DCT_A + (1 << (shift - 1))) >> shift;
     }
 
-    for (int x = 0; x < nzw; x++)
-        fc->vvcdsp.itx.itx[trv][tb->log2_tb_height - 1](tb->coeffs + x, w, nzh);
-    scale_clip(tb->coeffs, nzw, w, h, shift[0], sps->log2_transform_range);
+    return 1;
+}
 
-    for (int y = 0; y < h; y++)
-        fc->vvcdsp.itx.itx[trh][tb->log2_tb_width - 1](tb->coeffs + y * w, 1, nzw);
-    scale(tb->coeffs, tb->coeffs, w, h, shift[1]);
+static void itx_2d(const VVCFrameContext *fc, TransformBlock *tb, const enum TxType trh, const enum TxType trv)
+{
+    const VVCSPS *sps   = fc->ps.sps;
+    const size_t nzw    = tb->max_scan_x + 1;
+    const size_t nzh    = tb->max_scan_y + 1;
+    const int shift     = 5 + sps->log2_transform_range - sps->bit_depth;
+
+    fc->vvcdsp.itx.itx_2d(tb->coeffs, tb->log2_tb_width, tb->log2_tb_height, trh, trv,
+        nzw, nzh, shift, sps->log2_transform_range);
 }
 
 static void itx_1d(const VVCFrameContext *fc, TransformBlock *tb, const enum TxType trh, const enum TxType trv)
@@ -484,17 +507,6 @@ static void itx_1d(const VVCFrameContext *fc, TransformBlock *tb, const enum TxT
     const size_t nzw    = tb->max_scan_x + 1;
     const size_t nzh    = tb->max_scan_y + 1;
 
-    if ((w > 1 && nzw == 1 && trh == DCT2) || (h > 1 && nzh == 1 && trv == DCT2)) {
-        const int shift = 6 + sps->log2_transform_range - sps->bit_depth;
-        const int add   = 1 << (shift - 1);
-        const int dc    = (tb->coeffs[0] * DCT_A + add) >> shift;
-
-        for (int i = 0; i < w * h; i++)
-            tb->coeffs[i] = dc;
-
-        return;
-    }
-
     if (w > 1)
         fc->vvcdsp.itx.itx[trh][tb->log2_tb_width - 1](tb->coeffs, 1, nzw);
     else
@@ -502,6 +514,15 @@ static void itx_1d(const VVCFrameContext *fc, TransformBlock *tb, const enum TxT
     scale(tb->coeffs, tb->coeffs, w, h, 6 + sps->log2_transform_range - sps->bit_depth);
 }
 
+static int is_zero_residual(const TransformBlock *tb)
+{
+    for (int i = 0; i < tb->nb_coeffs; i++) {
+        if (tb->coeffs[tb->coeff_pos[i]])
+            return 0;
+    }
+    return 1;
+}
+
 static void transform_bdpcm(TransformBlock *tb, const VVCLocalContext *lc, const CodingUnit *cu)
 {
     const VVCSPS *sps        = lc->fc->ps.sps;
@@ -515,6 +536,25 @@ static void transform_bdpcm(TransformBlock *tb, const VVCLocalContext *lc, const
         tb->max_scan_x = tb->tb_width - 1;
 }
 
+// The vertical luma partitions narrower than MIN_ISP_PRED_WIDTH share one prediction, from the
+// samples around all of them, so their residuals are gathered and added to it in one call.
+static int isp_group_size(const CodingUnit *cu, const TransformUnit *tu, const int ch_type)
+{
+    if (cu->isp_split_type != ISP_VER_SPLIT || ch_type != LUMA || tu->width >= MIN_ISP_PRED_WIDTH)
+        return 0;
+    return MIN_ISP_PRED_WIDTH / tu->width;
+}
+
+static void isp_add_residual(VVCLocalContext *lc, const TransformUnit *tu, const int part)
+{
+    const VVCFrameContext *fc = lc->fc;
+    const ptrdiff_t stride    = fc->frame->linesize[LUMA];
+    const int x0              = tu->x0 - part * tu->width;
+    uint8_t *dst              = &fc->frame->data[LUMA][tu->y0 * stride + (x0 << fc->ps.sps->pixel_shift)];
+
+    fc->vvcdsp.itx.add_residual_isp[av_log2(tu->width)](dst, lc->isp_residual, tu->height, stride);
+}
+
 static void itransform(VVCLocalContext *lc, TransformUnit *tu, const int tu_idx, const int target_ch_type)
 {
     const VVCFrameContext *fc   = lc->fc;
@@ -522,7 +562,17 @@ static void itransform(VVCLocalContext *lc, TransformUnit *tu, const int tu_idx,
     const VVCSH *sh             = &lc->sc->sh;
     const CodingUnit *cu        = lc->cu;
     const int ps                = fc->ps.sps->pixel_shift;
+    const int isp_group         = isp_group_size(cu, tu, target_ch_type);
+    const int isp_part          = isp_group ? tu_idx % isp_group : 0;
+    int *isp_res                = lc->isp_residual + isp_part * tu->width * tu->height;
     DECLARE_ALIGNED(32, int, temp)[MAX_TB_SIZE * MAX_TB_SIZE];
+    DECLARE_ALIGNED(32, int, coeffs)[MAX_TB_SIZE * MAX_TB_SIZE];
+
+    if (fc->skip_idct)
+        return;
+
+    if (isp_group && !isp_part)
+        lc->isp_coded = 0;
 
     for (int i = 0; i < tu->nb_tbs; i++) {
         TransformBlock *tb  = &tu->tbs[i];
@@ -536,23 +586,61 @@ static void itransform(VVCLocalContext *lc, TransformUnit *tu, const int tu_idx,
             const ptrdiff_t stride  = fc->frame->linesize[c_idx];
             const int hs            = sps->hshift[c_idx];
             const int vs            = sps->vshift[c_idx];
+            const int sparse        = tb->nb_coeffs <= MAX_SPARSE_COEFFS && !cu->bdpcm_flag[c_idx];
+            const int grouped       = isp_group && !ch_type;
             uint8_t *dst            = &fc->frame->data[c_idx][(tb->y0 >> vs) * stride + ((tb->x0 >> hs) << ps)];
 
+            // the partitions without residual add zeros to the shared prediction
+            if (grouped && !lc->isp_coded) {
+                memset(lc->isp_residual, 0, MIN_ISP_PRED_WIDTH * tu->height * sizeof(*lc->isp_residual));
+                lc->isp_coded = 1;
+            }
+
+            // the reconstruction works in place on 32 bits
+            if (tb->coeffs16) {
+                tb->coeffs = grouped ? isp_res : coeffs;
+                if (tb->nb_coeffs <= MAX_SPARSE_COEFFS) {
+                    memset(tb->coeffs, 0, w * h * sizeof(*tb->coeffs));
+                    for (int j = 0; j < tb->nb_coeffs; j++)
+                        tb->coeffs[tb->coeff_pos[j]] = tb->coeff_level[j];
+                } else {
+                    for (int j = 0; j < w * h; j++)
+                        tb->coeffs[j] = tb->coeffs16[j];
+                }
+            }
+
             if (cu->bdpcm_flag[tb->c_idx])
                 transform_bdpcm(tb, lc, cu);
-            dequant(lc, tu, tb);
+            dequant(lc, tu, tb, sparse);
+            // the levels may all scale to zero, and the joint chroma residual is then zero too
+            if (sparse && is_zero_residual(tb))
+                continue;
             if (!tb->ts) {
                 enum TxType trh, trv;
+                int dc;
 
                 if (cu->apply_lfnst_flag[c_idx])
                     ilfnst_transform(lc, tb);
                 derive_transform_type(fc, lc, tb, &trh, &trv);
-                if (w > 1 && h > 1)
+                if (itx_dc(fc, tb, trh, trv, &dc)) {
+                    if (!chroma_scale && !(tu->joint_cbcr_residual_flag && c_idx) && !grouped) {
+                        fc->vvcdsp.itx.add_residual_dc(dst, dc, w, h, stride);
+                        continue;
+                    }
+                    for (int j = 0; j < w * h; j++)
+                        tb->coeffs[j] = dc;
+                } else if (w > 1 && h > 1) {
                     itx_2d(fc, tb, trh, trv);
-                else
+                } else {
                     itx_1d(fc, tb, trh, trv);
+                }
             }
 
+            if (grouped) {
+                if (tb->coeffs != isp_res)
+                    memcpy(isp_res, tb->coeffs, w * h * sizeof(*isp_res));
+                continue;
+            }
             if (chroma_scale)
                 fc->vvcdsp.intra.lmcs_scale_chroma(lc, temp, tb->coeffs, w, h, cu->x0, cu->y0);
             // TODO: Address performance issue here by combining transform, lmcs_scale_chroma, and add_residual into one function.
@@ -563,20 +651,53 @@ static void itransform(VVCLocalContext *lc, TransformUnit *tu, const int tu_idx,
                 add_residual_for_joint_coding_chroma(lc, tu, tb, chroma_scale);
         }
     }
+
+    if (isp_group && isp_part == isp_group - 1 && lc->isp_coded)
+        isp_add_residual(lc, tu, isp_part);
+}
+
+// An inter CU without CIIP only adds its residual to its own prediction, unless its chroma residual
+// is scaled by the luma around it, so it is reconstructed in the inter stage, off the wavefront of
+// the reconstruction stage.
+static int is_inter_stage_recon(const VVCLocalContext *lc, const CodingUnit *cu, const int ch_type)
+{
+    const VVCFrameContext *fc = lc->fc;
+
+    if (!cu->coded_flag || cu->ciip_flag || (cu->pred_mode != MODE_INTER && cu->pred_mode != MODE_SKIP))
+        return 0;
+    return ch_type == LUMA || !(lc->sc->sh.r->sh_lmcs_used_flag && fc->ps.ph.r->ph_chroma_residual_scale_flag);
+}
+
+void ff_vvc_reconstruct_inter(VVCLocalContext *lc)
+{
+    const VVCFrameContext *fc = lc->fc;
+    CodingUnit *cu            = lc->cu;
+    const int end             = fc->ps.sps->r->sps_chroma_format_idc && !fc->gray ? CHROMA : LUMA;
+
+    for (int ch_type = LUMA; ch_type <= end; ch_type++) {
+        if (is_inter_stage_recon(lc, cu, ch_type)) {
+            TransformUnit *tu = cu->tus.head;
+            for (int i = 0; tu; i++) {
+                itransform(lc, tu, i, ch_type);
+                tu = tu->next;
+            }
+        }
+    }
 }
 
-static int reconstruct(VVCLocalContext *lc)
+static int reconstruct(VVCLocalContext *lc, const int first, const int last)
 {
     VVCFrameContext *fc = lc->fc;
     CodingUnit *cu      = lc->cu;
-    const int start     = cu->tree_type == DUAL_TREE_CHROMA;
-    const int end       = fc->ps.sps->r->sps_chroma_format_idc && (cu->tree_type != DUAL_TREE_LUMA);
+    const int start     = FFMAX(first, cu->tree_type == DUAL_TREE_CHROMA);
+    const int end       = FFMIN(last, fc->ps.sps->r->sps_chroma_format_idc && !fc->gray && (cu->tree_type != DUAL_TREE_LUMA));
 
     for (int ch_type = start; ch_type <= end; ch_type++) {
         TransformUnit *tu = cu->tus.head;
         for (int i = 0; tu; i++) {
             predict_intra(lc, tu, i, ch_type);
-            itransform(lc, tu, i, ch_type);
+            if (!is_inter_stage_recon(lc, cu, ch_type))
+                itransform(lc, tu, i, ch_type);
             tu = tu->next;
         }
     }
@@ -593,26 +714,22 @@ static int reconstruct(VVCLocalContext *lc)
 #define IBC_X(x)  ((x) & ((fc->tab.sz.ibc_buffer_width >> hs) - 1))
 #define IBC_Y(y)  ((y) & ((1 << sps->ctb_log2_size_y >> vs) - 1))
 
-static void intra_block_copy(const VVCLocalContext *lc, const int c_idx)
+static void ibc_copy_vir_buf(const VVCLocalContext *lc, uint8_t *dst, const int c_idx,
+    const int x, const int y, const int w, const int h)
 {
     const CodingUnit *cu      = lc->cu;
-    const PredictionUnit *pu  = &cu->pu;
     const VVCFrameContext *fc = lc->fc;
     const VVCSPS *sps         = fc->ps.sps;
-    const Mv *bv              = &pu->mi.mv[L0][0];
     const int hs              = sps->hshift[c_idx];
     const int vs              = sps->vshift[c_idx];
     const int ps              = sps->pixel_shift;
-    const int ref_x           = IBC_X((cu->x0 >> hs) + (bv->x >> (4 + hs)));
-    const int ref_y           = IBC_Y((cu->y0 >> vs) + (bv->y >> (4 + vs)));
-    const int w               = cu->cb_width >> hs;
-    const int h               = cu->cb_height >> vs;
+    const int ref_x           = IBC_X(x);
+    const int ref_y           = IBC_Y(y);
     const int ibc_buf_width   = fc->tab.sz.ibc_buffer_width >> hs;    ///< IbcBufWidthY and IbcBufWidthC
     const int rw              = FFMIN(w, ibc_buf_width - ref_x);
     const int ibc_stride      = ibc_buf_width << ps;
     const int dst_stride      = fc->frame->linesize[c_idx];
     const uint8_t *ibc_buf    = IBC_POS(c_idx, ref_x, ref_y);
-    uint8_t *dst              = POS(c_idx, cu->x0, cu->y0);
 
     av_image_copy_plane(dst, dst_stride, ibc_buf, ibc_stride, rw << ps, h);
 
@@ -624,41 +741,79 @@ static void intra_block_copy(const VVCLocalContext *lc, const int c_idx)
     }
 }
 
-static void vvc_predict_ibc(const VVCLocalContext *lc)
+// The current ctu is only copied to the virtual buffer once it is reconstructed, so references
+// into it are read from the frame, and only those into the ctus left of it from the buffer.
+static void intra_block_copy(const VVCLocalContext *lc, const int c_idx)
+{
+    const CodingUnit *cu      = lc->cu;
+    const PredictionUnit *pu  = &cu->pu;
+    const VVCFrameContext *fc = lc->fc;
+    const VVCSPS *sps         = fc->ps.sps;
+    const VVCPPS *pps         = fc->ps.pps;
+    const Mv *bv              = &pu->mi.mv[L0][0];
+    const int hs              = sps->hshift[c_idx];
+    const int vs              = sps->vshift[c_idx];
+    const int ps              = sps->pixel_shift;
+    const int ctb_mask        = ~(sps->ctb_size_y - 1);
+    const int ctb_x           = (cu->x0 & ctb_mask) >> hs;
+    const int ctb_y           = (cu->y0 & ctb_mask) >> vs;
+    const int ctb_r           = FFMIN((cu->x0 & ctb_mask) + sps->ctb_size_y, pps->width)  >> hs;
+    const int ctb_b           = FFMIN((cu->y0 & ctb_mask) + sps->ctb_size_y, pps->height) >> vs;
+    const int x               = (cu->x0 >> hs) + (bv->x >> (4 + hs));
+    const int y               = (cu->y0 >> vs) + (bv->y >> (4 + vs));
+    const int w               = cu->cb_width >> hs;
+    const int h               = cu->cb_height >> vs;
+    const int dst_stride      = fc->frame->linesize[c_idx];
+    uint8_t *dst              = POS(c_idx, cu->x0, cu->y0);
+    const int in_ctb          = y >= ctb_y && y + h <= ctb_b && x + w > ctb_x && x + w <= ctb_r;
+    const int lw              = in_ctb ? av_clip(ctb_x - x, 0, w) : w;
+
+    if (lw)
+        ibc_copy_vir_buf(lc, dst, c_idx, x, y, lw, h);
+    if (w > lw) {
+        const uint8_t *src = fc->frame->data[c_idx] + y * dst_stride + ((x + lw) << ps);
+        av_image_copy_plane(dst + (lw << ps), dst_stride, src, dst_stride, (w - lw) << ps, h);
+    }
+}
+
+static void vvc_predict_ibc(const VVCLocalContext *lc, const int start, const int end)
 {
     const H266RawSPS *rsps = lc->fc->ps.sps->r;
 
-    intra_block_copy(lc, LUMA);
-    if (lc->cu->tree_type == SINGLE_TREE && rsps->sps_chroma_format_idc) {
+    if (start == LUMA)
+        intra_block_copy(lc, LUMA);
+    if (end == CHROMA && lc->cu->tree_type == SINGLE_TREE && rsps->sps_chroma_format_idc && !lc->fc->gray) {
         intra_block_copy(lc, CB);
         intra_block_copy(lc, CR);
     }
 }
 
-static void ibc_fill_vir_buf(const VVCLocalContext *lc, const CodingUnit *cu)
+static void ibc_fill_vir_buf(const VVCLocalContext *lc, const int x0, const int y0,
+    const int start, const int end)
 {
     const VVCFrameContext *fc = lc->fc;
     const VVCSPS *sps         = fc->ps.sps;
-    const int has_chroma      = sps->r->sps_chroma_format_idc && cu->tree_type != DUAL_TREE_LUMA;
-    const int start           = cu->tree_type == DUAL_TREE_CHROMA;
-    const int end             = has_chroma ? CR : LUMA;
+    const VVCPPS *pps         = fc->ps.pps;
+    const int first           = start == LUMA ? LUMA : CB;
+    const int last            = end == CHROMA && sps->r->sps_chroma_format_idc && !fc->gray ? CR : LUMA;
+    const int width           = FFMIN(sps->ctb_size_y, pps->width  - x0);
+    const int height          = FFMIN(sps->ctb_size_y, pps->height - y0);
 
-    for (int c_idx = start; c_idx <= end; c_idx++) {
+    for (int c_idx = first; c_idx <= last; c_idx++) {
         const int hs = sps->hshift[c_idx];
         const int vs = sps->vshift[c_idx];
         const int ps = sps->pixel_shift;
-        const int x  = IBC_X(cu->x0 >> hs);
-        const int y  = IBC_Y(cu->y0 >> vs);
         const int src_stride = fc->frame->linesize[c_idx];
         const int ibc_stride = fc->tab.sz.ibc_buffer_width >> hs << ps;
-        const uint8_t *src   = POS(c_idx, cu->x0, cu->y0);
-        uint8_t *ibc_buf     = IBC_POS(c_idx, x, y);
+        const uint8_t *src   = POS(c_idx, x0, y0);
+        uint8_t *ibc_buf     = fc->tab.ibc_vir_buf[c_idx] + (IBC_X(x0 >> hs) << ps) + (y0 >> vs) * ibc_stride;
 
-        av_image_copy_plane(ibc_buf, ibc_stride, src, src_stride, cu->cb_width >> hs << ps , cu->cb_height >> vs);
+        av_image_copy_plane(ibc_buf, ibc_stride, src, src_stride, width >> hs << ps, height >> vs);
     }
 }
 
-int ff_vvc_reconstruct(VVCLocalContext *lc, const int rs, const int rx, const int ry)
+int ff_vvc_reconstruct(VVCLocalContext *lc, const int rs, const int rx, const int ry,
+    const int start, const int end)
 {
     const VVCFrameContext *fc   = lc->fc;
     const VVCSPS *sps           = fc->ps.sps;
@@ -668,30 +823,33 @@ int ff_vvc_reconstruct(VVCLocalContext *lc, const int rs, const int rx, const in
     CodingUnit *cu              = ctu->cus;
     int ret                     = 0;
 
-    lc->num_ras[0] = lc->num_ras[1] = 0;
+    memset(lc->recon_right,  0, sizeof(lc->recon_right));
+    memset(lc->recon_bottom, 0, sizeof(lc->recon_bottom));
     lc->lmcs.x_vpdu = -1;
     lc->lmcs.y_vpdu = -1;
-    ff_vvc_decode_neighbour(lc, x_ctb, y_ctb, rx, ry, rs);
+    ff_vvc_load_neighbour(lc, rs);
     while (cu) {
         lc->cu = cu;
 
-        if (cu->ciip_flag)
+        // the inter cus, with both channel types predicted together, are never split
+        if (cu->ciip_flag && start == LUMA)
             ff_vvc_predict_ciip(lc);
         else if (cu->pred_mode == MODE_IBC)
-            vvc_predict_ibc(lc);
+            vvc_predict_ibc(lc, start, end);
         if (cu->coded_flag) {
-            ret = reconstruct(lc);
+            ret = reconstruct(lc, start, end);
         } else {
-            if (cu->tree_type != DUAL_TREE_CHROMA)
+            if (start == LUMA && cu->tree_type != DUAL_TREE_CHROMA)
                 add_reconstructed_area(lc, LUMA, cu->x0, cu->y0, cu->cb_width, cu->cb_height);
-            if (sps->r->sps_chroma_format_idc && cu->tree_type != DUAL_TREE_LUMA)
+            if (end == CHROMA && sps->r->sps_chroma_format_idc && !fc->gray && cu->tree_type != DUAL_TREE_LUMA)
                 add_reconstructed_area(lc, CHROMA, cu->x0, cu->y0, cu->cb_width, cu->cb_height);
         }
-        if (sps->r->sps_ibc_enabled_flag)
-            ibc_fill_vir_buf(lc, cu);
         cu = cu->next;
     }
-    ff_vvc_ctu_free_cus(ctu);
+
+    // the ctus of the next row do not reference this one, so the last ctu of a row is not needed
+    if (sps->r->sps_ibc_enabled_flag && x_ctb + sps->ctb_size_y < fc->ps.pps->width)
+        ibc_fill_vir_buf(lc, x_ctb, y_ctb, start, end);
     return ret;
 }
 
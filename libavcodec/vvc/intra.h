@@ -30,9 +30,20 @@
  * @param rs raster order for the CTU.
  * @param rx raster order x for the CTU.
  * @param ry raster order y for the CTU.
+ * @param start first channel type to reconstruct, LUMA or CHROMA.
+ * @param end last channel type to reconstruct; the chroma CUs of a dual tree only
+ *            read the luma, so they can be reconstructed on their own, after it.
  * @return AVERROR
  */
-int ff_vvc_reconstruct(VVCLocalContext *lc, const int rs, const int rx, const int ry);
+int ff_vvc_reconstruct(VVCLocalContext *lc, const int rs, const int rx, const int ry,
+    const int start, const int end);
+
+/**
+ * add the residual of an inter CU to its prediction, for the channel types that
+ * do not depend on the reconstruction around the CU
+ * @param lc local context for CTU, with the CU in lc->cu
+ */
+void ff_vvc_reconstruct_inter(VVCLocalContext *lc);
 
 //utils for vvc_intra_template
 int ff_vvc_get_top_available(const VVCLocalContext *lc, int x0, int y0, int target_size, int c_idx);
@@ -75,35 +75,17 @@ int ff_vvc_need_pdpc(const int w, const int h, const uint8_t bdpcm_flag, const i
     return 0;
 }
 
-static const ReconstructedArea* get_reconstructed_area(const VVCLocalContext *lc, const int x, const int y, const int c_idx)
-{
-    const int ch_type = c_idx > 0;
-    for (int i = lc->num_ras[ch_type] - 1; i >= 0; i--) {
-        const ReconstructedArea* a = &lc->ras[ch_type][i];
-        const int r = (a->x + a->w);
-        const int b = (a->y + a->h);
-        if (a->x <= x && x < r && a->y <= y && y < b)
-            return a;
-
-        //it's too far away, no need check it;
-        if (x >= r && y >= b)
-            break;
-    }
-    return NULL;
-}
-
 int ff_vvc_get_top_available(const VVCLocalContext *lc, const int x, const int y, int target_size, const int c_idx)
 {
     const VVCFrameContext *fc = lc->fc;
     const VVCSPS *sps = fc->ps.sps;
     const int hs = sps->hshift[c_idx];
     const int vs = sps->vshift[c_idx];
+    const int log2_ctb_size_h   = sps->ctb_log2_size_y - hs;
     const int log2_ctb_size_v   = sps->ctb_log2_size_y - vs;
     const int end_of_ctb_x      = ((lc->cu->x0 >> sps->ctb_log2_size_y) + 1) << sps->ctb_log2_size_y;
     const int y0b               = av_zero_extend(y, log2_ctb_size_v);
     const int max_x             = FFMIN(fc->ps.pps->width, end_of_ctb_x) >> hs;
-    const ReconstructedArea *a;
-    int px = x;
 
     if (!y0b) {
         if (!lc->ctb_up_flag)
@@ -115,12 +97,7 @@ int ff_vvc_get_top_available(const VVCLocalContext *lc, const int x, const int y
     }
 
     target_size = FFMAX(0, FFMIN(target_size, max_x - x));
-    while (target_size > 0 && (a = get_reconstructed_area(lc, px, y - 1, c_idx))) {
-        const int sz = FFMIN(target_size, a->x + a->w - px);
-        px += sz;
-        target_size -= sz;
-    }
-    return px - x;
+    return av_clip(lc->recon_right[c_idx > 0][y0b - 1] - av_zero_extend(x, log2_ctb_size_h), 0, target_size);
 }
 
 int ff_vvc_get_left_available(const VVCLocalContext *lc, const int x, const int y, int target_size, const int c_idx)
@@ -130,11 +107,10 @@ int ff_vvc_get_left_available(const VVCLocalContext *lc, const int x, const int
     const int hs = sps->hshift[c_idx];
     const int vs = sps->vshift[c_idx];
     const int log2_ctb_size_h   =  sps->ctb_log2_size_y - hs;
+    const int log2_ctb_size_v   =  sps->ctb_log2_size_y - vs;
     const int x0b               = av_zero_extend(x, log2_ctb_size_h);
     const int end_of_ctb_y      = ((lc->cu->y0 >> sps->ctb_log2_size_y) + 1) << sps->ctb_log2_size_y;
     const int max_y             = FFMIN(fc->ps.pps->height, end_of_ctb_y) >> vs;
-    const ReconstructedArea *a;
-    int  py = y;
 
     if (!x0b && !lc->ctb_left_flag)
         return 0;
@@ -143,23 +119,17 @@ int ff_vvc_get_left_available(const VVCLocalContext *lc, const int x, const int
     if (!x0b)
         return target_size;
 
-    while (target_size > 0 && (a = get_reconstructed_area(lc, x - 1, py, c_idx))) {
-        const int sz = FFMIN(target_size, a->y + a->h - py);
-        py += sz;
-        target_size -= sz;
-    }
-    return py - y;
-}
-
-static int less(const void *a, const void *b)
-{
-    return *(const int*)a - *(const int*)b;
+    return av_clip(lc->recon_bottom[c_idx > 0][x0b - 1] - av_zero_extend(y, log2_ctb_size_v), 0, target_size);
 }
 
 int ff_vvc_ref_filter_flag_derive(const int mode)
 {
-    static const int modes[] = { -14, -12, -10, -6, INTRA_PLANAR, 2, 34, 66, 72, 76, 78, 80};
-    return bsearch(&mode, modes, FF_ARRAY_ELEMS(modes), sizeof(int), less) != NULL;
+    switch (mode) {
+    case -14: case -12: case -10: case -6: case INTRA_PLANAR:
+    case 2: case 34: case 66: case 72: case 76: case 78: case 80:
+        return 1;
+    }
+    return 0;
 }
 
 int ff_vvc_intra_pred_angle_derive(const int pred_mode)
@@ -184,13 +154,15 @@ int ff_vvc_intra_pred_angle_derive(const int pred_mode)
     return intra_pred_angle;
 }
 
-#define ROUND(f) (int)(f < 0 ? -(-f + 0.5) : (f + 0.5))
+// 32 * 512 / intra_pred_angle, rounded half away from zero
 int ff_vvc_intra_inv_angle_derive(const int intra_pred_angle)
 {
-    float inv_angle;
+    const int angle = FFABS(intra_pred_angle);
+    int inv_angle;
+
     av_assert0(intra_pred_angle);
-    inv_angle = 32 * 512.0 / intra_pred_angle;
-    return ROUND(inv_angle);
+    inv_angle = (32 * 512 + (angle >> 1)) / angle;
+    return intra_pred_angle < 0 ? -inv_angle : inv_angle;
 }
 
 //8.4.5.2.7 Wide angle intra prediction mode mapping proces
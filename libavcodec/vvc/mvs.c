@@ -20,6 +20,8 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include "libavcodec/mathops.h"
+
 #include "ctu.h"
 #include "data.h"
 #include "refs.h"
@@ -74,7 +76,7 @@ void ff_vvc_mv_scale(Mv *dst, const Mv *src, int td, int tb)
 
     td = av_clip_int8(td);
     tb = av_clip_int8(tb);
-    tx = (0x4000 + (abs(td) >> 1)) / td;
+    tx = ff_vvc_mv_scale_tx[td + 128];
     scale_factor = av_clip_intp2((tb * tx + 32) >> 6, 12);
     dst->x = av_clip_intp2((scale_factor * src->x + 127 +
                            (scale_factor * src->x < 0)) >> 8, 17);
@@ -82,15 +84,78 @@ void ff_vvc_mv_scale(Mv *dst, const Mv *src, int td, int tb)
                            (scale_factor * src->y < 0)) >> 8, 17);
 }
 
+#define COL_MV_VALID    1
+#define COL_MV_LT       2
+#define COL_MV_TD(c)    ((int8_t)((c) >> 2))
+#define COL_MV_X(c)     col_mv_unpack((c) >> 10)
+#define COL_MV_Y(c)     col_mv_unpack((c) >> 21)
+
+// a compressed motion vector component is a 7-bit mantissa shifted by up to 12
+static uint32_t col_mv_pack(int mv)
+{
+    int exp = 0;
+
+    while (mv < -64 || mv > 63) {
+        mv >>= 1;
+        exp++;
+    }
+    return (mv & 0x7f) << 4 | exp;
+}
+
+static av_always_inline int col_mv_unpack(const uint32_t c)
+{
+    return sign_extend(c >> 4, 7) * (1 << (c & 0xf));
+}
+
+// the predFlagLXCol, motion and reference of list lx of a block, POC distances clipped as ff_vvc_mv_scale() does
+static uint32_t col_mvf_pack(const MvField *mvf, const int lx, const RefPicList *rpl, const int poc)
+{
+    const VVCRefPic *ref = rpl[lx].refs + mvf->ref_idx[lx];
+    Mv mv                = mvf->mv[lx];
+
+    if (mvf->pred_flag & ~PF_BI || !(mvf->pred_flag & (1 << lx)))
+        return 0;
+
+    mv_compression(&mv);
+    return col_mv_pack(mv.y) << 21 | col_mv_pack(mv.x) << 10 |
+        (uint8_t)av_clip_int8(poc - ref->poc) << 2 | ref->is_lt * COL_MV_LT | COL_MV_VALID;
+}
+
+void ff_vvc_store_col_mvf(const VVCFrameContext *fc, const int rx, const int ry)
+{
+    const VVCSPS *sps       = fc->ps.sps;
+    const VVCPPS *pps       = fc->ps.pps;
+    const VVCFrame *cur     = fc->ref;
+    const int ctb_log2_size = sps->ctb_log2_size_y;
+    const int x0            = rx << ctb_log2_size;
+    const int y0            = ry << ctb_log2_size;
+    const int x_end         = FFMIN(x0 + (1 << ctb_log2_size), pps->width);
+    const int y_end         = FFMIN(y0 + (1 << ctb_log2_size), pps->height);
+    const int col_width     = AV_CEIL_RSHIFT(pps->width, COL_MV_LOG2);
+    const RefPicList *rpl   = cur->rpl_tab[ry * pps->ctb_width + rx]->refPicList;
+
+    for (int y = y0; y < y_end; y += 1 << COL_MV_LOG2) {
+        const MvField *mvf = cur->tab_dmvr_mvf + (y >> MIN_PU_LOG2) * pps->min_pu_width;
+        ColMvField *col    = cur->tab_col_mvf + (y >> COL_MV_LOG2) * col_width;
+
+        for (int x = x0; x < x_end; x += 1 << COL_MV_LOG2) {
+            const MvField *m = mvf + (x >> MIN_PU_LOG2);
+            ColMvField *c    = col + (x >> COL_MV_LOG2);
+
+            c->lx[L0] = col_mvf_pack(m, L0, rpl, cur->poc);
+            c->lx[L1] = col_mvf_pack(m, L1, rpl, cur->poc);
+        }
+    }
+}
+
 //part of 8.5.2.12 Derivation process for collocated motion vectors
-static int check_mvset(Mv *mvLXCol, Mv *mvCol,
-                       int colPic, int poc,
-                       const RefPicList *refPicList, int X, int refIdxLx,
-                       const RefPicList *refPicList_col, int listCol, int refidxCol)
+static int check_mvset(Mv *mvLXCol, const uint32_t col,
+                       int poc, const RefPicList *refPicList, int X, int refIdxLx)
 {
     int cur_lt = refPicList[X].refs[refIdxLx].is_lt;
-    int col_lt = refPicList_col[listCol].refs[refidxCol].is_lt;
+    int col_lt = !!(col & COL_MV_LT);
     int col_poc_diff, cur_poc_diff;
+    Mv mvCol;
 
     if (cur_lt != col_lt) {
         mvLXCol->x = 0;
@@ -98,24 +163,24 @@ static int check_mvset(Mv *mvLXCol, Mv *mvCol,
         return 0;
     }
 
-    col_poc_diff = colPic - refPicList_col[listCol].refs[refidxCol].poc;
-    cur_poc_diff = poc    - refPicList[X].refs[refIdxLx].poc;
+    // the clipped col_poc_diff compares as the exact one would, at the clip values td == tb scales by 1
+    col_poc_diff = COL_MV_TD(col);
+    cur_poc_diff = poc - refPicList[X].refs[refIdxLx].poc;
 
-    mv_compression(mvCol);
+    mvCol.x = COL_MV_X(col);
+    mvCol.y = COL_MV_Y(col);
     if (cur_lt || col_poc_diff == cur_poc_diff) {
-        mvLXCol->x = av_clip_intp2(mvCol->x, 17);
-        mvLXCol->y = av_clip_intp2(mvCol->y, 17);
+        mvLXCol->x = av_clip_intp2(mvCol.x, 17);
+        mvLXCol->y = av_clip_intp2(mvCol.y, 17);
     } else {
-        ff_vvc_mv_scale(mvLXCol, mvCol, col_poc_diff, cur_poc_diff);
+        ff_vvc_mv_scale(mvLXCol, &mvCol, col_poc_diff, cur_poc_diff);
     }
     return 1;
 }
 
 #define CHECK_MVSET(l)                                          \
-    check_mvset(mvLXCol, temp_col.mv + l,                       \
-                colPic, fc->ps.ph.poc,                          \
-                refPicList, X, refIdxLx,                        \
-                refPicList_col, L ## l, temp_col.ref_idx[l])
+    check_mvset(mvLXCol, temp_col.lx[l], fc->ps.ph.poc,         \
+                refPicList, X, refIdxLx)
 
 //derive NoBackwardPredFlag
 int ff_vvc_no_backward_pred_flag(const VVCLocalContext *lc)
@@ -136,35 +201,35 @@ int ff_vvc_no_backward_pred_flag(const VVCLocalContext *lc)
 }
 
 //8.5.2.12 Derivation process for collocated motion vectors
-static int derive_temporal_colocated_mvs(const VVCLocalContext *lc, MvField temp_col,
-                                         int refIdxLx, Mv *mvLXCol, int X,
-                                         int colPic, const RefPicList *refPicList_col, int sb_flag)
+static int derive_temporal_colocated_mvs(const VVCLocalContext *lc, const ColMvField temp_col,
+                                         int refIdxLx, Mv *mvLXCol, int X, int sb_flag)
 {
     const VVCFrameContext *fc   = lc->fc;
     const SliceContext *sc      = lc->sc;
     RefPicList* refPicList      = sc->rpl;
+    const int pred_flag         = (temp_col.lx[L0] & COL_MV_VALID) | (temp_col.lx[L1] & COL_MV_VALID) << 1;
 
-    if (temp_col.pred_flag == PF_INTRA)
+    if (pred_flag == PF_INTRA)
         return 0;
 
     if (sb_flag){
         if (X == 0) {
-            if (temp_col.pred_flag & PF_L0)
+            if (pred_flag & PF_L0)
                 return CHECK_MVSET(0);
-            else if (ff_vvc_no_backward_pred_flag(lc) && (temp_col.pred_flag & PF_L1))
+            else if (ff_vvc_no_backward_pred_flag(lc) && (pred_flag & PF_L1))
                 return CHECK_MVSET(1);
         } else {
-            if (temp_col.pred_flag & PF_L1)
+            if (pred_flag & PF_L1)
                 return CHECK_MVSET(1);
-            else if (ff_vvc_no_backward_pred_flag(lc) && (temp_col.pred_flag & PF_L0))
+            else if (ff_vvc_no_backward_pred_flag(lc) && (pred_flag & PF_L0))
                 return CHECK_MVSET(0);
         }
     } else {
-        if (!(temp_col.pred_flag & PF_L0))
+        if (!(pred_flag & PF_L0))
             return CHECK_MVSET(1);
-        else if (temp_col.pred_flag == PF_L0)
+        else if (pred_flag == PF_L0)
             return CHECK_MVSET(0);
-        else if (temp_col.pred_flag == PF_BI) {
+        else if (pred_flag == PF_BI) {
             if (ff_vvc_no_backward_pred_flag(lc)) {
                 if (X == 0)
                     return CHECK_MVSET(0);
@@ -184,6 +249,9 @@ static int derive_temporal_colocated_mvs(const VVCLocalContext *lc, MvField temp
 #define TAB_MVF(x, y)                                                   \
     tab_mvf[((y) >> MIN_PU_LOG2) * min_pu_width + ((x) >> MIN_PU_LOG2)]
 
+#define TAB_PF(x, y)                                                    \
+    fc->tab.pf[((y) >> MIN_PU_LOG2) * min_pu_width + ((x) >> MIN_PU_LOG2)]
+
 #define TAB_MVF_PU(v)                                                   \
     TAB_MVF(x ## v, y ## v)
 
@@ -191,10 +259,12 @@ static int derive_temporal_colocated_mvs(const VVCLocalContext *lc, MvField temp
     fc->tab.cp_mv[lx][((((y) >> min_cb_log2_size) * min_cb_width + ((x) >> min_cb_log2_size)) ) * MAX_CONTROL_POINTS]
 
 
+#define TAB_COL_MVF(x, y)                                               \
+    tab_col_mvf[((y) >> COL_MV_LOG2) * col_width + ((x) >> COL_MV_LOG2)]
+
 #define DERIVE_TEMPORAL_COLOCATED_MVS(sb_flag)                          \
     derive_temporal_colocated_mvs(lc, temp_col,                          \
-                                  refIdxLx, mvLXCol, X, colPic,         \
-                                  ff_vvc_get_ref_list(fc, ref, x, y), sb_flag)
+                                  refIdxLx, mvLXCol, X, sb_flag)
 
 //8.5.2.11 Derivation process for temporal luma motion vector prediction
 static int temporal_luma_motion_vector(const VVCLocalContext *lc,
@@ -205,11 +275,11 @@ static int temporal_luma_motion_vector(const VVCLocalContext *lc,
     const VVCPPS *pps         = fc->ps.pps;
     const CodingUnit *cu      = lc->cu;
     const int subpic_idx      = lc->sc->sh.r->curr_subpic_idx;
-    int x, y, x_end, y_end, colPic, availableFlagLXCol = 0;
-    int min_pu_width = fc->ps.pps->min_pu_width;
+    int x, y, x_end, y_end, availableFlagLXCol = 0;
+    const int col_width = AV_CEIL_RSHIFT(pps->width, COL_MV_LOG2);
     VVCFrame *ref = fc->ref->collocated_ref;
-    MvField *tab_mvf;
-    MvField temp_col;
+    const ColMvField *tab_col_mvf;
+    ColMvField temp_col;
 
     if (!ref) {
         memset(mvLXCol, 0, sizeof(*mvLXCol));
@@ -219,8 +289,7 @@ static int temporal_luma_motion_vector(const VVCLocalContext *lc,
     if (!fc->ps.ph.r->ph_temporal_mvp_enabled_flag || (cu->cb_width * cu->cb_height <= 32))
         return 0;
 
-    tab_mvf = ref->tab_dmvr_mvf;
-    colPic  = ref->poc;
+    tab_col_mvf = ref->tab_col_mvf;
 
     //bottom right collocated motion vector
     x = cu->x0 + cu->cb_width;
@@ -229,22 +298,18 @@ static int temporal_luma_motion_vector(const VVCLocalContext *lc,
     x_end = pps->subpic_x[subpic_idx] + pps->subpic_width[subpic_idx];
     y_end = pps->subpic_y[subpic_idx] + pps->subpic_height[subpic_idx];
 
-    if (tab_mvf &&
+    if (tab_col_mvf &&
         (cu->y0 >> sps->ctb_log2_size_y) == (y >> sps->ctb_log2_size_y) &&
         x < x_end && y < y_end) {
-        x                 &= ~7;
-        y                 &= ~7;
-        temp_col           = TAB_MVF(x, y);
+        temp_col           = TAB_COL_MVF(x, y);
         availableFlagLXCol = DERIVE_TEMPORAL_COLOCATED_MVS(sb_flag);
     }
     if (check_center) {
         // derive center collocated motion vector
-        if (tab_mvf && !availableFlagLXCol) {
+        if (tab_col_mvf && !availableFlagLXCol) {
             x                  = cu->x0 + (cu->cb_width >> 1);
             y                  = cu->y0 + (cu->cb_height >> 1);
-            x                 &= ~7;
-            y                 &= ~7;
-            temp_col           = TAB_MVF(x, y);
+            temp_col           = TAB_COL_MVF(x, y);
             availableFlagLXCol = DERIVE_TEMPORAL_COLOCATED_MVS(sb_flag);
         }
     }
@@ -256,14 +321,11 @@ void ff_vvc_set_mvf(const VVCLocalContext *lc, const int x0, const int y0, const
     const VVCFrameContext *fc   = lc->fc;
     MvField *tab_mvf            = fc->tab.mvf;
     const int min_pu_width      = fc->ps.pps->min_pu_width;
-    const int min_pu_size       = 1 << MIN_PU_LOG2;
-    for (int dy = 0; dy < h; dy += min_pu_size) {
-        for (int dx = 0; dx < w; dx += min_pu_size) {
-            const int x = x0 + dx;
-            const int y = y0 + dy;
-            TAB_MVF(x, y) = *mvf;
-        }
-    }
+
+    ff_vvc_fill_rect(&TAB_MVF(x0, y0), min_pu_width * sizeof(*tab_mvf), mvf, sizeof(*mvf),
+        w >> MIN_PU_LOG2, h >> MIN_PU_LOG2);
+    ff_vvc_fill_rect(&TAB_PF(x0, y0), min_pu_width, &mvf->pred_flag, 1,
+        w >> MIN_PU_LOG2, h >> MIN_PU_LOG2);
 }
 
 void ff_vvc_set_intra_mvf(const VVCLocalContext *lc, const int dmvr)
@@ -272,14 +334,14 @@ void ff_vvc_set_intra_mvf(const VVCLocalContext *lc, const int dmvr)
     const CodingUnit *cu        = lc->cu;
     MvField *tab_mvf            = dmvr ? fc->ref->tab_dmvr_mvf : fc->tab.mvf;
     const int min_pu_width      = fc->ps.pps->min_pu_width;
-    const int min_pu_size       = 1 << MIN_PU_LOG2;
-    for (int dy = 0; dy < cu->cb_height; dy += min_pu_size) {
-        for (int dx = 0; dx < cu->cb_width; dx += min_pu_size) {
-            const int x = cu->x0 + dx;
-            const int y = cu->y0 + dy;
-            TAB_MVF(x, y).pred_flag = PF_INTRA;
-        }
-    }
+    const int w                 = cu->cb_width  >> MIN_PU_LOG2;
+    const int h                 = cu->cb_height >> MIN_PU_LOG2;
+    // the motion of an intra block is never read, only its pred_flag
+    const MvField intra         = { .pred_flag = PF_INTRA };
+
+    ff_vvc_fill_rect(&TAB_MVF(cu->x0, cu->y0), min_pu_width * sizeof(*tab_mvf), &intra, sizeof(intra), w, h);
+    if (!dmvr)
+        ff_vvc_fill_rect(&TAB_PF(cu->x0, cu->y0), min_pu_width, &intra.pred_flag, 1, w, h);
 }
 
 //cbProfFlagLX from 8.5.5.9 Derivation process for motion vector arrays from affine control point motion vectors
@@ -370,15 +432,26 @@ static void derive_subblock_diff_mvs(const VVCLocalContext *lc, PredictionUnit*
         const int dmv_limit = 1 << 5;
         const int pos_offset_x = 6 * (sp->d_hor_x + sp->d_hor_y);
         const int pos_offset_y = 6 * (sp->d_ver_x + sp->d_ver_y);
-        for (int x = 0; x < AFFINE_MIN_BLOCK_SIZE; x++) {
-            for (int y = 0; y < AFFINE_MIN_BLOCK_SIZE; y++) {
-                LOCAL_ALIGNED_8(Mv, diff, [1]);
-                diff->x = x * (sp->d_hor_x * (1 << 2)) + y * (sp->d_hor_y * (1 << 2)) - pos_offset_x;
-                diff->y = x * (sp->d_ver_x * (1 << 2)) + y * (sp->d_ver_y * (1 << 2)) - pos_offset_y;
-                ff_vvc_round_mv(diff, 0, 8);
-                pu->diff_mv_x[lx][AFFINE_MIN_BLOCK_SIZE * y + x] = av_clip(diff->x, -dmv_limit + 1, dmv_limit - 1);
-                pu->diff_mv_y[lx][AFFINE_MIN_BLOCK_SIZE * y + x] = av_clip(diff->y, -dmv_limit + 1, dmv_limit - 1);
+        int16_t *diff_x = pu->diff_mv_x[lx];
+        int16_t *diff_y = pu->diff_mv_y[lx];
+
+        // in the order of the table, so the rows are stepped along the model
+        for (int y = 0; y < AFFINE_MIN_BLOCK_SIZE; y++) {
+            Mv diff = {
+                y * (sp->d_hor_y * (1 << 2)) - pos_offset_x,
+                y * (sp->d_ver_y * (1 << 2)) - pos_offset_y,
+            };
+            for (int x = 0; x < AFFINE_MIN_BLOCK_SIZE; x++) {
+                Mv d = diff;
+
+                ff_vvc_round_mv(&d, 0, 8);
+                diff_x[x] = av_clip(d.x, -dmv_limit + 1, dmv_limit - 1);
+                diff_y[x] = av_clip(d.y, -dmv_limit + 1, dmv_limit - 1);
+                diff.x += sp->d_hor_x * (1 << 2);
+                diff.y += sp->d_ver_x * (1 << 2);
             }
+            diff_x += AFFINE_MIN_BLOCK_SIZE;
+            diff_y += AFFINE_MIN_BLOCK_SIZE;
         }
     }
 }
@@ -404,15 +477,31 @@ static void store_cp_mv(const VVCLocalContext *lc, const MotionInfo *mi, const i
     }
 }
 
+// the motion of the subblock at sbx, sby, with its model stepped by d_x along the row
+static av_always_inline void affine_sb_mv(Mv *mv, Mv *d_x, const SubblockParams *sp, const int sbx, const int sby)
+{
+    const int x_pos_cb = sp->is_fallback ? (sp->cb_width >> 1) : (2 + (sbx << MIN_CU_LOG2));
+    const int y_pos_cb = sp->is_fallback ? (sp->cb_height >> 1) : (2 + (sby << MIN_CU_LOG2));
+
+    mv->x  = sp->mv_scale_hor + sp->d_hor_x * x_pos_cb + sp->d_hor_y * y_pos_cb;
+    mv->y  = sp->mv_scale_ver + sp->d_ver_x * x_pos_cb + sp->d_ver_y * y_pos_cb;
+    d_x->x = sp->is_fallback ? 0 : sp->d_hor_x * (1 << MIN_CU_LOG2);
+    d_x->y = sp->is_fallback ? 0 : sp->d_ver_x * (1 << MIN_CU_LOG2);
+}
+
 //8.5.5.9 Derivation process for motion vector arrays from affine control point motion vectors
 void ff_vvc_store_sb_mvs(const VVCLocalContext *lc, PredictionUnit *pu)
 {
-    const CodingUnit *cu = lc->cu;
-    const MotionInfo *mi = &pu->mi;
-    const int sbw = cu->cb_width / mi->num_sb_x;
-    const int sbh = cu->cb_height / mi->num_sb_y;
+    const VVCFrameContext *fc   = lc->fc;
+    const CodingUnit *cu        = lc->cu;
+    const MotionInfo *mi        = &pu->mi;
+    const int min_pu_width      = fc->ps.pps->min_pu_width;
+    MvField *tab_mvf            = fc->tab.mvf;
+    int fallback                = 1;
     SubblockParams params[2];
     MvField mvf = {0};
+    MvField *row;
+    uint8_t *pf;
 
     mvf.pred_flag = mi->pred_flag;
     mvf.bcw_idx = mi->bcw_idx;
@@ -424,29 +513,51 @@ void ff_vvc_store_sb_mvs(const VVCLocalContext *lc, PredictionUnit *pu)
             init_subblock_params(params + i, mi, cu->cb_width, cu->cb_height, i);
             derive_subblock_diff_mvs(lc, pu, params + i, i);
             mvf.ref_idx[i] = mi->ref_idx[i];
+            fallback &= params[i].is_fallback;
         }
     }
 
+    // one motion for all of the cu
+    if (fallback) {
+        for (int i = 0; i < 2; i++) {
+            if (mi->pred_flag & (i + 1)) {
+                Mv d_x;
+
+                affine_sb_mv(mvf.mv + i, &d_x, params + i, 0, 0);
+                ff_vvc_round_mv(mvf.mv + i, 0, MAX_CU_DEPTH);
+                ff_vvc_clip_mv(mvf.mv + i);
+            }
+        }
+        ff_vvc_set_mvf(lc, cu->x0, cu->y0, cu->cb_width, cu->cb_height, &mvf);
+        return;
+    }
+
+    // The subblocks are the min pus of the motion field, so each row of them is stepped along the
+    // model and written in place.
+    row = &TAB_MVF(cu->x0, cu->y0);
+    pf  = &TAB_PF(cu->x0, cu->y0);
     for (int sby = 0; sby < mi->num_sb_y; sby++) {
+        Mv mv[2], d_x[2];
+
+        for (int i = 0; i < 2; i++) {
+            if (mi->pred_flag & (i + 1))
+                affine_sb_mv(mv + i, d_x + i, params + i, 0, sby);
+        }
         for (int sbx = 0; sbx < mi->num_sb_x; sbx++) {
-            const int x0 = cu->x0 + sbx * sbw;
-            const int y0 = cu->y0 + sby * sbh;
             for (int i = 0; i < 2; i++) {
-                const PredFlag mask = i + 1;
-                if (mi->pred_flag & mask) {
-                    const SubblockParams* sp = params + i;
-                    const int x_pos_cb = sp->is_fallback ? (cu->cb_width >> 1) : (2 + (sbx << MIN_CU_LOG2));
-                    const int y_pos_cb = sp->is_fallback ? (cu->cb_height >> 1) : (2 + (sby << MIN_CU_LOG2));
-                    Mv *mv = mvf.mv + i;
-
-                    mv->x = sp->mv_scale_hor + sp->d_hor_x * x_pos_cb + sp->d_hor_y * y_pos_cb;
-                    mv->y = sp->mv_scale_ver + sp->d_ver_x * x_pos_cb + sp->d_ver_y * y_pos_cb;
-                    ff_vvc_round_mv(mv, 0, MAX_CU_DEPTH);
-                    ff_vvc_clip_mv(mv);
+                if (mi->pred_flag & (i + 1)) {
+                    mvf.mv[i] = mv[i];
+                    ff_vvc_round_mv(mvf.mv + i, 0, MAX_CU_DEPTH);
+                    ff_vvc_clip_mv(mvf.mv + i);
+                    mv[i].x += d_x[i].x;
+                    mv[i].y += d_x[i].y;
                 }
             }
-            ff_vvc_set_mvf(lc, x0, y0, sbw, sbh, &mvf);
+            row[sbx] = mvf;
         }
+        memset(pf, mvf.pred_flag, mi->num_sb_x);
+        row += min_pu_width;
+        pf  += min_pu_width;
     }
 }
 
@@ -602,13 +713,11 @@ static int check_available(Neighbour *n, const VVCLocalContext *lc, const int ch
     const VVCFrameContext *fc   = lc->fc;
     const VVCSPS *sps           = fc->ps.sps;
     const CodingUnit *cu        = lc->cu;
-    const MvField *tab_mvf      = fc->tab.mvf;
-    const int min_pu_width      = fc->ps.pps->min_pu_width;
 
     if (!n->checked) {
         n->checked = 1;
         n->available = !sps->r->sps_entropy_coding_sync_enabled_flag || ((n->x >> sps->ctb_log2_size_y) <= (cu->x0 >> sps->ctb_log2_size_y));
-        n->available &= cu->pred_mode == pred_flag_to_mode(TAB_MVF(n->x, n->y).pred_flag);
+        n->available &= cu->pred_mode == pred_flag_to_mode(ff_vvc_get_pred_flag(fc, n->x, n->y));
         if (check_mer)
             n->available &= !is_same_mer(fc, n->x, n->y, cu->x0, cu->y0);
     }
@@ -692,14 +801,22 @@ static int mv_merge_temporal_candidate(const VVCLocalContext *lc, MvField *cand)
     return cand->pred_flag;
 }
 
+// candidate i of the list, from the oldest
+static av_always_inline const MvField *hmvp_cand(const HMVPList *l, const int i)
+{
+    const int idx = l->start + i;
+
+    return l->cands + (idx >= MAX_NUM_HMVP_CANDS ? idx - MAX_NUM_HMVP_CANDS : idx);
+}
+
 //8.5.2.6 Derivation process for history-based merging candidates
 static int mv_merge_history_candidates(const VVCLocalContext *lc, const int merge_idx,
     const MvField **nb_list, MvField *cand_list, int *num_cands)
 {
     const VVCSPS *sps       = lc->fc->ps.sps;
     const EntryPoint* ep    = lc->ep;
-    for (int i = 1; i <= ep->num_hmvp && (*num_cands < sps->max_num_merge_cand - 1); i++) {
-        const MvField *h = &ep->hmvp[ep->num_hmvp - i];
+    for (int i = 1; i <= ep->hmvp.num && (*num_cands < sps->max_num_merge_cand - 1); i++) {
+        const MvField *h = hmvp_cand(&ep->hmvp, ep->hmvp.num - i);
         const int same_motion = i <= 2 && (compare_mv_ref_idx(h, nb_list[A1]) || compare_mv_ref_idx(h, nb_list[B1]));
         if (!same_motion) {
             cand_list[*num_cands] = *h;
@@ -1012,20 +1129,19 @@ static void sb_temproal_luma_motion(const VVCLocalContext *lc,
     const int x_ctb, const int y_ctb, const Mv *temp_mv,
     int x, int y, uint8_t *pred_flag, Mv *mv)
 {
-    MvField temp_col;
+    ColMvField temp_col;
     Mv* mvLXCol;
     const int refIdxLx          = 0;
     const VVCFrameContext *fc   = lc->fc;
     const VVCSH *sh             = &lc->sc->sh;
-    const int min_pu_width      = fc->ps.pps->min_pu_width;
-    VVCFrame *ref               = fc->ref->collocated_ref;
-    MvField *tab_mvf            = ref->tab_dmvr_mvf;
-    int colPic                  = ref->poc;
+    const int col_width         = AV_CEIL_RSHIFT(fc->ps.pps->width, COL_MV_LOG2);
+    const VVCFrame *ref         = fc->ref->collocated_ref;
+    const ColMvField *tab_col_mvf = ref->tab_col_mvf;
     int X                       = 0;
 
     sb_clip_location(lc, x_ctb, y_ctb, temp_mv, &x, &y);
 
-    temp_col    = TAB_MVF(x, y);
+    temp_col    = TAB_COL_MVF(x, y);
     mvLXCol     = mv + 0;
     *pred_flag = DERIVE_TEMPORAL_COLOCATED_MVS(1);
     if (IS_B(sh->r)) {
@@ -1551,10 +1667,10 @@ static int mvp_history_candidates(const VVCLocalContext *lc,
     const RefPicList* rpl           = lc->sc->rpl;
     const int poc                   = rpl[lx].refs[ref_idx].poc;
 
-    if (ep->num_hmvp == 0)
+    if (ep->hmvp.num == 0)
         return 0;
-    for (int i = 1; i <= FFMIN(4, ep->num_hmvp); i++) {
-        const MvField* h = &ep->hmvp[i - 1];
+    for (int i = 1; i <= FFMIN(4, ep->hmvp.num); i++) {
+        const MvField* h = hmvp_cand(&ep->hmvp, i - 1);
         for (int j = 0; j < 2; j++) {
             const int ly = (j ? !lx : lx);
             PredFlag mask = PF_L0 + ly;
@@ -1648,9 +1764,9 @@ static int ibc_history_candidates(const VVCLocalContext *lc,
     const int is_gt4by4  = (cu->cb_width * cu->cb_height) > 16;
     int num_cands        = *nb_merge_cand;
 
-    for (int i = 1; i <= ep->num_hmvp_ibc; i++) {
+    for (int i = 1; i <= ep->hmvp_ibc.num; i++) {
         int same_motion = 0;
-        const MvField *mvf = &ep->hmvp_ibc[ep->num_hmvp_ibc - i];
+        const MvField *mvf = hmvp_cand(&ep->hmvp_ibc, ep->hmvp_ibc.num - i);
         for (int j = 0; j < *nb_merge_cand; j++) {
             same_motion = is_gt4by4 && i == 1 && IS_SAME_MV(&mvf->mv[L0], &cand_list[j]);
             if (same_motion)
@@ -1890,28 +2006,56 @@ static av_always_inline int is_greater_mer(const VVCFrameContext *fc, const int
            y0_br >> plevel > y0 >> plevel;
 }
 
-static void update_hmvp(MvField *hmvp, int *num_hmvp, const MvField *mvf,
+// the motion compare_mv_ref_idx() compares folded into a word, equal for the same motion
+static uint64_t mv_ref_idx_key(const MvField *mvf)
+{
+    uint64_t key = mvf->pred_flag;
+
+    for (int i = 0; i < 2; i++) {
+        if (mvf->pred_flag & (PF_L0 << i))
+            key = (key ^ AV_RN64A(mvf->mv + i) ^ (uint64_t)(uint8_t)mvf->ref_idx[i] << 56) * 0x9E3779B97F4A7C15ULL;
+    }
+    return key;
+}
+
+/**
+ * Move mvf to the newest end of the list, removing an equal candidate or
+ * else the oldest one if the list is full.  Equal candidates have equal
+ * keys, so only candidates with the key of mvf are compared, and not at all
+ * if the key is the motion itself, compare is NULL.
+ */
+static void update_hmvp(HMVPList *l, const MvField *mvf, const uint64_t key,
     int (*compare)(const MvField *n, const MvField *o))
 {
-    int i;
-    for (i = 0; i < *num_hmvp; i++) {
-        if (compare(mvf, hmvp + i)) {
-            (*num_hmvp)--;
+    int i, idx;
+
+    // the list holds no equal candidates, look from the newest which most often is the one
+    for (i = l->num - 1; i >= 0; i--) {
+        idx = l->start + i;
+        idx -= idx >= MAX_NUM_HMVP_CANDS ? MAX_NUM_HMVP_CANDS : 0;
+        if (l->keys[idx] == key && (!compare || compare(mvf, l->cands + idx)))
             break;
-        }
-    }
-    if (i == MAX_NUM_HMVP_CANDS) {
-        (*num_hmvp)--;
-        i = 0;
     }
 
-    memmove(hmvp + i, hmvp + i + 1, (*num_hmvp - i) * sizeof(MvField));
-    hmvp[(*num_hmvp)++] = *mvf;
-}
+    if (i >= 0) {
+        for (; i < l->num - 1; i++) {
+            const int next = idx + 1 == MAX_NUM_HMVP_CANDS ? 0 : idx + 1;
 
-static int compare_l0_mv(const MvField *n, const MvField *o)
-{
-    return IS_SAME_MV(&n->mv[L0], &o->mv[L0]);
+            l->cands[idx] = l->cands[next];
+            l->keys[idx]  = l->keys[next];
+            idx           = next;
+        }
+        l->num--;
+    } else if (l->num == MAX_NUM_HMVP_CANDS) {
+        l->start = l->start + 1 == MAX_NUM_HMVP_CANDS ? 0 : l->start + 1;
+        l->num--;
+    }
+
+    idx = l->start + l->num;
+    idx -= idx >= MAX_NUM_HMVP_CANDS ? MAX_NUM_HMVP_CANDS : 0;
+    l->cands[idx] = *mvf;
+    l->keys[idx]  = key;
+    l->num++;
 }
 
 //8.6.2.4 Derivation process for IBC history-based block vector candidates
@@ -1923,15 +2067,17 @@ void ff_vvc_update_hmvp(VVCLocalContext *lc, const MotionInfo *mi)
     const int min_pu_width      = fc->ps.pps->min_pu_width;
     const MvField *tab_mvf      = fc->tab.mvf;
     EntryPoint *ep              = lc->ep;
+    const MvField *mvf          = &TAB_MVF(cu->x0, cu->y0);
 
     if (cu->pred_mode == MODE_IBC) {
         if (cu->cb_width * cu->cb_height <= 16)
             return;
-        update_hmvp(ep->hmvp_ibc, &ep->num_hmvp_ibc, &TAB_MVF(cu->x0, cu->y0), compare_l0_mv);
+        // block vectors are compared by the L0 motion alone, which is a word itself
+        update_hmvp(&ep->hmvp_ibc, mvf, AV_RN64A(&mvf->mv[L0]), NULL);
     } else {
         if (!is_greater_mer(fc, cu->x0, cu->y0, cu->x0 + cu->cb_width, cu->y0 + cu->cb_height))
             return;
-        update_hmvp(ep->hmvp, &ep->num_hmvp, &TAB_MVF(cu->x0, cu->y0), compare_mv_ref_idx);
+        update_hmvp(&ep->hmvp, mvf, mv_ref_idx_key(mvf), compare_mv_ref_idx);
     }
 }
 
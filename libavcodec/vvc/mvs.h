@@ -42,6 +42,22 @@ void ff_vvc_store_gpm_mvf(const VVCLocalContext *lc, const PredictionUnit* pu);
 void ff_vvc_update_hmvp(VVCLocalContext *lc, const MotionInfo *mi);
 int ff_vvc_no_backward_pred_flag(const VVCLocalContext *lc);
 MvField* ff_vvc_get_mvf(const VVCFrameContext *fc, const int x0, const int y0);
+
+/**
+ * Store the motion of a ctu of the current picture as a collocated picture
+ * provides it, once the motion (after DMVR) of the ctu is final.
+ */
+void ff_vvc_store_col_mvf(const VVCFrameContext *fc, int rx, int ry);
+
+/**
+ * Get the PredFlag of the prediction unit covering (x0, y0) in the current picture.
+ * Reads the dense PredFlag plane, so intra/inter checks do not touch the MvField table.
+ */
+static av_always_inline PredFlag ff_vvc_get_pred_flag(const VVCFrameContext *fc, const int x0, const int y0)
+{
+    return fc->tab.pf[(y0 >> MIN_PU_LOG2) * fc->ps.pps->min_pu_width + (x0 >> MIN_PU_LOG2)];
+}
+
 void ff_vvc_set_mvf(const VVCLocalContext *lc, const int x0, const int y0, const int w, const int h, const MvField *mvf);
 void ff_vvc_set_intra_mvf(const VVCLocalContext *lc, int dmvr);
 
@@ -22,6 +22,7 @@
  */
 
 #include "libavcodec/cbs_h266.h"
+#include "libavcodec/golomb.h"
 #include "libavutil/mem.h"
 #include "libavutil/pixdesc.h"
 #include "libavcodec/refstruct.h"
@@ -153,6 +154,16 @@ static void sps_inter(VVCSPS *sps)
     sps->log2_parallel_merge_level = r->sps_log2_parallel_merge_level_minus2 + 2;
 }
 
+// the intra only constraint, or a dpb with no room for a reference picture besides the current one
+static void sps_intra_only(VVCSPS *sps)
+{
+    const H266RawSPS *r = sps->r;
+
+    sps->intra_only = r->sps_ptl_dpb_hrd_params_present_flag &&
+        (r->profile_tier_level.general_constraints_info.gci_intra_only_constraint_flag ||
+         !r->sps_dpb_params.dpb_max_dec_pic_buffering_minus1[r->sps_max_sublayers_minus1]);
+}
+
 static void sps_partition_constraints(VVCSPS* sps)
 {
     const H266RawSPS *r = sps->r;
@@ -189,6 +200,7 @@ static int sps_derive(VVCSPS *sps, void *log_ctx)
         return ret;
     sps_poc(sps);
     sps_inter(sps);
+    sps_intra_only(sps);
     sps_partition_constraints(sps);
     sps_ladf(sps);
     if (r->sps_chroma_format_idc != 0) {
@@ -227,6 +239,18 @@ fail:
     return NULL;
 }
 
+// Whether raw is the raw parameter set old_r was derived from, or a bit-identical re-sent copy
+// of it. The copy is kept in *resent, so the following pictures find it without memcmp().
+static int ps_unchanged(void *resent, const void *old_r, const void *raw, const size_t size)
+{
+    if (raw == old_r || raw == *(const void **)resent)
+        return 1;
+    if (memcmp(old_r, raw, size))
+        return 0;
+    ff_refstruct_replace(resent, raw);
+    return 1;
+}
+
 static int decode_sps(VVCParamSets *ps, const H266RawSPS *rsps, void *log_ctx, int is_clvss)
 {
     const int sps_id        = rsps->sps_seq_parameter_set_id;
@@ -238,7 +262,7 @@ static int decode_sps(VVCParamSets *ps, const H266RawSPS *rsps, void *log_ctx, i
     }
 
     if (old_sps) {
-        if (old_sps->r == rsps || !memcmp(old_sps->r, rsps, sizeof(*old_sps->r)))
+        if (ps_unchanged(&ps->sps_resent[sps_id], old_sps->r, rsps, sizeof(*rsps)))
             return 0;
         else if (ps->sps_id_used & (1 << sps_id))
             return AVERROR_INVALIDDATA;
@@ -249,9 +273,18 @@ static int decode_sps(VVCParamSets *ps, const H266RawSPS *rsps, void *log_ctx, i
         return AVERROR(ENOMEM);
 
     ff_refstruct_unref(&ps->sps_list[sps_id]);
+    ff_refstruct_unref(&ps->sps_resent[sps_id]);
     ps->sps_list[sps_id] = sps;
     ps->sps_id_used |= (1 << sps_id);
 
+    // the PPSs derived from the old SPS can't be reused
+    for (int i = 0; i < FF_ARRAY_ELEMS(ps->pps_list); i++) {
+        if (ps->pps_list[i] && ps->pps_list[i]->r->pps_seq_parameter_set_id == sps_id) {
+            ff_refstruct_unref(&ps->pps_list[i]);
+            ff_refstruct_unref(&ps->pps_resent[i]);
+        }
+    }
+
     return 0;
 }
 
@@ -614,7 +647,7 @@ static int decode_pps(VVCParamSets *ps, const H266RawPPS *rpps)
     const VVCPPS *old_pps   = ps->pps_list[pps_id];
     const VVCPPS *pps;
 
-    if (old_pps && old_pps->r == rpps)
+    if (old_pps && ps_unchanged(&ps->pps_resent[pps_id], old_pps->r, rpps, sizeof(*rpps)))
         return 0;
 
     pps = pps_alloc(rpps, ps->sps_list[sps_id]);
@@ -622,6 +655,7 @@ static int decode_pps(VVCParamSets *ps, const H266RawPPS *rpps)
         return AVERROR(ENOMEM);
 
     ff_refstruct_unref(&ps->pps_list[pps_id]);
+    ff_refstruct_unref(&ps->pps_resent[pps_id]);
     ps->pps_list[pps_id] = pps;
 
     return ret;
@@ -870,6 +904,57 @@ static int decode_ph(VVCFrameParamSets *fps, const H266RawPictureHeader *rph, vo
     return 0;
 }
 
+// 8.8.5.2 the filter coefficients and clipping values of each class and transposeIdx
+static void alf_derive_luma_filters(VVCALFLumaFilters *f, const int16_t *coeff_set,
+    const uint8_t *clip_idx_set, const uint8_t *class_to_filt, const int bit_depth)
+{
+    static const uint8_t index[ALF_NUM_TRANSPOSES][ALF_NUM_COEFF_LUMA] = {
+        { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 },
+        { 9, 4, 10, 8, 1, 5, 11, 7, 3, 0, 2, 6 },
+        { 0, 3, 2, 1, 8, 7, 6, 5, 4, 9, 10, 11 },
+        { 9, 8, 10, 4, 3, 7, 11, 5, 1, 0, 2, 6 },
+    };
+    const int16_t clip_set[] = {
+        1 << bit_depth, 1 << (bit_depth - 3), 1 << (bit_depth - 5), 1 << (bit_depth - 7)
+    };
+
+    for (int cls = 0; cls < ALF_NUM_FILTERS_LUMA; cls++) {
+        const int16_t *coeff   = coeff_set + class_to_filt[cls] * ALF_NUM_COEFF_LUMA;
+        const uint8_t *clip_idx = clip_idx_set ? clip_idx_set + cls * ALF_NUM_COEFF_LUMA : NULL;
+
+        for (int t = 0; t < ALF_NUM_TRANSPOSES; t++) {
+            for (int j = 0; j < ALF_NUM_COEFF_LUMA; j++) {
+                const int idx = index[t][j];
+
+                f->coeff[cls][t][j] = coeff[idx];
+                f->clip[cls][t][j]  = clip_set[clip_idx ? clip_idx[idx] : 0];
+            }
+        }
+    }
+}
+
+static void decode_frame_alf(VVCFrameParamSets *fps, const VVCParamSets *ps)
+{
+    const int bit_depth = fps->sps->bit_depth;
+
+    for (int i = 0; i < FF_ARRAY_ELEMS(fps->alf_list); i++) {
+        const VVCALF *alf = ps->alf_list[i];
+
+        // a resent APS keeps its pointer, so the filters of the last picture of this context still apply
+        if (alf && (alf != fps->alf_list[i] || fps->alf_bit_depth != bit_depth))
+            alf_derive_luma_filters(&fps->alf_luma[i], &alf->luma_coeff[0][0], &alf->luma_clip_idx[0][0],
+                ff_vvc_alf_aps_class_to_filt_map, bit_depth);
+        ff_refstruct_replace(&fps->alf_list[i], alf);
+    }
+
+    if (fps->alf_bit_depth != bit_depth) {
+        for (int i = 0; i < ALF_NUM_FIXED_FILTER_SETS; i++)
+            alf_derive_luma_filters(&fps->alf_fixed[i], &ff_vvc_alf_fix_filt_coeff[0][0], NULL,
+                ff_vvc_alf_class_to_filt_map[i], bit_depth);
+        fps->alf_bit_depth = bit_depth;
+    }
+}
+
 static int decode_frame_ps(VVCFrameParamSets *fps, const VVCParamSets *ps,
     const CodedBitstreamH266Context *h266, const int poc_tid0, const int is_clvss)
 {
@@ -895,13 +980,20 @@ static int decode_frame_ps(VVCFrameParamSets *fps, const VVCParamSets *ps,
         ff_refstruct_replace(&fps->sl, ps->scaling_list[ph->ph_scaling_list_aps_id]);
 
     if (ph->ph_lmcs_enabled_flag) {
-        ret = lmcs_derive_lut(&fps->lmcs, ps->lmcs_list[ph->ph_lmcs_aps_id], fps->sps->r);
-        if (ret < 0)
-            return ret;
+        const H266RawAPS *lmcs_aps = ps->lmcs_list[ph->ph_lmcs_aps_id];
+
+        // a resent APS keeps its pointer, so the luts of the last picture of this context still apply
+        if (!lmcs_aps || lmcs_aps != fps->lmcs_aps || fps->lmcs_bit_depth != fps->sps->bit_depth) {
+            ff_refstruct_unref(&fps->lmcs_aps);
+            ret = lmcs_derive_lut(&fps->lmcs, lmcs_aps, fps->sps->r);
+            if (ret < 0)
+                return ret;
+            ff_refstruct_replace(&fps->lmcs_aps, lmcs_aps);
+            fps->lmcs_bit_depth = fps->sps->bit_depth;
+        }
     }
 
-    for (int i = 0; i < FF_ARRAY_ELEMS(fps->alf_list); i++)
-        ff_refstruct_replace(&fps->alf_list[i], ps->alf_list[i]);
+    decode_frame_alf(fps, ps);
 
     return 0;
 }
@@ -949,6 +1041,7 @@ void ff_vvc_frame_ps_free(VVCFrameParamSets *fps)
     ff_refstruct_unref(&fps->pps);
     ff_refstruct_unref(&fps->ph.rref);
     ff_refstruct_unref(&fps->sl);
+    ff_refstruct_unref(&fps->lmcs_aps);
     for (int i = 0; i < FF_ARRAY_ELEMS(fps->alf_list); i++)
         ff_refstruct_unref(&fps->alf_list[i]);
 }
@@ -961,10 +1054,20 @@ void ff_vvc_ps_uninit(VVCParamSets *ps)
         ff_refstruct_unref(&ps->lmcs_list[i]);
     for (int i = 0; i < FF_ARRAY_ELEMS(ps->alf_list); i++)
         ff_refstruct_unref(&ps->alf_list[i]);
-    for (int i = 0; i < FF_ARRAY_ELEMS(ps->sps_list); i++)
+    for (int t = 0; t < FF_ARRAY_ELEMS(ps->aps_data); t++) {
+        for (int i = 0; i < FF_ARRAY_ELEMS(ps->aps_data[t]); i++) {
+            av_freep(&ps->aps_data[t][i]);
+            ps->aps_size[t][i] = 0;
+        }
+    }
+    for (int i = 0; i < FF_ARRAY_ELEMS(ps->sps_list); i++) {
         ff_refstruct_unref(&ps->sps_list[i]);
-    for (int i = 0; i < FF_ARRAY_ELEMS(ps->pps_list); i++)
+        ff_refstruct_unref(&ps->sps_resent[i]);
+    }
+    for (int i = 0; i < FF_ARRAY_ELEMS(ps->pps_list); i++) {
         ff_refstruct_unref(&ps->pps_list[i]);
+        ff_refstruct_unref(&ps->pps_resent[i]);
+    }
 }
 
 static void alf_coeff(int16_t *coeff,
@@ -1142,6 +1245,46 @@ static int aps_decode_scaling(const VVCScalingList **scaling, const H266RawAPS *
     return 0;
 }
 
+static int aps_decoded(const VVCParamSets *ps, const H266RawAPS *aps)
+{
+    const int id = aps->aps_adaptation_parameter_set_id;
+
+    switch (aps->aps_params_type) {
+    case VVC_ASP_TYPE_ALF:
+        return !!ps->alf_list[id];
+    case VVC_ASP_TYPE_LMCS:
+        return !!ps->lmcs_list[id];
+    case VVC_ASP_TYPE_SCALING:
+        return !!ps->scaling_list[id];
+    }
+    return 0;
+}
+
+// whether the APS resends the payload of the one in use, else remember the payload
+static int aps_resent(VVCParamSets *ps, const H266RawAPS *aps, const CodedBitstreamUnit *unit)
+{
+    // the nal unit header may differ between prefix and suffix APS, or in the temporal ID
+    const uint8_t *data = unit->data + 2;
+    const size_t size   = unit->data_size > 2 ? unit->data_size - 2 : 0;
+    uint8_t **dst       = &ps->aps_data[aps->aps_params_type][aps->aps_adaptation_parameter_set_id];
+    size_t *dst_size    = &ps->aps_size[aps->aps_params_type][aps->aps_adaptation_parameter_set_id];
+
+    if (!size)
+        return 0;
+
+    if (*dst && *dst_size == size && !memcmp(*dst, data, size))
+        return aps_decoded(ps, aps);
+
+    // not remembering the payload only costs deriving its data again
+    av_freep(dst);
+    *dst_size = 0;
+    *dst = av_memdup(data, size);
+    if (*dst)
+        *dst_size = size;
+
+    return 0;
+}
+
 int ff_vvc_decode_aps(VVCParamSets *ps, const CodedBitstreamUnit *unit)
 {
     const H266RawAPS *aps = unit->content_ref;
@@ -1150,6 +1293,9 @@ int ff_vvc_decode_aps(VVCParamSets *ps, const CodedBitstreamUnit *unit)
     if (!aps)
         return AVERROR_INVALIDDATA;
 
+    if (aps->aps_params_type <= VVC_ASP_TYPE_SCALING && aps_resent(ps, aps, unit))
+        return 0;
+
     switch (aps->aps_params_type) {
         case VVC_ASP_TYPE_ALF:
             ret = aps_decode_alf(&ps->alf_list[aps->aps_adaptation_parameter_set_id], aps);
@@ -1162,6 +1308,12 @@ int ff_vvc_decode_aps(VVCParamSets *ps, const CodedBitstreamUnit *unit)
             break;
     }
 
+    // the list keeps the data of another payload
+    if (ret < 0) {
+        av_freep(&ps->aps_data[aps->aps_params_type][aps->aps_adaptation_parameter_set_id]);
+        ps->aps_size[aps->aps_params_type][aps->aps_adaptation_parameter_set_id] = 0;
+    }
+
     return ret;
 }
 
@@ -1331,14 +1483,420 @@ static int sh_derive(VVCSH *sh, const VVCFrameParamSets *fps)
     return 0;
 }
 
-int ff_vvc_decode_sh(VVCSH *sh, const VVCFrameParamSets *fps, const CodedBitstreamUnit *unit)
+// Exp-Golomb codes with more than 31 leading zero bits are invalid, they are returned as
+// values which the range checks of all the syntax elements reject.
+static unsigned sh_read_ue(GetBitContext *gb)
+{
+    return show_bits_long(gb, 32) ? get_ue_golomb_long(gb) : UINT32_MAX;
+}
+
+static int sh_read_se(GetBitContext *gb)
+{
+    return show_bits_long(gb, 32) ? get_se_golomb_long(gb) : INT_MIN;
+}
+
+static int sh_read_ref_pic_lists(GetBitContext *gb, H266RefPicLists *rpls,
+    const H266RawSPS *sps, const H266RawPPS *pps)
+{
+    for (int i = 0; i < 2; i++) {
+        const int num_lists = sps->sps_num_ref_pic_lists[i];
+        const int present   = i == 0 || pps->pps_rpl1_idx_present_flag;
+        const H266RefPicListStruct *rpl;
+        int num_ltrp_entries = 0;
+
+        if (num_lists && present)
+            rpls->rpl_sps_flag[i] = get_bits1(gb);
+        else
+            rpls->rpl_sps_flag[i] = num_lists ? rpls->rpl_sps_flag[0] : 0;
+
+        // a ref_pic_list_struct() in the slice header is left to CBS
+        if (!rpls->rpl_sps_flag[i])
+            return AVERROR(EAGAIN);
+
+        if (num_lists > 1 && present)
+            rpls->rpl_idx[i] = get_bits(gb, av_ceil_log2(num_lists));
+        else if (num_lists == 1)
+            rpls->rpl_idx[i] = 0;
+        else
+            rpls->rpl_idx[i] = rpls->rpl_idx[0];
+        if (rpls->rpl_idx[i] >= num_lists)
+            return AVERROR_INVALIDDATA;
+
+        rpl = &sps->sps_ref_pic_list_struct[i][rpls->rpl_idx[i]];
+        rpls->rpl_ref_list[i] = *rpl;
+
+        for (int k = 0; k < rpl->num_ref_entries; k++)
+            num_ltrp_entries += !rpl->inter_layer_ref_pic_flag[k] && !rpl->st_ref_pic_flag[k];
+
+        for (int j = 0; j < num_ltrp_entries; j++) {
+            if (rpl->ltrp_in_header_flag)
+                rpls->poc_lsb_lt[i][j] = get_bits(gb, sps->sps_log2_max_pic_order_cnt_lsb_minus4 + 4);
+            rpls->delta_poc_msb_cycle_present_flag[i][j] = get_bits1(gb);
+            if (rpls->delta_poc_msb_cycle_present_flag[i][j]) {
+                const uint32_t delta = sh_read_ue(gb);
+                if (delta > 1 << (32 - sps->sps_log2_max_pic_order_cnt_lsb_minus4 - 4))
+                    return AVERROR_INVALIDDATA;
+                rpls->delta_poc_msb_cycle_lt[i][j] = delta;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int sh_read_num_entry_points(H266RawSliceHeader *rsh, const H266RawSPS *sps, const H266RawPPS *pps)
+{
+    const int entropy_sync     = sps->sps_entropy_coding_sync_enabled_flag;
+    unsigned num_entry_points  = 0;
+
+    if (pps->pps_rect_slice_flag) {
+        int slice_idx = rsh->sh_slice_address;
+        for (int i = 0; i < rsh->curr_subpic_idx; i++)
+            slice_idx += pps->num_slices_in_subpic[i];
+        num_entry_points = (pps->pps_slice_width_in_tiles_minus1[slice_idx] + 1) *
+            (entropy_sync ? pps->slice_height_in_ctus[slice_idx] : pps->pps_slice_height_in_tiles_minus1[slice_idx] + 1);
+    } else {
+        for (int tile_idx = rsh->sh_slice_address;
+             tile_idx <= rsh->sh_slice_address + rsh->sh_num_tiles_in_slice_minus1; tile_idx++)
+            num_entry_points += entropy_sync ? pps->row_height_val[tile_idx / pps->num_tile_rows] : 1;
+    }
+    num_entry_points--;
+    if (num_entry_points > VVC_MAX_ENTRY_POINTS)
+        return AVERROR_PATCHWELCOME;
+    rsh->num_entry_points = num_entry_points;
+
+    return 0;
+}
+
+static int sh_read_chroma_qp_offset(GetBitContext *gb, int8_t *offset, const int pps_offset)
+{
+    const int off = sh_read_se(gb);
+
+    if (off < -12 || off > 12 || pps_offset + off < -12 || pps_offset + off > 12)
+        return AVERROR_INVALIDDATA;
+    *offset = off;
+    return 0;
+}
+
+static int sh_read_db_offset(GetBitContext *gb, int8_t *offset)
+{
+    const int off = sh_read_se(gb);
+
+    if (off < -12 || off > 12)
+        return AVERROR_INVALIDDATA;
+    *offset = off;
+    return 0;
+}
+
+// 7.3.7 Slice header syntax, for the slice headers without the less common parts
+int ff_vvc_read_sh(H266RawSliceHeader *rsh, size_t *header_size,
+    const VVCFrameParamSets *fps, const uint8_t *data, const size_t size)
+{
+    const H266RawSPS *sps          = fps->sps->r;
+    const H266RawPPS *pps          = fps->pps->r;
+    const H266RawPictureHeader *ph = fps->ph.r;
+    const H266RefPicLists *rpls    = &ph->ph_ref_pic_lists;
+    int nal_unit_type, qp_bd_offset, init_qp, max, ret;
+    GetBitContext gb;
+
+    ret = init_get_bits8(&gb, data, size);
+    if (ret < 0)
+        return ret;
+
+    memset(&rsh->sh_subpic_id, 0, offsetof(H266RawSliceHeader, sh_entry_offset_len_minus1) -
+        offsetof(H266RawSliceHeader, sh_subpic_id));
+
+    if (get_bits1(&gb))                                                     // forbidden_zero_bit
+        return AVERROR_INVALIDDATA;
+    rsh->nal_unit_header.nuh_reserved_zero_bit = get_bits1(&gb);
+    rsh->nal_unit_header.nuh_layer_id          = get_bits(&gb, 6);
+    rsh->nal_unit_header.nal_unit_type         = nal_unit_type = get_bits(&gb, 5);
+    rsh->nal_unit_header.nuh_temporal_id_plus1 = get_bits(&gb, 3);
+    if (!rsh->nal_unit_header.nuh_temporal_id_plus1)
+        return AVERROR_INVALIDDATA;
+
+    // the picture header in the slice header is left to CBS
+    rsh->sh_picture_header_in_slice_header_flag = get_bits1(&gb);
+    if (rsh->sh_picture_header_in_slice_header_flag)
+        return AVERROR(EAGAIN);
+
+    if (sps->sps_subpic_info_present_flag) {
+        int i;
+        rsh->sh_subpic_id = get_bits(&gb, sps->sps_subpic_id_len_minus1 + 1);
+        for (i = 0; i <= sps->sps_num_subpics_minus1; i++) {
+            if (pps->sub_pic_id_val[i] == rsh->sh_subpic_id)
+                break;
+        }
+        if (i > sps->sps_num_subpics_minus1)
+            return AVERROR_INVALIDDATA;
+        rsh->curr_subpic_idx = i;
+    } else {
+        rsh->curr_subpic_idx = 0;
+    }
+
+    max = pps->pps_rect_slice_flag ? pps->num_slices_in_subpic[rsh->curr_subpic_idx] : pps->num_tiles_in_pic;
+    if (max > 1) {
+        rsh->sh_slice_address = get_bits(&gb, av_ceil_log2(max));
+        if (rsh->sh_slice_address >= max)
+            return AVERROR_INVALIDDATA;
+    }
+
+    for (int i = 0; i < sps->sps_num_extra_sh_bytes * 8; i++) {
+        if (sps->sps_extra_sh_bit_present_flag[i])
+            rsh->sh_extra_bit[i] = get_bits1(&gb);
+    }
+
+    if (!pps->pps_rect_slice_flag && pps->num_tiles_in_pic - rsh->sh_slice_address > 1) {
+        const unsigned num_tiles_minus1 = sh_read_ue(&gb);
+        if (num_tiles_minus1 > pps->num_tiles_in_pic - 1)
+            return AVERROR_INVALIDDATA;
+        rsh->sh_num_tiles_in_slice_minus1 = num_tiles_minus1;
+    }
+
+    rsh->sh_slice_type = VVC_SLICE_TYPE_I;
+    if (ph->ph_inter_slice_allowed_flag) {
+        const unsigned slice_type = sh_read_ue(&gb);
+        if (slice_type > VVC_SLICE_TYPE_I)
+            return AVERROR_INVALIDDATA;
+        rsh->sh_slice_type = slice_type;
+    }
+
+    if (nal_unit_type == VVC_IDR_W_RADL || nal_unit_type == VVC_IDR_N_LP ||
+        nal_unit_type == VVC_CRA_NUT || nal_unit_type == VVC_GDR_NUT)
+        rsh->sh_no_output_of_prior_pics_flag = get_bits1(&gb);
+
+    if (sps->sps_alf_enabled_flag) {
+        if (!pps->pps_alf_info_in_ph_flag) {
+            rsh->sh_alf_enabled_flag = get_bits1(&gb);
+            if (rsh->sh_alf_enabled_flag) {
+                rsh->sh_num_alf_aps_ids_luma = get_bits(&gb, 3);
+                for (int i = 0; i < rsh->sh_num_alf_aps_ids_luma; i++)
+                    rsh->sh_alf_aps_id_luma[i] = get_bits(&gb, 3);
+                if (sps->sps_chroma_format_idc) {
+                    rsh->sh_alf_cb_enabled_flag = get_bits1(&gb);
+                    rsh->sh_alf_cr_enabled_flag = get_bits1(&gb);
+                }
+                if (rsh->sh_alf_cb_enabled_flag || rsh->sh_alf_cr_enabled_flag)
+                    rsh->sh_alf_aps_id_chroma = get_bits(&gb, 3);
+                if (sps->sps_ccalf_enabled_flag) {
+                    rsh->sh_alf_cc_cb_enabled_flag = get_bits1(&gb);
+                    if (rsh->sh_alf_cc_cb_enabled_flag)
+                        rsh->sh_alf_cc_cb_aps_id = get_bits(&gb, 3);
+                    rsh->sh_alf_cc_cr_enabled_flag = get_bits1(&gb);
+                    if (rsh->sh_alf_cc_cr_enabled_flag)
+                        rsh->sh_alf_cc_cr_aps_id = get_bits(&gb, 3);
+                }
+            }
+        } else {
+            rsh->sh_alf_enabled_flag = ph->ph_alf_enabled_flag;
+            if (rsh->sh_alf_enabled_flag) {
+                rsh->sh_num_alf_aps_ids_luma = ph->ph_num_alf_aps_ids_luma;
+                memcpy(rsh->sh_alf_aps_id_luma, ph->ph_alf_aps_id_luma, rsh->sh_num_alf_aps_ids_luma);
+                rsh->sh_alf_cb_enabled_flag = ph->ph_alf_cb_enabled_flag;
+                rsh->sh_alf_cr_enabled_flag = ph->ph_alf_cr_enabled_flag;
+                if (rsh->sh_alf_cb_enabled_flag || rsh->sh_alf_cr_enabled_flag)
+                    rsh->sh_alf_aps_id_chroma = ph->ph_alf_aps_id_chroma;
+                if (sps->sps_ccalf_enabled_flag) {
+                    rsh->sh_alf_cc_cb_enabled_flag = ph->ph_alf_cc_cb_enabled_flag;
+                    if (rsh->sh_alf_cc_cb_enabled_flag)
+                        rsh->sh_alf_cc_cb_aps_id = ph->ph_alf_cc_cb_aps_id;
+                    rsh->sh_alf_cc_cr_enabled_flag = ph->ph_alf_cc_cr_enabled_flag;
+                    if (rsh->sh_alf_cc_cr_enabled_flag)
+                        rsh->sh_alf_cc_cr_aps_id = ph->ph_alf_cc_cr_aps_id;
+                }
+            }
+        }
+    }
+
+    if (ph->ph_lmcs_enabled_flag)
+        rsh->sh_lmcs_used_flag = get_bits1(&gb);
+    if (ph->ph_explicit_scaling_list_enabled_flag)
+        rsh->sh_explicit_scaling_list_used_flag = get_bits1(&gb);
+
+    if (!pps->pps_rpl_info_in_ph_flag &&
+        ((nal_unit_type != VVC_IDR_W_RADL && nal_unit_type != VVC_IDR_N_LP) || sps->sps_idr_rpl_present_flag)) {
+        ret = sh_read_ref_pic_lists(&gb, &rsh->sh_ref_pic_lists, sps, pps);
+        if (ret < 0)
+            return ret;
+        rpls = &rsh->sh_ref_pic_lists;
+    }
+
+    if ((rsh->sh_slice_type != VVC_SLICE_TYPE_I && rpls->rpl_ref_list[0].num_ref_entries > 1) ||
+        (rsh->sh_slice_type == VVC_SLICE_TYPE_B && rpls->rpl_ref_list[1].num_ref_entries > 1)) {
+        rsh->sh_num_ref_idx_active_override_flag = get_bits1(&gb);
+        if (rsh->sh_num_ref_idx_active_override_flag) {
+            for (int i = 0; i < (rsh->sh_slice_type == VVC_SLICE_TYPE_B ? 2 : 1); i++) {
+                if (rpls->rpl_ref_list[i].num_ref_entries > 1) {
+                    const unsigned num_ref_idx_active_minus1 = sh_read_ue(&gb);
+                    if (num_ref_idx_active_minus1 > 14)
+                        return AVERROR_INVALIDDATA;
+                    rsh->sh_num_ref_idx_active_minus1[i] = num_ref_idx_active_minus1;
+                }
+            }
+        }
+    } else {
+        rsh->sh_num_ref_idx_active_override_flag = 1;
+    }
+
+    for (int i = 0; i < 2; i++) {
+        if (rsh->sh_slice_type == VVC_SLICE_TYPE_B || (rsh->sh_slice_type == VVC_SLICE_TYPE_P && !i)) {
+            if (rsh->sh_num_ref_idx_active_override_flag)
+                rsh->num_ref_idx_active[i] = rsh->sh_num_ref_idx_active_minus1[i] + 1;
+            else
+                rsh->num_ref_idx_active[i] = FFMIN(rpls->rpl_ref_list[i].num_ref_entries,
+                    pps->pps_num_ref_idx_default_active_minus1[i] + 1);
+        } else {
+            rsh->num_ref_idx_active[i] = 0;
+        }
+    }
+
+    if (rsh->sh_slice_type != VVC_SLICE_TYPE_I) {
+        if (pps->pps_cabac_init_present_flag)
+            rsh->sh_cabac_init_flag = get_bits1(&gb);
+        if (ph->ph_temporal_mvp_enabled_flag) {
+            if (!pps->pps_rpl_info_in_ph_flag) {
+                rsh->sh_collocated_from_l0_flag = 1;
+                if (rsh->sh_slice_type == VVC_SLICE_TYPE_B)
+                    rsh->sh_collocated_from_l0_flag = get_bits1(&gb);
+                max = rsh->num_ref_idx_active[!rsh->sh_collocated_from_l0_flag];
+                if (max > 1) {
+                    const unsigned collocated_ref_idx = sh_read_ue(&gb);
+                    if (collocated_ref_idx > max - 1)
+                        return AVERROR_INVALIDDATA;
+                    rsh->sh_collocated_ref_idx = collocated_ref_idx;
+                }
+            } else {
+                rsh->sh_collocated_from_l0_flag = rsh->sh_slice_type == VVC_SLICE_TYPE_B ?
+                    ph->ph_collocated_from_l0_flag : 1;
+                rsh->sh_collocated_ref_idx = ph->ph_collocated_ref_idx;
+            }
+        }
+        // a pred_weight_table() in the slice header is left to CBS
+        if (!pps->pps_wp_info_in_ph_flag &&
+            ((pps->pps_weighted_pred_flag && rsh->sh_slice_type == VVC_SLICE_TYPE_P) ||
+             (pps->pps_weighted_bipred_flag && rsh->sh_slice_type == VVC_SLICE_TYPE_B)))
+            return AVERROR(EAGAIN);
+    }
+
+    qp_bd_offset = 6 * sps->sps_bitdepth_minus8;
+    init_qp      = 26 + pps->pps_init_qp_minus26;
+    if (!pps->pps_qp_delta_info_in_ph_flag) {
+        const int qp_delta = sh_read_se(&gb);
+        if (qp_delta < -qp_bd_offset - init_qp || qp_delta > 63 - init_qp)
+            return AVERROR_INVALIDDATA;
+        rsh->sh_qp_delta = qp_delta;
+    }
+    if (pps->pps_slice_chroma_qp_offsets_present_flag) {
+        ret = sh_read_chroma_qp_offset(&gb, &rsh->sh_cb_qp_offset, pps->pps_cb_qp_offset);
+        if (ret < 0)
+            return ret;
+        ret = sh_read_chroma_qp_offset(&gb, &rsh->sh_cr_qp_offset, pps->pps_cr_qp_offset);
+        if (ret < 0)
+            return ret;
+        if (sps->sps_joint_cbcr_enabled_flag) {
+            ret = sh_read_chroma_qp_offset(&gb, &rsh->sh_joint_cbcr_qp_offset, pps->pps_joint_cbcr_qp_offset_value);
+            if (ret < 0)
+                return ret;
+        }
+    }
+    if (pps->pps_cu_chroma_qp_offset_list_enabled_flag)
+        rsh->sh_cu_chroma_qp_offset_enabled_flag = get_bits1(&gb);
+
+    if (sps->sps_sao_enabled_flag && !pps->pps_sao_info_in_ph_flag) {
+        rsh->sh_sao_luma_used_flag   = get_bits1(&gb);
+        rsh->sh_sao_chroma_used_flag = sps->sps_chroma_format_idc ? get_bits1(&gb) : ph->ph_sao_chroma_enabled_flag;
+    } else {
+        rsh->sh_sao_luma_used_flag   = ph->ph_sao_luma_enabled_flag;
+        rsh->sh_sao_chroma_used_flag = ph->ph_sao_chroma_enabled_flag;
+    }
+
+    if (pps->pps_deblocking_filter_override_enabled_flag && !pps->pps_dbf_info_in_ph_flag)
+        rsh->sh_deblocking_params_present_flag = get_bits1(&gb);
+    if (rsh->sh_deblocking_params_present_flag) {
+        if (!pps->pps_deblocking_filter_disabled_flag)
+            rsh->sh_deblocking_filter_disabled_flag = get_bits1(&gb);
+        if (!rsh->sh_deblocking_filter_disabled_flag) {
+            if ((ret = sh_read_db_offset(&gb, &rsh->sh_luma_beta_offset_div2)) < 0 ||
+                (ret = sh_read_db_offset(&gb, &rsh->sh_luma_tc_offset_div2)) < 0)
+                return ret;
+            if (pps->pps_chroma_tool_offsets_present_flag) {
+                if ((ret = sh_read_db_offset(&gb, &rsh->sh_cb_beta_offset_div2)) < 0 ||
+                    (ret = sh_read_db_offset(&gb, &rsh->sh_cb_tc_offset_div2)) < 0 ||
+                    (ret = sh_read_db_offset(&gb, &rsh->sh_cr_beta_offset_div2)) < 0 ||
+                    (ret = sh_read_db_offset(&gb, &rsh->sh_cr_tc_offset_div2)) < 0)
+                    return ret;
+            } else {
+                rsh->sh_cb_beta_offset_div2 = rsh->sh_cr_beta_offset_div2 = rsh->sh_luma_beta_offset_div2;
+                rsh->sh_cb_tc_offset_div2   = rsh->sh_cr_tc_offset_div2   = rsh->sh_luma_tc_offset_div2;
+            }
+        }
+    } else {
+        rsh->sh_deblocking_filter_disabled_flag = ph->ph_deblocking_filter_disabled_flag;
+        if (!rsh->sh_deblocking_filter_disabled_flag) {
+            rsh->sh_luma_beta_offset_div2 = ph->ph_luma_beta_offset_div2;
+            rsh->sh_luma_tc_offset_div2   = ph->ph_luma_tc_offset_div2;
+            rsh->sh_cb_beta_offset_div2   = ph->ph_cb_beta_offset_div2;
+            rsh->sh_cb_tc_offset_div2     = ph->ph_cb_tc_offset_div2;
+            rsh->sh_cr_beta_offset_div2   = ph->ph_cr_beta_offset_div2;
+            rsh->sh_cr_tc_offset_div2     = ph->ph_cr_tc_offset_div2;
+        }
+    }
+
+    if (sps->sps_dep_quant_enabled_flag)
+        rsh->sh_dep_quant_used_flag = get_bits1(&gb);
+    if (sps->sps_sign_data_hiding_enabled_flag && !rsh->sh_dep_quant_used_flag)
+        rsh->sh_sign_data_hiding_used_flag = get_bits1(&gb);
+    if (sps->sps_transform_skip_enabled_flag && !rsh->sh_dep_quant_used_flag && !rsh->sh_sign_data_hiding_used_flag)
+        rsh->sh_ts_residual_coding_disabled_flag = get_bits1(&gb);
+    if (!rsh->sh_ts_residual_coding_disabled_flag && sps->sps_ts_residual_coding_rice_present_in_sh_flag)
+        rsh->sh_ts_residual_coding_rice_idx_minus1 = get_bits(&gb, 3);
+    if (sps->sps_reverse_last_sig_coeff_enabled_flag)
+        rsh->sh_reverse_last_sig_coeff_flag = get_bits1(&gb);
+
+    // the slice header extension is left to CBS
+    if (pps->pps_slice_header_extension_present_flag)
+        return AVERROR(EAGAIN);
+
+    rsh->num_entry_points           = 0;
+    rsh->sh_entry_offset_len_minus1 = 0;
+    if (sps->sps_entry_point_offsets_present_flag) {
+        ret = sh_read_num_entry_points(rsh, sps, pps);
+        if (ret < 0)
+            return ret;
+        if (rsh->num_entry_points > 0) {
+            const unsigned offset_len_minus1 = sh_read_ue(&gb);
+            if (offset_len_minus1 > 31)
+                return AVERROR_INVALIDDATA;
+            rsh->sh_entry_offset_len_minus1 = offset_len_minus1;
+            for (int i = 0; i < rsh->num_entry_points; i++)
+                rsh->sh_entry_point_offset_minus1[i] = get_bits_long(&gb, offset_len_minus1 + 1);
+        }
+    }
+
+    // byte_alignment()
+    if (!get_bits1(&gb))
+        return AVERROR_INVALIDDATA;
+    while (get_bits_count(&gb) & 7) {
+        if (get_bits1(&gb))
+            return AVERROR_INVALIDDATA;
+    }
+
+    // the slice data can't be empty
+    if (get_bits_left(&gb) <= 0)
+        return AVERROR_INVALIDDATA;
+    *header_size = get_bits_count(&gb) >> 3;
+
+    return 0;
+}
+
+int ff_vvc_decode_sh(VVCSH *sh, const VVCFrameParamSets *fps, const H266RawSliceHeader *rsh)
 {
     int ret;
 
     if (!fps->sps || !fps->pps)
         return AVERROR_INVALIDDATA;
 
-    ff_refstruct_replace(&sh->r, unit->content_ref);
+    ff_refstruct_replace(&sh->r, rsh);
 
     ret = sh_derive(sh, fps);
     if (ret < 0)
@@ -82,6 +82,7 @@ typedef struct VVCSPS {
     uint8_t     log2_parallel_merge_level;                          ///< sps_log2_parallel_merge_level_minus2 + 2;
     uint8_t     log2_transform_range;                               ///< Log2TransformRange
     int8_t      chroma_qp_table[3][VVC_MAX_POINTS_IN_QP_TABLE];     ///< ChromaQpTable
+    uint8_t     intra_only;                                         ///< no slice is inter predicted, no reference is kept
 } VVCSPS;
 
 typedef struct DBParams {
@@ -180,6 +181,18 @@ typedef struct VVCALF {
     int16_t cc_coeff[2][ALF_NUM_FILTERS_CC][ALF_NUM_COEFF_CC];
 } VVCALF;
 
+#define ALF_NUM_FIXED_FILTER_SETS 16
+#define ALF_NUM_TRANSPOSES       4
+
+/**
+ * The coefficients and clipping values of the luma filters of a filter set,
+ * for each class and transposeIdx, in the order the filter applies them.
+ */
+typedef struct VVCALFLumaFilters {
+    int16_t coeff[ALF_NUM_FILTERS_LUMA][ALF_NUM_TRANSPOSES][ALF_NUM_COEFF_LUMA];
+    int16_t clip [ALF_NUM_FILTERS_LUMA][ALF_NUM_TRANSPOSES][ALF_NUM_COEFF_LUMA];
+} VVCALFLumaFilters;
+
 enum {
   SL_START_2x2    = 0,
   SL_START_4x4    = 2,
@@ -221,8 +234,18 @@ typedef struct VVCParamSets {
     const H266RawAPS        *lmcs_list[VVC_MAX_LMCS_COUNT];     ///< RefStruct reference
     const VVCScalingList    *scaling_list[VVC_MAX_SL_COUNT];    ///< RefStruct reference
 
+    // The last re-sent copies of sps_list[i]->r and pps_list[i]->r, found by their pointers
+    // until the parameter sets are sent again
+    const H266RawSPS        *sps_resent[VVC_MAX_SPS_COUNT];     ///< RefStruct reference
+    const H266RawPPS        *pps_resent[VVC_MAX_PPS_COUNT];     ///< RefStruct reference
+
     // Bit field of SPS IDs used in the current CVS
     uint16_t                 sps_id_used;
+
+    // The payloads of the last APS of each type and ID, a resend of the same payload keeps
+    // the derived data and its pointer
+    uint8_t                 *aps_data[VVC_ASP_TYPE_SCALING + 1][VVC_MAX_ALF_COUNT];
+    size_t                   aps_size[VVC_ASP_TYPE_SCALING + 1][VVC_MAX_ALF_COUNT];
 } VVCParamSets;
 
 typedef struct VVCFrameParamSets {
@@ -230,7 +253,15 @@ typedef struct VVCFrameParamSets {
     const VVCPPS           *pps;                                ///< RefStruct reference
     VVCPH                   ph;
     const VVCALF           *alf_list[VVC_MAX_ALF_COUNT];        ///< RefStruct reference
+
+    // the luma filters of alf_list and of the fixed filter sets, derived again only when they change
+    VVCALFLumaFilters       alf_luma[VVC_MAX_ALF_COUNT];
+    VVCALFLumaFilters       alf_fixed[ALF_NUM_FIXED_FILTER_SETS];
+    int                     alf_bit_depth;                      ///< the bit depth the filters are derived for
+
     VVCLMCS                 lmcs;
+    const H266RawAPS       *lmcs_aps;                           ///< RefStruct reference, the APS lmcs is derived from
+    int                     lmcs_bit_depth;                     ///< the bit depth lmcs is derived for
     const VVCScalingList   *sl;                                 ///< RefStruct reference
 } VVCFrameParamSets;
 
@@ -268,7 +299,14 @@ struct VVCContext;
 
 int ff_vvc_decode_frame_ps(VVCFrameParamSets *fps, struct VVCContext *s);
 int ff_vvc_decode_aps(VVCParamSets *ps, const CodedBitstreamUnit *unit);
-int ff_vvc_decode_sh(VVCSH *sh, const VVCFrameParamSets *ps, const CodedBitstreamUnit *unit);
+/**
+ * Read the slice header at data into rsh without CBS, AVERROR(EAGAIN) is returned for
+ * the syntax it leaves to CBS: the picture header in the slice header, ref_pic_list_struct()
+ * and pred_weight_table() in the slice header and the slice header extension.
+ */
+int ff_vvc_read_sh(H266RawSliceHeader *rsh, size_t *header_size,
+    const VVCFrameParamSets *ps, const uint8_t *data, size_t size);
+int ff_vvc_decode_sh(VVCSH *sh, const VVCFrameParamSets *ps, const H266RawSliceHeader *rsh);
 void ff_vvc_frame_ps_free(VVCFrameParamSets *fps);
 void ff_vvc_ps_uninit(VVCParamSets *ps);
 
@@ -22,11 +22,15 @@
 
 #include <stdatomic.h>
 
+#include "libavutil/imgutils.h"
 #include "libavutil/mem.h"
 #include "libavutil/thread.h"
+#include "libavcodec/decode.h"
 #include "libavcodec/refstruct.h"
 #include "libavcodec/thread.h"
 
+#include "ctu.h"
+#include "inter.h"
 #include "refs.h"
 
 #define VVC_FRAME_FLAG_OUTPUT    (1 << 0)
@@ -36,7 +40,18 @@
 
 typedef struct FrameProgress {
     atomic_int progress[VVC_PROGRESS_LAST];
-    VVCProgressListener *listener[VVC_PROGRESS_LAST];
+
+    // the columns left of partial_x are final up to partial_y
+    int partial_y[VVC_PROGRESS_LAST];
+    int partial_x[VVC_PROGRESS_LAST];
+
+    // listeners bucketed by the ctu row of their y, the last row also takes all below the picture
+    VVCProgressListener **listener[VVC_PROGRESS_LAST];
+    int first_row[VVC_PROGRESS_LAST];   ///< the rows above are done and have no listener
+    int nb_rows;
+    int ctb_log2_size;
+    atomic_int padded;                  ///< the guard bands are filled, see ff_vvc_pad_frame()
+    atomic_int concealed;               ///< some ctus were concealed, see ff_vvc_report_concealed()
     AVMutex lock;
     AVCond  cond;
     uint8_t has_lock;
@@ -52,11 +67,16 @@ void ff_vvc_unref_frame(VVCFrameContext *fc, VVCFrame *frame, int flags)
     frame->flags &= ~flags;
     if (!frame->flags) {
         av_frame_unref(frame->frame);
+        av_frame_unref(frame->output);
         ff_refstruct_unref(&frame->sps);
         ff_refstruct_unref(&frame->pps);
         ff_refstruct_unref(&frame->progress);
+        ff_refstruct_unref(&frame->rpr_cache);
+        ff_refstruct_unref(&frame->hwaccel_picture_private);
+        ff_refstruct_unref(&frame->stage_stats);
 
         ff_refstruct_unref(&frame->tab_dmvr_mvf);
+        ff_refstruct_unref(&frame->tab_col_mvf);
 
         ff_refstruct_unref(&frame->rpl);
         frame->nb_rpl_elems = 0;
@@ -73,6 +93,9 @@ const RefPicList *ff_vvc_get_ref_list(const VVCFrameContext *fc, const VVCFrame
     const int pic_width_cb = fc->ps.pps->ctb_width;
     const int ctb_addr_rs  = y_cb * pic_width_cb + x_cb;
 
+    // no reference lists in an intra only sequence
+    if (!ref->rpl_tab)
+        return NULL;
     return (const RefPicList *)ref->rpl_tab[ctb_addr_rs];
 }
 
@@ -97,13 +120,24 @@ static void free_progress(FFRefStructOpaque unused, void *obj)
         ff_cond_destroy(&p->cond);
     if (p->has_lock)
         ff_mutex_destroy(&p->lock);
+    for (int i = 0; i < VVC_PROGRESS_LAST; i++)
+        av_freep(&p->listener[i]);
 }
 
-static FrameProgress *alloc_progress(void)
+static FrameProgress *alloc_progress(const int ctb_log2_size, const int nb_rows)
 {
     FrameProgress *p = ff_refstruct_alloc_ext(sizeof(*p), 0, NULL, free_progress);
 
     if (p) {
+        p->ctb_log2_size = ctb_log2_size;
+        p->nb_rows       = nb_rows;
+        for (int i = 0; i < VVC_PROGRESS_LAST; i++) {
+            p->listener[i] = av_calloc(nb_rows, sizeof(*p->listener[i]));
+            if (!p->listener[i]) {
+                ff_refstruct_unref(&p);
+                return NULL;
+            }
+        }
         p->has_lock = !ff_mutex_init(&p->lock, NULL);
         p->has_cond = !ff_cond_init(&p->cond, NULL);
         if (!p->has_lock || !p->has_cond)
@@ -112,6 +146,71 @@ static FrameProgress *alloc_progress(void)
     return p;
 }
 
+// the planes of a picture that is never returned to the caller, from a pool of the decoder
+static int get_dpb_buffer(VVCContext *s, AVFrame *f)
+{
+    int linesize[4];
+    ptrdiff_t linesizes[4];
+    size_t sizes[4], size = 0;
+    uint8_t *data;
+    int ret;
+
+    ret = av_image_fill_linesizes(linesize, f->format, FFALIGN(f->width, 64));
+    if (ret < 0)
+        return ret;
+    for (int i = 0; i < 4; i++)
+        linesizes[i] = FFALIGN(linesize[i], 64);
+    ret = av_image_fill_plane_sizes(sizes, f->format, f->height, linesizes);
+    if (ret < 0)
+        return ret;
+    for (int i = 0; i < 4; i++)
+        size += FFALIGN(sizes[i], 64);
+
+    if (!s->dpb_pool || s->dpb_pool_size != size + 64) {
+        av_buffer_pool_uninit(&s->dpb_pool);
+        s->dpb_pool      = av_buffer_pool_init(size + 64, NULL);
+        s->dpb_pool_size = size + 64;
+        if (!s->dpb_pool)
+            return AVERROR(ENOMEM);
+    }
+    f->buf[0] = av_buffer_pool_get(s->dpb_pool);
+    if (!f->buf[0])
+        return AVERROR(ENOMEM);
+
+    data = (uint8_t *)FFALIGN((uintptr_t)f->buf[0]->data, 64);
+    for (int i = 0; i < 4 && sizes[i]; i++) {
+        f->data[i]     = data;
+        f->linesize[i] = linesizes[i];
+        data          += FFALIGN(sizes[i], 64);
+    }
+    f->extended_data = f->data;
+
+    return 0;
+}
+
+// the chroma planes of a gray decoded picture are never written
+static void fill_chroma_grey(const VVCFrame *frame)
+{
+    const VVCSPS *sps = frame->sps;
+    const AVFrame *f  = frame->frame;
+    const int w       = AV_CEIL_RSHIFT(f->width,  sps->hshift[CHROMA]);
+    const int h       = AV_CEIL_RSHIFT(f->height, sps->vshift[CHROMA]);
+    const int grey    = 1 << (sps->bit_depth - 1);
+
+    for (int c = CB; c <= CR; c++) {
+        for (int y = 0; y < h; y++) {
+            uint8_t *dst = f->data[c] + y * f->linesize[c];
+
+            if (sps->pixel_shift) {
+                for (int x = 0; x < w; x++)
+                    AV_WN16(dst + 2 * x, grey);
+            } else {
+                memset(dst, grey, w);
+            }
+        }
+    }
+}
+
 static VVCFrame *alloc_frame(VVCContext *s, VVCFrameContext *fc)
 {
     const VVCSPS *sps = fc->ps.sps;
@@ -126,18 +225,78 @@ static VVCFrame *alloc_frame(VVCContext *s, VVCFrameContext *fc)
         frame->sps = ff_refstruct_ref_c(fc->ps.sps);
         frame->pps = ff_refstruct_ref_c(fc->ps.pps);
 
-        ret = ff_thread_get_buffer(s->avctx, frame->frame, AV_GET_BUFFER_FLAG_REF);
-        if (ret < 0)
+        frame->padding = s->pad_refs && !s->parse_only && !s->avctx->hwaccel ? VVC_FRAME_PADDING : 0;
+        if (frame->padding) {
+            frame->frame->width  = pps->width  + 2 * frame->padding;
+            frame->frame->height = pps->height + 2 * frame->padding;
+        }
+
+        // a different output format (semi planar) or size (lowres) is converted to from the
+        // planar picture, ctu by ctu
+        frame->lowres = s->lowres;
+        if (!s->avctx->hwaccel && (s->avctx->pix_fmt != sps->pix_fmt || frame->lowres)) {
+            AVFrame *f = frame->frame;
+
+            ret = ff_thread_get_buffer(s->avctx, frame->output, 0);
+            if (ret < 0)
+                return NULL;
+
+            f->format = sps->pix_fmt;
+            if (!frame->padding) {
+                f->width  = pps->width;
+                f->height = pps->height;
+            }
+            ret = get_dpb_buffer(s, f);
+        } else {
+            ret = ff_thread_get_buffer(s->avctx, frame->frame, AV_GET_BUFFER_FLAG_REF);
+        }
+        if (ret < 0) {
+            av_frame_unref(frame->output);
+            av_frame_unref(frame->frame);
             return NULL;
+        }
 
-        frame->rpl = ff_refstruct_allocz(s->current_frame.nb_units * sizeof(RefPicListTab));
+        // the pictures using horizontal wraparound are mostly referenced with it
+        frame->padding_wrap = frame->padding && pps->r->pps_ref_wraparound_enabled_flag ?
+            pps->ref_wraparound_offset << sps->min_cb_log2_size_y : 0;
+
+        if (frame->padding) {
+            AVFrame *f = frame->frame;
+            for (int c = 0; c < FF_ARRAY_ELEMS(f->data) && f->data[c]; c++)
+                f->data[c] += (frame->padding >> sps->vshift[c]) * f->linesize[c] +
+                    ((frame->padding >> sps->hshift[c]) << sps->pixel_shift);
+            f->width  = pps->width;
+            f->height = pps->height;
+        }
+
+        if (fc->gray)
+            fill_chroma_grey(frame);
+
+        // pool entries may be larger than this picture needs, only clear the used part;
+        // the pictures of an intra only sequence have no reference lists nor motion
+        if (sps->intra_only) {
+            frame->nb_rpl_elems = 0;
+            goto intra_only;
+        }
+
+        frame->rpl = ff_refstruct_pool_get(fc->rpl_pool);
         if (!frame->rpl)
             goto fail;
         frame->nb_rpl_elems = s->current_frame.nb_units;
+        memset(frame->rpl, 0, frame->nb_rpl_elems * sizeof(*frame->rpl));
 
         frame->tab_dmvr_mvf = ff_refstruct_pool_get(fc->tab_dmvr_mvf_pool);
         if (!frame->tab_dmvr_mvf)
             goto fail;
+        memset(frame->tab_dmvr_mvf, 0, pps->min_pu_width * pps->min_pu_height * sizeof(*frame->tab_dmvr_mvf));
+
+        if (sps->r->sps_temporal_mvp_enabled_flag) {
+            frame->tab_col_mvf = ff_refstruct_pool_get(fc->tab_col_mvf_pool);
+            if (!frame->tab_col_mvf)
+                goto fail;
+            memset(frame->tab_col_mvf, 0, AV_CEIL_RSHIFT(pps->width, COL_MV_LOG2) *
+                AV_CEIL_RSHIFT(pps->height, COL_MV_LOG2) * sizeof(*frame->tab_col_mvf));
+        }
 
         frame->rpl_tab = ff_refstruct_pool_get(fc->rpl_tab_pool);
         if (!frame->rpl_tab)
@@ -146,6 +305,7 @@ static VVCFrame *alloc_frame(VVCContext *s, VVCFrameContext *fc)
         for (int j = 0; j < frame->ctb_count; j++)
             frame->rpl_tab[j] = frame->rpl;
 
+intra_only:
         win->left_offset   = pps->r->pps_scaling_win_left_offset   << sps->hshift[CHROMA];
         win->right_offset  = pps->r->pps_scaling_win_right_offset  << sps->hshift[CHROMA];
         win->top_offset    = pps->r->pps_scaling_win_top_offset    << sps->vshift[CHROMA];
@@ -153,10 +313,20 @@ static VVCFrame *alloc_frame(VVCContext *s, VVCFrameContext *fc)
         frame->ref_width   = pps->r->pps_pic_width_in_luma_samples  - win->left_offset   - win->right_offset;
         frame->ref_height  = pps->r->pps_pic_height_in_luma_samples - win->bottom_offset - win->top_offset;
 
-        frame->progress = alloc_progress();
+        frame->progress = alloc_progress(sps->ctb_log2_size_y, pps->ctb_height);
         if (!frame->progress)
             goto fail;
 
+        ret = ff_hwaccel_frame_priv_alloc(s->avctx, &frame->hwaccel_picture_private);
+        if (ret < 0)
+            goto fail;
+
+        if (s->rpr_cache && !s->parse_only && !s->avctx->hwaccel) {
+            frame->rpr_cache = ff_vvc_rpr_cache_alloc();
+            if (!frame->rpr_cache)
+                goto fail;
+        }
+
         return frame;
 fail:
         ff_vvc_unref_frame(fc, frame, ~0);
@@ -204,11 +374,23 @@ int ff_vvc_set_new_ref(VVCContext *s, VVCFrameContext *fc, AVFrame **frame)
     ref->frame->crop_right  = fc->ps.pps->r->pps_conf_win_right_offset << fc->ps.sps->hshift[CHROMA];
     ref->frame->crop_top    = fc->ps.pps->r->pps_conf_win_top_offset << fc->ps.sps->vshift[CHROMA];
     ref->frame->crop_bottom = fc->ps.pps->r->pps_conf_win_bottom_offset << fc->ps.sps->vshift[CHROMA];
+    if (ref->output->buf[0]) {
+        AVFrame *out = ref->output;
+        const int l  = ref->lowres;
+
+        out->crop_left   = ref->frame->crop_left >> l;
+        out->crop_top    = ref->frame->crop_top  >> l;
+        out->crop_right  = FFMAX(0, out->width  - (int)out->crop_left - AV_CEIL_RSHIFT(ref->frame->width -
+            (int)(ref->frame->crop_left + ref->frame->crop_right), l));
+        out->crop_bottom = FFMAX(0, out->height - (int)out->crop_top  - AV_CEIL_RSHIFT(ref->frame->height -
+            (int)(ref->frame->crop_top + ref->frame->crop_bottom), l));
+    }
 
     return 0;
 }
 
-int ff_vvc_output_frame(VVCContext *s, VVCFrameContext *fc, AVFrame *out, const int no_output_of_prior_pics_flag, int flush)
+int ff_vvc_output_frame(VVCContext *s, VVCFrameContext *fc, AVFrame *out, FrameProgress **progress,
+    const int no_output_of_prior_pics_flag, int flush)
 {
     const VVCSPS *sps = fc->ps.sps;
     do {
@@ -240,13 +422,17 @@ int ff_vvc_output_frame(VVCContext *s, VVCFrameContext *fc, AVFrame *out, const
 
         /* wait for more frames before output */
         if (!flush && s->seq_output == s->seq_decode && sps &&
-            nb_output <= sps->r->sps_dpb_params.dpb_max_num_reorder_pics[sps->r->sps_max_sublayers_minus1])
+            nb_output <= sps->r->sps_dpb_params.dpb_max_num_reorder_pics[ff_vvc_highest_tid(s, sps)])
             return 0;
 
         if (nb_output) {
             VVCFrame *frame = &fc->DPB[min_idx];
 
-            ret = av_frame_ref(out, frame->frame);
+            ret = av_frame_ref(out, frame->output->buf[0] ? frame->output : frame->frame);
+            if (progress) {
+                ff_refstruct_replace(progress, frame->progress);
+                ff_refstruct_replace(&fc->output_stats, frame->stage_stats);
+            }
             if (frame->flags & VVC_FRAME_FLAG_BUMPING)
                 ff_vvc_unref_frame(fc, frame, VVC_FRAME_FLAG_OUTPUT | VVC_FRAME_FLAG_BUMPING);
             else
@@ -283,7 +469,7 @@ void ff_vvc_bump_frame(VVCContext *s, VVCFrameContext *fc)
         }
     }
 
-    if (sps && dpb >= sps->r->sps_dpb_params.dpb_max_dec_pic_buffering_minus1[sps->r->sps_max_sublayers_minus1] + 1) {
+    if (sps && dpb >= sps->r->sps_dpb_params.dpb_max_dec_pic_buffering_minus1[ff_vvc_highest_tid(s, sps)] + 1) {
         for (int i = 0; i < FF_ARRAY_ELEMS(fc->DPB); i++) {
             VVCFrame *frame = &fc->DPB[i];
             if ((frame->flags) &&
@@ -357,6 +543,7 @@ static VVCFrame *generate_missing_ref(VVCContext *s, VVCFrameContext *fc, int po
     frame->sequence = s->seq_decode;
     frame->flags    = 0;
 
+    ff_vvc_pad_frame(frame);
     ff_vvc_report_frame_finished(frame);
 
     return frame;
@@ -532,6 +719,12 @@ int ff_vvc_frame_rpl(VVCContext *s, VVCFrameContext *fc, SliceContext *sc)
         mark_ref(frame, 0);
     }
 
+    // with no reference in the sequence, all the other frames are released
+    if (fc->ps.sps->intra_only) {
+        sc->rpl = NULL;
+        goto fail;
+    }
+
     if ((ret = ff_vvc_slice_rpl(s, fc, sc)) < 0)
         goto fail;
 
@@ -542,6 +735,81 @@ fail:
     return ret;
 }
 
+static void pad_samples(uint8_t *dst, const uint8_t *src, const int n, const int pixel_shift)
+{
+    if (!n)
+        return;
+    if (!pixel_shift) {
+        memset(dst, *src, n);
+    } else {
+        AV_COPY16(dst, src);
+        av_memcpy_backptr(dst + 2, 2, 2 * n - 2);
+    }
+}
+
+void ff_vvc_pad_frame(VVCFrame *frame)
+{
+    const VVCSPS *sps = frame->sps;
+    const VVCPPS *pps = frame->pps;
+    const AVFrame *f  = frame->frame;
+    const int ps      = sps->pixel_shift;
+
+    if (!frame->padding)
+        return;
+
+    for (int c = 0; c < (sps->r->sps_chroma_format_idc ? VVC_MAX_SAMPLE_ARRAYS : 1); c++) {
+        const int pad_x         = frame->padding >> sps->hshift[c];
+        const int wrap          = frame->padding_wrap >> sps->hshift[c];
+        const int pad_y         = frame->padding >> sps->vshift[c];
+        const int w             = pps->width  >> sps->hshift[c];
+        const int h             = pps->height >> sps->vshift[c];
+        const ptrdiff_t stride  = f->linesize[c];
+        const size_t row_bytes  = (w + 2 * pad_x) << ps;
+        uint8_t *first          = f->data[c] - (pad_x << ps);
+        uint8_t *last           = first + (h - 1) * stride;
+        uint8_t *row            = f->data[c];
+
+        for (int y = 0; y < h; y++, row += stride) {
+            uint8_t *left  = row - (pad_x << ps);
+            uint8_t *right = row + (w << ps);
+
+            if (wrap) {
+                // x < 0 is read at x + wrap and x >= w at x - wrap, both clipped to the picture,
+                // wrap is at most w
+                const int n = FFMIN(pad_x, wrap);
+                pad_samples(left, row, pad_x - n, ps);
+                memcpy(left + ((pad_x - n) << ps), row + ((wrap - n) << ps), n << ps);
+                memcpy(right, row + ((w - wrap) << ps), n << ps);
+                pad_samples(right + (n << ps), row + ((w - 1) << ps), pad_x - n, ps);
+            } else {
+                pad_samples(left, row, pad_x, ps);
+                pad_samples(right, row + ((w - 1) << ps), pad_x, ps);
+            }
+        }
+        for (int y = 1; y <= pad_y; y++) {
+            memcpy(first - y * stride, first, row_bytes);
+            memcpy(last  + y * stride, last,  row_bytes);
+        }
+    }
+
+    atomic_store(&frame->progress->padded, 1);
+}
+
+int ff_vvc_frame_padded(const VVCFrame *frame)
+{
+    return atomic_load(&frame->progress->padded);
+}
+
+void ff_vvc_report_concealed(VVCFrame *frame)
+{
+    atomic_store(&frame->progress->concealed, 1);
+}
+
+int ff_vvc_progress_concealed(const FrameProgress *progress)
+{
+    return atomic_load(&progress->concealed);
+}
+
 void ff_vvc_report_frame_finished(VVCFrame *frame)
 {
     ff_vvc_report_progress(frame, VVC_PROGRESS_MV, INT_MAX);
@@ -550,7 +818,8 @@ void ff_vvc_report_frame_finished(VVCFrame *frame)
 
 static int is_progress_done(const FrameProgress *p, const VVCProgressListener *l)
 {
-    return p->progress[l->vp] > l->y;
+    return p->progress[l->vp] > l->y ||
+        (p->partial_y[l->vp] > l->y && p->partial_x[l->vp] > l->x);
 }
 
 static void add_listener(VVCProgressListener **prev, VVCProgressListener *l)
@@ -566,22 +835,170 @@ static VVCProgressListener* remove_listener(VVCProgressListener **prev, VVCProgr
     return l;
 }
 
+static int listener_row(const FrameProgress *p, const int y)
+{
+    return av_clip(y >> p->ctb_log2_size, 0, p->nb_rows - 1);
+}
+
+// move the done listeners of the rows [start, end] to list
+static void get_done_rows(FrameProgress *p, const VVCProgress vp, const int start, const int end,
+    VVCProgressListener **list)
+{
+    for (int row = start; row <= end; row++) {
+        VVCProgressListener **prev = &p->listener[vp][row];
+
+        while (*prev) {
+            if (is_progress_done(p, *prev)) {
+                VVCProgressListener *l = remove_listener(prev, *prev);
+                add_listener(list, l);
+            } else {
+                prev = &(*prev)->next;
+            }
+        }
+    }
+}
+
+// the listeners the last report of full rows made ready
 static VVCProgressListener* get_done_listener(FrameProgress *p, const VVCProgress vp)
 {
     VVCProgressListener *list = NULL;
-    VVCProgressListener **prev = &p->listener[vp];
+    const int y = p->progress[vp];
+    const int done_rows = y == INT_MAX ? p->nb_rows : FFMIN(y >> p->ctb_log2_size, p->nb_rows - 1);
 
-    while (*prev) {
-        if (is_progress_done(p, *prev)) {
-            VVCProgressListener *l = remove_listener(prev, *prev);
+    // all the listeners of the rows above done_rows are ready
+    for (int row = p->first_row[vp]; row < done_rows; row++) {
+        VVCProgressListener *l = p->listener[vp][row];
+
+        while (l) {
+            VVCProgressListener *next = l->next;
             add_listener(&list, l);
-        } else {
-            prev = &(*prev)->next;
+            l = next;
         }
+        p->listener[vp][row] = NULL;
     }
+    p->first_row[vp] = FFMAX(p->first_row[vp], done_rows);
+
+    if (p->first_row[vp] < p->nb_rows)
+        get_done_rows(p, vp, p->first_row[vp], p->first_row[vp], &list);
+    return list;
+}
+
+// the listeners the last partial report made ready
+static VVCProgressListener* get_partial_done_listener(FrameProgress *p, const VVCProgress vp)
+{
+    VVCProgressListener *list = NULL;
+
+    if (p->partial_y[vp] > 0 && p->first_row[vp] < p->nb_rows)
+        get_done_rows(p, vp, p->first_row[vp], listener_row(p, p->partial_y[vp] - 1), &list);
     return list;
 }
 
+int ff_vvc_check_progress(const VVCFrame *frame, const VVCProgress vp, const int y)
+{
+    return atomic_load(&frame->progress->progress[vp]) > y;
+}
+
+// each output sample is the rounded mean of the 1 << lowres by 1 << lowres block it covers,
+// clipped to the picture
+static void output_ctu_lowres(const VVCFrame *frame, const int x0, const int y0, const int ctu_size)
+{
+    const VVCSPS *sps   = frame->sps;
+    const AVFrame *src  = frame->frame;
+    AVFrame *dst        = frame->output;
+    const int l         = frame->lowres;
+    const int ps        = sps->pixel_shift;
+    const int semi      = av_pix_fmt_count_planes(dst->format) == 2;
+    const int shift     = semi && ps ? 16 - sps->bit_depth : 0;
+    const int nb_planes = sps->r->sps_chroma_format_idc ? VVC_MAX_SAMPLE_ARRAYS : 1;
+
+    for (int c = 0; c < nb_planes; c++) {
+        const int hs     = sps->hshift[c];
+        const int vs     = sps->vshift[c];
+        const int sx0    = x0 >> hs;
+        const int sy0    = y0 >> vs;
+        const int sx1    = FFMIN((x0 + ctu_size) >> hs, AV_CEIL_RSHIFT(frame->pps->width,  hs));
+        const int sy1    = FFMIN((y0 + ctu_size) >> vs, AV_CEIL_RSHIFT(frame->pps->height, vs));
+        const int dp     = semi && c ? 1 : c;
+        const int dstep  = semi && c ? 2 : 1;
+        const int doff   = semi && c ? c - 1 : 0;
+
+        for (int dy = sy0 >> l; dy < AV_CEIL_RSHIFT(sy1, l); dy++) {
+            uint8_t *d = dst->data[dp] + dy * dst->linesize[dp];
+
+            for (int dx = sx0 >> l; dx < AV_CEIL_RSHIFT(sx1, l); dx++) {
+                const int bx1 = FFMIN((dx + 1) << l, sx1);
+                const int by1 = FFMIN((dy + 1) << l, sy1);
+                const int n   = (bx1 - (dx << l)) * (by1 - (dy << l));
+                int sum       = 0;
+
+                for (int y = dy << l; y < by1; y++) {
+                    const uint8_t *s = src->data[c] + y * src->linesize[c];
+                    for (int x = dx << l; x < bx1; x++)
+                        sum += ps ? AV_RN16(s + 2 * x) : s[x];
+                }
+                sum = (sum + (n >> 1)) / n;
+                if (ps)
+                    AV_WN16(d + ((dx * dstep + doff) << 1), sum << shift);
+                else
+                    d[dx * dstep + doff] = sum;
+            }
+        }
+    }
+}
+
+void ff_vvc_output_ctu(const VVCFrame *frame, const int x0, const int y0, const int ctu_size)
+{
+    const VVCSPS *sps   = frame->sps;
+    const AVFrame *src  = frame->frame;
+    AVFrame *dst        = frame->output;
+    const int ps        = sps->pixel_shift;
+    const int shift     = 16 - sps->bit_depth;
+    const int width     = FFMIN(ctu_size, frame->pps->width  - x0);
+    const int height    = FFMIN(ctu_size, frame->pps->height - y0);
+
+    if (frame->lowres) {
+        output_ctu_lowres(frame, x0, y0, ctu_size);
+        return;
+    }
+
+    for (int y = 0; y < height; y++) {
+        const uint8_t *s = src->data[LUMA] + (y0 + y) * src->linesize[LUMA] + (x0 << ps);
+        uint8_t *d       = dst->data[LUMA] + (y0 + y) * dst->linesize[LUMA] + (x0 << ps);
+
+        if (!ps) {
+            memcpy(d, s, width);
+        } else {
+            for (int x = 0; x < width; x++)
+                AV_WN16(d + 2 * x, AV_RN16(s + 2 * x) << shift);
+        }
+    }
+
+    for (int y = y0 >> sps->vshift[1]; y < (y0 + height) >> sps->vshift[1]; y++) {
+        const int cx0   = x0 >> sps->hshift[1];
+        const int w     = width >> sps->hshift[1];
+        const uint8_t *u = src->data[CB] + y * src->linesize[CB] + (cx0 << ps);
+        const uint8_t *v = src->data[CR] + y * src->linesize[CR] + (cx0 << ps);
+        uint8_t *d       = dst->data[1]  + y * dst->linesize[1]  + (cx0 << (ps + 1));
+
+        if (!ps) {
+            for (int x = 0; x < w; x++) {
+                d[2 * x]     = u[x];
+                d[2 * x + 1] = v[x];
+            }
+        } else {
+            for (int x = 0; x < w; x++) {
+                AV_WN16(d + 4 * x,     AV_RN16(u + 2 * x) << shift);
+                AV_WN16(d + 4 * x + 2, AV_RN16(v + 2 * x) << shift);
+            }
+        }
+    }
+}
+
+int ff_vvc_progress_finished(const FrameProgress *progress)
+{
+    return atomic_load(&progress->progress[VVC_PROGRESS_PIXEL]) == INT_MAX;
+}
+
 void ff_vvc_report_progress(VVCFrame *frame, const VVCProgress vp, const int y)
 {
     FrameProgress *p = frame->progress;
@@ -602,6 +1019,25 @@ void ff_vvc_report_progress(VVCFrame *frame, const VVCProgress vp, const int y)
     }
 }
 
+void ff_vvc_report_partial_progress(VVCFrame *frame, const VVCProgress vp, const int y, const int x)
+{
+    FrameProgress *p = frame->progress;
+    VVCProgressListener *l = NULL;
+
+    ff_mutex_lock(&p->lock);
+
+    p->partial_y[vp] = y;
+    p->partial_x[vp] = x;
+    l = get_partial_done_listener(p, vp);
+
+    ff_mutex_unlock(&p->lock);
+
+    while (l) {
+        l->progress_done(l);
+        l = l->next;
+    }
+}
+
 void ff_vvc_add_progress_listener(VVCFrame *frame, VVCProgressListener *l)
 {
     FrameProgress *p = frame->progress;
@@ -612,7 +1048,7 @@ void ff_vvc_add_progress_listener(VVCFrame *frame, VVCProgressListener *l)
         ff_mutex_unlock(&p->lock);
         l->progress_done(l);
     } else {
-        add_listener(p->listener + l->vp, l);
+        add_listener(&p->listener[l->vp][listener_row(p, l->y)], l);
         ff_mutex_unlock(&p->lock);
     }
 }
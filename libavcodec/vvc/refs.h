@@ -25,7 +25,15 @@
 
 #include "dec.h"
 
-int ff_vvc_output_frame(VVCContext *s, VVCFrameContext *fc, struct AVFrame *out, int no_output_of_prior_pics_flag, int flush);
+/**
+ * Bump the next frame for output into out.
+ * @param progress if not NULL, replaced by a RefStruct reference to the progress
+ *                 of the output frame, which may still be decoding in another frame context,
+ *                 and fc->output_stats by its stage stats
+ * @return 1 if a frame was output, 0 if none is due, a negative error code on failure
+ */
+int ff_vvc_output_frame(VVCContext *s, VVCFrameContext *fc, struct AVFrame *out, struct FrameProgress **progress,
+    int no_output_of_prior_pics_flag, int flush);
 void ff_vvc_bump_frame(VVCContext *s, VVCFrameContext *fc);
 int ff_vvc_set_new_ref(VVCContext *s, VVCFrameContext *fc, struct AVFrame **frame);
 const RefPicList *ff_vvc_get_ref_list(const VVCFrameContext *fc, const VVCFrame *ref, int x0, int y0);
@@ -35,6 +43,20 @@ void ff_vvc_unref_frame(VVCFrameContext *fc, VVCFrame *frame, int flags);
 void ff_vvc_clear_refs(VVCFrameContext *fc);
 void ff_vvc_flush_dpb(VVCFrameContext *fc);
 
+/**
+ * HighestTid, the index of the DPB parameters that apply to the decoded sublayers.
+ */
+static inline int ff_vvc_highest_tid(const VVCContext *s, const VVCSPS *sps)
+{
+    const H266RawSPS *r = sps->r;
+
+    // without sps_sublayer_dpb_params_flag, the parameters of the lower sublayers are
+    // inferred equal to those of the highest one
+    if (!r->sps_sublayer_dpb_params_flag)
+        return r->sps_max_sublayers_minus1;
+    return FFMIN(s->max_temporal_layer, r->sps_max_sublayers_minus1);
+}
+
 typedef enum VVCProgress {
     VVC_PROGRESS_MV,
     VVC_PROGRESS_PIXEL,
@@ -47,12 +69,64 @@ typedef void (*progress_done_fn)(VVCProgressListener *l);
 struct VVCProgressListener {
     VVCProgress vp;
     int y;
+    int x;                       ///< rightmost column needed, INT_MAX if the whole width is
     progress_done_fn progress_done;
     VVCProgressListener *next;   //used by ff_vvc_add_progress_listener only
 };
 
+// luma samples of guard band on each side of the pictures, a multiple of 64 keeps the planes aligned
+#define VVC_FRAME_PADDING 128
+
+/**
+ * Fill the guard bands of a fully decoded frame with its edge samples, so
+ * that motion compensation reads the blocks next to the picture in place.
+ * Called before the last progress is reported, does nothing for frames
+ * allocated without padding.
+ */
+void ff_vvc_pad_frame(VVCFrame *frame);
+
+/**
+ * Whether ff_vvc_pad_frame() has filled the guard bands of the frame.
+ */
+int ff_vvc_frame_padded(const VVCFrame *frame);
+
+/**
+ * Mark the frame as having concealed ctus, before its last progress is
+ * reported. The output frame may be referenced before, so the mark is kept
+ * with the progress and copied at its return, see ff_vvc_progress_concealed().
+ */
+void ff_vvc_report_concealed(VVCFrame *frame);
+
+/**
+ * Whether ctus of the finished frame owning the progress were concealed.
+ */
+int ff_vvc_progress_concealed(const struct FrameProgress *progress);
+
 void ff_vvc_report_frame_finished(VVCFrame *frame);
 void ff_vvc_report_progress(VVCFrame *frame, VVCProgress vp, int y);
+
+/**
+ * Report that the lines above y which are left of x are final too, past the
+ * lines reported by ff_vvc_report_progress().
+ */
+void ff_vvc_report_partial_progress(VVCFrame *frame, VVCProgress vp, int y, int x);
+
+/**
+ * Whether the lines up to y of the frame are final, without waiting for them.
+ */
+int ff_vvc_check_progress(const VVCFrame *frame, VVCProgress vp, int y);
+
+/**
+ * Convert the final samples of a ctu into the semi planar or downscaled output
+ * frame, for frames allocated with one.
+ */
+void ff_vvc_output_ctu(const VVCFrame *frame, int x0, int y0, int ctu_size);
+
+/**
+ * Whether all the pixels of the frame owning the progress are final, without waiting for them.
+ */
+int ff_vvc_progress_finished(const struct FrameProgress *progress);
+
 void ff_vvc_add_progress_listener(VVCFrame *frame, VVCProgressListener *l);
 
 #endif // AVCODEC_VVC_REFS_H
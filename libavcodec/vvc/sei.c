@@ -0,0 +1,203 @@
+/*
+ * VVC Supplementary Enhancement Information messages
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include "libavutil/bswap.h"
+#include "libavutil/crc.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/md5.h"
+#include "libavutil/mem.h"
+
+#include "libavcodec/bytestream.h"
+#include "libavcodec/get_bits.h"
+#include "libavcodec/h2645_vui.h"
+#include "libavcodec/sei.h"
+
+#include "sei.h"
+
+int ff_vvc_sei_decode(VVCSEI *s, const H266RawSEI *sei, void *log_ctx)
+{
+    for (int i = 0; i < sei->message_list.nb_messages; i++) {
+        const SEIRawMessage *msg = &sei->message_list.messages[i];
+        GetByteContext gbyte;
+        GetBitContext gb;
+        int ret;
+
+        // cbs has no type for the film grain characteristics, so the payload is kept as bytes
+        if (msg->payload_type != SEI_TYPE_FILM_GRAIN_CHARACTERISTICS)
+            continue;
+
+        ret = init_get_bits8(&gb, msg->payload, msg->payload_size);
+        if (ret < 0)
+            return ret;
+        bytestream2_init(&gbyte, msg->payload, msg->payload_size);
+
+        ret = ff_h2645_sei_message_decode(&s->common, msg->payload_type, AV_CODEC_ID_VVC,
+            &gb, &gbyte, log_ctx);
+        if (ret < 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+int ff_vvc_sei_to_frame(AVFrame *frame, VVCSEI *s, AVCodecContext *avctx, const VVCSPS *sps, const int poc)
+{
+    const H266RawVUI *rvui = &sps->r->vui;
+    H2645VUI vui           = { 0 };
+
+    // the colour description of the vui carries the range too
+    if (sps->r->sps_vui_parameters_present_flag && rvui->vui_colour_description_present_flag) {
+        vui.video_signal_type_present_flag  = 1;
+        vui.video_full_range_flag           = rvui->vui_full_range_flag;
+        vui.colour_description_present_flag = 1;
+        vui.colour_primaries                = rvui->vui_colour_primaries;
+        vui.transfer_characteristics        = rvui->vui_transfer_characteristics;
+        vui.matrix_coeffs                   = rvui->vui_matrix_coeffs;
+    }
+
+    return ff_h2645_sei_to_frame(frame, &s->common, AV_CODEC_ID_VVC, avctx, &vui,
+        sps->bit_depth, sps->bit_depth, poc);
+}
+
+void ff_vvc_sei_reset(VVCSEI *s)
+{
+    ff_h2645_sei_reset(&s->common);
+    s->common.film_grain_characteristics.present = 0;
+}
+
+const SEIRawDecodedPictureHash *ff_vvc_sei_picture_hash(const H266RawSEI *sei)
+{
+    for (int i = 0; i < sei->message_list.nb_messages; i++) {
+        const SEIRawMessage *msg = &sei->message_list.messages[i];
+
+        if (msg->payload_type == SEI_TYPE_DECODED_PICTURE_HASH)
+            return msg->payload;
+    }
+    return NULL;
+}
+
+// the pictureData of the hashes has the samples above 8 bits as two bytes, the low one first
+static const uint8_t *le_row(const uint8_t *src, const int width, const int pixel_shift, uint8_t *tmp)
+{
+#if HAVE_BIGENDIAN
+    if (pixel_shift) {
+        for (int x = 0; x < width; x++)
+            AV_WL16(tmp + 2 * x, AV_RN16(src + 2 * x));
+        return tmp;
+    }
+#endif
+    return src;
+}
+
+static uint32_t plane_checksum(const uint8_t *src, const ptrdiff_t stride,
+    const int width, const int height, const int pixel_shift)
+{
+    uint32_t sum = 0;
+
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            const int xor_mask = (x & 0xff) ^ (y & 0xff) ^ (x >> 8) ^ (y >> 8);
+            const int v        = pixel_shift ? AV_RN16(src + 2 * x) : src[x];
+
+            sum += (v & 0xff) ^ xor_mask;
+            if (pixel_shift)
+                sum += (v >> 8) ^ xor_mask;
+        }
+        src += stride;
+    }
+    return sum;
+}
+
+// D.3.n of H.274
+int ff_vvc_verify_picture_hash(const SEIRawDecodedPictureHash *dph, const AVFrame *frame,
+    const VVCSPS *sps, const VVCPPS *pps, const int poc, void *log_ctx)
+{
+    static const char *const names[] = { "MD5", "CRC", "checksum" };
+    const AVCRC *crc_table = av_crc_get_table(AV_CRC_16_CCITT);
+    const int ps           = sps->pixel_shift;
+    const int nb_planes    = FFMIN(dph->dph_sei_single_component_flag ? 1 : 3,
+                                   sps->r->sps_chroma_format_idc ? 3 : 1);
+    struct AVMD5 *md5      = NULL;
+    uint8_t *tmp           = NULL;
+    int ret                = 0;
+
+    if (dph->dph_sei_hash_type == 0) {
+        md5 = av_md5_alloc();
+        if (HAVE_BIGENDIAN && ps)
+            tmp = av_malloc(pps->width << ps);
+        if (!md5 || (HAVE_BIGENDIAN && ps && !tmp)) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+    }
+
+    for (int c = 0; c < nb_planes; c++) {
+        const int w              = pps->width  >> sps->hshift[c];
+        const int h              = pps->height >> sps->vshift[c];
+        const ptrdiff_t stride   = frame->linesize[c];
+        const uint8_t *src       = frame->data[c];
+        int match;
+
+        if (dph->dph_sei_hash_type == 0) {
+            uint8_t digest[16];
+
+            av_md5_init(md5);
+            for (int y = 0; y < h; y++)
+                av_md5_update(md5, le_row(src + y * stride, w, ps, tmp), w << ps);
+            av_md5_final(md5, digest);
+            match = !memcmp(digest, dph->dph_sei_picture_md5[c], sizeof(digest));
+        } else if (dph->dph_sei_hash_type == 1) {
+            // the augmented crc starting at 0xffff of the spec is the direct one starting at 0x1d0f
+            uint32_t crc = av_bswap16(0x1d0f);
+
+            for (int y = 0; y < h; y++) {
+                if (HAVE_BIGENDIAN && ps) {
+                    for (int x = 0; x < w; x++) {
+                        uint8_t b[2];
+
+                        AV_WL16(b, AV_RN16(src + y * stride + 2 * x));
+                        crc = av_crc(crc_table, crc, b, 2);
+                    }
+                } else {
+                    crc = av_crc(crc_table, crc, src + y * stride, w << ps);
+                }
+            }
+            match = av_bswap16(crc) == dph->dph_sei_picture_crc[c];
+        } else {
+            match = plane_checksum(src, stride, w, h, ps) == dph->dph_sei_picture_checksum[c];
+        }
+
+        if (!match) {
+            av_log(log_ctx, AV_LOG_ERROR, "Incorrect %s (poc: %d, plane: %d)\n",
+                   names[dph->dph_sei_hash_type], poc, c);
+            ret = AVERROR_INVALIDDATA;
+        } else {
+            av_log(log_ctx, AV_LOG_DEBUG, "Correct %s (poc: %d, plane: %d)\n",
+                   names[dph->dph_sei_hash_type], poc, c);
+        }
+    }
+
+end:
+    av_free(md5);
+    av_free(tmp);
+    return ret;
+}
@@ -0,0 +1,58 @@
+/*
+ * VVC Supplementary Enhancement Information messages
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVCODEC_VVC_SEI_H
+#define AVCODEC_VVC_SEI_H
+
+#include "libavcodec/avcodec.h"
+#include "libavcodec/cbs_h266.h"
+#include "libavcodec/h2645_sei.h"
+
+#include "ps.h"
+
+typedef struct VVCSEI {
+    H2645SEI common;
+} VVCSEI;
+
+/**
+ * Decode the messages of an SEI unit, only the film grain characteristics are used so far.
+ */
+int ff_vvc_sei_decode(VVCSEI *s, const H266RawSEI *sei, void *log_ctx);
+
+/**
+ * Attach the side data of the decoded messages to the frame of a picture.
+ */
+int ff_vvc_sei_to_frame(AVFrame *frame, VVCSEI *s, AVCodecContext *avctx, const VVCSPS *sps, int poc);
+
+void ff_vvc_sei_reset(VVCSEI *s);
+
+/**
+ * @return the decoded picture hash message of an SEI unit, NULL if there is none
+ */
+const SEIRawDecodedPictureHash *ff_vvc_sei_picture_hash(const H266RawSEI *sei);
+
+/**
+ * Check the samples of a decoded picture against its decoded picture hash.
+ * @return 0 if all the hashes match, AVERROR_INVALIDDATA if one does not
+ */
+int ff_vvc_verify_picture_hash(const SEIRawDecodedPictureHash *dph, const AVFrame *frame,
+    const VVCSPS *sps, const VVCPPS *pps, int poc, void *log_ctx);
+
+#endif /* AVCODEC_VVC_SEI_H */
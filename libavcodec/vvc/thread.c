@@ -22,27 +22,38 @@
 
 #include <stdatomic.h>
 
+#include "libavcodec/avcodec.h"
+#include "libavcodec/refstruct.h"
+#include "libavutil/cpu.h"
+#include "libavutil/dict.h"
 #include "libavutil/executor.h"
+#include "libavutil/file_open.h"
 #include "libavutil/mem.h"
+#include "libavutil/pixdesc.h"
 #include "libavutil/thread.h"
+#include "libavutil/time.h"
+#include "libavutil/video_coding_stats.h"
 
 #include "thread.h"
 #include "ctu.h"
 #include "filter.h"
 #include "inter.h"
 #include "intra.h"
+#include "mvs.h"
 #include "refs.h"
 
 typedef struct ProgressListener {
     VVCProgressListener l;
     struct VVCTask *task;
     VVCContext *s;
+    int64_t start;                  ///< when it was added, for the stage stats
 } ProgressListener;
 
 typedef enum VVCTaskStage {
     VVC_TASK_STAGE_PARSE,
     VVC_TASK_STAGE_INTER,
     VVC_TASK_STAGE_RECON,
+    VVC_TASK_STAGE_RECON_CHROMA,        ///< the chroma of dual tree frames, nothing for the others
     VVC_TASK_STAGE_LMCS,
     VVC_TASK_STAGE_DEBLOCK_V,
     VVC_TASK_STAGE_DEBLOCK_H,
@@ -51,6 +62,19 @@ typedef enum VVCTaskStage {
     VVC_TASK_STAGE_LAST
 } VVCTaskStage;
 
+// the time is in microseconds, summed over the tasks of each stage
+typedef struct VVCStageStats {
+    atomic_int_least64_t tasks[VVC_TASK_STAGE_LAST];
+    atomic_int_least64_t run[VVC_TASK_STAGE_LAST];      ///< running
+    atomic_int_least64_t ready[VVC_TASK_STAGE_LAST];    ///< in the executor before running
+    atomic_int_least64_t blocked[VVC_TASK_STAGE_LAST];  ///< listeners waiting for reference progress, they may overlap
+    atomic_int_least64_t replay[VVC_TASK_STAGE_LAST];   ///< running again for the replay option, all the iterations
+} VVCStageStats;
+
+static const char *const stage_name[] = {
+    "parse", "inter", "recon", "recon_chroma", "lmcs", "deblock_v", "deblock_h", "sao", "alf",
+};
+
 typedef struct VVCTask {
     union {
         struct VVCTask *next;                //for executor debug only
@@ -70,44 +94,110 @@ typedef struct VVCTask {
     SliceContext *sc;
     EntryPoint *ep;
     int ctu_idx;                    //ctu idx in the current slice
+    int coeff_slot;                 //from parse to reconstruction
+
+    uint8_t pixel_done;             ///< alf finished, protected by VVCFrameThread.lock
+    uint8_t concealed;              ///< a stage failed with VVCContext.conceal, set by the stages of the ctu
+
+    int64_t ready_time;             ///< when it entered the executor, for the stage stats
 
-    // tasks with target scores met are ready for scheduling
-    atomic_uchar score[VVC_TASK_STAGE_LAST];
+    // Tasks with target scores met are ready for scheduling. The scores are bumped by
+    // the threads finishing the neighbouring ctus, so they get a cache line of their
+    // own, at the end of the task.
+    DECLARE_ALIGNED(ALIGN_64, atomic_uchar, score)[VVC_TASK_STAGE_LAST];
     atomic_uchar target_inter_score;
 } VVCTask;
 
+// one cache line per row, the rows are finished by different threads
 typedef struct VVCRowThread {
-    atomic_int col_progress[VVC_PROGRESS_LAST];
+    DECLARE_ALIGNED(ALIGN_64, atomic_int, col_progress)[VVC_PROGRESS_LAST];
+
+    // final ctus from the left of the row, and the part reported, protected by VVCFrameThread.lock
+    int pixel_prefix;
+    int pixel_reported;
 } VVCRowThread;
 
 typedef struct VVCFrameThread {
     // error return for tasks
     atomic_int ret;
+    atomic_int nb_concealed;        ///< ctus that failed and were concealed
+
+    // the executor may be shared by several decoders, so tasks find their context here
+    VVCContext *s;
 
     VVCRowThread *rows;
     VVCTask *tasks;
+    VVCTask hash_task;              ///< checks the decoded picture hash once the pixels are final
 
     int ctu_size;
     int ctu_width;
     int ctu_height;
     int ctu_count;
 
+    int home;                       ///< executor group the tasks prefer
+
+    // With dual trees, the chroma of an intra ctu only reads its luma, so the luma of the
+    // next ctus is reconstructed while its chroma is, and the two wavefronts overlap
+    int split_recon;
+
+    // the loop filter stages that do not wait for the ctus of other tiles
+    uint8_t tile_split[VVC_TASK_STAGE_LAST];
+
+    // the loop filter stages of filter_batch horizontally adjacent ctus run as one task,
+    // batch_pending counts the ctus of each run still waiting for other runs or stages
+    int filter_batch;
+    int nb_runs;                    ///< runs per ctu row
+    atomic_int *batch_pending;
+
+    // coefficient slots are handed out in raster order, protected by lock
+    int nb_coeff_slots;
+    int *free_slots;
+    int nb_free_slots;
+    CTUArena *arenas;               ///< coding and transform units of each slot
+    int next_slot_rs;               ///< next ctu to get a slot
+
     //protected by lock
     atomic_int nb_scheduled_tasks;
     atomic_int nb_scheduled_listeners;
 
     int row_progress[VVC_PROGRESS_LAST];
 
+    int draw_bands;                 ///< call AVCodecContext.draw_horiz_band() for the final rows
+    int nb_submitted_slices;        ///< the first slices of fc, whose tasks are started
+
     AVMutex lock;
     AVCond  cond;
 } VVCFrameThread;
 
-static void add_task(VVCContext *s, VVCTask *t)
+// The nal units of the next packet are read by the executor while the caller returns the
+// frames finished meanwhile. Only the read moves, the setup of the frame stays on the caller:
+// it updates the parameter sets and the dpb, which follow the decode order.
+typedef struct VVCPacketRead {
+    VVCTask task;                   ///< without a frame context
+    VVCContext *s;
+    AVPacket *pkt;
+    int ret;
+    int pending;                    ///< started and not waited for, only used by the caller
+    atomic_int done;
+
+    AVMutex lock;
+    AVCond  cond;
+} VVCPacketRead;
+
+// With lc, the worker running lc keeps the task to run it next, unless it already keeps one.
+// The deterministic mode keeps the executor order.
+static void add_task(VVCContext *s, VVCTask *t, VVCLocalContext *lc)
 {
     VVCFrameThread *ft = t->fc->ft;
 
     atomic_fetch_add(&ft->nb_scheduled_tasks, 1);
 
+    if (t->fc->ref->stage_stats)
+        t->ready_time = av_gettime_relative();
+    if (lc && !lc->continuation && !lc->waiter && !s->deterministic) {
+        lc->continuation = t;
+        return;
+    }
     av_executor_execute(s->executor, &t->u.task);
 }
 
@@ -166,7 +256,8 @@ static int task_has_target_score(VVCTask *t, const VVCTaskStage stage, const uin
     static const uint8_t target_score[] =
     {
         2,          //VVC_TASK_STAGE_RECON,     need l + rt recon
-        3,          //VVC_TASK_STAGE_LMCS,      need r + b + rb recon
+        2,          //VVC_TASK_STAGE_RECON_CHROMA, need l + rt recon chroma, if split_recon
+        3,          //VVC_TASK_STAGE_LMCS,      need r + b + rb recon (chroma)
         1,          //VVC_TASK_STAGE_DEBLOCK_V, need l deblock v
         2,          //VVC_TASK_STAGE_DEBLOCK_H, need r deblock v + t deblock h
         5,          //VVC_TASK_STAGE_SAO,       need l + r + lb + b + rb deblock h
@@ -178,9 +269,11 @@ static int task_has_target_score(VVCTask *t, const VVCTaskStage stage, const uin
     if (stage == VVC_TASK_STAGE_PARSE) {
         const H266RawSPS *rsps = fc->ps.sps->r;
         const int wpp = rsps->sps_entropy_coding_sync_enabled_flag && !is_first_row(fc, t->rx, t->ry);
-        target = 2 + wpp - 1;                           //left parse + colocation + wpp - no previous stage
+        target = 3 + wpp - 1;                           //left parse + colocation + coeff slot + wpp - no previous stage
     } else if (stage == VVC_TASK_STAGE_INTER) {
         target = atomic_load(&t->target_inter_score);
+    } else if (stage == VVC_TASK_STAGE_RECON_CHROMA && !fc->ft->split_recon) {
+        target = 0;
     } else {
         target = target_score[stage - VVC_TASK_STAGE_RECON];
     }
@@ -190,8 +283,31 @@ static int task_has_target_score(VVCTask *t, const VVCTaskStage stage, const uin
     return score == target + 1;
 }
 
+static int stage_is_batched(const VVCFrameThread *ft, const VVCTaskStage stage)
+{
+    return ft->filter_batch > 1 && stage >= VVC_TASK_STAGE_DEBLOCK_V && stage < VVC_TASK_STAGE_LAST;
+}
+
+static atomic_int *run_pending(const VVCFrameThread *ft, const int rx, const int ry, const VVCTaskStage stage)
+{
+    const int run = ry * ft->nb_runs + rx / ft->filter_batch;
+
+    return ft->batch_pending + run * (VVC_TASK_STAGE_LAST - VVC_TASK_STAGE_DEBLOCK_V) + stage - VVC_TASK_STAGE_DEBLOCK_V;
+}
+
+// a ctu is ready for its batch once the dependencies outside of the run are met
+static int task_has_batch_score(VVCTask *t, const VVCTaskStage stage, const uint8_t score)
+{
+    const VVCFrameThread *ft = t->fc->ft;
+
+    // the left deblock v inside a run is done by the batch itself, so only the lmcs is waited for
+    if (stage == VVC_TASK_STAGE_DEBLOCK_V && t->rx % ft->filter_batch)
+        return score == 1;
+    return task_has_target_score(t, stage, score);
+}
+
 static void frame_thread_add_score(VVCContext *s, VVCFrameThread *ft,
-    const int rx, const int ry, const VVCTaskStage stage)
+    const int rx, const int ry, const VVCTaskStage stage, VVCLocalContext *lc)
 {
     VVCTask *t = ft->tasks + ft->ctu_width * ry + rx;
     uint8_t score;
@@ -199,11 +315,23 @@ static void frame_thread_add_score(VVCContext *s, VVCFrameThread *ft,
     if (rx < 0 || rx >= ft->ctu_width || ry < 0 || ry >= ft->ctu_height)
         return;
 
+    // tasks only enter the executor once their target score is met, so it never polls them
     score = task_add_score(t, stage);
+    if (stage_is_batched(ft, stage)) {
+        if (task_has_batch_score(t, stage, score) &&
+            atomic_fetch_sub(run_pending(ft, rx, ry, stage), 1) == 1) {
+            VVCTask *leader = t - rx % ft->filter_batch;
+
+            av_assert0(s);
+            av_assert0(stage == leader->stage);
+            add_task(s, leader, lc);
+        }
+        return;
+    }
     if (task_has_target_score(t, stage, score)) {
         av_assert0(s);
         av_assert0(stage == t->stage);
-        add_task(s, t);
+        add_task(s, t, lc);
     }
 }
 
@@ -216,13 +344,50 @@ static void sheduled_done(VVCFrameThread *ft, atomic_int *scheduled)
     }
 }
 
+// A ctu depends only on ctus before it in raster order, so granting the slots in
+// this order means the first ctu that is not reconstructed always holds one.
+static void coeff_slots_grant(VVCContext *s, VVCFrameThread *ft)
+{
+    int start, end;
+
+    ff_mutex_lock(&ft->lock);
+    start = ft->next_slot_rs;
+    while (ft->nb_free_slots && ft->next_slot_rs < ft->ctu_count)
+        ft->tasks[ft->next_slot_rs++].coeff_slot = ft->free_slots[--ft->nb_free_slots];
+    end = ft->next_slot_rs;
+    ff_mutex_unlock(&ft->lock);
+
+    for (int rs = start; rs < end; rs++)
+        frame_thread_add_score(s, ft, rs % ft->ctu_width, rs / ft->ctu_width, VVC_TASK_STAGE_PARSE, NULL);
+}
+
+static void coeff_slot_release(VVCContext *s, VVCFrameThread *ft, const VVCTask *t)
+{
+    ff_vvc_ctu_free_cus(t->fc->tab.ctus + t->rs);
+    ff_vvc_ctu_arena_reset(ft->arenas + t->coeff_slot);
+
+    ff_mutex_lock(&ft->lock);
+    ft->free_slots[ft->nb_free_slots++] = t->coeff_slot;
+    ff_mutex_unlock(&ft->lock);
+
+    coeff_slots_grant(s, ft);
+}
+
+static void stats_add(atomic_int_least64_t *counter, const int64_t v)
+{
+    atomic_fetch_add_explicit(counter, v, memory_order_relaxed);
+}
+
 static void progress_done(VVCProgressListener *_l, const int type)
 {
     const ProgressListener *l = (ProgressListener *)_l;
     const VVCTask *t          = l->task;
     VVCFrameThread *ft        = t->fc->ft;
+    VVCStageStats *stats      = t->fc->ref->stage_stats;
 
-    frame_thread_add_score(l->s, ft, t->rx, t->ry, type);
+    if (stats)
+        stats_add(&stats->blocked[type], av_gettime_relative() - l->start);
+    frame_thread_add_score(l->s, ft, t->rx, t->ry, type, NULL);
     sheduled_done(ft, &ft->nb_scheduled_listeners);
 }
 
@@ -236,7 +401,7 @@ static void mv_done(VVCProgressListener *l)
     progress_done(l, VVC_TASK_STAGE_PARSE);
 }
 
-static void listener_init(ProgressListener *l,  VVCTask *t, VVCContext *s, const VVCProgress vp, const int y)
+static void listener_init(ProgressListener *l,  VVCTask *t, VVCContext *s, const VVCProgress vp, const int y, const int x)
 {
     const int is_inter = vp == VVC_PROGRESS_PIXEL;
 
@@ -244,18 +409,21 @@ static void listener_init(ProgressListener *l,  VVCTask *t, VVCContext *s, const
     l->s    = s;
     l->l.vp = vp;
     l->l.y  = y;
+    l->l.x  = x;
     l->l.progress_done = is_inter ? pixel_done : mv_done;
     if (is_inter)
         atomic_fetch_add(&t->target_inter_score, 1);
 }
 
 static void add_progress_listener(VVCFrame *ref, ProgressListener *l,
-    VVCTask *t, VVCContext *s, const VVCProgress vp, const int y)
+    VVCTask *t, VVCContext *s, const VVCProgress vp, const int y, const int x)
 {
     VVCFrameThread *ft = t->fc->ft;
 
     atomic_fetch_add(&ft->nb_scheduled_listeners, 1);
-    listener_init(l, t, s, vp, y);
+    listener_init(l, t, s, vp, y, x);
+    if (t->fc->ref->stage_stats)
+        l->start = av_gettime_relative();
     ff_vvc_add_progress_listener(ref, (VVCProgressListener*)l);
 }
 
@@ -274,15 +442,10 @@ static void schedule_next_parse(VVCContext *s, VVCFrameContext *fc, const SliceC
             }
         }
         if (t->ry + 1 < ft->ctu_height && !is_first_row(fc, t->rx, t->ry + 1))
-            frame_thread_add_score(s, ft, t->rx, t->ry + 1, VVC_TASK_STAGE_PARSE);
+            frame_thread_add_score(s, ft, t->rx, t->ry + 1, VVC_TASK_STAGE_PARSE, NULL);
     }
 
-    if (t->ctu_idx + 1 < t->ep->ctu_end) {
-        const int next_rs = sc->sh.ctb_addr_in_curr_slice[t->ctu_idx + 1];
-        const int next_rx = next_rs % ft->ctu_width;
-        const int next_ry = next_rs / ft->ctu_width;
-        frame_thread_add_score(s, ft, next_rx, next_ry, VVC_TASK_STAGE_PARSE);
-    }
+    // the next ctu of the entry point is scheduled by task_run_parse()
 }
 
 static void schedule_inter(VVCContext *s, VVCFrameContext *fc, const SliceContext *sc, VVCTask *t, const int rs)
@@ -291,15 +454,20 @@ static void schedule_inter(VVCContext *s, VVCFrameContext *fc, const SliceContex
 
     if (!IS_I(sh->r)) {
         CTU *ctu = fc->tab.ctus + rs;
+        const int wrap_enabled = fc->ps.pps->r->pps_ref_wraparound_enabled_flag;
         for (int lx = 0; lx < 2; lx++) {
             for (int i = 0; i < sh->r->num_ref_idx_active[lx]; i++) {
                 int y = ctu->max_y[lx][i];
+                int x = ctu->max_x[lx][i] + LUMA_EXTRA_AFTER;
                 VVCRefPic *refp = sc->rpl[lx].refs + i;
                 VVCFrame *ref   = refp->ref;
                 if (ref && y >= 0) {
                     if (refp->is_scaled)
                         y = y * refp->scale[1] >> 14;
-                    add_progress_listener(ref, &t->listener[lx][i], t, s, VVC_PROGRESS_PIXEL, y + LUMA_EXTRA_AFTER);
+                    // the left part of a reference row is only enough without scaling and wraparound
+                    if (refp->is_scaled || wrap_enabled)
+                        x = INT_MAX;
+                    add_progress_listener(ref, &t->listener[lx][i], t, s, VVC_PROGRESS_PIXEL, y + LUMA_EXTRA_AFTER, x);
                 }
             }
         }
@@ -318,13 +486,33 @@ static void parse_task_done(VVCContext *s, VVCFrameContext *fc, const int rx, co
     schedule_inter(s, fc, sc, t, rs);
 }
 
-static void task_stage_done(const VVCTask *t, VVCContext *s)
+// the neighbour at dx, dy of a ctu is in another tile, and its stage does not wait for this one
+static int tile_crossed(const VVCFrameContext *fc, const int rx, const int ry,
+    const int dx, const int dy, const VVCTaskStage stage)
+{
+    const VVCFrameThread *ft = fc->ft;
+    const VVCPPS *pps        = fc->ps.pps;
+    const int x              = rx + dx;
+    const int y              = ry + dy;
+
+    if (!ft->tile_split[stage] ||
+        rx < 0 || rx >= ft->ctu_width || ry < 0 || ry >= ft->ctu_height ||
+        x  < 0 || x  >= ft->ctu_width || y  < 0 || y  >= ft->ctu_height)
+        return 0;
+    return pps->ctb_to_col_bd[x] != pps->ctb_to_col_bd[rx] || pps->ctb_to_row_bd[y] != pps->ctb_to_row_bd[ry];
+}
+
+// the scores added to the neighbours in other tiles, with crossed, or to the others
+static void stage_done(const VVCTask *t, VVCContext *s, VVCLocalContext *lc, const int crossed)
 {
     VVCFrameContext *fc      = t->fc;
     VVCFrameThread *ft       = fc->ft;
     const VVCTaskStage stage = t->stage;
 
-#define ADD(dx, dy, stage) frame_thread_add_score(s, ft, t->rx + (dx), t->ry + (dy), stage)
+#define ADD(dx, dy, stage) do {                                                         \
+    if (tile_crossed(fc, t->rx, t->ry, dx, dy, stage) == crossed)                       \
+        frame_thread_add_score(s, ft, t->rx + (dx), t->ry + (dy), stage, lc);          \
+} while (0)
 
     //this is a reserve map of ready_score, ordered by zigzag
     if (stage == VVC_TASK_STAGE_PARSE) {
@@ -332,9 +520,19 @@ static void task_stage_done(const VVCTask *t, VVCContext *s)
     } else if (stage == VVC_TASK_STAGE_RECON) {
         ADD(-1,  1, VVC_TASK_STAGE_RECON);
         ADD( 1,  0, VVC_TASK_STAGE_RECON);
-        ADD(-1, -1, VVC_TASK_STAGE_LMCS);
-        ADD( 0, -1, VVC_TASK_STAGE_LMCS);
-        ADD(-1,  0, VVC_TASK_STAGE_LMCS);
+        if (!ft->split_recon) {
+            ADD(-1, -1, VVC_TASK_STAGE_LMCS);
+            ADD( 0, -1, VVC_TASK_STAGE_LMCS);
+            ADD(-1,  0, VVC_TASK_STAGE_LMCS);
+        }
+    } else if (stage == VVC_TASK_STAGE_RECON_CHROMA) {
+        if (ft->split_recon) {
+            ADD(-1,  1, VVC_TASK_STAGE_RECON_CHROMA);
+            ADD( 1,  0, VVC_TASK_STAGE_RECON_CHROMA);
+            ADD(-1, -1, VVC_TASK_STAGE_LMCS);
+            ADD( 0, -1, VVC_TASK_STAGE_LMCS);
+            ADD(-1,  0, VVC_TASK_STAGE_LMCS);
+        }
     } else if (stage == VVC_TASK_STAGE_DEBLOCK_V) {
         ADD( 1,  0,  VVC_TASK_STAGE_DEBLOCK_V);
         ADD(-1,  0,  VVC_TASK_STAGE_DEBLOCK_H);
@@ -355,6 +553,14 @@ static void task_stage_done(const VVCTask *t, VVCContext *s)
         ADD( 0,  1,  VVC_TASK_STAGE_ALF);
         ADD( 1,  1,  VVC_TASK_STAGE_ALF);
     }
+#undef ADD
+}
+
+// the first neighbour made ready is kept by the worker of lc, the
+// parse lanes run long, so the stages they make ready are not kept
+static void task_stage_done(const VVCTask *t, VVCContext *s, VVCLocalContext *lc)
+{
+    stage_done(t, s, lc, 0);
 }
 
 static int task_is_stage_ready(VVCTask *t, int add)
@@ -367,43 +573,110 @@ static int task_is_stage_ready(VVCTask *t, int add)
     return task_has_target_score(t, stage, score);
 }
 
-static int task_ready(const AVTask *_t, void *user_data)
+// older frames first, parse before the other stages, then zigzag with type
+#define PRIORITY_FRAMES     4
+#define PRIORITY_PER_FRAME  (AV_EXECUTOR_PRIORITIES / PRIORITY_FRAMES)
+
+static int task_priority(const AVTask *_t, void *user_data)
 {
-    VVCTask *t = (VVCTask*)_t;
+    const VVCTask *t = (const VVCTask*)_t;
+    const VVCFrameThread *ft;
+    const VVCContext *s;
+    unsigned age;
+    int p = 0;
+
+    // the caller waits for the packet read to set up the next frame
+    if (!t->fc)
+        return 0;
 
-    return task_is_stage_ready(t, 0);
-}
+    ft  = t->fc->ft;
+    s   = ft->s;
+    // with the output and deadline priorities the frame needed first is the oldest
+    if (s->priority != VVC_PRIORITY_DECODE)
+        age = FFMAX(atomic_load(&t->fc->rank), 0);
+    else
+        age = (unsigned)t->fc->decode_order - atomic_load(&s->oldest_decode_order);
+
+    // nothing waits for the hash check
+    if (t->stage == VVC_TASK_STAGE_LAST)
+        return AV_EXECUTOR_PRIORITIES - 1;
+
+    // one frame is in flight, the tasks of the upper rows go first and the buckets keep
+    // the submission order, so each run does the same work in the same order
+    if (s->deterministic)
+        return t->ry * AV_EXECUTOR_PRIORITIES / ft->ctu_height;
+
+    if (t->stage != VVC_TASK_STAGE_PARSE) {
+        const int zigzag = t->rx + t->ry + t->stage;
+        const int max    = ft->ctu_width + ft->ctu_height + VVC_TASK_STAGE_LAST;
+        p = 1 + zigzag * (PRIORITY_PER_FRAME - 1) / max;
+    }
 
-#define CHECK(a, b)                         \
-    do {                                    \
-        if ((a) != (b))                     \
-            return (a) < (b);               \
-    } while (0)
+    return FFMIN(age, PRIORITY_FRAMES - 1) * PRIORITY_PER_FRAME + p;
+}
 
-static int task_priority_higher(const AVTask *_a, const AVTask *_b)
+// ctus of a row are finished roughly from left to right, so the left part of the
+// first unfinished row is published before the row is complete
+static void report_pixel_partial_progress(VVCFrameContext *fc, const int rx, const int ry)
 {
-    const VVCTask *a = (const VVCTask*)_a;
-    const VVCTask *b = (const VVCTask*)_b;
+    VVCFrameThread *ft = fc->ft;
+    VVCRowThread *row  = ft->rows + ry;
+    const int y        = ft->row_progress[VVC_PROGRESS_PIXEL];
 
-    CHECK(a->fc->decode_order, b->fc->decode_order);             //decode order
+    if (rx >= 0) {
+        ft->tasks[ry * ft->ctu_width + rx].pixel_done = 1;
+        while (row->pixel_prefix < ft->ctu_width && ft->tasks[ry * ft->ctu_width + row->pixel_prefix].pixel_done)
+            row->pixel_prefix++;
+    }
 
-    if (a->stage == VVC_TASK_STAGE_PARSE || b->stage == VVC_TASK_STAGE_PARSE) {
-        CHECK(a->stage, b->stage);
-        CHECK(a->ry, b->ry);
-        return a->rx < b->rx;
+    if (y < ft->ctu_height) {
+        row = ft->rows + y;
+        if (row->pixel_prefix > row->pixel_reported && row->pixel_prefix < ft->ctu_width) {
+            row->pixel_reported = row->pixel_prefix;
+            ff_vvc_report_partial_progress(fc->ref, VVC_PROGRESS_PIXEL,
+                (y + 1) * ft->ctu_size, row->pixel_prefix * ft->ctu_size);
+        }
     }
+}
 
-    CHECK(a->rx + a->ry + a->stage, b->rx + b->ry + b->stage);    //zigzag with type
-    CHECK(a->rx + a->ry, b->rx + b->ry);                          //zigzag
-    return a->ry < b->ry;
+// the luma rows y0 to y1 of the frame are final, report their part in the output window
+static void draw_band(VVCFrameContext *fc, int y0, int y1)
+{
+    AVCodecContext *avctx = fc->ft->s->avctx;
+    const VVCSPS *sps     = fc->ps.sps;
+    const AVFrame *frame  = fc->ref->output->buf[0] ? fc->ref->output : fc->ref->frame;
+    const int top         = frame->crop_top;
+    const int bottom      = frame->height - frame->crop_bottom;
+    const int nb_planes   = av_pix_fmt_count_planes(frame->format);
+    int offset[AV_NUM_DATA_POINTERS] = { 0 };
+
+    y0 = FFMAX(y0 >> fc->ref->lowres, top);
+    y1 = AV_CEIL_RSHIFT(y1, fc->ref->lowres);
+    y1 = FFMIN(y1, bottom);
+    if (y0 >= y1)
+        return;
+
+    // the chroma samples are interleaved in the second of two planes
+    for (int c = 0; c < nb_planes; c++)
+        offset[c] = (y0 >> sps->vshift[c]) * frame->linesize[c] +
+            ((frame->crop_left >> sps->hshift[c]) << (sps->pixel_shift + (nb_planes == 2 && c)));
+
+    avctx->draw_horiz_band(avctx, frame, offset, y0 - top, 3, y1 - y0);
 }
 
 static void report_frame_progress(VVCFrameContext *fc,
-   const int ry, const VVCProgress idx)
+   const int rx, const int ry, const VVCProgress idx)
 {
     VVCFrameThread *ft = fc->ft;
     const int ctu_size = ft->ctu_size;
-    int old;
+    int old, check_hash = 0;
+
+    // no later picture of an intra only sequence waits for its motion
+    if (idx == VVC_PROGRESS_MV && fc->ps.sps->intra_only)
+        return;
+
+    if (idx == VVC_PROGRESS_MV && fc->ref->tab_col_mvf)
+        ff_vvc_store_col_mvf(fc, rx, ry);
 
     if (atomic_fetch_add(&ft->rows[ry].col_progress[idx], 1) == ft->ctu_width - 1) {
         int y;
@@ -414,27 +687,116 @@ static void report_frame_progress(VVCFrameContext *fc,
         if (old != y) {
             const int progress = y == ft->ctu_height ? INT_MAX : y * ctu_size;
             ft->row_progress[idx] = y;
+            if (idx == VVC_PROGRESS_PIXEL && progress == INT_MAX) {
+                ff_vvc_pad_frame(fc->ref);
+                check_hash = fc->has_picture_hash;
+                if (atomic_load(&ft->nb_concealed)) {
+                    ff_vvc_report_concealed(fc->ref);
+                    av_log(ft->s->avctx, AV_LOG_WARNING, "Concealed %d CTUs of frame %d\n",
+                           atomic_load(&ft->nb_concealed), (int)fc->decode_order);
+                }
+                if (ft->s->avctx->export_side_data & (AV_CODEC_EXPORT_DATA_MVS | AV_CODEC_EXPORT_DATA_VIDEO_ENC_PARAMS) &&
+                    ff_vvc_export_side_data(ft->s, fc) < 0)
+                    av_log(ft->s->avctx, AV_LOG_WARNING, "Failed to export the side data of frame %d\n",
+                           (int)fc->decode_order);
+            }
             ff_vvc_report_progress(fc->ref, idx, progress);
+            // under the lock, so the bands of a frame are drawn top to bottom
+            if (idx == VVC_PROGRESS_PIXEL && ft->draw_bands)
+                draw_band(fc, old * ctu_size, FFMIN(y * ctu_size, fc->ps.pps->height));
         }
+        if (idx == VVC_PROGRESS_PIXEL)
+            report_pixel_partial_progress(fc, -1, ry);
+        ff_mutex_unlock(&ft->lock);
+
+        // add_task() may run it inline, so not under the lock
+        if (check_hash) {
+            task_init(&ft->hash_task, VVC_TASK_STAGE_LAST, fc, 0, 0);
+            add_task(ft->s, &ft->hash_task, NULL);
+        }
+    } else if (idx == VVC_PROGRESS_PIXEL) {
+        ff_mutex_lock(&ft->lock);
+        report_pixel_partial_progress(fc, rx, ry);
         ff_mutex_unlock(&ft->lock);
     }
 }
 
+// bits and bins are what the arithmetic decoder consumed for the ctu
+static void ctu_stats_fill(VVCFrameContext *fc, const int rs, const int64_t bits, const unsigned bins)
+{
+    AVVideoCodingBlockStats *b = av_video_coding_stats_block(fc->ctu_stats, rs);
+    int nb_qps = 0, qp_sum = 0;
+
+    b->bits        = bits;
+    b->bins        = bins;
+    b->min_cu_area = INT_MAX;
+    for (const CodingUnit *cu = fc->tab.ctus[rs].cus; cu; cu = cu->next) {
+        for (const TransformUnit *tu = cu->tus.head; tu; tu = tu->next)
+            b->nb_tus++;
+        b->nb_cus++;
+        b->nb_intra   += cu->pred_mode == MODE_INTRA;
+        b->nb_inter   += cu->pred_mode == MODE_INTER;
+        b->nb_ibc     += cu->pred_mode == MODE_IBC;
+        b->nb_palette += cu->pred_mode == MODE_PLT;
+        b->nb_skip    += cu->skip_flag;
+        b->nb_coded   += cu->coded_flag;
+        b->max_qt_depth = FFMAX(b->max_qt_depth, cu->cqt_depth);
+        if (cu->tree_type != DUAL_TREE_CHROMA) {
+            b->min_cu_area = FFMIN(b->min_cu_area, cu->cb_width * cu->cb_height);
+            qp_sum += cu->qp[LUMA];
+            nb_qps++;
+        }
+    }
+    if (nb_qps)
+        b->qp = FFUDIV(qp_sum, nb_qps);
+    else
+        b->min_cu_area = 0;
+}
+
+// the stages of a ctu run one after another, so no locking is needed
+static void ctu_stats_add_time(VVCFrameContext *fc, const int rs, const VVCTaskStage stage, const int64_t time)
+{
+    AVVideoCodingBlockStats *b = av_video_coding_stats_block(fc->ctu_stats, rs);
+
+    if (stage == VVC_TASK_STAGE_PARSE)
+        b->parse_time  += time;
+    else if (stage < VVC_TASK_STAGE_DEBLOCK_V)
+        b->recon_time  += time;
+    else
+        b->filter_time += time;
+}
+
 static int run_parse(VVCContext *s, VVCLocalContext *lc, VVCTask *t)
 {
     int ret;
     VVCFrameContext *fc = lc->fc;
     const int rs        = t->rs;
     const CTU *ctu      = fc->tab.ctus + rs;
-
-    lc->ep = t->ep;
+    const VVCCabacContext *cc = &t->ep->cc;
+    const uint8_t *start      = cc->buf + cc->pos;
+    const int start_cnt       = cc->cnt;
+    const unsigned start_bins = cc->bins;
+
+    lc->ep     = t->ep;
+    lc->arena  = fc->ft->arenas + t->coeff_slot;
+    lc->coeffs   = NULL;
+    lc->coeffs16 = NULL;
+    if (fc->tab.sz.coeffs16)
+        lc->coeffs16 = fc->tab.coeffs16 + t->coeff_slot * fc->tab.sz.ctu_size * VVC_MAX_SAMPLE_ARRAYS;
+    else
+        lc->coeffs   = fc->tab.coeffs + t->coeff_slot * fc->tab.sz.ctu_size * VVC_MAX_SAMPLE_ARRAYS;
+
+    ff_vvc_ctu_tabs_reset(fc, t->rx, t->ry);
 
     ret = ff_vvc_coding_tree_unit(lc, t->ctu_idx, rs, t->rx, t->ry);
     if (ret < 0)
         return ret;
 
+    if (fc->ctu_stats)
+        ctu_stats_fill(fc, rs, (cc->buf + cc->pos - start) * 8 - (cc->cnt - start_cnt), cc->bins - start_bins);
+
     if (!ctu->has_dmvr)
-        report_frame_progress(lc->fc, t->ry, VVC_PROGRESS_MV);
+        report_frame_progress(lc->fc, t->rx, t->ry, VVC_PROGRESS_MV);
 
     return 0;
 }
@@ -450,14 +812,49 @@ static int run_inter(VVCContext *s, VVCLocalContext *lc, VVCTask *t)
         return ret;
 
     if (ctu->has_dmvr)
-        report_frame_progress(fc, t->ry, VVC_PROGRESS_MV);
+        report_frame_progress(fc, t->rx, t->ry, VVC_PROGRESS_MV);
 
     return 0;
 }
 
 static int run_recon(VVCContext *s, VVCLocalContext *lc, VVCTask *t)
 {
-    return ff_vvc_reconstruct(lc, t->rs, t->rx, t->ry);
+    const VVCFrameThread *ft = lc->fc->ft;
+    int ret = ff_vvc_reconstruct(lc, t->rs, t->rx, t->ry, LUMA, ft->split_recon ? LUMA : CHROMA);
+    if (ret < 0)
+        return ret;
+
+    // the chroma residual scaling reads the luma before the inverse mapping
+    if (!ft->split_recon)
+        ff_vvc_lmcs_filter_recon(lc, t->rx * ft->ctu_size, t->ry * ft->ctu_size);
+
+    // The boundary strengths only need the neighbours parsed, so they are derived here rather
+    // than on the critical path of the deblocking stages. The left ctu is reconstructed by now,
+    // the one above only if there is a ctu right of it, whose reconstruction needs it.
+    if (!lc->sc->sh.r->sh_deblocking_filter_disabled_flag) {
+        ff_vvc_deblock_bs(lc, t->rx, t->ry, t->rs, 1);
+        if (ft->ctu_width > 1)
+            ff_vvc_deblock_bs(lc, t->rx, t->ry, t->rs, 0);
+    }
+
+    return 0;
+}
+
+static int run_recon_chroma(VVCContext *s, VVCLocalContext *lc, VVCTask *t)
+{
+    const VVCFrameThread *ft = lc->fc->ft;
+    int ret;
+
+    if (!ft->split_recon)
+        return 0;
+
+    ret = ff_vvc_reconstruct(lc, t->rs, t->rx, t->ry, CHROMA, CHROMA);
+    if (ret < 0)
+        return ret;
+
+    ff_vvc_lmcs_filter_recon(lc, t->rx * ft->ctu_size, t->ry * ft->ctu_size);
+
+    return 0;
 }
 
 static int run_lmcs(VVCContext *s, VVCLocalContext *lc, VVCTask *t)
@@ -481,8 +878,9 @@ static int run_deblock_v(VVCContext *s, VVCLocalContext *lc, VVCTask *t)
     const int x0        = t->rx * ctb_size;
     const int y0        = t->ry * ctb_size;
 
-    if (!lc->sc->sh.r->sh_deblocking_filter_disabled_flag) {
-        ff_vvc_decode_neighbour(lc, x0, y0, t->rx, t->ry, t->rs);
+    // the ctus with all boundary strengths 0, such as static skipped ones, are left as they are
+    if (!lc->sc->sh.r->sh_deblocking_filter_disabled_flag && fc->tab.ctus[t->rs].has_bs[1]) {
+        ff_vvc_load_neighbour(lc, t->rs);
         ff_vvc_deblock_vertical(lc, x0, y0, t->rs);
     }
 
@@ -498,8 +896,11 @@ static int run_deblock_h(VVCContext *s, VVCLocalContext *lc, VVCTask *t)
     const int y0        = t->ry * ctb_size;
 
     if (!lc->sc->sh.r->sh_deblocking_filter_disabled_flag) {
-        ff_vvc_decode_neighbour(lc, x0, y0, t->rx, t->ry, t->rs);
-        ff_vvc_deblock_horizontal(lc, x0, y0, t->rs);
+        ff_vvc_load_neighbour(lc, t->rs);
+        if (ft->ctu_width == 1)
+            ff_vvc_deblock_bs(lc, t->rx, t->ry, t->rs, 0);
+        if (fc->tab.ctus[t->rs].has_bs[0])
+            ff_vvc_deblock_horizontal(lc, x0, y0, t->rs);
     }
     if (fc->ps.sps->r->sps_sao_enabled_flag)
         ff_vvc_sao_copy_ctb_to_hv(lc, t->rx, t->ry, t->ry == ft->ctu_height - 1);
@@ -515,8 +916,8 @@ static int run_sao(VVCContext *s, VVCLocalContext *lc, VVCTask *t)
     const int x0        = t->rx * ctb_size;
     const int y0        = t->ry * ctb_size;
 
-    if (fc->ps.sps->r->sps_sao_enabled_flag) {
-        ff_vvc_decode_neighbour(lc, x0, y0, t->rx, t->ry, t->rs);
+    if (fc->ps.sps->r->sps_sao_enabled_flag && ff_vvc_sao_needed(fc, t->rx, t->ry)) {
+        ff_vvc_load_neighbour(lc, t->rs);
         ff_vvc_sao_filter(lc, x0, y0);
     }
 
@@ -526,6 +927,17 @@ static int run_sao(VVCContext *s, VVCLocalContext *lc, VVCTask *t)
     return 0;
 }
 
+static void alf_filter(VVCLocalContext *lc, const VVCTask *t)
+{
+    VVCFrameContext *fc = lc->fc;
+    const int ctu_size  = fc->ft->ctu_size;
+
+    if (fc->ps.sps->r->sps_alf_enabled_flag && ff_vvc_alf_needed(fc, t->rx, t->ry)) {
+        ff_vvc_load_neighbour(lc, t->rs);
+        ff_vvc_alf_filter(lc, t->rx * ctu_size, t->ry * ctu_size);
+    }
+}
+
 static int run_alf(VVCContext *s, VVCLocalContext *lc, VVCTask *t)
 {
     VVCFrameContext *fc = lc->fc;
@@ -534,28 +946,144 @@ static int run_alf(VVCContext *s, VVCLocalContext *lc, VVCTask *t)
     const int x0        = t->rx * ctu_size;
     const int y0        = t->ry * ctu_size;
 
-    if (fc->ps.sps->r->sps_alf_enabled_flag) {
+    alf_filter(lc, t);
+    if (fc->ref->output->buf[0])
+        ff_vvc_output_ctu(fc->ref, x0, y0, ctu_size);
+    report_frame_progress(fc, t->rx, t->ry, VVC_PROGRESS_PIXEL);
+
+    return 0;
+}
+
+// the parse only mode and skip_loop_filter run none of the later stages, but report the progress they would,
+// and the ctus of skipped subpictures run no stage at all
+static int run_skipped(VVCContext *s, VVCLocalContext *lc, VVCTask *t)
+{
+    VVCFrameContext *fc = lc->fc;
+
+    if (t->stage == VVC_TASK_STAGE_PARSE) {
+        // no cu, so the neighbours see nothing coded and no reference is waited for
+        ff_vvc_ctu_tabs_reset(fc, t->rx, t->ry);
+        memset(fc->tab.ctus[t->rs].max_y, -1, sizeof(fc->tab.ctus[t->rs].max_y));
+        report_frame_progress(fc, t->rx, t->ry, VVC_PROGRESS_MV);
+    } else if (t->stage == VVC_TASK_STAGE_INTER && fc->tab.ctus[t->rs].has_dmvr) {
+        report_frame_progress(fc, t->rx, t->ry, VVC_PROGRESS_MV);
+    } else if (t->stage == VVC_TASK_STAGE_ALF) {
+        const int ctu_size = fc->ft->ctu_size;
+
+        if (fc->ref->output->buf[0] && !t->sc->skipped)
+            ff_vvc_output_ctu(fc->ref, t->rx * ctu_size, t->ry * ctu_size, ctu_size);
+        report_frame_progress(fc, t->rx, t->ry, VVC_PROGRESS_PIXEL);
+    }
+
+    return 0;
+}
+
+// only the first reference of list 0 is waited for and only when it needs no rescaling
+static const VVCFrame *conceal_ref(const SliceContext *sc)
+{
+    const VVCRefPic *refp = sc->rpl[L0].refs;
+
+    if (IS_I(sc->sh.r) || !refp->ref || refp->is_scaled)
+        return NULL;
+    return refp->ref;
+}
+
+
+// a concealed ctu is predicted from the colocated area of a reference, with no cu, and
+// the loop filter stages still run on it with its own sao and alf off
+static int run_concealed(VVCContext *s, VVCLocalContext *lc, VVCTask *t)
+{
+    VVCFrameContext *fc = lc->fc;
+    const int ctu_size  = fc->ft->ctu_size;
+    const int x0        = t->rx * ctu_size;
+    const int y0        = t->ry * ctu_size;
+
+    if (t->stage == VVC_TASK_STAGE_PARSE) {
+        CTU *ctu = fc->tab.ctus + t->rs;
+
+        // also turns off its sao and alf
+        ff_vvc_ctu_tabs_reset(fc, t->rx, t->ry);
         ff_vvc_decode_neighbour(lc, x0, y0, t->rx, t->ry, t->rs);
-        ff_vvc_alf_filter(lc, x0, y0);
+        memset(ctu->max_y, -1, sizeof(ctu->max_y));
+        memset(ctu->max_x, -1, sizeof(ctu->max_x));
+        if (conceal_ref(t->sc)) {
+            ctu->max_y[L0][0] = FFMIN(y0 + ctu_size, fc->ps.pps->height) - 1;
+            ctu->max_x[L0][0] = FFMIN(x0 + ctu_size, fc->ps.pps->width)  - 1;
+        }
+        report_frame_progress(fc, t->rx, t->ry, VVC_PROGRESS_MV);
+    } else if (t->stage == VVC_TASK_STAGE_INTER) {
+        ff_vvc_conceal_ctu(lc, conceal_ref(t->sc), x0, y0);
     }
-    report_frame_progress(fc, t->ry, VVC_PROGRESS_PIXEL);
 
     return 0;
 }
 
-#define VVC_THREAD_DEBUG
-#ifdef VVC_THREAD_DEBUG
+static void conceal_start(VVCFrameThread *ft, VVCTask *t)
+{
+    t->concealed = 1;
+    atomic_fetch_add(&ft->nb_concealed, 1);
+}
+
 const static char* task_name[] = {
     "P",
     "I",
     "R",
+    "C",
     "L",
     "V",
     "H",
     "S",
     "A"
 };
-#endif
+
+typedef struct VVCTraceEvent {
+    uint64_t decode_order;
+    int64_t start;
+    int64_t end;
+    int16_t rx, ry;
+    uint8_t stage;
+} VVCTraceEvent;
+
+// one ring per worker, events are only read back once the decoder is idle
+typedef struct VVCTraceRing {
+    atomic_uint head;
+    VVCTraceEvent *events;
+} VVCTraceRing;
+
+typedef struct VVCTrace {
+    VVCTraceRing *rings;
+    int nb_rings;                   ///< the first one is for the waiting thread
+    unsigned size;                  ///< events per ring, power of 2
+    int64_t epoch;
+
+    atomic_int *next_id;            ///< of the local contexts of the executor
+    atomic_int own_ids;
+} VVCTrace;
+
+// the local contexts of the shared executor serve all its decoders, they are numbered once
+static atomic_int shared_trace_ids;
+
+static void trace_add(VVCTrace *tr, VVCLocalContext *lc, const VVCTask *t,
+    const int64_t start, const int64_t end)
+{
+    VVCTraceRing *ring;
+    unsigned idx;
+    VVCTraceEvent *ev;
+
+    // only the worker owning lc writes trace_id, the executor allocates each context on its own
+    if (!lc->waiter && !lc->trace_id)
+        lc->trace_id = atomic_fetch_add_explicit(tr->next_id, 1, memory_order_relaxed) + 1;
+    ring = tr->rings + (lc->waiter ? 0 : 1 + (lc->trace_id - 1) % (tr->nb_rings - 1));
+    idx = atomic_fetch_add_explicit(&ring->head, 1, memory_order_relaxed) & (tr->size - 1);
+    ev  = ring->events + idx;
+
+    ev->decode_order = t->fc->decode_order;
+    ev->start        = start;
+    ev->end          = end;
+    ev->rx           = t->rx;
+    ev->ry           = t->ry;
+    ev->stage        = t->stage;
+}
 
 typedef int (*run_func)(VVCContext *s, VVCLocalContext *lc, VVCTask *t);
 
@@ -569,6 +1097,7 @@ static void task_run_stage(VVCTask *t, VVCContext *s, VVCLocalContext *lc)
         run_parse,
         run_inter,
         run_recon,
+        run_recon_chroma,
         run_lmcs,
         run_deblock_v,
         run_deblock_h,
@@ -576,14 +1105,43 @@ static void task_run_stage(VVCTask *t, VVCContext *s, VVCLocalContext *lc)
         run_alf,
     };
 
-#ifdef VVC_THREAD_DEBUG
-    av_log(s->avctx, AV_LOG_DEBUG, "frame %5d, %s(%3d, %3d)\r\n", (int)t->fc->decode_order, task_name[stage], t->rx, t->ry);
-#endif
+    VVCStageStats *stats     = fc->ref->stage_stats;
+    int64_t start = 0, end;
 
     lc->sc = t->sc;
 
+    if (s->trace || stats || fc->ctu_stats)
+        start = av_gettime_relative();
+
     if (!atomic_load(&ft->ret)) {
-        if ((ret = run[stage](s, lc, t)) < 0) {
+        // the cabac state of an entry point is lost after a failed parse, so the next ctus are concealed
+        // too; the failures of the later stages run concurrently with the parse and are not followed
+        if (s->conceal && stage == VVC_TASK_STAGE_PARSE && t->ep->lost)
+            conceal_start(ft, t);
+
+        if (t->concealed && stage < VVC_TASK_STAGE_DEBLOCK_V)
+            ret = run_concealed(s, lc, t);
+        else if (t->sc->skipped || (s->parse_only && stage != VVC_TASK_STAGE_PARSE) ||
+            (fc->skip_loop_filter && stage >= VVC_TASK_STAGE_DEBLOCK_V))
+            ret = run_skipped(s, lc, t);
+        else
+            ret = run[stage](s, lc, t);
+        if (ret < 0 && s->conceal && ret != AVERROR(ENOMEM) && !t->concealed) {
+            av_log(s->avctx, AV_LOG_WARNING,
+                "frame %5d, %s(%3d, %3d) failed with %d, concealed\n",
+                (int)fc->decode_order, task_name[stage], t->rx, t->ry, ret);
+            conceal_start(ft, t);
+            // the prediction done before a later stage failed is kept
+            if (stage == VVC_TASK_STAGE_PARSE) {
+                t->ep->lost = 1;
+                ret = run_concealed(s, lc, t);
+            } else {
+                if (stage == VVC_TASK_STAGE_INTER && fc->tab.ctus[t->rs].has_dmvr)
+                    report_frame_progress(fc, t->rx, t->ry, VVC_PROGRESS_MV);
+                ret = 0;
+            }
+        }
+        if (ret < 0) {
 #ifdef COMPAT_ATOMICS_WIN32_STDATOMIC_H
             intptr_t zero = 0;
 #else
@@ -596,49 +1154,454 @@ static void task_run_stage(VVCTask *t, VVCContext *s, VVCLocalContext *lc)
         }
     }
 
-    task_stage_done(t, s);
+    if (s->trace || stats || fc->ctu_stats) {
+        end = av_gettime_relative();
+        if (s->trace)
+            trace_add(s->trace, lc, t, start, end);
+        if (stats) {
+            stats_add(&stats->tasks[stage], 1);
+            stats_add(&stats->run[stage], end - start);
+        }
+        if (fc->ctu_stats)
+            ctu_stats_add_time(fc, t->rs, stage, end - start);
+    }
+
+    // the replay keeps the cus and coefficients of the whole frame, see ff_vvc_frame_wait()
+    if (stage == VVC_TASK_STAGE_RECON_CHROMA && !s->replay)
+        coeff_slot_release(s, ft, t);
+
+    task_stage_done(t, s, lc);
     return;
 }
 
-static int task_run(AVTask *_t, void *local_context, void *user_data)
+// run one loop filter stage for a run of ctus, t is the leftmost one
+static void task_run_batch(VVCTask *t, VVCContext *s, VVCLocalContext *lc)
 {
-    VVCTask *t          = (VVCTask*)_t;
-    VVCContext *s       = (VVCContext *)user_data;
-    VVCLocalContext *lc = local_context;
-    VVCFrameThread *ft  = t->fc->ft;
+    VVCFrameThread *ft = t->fc->ft;
+    const int end      = FFMIN(t->rx + ft->filter_batch, ft->ctu_width);
+
+    for (int rx = t->rx; rx < end; rx++)
+        task_run_stage(t + rx - t->rx, s, lc);
+
+    for (int rx = t->rx; rx < end; rx++) {
+        VVCTask *c = t + rx - t->rx;
+
+        c->stage++;
+        if (c->stage != VVC_TASK_STAGE_LAST)
+            frame_thread_add_score(s, ft, c->rx, c->ry, c->stage, lc);
+    }
+}
+
+// the next ctu of the entry point, if it is ready to parse now
+static VVCTask *parse_lane_next(VVCFrameThread *ft, const VVCTask *t)
+{
+    const SliceContext *sc = t->sc;
+    VVCTask *next;
+
+    if (t->ctu_idx + 1 >= t->ep->ctu_end)
+        return NULL;
+
+    next = ft->tasks + sc->sh.ctb_addr_in_curr_slice[t->ctu_idx + 1];
+    if (!task_has_target_score(next, VVC_TASK_STAGE_PARSE, task_add_score(next, VVC_TASK_STAGE_PARSE)))
+        return NULL;
+    return next;
+}
+
+// parsing is the critical path, so an entry point stays on this worker as long as its next ctu
+// is ready, and the later stages of the parsed ctus go to the executor. With wavefront parallel
+// processing, the row below waits for the ctu above only, and its lane starts on another worker.
+static void task_run_parse(VVCTask *t, VVCContext *s, VVCLocalContext *lc)
+{
+    VVCFrameThread *ft = t->fc->ft;
+
+    while (t) {
+        VVCTask *next;
 
+        task_run_stage(t, s, lc);
+        next = parse_lane_next(ft, t);
+
+        t->stage++;
+        frame_thread_add_score(s, ft, t->rx, t->ry, t->stage, NULL);
+
+        // the waiting thread returns as soon as its frame is done, the lane goes on elsewhere
+        if (next && lc->waiter) {
+            add_task(s, next, NULL);
+            break;
+        }
+        t = next;
+    }
+}
+
+static void task_run_hash(VVCTask *t, VVCContext *s)
+{
+    VVCFrameContext *fc = t->fc;
+    VVCFrameThread *ft  = fc->ft;
+    const int ret       = ff_vvc_verify_picture_hash(&fc->picture_hash, fc->ref->frame,
+        fc->ps.sps, fc->ps.pps, fc->ref->poc, s->avctx);
+
+    if (ret < 0 && (ret == AVERROR(ENOMEM) || s->avctx->err_recognition & AV_EF_EXPLODE)) {
+#ifdef COMPAT_ATOMICS_WIN32_STDATOMIC_H
+        intptr_t zero = 0;
+#else
+        int zero = 0;
+#endif
+        atomic_compare_exchange_strong(&ft->ret, &zero, ret);
+    }
+}
+
+static void task_run_read(VVCPacketRead *r)
+{
+    VVCContext *s = r->s;
+
+    ff_cbs_fragment_reset(&s->current_frame);
+    r->ret = ff_cbs_read_packet(s->cbc, &s->current_frame, r->pkt);
+
+    ff_mutex_lock(&r->lock);
+    atomic_store(&r->done, 1);
+    ff_cond_signal(&r->cond);
+    ff_mutex_unlock(&r->lock);
+}
+
+static void task_run_one(VVCTask *t, VVCLocalContext *lc)
+{
+    VVCFrameThread *ft;
+    VVCContext *s;
+
+    if (!t->fc) {
+        task_run_read((VVCPacketRead *)t);
+        return;
+    }
+
+    ft     = t->fc->ft;
+    s      = ft->s;
     lc->fc = t->fc;
 
+    if (t->stage == VVC_TASK_STAGE_LAST) {
+        task_run_hash(t, s);
+        sheduled_done(ft, &ft->nb_scheduled_tasks);
+        return;
+    }
+
+    if (t->fc->ref->stage_stats)
+        stats_add(&t->fc->ref->stage_stats->ready[t->stage], av_gettime_relative() - t->ready_time);
+
+    if (t->stage == VVC_TASK_STAGE_PARSE) {
+        task_run_parse(t, s, lc);
+        sheduled_done(ft, &ft->nb_scheduled_tasks);
+        return;
+    }
+
+    if (stage_is_batched(ft, t->stage)) {
+        task_run_batch(t, s, lc);
+        sheduled_done(ft, &ft->nb_scheduled_tasks);
+        return;
+    }
+
     do {
         task_run_stage(t, s, lc);
         t->stage++;
-    } while (task_is_stage_ready(t, 1));
+    } while (!stage_is_batched(ft, t->stage) && task_is_stage_ready(t, 1));
 
     if (t->stage != VVC_TASK_STAGE_LAST)
-        frame_thread_add_score(s, ft, t->rx, t->ry, t->stage);
+        frame_thread_add_score(s, ft, t->rx, t->ry, t->stage, lc);
 
     sheduled_done(ft, &ft->nb_scheduled_tasks);
+}
+
+// A task made ready by the one running is kept by the worker and run next, with the data
+// of their neighbouring ctus still in its caches, rather than queued and run by another one.
+static int task_run(AVTask *_t, void *local_context, void *user_data)
+{
+    VVCLocalContext *lc = local_context;
+    VVCTask *t          = (VVCTask*)_t;
+    // without threads, the executor runs the tasks added by a task inside it, with the same lc
+    VVCTask *outer      = lc->continuation;
+
+    while (t) {
+        lc->continuation = NULL;
+        task_run_one(t, lc);
+        t = lc->continuation;
+    }
+    lc->continuation = outer;
 
     return 0;
 }
 
-AVExecutor* ff_vvc_executor_alloc(VVCContext *s, const int thread_count)
+static int task_group(const AVTask *_t, void *user_data)
+{
+    const VVCTask *t = (const VVCTask*)_t;
+
+    return t->fc ? t->fc->ft->home : 0;
+}
+
+static int alloc_executor(AVExecutor **e, void *user_data, const int thread_count, const int flags)
 {
     AVTaskCallbacks callbacks = {
-        s,
-        sizeof(VVCLocalContext),
-        task_priority_higher,
-        task_ready,
-        task_run,
+        .user_data          = user_data,
+        .local_context_size = sizeof(VVCLocalContext),
+        .run                = task_run,
     };
-    return av_executor_alloc(&callbacks, thread_count);
+    const AVTaskCallbacksExt ext = {
+        .size               = sizeof(ext),
+        .priority           = task_priority,
+        .group              = task_group,
+    };
+
+    *e = av_executor_alloc2(&callbacks, &ext, thread_count, flags);
+    return *e ? 0 : AVERROR(ENOMEM);
+}
+
+// one executor for all decoders opened with shared_threads
+static AVMutex shared_lock = AV_MUTEX_INITIALIZER;
+static AVExecutor *shared_executor;
+static int shared_refs;
+
+AVExecutor* ff_vvc_executor_alloc(VVCContext *s, const int thread_count)
+{
+    const int flags = (s->thread_affinity ? AV_EXECUTOR_FLAG_AFFINITY : 0) |
+                      (s->stage_stats     ? AV_EXECUTOR_FLAG_STATS    : 0);
+    AVExecutor *e   = NULL;
+
+    if (!s->shared_threads) {
+        alloc_executor(&e, s, thread_count, flags);
+        return e;
+    }
+
+    ff_mutex_lock(&shared_lock);
+    if (shared_executor || !alloc_executor(&shared_executor, &shared_executor, av_cpu_count(), flags)) {
+        shared_refs++;
+        e = shared_executor;
+    }
+    ff_mutex_unlock(&shared_lock);
+
+    return e;
 }
 
 void ff_vvc_executor_free(AVExecutor **e)
 {
+    if (!*e)
+        return;
+
+    ff_mutex_lock(&shared_lock);
+    if (*e == shared_executor) {
+        // all frames of the decoder are done, no task of it is left in the executor
+        if (!--shared_refs)
+            av_executor_free(&shared_executor);
+        *e = NULL;
+    }
+    ff_mutex_unlock(&shared_lock);
+
     av_executor_free(e);
 }
 
+int ff_vvc_executor_nb_users(const AVExecutor *e)
+{
+    int nb_users = 1;
+
+    ff_mutex_lock(&shared_lock);
+    if (e == shared_executor)
+        nb_users = shared_refs;
+    ff_mutex_unlock(&shared_lock);
+
+    return nb_users;
+}
+
+int ff_vvc_trace_init(VVCContext *s, const int nb_threads)
+{
+    VVCTrace *tr;
+
+    if (!s->trace_file)
+        return 0;
+
+    tr = s->trace = av_mallocz(sizeof(*tr));
+    if (!tr)
+        return AVERROR(ENOMEM);
+
+    tr->size     = 1U << av_log2(FFMAX(s->trace_size, 1));
+    tr->nb_rings = FFMAX(nb_threads, 1) + 1;
+    tr->epoch    = av_gettime_relative();
+    atomic_init(&tr->own_ids, 0);
+    tr->next_id  = s->shared_threads ? &shared_trace_ids : &tr->own_ids;
+    tr->rings    = av_calloc(tr->nb_rings, sizeof(*tr->rings));
+    if (!tr->rings)
+        return AVERROR(ENOMEM);
+
+    for (int i = 0; i < tr->nb_rings; i++) {
+        VVCTraceRing *ring = tr->rings + i;
+
+        atomic_init(&ring->head, 0);
+        ring->events = av_malloc_array(tr->size, sizeof(*ring->events));
+        if (!ring->events)
+            return AVERROR(ENOMEM);
+    }
+
+    return 0;
+}
+
+// write the events in the Chrome trace event format, loadable by chrome://tracing and Perfetto
+static void trace_write(const VVCContext *s, const VVCTrace *tr)
+{
+    FILE *f = avpriv_fopen_utf8(s->trace_file, "w");
+    const char *sep = "";
+
+    if (!f) {
+        av_log(s->avctx, AV_LOG_ERROR, "Cannot open trace file %s.\n", s->trace_file);
+        return;
+    }
+
+    fprintf(f, "{\"traceEvents\":[\n");
+    for (int i = 0; i < tr->nb_rings; i++) {
+        const VVCTraceRing *ring = tr->rings + i;
+        const unsigned head      = atomic_load(&ring->head);
+        const unsigned nb_events = FFMIN(head, tr->size);
+
+        for (unsigned j = head - nb_events; j != head; j++) {
+            const VVCTraceEvent *ev = ring->events + (j & (tr->size - 1));
+
+            fprintf(f, "%s{\"name\":\"%s\",\"cat\":\"vvc\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,"
+                "\"ts\":%"PRId64",\"dur\":%"PRId64",\"args\":{\"frame\":%"PRIu64",\"rx\":%d,\"ry\":%d}}",
+                sep, stage_name[ev->stage], i, ev->start - tr->epoch, ev->end - ev->start,
+                ev->decode_order, ev->rx, ev->ry);
+            sep = ",\n";
+        }
+    }
+    fprintf(f, "\n]}\n");
+    fclose(f);
+}
+
+void ff_vvc_trace_uninit(VVCContext *s)
+{
+    VVCTrace *tr = s->trace;
+
+    if (!tr)
+        return;
+
+    if (tr->rings) {
+        trace_write(s, tr);
+        for (int i = 0; i < tr->nb_rings; i++)
+            av_free(tr->rings[i].events);
+        av_free(tr->rings);
+    }
+    av_freep(&s->trace);
+}
+
+// a picture is added to the totals once all its tasks are done and no frame context holds it
+static void stage_stats_free(FFRefStructOpaque opaque, void *obj)
+{
+    VVCStageStats *totals      = opaque.nc;
+    const VVCStageStats *stats = obj;
+
+    for (int i = 0; i < VVC_TASK_STAGE_LAST; i++) {
+        stats_add(&totals->tasks[i],   atomic_load(&stats->tasks[i]));
+        stats_add(&totals->run[i],     atomic_load(&stats->run[i]));
+        stats_add(&totals->ready[i],   atomic_load(&stats->ready[i]));
+        stats_add(&totals->blocked[i], atomic_load(&stats->blocked[i]));
+        stats_add(&totals->replay[i],  atomic_load(&stats->replay[i]));
+    }
+}
+
+static void stage_stats_reset(VVCStageStats *stats)
+{
+    for (int i = 0; i < VVC_TASK_STAGE_LAST; i++) {
+        atomic_init(&stats->tasks[i],   0);
+        atomic_init(&stats->run[i],     0);
+        atomic_init(&stats->ready[i],   0);
+        atomic_init(&stats->blocked[i], 0);
+        atomic_init(&stats->replay[i],  0);
+    }
+}
+
+int ff_vvc_stage_stats_init(VVCContext *s)
+{
+    if (!s->stage_stats)
+        return 0;
+
+    s->stage_totals = av_malloc(sizeof(*s->stage_totals));
+    if (!s->stage_totals)
+        return AVERROR(ENOMEM);
+    stage_stats_reset(s->stage_totals);
+
+    return 0;
+}
+
+VVCStageStats *ff_vvc_stage_stats_alloc(VVCContext *s)
+{
+    VVCStageStats *stats = ff_refstruct_alloc_ext(sizeof(*stats), 0, s->stage_totals, stage_stats_free);
+
+    if (stats)
+        stage_stats_reset(stats);
+    return stats;
+}
+
+int ff_vvc_stage_stats_export(AVFrame *frame, const VVCStageStats *stats)
+{
+    for (int i = 0; i < VVC_TASK_STAGE_LAST; i++) {
+        const struct {
+            const char *name;
+            const atomic_int_least64_t *v;
+        } fields[] = {
+            { "tasks",   &stats->tasks[i]   },
+            { "run",     &stats->run[i]     },
+            { "ready",   &stats->ready[i]   },
+            { "blocked", &stats->blocked[i] },
+            { "replay",  &stats->replay[i]  },
+        };
+
+        for (int j = 0; j < FF_ARRAY_ELEMS(fields); j++) {
+            char key[64];
+            int ret;
+
+            snprintf(key, sizeof(key), "lavc.vvc.%s.%s", stage_name[i], fields[j].name);
+            ret = av_dict_set_int(&frame->metadata, key, atomic_load(fields[j].v), 0);
+            if (ret < 0)
+                return ret;
+        }
+    }
+    return 0;
+}
+
+void ff_vvc_executor_stats_log(VVCContext *s)
+{
+    AVExecutorStats st;
+
+    // a shared executor logs the stats of all the decoders using it
+    if (!s->stage_stats || !s->executor || av_executor_get_stats(s->executor, &st) < 0)
+        return;
+
+    av_log(s->avctx, AV_LOG_INFO, "executor: %"PRIu64" tasks, %"PRIu64" stolen, %.2f ready polls/task, "
+           "queue length avg %.1f max %d\n", st.nb_tasks, st.nb_stolen,
+           st.nb_tasks ? (double)st.nb_ready_polls / st.nb_tasks : 0.0, st.avg_queue_length, st.max_queue_length);
+    av_log(s->avctx, AV_LOG_INFO, "executor: run %.1f ms, idle %.1f ms, lock wait %.1f ms, lock hold %.1f ms\n",
+           st.run_time / 1000.0, st.idle_time / 1000.0, st.lock_wait_time / 1000.0, st.lock_hold_time / 1000.0);
+}
+
+void ff_vvc_stage_stats_uninit(VVCContext *s)
+{
+    const VVCStageStats *totals = s->stage_totals;
+    int64_t run = 0;
+
+    if (!totals)
+        return;
+
+    for (int i = 0; i < VVC_TASK_STAGE_LAST; i++)
+        run += atomic_load(&totals->run[i]);
+
+    av_log(s->avctx, AV_LOG_INFO, "%-10s %10s %12s %8s %7s %12s %12s%s\n",
+           "stage", "tasks", "run ms", "us/task", "share", "ready ms", "blocked ms", s->replay ? "    replay ms" : "");
+    for (int i = 0; i < VVC_TASK_STAGE_LAST; i++) {
+        const int64_t tasks = atomic_load(&totals->tasks[i]);
+        const int64_t r     = atomic_load(&totals->run[i]);
+        char replay[16]     = "";
+
+        if (s->replay)
+            snprintf(replay, sizeof(replay), " %12.1f", atomic_load(&totals->replay[i]) / 1000.0);
+        av_log(s->avctx, AV_LOG_INFO, "%-10s %10"PRId64" %12.1f %8.2f %6.1f%% %12.1f %12.1f%s\n",
+               stage_name[i], tasks, r / 1000.0, tasks ? (double)r / tasks : 0.0, run ? 100.0 * r / run : 0.0,
+               atomic_load(&totals->ready[i]) / 1000.0, atomic_load(&totals->blocked[i]) / 1000.0, replay);
+    }
+    av_freep(&s->stage_totals);
+}
+
 void ff_vvc_frame_thread_free(VVCFrameContext *fc)
 {
     VVCFrameThread *ft = fc->ft;
@@ -650,6 +1613,13 @@ void ff_vvc_frame_thread_free(VVCFrameContext *fc)
     ff_cond_destroy(&ft->cond);
     av_freep(&ft->rows);
     av_freep(&ft->tasks);
+    av_freep(&ft->batch_pending);
+    av_freep(&ft->free_slots);
+    if (ft->arenas) {
+        for (int i = 0; i < ft->nb_coeff_slots; i++)
+            ff_vvc_ctu_arena_free(ft->arenas + i);
+        av_freep(&ft->arenas);
+    }
     av_freep(&ft);
 }
 
@@ -665,21 +1635,32 @@ static void frame_thread_init_score(VVCFrameContext *fc)
 
         for (task.rx = -1; task.rx <= ft->ctu_width; task.rx++) {
             task.ry = -1;                           //top
-            task_stage_done(&task, NULL);
+            task_stage_done(&task, NULL, NULL);
             task.ry = ft->ctu_height;               //bottom
-            task_stage_done(&task, NULL);
+            task_stage_done(&task, NULL, NULL);
         }
 
         for (task.ry = 0; task.ry < ft->ctu_height; task.ry++) {
             task.rx = -1;                           //left
-            task_stage_done(&task, NULL);
+            task_stage_done(&task, NULL, NULL);
             task.rx = ft->ctu_width;                //right
-            task_stage_done(&task, NULL);
+            task_stage_done(&task, NULL, NULL);
+        }
+    }
+
+    // the ctus of the other tiles count as done, like the ones outside of the picture
+    if (!memchr(ft->tile_split, 1, sizeof(ft->tile_split)))
+        return;
+    for (int i = VVC_TASK_STAGE_RECON; i < VVC_TASK_STAGE_LAST; i++) {
+        task.stage = i;
+        for (task.ry = 0; task.ry < ft->ctu_height; task.ry++) {
+            for (task.rx = 0; task.rx < ft->ctu_width; task.rx++)
+                stage_done(&task, NULL, NULL, 1);
         }
     }
 }
 
-int ff_vvc_frame_thread_init(VVCFrameContext *fc)
+int ff_vvc_frame_thread_init(VVCContext *s, VVCFrameContext *fc)
 {
     const VVCSPS *sps  = fc->ps.sps;
     const VVCPPS *pps  = fc->ps.pps;
@@ -688,7 +1669,9 @@ int ff_vvc_frame_thread_init(VVCFrameContext *fc)
 
     if (!ft || ft->ctu_width != pps->ctb_width ||
         ft->ctu_height != pps->ctb_height ||
-        ft->ctu_size != sps->ctb_size_y) {
+        ft->ctu_size != sps->ctb_size_y ||
+        ft->filter_batch != s->filter_batch ||
+        ft->nb_coeff_slots != fc->tab.sz.coeff_slots) {
 
         ff_vvc_frame_thread_free(fc);
         ft = av_calloc(1, sizeof(*fc->ft));
@@ -708,6 +1691,19 @@ int ff_vvc_frame_thread_init(VVCFrameContext *fc)
         if (!ft->tasks)
             goto fail;
 
+        ft->filter_batch = s->filter_batch;
+        ft->nb_runs      = (ft->ctu_width + ft->filter_batch - 1) / ft->filter_batch;
+        ft->batch_pending = av_malloc_array(ft->ctu_height * ft->nb_runs,
+            (VVC_TASK_STAGE_LAST - VVC_TASK_STAGE_DEBLOCK_V) * sizeof(*ft->batch_pending));
+        if (!ft->batch_pending)
+            goto fail;
+
+        ft->nb_coeff_slots = fc->tab.sz.coeff_slots;
+        ft->free_slots     = av_malloc_array(ft->nb_coeff_slots, sizeof(*ft->free_slots));
+        ft->arenas         = av_calloc(ft->nb_coeff_slots, sizeof(*ft->arenas));
+        if (!ft->free_slots || !ft->arenas)
+            goto fail;
+
         if ((ret = ff_cond_init(&ft->cond, NULL)))
             goto fail;
 
@@ -718,9 +1714,13 @@ int ff_vvc_frame_thread_init(VVCFrameContext *fc)
     }
     fc->ft = ft;
     ft->ret = 0;
+    atomic_store(&ft->nb_concealed, 0);
+    ft->s    = s;
+    ft->home = (fc - s->fcs) % av_executor_nb_groups(s->executor);
     for (int y = 0; y < ft->ctu_height; y++) {
         VVCRowThread *row = ft->rows + y;
         memset(row->col_progress, 0, sizeof(row->col_progress));
+        row->pixel_prefix = row->pixel_reported = 0;
     }
 
     for (int rs = 0; rs < ft->ctu_count; rs++) {
@@ -730,6 +1730,35 @@ int ff_vvc_frame_thread_init(VVCFrameContext *fc)
 
     memset(&ft->row_progress[0], 0, sizeof(ft->row_progress));
 
+    // Without loop filtering across tiles, the filters of a tile neither read nor write the samples
+    // of the others, so each tile runs its own wavefront of filter stages. Reconstruction keeps the
+    // picture order: the boundary strengths derived with it read the ctus above and left of it.
+    // The batched stages count the ctus of their runs instead.
+    memset(ft->tile_split, 0, sizeof(ft->tile_split));
+    if (pps->r->num_tiles_in_pic > 1 && !pps->r->pps_loop_filter_across_tiles_enabled_flag) {
+        for (int i = VVC_TASK_STAGE_DEBLOCK_V; i < VVC_TASK_STAGE_LAST; i++)
+            ft->tile_split[i] = !stage_is_batched(ft, i);
+    }
+
+    for (int ry = 0; ry < ft->ctu_height; ry++) {
+        for (int rx = 0; rx < ft->ctu_width; rx += ft->filter_batch) {
+            const int n = FFMIN(ft->filter_batch, ft->ctu_width - rx);
+            for (int i = VVC_TASK_STAGE_DEBLOCK_V; i < VVC_TASK_STAGE_LAST; i++)
+                atomic_store(run_pending(ft, rx, ry, i), n);
+        }
+    }
+
+    // lowest slots first, so a frame that fits touches the same memory as before
+    ft->nb_free_slots = ft->nb_coeff_slots;
+    for (int i = 0; i < ft->nb_coeff_slots; i++)
+        ft->free_slots[i] = ft->nb_coeff_slots - 1 - i;
+    ft->next_slot_rs = 0;
+    ft->nb_submitted_slices = 0;
+
+    // the scores of the stages depend on it
+    ft->split_recon = sps->r->sps_qtbtt_dual_tree_intra_flag && !fc->ps.ph.r->ph_inter_slice_allowed_flag &&
+                      sps->r->sps_chroma_format_idc && !fc->gray;
+
     frame_thread_init_score(fc);
 
     return 0;
@@ -738,6 +1767,9 @@ fail:
     if (ft) {
         av_freep(&ft->rows);
         av_freep(&ft->tasks);
+        av_freep(&ft->batch_pending);
+        av_freep(&ft->free_slots);
+        av_freep(&ft->arenas);
         av_freep(&ft);
     }
 
@@ -754,11 +1786,11 @@ static void check_colocation(VVCContext *s, VVCTask *t)
         if (col && first_col) {
             //we depend on bottom and right boundary, do not - 1 for y
             const int y = (t->ry << fc->ps.sps->ctb_log2_size_y);
-            add_progress_listener(col, &t->col_listener, t, s, VVC_PROGRESS_MV, y);
+            add_progress_listener(col, &t->col_listener, t, s, VVC_PROGRESS_MV, y, INT_MAX);
             return;
         }
     }
-    frame_thread_add_score(s, fc->ft, t->rx, t->ry, VVC_TASK_STAGE_PARSE);
+    frame_thread_add_score(s, fc->ft, t->rx, t->ry, VVC_TASK_STAGE_PARSE, NULL);
 }
 
 static void submit_entry_point(VVCContext *s, VVCFrameThread *ft, SliceContext *sc, EntryPoint *ep)
@@ -766,54 +1798,331 @@ static void submit_entry_point(VVCContext *s, VVCFrameThread *ft, SliceContext *
     const int rs = sc->sh.ctb_addr_in_curr_slice[ep->ctu_start];
     VVCTask *t   = ft->tasks + rs;
 
-    frame_thread_add_score(s, ft, t->rx, t->ry, VVC_TASK_STAGE_PARSE);
+    frame_thread_add_score(s, ft, t->rx, t->ry, VVC_TASK_STAGE_PARSE, NULL);
 }
 
-int ff_vvc_frame_submit(VVCContext *s, VVCFrameContext *fc)
+static int submit_slice(VVCContext *s, VVCFrameContext *fc, SliceContext *sc)
 {
     VVCFrameThread *ft = fc->ft;
 
+    if (!ft->nb_submitted_slices) {
+        const VVCSPS *sps = fc->ps.sps;
+
+        // bands are only useful in display order unless the caller asked otherwise
+        ft->draw_bands = s->avctx->draw_horiz_band && !s->parse_only &&
+            ((s->avctx->slice_flags & SLICE_FLAG_CODED_ORDER) ||
+             !sps->r->sps_dpb_params.dpb_max_num_reorder_pics[ff_vvc_highest_tid(s, sps)]);
+    }
+
     // We'll handle this in two passes:
     // Pass 0 to initialize tasks with parser, this will help detect bit stream error
     // Pass 1 to shedule location check and submit the entry point
     for (int pass = 0; pass < 2; pass++) {
-        for (int i = 0; i < fc->nb_slices; i++) {
-            SliceContext *sc = fc->slices[i];
-            for (int j = 0; j < sc->nb_eps; j++) {
-                EntryPoint *ep = sc->eps + j;
-                for (int k = ep->ctu_start; k < ep->ctu_end; k++) {
-                    const int rs = sc->sh.ctb_addr_in_curr_slice[k];
-                    VVCTask *t   = ft->tasks + rs;
-                    if (pass) {
-                        check_colocation(s, t);
-                    } else {
-                        const int ret = task_init_parse(t, sc, ep, k);
-                        if (ret < 0)
-                            return ret;
-                    }
+        // the ctus of the slices not submitted yet miss the other scores, so they wait with a slot
+        if (pass && !ft->nb_submitted_slices)
+            coeff_slots_grant(s, ft);
+        for (int j = 0; j < sc->nb_eps; j++) {
+            EntryPoint *ep = sc->eps + j;
+            for (int k = ep->ctu_start; k < ep->ctu_end; k++) {
+                const int rs = sc->sh.ctb_addr_in_curr_slice[k];
+                VVCTask *t   = ft->tasks + rs;
+                if (pass) {
+                    check_colocation(s, t);
+                } else {
+                    const int ret = task_init_parse(t, sc, ep, k);
+                    if (ret < 0)
+                        return ret;
                 }
-                if (pass)
-                    submit_entry_point(s, ft, sc, ep);
             }
+            if (pass)
+                submit_entry_point(s, ft, sc, ep);
         }
     }
+    ft->nb_submitted_slices++;
+
     return 0;
 }
 
-int ff_vvc_frame_wait(VVCContext *s, VVCFrameContext *fc)
+int ff_vvc_frame_submit_slices(VVCContext *s, VVCFrameContext *fc)
 {
     VVCFrameThread *ft = fc->ft;
 
-    ff_mutex_lock(&ft->lock);
+    while (ft->nb_submitted_slices < fc->nb_slices - 1) {
+        const int ret = submit_slice(s, fc, fc->slices[ft->nb_submitted_slices]);
+        if (ret < 0)
+            return ret;
+    }
+    return 0;
+}
 
-    while (atomic_load(&ft->nb_scheduled_tasks) || atomic_load(&ft->nb_scheduled_listeners))
-        ff_cond_wait(&ft->cond, &ft->lock);
+int ff_vvc_frame_submit(VVCContext *s, VVCFrameContext *fc)
+{
+    VVCFrameThread *ft = fc->ft;
 
-    ff_mutex_unlock(&ft->lock);
+    while (ft->nb_submitted_slices < fc->nb_slices) {
+        const int ret = submit_slice(s, fc, fc->slices[ft->nb_submitted_slices]);
+        if (ret < 0)
+            return ret;
+    }
+    return 0;
+}
+
+// The tasks that wait for the scores of the slices not submitted yet do not run before
+// these add them, so once the others ran, no task touches the frame context.
+static void frame_idle(VVCContext *s, VVCFrameThread *ft)
+{
+    // run the ready tasks of any frame while this one is not done, and block only when there are none
+    while (atomic_load(&ft->nb_scheduled_tasks) || atomic_load(&ft->nb_scheduled_listeners)) {
+        if (s->wait_lc && av_executor_run_one(s->executor, s->wait_lc))
+            continue;
+
+        ff_mutex_lock(&ft->lock);
+        while (atomic_load(&ft->nb_scheduled_tasks) || atomic_load(&ft->nb_scheduled_listeners))
+            ff_cond_wait(&ft->cond, &ft->lock);
+        ff_mutex_unlock(&ft->lock);
+    }
+}
+
+void ff_vvc_frame_pause(VVCContext *s, VVCFrameContext *fc)
+{
+    if (!s->avctx->hwaccel && fc->ft->nb_submitted_slices)
+        frame_idle(s, fc->ft);
+}
+
+void ff_vvc_frame_eps_moved(VVCFrameContext *fc)
+{
+    VVCFrameThread *ft = fc->ft;
+
+    for (int i = 0; i < ft->nb_submitted_slices; i++) {
+        SliceContext *sc = fc->slices[i];
+        for (int j = 0; j < sc->nb_eps; j++) {
+            EntryPoint *ep = sc->eps + j;
+            for (int k = ep->ctu_start; k < ep->ctu_end; k++)
+                ft->tasks[sc->sh.ctb_addr_in_curr_slice[k]].ep = ep;
+        }
+    }
+}
+
+// the stages a ctu runs again, as task_run_stage() would
+static int replay_ctu(const VVCContext *s, const VVCFrameContext *fc, const VVCTask *t, const VVCTaskStage stage)
+{
+    return t->sc && !t->sc->skipped && !s->parse_only &&
+        !(fc->skip_loop_filter && stage >= VVC_TASK_STAGE_DEBLOCK_V);
+}
+
+static int replay_timed(const VVCContext *s, const VVCTaskStage stage)
+{
+    static const uint8_t flag[VVC_TASK_STAGE_LAST] = {
+        [VVC_TASK_STAGE_INTER]        = VVC_REPLAY_INTER,
+        [VVC_TASK_STAGE_RECON]        = VVC_REPLAY_RECON,
+        [VVC_TASK_STAGE_RECON_CHROMA] = VVC_REPLAY_RECON,
+        [VVC_TASK_STAGE_LMCS]         = VVC_REPLAY_LMCS,
+        [VVC_TASK_STAGE_DEBLOCK_V]    = VVC_REPLAY_DEBLOCK,
+        [VVC_TASK_STAGE_DEBLOCK_H]    = VVC_REPLAY_DEBLOCK,
+        [VVC_TASK_STAGE_SAO]          = VVC_REPLAY_SAO,
+        [VVC_TASK_STAGE_ALF]          = VVC_REPLAY_ALF,
+    };
+    return s->replay_stages & flag[stage];
+}
+
+static void replay_stage(VVCContext *s, VVCLocalContext *lc, VVCTask *t, const VVCTaskStage stage)
+{
+    const int ctu_size = lc->fc->ft->ctu_size;
+
+    lc->sc = t->sc;
+    // without the progress reports and the output of the picture
+    if (t->concealed && stage < VVC_TASK_STAGE_DEBLOCK_V) {
+        if (stage == VVC_TASK_STAGE_INTER)
+            ff_vvc_conceal_ctu(lc, conceal_ref(t->sc), t->rx * ctu_size, t->ry * ctu_size);
+    } else if (stage == VVC_TASK_STAGE_INTER)
+        ff_vvc_predict_inter(lc, t->rs);
+    else if (stage == VVC_TASK_STAGE_RECON)
+        run_recon(s, lc, t);
+    else if (stage == VVC_TASK_STAGE_RECON_CHROMA)
+        run_recon_chroma(s, lc, t);
+    else if (stage == VVC_TASK_STAGE_LMCS)
+        run_lmcs(s, lc, t);
+    else if (stage == VVC_TASK_STAGE_DEBLOCK_V)
+        run_deblock_v(s, lc, t);
+    else if (stage == VVC_TASK_STAGE_DEBLOCK_H)
+        run_deblock_h(s, lc, t);
+    else if (stage == VVC_TASK_STAGE_SAO)
+        run_sao(s, lc, t);
+    else
+        alf_filter(lc, t);
+}
+
+static int replay_frame_alloc(VVCContext *s, const VVCFrameContext *fc)
+{
+    const AVFrame *frame = fc->frame;
+    const int ctb_size   = fc->ps.sps->ctb_size_y;
+    AVFrame *scratch     = s->replay_frame;
+    int ret;
+
+    if (scratch->buf[0] && scratch->format == frame->format &&
+        scratch->width == frame->width && scratch->height == frame->height)
+        return 0;
+
+    av_frame_unref(scratch);
+    // the ctus at the right and bottom edges may be written up to their end
+    scratch->format = frame->format;
+    scratch->width  = FFALIGN(frame->width, ctb_size);
+    scratch->height = FFALIGN(frame->height, ctb_size);
+    ret = av_frame_get_buffer(scratch, 0);
+    if (ret < 0)
+        return ret;
+    scratch->width  = frame->width;
+    scratch->height = frame->height;
+
+    return 0;
+}
+
+// The stages after the parse rewrite every sample of the picture from the parsed ctus and the
+// references, so they are run again, one after another for all the ctus, on a scratch picture.
+// The ones before the last replayed stage run too, for their output, but are not timed.
+static int frame_replay(VVCContext *s, VVCFrameContext *fc)
+{
+    VVCFrameThread *ft   = fc->ft;
+    VVCStageStats *stats = fc->ref->stage_stats;
+    VVCLocalContext *lc  = s->replay_lc;
+    AVFrame *frame       = fc->frame;
+    VVCTaskStage last    = VVC_TASK_STAGE_PARSE;
+    int ret;
+
+    for (int i = VVC_TASK_STAGE_INTER; i < VVC_TASK_STAGE_LAST; i++) {
+        if (replay_timed(s, i))
+            last = i;
+    }
+    if (last == VVC_TASK_STAGE_PARSE || !stats)
+        return 0;
+    // the reconstruction transforms the 32 bit coefficients in place
+    if (!fc->tab.sz.coeffs16) {
+        av_log(s->avctx, AV_LOG_WARNING, "No replay of frame %d, its coefficients are not kept.\n",
+               (int)fc->decode_order);
+        return 0;
+    }
+
+    ret = replay_frame_alloc(s, fc);
+    if (ret < 0)
+        return ret;
+
+    lc->fc    = fc;
+    fc->frame = s->replay_frame;
+    for (int i = 0; i < s->replay; i++) {
+        for (VVCTaskStage stage = VVC_TASK_STAGE_INTER; stage <= last; stage++) {
+            const int64_t start = av_gettime_relative();
+
+            for (int rs = 0; rs < ft->ctu_count; rs++) {
+                VVCTask *t = ft->tasks + rs;
+
+                if (replay_ctu(s, fc, t, stage))
+                    replay_stage(s, lc, t, stage);
+            }
+            if (replay_timed(s, stage))
+                stats_add(&stats->replay[stage], av_gettime_relative() - start);
+        }
+    }
+    fc->frame = frame;
+
+    return 0;
+}
+
+int ff_vvc_frame_wait(VVCContext *s, VVCFrameContext *fc)
+{
+    VVCFrameThread *ft = fc->ft;
+    int ret = 0;
+
+    frame_idle(s, ft);
+    if (s->replay) {
+        if (!atomic_load(&ft->ret))
+            ret = frame_replay(s, fc);
+        for (int rs = 0; rs < ft->ctu_count; rs++)
+            ff_vvc_ctu_free_cus(fc->tab.ctus + rs);
+        for (int i = 0; i < ft->nb_coeff_slots; i++)
+            ff_vvc_ctu_arena_reset(ft->arenas + i);
+    }
     ff_vvc_report_frame_finished(fc->ref);
 
 #ifdef VVC_THREAD_DEBUG
     av_log(s->avctx, AV_LOG_DEBUG, "frame %5d done\r\n", (int)fc->decode_order);
 #endif
-    return ft->ret;
+    return ret < 0 ? ret : ft->ret;
+}
+
+int ff_vvc_packet_read_init(VVCContext *s)
+{
+    VVCPacketRead *r = av_mallocz(sizeof(*r));
+
+    if (!r)
+        return AVERROR(ENOMEM);
+    r->pkt = av_packet_alloc();
+    if (!r->pkt)
+        goto fail;
+    if (ff_mutex_init(&r->lock, NULL))
+        goto fail;
+    if (ff_cond_init(&r->cond, NULL)) {
+        ff_mutex_destroy(&r->lock);
+        goto fail;
+    }
+    r->s    = s;
+    s->read = r;
+
+    return 0;
+
+fail:
+    av_packet_free(&r->pkt);
+    av_free(r);
+    return AVERROR(ENOMEM);
+}
+
+void ff_vvc_packet_read_free(VVCContext *s)
+{
+    VVCPacketRead *r = s->read;
+
+    if (!r)
+        return;
+    ff_vvc_packet_read_wait(s);
+    av_packet_free(&r->pkt);
+    ff_cond_destroy(&r->cond);
+    ff_mutex_destroy(&r->lock);
+    av_freep(&s->read);
+}
+
+void ff_vvc_packet_read_start(VVCContext *s, AVPacket *pkt)
+{
+    VVCPacketRead *r = s->read;
+
+    av_packet_move_ref(r->pkt, pkt);
+    memset(&r->task, 0, sizeof(r->task));
+    atomic_store(&r->done, 0);
+    r->pending = 1;
+
+    av_executor_execute(s->executor, &r->task.u.task);
+}
+
+int ff_vvc_packet_read_pending(const VVCContext *s)
+{
+    return s->read && s->read->pending;
+}
+
+int ff_vvc_packet_read_wait(VVCContext *s)
+{
+    VVCPacketRead *r = s->read;
+
+    if (!ff_vvc_packet_read_pending(s))
+        return 0;
+
+    while (!atomic_load(&r->done)) {
+        if (av_executor_run_one(s->executor, s->wait_lc))
+            continue;
+
+        ff_mutex_lock(&r->lock);
+        while (!atomic_load(&r->done))
+            ff_cond_wait(&r->cond, &r->lock);
+        ff_mutex_unlock(&r->lock);
+    }
+    r->pending = 0;
+    av_packet_unref(r->pkt);
+
+    return r->ret;
 }
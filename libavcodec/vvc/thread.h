@@ -27,10 +27,57 @@
 
 struct AVExecutor* ff_vvc_executor_alloc(VVCContext *s, int thread_count);
 void ff_vvc_executor_free(struct AVExecutor **e);
+/**
+ * @return the number of decoders using e, more than 1 only for the shared executor
+ */
+int ff_vvc_executor_nb_users(const struct AVExecutor *e);
+
+int ff_vvc_trace_init(VVCContext *s, int nb_threads);
+void ff_vvc_trace_uninit(VVCContext *s);
+
+int ff_vvc_stage_stats_init(VVCContext *s);
+/**
+ * Allocate the stage stats of a picture, which are added to the totals of s once freed.
+ * @return a RefStruct reference or NULL on failure
+ */
+struct VVCStageStats *ff_vvc_stage_stats_alloc(VVCContext *s);
+/**
+ * Set the stage stats as metadata of frame, lavc.vvc.<stage>.{tasks,run,ready,blocked}.
+ */
+int ff_vvc_stage_stats_export(struct AVFrame *frame, const struct VVCStageStats *stats);
+// log the totals and free them, all the pictures must be freed already
+void ff_vvc_stage_stats_uninit(VVCContext *s);
+// log the scheduling stats of the executor, before it is freed
+void ff_vvc_executor_stats_log(VVCContext *s);
 
-int ff_vvc_frame_thread_init(VVCFrameContext *fc);
+int ff_vvc_frame_thread_init(VVCContext *s, VVCFrameContext *fc);
 void ff_vvc_frame_thread_free(VVCFrameContext *fc);
+/**
+ * Start the tasks of the slices of fc but the last one, while the next NAL units are
+ * decoded. The last one completes the picture, so it waits for the suffix NAL units,
+ * until ff_vvc_frame_submit() starts it with any slice left.
+ */
+int ff_vvc_frame_submit_slices(VVCContext *s, VVCFrameContext *fc);
 int ff_vvc_frame_submit(VVCContext *s, VVCFrameContext *fc);
+/**
+ * Wait until the started tasks of fc only wait for the slices not submitted yet, so
+ * the slice and entry point arrays of fc can move.
+ */
+void ff_vvc_frame_pause(VVCContext *s, VVCFrameContext *fc);
+// point the tasks of the submitted slices at their entry points, after they moved
+void ff_vvc_frame_eps_moved(VVCFrameContext *fc);
 int ff_vvc_frame_wait(VVCContext *s, VVCFrameContext *fc);
 
+/**
+ * Read the nal units of the next packet ahead, into VVCContext.current_frame, with
+ * the executor. Only with worker threads, s->read is NULL otherwise.
+ */
+int ff_vvc_packet_read_init(VVCContext *s);
+void ff_vvc_packet_read_free(VVCContext *s);
+// start reading pkt, which is moved to the read, the previous read must have been waited for
+void ff_vvc_packet_read_start(VVCContext *s, AVPacket *pkt);
+int ff_vvc_packet_read_pending(const VVCContext *s);
+// @return the return value of ff_cbs_read_packet(), 0 if no read is pending
+int ff_vvc_packet_read_wait(VVCContext *s);
+
 #endif // AVCODEC_VVC_THREAD_H
@@ -24,8 +24,11 @@
 #include "cbs.h"
 #include "cbs_h266.h"
 #include "parser.h"
+#include "refstruct.h"
+#include "startcode.h"
 
 #define START_CODE 0x000001 ///< start_code_prefix_one_3bytes
+#define SLICE_HEADER_PREFIX 256 ///< bytes copied to read a slice header, most are smaller
 #define IS_IDR(nut)   (nut == VVC_IDR_W_RADL || nut == VVC_IDR_N_LP)
 #define IS_H266_SLICE(nut) (nut <= VVC_RASL_NUT || (nut >= VVC_IDR_W_RADL && nut <= VVC_GDR_NUT))
 
@@ -90,8 +93,23 @@ static int find_frame_end(AVCodecParserContext *s, const uint8_t *buf,
     int i;
 
     for (i = 0; i < buf_size; i++) {
+        const uint32_t last = pc->state64;
         int nut, code_len;
 
+        // without a zero among the last 4 bytes, a start code is only found
+        // 4 bytes after the next zero byte, so skip to it
+        if (!((last - 0x01010101U) & ~last & 0x80808080U)) {
+            const int skip = ff_startcode_find_candidate_c(buf + i, buf_size - i);
+
+            if (skip) {
+                // the skipped bytes are not zero, which is all the state needs to know of them
+                pc->state64 = UINT64_MAX;
+                i += skip;
+                if (i >= buf_size)
+                    break;
+            }
+        }
+
         pc->state64 = (pc->state64 << 8) | buf[i];
 
         if (((pc->state64 >> 3 * 8) & 0xFFFFFF) != START_CODE)
@@ -131,7 +149,7 @@ static int get_pict_type(const CodedBitstreamFragment *pu)
     int has_p = 0;
     for (int i = 0; i < pu->nb_units; i++) {
         CodedBitstreamUnit *unit = &pu->units[i];
-        if (IS_H266_SLICE(unit->type)) {
+        if (IS_H266_SLICE(unit->type) && unit->content) {
             const H266RawSlice *slice = unit->content;
             uint8_t type = slice->header.sh_slice_type;
             if (type == VVC_SLICE_TYPE_B) {
@@ -166,6 +184,8 @@ static void set_parser_ctx(AVCodecParserContext *s, AVCodecContext *avctx,
                    nal->nal_unit_type == VVC_IDR_N_LP ||
                    nal->nal_unit_type == VVC_CRA_NUT ||
                    nal->nal_unit_type == VVC_GDR_NUT;
+    // the streams of low delay encoders may have no irap, only gdr pictures to cut at
+    s->recovery_distance = nal->nal_unit_type == VVC_GDR_NUT ? pu->ph->ph_recovery_poc_cnt : -1;
 
     s->coded_width  = pps->pps_pic_width_in_luma_samples;
     s->coded_height = pps->pps_pic_height_in_luma_samples;
@@ -322,6 +342,271 @@ error:
     return ret;
 }
 
+static int read_unit(VVCParserContext *ctx, CodedBitstreamUnit *unit)
+{
+    int ret = ff_cbs_read_unit(ctx->cbc, unit);
+
+    if (ret == AVERROR(ENOSYS) || ret == AVERROR(EAGAIN)) {
+        ff_refstruct_unref(&unit->content_ref);
+        unit->content = NULL;
+        return 0;
+    }
+    return ret;
+}
+
+static int has_escapes(const uint8_t *data, const size_t size)
+{
+    for (size_t i = 2; i < size; i++) {
+        if (data[i] == 3 && !data[i - 1] && !data[i - 2])
+            return 1;
+    }
+    return 0;
+}
+
+/**
+ * The slices keep their emulation prevention bytes, most slice headers have
+ * none. The others are read again from an unescaped copy.
+ */
+static int read_slice(VVCParserContext *ctx, CodedBitstreamUnit *unit)
+{
+    const uint8_t *src = unit->data;
+    const size_t size  = unit->data_size;
+    AVBufferRef *rbsp;
+    uint8_t *dst;
+    int ret, zeros = 0;
+
+    ret = read_unit(ctx, unit);
+    if (ret >= 0) {
+        const H266RawSlice *slice = unit->content;
+        if (!slice || !has_escapes(src, FFMIN(size, slice->header_size + 1)))
+            return 0;
+    } else if (!has_escapes(src, size)) {
+        return ret;
+    }
+
+    rbsp = av_buffer_alloc(size + AV_INPUT_BUFFER_PADDING_SIZE);
+    if (!rbsp)
+        return AVERROR(ENOMEM);
+    dst = rbsp->data;
+    for (size_t i = 0; i < size; i++) {
+        if (zeros >= 2 && src[i] == 3) {
+            zeros = 0;
+            continue;
+        }
+        zeros = src[i] ? 0 : zeros + 1;
+        *dst++ = src[i];
+    }
+    memset(dst, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+
+    av_buffer_unref(&unit->data_ref);
+    unit->data_ref  = rbsp;
+    unit->data      = rbsp->data;
+    unit->data_size = dst - rbsp->data;
+
+    return read_unit(ctx, unit);
+}
+
+/**
+ * Decompose what the au detection and set_parser_ctx() need: the parameter
+ * sets that changed, the picture header and the first slice header. The
+ * following slice headers are only read while they can change the picture type.
+ */
+static int read_pu(VVCParserContext *ctx, CodedBitstreamFragment *pu)
+{
+    const H266RawPictureHeader *ph = NULL;
+    int slices = 0, is_b = 0;
+    int ret;
+
+    for (int i = 0; i < pu->nb_units; i++) {
+        CodedBitstreamUnit *unit = &pu->units[i];
+
+        switch (unit->type) {
+        case VVC_VPS_NUT:
+        case VVC_SPS_NUT:
+        case VVC_PPS_NUT:
+            ret = read_unit(ctx, unit);
+            if (ret < 0)
+                return ret;
+            break;
+        case VVC_PH_NUT:
+            if (unit->content)
+                ph = &((const H266RawPH *)unit->content)->ph_picture_header;
+            break;
+        default:
+            if (!IS_H266_SLICE(unit->type))
+                break;
+            if (slices++ && (!ph || !ph->ph_inter_slice_allowed_flag || is_b))
+                break;
+            ret = read_slice(ctx, unit);
+            if (ret < 0)
+                return ret;
+            if (unit->content) {
+                const H266RawSliceHeader *sh = &((const H266RawSlice *)unit->content)->header;
+                if (sh->sh_picture_header_in_slice_header_flag)
+                    ph = &sh->sh_picture_header;
+                is_b |= sh->sh_slice_type == VVC_SLICE_TYPE_B;
+            }
+            break;
+        }
+    }
+    return 0;
+}
+
+static const uint8_t *find_start_code(const uint8_t *p, const uint8_t *end)
+{
+    while (end - p >= 3) {
+        p += ff_startcode_find_candidate_c(p, end - p);
+        if (end - p < 3)
+            break;
+        if (!p[1] && p[2] == 1)
+            return p;
+        p++;
+    }
+    return end;
+}
+
+/**
+ * Append a copy of size bytes of a nal unit, with the emulation prevention
+ * bytes removed unless it is a slice. The trailing zeros are only removed
+ * from a whole unit.
+ * @return 1 if the unit was appended, 0 if it is too small, or an error code
+ */
+static int append_unit(CodedBitstreamFragment *pu, const uint8_t *src, size_t size,
+                       int is_slice, int whole)
+{
+    uint8_t *data;
+    size_t n = 0;
+    int zeros = 0, ret;
+
+    while (whole && size && !src[size - 1])
+        size--;
+    if (size < 2)
+        return 0;
+
+    data = av_malloc(size + AV_INPUT_BUFFER_PADDING_SIZE);
+    if (!data)
+        return AVERROR(ENOMEM);
+    if (is_slice) {
+        memcpy(data, src, size);
+        n = size;
+    } else {
+        for (size_t i = 0; i < size; i++) {
+            if (zeros >= 2 && src[i] == 3) {
+                zeros = 0;
+                continue;
+            }
+            zeros = src[i] ? 0 : zeros + 1;
+            data[n++] = src[i];
+        }
+    }
+    memset(data + n, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+
+    ret = ff_cbs_append_unit_data(pu, src[1] >> 3, data, n, NULL);
+    return ret < 0 ? ret : 1;
+}
+
+/**
+ * Build the picture unit from the units read_pu() would decompose only,
+ * and decompose them. The other units are skipped without being copied
+ * or unescaped. In Annex B, nothing is scanned after the last slice header
+ * needed, so a complete frame costs about as much as its headers.
+ */
+static int read_pu_units(VVCParserContext *ctx, CodedBitstreamFragment *pu,
+                         const uint8_t *buf, int buf_size)
+{
+    const CodedBitstreamH266Context *h266 = ctx->cbc->priv_data;
+    const int length_size = h266->common.mp4 ? h266->common.nal_length_size : 0;
+    const uint8_t *p = buf, *end = buf + buf_size;
+    const H266RawPictureHeader *ph = NULL;
+    int slices = 0, is_b = 0;
+    int ret;
+
+    while (p < end) {
+        const uint8_t *nal, *nal_end = NULL;
+        CodedBitstreamUnit *unit;
+        int type;
+
+        if (length_size) {
+            uint32_t size = 0;
+
+            if (end - p < length_size)
+                return AVERROR_INVALIDDATA;
+            for (int i = 0; i < length_size; i++)
+                size = (size << 8) | *p++;
+            if (size > end - p)
+                return AVERROR_INVALIDDATA;
+            nal = p;
+            p   = nal_end = p + size;
+        } else {
+            nal = find_start_code(p, end);
+            if (end - nal <= 3)
+                break;
+            // the end of the unit is only searched for when it is needed
+            p = nal += 3;
+        }
+        if ((nal_end ? nal_end : end) - nal < 2)
+            continue;
+
+        type = nal[1] >> 3;
+        if (IS_H266_SLICE(type)) {
+            size_t size;
+            int whole;
+
+            if (slices++ && (!ph || !ph->ph_inter_slice_allowed_flag || is_b)) {
+                if (!length_size)
+                    break;
+                continue;
+            }
+            size  = FFMIN((nal_end ? nal_end : end) - nal, SLICE_HEADER_PREFIX);
+            whole = nal_end && size == nal_end - nal;
+            ret   = append_unit(pu, nal, size, 1, whole);
+            if (ret <= 0) {
+                if (ret < 0)
+                    return ret;
+                continue;
+            }
+            unit = &pu->units[pu->nb_units - 1];
+            ret  = read_slice(ctx, unit);
+            if (ret < 0 && !whole) {
+                // a large header, read it again from the whole slice
+                if (!nal_end)
+                    nal_end = find_start_code(nal, end);
+                ff_cbs_delete_unit(pu, pu->nb_units - 1);
+                ret = append_unit(pu, nal, nal_end - nal, 1, 1);
+                if (ret <= 0)
+                    return ret < 0 ? ret : AVERROR_INVALIDDATA;
+                unit = &pu->units[pu->nb_units - 1];
+                ret  = read_slice(ctx, unit);
+            }
+            if (ret < 0)
+                return ret;
+            if (unit->content) {
+                const H266RawSliceHeader *sh = &((const H266RawSlice *)unit->content)->header;
+                if (sh->sh_picture_header_in_slice_header_flag)
+                    ph = &sh->sh_picture_header;
+                is_b |= sh->sh_slice_type == VVC_SLICE_TYPE_B;
+            }
+        } else if (type == VVC_VPS_NUT || type == VVC_SPS_NUT || type == VVC_PPS_NUT ||
+                   type == VVC_PH_NUT  || type == VVC_AUD_NUT) {
+            if (!nal_end)
+                p = nal_end = find_start_code(nal, end);
+            ret = append_unit(pu, nal, nal_end - nal, 0, 1);
+            if (ret <= 0) {
+                if (ret < 0)
+                    return ret;
+                continue;
+            }
+            unit = &pu->units[pu->nb_units - 1];
+            ret  = read_unit(ctx, unit);
+            if (ret < 0)
+                return ret;
+            if (type == VVC_PH_NUT && unit->content)
+                ph = &((const H266RawPH *)unit->content)->ph_picture_header;
+        }
+    }
+    return 0;
+}
+
 static int append_au(AVPacket *pkt, const uint8_t *buf, int buf_size)
 {
     int offset = pkt->size;
@@ -341,6 +626,7 @@ end:
  * @param buf buffer with field/frame data.
  * @param buf_size size of the buffer.
  * @return < 0 for error, == 0 for a complete au, > 0 is not a completed au.
+ *         A complete au is in last_au, or is buf itself when last_au is empty.
  */
 static int parse_nal_units(AVCodecParserContext *s, const uint8_t *buf,
                            int buf_size, AVCodecContext *avctx)
@@ -360,20 +646,27 @@ static int parse_nal_units(AVCodecParserContext *s, const uint8_t *buf,
         return 1;
     }
 
-    if ((ret = ff_cbs_read(ctx->cbc, pu, buf, buf_size)) < 0) {
+    if ((ret = read_pu_units(ctx, pu, buf, buf_size)) < 0) {
         av_log(avctx, AV_LOG_ERROR, "Failed to parse picture unit.\n");
         goto end;
     }
     if ((ret = get_pu_info(&info, h266, pu, avctx)) < 0)
         goto end;
-    if (append_au(&ctx->au, buf, buf_size) < 0) {
-        ret = AVERROR(ENOMEM);
-        goto end;
-    }
     if (is_au_start(ctx, &info, avctx)) {
         set_parser_ctx(s, avctx, &info);
+        // an au of a single pu is output from buf, without copying it
+        if (!ctx->au.size)
+            goto end;
+        if (append_au(&ctx->au, buf, buf_size) < 0) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
         av_packet_move_ref(&ctx->last_au, &ctx->au);
     } else {
+        if (append_au(&ctx->au, buf, buf_size) < 0) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
         ret = 1; //not a completed au
     }
 end:
@@ -404,7 +697,7 @@ static int combine_au(AVCodecParserContext *s, AVCodecContext *avctx,
         if (ctx->last_au.size) {
             *buf = ctx->last_au.data;
             *buf_size = ctx->last_au.size;
-        } else {
+        } else if (!*buf_size) {
             ret = 1; //no output
         }
     }
@@ -432,6 +725,8 @@ static int vvc_parser_parse(AVCodecParserContext *s, AVCodecContext *avctx,
         ctx->parsed_extradata = 1;
 
         ret = ff_cbs_read_extradata_from_codec(ctx->cbc, pu, avctx);
+        if (ret >= 0)
+            ret = read_pu(ctx, pu);
         if (ret < 0)
             av_log(avctx, AV_LOG_WARNING, "Failed to parse extradata.\n");
 
@@ -464,18 +759,8 @@ static int vvc_parser_parse(AVCodecParserContext *s, AVCodecContext *avctx,
     return next;
 }
 
+// the parameter sets and the slices are decomposed by read_pu()
 static const CodedBitstreamUnitType decompose_unit_types[] = {
-    VVC_TRAIL_NUT,
-    VVC_STSA_NUT,
-    VVC_RADL_NUT,
-    VVC_RASL_NUT,
-    VVC_IDR_W_RADL,
-    VVC_IDR_N_LP,
-    VVC_CRA_NUT,
-    VVC_GDR_NUT,
-    VVC_VPS_NUT,
-    VVC_SPS_NUT,
-    VVC_PPS_NUT,
     VVC_PH_NUT,
     VVC_AUD_NUT,
 };
@@ -492,6 +777,7 @@ static av_cold int vvc_parser_init(AVCodecParserContext *s)
 
     ctx->cbc->decompose_unit_types    = decompose_unit_types;
     ctx->cbc->nb_decompose_unit_types = FF_ARRAY_ELEMS(decompose_unit_types);
+    ((CodedBitstreamH266Context *)ctx->cbc->priv_data)->common.read_packet.keep_vcl_escapes = 1;
 
     return ret;
 }
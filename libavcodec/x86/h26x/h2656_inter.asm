@@ -38,6 +38,18 @@ cextern pw_8192
 max_pixels_12:          times 16 dw ((1 << 12)-1)
 cextern pb_0
 
+; the 4 pixels of the first and the last 4 taps of 16 outputs
+pb_8tap_h_shuffle_avx512icl:
+%assign i 0
+%rep 16
+    db i, i + 1, i + 2, i + 3
+%assign i i + 1
+%endrep
+%rep 16
+    db i - 12, i - 11, i - 10, i - 9
+%assign i i + 1
+%endrep
+
 SECTION .text
 %macro SIMPLE_LOAD 4    ;width, bitd, tab, r1
 %if %1 == 2 || (%2 == 8 && %1 <= 4)
@@ -1021,6 +1033,40 @@ cglobal %1_put_uni_8tap_hv%2_%3, 7, 9, 16, 0 - 16*mmsize, dst, dststride, src, s
 
 %endmacro
 
+; vpdpbusd sums 4 products of the unsigned pixels and the signed taps into each dword
+; %1: dst register, %2: pixel offset
+%macro MC_8TAP_H_AVX512ICL_COMPUTE 2
+    pxor             m%1, m%1
+    movu             ym4, [srcq + %2 - 3]
+    vpermb            m5, m2, m4
+    vpermb            m4, m3, m4
+    vpdpbusd         m%1, m5, m0
+    vpdpbusd         m%1, m4, m1
+%endmacro
+
+; ******************************
+; void put_8tap_hX_8(int16_t *dst, ptrdiff_t dststride, const uint8_t *_src, ptrdiff_t srcstride,
+;                    int height, const int8_t *hf, const int8_t *vf, int width)
+; ******************************
+%macro PUT_8TAP_H_AVX512ICL 2
+cglobal %1_put_8tap_h%2_8, 6, 6, 8, dst, dststride, src, srcstride, height, hf
+    vpbroadcastd      m0, [hfq]
+    vpbroadcastd      m1, [hfq + 4]
+    movu              m2, [pb_8tap_h_shuffle_avx512icl]
+    movu              m3, [pb_8tap_h_shuffle_avx512icl + 64]
+.loop:
+%assign i 0
+%rep %2 / 32
+    MC_8TAP_H_AVX512ICL_COMPUTE 6, i
+    MC_8TAP_H_AVX512ICL_COMPUTE 7, i + 16
+    vpmovdw  [dstq + 2 * i], m6
+    vpmovdw  [dstq + 2 * i + 32], m7
+%assign i i + 32
+%endrep
+    LOOP_END        dst, src, srcstride
+    RET
+%endmacro
+
 %macro H2656PUT_PIXELS 2
     PUT_PIXELS h2656, %1, %2
 %endmacro
@@ -1140,4 +1186,11 @@ H2656PUT_4TAP_HV 16, 12
 
 %endif
 
+%if HAVE_AVX512ICL_EXTERNAL
+INIT_ZMM avx512icl
+
+PUT_8TAP_H_AVX512ICL h2656, 64
+
+%endif
+
 %endif
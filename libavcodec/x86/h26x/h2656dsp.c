@@ -98,4 +98,8 @@ MC_REP_FUNCS_AVX2(4tap_h)
 MC_REP_FUNCS_AVX2(4tap_v)
 MC_REP_FUNCS_AVX2(4tap_hv)
 #endif
+
+#if HAVE_AVX512ICL_EXTERNAL
+mc_rep_func(8tap_h, 8, 64, 128, avx512icl)
+#endif
 #endif
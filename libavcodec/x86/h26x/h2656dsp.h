@@ -100,4 +100,7 @@ H2656_MC_8TAP_PROTOTYPES_AVX2(4tap_h);
 H2656_MC_8TAP_PROTOTYPES_AVX2(4tap_v);
 H2656_MC_8TAP_PROTOTYPES_AVX2(4tap_hv);
 
+void ff_h2656_put_8tap_h64_8_avx512icl(int16_t *dst, ptrdiff_t dststride, const uint8_t *_src, ptrdiff_t _srcstride, int height, const int8_t *hf, const int8_t *vf, int width);
+void ff_h2656_put_8tap_h128_8_avx512icl(int16_t *dst, ptrdiff_t dststride, const uint8_t *_src, ptrdiff_t _srcstride, int height, const int8_t *hf, const int8_t *vf, int width);
+
 #endif
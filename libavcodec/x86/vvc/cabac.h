@@ -0,0 +1,88 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVCODEC_X86_VVC_CABAC_H
+#define AVCODEC_X86_VVC_CABAC_H
+
+#include <stdint.h>
+
+#include "libavutil/attributes.h"
+#include "libavcodec/cabac_functions.h"
+#include "libavcodec/vvc/ctu.h"
+#include "config.h"
+
+#if HAVE_INLINE_ASM && HAVE_FAST_CMOV && ARCH_X86_64
+
+// The compare and the conditional updates share the flags of a single subtraction.
+
+#define vvc_get_cabac_inline vvc_get_cabac_inline_x86
+static av_always_inline int vvc_get_cabac_inline_x86(VVCCabacContext *c, const int range_lps, const int val_mps)
+{
+    uint64_t value = c->value, scaled, diff;
+    unsigned range = c->range - range_lps;
+    int lps;
+    int shift;
+
+    __asm__ (
+        "xor      %k[lps]     , %k[lps]         \n\t"
+        "mov      %k[range]   , %k[scaled]      \n\t"
+        "shl      %%cl        , %[scaled]       \n\t"
+        "mov      %[value]    , %[diff]         \n\t"
+        "sub      %[scaled]   , %[diff]         \n\t"
+        "cmovae   %[diff]     , %[value]        \n\t"
+        "cmovae   %k[rlps]    , %k[range]       \n\t"
+        "setae    %b[lps]                       \n\t"
+        : [value]"+r"(value), [range]"+r"(range), [scaled]"=&r"(scaled), [diff]"=&r"(diff), [lps]"=&r"(lps)
+        : [rlps]"r"(range_lps), "c"(c->cnt)
+        : "cc"
+    );
+
+    shift     = ff_h264_norm_shift[range];
+    c->value  = value;
+    c->range  = range << shift;
+    c->cnt   -= shift;
+
+    return val_mps ^ lps;
+}
+
+#define vvc_get_cabac_bypass_inline vvc_get_cabac_bypass_inline_x86
+static av_always_inline int vvc_get_cabac_bypass_inline_x86(VVCCabacContext *c)
+{
+    uint64_t value = c->value, scaled, diff;
+    int bit;
+
+    __asm__ (
+        "xor      %k[bit]     , %k[bit]         \n\t"
+        "mov      %k[range]   , %k[scaled]      \n\t"
+        "shl      %%cl        , %[scaled]       \n\t"
+        "mov      %[value]    , %[diff]         \n\t"
+        "sub      %[scaled]   , %[diff]         \n\t"
+        "cmovae   %[diff]     , %[value]        \n\t"
+        "setae    %b[bit]                       \n\t"
+        : [value]"+r"(value), [scaled]"=&r"(scaled), [diff]"=&r"(diff), [bit]"=&r"(bit)
+        : [range]"r"(c->range), "c"(--c->cnt)
+        : "cc"
+    );
+
+    c->value = value;
+
+    return bit;
+}
+
+#endif /* HAVE_INLINE_ASM && HAVE_FAST_CMOV && ARCH_X86_64 */
+#endif /* AVCODEC_X86_VVC_CABAC_H */
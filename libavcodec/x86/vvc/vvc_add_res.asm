@@ -0,0 +1,305 @@
+; /*
+; * Provide SIMD residual functions for VVC decoding
+; *
+; * This file is part of FFmpeg.
+; *
+; * FFmpeg is free software; you can redistribute it and/or
+; * modify it under the terms of the GNU Lesser General Public
+; * License as published by the Free Software Foundation; either
+; * version 2.1 of the License, or (at your option) any later version.
+; *
+; * FFmpeg is distributed in the hope that it will be useful,
+; * but WITHOUT ANY WARRANTY; without even the implied warranty of
+; * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+; * Lesser General Public License for more details.
+; *
+; * You should have received a copy of the GNU Lesser General Public
+; * License along with FFmpeg; if not, write to the Free Software
+; * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+; */
+
+%include "libavutil/x86/x86util.asm"
+
+SECTION .text
+
+; The residuals are saturated to 16 bits before they are added, which gives the same
+; result as clipping the 32 bit sum since the samples are at most 12 bits.
+
+; m4: zero, m5: c_sign, xm6: shift, m7: pixel max
+
+; %1: joint, %2: residual register, %3: c_sign register
+%macro JOINT 3
+%if %1
+    psignd               %2, %3
+    psrad                %2, xm6
+%endif
+%endmacro
+
+; %1: 8 or 16 bpc, %2: residual, %3: dst address
+%macro ADD_RES_STORE 3
+%if %1 == 8
+    vextracti128       xm1, %2, 1
+    packuswb            xm0, xm1
+    movu                 %3, xm0
+%else
+    pmaxsw               %2, m4
+    pminsw               %2, m7
+    movu                 %3, %2
+%endif
+%endmacro
+
+; %1: 8 or 16 bpc, %2: joint
+%macro ADD_RES 2
+%if %2
+cglobal vvc_add_residual_joint_%1bpc, 8, 10, 8, dst, res, width, height, stride, sign, shift, max, x, tmp
+%else
+cglobal vvc_add_residual_%1bpc, 8, 10, 8, dst, res, width, height, stride, sign, shift, max, x, tmp
+%endif
+    pxor                 m4, m4
+%if %2
+    movd                xm5, signd
+    vpbroadcastd         m5, xm5
+    movd                xm6, shiftd
+%endif
+%if %1 == 16
+    movd                xm7, maxd
+    vpbroadcastw         m7, xm7
+%endif
+    cmp              widthq, 8
+    jg .w16
+    je .w8
+    cmp              widthq, 4
+    je .w4
+
+.w2:
+    movq                xm0, [resq]
+    JOINT               %2, xm0, xm5
+    packssdw            xm0, xm0
+%if %1 == 8
+    movzx              tmpd, word [dstq]
+    movd                xm1, tmpd
+    punpcklbw           xm1, xm4
+    paddsw              xm0, xm1
+    packuswb            xm0, xm0
+    movd               tmpd, xm0
+    mov          [dstq], tmpw
+%else
+    movd                xm1, [dstq]
+    paddsw              xm0, xm1
+    pmaxsw              xm0, xm4
+    pminsw              xm0, xm7
+    movd             [dstq], xm0
+%endif
+    add                resq, 8
+    add                dstq, strideq
+    dec             heightd
+    jg .w2
+    RET
+
+.w4:
+    movu                xm0, [resq]
+    JOINT               %2, xm0, xm5
+    packssdw            xm0, xm0
+%if %1 == 8
+    movd                xm1, [dstq]
+    punpcklbw           xm1, xm4
+    paddsw              xm0, xm1
+    packuswb            xm0, xm0
+    movd             [dstq], xm0
+%else
+    movq                xm1, [dstq]
+    paddsw              xm0, xm1
+    pmaxsw              xm0, xm4
+    pminsw              xm0, xm7
+    movq             [dstq], xm0
+%endif
+    add                resq, 16
+    add                dstq, strideq
+    dec             heightd
+    jg .w4
+    RET
+
+.w8:
+    movu                 m0, [resq]
+    JOINT               %2, m0, m5
+    vextracti128        xm1, m0, 1
+    packssdw            xm0, xm1
+%if %1 == 8
+    pmovzxbw            xm1, [dstq]
+    paddsw              xm0, xm1
+    packuswb            xm0, xm0
+    movq             [dstq], xm0
+%else
+    movu                xm1, [dstq]
+    paddsw              xm0, xm1
+    pmaxsw              xm0, xm4
+    pminsw              xm0, xm7
+    movu             [dstq], xm0
+%endif
+    add                resq, 32
+    add                dstq, strideq
+    dec             heightd
+    jg .w8
+    RET
+
+.w16:
+    xor                  xq, xq
+.w16_loop:
+    movu                 m0, [resq + xq * 4]
+    movu                 m1, [resq + xq * 4 + 32]
+    JOINT               %2, m0, m5
+    JOINT               %2, m1, m5
+    packssdw             m0, m1
+    vpermq               m0, m0, q3120
+%if %1 == 8
+    pmovzxbw             m1, [dstq + xq]
+    paddsw               m0, m1
+    ADD_RES_STORE        %1, m0, [dstq + xq]
+%else
+    movu                 m1, [dstq + xq * 2]
+    paddsw               m0, m1
+    ADD_RES_STORE        %1, m0, [dstq + xq * 2]
+%endif
+    add                  xq, 16
+    cmp                  xq, widthq
+    jl .w16_loop
+    lea                resq, [resq + widthq * 4]
+    add                dstq, strideq
+    dec             heightd
+    jg .w16
+    RET
+%endmacro
+
+; m2: the dc, for 8 bpc its positive part as bytes and m3 its negative part
+; %1: 8 or 16 bpc, %2: x or y
+%macro ADD_DC 2
+%if %1 == 8
+    paddusb           %{2}m0, %{2}m2
+    psubusb           %{2}m0, %{2}m3
+%else
+    paddsw            %{2}m0, %{2}m2
+    pmaxsw            %{2}m0, %{2}m4
+    pminsw            %{2}m0, %{2}m7
+%endif
+%endmacro
+
+; void ff_vvc_add_residual_dc_%1bpc(uint8_t *dst, intptr_t dc, intptr_t width, intptr_t height,
+;     ptrdiff_t stride, intptr_t pixel_max)
+%macro ADD_RES_DC 1
+cglobal vvc_add_residual_dc_%1bpc, 6, 7, 8, dst, dc, width, height, stride, max, x
+    pxor                 m4, m4
+    movd                xm2, dcd
+    packssdw            xm2, xm2
+%if %1 == 8
+    psubsw              xm3, xm4, xm2
+    packuswb            xm2, xm2
+    packuswb            xm3, xm3
+    vpbroadcastb         m2, xm2
+    vpbroadcastb         m3, xm3
+%else
+    vpbroadcastw         m2, xm2
+    movd                xm7, maxd
+    vpbroadcastw         m7, xm7
+    add              widthq, widthq
+%endif
+    ; the width in bytes from here
+    cmp              widthq, 16
+    jg .w32
+    je .w16
+    cmp              widthq, 4
+    jg .w8
+    je .w4
+
+.w2:
+    movzx                xd, word [dstq]
+    movd                xm0, xd
+    ADD_DC              %1, x
+    movd                 xd, xm0
+    mov              [dstq], xw
+    add                dstq, strideq
+    dec             heightd
+    jg .w2
+    RET
+
+.w4:
+    movd                xm0, [dstq]
+    ADD_DC              %1, x
+    movd             [dstq], xm0
+    add                dstq, strideq
+    dec             heightd
+    jg .w4
+    RET
+
+.w8:
+    movq                xm0, [dstq]
+    ADD_DC              %1, x
+    movq             [dstq], xm0
+    add                dstq, strideq
+    dec             heightd
+    jg .w8
+    RET
+
+.w16:
+    movu                xm0, [dstq]
+    ADD_DC              %1, x
+    movu             [dstq], xm0
+    add                dstq, strideq
+    dec             heightd
+    jg .w16
+    RET
+
+.w32:
+    xor                  xq, xq
+.w32_loop:
+    movu                 m0, [dstq + xq]
+    ADD_DC              %1, y
+    movu        [dstq + xq], m0
+    add                  xq, 32
+    cmp                  xq, widthq
+    jl .w32_loop
+    add                dstq, strideq
+    dec             heightd
+    jg .w32
+    RET
+%endmacro
+
+%if ARCH_X86_64
+%if HAVE_AVX2_EXTERNAL
+
+INIT_YMM avx2
+
+ADD_RES  8, 0
+ADD_RES  8, 1
+ADD_RES 16, 0
+ADD_RES 16, 1
+
+ADD_RES_DC  8
+ADD_RES_DC 16
+
+; void ff_vvc_pred_residual_joint_avx2(int *buf, int width, int height, int c_sign, int shift);
+cglobal vvc_pred_residual_joint, 5, 5, 3, buf, width, height, sign, shift
+    imul             widthd, heightd
+    movd                xm1, signd
+    vpbroadcastd         m1, xm1
+    movd                xm2, shiftd
+    cmp              widthd, 8
+    jl .w4
+.loop:
+    movu                 m0, [bufq]
+    psignd               m0, m1
+    psrad                m0, xm2
+    movu             [bufq], m0
+    add                bufq, 32
+    sub              widthd, 8
+    jg .loop
+    RET
+
+.w4:
+    movu                xm0, [bufq]
+    psignd              xm0, xm1
+    psrad               xm0, xm2
+    movu             [bufq], xm0
+    RET
+
+%endif
+%endif
@@ -44,6 +44,7 @@ CLASSIFY_SHUFFE: times 2    db 2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12,
 TRANSPOSE_PERMUTE:          dd 0, 1, 4, 5, 2, 3, 6, 7
 ARG_VAR_SHUFFE: times 2     db 0, 1, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3, 4
 
+
 dd448: times 8             dd 512 - 64
 dw64: times 8              dd 64
 dd2:  times 8              dd 2
@@ -51,6 +52,8 @@ dw3:  times 8              dd 3
 dw5:  times 8              dd 5
 dd15: times 8              dd 15
 
+cextern pw_255
+
 SECTION .text
 
 
@@ -138,11 +141,16 @@ SECTION .text
     punpcklwd        m10, m12, m12
     punpckhwd        m12, m12, m12
 
+%if cpuflag(avx512icl)
+    vpdpwssd          m0, m9, m10
+    vpdpwssd          m1, m12, m13
+%else
     pmaddwd           m9, m10
     pmaddwd          m12, m13
 
     paddd             m0, m9
     paddd             m1, m12
+%endif
 %endmacro
 
 ; FILTER(param_idx, bottom, top, byte_offset)
@@ -865,6 +873,269 @@ cglobal vvc_alf_classify_%1bpc, 7, 15, 16, class_idx, transpose_idx, gradient_su
     RET
 %endmacro
 
+; ******************************
+; CC-ALF, 16 chroma samples and the 7 luma taps of each at a time
+; ******************************
+
+; CC_LOAD_PIXELS(dst, tmp, src): 16 luma samples at x << hs, hs = 1 takes the even ones
+%macro CC_LOAD_PIXELS 3
+%if HS
+    movu                    %1, [%3]
+%if ps == 2
+    movu                    %2, [%3 + 32]
+    pblendw                 %1, m14, 0xaa
+    pblendw                 %2, m14, 0xaa
+    packusdw                %1, %2
+    vpermq                  %1, %1, q3120
+%else
+    pand                    %1, m13
+%endif
+%else
+    LOAD_PIXELS             %1, [%3]
+%endif
+%endmacro
+
+; CC_LOAD_PIXELS_R(dst, tmp, src): the luma samples right of the ones at src
+%macro CC_LOAD_PIXELS_R 3
+%if HS
+    movu                    %1, [%3]
+%if ps == 2
+    movu                    %2, [%3 + 32]
+    psrld                   %1, 16
+    psrld                   %2, 16
+    packusdw                %1, %2
+    vpermq                  %1, %1, q3120
+%else
+    psrlw                   %1, 8
+%endif
+%else
+    LOAD_PIXELS             %1, [%3 + ps]
+%endif
+%endmacro
+
+; CC_FILTER_PAIR(filter, first): m5, m4 += m1 * filter[0] + m2 * filter[1], m3 tmp
+%macro CC_FILTER_PAIR 2
+    punpcklwd               m3, m1, m2
+    punpckhwd               m1, m2
+    pmaddwd                 m3, %1
+    pmaddwd                 m1, %1
+%if %2
+    mova                    m5, m3
+    mova                    m4, m1
+%else
+    paddd                   m5, m3
+    paddd                   m4, m1
+%endif
+%endmacro
+
+; output: m5, the clipped offsets of 16 chroma samples
+%macro CC_FILTER_16 0
+    CC_LOAD_PIXELS          m0, m3, srcq
+    CC_LOAD_PIXELS          m1, m3, srcq + off0q
+    CC_LOAD_PIXELS          m2, m3, srcq - ps
+    psubw                   m1, m0
+    psubw                   m2, m0
+    CC_FILTER_PAIR          m8, 1
+
+    CC_LOAD_PIXELS_R        m1, m3, srcq
+    lea                   tmpq, [srcq + off2q]
+    CC_LOAD_PIXELS          m2, m3, tmpq - ps
+    psubw                   m1, m0
+    psubw                   m2, m0
+    CC_FILTER_PAIR          m9, 0
+
+    CC_LOAD_PIXELS          m1, m3, tmpq
+    CC_LOAD_PIXELS_R        m2, m3, tmpq
+    psubw                   m1, m0
+    psubw                   m2, m0
+    CC_FILTER_PAIR         m10, 0
+
+    CC_LOAD_PIXELS          m1, m3, srcq + off3q
+    psubw                   m1, m0
+    punpcklwd               m3, m1, m14
+    punpckhwd               m1, m14
+    pmaddwd                 m3, m11
+    pmaddwd                 m1, m11
+    paddd                   m5, m3
+    paddd                   m4, m1
+
+    paddd                   m5, m12
+    paddd                   m4, m12
+    psrad                   m5, 7
+    psrad                   m4, 7
+    pminsd                  m5, m6
+    pminsd                  m4, m6
+    pmaxsd                  m5, m7
+    pmaxsd                  m4, m7
+    packssdw                m5, m4
+%endmacro
+
+; CC_ADD_OFFSETS: m1 = clip(m1 + m5)
+%macro CC_ADD_OFFSETS 0
+    paddw                   m1, m5
+%if ps == 2
+    CLIPW                   m1, m14, m15
+%else
+    packuswb                m1, m1
+    vpermq                  m1, m1, q3120
+%endif
+%endmacro
+
+; the last 4, 8 or 12 samples of a row
+%macro CC_FILTER_TAIL 0
+    cmp                     wq, 8
+    jl %%tail_w4
+    je %%tail_w8
+%if ps == 2
+    movu                   xm1, [dstpq]
+    movq                   xm2, [dstpq + 16]
+    vinserti128             m1, m1, xm2, 1
+    CC_ADD_OFFSETS
+    movu              [dstpq], xm1
+    vextracti128           xm2, m1, 1
+    movq         [dstpq + 16], xm2
+%else
+    movq                   xm1, [dstpq]
+    movd                   xm2, [dstpq + 8]
+    punpcklqdq             xm1, xm2
+    pmovzxbw                m1, xm1
+    CC_ADD_OFFSETS
+    movq              [dstpq], xm1
+    pextrd        [dstpq + 8], xm1, 2
+%endif
+    jmp %%row_end
+%%tail_w8:
+%if ps == 2
+    movu                   xm1, [dstpq]
+    CC_ADD_OFFSETS
+    movu              [dstpq], xm1
+%else
+    pmovzxbw                m1, [dstpq]
+    CC_ADD_OFFSETS
+    movq              [dstpq], xm1
+%endif
+    jmp %%row_end
+%%tail_w4:
+%if ps == 2
+    movq                   xm1, [dstpq]
+    CC_ADD_OFFSETS
+    movq              [dstpq], xm1
+%else
+    movd                   xm1, [dstpq]
+    pmovzxbw                m1, xm1
+    CC_ADD_OFFSETS
+    movd              [dstpq], xm1
+%endif
+%%row_end:
+%endmacro
+
+; ******************************
+; void ff_vvc_alf_filter_cc_%1bpc_avx2(uint8_t *dst, ptrdiff_t dst_stride,
+;      const uint8_t *luma, ptrdiff_t luma_stride, ptrdiff_t width, ptrdiff_t height,
+;      ptrdiff_t hs, ptrdiff_t vs, const int16_t *filter, ptrdiff_t vb_pos, ptrdiff_t pixel_max);
+; width is a multiple of 4
+; ******************************
+%macro ALF_FILTER_CC_HS 1
+%xdefine HS %1
+.loop_h%1:
+    ; vb_pos counts down to the current luma row, the rows next to the virtual boundary
+    ; use the padded taps, see alf_filter_cc()
+    test                   vsd, vsd
+    jnz .no_skip%1
+    cmp                vb_posq, 0
+    je .next_row%1
+    cmp                vb_posq, -1
+    je .next_row%1
+.no_skip%1:
+    mov                  off0q, luma_strideq
+    neg                  off0q
+    mov                  off2q, luma_strideq
+    lea                  off3q, [luma_strideq * 2]
+    cmp                vb_posq, 2
+    je .s3_is_s2%1
+    cmp                vb_posq, -1
+    je .s3_is_s2%1
+    cmp                vb_posq, 1
+    je .s1_only%1
+    cmp                vb_posq, 0
+    jne .offsets_done%1
+.s1_only%1:
+    xor                  off0q, off0q
+    xor                  off2q, off2q
+.s3_is_s2%1:
+    mov                  off3q, off2q
+.offsets_done%1:
+
+    mov                   srcq, lumaq
+    mov                  dstpq, dstq
+    mov                     wq, widthq
+.loop_w%1:
+    CC_FILTER_16
+    cmp                     wq, 16
+    jl .tail%1
+
+%if ps == 2
+    movu                    m1, [dstpq]
+    CC_ADD_OFFSETS
+    movu              [dstpq], m1
+%else
+    pmovzxbw                m1, [dstpq]
+    CC_ADD_OFFSETS
+    movu              [dstpq], xm1
+%endif
+    add                   srcq, (16 << HS) * ps
+    add                  dstpq, 16 * ps
+    sub                     wq, 16
+    jg .loop_w%1
+    jmp .next_row%1
+
+.tail%1:
+    CC_FILTER_TAIL
+
+.next_row%1:
+    add                   dstq, dst_strideq
+    add                  lumaq, luma_strideq
+    dec                vb_posq
+    test                   vsd, vsd
+    jz .no_vs%1
+    add                  lumaq, luma_strideq
+    dec                vb_posq
+.no_vs%1:
+    dec                heightq
+    jg .loop_h%1
+    RET
+%endmacro
+
+%macro ALF_FILTER_CC 1
+%define ps (%1 / 8)
+cglobal vvc_alf_filter_cc_%1bpc, 11, 15, 16, dst, dst_stride, luma, luma_stride, width, height, hs, vs, filter, vb_pos, pixel_max, \
+    src, off0, off2, off3
+    movd                  xm15, pixel_maxd
+    vpbroadcastw           m15, xm15
+    shr             pixel_maxd, 1
+    movd                   xm6, pixel_maxd
+    vpbroadcastd            m6, xm6                     ; (1 << (bit_depth - 1)) - 1
+    pcmpeqd                 m7, m7
+    pxor                    m7, m6                      ; -(1 << (bit_depth - 1))
+
+    vpbroadcastd            m8, [filterq]
+    vpbroadcastd            m9, [filterq + 4]
+    vpbroadcastd           m10, [filterq + 8]
+    vpbroadcastw           m11, [filterq + 12]
+    mova                   m12, [dw64]
+    mova                   m13, [pw_255]
+    pxor                   m14, m14
+
+DEFINE_ARGS dst, dst_stride, luma, luma_stride, width, height, hs, vs, dstp, vb_pos, w, src, off0, off2, off3
+%define tmpq hsq
+    test                   hsd, hsd
+    jnz .hs1
+    ALF_FILTER_CC_HS 0
+.hs1:
+    ALF_FILTER_CC_HS 1
+%undef tmpq
+%endmacro
+
 %if ARCH_X86_64
 %if HAVE_AVX2_EXTERNAL
 INIT_YMM avx2
@@ -872,5 +1143,12 @@ ALF_FILTER   16
 ALF_FILTER   8
 ALF_CLASSIFY 16
 ALF_CLASSIFY 8
+ALF_FILTER_CC 16
+ALF_FILTER_CC 8
+%endif
+%if HAVE_AVX512ICL_EXTERNAL
+INIT_YMM avx512icl
+ALF_FILTER   16
+ALF_FILTER   8
 %endif
 %endif
@@ -0,0 +1,348 @@
+; /*
+; * Provide SIMD bi-directional optical flow functions for VVC decoding
+; *
+; * This file is part of FFmpeg.
+; *
+; * FFmpeg is free software; you can redistribute it and/or
+; * modify it under the terms of the GNU Lesser General Public
+; * License as published by the Free Software Foundation; either
+; * version 2.1 of the License, or (at your option) any later version.
+; *
+; * FFmpeg is distributed in the hope that it will be useful,
+; * but WITHOUT ANY WARRANTY; without even the implied warranty of
+; * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+; * Lesser General Public License for more details.
+; *
+; * You should have received a copy of the GNU Lesser General Public
+; * License along with FFmpeg; if not, write to the Free Software
+; * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+; */
+
+%include "libavutil/x86/x86util.asm"
+
+%define MAX_PB_SIZE 128
+%define SRC_STRIDE  (MAX_PB_SIZE * 2)
+
+SECTION_RODATA 32
+
+bdof_hmask:   times 4 dw 0, 0, -1, -1
+pw_1:         times 2 dw 1
+pd_15:        times 1 dd 15
+pd_m15:       times 1 dd -15
+pd_127:       times 1 dd 127
+
+SECTION .text
+
+; The per sample terms of the 6x6 window sums are computed one row of the block at a time
+; and kept in a stack buffer, 16 samples per row:
+;     0: |gx|, 1: |gy|, 2: sign(gy) * gx, 3: -sign(gx) * diff, 4: -sign(gy) * diff
+; with gx, gy the averaged gradients of both predictions,
+;     5: gx0 - gx1, 6: gy0 - gy1
+; for the correction of every sample. The rows and columns outside the block are
+; replicated from the block edge, i.e. the padding of apply_bdof().
+%define TERM_ROW    32
+%define TERM_SIZE   (16 * TERM_ROW)
+%define TERM(i)     rowq + (i) * TERM_SIZE
+%define HBUF        rsp + 7 * TERM_SIZE
+%define STACK_SIZE  (7 * TERM_SIZE + 64)
+
+; GRADIENT(dst, tmp, src, offset): (src[offset] >> 6) - (src[-offset] >> 6)
+%macro GRADIENT 4
+    movu                    %1, [%3 + %4]
+    movu                    %2, [%3 - %4]
+    psraw                   %1, 6
+    psraw                   %2, 6
+    psubw                   %1, %2
+%endmacro
+
+; one row of the window terms
+%macro BDOF_TERMS_ROW 0
+    GRADIENT                m1, m0, s0q, 2
+    GRADIENT                m2, m0, s0q, SRC_STRIDE
+    GRADIENT                m3, m0, s1q, 2
+    GRADIENT                m4, m0, s1q, SRC_STRIDE
+    psubw                   m5, m1, m3
+    psubw                   m6, m2, m4
+    movu         [TERM(5)], m5
+    movu         [TERM(6)], m6
+    paddw                   m1, m3
+    paddw                   m2, m4
+    psraw                   m1, 1                       ; gx
+    psraw                   m2, 1                       ; gy
+
+    movu                    m3, [s0q]
+    movu                    m4, [s1q]
+    psraw                   m3, 4
+    psraw                   m4, 4
+    psubw                   m4, m3                      ; -diff
+
+    pabsw                   m0, m1
+    pabsw                   m3, m2
+    psignw                  m5, m1, m2
+    psignw                  m6, m4, m1
+    psignw                  m4, m4, m2
+    movu         [TERM(0)], m0
+    movu         [TERM(1)], m3
+    movu         [TERM(2)], m5
+    movu         [TERM(3)], m6
+    movu         [TERM(4)], m4
+%endmacro
+
+; WINDOW_SUM(dst, term): the 6x6 window sums of term for the 4 blocks of a block row,
+; as the dword pairs of dst
+%macro WINDOW_SUM 2
+    movu                    m0, [TERM(%2) + topq]
+    paddw                   m0, [TERM(%2)]
+    paddw                   m0, [TERM(%2) + 1 * TERM_ROW]
+    paddw                   m0, [TERM(%2) + 2 * TERM_ROW]
+    paddw                   m0, [TERM(%2) + 3 * TERM_ROW]
+    paddw                   m0, [TERM(%2) + bottomq]
+
+    ; column -1 and column block_w repeat the edge columns
+    movu         [HBUF + 2], m0
+    movzx                 tmpd, word [HBUF + 2]
+    mov          [HBUF + 0], tmpw
+    movzx                 tmpd, word [HBUF + block_wq * 2]
+    mov [HBUF + block_wq * 2 + 2], tmpw
+
+    movu                    %1, [HBUF]                  ; columns 4 * i - 1 ... 4 * i + 2
+    movu                    m0, [HBUF + 4]
+    pand                    m0, m9                      ; columns 4 * i + 3, 4 * i + 4
+    pmaddwd                 %1, m8
+    pmaddwd                 m0, m8
+    paddd                   %1, m0
+%endmacro
+
+; LOG2(dst, src): av_log2(src) for 0 < src < (1 << 24)
+%macro LOG2 2
+    cvtdq2ps                %1, %2
+    psrld                   %1, 23
+    psubd                   %1, m12
+%endmacro
+
+; CLIP_MV(dst, shift, sum): dst = sum > 0 ? av_clip(dst >> av_log2(sum), -15, 15) : 0
+%macro CLIP_MV 3
+    LOG2                    %2, %3
+    vpsravd                 %1, %1, %2
+    pminsd                  %1, m10
+    pmaxsd                  %1, m11
+    pcmpgtd                 %2, %3, m14
+    pand                    %1, %2
+%endmacro
+
+; derive vx and vy of the blocks of a block row, output: m6, m7 the (vx, vy) pairs
+; of the first and second 4 samples in each lane
+%macro BDOF_VX_VY 0
+    WINDOW_SUM              m3, 0
+    WINDOW_SUM              m4, 1
+    WINDOW_SUM              m5, 2
+    WINDOW_SUM              m6, 3
+    WINDOW_SUM              m7, 4
+
+    ; one dword per block in 0, 1, 4, 5
+    phaddd                  m3, m4                      ; sgx2, sgy2
+    phaddd                  m5, m6                      ; sgxgy, sgxdi
+    phaddd                  m7, m7                      ; sgydi
+    pshufd                  m4, m3, q1032               ; sgy2
+    pshufd                  m6, m5, q1032               ; sgxdi
+
+    pslld                   m1, m6, 2
+    CLIP_MV                 m1, m0, m3                  ; vx
+
+    pmulld                  m2, m1, m5
+    psrad                   m2, 1
+    pslld                   m7, 2
+    psubd                   m7, m2
+    CLIP_MV                 m7, m0, m4                  ; vy
+
+    pslld                   m7, 16
+    pblendw                 m1, m7, 0xaa
+    pshufd                  m6, m1, q0000
+    pshufd                  m7, m1, q1111
+%endmacro
+
+; correct and store one row of 16 or 8 samples
+%macro BDOF_APPLY_ROW 0
+    movu                    m0, [TERM(5)]
+    movu                    m1, [TERM(6)]
+    punpcklwd               m2, m0, m1
+    punpckhwd               m0, m1
+    pmaddwd                 m2, m6
+    pmaddwd                 m0, m7
+
+    movu                    m1, [src0q]
+    movu                    m3, [src1q]
+    punpcklwd               m4, m1, m3
+    punpckhwd               m1, m3
+    pmaddwd                 m4, m8
+    pmaddwd                 m1, m8
+    paddd                   m2, m4
+    paddd                   m0, m1
+    paddd                   m2, m13
+    paddd                   m0, m13
+    psrad                   m2, 15 - BD
+    psrad                   m0, 15 - BD
+    packssdw                m2, m0
+
+%if BD == 8
+    packuswb                m2, m2
+    vpermq                  m2, m2, q3120
+    cmp               block_wd, 8
+    je %%w8
+    movu                [dstq], xm2
+    jmp %%end
+%%w8:
+    movq                [dstq], xm2
+%else
+    CLIPW                   m2, m14, m15
+    cmp               block_wd, 8
+    je %%w8
+    movu                [dstq], m2
+    jmp %%end
+%%w8:
+    movu                [dstq], xm2
+%endif
+%%end:
+%endmacro
+
+; void ff_vvc_apply_bdof_%1_avx2(uint8_t *dst, ptrdiff_t dst_stride, int16_t *src0, int16_t *src1,
+;     int block_w, int block_h);
+; block_w and block_h are 8 or 16
+%macro APPLY_BDOF 1
+%xdefine BD %1
+cglobal vvc_apply_bdof_%1, 6, 13, 16, STACK_SIZE, dst, dst_stride, src0, src1, block_w, block_h, \
+    s0, s1, row, top, bottom, tmp, y
+    movsxdifnidn      block_wq, block_wd
+    movsxdifnidn      block_hq, block_hd
+
+    vpbroadcastd            m8, [pw_1]
+    mova                    m9, [bdof_hmask]
+    vpbroadcastd           m10, [pd_15]
+    vpbroadcastd           m11, [pd_m15]
+    vpbroadcastd           m12, [pd_127]
+    mov                   tmpd, 1 << (14 - BD)
+    movd                  xm13, tmpd
+    vpbroadcastd           m13, xm13                    ; 1 << (shift4 - 1)
+    pxor                   m14, m14
+%if BD > 8
+    mov                   tmpd, (1 << BD) - 1
+    movd                  xm15, tmpd
+    vpbroadcastw           m15, xm15
+%endif
+
+    mov                    s0q, src0q
+    mov                    s1q, src1q
+    mov                   rowq, rsp
+    mov                     yq, block_hq
+.terms:
+    BDOF_TERMS_ROW
+    add                    s0q, SRC_STRIDE
+    add                    s1q, SRC_STRIDE
+    add                   rowq, TERM_ROW
+    dec                     yq
+    jg .terms
+
+    mov                   rowq, rsp
+    xor                     yq, yq
+.block_row:
+    ; the window rows above and below the blocks, replicated at the block edges
+    mov                   topq, -TERM_ROW
+    xor                   tmpq, tmpq
+    test                    yq, yq
+    cmovz                 topq, tmpq
+    mov                bottomq, 4 * TERM_ROW
+    mov                   tmpq, 3 * TERM_ROW
+    lea                    s0q, [yq + 4]
+    cmp                    s0q, block_hq
+    cmove              bottomq, tmpq
+
+    BDOF_VX_VY
+
+%rep 4
+    BDOF_APPLY_ROW
+    add                  src0q, SRC_STRIDE
+    add                  src1q, SRC_STRIDE
+    add                   dstq, dst_strideq
+    add                   rowq, TERM_ROW
+%endrep
+    add                     yq, 4
+    cmp                     yq, block_hq
+    jl .block_row
+    RET
+%endmacro
+
+; FETCH_ROW: block_w + 2 samples
+%macro FETCH_ROW 0
+    xor                     iq, iq
+%%loop:
+%if ps == 2
+    movu                   xm0, [srcq + iq * 2]
+%else
+    pmovzxbw               xm0, [srcq + iq]
+%endif
+    psllw                  xm0, 14 - BD
+    movu        [dstq + iq * 2], xm0
+    add                     iq, 8
+    cmp                     iq, widthq
+    jl %%loop
+    FETCH_SAMPLE            widthq
+    FETCH_SAMPLE            widthq + 1
+%endmacro
+
+; FETCH_SAMPLE(x)
+%macro FETCH_SAMPLE 1
+%if ps == 2
+    movzx                 tmpd, word [srcq + (%1) * 2]
+%else
+    movzx                 tmpd, byte [srcq + %1]
+%endif
+    shl                   tmpd, 14 - BD
+    mov  [dstq + (%1) * 2], tmpw
+%endmacro
+
+; void ff_vvc_bdof_fetch_samples_%1_avx2(int16_t *dst, const uint8_t *src, ptrdiff_t src_stride,
+;     int x_frac, int y_frac, int width, int height);
+; width is a multiple of 8
+%macro BDOF_FETCH_SAMPLES 1
+%xdefine BD %1
+%define ps ((%1 + 7) / 8)
+cglobal vvc_bdof_fetch_samples_%1, 7, 9, 1, dst, src, src_stride, x_frac, y_frac, width, height, tmp, i
+    movsxdifnidn        widthq, widthd
+    shr                x_fracd, 3
+    shr                y_fracd, 3
+    dec                x_fracq
+    dec                y_fracq
+    imul               y_fracq, src_strideq
+    lea                   srcq, [srcq + x_fracq * ps]
+    add                   srcq, y_fracq
+    sub                   dstq, (MAX_PB_SIZE + 1) * 2
+
+    FETCH_ROW
+.rows:
+    add                   dstq, SRC_STRIDE
+    add                   srcq, src_strideq
+    FETCH_SAMPLE            0
+    FETCH_SAMPLE            widthq + 1
+    dec                heightd
+    jg .rows
+    add                   dstq, SRC_STRIDE
+    add                   srcq, src_strideq
+    FETCH_ROW
+    RET
+%endmacro
+
+%if ARCH_X86_64
+%if HAVE_AVX2_EXTERNAL
+
+INIT_YMM avx2
+
+APPLY_BDOF          8
+APPLY_BDOF         10
+APPLY_BDOF         12
+
+BDOF_FETCH_SAMPLES  8
+BDOF_FETCH_SAMPLES 10
+BDOF_FETCH_SAMPLES 12
+
+%endif
+%endif
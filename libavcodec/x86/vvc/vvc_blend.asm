@@ -0,0 +1,267 @@
+; /*
+; * Provide SIMD CIIP and GPM blending functions for VVC decoding
+; *
+; * This file is part of FFmpeg.
+; *
+; * FFmpeg is free software; you can redistribute it and/or
+; * modify it under the terms of the GNU Lesser General Public
+; * License as published by the Free Software Foundation; either
+; * version 2.1 of the License, or (at your option) any later version.
+; *
+; * FFmpeg is distributed in the hope that it will be useful,
+; * but WITHOUT ANY WARRANTY; without even the implied warranty of
+; * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+; * Lesser General Public License for more details.
+; *
+; * You should have received a copy of the GNU Lesser General Public
+; * License along with FFmpeg; if not, write to the Free Software
+; * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+; */
+
+%include "libavutil/x86/x86util.asm"
+
+%define MAX_PB_SIZE 128
+
+SECTION_RODATA 32
+
+pb_reverse_w: db 14, 15, 12, 13, 10, 11, 8, 9, 6, 7, 4, 5, 2, 3, 0, 1
+              db 14, 15, 12, 13, 10, 11, 8, 9, 6, 7, 4, 5, 2, 3, 0, 1
+
+cextern pw_2
+cextern pw_8
+cextern pw_255
+
+SECTION .text
+
+; LOAD_BYTES(dst, src, bytes)
+%macro LOAD_BYTES 3
+%if %3 == 4
+    movd                    %1, %2
+%elif %3 == 8
+    movq                    %1, %2
+%else
+    movu                    %1, %2
+%endif
+%endmacro
+
+; STORE_PIXELS(dst, src as a register number, number of pixels)
+; the pixels are words, m12 and m13 the clipping bounds for the high bit depths
+%macro STORE_PIXELS 3
+%if BD == 8
+    packuswb             m%2, m%2
+%if %3 == 16
+    vpermq               m%2, m%2, q3120
+%endif
+    LOAD_BYTES            %1, xm%2, %3
+%else
+    CLIPW                m%2, m12, m13
+    LOAD_BYTES            %1, m%2, 2 * %3
+%endif
+%endmacro
+
+; GPM_WEIGHTS(step_x, number of pixels): m0 the weights of the pixels as words
+%macro GPM_WEIGHTS 2
+%assign %%step %1
+%if %%step < 0
+%assign %%step -%%step
+    lea                   tmpq, [wpq - (%2 - 1) * %%step]
+%define GPM_WSRC tmpq
+%else
+%define GPM_WSRC wpq
+%endif
+%if %%step == 1
+%if %2 == 4
+    movd                  xm0, [GPM_WSRC]
+    pmovzxbw              xm0, xm0
+%else
+    pmovzxbw               m0, [GPM_WSRC]
+%endif
+%else
+    LOAD_BYTES             m0, [GPM_WSRC], 2 * %2
+    pand                   m0, m9
+%endif
+%if %1 < 0
+%if %2 == 4
+    pshuflw               xm0, xm0, q0123
+%else
+    pshufb                 m0, m10
+%if %2 == 16
+    vpermq                 m0, m0, q1032
+%endif
+%endif
+%endif
+%endmacro
+
+; GPM_BLEND(number of pixels)
+%macro GPM_BLEND 1
+    LOAD_BYTES             m1, [src0q + xq * 2], 2 * %1
+    LOAD_BYTES             m2, [src1q + xq * 2], 2 * %1
+    psubw                  m3, m8, m0
+    punpcklwd              m4, m0, m3
+    punpckhwd              m0, m3
+    punpcklwd              m3, m1, m2
+    punpckhwd              m1, m2
+    pmaddwd                m4, m3
+    pmaddwd                m0, m1
+    paddd                  m4, m11
+    paddd                  m0, m11
+    psrad                  m4, GPM_SHIFT
+    psrad                  m0, GPM_SHIFT
+    packssdw               m4, m0
+    STORE_PIXELS           [dstq + xq * ((BD + 7) / 8)], 4, %1
+%endmacro
+
+; GPM_LOOP(name, step_x, number of pixels per iteration)
+%macro GPM_LOOP 3
+.%1_%3:
+    mov                    wpq, weightsq
+    xor                     xq, xq
+.%1_%3_col:
+    GPM_WEIGHTS             %2, %3
+    GPM_BLEND               %3
+    add                    wpq, %2 * %3
+    add                     xq, %3
+    cmp                     xq, widthq
+    jl .%1_%3_col
+
+    add                   dstq, dst_strideq
+    add                  src0q, MAX_PB_SIZE * 2
+    add                  src1q, MAX_PB_SIZE * 2
+    add               weightsq, step_yq
+    dec                 heightd
+    jg .%1_%3
+    RET
+%endmacro
+
+; GPM_STEP(name, step_x)
+%macro GPM_STEP 2
+.%1:
+    cmp                 widthd, 8
+    jl .%1_4
+    je .%1_8
+INIT_YMM cpuname
+    GPM_LOOP                %1, %2, 16
+INIT_XMM cpuname
+    GPM_LOOP                %1, %2, 8
+    GPM_LOOP                %1, %2, 4
+INIT_YMM cpuname
+%endmacro
+
+; void ff_vvc_put_gpm_%1_avx2(uint8_t *dst, ptrdiff_t dst_stride, int width, int height,
+;     const int16_t *src0, const int16_t *src1, const uint8_t *weights, int step_x, int step_y);
+%macro PUT_GPM 1
+%xdefine BD %1
+%assign GPM_SHIFT 17 - BD
+%if GPM_SHIFT < 5
+%assign GPM_SHIFT 5
+%endif
+cglobal vvc_put_gpm_%1, 9, 12, 14, dst, dst_stride, width, height, src0, src1, weights, step_x, step_y, \
+    x, wp, tmp
+    movsxdifnidn        widthq, widthd
+    movsxdifnidn       step_yq, step_yd
+    vpbroadcastd           m8, [pw_8]
+    vpbroadcastd           m9, [pw_255]
+    mova                  m10, [pb_reverse_w]
+    mov                   tmpd, 1 << (GPM_SHIFT - 1)
+    movd                 xm11, tmpd
+    vpbroadcastd          m11, xm11
+%if BD > 8
+    pxor                  m12, m12
+    mov                   tmpd, (1 << BD) - 1
+    movd                 xm13, tmpd
+    vpbroadcastw          m13, xm13
+%endif
+
+    cmp                step_xd, 1
+    je .p1
+    cmp                step_xd, 2
+    je .p2
+    cmp                step_xd, -1
+    je .m1
+    GPM_STEP               m2, -2
+    GPM_STEP               m1, -1
+    GPM_STEP               p2,  2
+    GPM_STEP               p1,  1
+%endmacro
+
+; CIIP_LOOP(number of pixels per iteration)
+%macro CIIP_LOOP 1
+.w%1:
+    xor                     xq, xq
+.w%1_col:
+%if BD == 8
+%if %1 == 4
+    movd                  xm0, [dstq + xq]
+    movd                  xm1, [interq + xq]
+    pmovzxbw              xm0, xm0
+    pmovzxbw              xm1, xm1
+%else
+    pmovzxbw               m0, [dstq + xq]
+    pmovzxbw               m1, [interq + xq]
+%endif
+%else
+    LOAD_BYTES             m0, [dstq + xq * 2], 2 * %1
+    LOAD_BYTES             m1, [interq + xq * 2], 2 * %1
+%endif
+    pmullw                 m0, m8
+    pmullw                 m1, m9
+    paddw                  m0, m10
+    paddw                  m0, m1
+    psrlw                  m0, 2
+    STORE_PIXELS           [dstq + xq * ((BD + 7) / 8)], 0, %1
+    add                     xq, %1
+    cmp                     xq, widthq
+    jl .w%1_col
+
+    add                   dstq, dst_strideq
+    add                 interq, inter_strideq
+    dec                 heightd
+    jg .w%1
+    RET
+%endmacro
+
+; void ff_vvc_put_ciip_%1_avx2(uint8_t *dst, ptrdiff_t dst_stride, int width, int height,
+;     const uint8_t *inter, ptrdiff_t inter_stride, int intra_weight);
+%macro PUT_CIIP 1
+%xdefine BD %1
+cglobal vvc_put_ciip_%1, 7, 8, 14, dst, dst_stride, width, height, inter, inter_stride, intra_weight, x
+    movsxdifnidn        widthq, widthd
+    movd                  xm8, intra_weightd
+    vpbroadcastw           m8, xm8
+    neg          intra_weightd
+    add          intra_weightd, 4
+    movd                  xm9, intra_weightd
+    vpbroadcastw           m9, xm9
+    vpbroadcastd          m10, [pw_2]
+%if BD > 8
+    pxor                  m12, m12
+    mov          intra_weightd, (1 << BD) - 1
+    movd                 xm13, intra_weightd
+    vpbroadcastw          m13, xm13
+%endif
+
+    cmp                 widthd, 8
+    jl .w4
+    je .w8
+    CIIP_LOOP              16
+INIT_XMM cpuname
+    CIIP_LOOP               8
+    CIIP_LOOP               4
+INIT_YMM cpuname
+%endmacro
+
+%if ARCH_X86_64
+%if HAVE_AVX2_EXTERNAL
+
+INIT_YMM avx2
+
+PUT_GPM          8
+PUT_GPM         10
+PUT_GPM         12
+
+PUT_CIIP         8
+PUT_CIIP        10
+PUT_CIIP        12
+
+%endif
+%endif
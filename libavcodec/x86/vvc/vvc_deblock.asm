@@ -0,0 +1,377 @@
+; /*
+; * Provide SIMD deblocking filter functions for VVC decoding
+; *
+; * This file is part of FFmpeg.
+; *
+; * FFmpeg is free software; you can redistribute it and/or
+; * modify it under the terms of the GNU Lesser General Public
+; * License as published by the Free Software Foundation; either
+; * version 2.1 of the License, or (at your option) any later version.
+; *
+; * FFmpeg is distributed in the hope that it will be useful,
+; * but WITHOUT ANY WARRANTY; without even the implied warranty of
+; * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+; * Lesser General Public License for more details.
+; *
+; * You should have received a copy of the GNU Lesser General Public
+; * License along with FFmpeg; if not, write to the Free Software
+; * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+; */
+
+%include "libavutil/x86/x86util.asm"
+
+SECTION_RODATA
+
+pw_2:  times 8 dw 2
+pw_4:  times 8 dw 4
+pw_8:  times 8 dw 8
+pw_10: times 8 dw 10
+
+SECTION .text
+
+; The decisions are made in C and passed as a VVCLFLanes, one word lane for each of the
+; 8 lines of the edge. Every lane runs all the filters and the results are selected with
+; the lane masks, so the edge is loaded and stored only once. The samples are kept as
+; words, m0 - m7 are p3, p2, p1, p0, q0, q1, q2, q3.
+
+; VVCLFLanes
+%define TC         0
+%define FILTER_P  16
+%define FILTER_Q  32
+%define WEAK      48
+%define WEAK_P1   64
+%define WEAK_Q1   80
+%define STRONG    96
+%define ONE_SIDE 112
+
+; filtered p2, p1, q1, q2 on the stack
+%define S_P2 rsp + 0 * 16
+%define S_P1 rsp + 1 * 16
+%define S_Q1 rsp + 2 * 16
+%define S_Q2 rsp + 3 * 16
+
+; %1 = clip(%1, %2 - %3, %2 + %3), %4: tmp
+%macro CLIP_TC 4
+    psubw                %4, %2, %3
+    pmaxsw               %1, %4
+    paddw                %4, %2, %3
+    pminsw               %1, %4
+%endmacro
+
+%macro LUMA_FILTER 0
+    movu               m11, [lq + TC]
+    paddw              m12, m11, m11            ; 2 * tc
+    paddw              m13, m12, m11            ; 3 * tc
+
+    ; strong filter, p side
+    paddw               m8, m2, m3
+    paddw               m8, m4                  ; p1 + p0 + q0
+    paddw              m14, m8, m8
+    paddw              m14, m1
+    paddw              m14, m5
+    paddw              m14, [pw_4]
+    psrlw              m14, 3
+    CLIP_TC            m14, m3, m13, m10        ; P0
+    paddw               m9, m8, m1
+    paddw               m9, [pw_2]
+    psrlw               m9, 2
+    CLIP_TC             m9, m2, m12, m10
+    mova            [S_P1], m9
+    paddw               m9, m0, m1
+    paddw               m9, m9
+    paddw               m9, m1
+    paddw               m9, m8
+    paddw               m9, [pw_4]
+    psrlw               m9, 3
+    CLIP_TC             m9, m1, m11, m10
+    mova            [S_P2], m9
+
+    ; strong filter, q side
+    paddw               m8, m3, m4
+    paddw               m8, m5                  ; p0 + q0 + q1
+    paddw              m15, m8, m8
+    paddw              m15, m2
+    paddw              m15, m6
+    paddw              m15, [pw_4]
+    psrlw              m15, 3
+    CLIP_TC            m15, m4, m13, m10        ; Q0
+    paddw               m9, m8, m6
+    paddw               m9, [pw_2]
+    psrlw               m9, 2
+    CLIP_TC             m9, m5, m12, m10
+    mova            [S_Q1], m9
+    paddw               m9, m7, m6
+    paddw               m9, m9
+    paddw               m9, m6
+    paddw               m9, m8
+    paddw               m9, [pw_4]
+    psrlw               m9, 3
+    CLIP_TC             m9, m6, m11, m10
+    mova            [S_Q2], m9
+
+    ; strong p0 and q0 are in m14 and m15 until the weak p1 and q1 are done
+    mova            [S_P2 + 4 * 16], m14
+    mova            [S_P2 + 5 * 16], m15
+
+    ; weak filter, delta0 = (9 * (q0 - p0) - 3 * (q1 - p1) + 8) >> 4 without overflowing 16 bits,
+    ; (d0 + ((d0 - 3 * (q1 - p1) + 8) >> 3)) >> 1
+    psubw               m8, m4, m3              ; d0
+    psubw               m9, m5, m2
+    paddw              m10, m9, m9
+    paddw               m9, m10
+    psubw               m9, m8, m9
+    paddw               m9, [pw_8]
+    psraw               m9, 3
+    paddw               m9, m8
+    psraw               m9, 1                   ; delta0
+    pabsw               m8, m9
+    pmullw             m10, m11, [pw_10]
+    pcmpgtw            m10, m8                  ; abs(delta0) < 10 * tc
+    pand               m10, [lq + WEAK]
+    pminsw              m9, m11
+    pxor                m8, m8
+    psubw               m8, m11
+    pmaxsw              m9, m8                  ; av_clip(delta0, -tc, tc)
+    psraw              m12, m11, 1              ; tc >> 1
+    pxor               m13, m13
+    psubw              m13, m12
+
+    pavgw              m14, m1, m3
+    psubw              m14, m2
+    paddw              m14, m9
+    psraw              m14, 1
+    CLIPW              m14, m13, m12
+    paddw              m14, m2                  ; P1
+    pavgw              m15, m6, m4
+    psubw              m15, m5
+    psubw              m15, m9
+    psraw              m15, 1
+    CLIPW              m15, m13, m12
+    paddw              m15, m5                  ; Q1
+
+    pand               m12, m10, [lq + FILTER_P]
+    pand               m13, m10, [lq + FILTER_Q]
+    paddw               m8, m3, m9
+    psubw              m11, m4, m9
+    pblendvb            m3, m3, m8, m12
+    pblendvb            m4, m4, m11, m13
+    pand               m12, [lq + WEAK_P1]
+    pand               m13, [lq + WEAK_Q1]
+    pblendvb            m2, m2, m14, m12
+    pblendvb            m5, m5, m15, m13
+
+    movu               m12, [lq + STRONG]
+    pand               m13, m12, [lq + FILTER_Q]
+    pand               m12, [lq + FILTER_P]
+    pblendvb            m1, m1, [S_P2], m12
+    pblendvb            m2, m2, [S_P1], m12
+    pblendvb            m3, m3, [S_P2 + 4 * 16], m12
+    pblendvb            m4, m4, [S_P2 + 5 * 16], m13
+    pblendvb            m5, m5, [S_Q1], m13
+    pblendvb            m6, m6, [S_Q2], m13
+%endmacro
+
+%macro CHROMA_FILTER 0
+    movu               m11, [lq + TC]
+    paddw               m8, m2, m3
+    paddw               m8, m4                  ; p1 + p0 + q0
+
+    ; q1 and q2 are the same for the strong and the one side filter
+    paddw               m9, m5, m7
+    paddw               m9, m9
+    paddw               m9, m6
+    paddw               m9, m8
+    paddw               m9, [pw_4]
+    psrlw               m9, 3
+    CLIP_TC             m9, m5, m11, m10
+    mova            [S_Q1], m9
+    paddw              m10, m6, m7
+    paddw               m9, m3, m4
+    paddw               m9, m5
+    paddw               m9, m10
+    paddw               m9, m10
+    paddw               m9, m7
+    paddw               m9, [pw_4]
+    psrlw               m9, 3
+    CLIP_TC             m9, m6, m11, m10
+    mova            [S_Q2], m9
+
+    ; strong
+    paddw               m9, m0, m2
+    paddw               m9, m9
+    paddw               m9, m1
+    paddw               m9, m3
+    paddw               m9, m4
+    paddw               m9, m5
+    paddw               m9, [pw_4]
+    psrlw               m9, 3
+    CLIP_TC             m9, m2, m11, m10
+    mova            [S_P1], m9
+    paddw               m9, m0, m0
+    paddw               m9, m0
+    paddw               m9, m1
+    paddw               m9, m1
+    paddw               m9, m8
+    paddw               m9, [pw_4]
+    psrlw               m9, 3
+    CLIP_TC             m9, m1, m11, m10
+    mova            [S_P2], m9
+    paddw              m12, m0, m1
+    paddw              m12, m8
+    paddw              m12, m3
+    paddw              m12, m5
+    paddw              m12, m6
+    paddw              m12, [pw_4]
+    psrlw              m12, 3
+    CLIP_TC            m12, m3, m11, m10        ; strong P0
+    paddw              m13, m1, m8
+    paddw              m13, m4
+    paddw              m13, m5
+    paddw              m13, m6
+    paddw              m13, m7
+    paddw              m13, [pw_4]
+    psrlw              m13, 3
+    CLIP_TC            m13, m4, m11, m10        ; strong Q0
+
+    ; one side
+    paddw              m14, m8, m2
+    paddw              m14, m2
+    paddw              m14, m3
+    paddw              m14, m5
+    paddw              m14, m6
+    paddw              m14, [pw_4]
+    psrlw              m14, 3
+    CLIP_TC            m14, m3, m11, m10        ; one side P0
+    paddw              m15, m8, m2
+    paddw              m15, m4
+    paddw              m15, m5
+    paddw              m15, m6
+    paddw              m15, m7
+    paddw              m15, [pw_4]
+    psrlw              m15, 3
+    CLIP_TC            m15, m4, m11, m10        ; one side Q0
+
+    ; weak
+    psubw               m9, m4, m3
+    psllw               m9, 2
+    paddw               m9, m2
+    psubw               m9, m5
+    paddw               m9, [pw_4]
+    psraw               m9, 3
+    pminsw              m9, m11
+    pxor                m8, m8
+    psubw               m8, m11
+    pmaxsw              m9, m8                  ; delta0
+    paddw              m10, m3, m9              ; weak P0
+    psubw               m9, m4, m9              ; weak Q0
+
+    movu                m8, [lq + ONE_SIDE]
+    pblendvb           m10, m10, m14, m8
+    pblendvb            m9, m9, m15, m8
+    movu               m14, [lq + STRONG]
+    pblendvb           m10, m10, m12, m14
+    pblendvb            m9, m9, m13, m14
+    por                 m8, m14                 ; strong or one side
+    movu               m12, [lq + FILTER_P]
+    movu               m13, [lq + FILTER_Q]
+    pblendvb            m3, m3, m10, m12
+    pblendvb            m4, m4, m9, m13
+    pand               m14, m12
+    pand                m8, m13
+    pblendvb            m1, m1, [S_P2], m14
+    pblendvb            m2, m2, [S_P1], m14
+    pblendvb            m5, m5, [S_Q1], m8
+    pblendvb            m6, m6, [S_Q2], m8
+%endmacro
+
+; %1: 8 or 16 bpc, %2: register, %3: address
+%macro LOAD_PIXELS 3
+%if %1 == 8
+    pmovzxbw             %2, [%3]
+%else
+    movu                 %2, [%3]
+%endif
+%endmacro
+
+%macro STORE_PIXELS 3
+%if %1 == 8
+    packuswb             %2, %2
+    movq               [%3], %2
+%else
+    movu               [%3], %2
+%endif
+%endmacro
+
+; void ff_vvc_lf_%2_%3_%1bpc_avx2(uint8_t *pix, ptrdiff_t stride, const VVCLFLanes *l, int pixel_max);
+; %1: 8 or 16 bpc, %2: luma or chroma, %3: h or v edge
+%macro LOOP_FILTER 3
+cglobal vvc_lf_%2_%3_%1bpc, 4, 6, 16, 0x60, pix, stride, l, max, stride3, pix4
+    lea            stride3q, [strideq * 3]
+%ifidn %3, h
+    sub                pixq, strideq
+    sub                pixq, stride3q
+%else
+    sub                pixq, 4 * %1 / 8
+%endif
+    lea               pix4q, [pixq + strideq * 4]
+    LOAD_PIXELS         %1, m0, pixq
+    LOAD_PIXELS         %1, m1, pixq + strideq
+    LOAD_PIXELS         %1, m2, pixq + strideq * 2
+    LOAD_PIXELS         %1, m3, pixq + stride3q
+    LOAD_PIXELS         %1, m4, pix4q
+    LOAD_PIXELS         %1, m5, pix4q + strideq
+    LOAD_PIXELS         %1, m6, pix4q + strideq * 2
+    LOAD_PIXELS         %1, m7, pix4q + stride3q
+%ifidn %3, v
+    TRANSPOSE8x8W        0, 1, 2, 3, 4, 5, 6, 7, 8
+%endif
+
+%ifidn %2, luma
+    LUMA_FILTER
+%else
+    CHROMA_FILTER
+%endif
+
+%if %1 == 16
+    pxor                m8, m8
+    movd               xm9, maxd
+    vpbroadcastw        m9, xm9
+    CLIPW               m1, m8, m9
+    CLIPW               m2, m8, m9
+    CLIPW               m3, m8, m9
+    CLIPW               m4, m8, m9
+    CLIPW               m5, m8, m9
+    CLIPW               m6, m8, m9
+%endif
+
+%ifidn %3, v
+    TRANSPOSE8x8W        0, 1, 2, 3, 4, 5, 6, 7, 8
+    STORE_PIXELS        %1, m0, pixq
+    STORE_PIXELS        %1, m7, pix4q + stride3q
+%endif
+    STORE_PIXELS        %1, m1, pixq + strideq
+    STORE_PIXELS        %1, m2, pixq + strideq * 2
+    STORE_PIXELS        %1, m3, pixq + stride3q
+    STORE_PIXELS        %1, m4, pix4q
+    STORE_PIXELS        %1, m5, pix4q + strideq
+    STORE_PIXELS        %1, m6, pix4q + strideq * 2
+    RET
+%endmacro
+
+%macro LOOP_FILTERS 1
+    LOOP_FILTER         %1, luma,   h
+    LOOP_FILTER         %1, luma,   v
+    LOOP_FILTER         %1, chroma, h
+    LOOP_FILTER         %1, chroma, v
+%endmacro
+
+%if ARCH_X86_64
+%if HAVE_AVX2_EXTERNAL
+
+INIT_XMM avx2
+
+LOOP_FILTERS  8
+LOOP_FILTERS 16
+
+%endif
+%endif
@@ -0,0 +1,196 @@
+; /*
+; * Provide SIMD DMVR bilinear interpolation functions for VVC decoding
+; *
+; * This file is part of FFmpeg.
+; *
+; * FFmpeg is free software; you can redistribute it and/or
+; * modify it under the terms of the GNU Lesser General Public
+; * License as published by the Free Software Foundation; either
+; * version 2.1 of the License, or (at your option) any later version.
+; *
+; * FFmpeg is distributed in the hope that it will be useful,
+; * but WITHOUT ANY WARRANTY; without even the implied warranty of
+; * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+; * Lesser General Public License for more details.
+; *
+; * You should have received a copy of the GNU Lesser General Public
+; * License along with FFmpeg; if not, write to the Free Software
+; * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+; */
+
+%include "libavutil/x86/x86util.asm"
+
+%define MAX_PB_SIZE 128
+
+SECTION_RODATA
+
+pw_16: times 2 dw 16
+
+SECTION .text
+
+; The bilinear filter taps are (16 - mx, mx), so a filtered sample is at most 16 * 4095 and
+; fits in an unsigned word. The rounding shift (t + (1 << (s - 1))) >> s is done as
+; pavgw(t >> (s - 1), 0), which cannot overflow.
+
+; LOAD_PIXELS(dst, src, width)
+%macro LOAD_PIXELS 3
+%if ps == 2
+%if %3 == 4
+    movq                    %1, %2
+%else
+    movu                    %1, %2
+%endif
+%else
+%if %3 == 4
+    movd                    %1, %2
+    pmovzxbw                %1, %1
+%else
+    pmovzxbw                %1, %2
+%endif
+%endif
+%endmacro
+
+; STORE_WORDS(dst, src, width)
+%macro STORE_WORDS 3
+%if %3 == 4
+    movq                    %1, %2
+%else
+    movu                    %1, %2
+%endif
+%endmacro
+
+; BILINEAR(dst, src0, src1, coeff0, coeff1, shift)
+%macro BILINEAR 6
+    pmullw                  %1, %2, %4
+    pmullw                  %3, %5
+    paddw                   %1, %3
+    psrlw                   %1, %6 - 1
+    pavgw                   %1, m3
+%endmacro
+
+; DMVR_COPY(width)
+%macro DMVR_COPY 1
+    LOAD_PIXELS             m0, [srcpq], %1
+%if BD == 8
+    psllw                   m0, 2
+%elif BD == 12
+    psrlw                   m0, 1
+    pavgw                   m0, m3
+%endif
+    STORE_WORDS        [dstpq], m0, %1
+%endmacro
+
+; DMVR_H(width)
+%macro DMVR_H 1
+    LOAD_PIXELS             m1, [srcpq], %1
+    LOAD_PIXELS             m2, [srcpq + ps], %1
+    BILINEAR                m0, m1, m2, m4, m5, BD - 6
+    STORE_WORDS        [dstpq], m0, %1
+%endmacro
+
+; DMVR_V(width)
+%macro DMVR_V 1
+    LOAD_PIXELS             m1, [srcpq], %1
+    LOAD_PIXELS             m2, [srcpq + src_strideq], %1
+    BILINEAR                m0, m1, m2, m4, m5, BD - 6
+    STORE_WORDS        [dstpq], m0, %1
+%endmacro
+
+; DMVR_HV(width), m6 holds the horizontal result of the row above
+%macro DMVR_HV 1
+    LOAD_PIXELS             m1, [srcpq + src_strideq], %1
+    LOAD_PIXELS             m2, [srcpq + src_strideq + ps], %1
+    BILINEAR                m0, m1, m2, m4, m5, BD - 6
+    mova                    m1, m0
+    BILINEAR                m2, m6, m1, m7, m8, 4
+    mova                    m6, m0
+    STORE_WORDS        [dstpq], m2, %1
+%endmacro
+
+; DMVR_ROWS(type, width): filter a column of the block
+%macro DMVR_ROWS 2
+    mov                  srcpq, srcq
+    mov                  dstpq, dstq
+    mov                     hd, heightd
+%ifidn %1, HV
+    LOAD_PIXELS             m1, [srcpq], %2
+    LOAD_PIXELS             m2, [srcpq + ps], %2
+    BILINEAR                m6, m1, m2, m4, m5, BD - 6
+%endif
+.rows_%2:
+    DMVR_%1                 %2
+    add                  srcpq, src_strideq
+    add                  dstpq, MAX_PB_SIZE * 2
+    dec                     hd
+    jg .rows_%2
+    add                   srcq, %2 * ps
+    add                   dstq, %2 * 2
+    sub                 widthd, %2
+%endmacro
+
+; SPLAT_COEFFS(coeff0, coeff1, frac)
+%macro SPLAT_COEFFS 3
+    movd                   xm%2, %3d
+    vpbroadcastw            m%2, xm%2
+    vpbroadcastd            m%1, [pw_16]
+    psubw                   m%1, m%2
+%endmacro
+
+; void ff_%3_%1_avx2(int16_t *dst, const uint8_t *src, ptrdiff_t src_stride,
+;     int height, intptr_t mx, intptr_t my, int width);
+; width is a multiple of 4
+; DMVR(bit_depth, type, name)
+%macro DMVR 3
+%xdefine BD %1
+%define ps ((%1 + 7) / 8)
+cglobal %3_%1, 7, 10, 9, dst, src, src_stride, height, mx, my, width, srcp, dstp, h
+    pxor                    m3, m3
+%ifidn %2, V
+    SPLAT_COEFFS             4, 5, my
+%else
+    SPLAT_COEFFS             4, 5, mx
+%endif
+%ifidn %2, HV
+    SPLAT_COEFFS             7, 8, my
+%endif
+
+.w16:
+    cmp                 widthd, 16
+    jl .w8
+    DMVR_ROWS               %2, 16
+    jmp .w16
+.w8:
+    cmp                 widthd, 8
+    jl .w4
+INIT_XMM cpuname
+    DMVR_ROWS               %2, 8
+INIT_YMM cpuname
+.w4:
+    cmp                 widthd, 4
+    jl .end
+INIT_XMM cpuname
+    DMVR_ROWS               %2, 4
+INIT_YMM cpuname
+    jmp .w4
+.end:
+    RET
+%endmacro
+
+%macro DMVR_FUNCS 1
+DMVR %1, COPY, vvc_dmvr
+DMVR %1, H,    vvc_dmvr_h
+DMVR %1, V,    vvc_dmvr_v
+DMVR %1, HV,   vvc_dmvr_hv
+%endmacro
+
+%if ARCH_X86_64
+%if HAVE_AVX2_EXTERNAL
+
+INIT_YMM avx2
+
+DMVR_FUNCS 8
+DMVR_FUNCS 10
+DMVR_FUNCS 12
+
+%endif
+%endif
@@ -0,0 +1,965 @@
+; /*
+; * Provide SIMD intra prediction functions for VVC decoding
+; *
+; * This file is part of FFmpeg.
+; *
+; * FFmpeg is free software; you can redistribute it and/or
+; * modify it under the terms of the GNU Lesser General Public
+; * License as published by the Free Software Foundation; either
+; * version 2.1 of the License, or (at your option) any later version.
+; *
+; * FFmpeg is distributed in the hope that it will be useful,
+; * but WITHOUT ANY WARRANTY; without even the implied warranty of
+; * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+; * Lesser General Public License for more details.
+; *
+; * You should have received a copy of the GNU Lesser General Public
+; * License along with FFmpeg; if not, write to the Free Software
+; * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+; */
+
+%include "libavutil/x86/x86util.asm"
+
+SECTION_RODATA 32
+
+pd_0_7: dd 0, 1, 2, 3, 4, 5, 6, 7
+pd_mip_before: dd 0, 0, 1, 2, 3, 4, 5, 6
+pd_cclm_left:  dd 7, 0, 1, 2, 3, 4, 5, 6
+
+cextern pw_1
+cextern pw_32
+cextern pd_1
+cextern pd_32
+cextern pd_65535
+
+SECTION .text
+
+; Loads %3 pixels at %2 as words into m%1, the upper part of the register is zeroed.
+; %1: register index, %2: address, %3: pixels (16, 8, 4 or 2), %4: bpc
+%macro LOAD_PIXELS 4
+%if %4 == 8
+    %if %3 == 16
+        pmovzxbw         m%1, [%2]
+    %elif %3 == 8
+        pmovzxbw        xm%1, [%2]
+    %elif %3 == 4
+        movd            xm%1, [%2]
+        pmovzxbw        xm%1, xm%1
+    %else
+        movzx          tmpd, word [%2]
+        movd            xm%1, tmpd
+        pmovzxbw        xm%1, xm%1
+    %endif
+%else
+    %if %3 == 16
+        movu             m%1, [%2]
+    %elif %3 == 8
+        movu            xm%1, [%2]
+    %elif %3 == 4
+        movq            xm%1, [%2]
+    %else
+        movd            xm%1, [%2]
+    %endif
+%endif
+%endmacro
+
+; Stores the first %3 words of m%2 as pixels at %1, m%2 is clobbered for 8 bpc.
+; %1: address, %2: register index, %3: pixels (16, 8, 4 or 2), %4: bpc
+%macro STORE_PIXELS 4
+%if %4 == 8
+    %if %3 == 16
+        packuswb         m%2, m%2
+        vpermq           m%2, m%2, q3120
+        movu           [%1], xm%2
+    %else
+        packuswb        xm%2, xm%2
+        %if %3 == 8
+            movq       [%1], xm%2
+        %elif %3 == 4
+            movd       [%1], xm%2
+        %else
+            pextrw     [%1], xm%2, 0
+        %endif
+    %endif
+%else
+    %if %3 == 16
+        movu           [%1], m%2
+    %elif %3 == 8
+        movu           [%1], xm%2
+    %elif %3 == 4
+        movq           [%1], xm%2
+    %else
+        movd           [%1], xm%2
+    %endif
+%endif
+%endmacro
+
+; Stores the first %1 bytes of m%2 (and m%2+1.. for the wider rows if %3) at dstq.
+; %1: bytes, %2: register index, %3: use consecutive registers
+%macro STORE_ROW 3
+%if %1 >= 32
+    %assign %%i 0
+    %rep %1 / 32
+        %if %3
+            %assign %%r %2 + %%i
+            movu [dstq + %%i * 32], m %+ %%r
+        %else
+            movu [dstq + %%i * 32], m%2
+        %endif
+        %assign %%i %%i+1
+    %endrep
+%elif %1 == 16
+    movu             [dstq], xm%2
+%elif %1 == 8
+    movq             [dstq], xm%2
+%elif %1 == 4
+    movd             [dstq], xm%2
+%else
+    pextrw           [dstq], xm%2, 0
+%endif
+%endmacro
+
+; Jumps to .b%1 for a row of 2^%1 bytes, the row size in bytes is in wq.
+%macro JMP_ROW_BYTES 0
+    tzcnt               wd, wd
+    cmp                 wd, 4
+    jg .b_wide
+    je .b4
+    cmp                 wd, 2
+    jg .b3
+    je .b2
+    jmp .b1
+.b_wide:
+    cmp                 wd, 6
+    jg .b7
+    je .b6
+    jmp .b5
+%endmacro
+
+; The fill of a row of every size, with the row in m0 (m0-m3 if %1)
+; %1: use consecutive registers, %2: per row setup
+%macro FILL_ROWS 2
+%assign %%b 1
+%rep 7
+.b %+ %%b:
+    %2
+    STORE_ROW       (1 << %%b), 0, %1
+    add               dstq, strideq
+    dec                 hd
+    jg .b %+ %%b
+    RET
+%assign %%b %%b+1
+%endrep
+%endmacro
+
+%macro NOP_ROW 0
+%endmacro
+
+%macro PRED_H_ROW 1 ; bpc
+%if %1 == 8
+    vpbroadcastb        m0, [leftq]
+    inc              leftq
+%else
+    vpbroadcastw        m0, [leftq]
+    add              leftq, 2
+%endif
+%endmacro
+
+;void ff_vvc_intra_pred_v_%1bpc_avx2(uint8_t *dst, ptrdiff_t stride, const uint8_t *top, intptr_t w, intptr_t h);
+%macro PRED_V 1
+cglobal vvc_intra_pred_v_%1bpc, 5, 5, 4, dst, stride, top, w, h
+%if %1 > 8
+    add                 wd, wd
+%endif
+    movu                m0, [topq]
+    cmp                 wd, 32
+    jle .load_done
+    movu                m1, [topq + 32]
+    cmp                 wd, 64
+    jle .load_done
+    movu                m2, [topq + 64]
+    movu                m3, [topq + 96]
+.load_done:
+    JMP_ROW_BYTES
+    FILL_ROWS 1, NOP_ROW
+%endmacro
+
+;void ff_vvc_intra_pred_h_%1bpc_avx2(uint8_t *dst, ptrdiff_t stride, const uint8_t *left, intptr_t w, intptr_t h);
+%macro PRED_H 1
+cglobal vvc_intra_pred_h_%1bpc, 5, 5, 1, dst, stride, left, w, h
+%if %1 > 8
+    add                 wd, wd
+%endif
+    JMP_ROW_BYTES
+    FILL_ROWS 0, PRED_H_ROW %1
+%endmacro
+
+; Adds the sum of the %2 pixels at %1 to the dwords of m0.
+; %1: pointer, %2: number of pixels, %3: bpc
+%macro DC_SUM 3
+    cmp               %2d, 8
+    jg %%wide
+    je %%w8
+    cmp               %2d, 4
+    je %%w4
+    LOAD_PIXELS          1, %1, 2, %3
+    jmp %%add
+%%w4:
+    LOAD_PIXELS          1, %1, 4, %3
+    jmp %%add
+%%w8:
+    LOAD_PIXELS          1, %1, 8, %3
+    jmp %%add
+%%wide:
+    xor                 xq, xq
+%%loop:
+%if %3 == 8
+    LOAD_PIXELS          1, %1 + xq, 16, %3
+%else
+    LOAD_PIXELS          1, %1 + xq * 2, 16, %3
+%endif
+    pmaddwd             m1, m2
+    paddd               m0, m1
+    add                 xd, 16
+    cmp                 xd, %2d
+    jl %%loop
+    jmp %%done
+%%add:
+    pmaddwd             m1, m2
+    paddd               m0, m1
+%%done:
+%endmacro
+
+;void ff_vvc_intra_pred_dc_%1bpc_avx2(uint8_t *dst, ptrdiff_t stride, const uint8_t *top, const uint8_t *left,
+;    intptr_t w, intptr_t h);
+%macro PRED_DC 1
+cglobal vvc_intra_pred_dc_%1bpc, 6, 8, 3, dst, stride, top, left, w, h, x, tmp
+    pxor                m0, m0
+    mova                m2, [pw_1]
+    cmp                 wd, hd
+    jl .left
+    DC_SUM            topq, w, %1
+    cmp                 wd, hd
+    jg .sum_done
+.left:
+    DC_SUM           leftq, h, %1
+.sum_done:
+    vextracti128       xm1, m0, 1
+    paddd              xm0, xm1
+    pshufd             xm1, xm0, q1032
+    paddd              xm0, xm1
+    pshufd             xm1, xm0, q2301
+    paddd              xm0, xm1
+
+    ; (sum + offset / 2) >> log2(offset), offset is 2 * w for square blocks and max(w, h) else
+    mov               tmpd, wd
+    cmp                 wd, hd
+    cmovl             tmpd, hd
+    jne .offset_done
+    add               tmpd, tmpd
+.offset_done:
+    mov                 xd, tmpd
+    shr                 xd, 1
+    movd               xm1, xd
+    paddd              xm0, xm1
+    tzcnt             tmpd, tmpd
+    movd               xm1, tmpd
+    psrld              xm0, xm1
+%if %1 == 8
+    vpbroadcastb        m0, xm0
+%else
+    vpbroadcastw        m0, xm0
+    add                 wd, wd
+%endif
+    JMP_ROW_BYTES
+    FILL_ROWS 0, NOP_ROW
+%endmacro
+
+;void ff_vvc_intra_pred_planar_%1bpc_avx2(uint8_t *dst, ptrdiff_t stride, const uint8_t *top, const uint8_t *left,
+;    intptr_t w, intptr_t h);
+%macro PRED_PLANAR 1
+%if %1 == 8
+    %define PS 1
+%else
+    %define PS 2
+%endif
+cglobal vvc_intra_pred_planar_%1bpc, 6, 10, 16, dst, stride, top, left, w, h, y, x, tmp, tmp2
+    tzcnt             tmpd, wd
+    movd              xm15, tmpd                ; log2(w)
+    tzcnt            tmp2d, hd
+    movd              xm14, tmp2d               ; log2(h)
+    lea               tmpd, [tmpq + tmp2q + 1]
+    movd              xm13, tmpd                ; shift
+    mov               tmpd, wd
+    imul              tmpd, hd
+    movd              xm12, tmpd
+    vpbroadcastd       m12, xm12                ; w * h
+%if %1 == 8
+    movzx             tmpd, byte [topq + wq]
+    movzx            tmp2d, byte [leftq + hq]
+%else
+    movzx             tmpd, word [topq + wq * 2]
+    movzx            tmp2d, word [leftq + hq * 2]
+%endif
+    movd              xm11, tmpd
+    vpbroadcastd       m11, xm11                ; top[w]
+    movd              xm10, tmp2d
+    vpbroadcastd       m10, xm10                ; left[h]
+    lea               tmpd, [wq - 1]
+    movd               xm9, tmpd
+    vpbroadcastd        m9, xm9                 ; w - 1
+    mova                m8, [pd_0_7]
+
+    xor                 yd, yd
+.row:
+    mov               tmpd, hd
+    sub               tmpd, yd
+    dec               tmpd
+    movd               xm7, tmpd
+    vpbroadcastd        m7, xm7                 ; h - 1 - y
+    lea               tmpd, [yq + 1]
+    movd               xm6, tmpd
+    vpbroadcastd        m6, xm6
+    pmulld              m6, m10                 ; (y + 1) * left[h]
+%if %1 == 8
+    movzx             tmpd, byte [leftq + yq]
+%else
+    movzx             tmpd, word [leftq + yq * 2]
+%endif
+    movd               xm5, tmpd
+    vpbroadcastd        m5, xm5                 ; left[y]
+
+    xor                 xd, xd
+.col:
+%if %1 == 8
+    pmovzxbd            m0, [topq + xq]
+%else
+    pmovzxwd            m0, [topq + xq * 2]
+%endif
+    pmulld              m0, m7
+    paddd               m0, m6
+    pslld               m0, xm15
+
+    movd               xm1, xd
+    vpbroadcastd        m1, xm1
+    paddd               m1, m8                  ; x
+    psubd               m2, m9, m1
+    pmulld              m2, m5
+    paddd               m1, [pd_1]
+    pmulld              m1, m11
+    paddd               m1, m2
+    pslld               m1, xm14
+
+    paddd               m0, m1
+    paddd               m0, m12
+    psrld               m0, xm13
+    packusdw            m0, m0
+    vpermq              m0, m0, q3120
+
+    cmp                 wd, 4
+    jl .store2
+    je .store4
+    STORE_PIXELS      dstq + xq * PS, 0, 8, %1
+    add                 xd, 8
+    cmp                 xd, wd
+    jl .col
+    jmp .next
+.store4:
+    STORE_PIXELS      dstq, 0, 4, %1
+    jmp .next
+.store2:
+    STORE_PIXELS      dstq, 0, 2, %1
+.next:
+    add               dstq, strideq
+    inc                 yd
+    cmp                 yd, hd
+    jl .row
+    RET
+%endmacro
+
+; One row of the angular prediction, the 4-tap filter of the row is applied to %2 pixels
+; %1: bpc, %2: pixels, %3: byte offset register or 0
+%macro ANGULAR_PIXELS 3
+%if %1 == 8
+    %define %%ps 1
+%else
+    %define %%ps 2
+%endif
+%ifnum %3
+    %define %%src srcq
+    %define %%dst dstq
+%else
+    %define %%src srcq + %3
+    %define %%dst dstq + %3
+%endif
+    LOAD_PIXELS          0, %%src,            %2, %1
+    LOAD_PIXELS          1, %%src + %%ps,     %2, %1
+    LOAD_PIXELS          2, %%src + 2 * %%ps, %2, %1
+    LOAD_PIXELS          3, %%src + 3 * %%ps, %2, %1
+    punpcklwd           m4, m0, m1
+    punpckhwd           m0, m1
+    punpcklwd           m5, m2, m3
+    punpckhwd           m2, m3
+    pmaddwd             m4, m6
+    pmaddwd             m0, m6
+    pmaddwd             m5, m7
+    pmaddwd             m2, m7
+    paddd               m4, m5
+    paddd               m0, m2
+    paddd               m4, m9
+    paddd               m0, m9
+    psrad               m4, 6
+    psrad               m0, 6
+    packssdw            m4, m0
+    CLIPW               m4, m10, m11
+    STORE_PIXELS     %%dst, 4, %2, %1
+%endmacro
+
+; %1: bpc, %2: pixels per row (16 for all the rows of 16 pixels or more)
+%macro ANGULAR_ROWS 2
+.w%2:
+    movsxd            offq, dword [offsetsq]
+%if %1 == 8
+    lea               srcq, [refq + offq]
+%else
+    lea               srcq, [refq + offq * 2]
+%endif
+    vpbroadcastd        m6, [filtersq]
+    vpbroadcastd        m7, [filtersq + 4]
+%if %2 == 16
+    xor                 xq, xq
+.w16_col:
+    ANGULAR_PIXELS      %1, 16, xq
+    add                 xq, 16 * (%1 / 8)
+    cmp                 xq, wq
+    jl .w16_col
+%else
+    ANGULAR_PIXELS      %1, %2, 0
+%endif
+    add           offsetsq, 4
+    add           filtersq, 8
+    add               dstq, strideq
+    dec                 hd
+    jg .w%2
+    RET
+%endmacro
+
+; Each row is a 4-tap filter of the reference at the offset of the row,
+;     dst[y * stride + x] = clip((sum(filters[y * 4 + k] * ref[offsets[y] + x + k], k < 4) + 32) >> 6)
+; The integer and chroma positions use filters that give the same result as the C code.
+;void ff_vvc_intra_pred_angular_%1bpc_avx2(uint8_t *dst, ptrdiff_t stride, const uint8_t *ref,
+;    const int32_t *offsets, const int16_t *filters, intptr_t w, intptr_t h, intptr_t pixel_max);
+%macro PRED_ANGULAR 1
+cglobal vvc_intra_pred_angular_%1bpc, 8, 12, 12, dst, stride, ref, offsets, filters, w, h, max, off, x, src, tmp
+    pxor               m10, m10
+    vpbroadcastw       m11, maxm
+    vpbroadcastd        m9, [pd_32]
+    cmp                 wd, 8
+    jg .wide
+    je .w8
+    cmp                 wd, 4
+    je .w4
+    jmp .w2
+.wide:
+%if %1 > 8
+    add                 wd, wd
+%endif
+    ANGULAR_ROWS        %1, 16
+    ANGULAR_ROWS        %1, 8
+    ANGULAR_ROWS        %1, 4
+    ANGULAR_ROWS        %1, 2
+%endmacro
+
+; %1: bpc, %2: pixels
+%macro PDPC_ROWS 2
+.w%2:
+    pcmpeqd             m2, m2
+%if %1 == 8
+    vpgatherdd          m0, [refq + m12], m2
+%else
+    vpgatherdd          m0, [refq + m12 * 2], m2
+%endif
+    pcmpeqd             m2, m2
+%if %1 == 8
+    vpgatherdd          m1, [refq + m13], m2
+%else
+    vpgatherdd          m1, [refq + m13 * 2], m2
+%endif
+    pand                m0, m9
+    pand                m1, m9
+    packusdw            m0, m1
+    vpermq              m0, m0, q3120           ; reference samples of the row
+
+    LOAD_PIXELS          3, dstq, %2, %1
+    psubw               m0, m3
+    punpcklwd           m1, m0, m8
+    punpckhwd           m0, m8
+    pmaddwd             m1, m14
+    pmaddwd             m0, m15
+    psrad               m1, 6
+    psrad               m0, 6
+    packssdw            m1, m0
+    paddw               m1, m3
+    CLIPW               m1, m10, m11
+    STORE_PIXELS      dstq, 1, %2, %1
+
+%if %1 == 8
+    inc               refq
+%else
+    add               refq, 2
+%endif
+    add               dstq, strideq
+    dec                 hd
+    jg .w%2
+    RET
+%endmacro
+
+; The pdpc of the angular modes on the first 16 pixels of each row,
+;     dst[x] += ((ref[y + offsets[x]] - dst[x]) * weights[x] + 32) >> 6
+; The references are gathered, the unused offsets and weights are 0.
+;void ff_vvc_intra_pdpc_%1bpc_avx2(uint8_t *dst, ptrdiff_t stride, const uint8_t *ref,
+;    const int32_t *offsets, const int16_t *weights, intptr_t w, intptr_t h, intptr_t pixel_max);
+%macro PDPC 1
+cglobal vvc_intra_pdpc_%1bpc, 8, 9, 16, dst, stride, ref, offsets, weights, w, h, max, tmp
+    movu               m12, [offsetsq]
+    movu               m13, [offsetsq + 32]
+    movu                m0, [weightsq]
+    vpbroadcastd        m1, [pw_32]
+    punpcklwd          m14, m0, m1
+    punpckhwd          m15, m0, m1              ; weight, 32
+    mova                m8, [pw_1]
+    pcmpeqd             m9, m9
+    psrld               m9, 32 - %1             ; pixel mask
+    pxor               m10, m10
+    vpbroadcastw       m11, maxm
+
+    cmp                 wd, 8
+    jg .w16
+    je .w8
+    cmp                 wd, 4
+    je .w4
+    jmp .w2
+    PDPC_ROWS           %1, 16
+    PDPC_ROWS           %1, 8
+    PDPC_ROWS           %1, 4
+    PDPC_ROWS           %1, 2
+%endmacro
+
+
+; The reduced prediction of the matrix based intra prediction, 8 outputs at a time. The matrix is
+; widened to words and interleaved as the pairs of inputs of 8 outputs, so each pairs of inputs needs
+; one pmaddwd.
+;void ff_vvc_mip_matrix_mul_avx2(int16_t *dst, const int16_t *reduced, const int16_t *matrix, intptr_t groups,
+;    intptr_t pairs, intptr_t ow, intptr_t temp0, intptr_t pixel_max);
+%macro MIP_MATRIX_MUL 0
+cglobal vvc_mip_matrix_mul, 8, 8, 12, dst, reduced, matrix, groups, pairs, ow, temp0, max
+    vpbroadcastd        m4, [reducedq]
+    vpbroadcastd        m5, [reducedq + 4]
+    vpbroadcastd        m6, [reducedq + 8]
+    vpbroadcastd        m7, [reducedq + 12]
+    movd               xm8, owd
+    vpbroadcastd        m8, xm8
+    movd               xm9, temp0d
+    vpbroadcastd        m9, xm9
+    movd              xm10, maxd
+    vpbroadcastd       m10, xm10
+    pxor               m11, m11
+    shl             pairsd, 5
+.group:
+    pmaddwd             m0, m4, [matrixq]
+    pmaddwd             m1, m5, [matrixq + 32]
+    paddd               m0, m1
+    cmp             pairsd, 64
+    je .sum_done
+    pmaddwd             m1, m6, [matrixq + 64]
+    pmaddwd             m2, m7, [matrixq + 96]
+    paddd               m0, m1
+    paddd               m0, m2
+.sum_done:
+    paddd               m0, m8
+    psrad               m0, 6
+    paddd               m0, m9
+    pmaxsd              m0, m11
+    pminsd              m0, m10
+    vextracti128       xm1, m0, 1
+    packusdw           xm0, xm1
+    movu            [dstq], xm0
+    add               dstq, 16
+    add            matrixq, pairsq
+    dec            groupsd
+    jg .group
+    RET
+%endmacro
+
+; The horizontal upsampling of the rows of the reduced prediction, with the left boundary before
+; the first reduced sample. The samples before and after each output are picked with vpermd.
+; A factor of 1 only stores the reduced prediction.
+;void ff_vvc_mip_upsample_h_%1bpc_avx2(uint8_t *dst, ptrdiff_t stride, const int16_t *pred, const uint8_t *left,
+;    ptrdiff_t left_step, intptr_t w, intptr_t pred_size, intptr_t log2_factor);
+%macro MIP_UPSAMPLE_H 1
+cglobal vvc_mip_upsample_h_%1bpc, 8, 11, 12, dst, stride, pred, left, left_step, w, rows, log2f, x, tmp, pred_stride
+    movd              xm11, log2fd
+    pcmpeqd            m10, m10
+    pslld              m10, xm11                ; ~(factor - 1)
+    vpbroadcastd        m7, [pd_1]
+    pslld               m9, m7, xm11
+    psrld               m9, 1                   ; factor / 2
+    mova                m8, [pd_0_7]
+    mova                m6, [pd_mip_before]
+    lea       pred_strideq, [rowsq * 2]
+.row:
+    pmovzxwd            m0, [predq]             ; after
+%if %1 == 8
+    movzx             tmpd, byte [leftq]
+%else
+    movzx             tmpd, word [leftq]
+%endif
+    movd               xm1, tmpd
+    vpbroadcastd        m1, xm1
+    vpermd              m2, m6, m0
+    vpblendd            m2, m2, m1, 0x01        ; before
+
+    xor                 xd, xd
+.col:
+    movd               xm3, xd
+    vpbroadcastd        m3, xm3
+    paddd               m3, m8
+    psrld               m4, m3, xm11            ; index of the reduced sample
+    pandn               m5, m10, m3
+    paddd               m5, m7                  ; k
+    vpermd              m3, m4, m2
+    vpermd              m4, m4, m0
+    psubd               m4, m3
+    pmulld              m4, m5
+    pslld               m3, xm11
+    paddd               m3, m4
+    paddd               m3, m9
+    psrld               m3, xm11
+    vextracti128       xm4, m3, 1
+    packusdw           xm3, xm4
+    cmp                 wd, 4
+    je .store4
+%if %1 == 8
+    STORE_PIXELS      dstq + xq, 3, 8, %1
+%else
+    STORE_PIXELS      dstq + xq * 2, 3, 8, %1
+%endif
+    add                 xd, 8
+    cmp                 xd, wd
+    jl .col
+    jmp .next
+.store4:
+    STORE_PIXELS      dstq, 3, 4, %1
+.next:
+    add              predq, pred_strideq
+    add              leftq, left_stepq
+    add               dstq, strideq
+    dec              rowsd
+    jg .row
+    RET
+%endmacro
+
+; %1: bpc, %2: pixels per row (16 for all the rows of 16 pixels or more)
+%macro MIP_UPSAMPLE_V_ROWS 2
+.w%2:
+    mov                 kd, 1
+.w%2_k:
+    movd               xm6, kd
+    vpbroadcastw        m6, xm6
+    mov               tmpd, fd
+    sub               tmpd, kd
+    movd               xm7, tmpd
+    vpbroadcastw        m7, xm7
+%if %2 == 16
+    xor                 xd, xd
+.w%2_col:
+    %if %1 == 8
+        LOAD_PIXELS      0, befq + xq, 16, %1
+        LOAD_PIXELS      1, aftq + xq, 16, %1
+    %else
+        LOAD_PIXELS      0, befq + xq * 2, 16, %1
+        LOAD_PIXELS      1, aftq + xq * 2, 16, %1
+    %endif
+%else
+    LOAD_PIXELS          0, befq, %2, %1
+    LOAD_PIXELS          1, aftq, %2, %1
+%endif
+    pmullw              m0, m7
+    pmullw              m1, m6
+    paddw               m0, m1
+    paddw               m0, m8
+    psrlw               m0, xm9
+%if %2 == 16
+    %if %1 == 8
+        STORE_PIXELS  dstq + xq, 0, 16, %1
+    %else
+        STORE_PIXELS  dstq + xq * 2, 0, 16, %1
+    %endif
+    add                 xd, 16
+    cmp                 xd, wd
+    jl .w%2_col
+%else
+    STORE_PIXELS      dstq, 0, %2, %1
+%endif
+    add               dstq, strideq
+    inc                 kd
+    cmp                 kd, fd
+    jl .w%2_k
+
+    mov               befq, aftq
+    add               dstq, strideq
+    add               aftq, fsq
+    dec              segsd
+    jg .w%2
+    RET
+%endmacro
+
+; The vertical upsampling between the rows of the horizontal one, with the top boundary before the
+; first row. The weighted sum is at most 16 * 4095 + 8, so it fits the unsigned words.
+;void ff_vvc_mip_upsample_v_%1bpc_avx2(uint8_t *dst, ptrdiff_t stride, const uint8_t *top, intptr_t w,
+;    intptr_t pred_size, intptr_t log2_factor);
+%macro MIP_UPSAMPLE_V 1
+cglobal vvc_mip_upsample_v_%1bpc, 6, 12, 10, dst, stride, bef, w, segs, log2f, aft, k, x, tmp, f, fs
+    movd               xm9, log2fd
+    xor                 fd, fd
+    bts                 fd, log2fd
+    mov               tmpd, fd
+    shr               tmpd, 1
+    movd               xm8, tmpd
+    vpbroadcastw        m8, xm8                 ; factor / 2
+    mov                fsq, fq
+    imul               fsq, strideq
+    lea               aftq, [dstq + fsq]
+    sub               aftq, strideq
+    cmp                 wd, 8
+    jg .w16
+    je .w8
+    MIP_UPSAMPLE_V_ROWS %1, 4
+    MIP_UPSAMPLE_V_ROWS %1, 8
+    MIP_UPSAMPLE_V_ROWS %1, 16
+%endmacro
+
+; The even and odd samples of %4 luma pixels at %3 as dwords in m%1 and m%2
+%macro CCLM_EVEN_ODD 4
+    LOAD_PIXELS         %2, %3, %4, BPC
+    pand               m%1, m%2, m15
+    psrld              m%2, 16
+%endmacro
+
+; The samples left of the odd ones in m%1, with the last odd sample of the previous chunk in m12
+%macro CCLM_LEFT 2
+    vpermd              m%1, m13, m%2
+    vpblendd            m%1, m%1, m12, 0x01
+    vpermd              m12, m13, m%2
+%endmacro
+
+; %1: type (422, 420 or 420_collocated), %2: outputs per chunk (8 for all the rows of 8 or more)
+%macro CCLM_DOWNSAMPLE_ROWS 2
+.w%2:
+%if %2 == 8
+    %define %%x xq
+%else
+    %define %%x 0
+%endif
+    movzx             tmpd, PIXEL [srcq + leftq]
+%ifidn %1, 420
+    movzx            tmp2d, PIXEL [srcq + strideq + leftq]
+    add               tmpd, tmp2d
+%endif
+    movd              xm12, tmpd
+    vpbroadcastd       m12, xm12
+%if %2 == 8
+    xor                 xd, xd
+.w%2_col:
+%endif
+    CCLM_EVEN_ODD        0, 1, srcq + %%x * 2 * PS, 2 * %2
+%ifidn %1, 422
+    CCLM_LEFT            2, 1
+    paddd               m0, m0
+    paddd               m0, m1
+    paddd               m0, m2
+    paddd               m0, m14
+    psrld               m0, 2
+%elifidn %1, 420
+    CCLM_EVEN_ODD        2, 3, srcq + strideq + %%x * 2 * PS, 2 * %2
+    paddd               m0, m2
+    paddd               m1, m3
+    CCLM_LEFT            2, 1
+    paddd               m0, m0
+    paddd               m0, m1
+    paddd               m0, m2
+    paddd               m0, m14
+    psrld               m0, 3
+%else
+    CCLM_EVEN_ODD        2, 3, srcq + strideq + %%x * 2 * PS, 2 * %2
+    CCLM_EVEN_ODD        4, 5, topq + %%x * 2 * PS, 2 * %2
+    CCLM_LEFT            3, 1
+    pslld               m0, 2
+    paddd               m0, m1
+    paddd               m0, m2
+    paddd               m0, m3
+    paddd               m0, m4
+    paddd               m0, m14
+    psrld               m0, 3
+%endif
+    packusdw            m0, m0
+    vpermq              m0, m0, q3120
+    STORE_PIXELS      dsyq + %%x * PS, 0, %2, BPC
+%if %2 == 8
+    add                 xd, 8
+    cmp                 xd, wd
+    jl .w%2_col
+%endif
+%ifidn %1, 422
+    add               srcq, strideq
+%else
+    lea               srcq, [srcq + strideq * 2]
+    %ifidn %1, 420_collocated
+        mov           topq, srcq
+        sub           topq, strideq
+    %endif
+%endif
+    add               dsyq, wdsyq
+    dec                 hd
+    jg .w%2
+    RET
+%endmacro
+
+; The luma downsampling of the cross-component linear model prediction. left is the offset of the
+; first left sample (0 if not available), top the one of the first top row for the collocated 4:2:0.
+;void ff_vvc_cclm_downsample_%2_%1bpc_avx2(uint8_t *dsy, const uint8_t *src, ptrdiff_t stride,
+;    intptr_t w, intptr_t h, intptr_t left, intptr_t top);
+%macro CCLM_DOWNSAMPLE 2
+%if %1 == 8
+    %define BPC 8
+    %define PS 1
+    %define PIXEL byte
+%else
+    %define BPC 16
+    %define PS 2
+    %define PIXEL word
+%endif
+cglobal vvc_cclm_downsample_%2_%1bpc, 7, 11, 16, dsy, src, stride, w, h, left, top, x, tmp, tmp2, wdsy
+%ifidn %2, 420_collocated
+    add               topq, srcq
+%endif
+    lea              wdsyq, [wq * PS]
+    mova               m15, [pd_65535]
+    mova               m13, [pd_cclm_left]
+    vpbroadcastd       m14, [pd_1]
+%ifidn %2, 422
+    pslld              m14, 1
+%else
+    pslld              m14, 2
+%endif
+    cmp                 wd, 4
+    jg .w8
+    je .w4
+    CCLM_DOWNSAMPLE_ROWS %2, 2
+    CCLM_DOWNSAMPLE_ROWS %2, 4
+    CCLM_DOWNSAMPLE_ROWS %2, 8
+%endmacro
+
+; %1: bpc, %2: pixels per chunk (8 for all the rows of 8 or more)
+%macro CCLM_LINEAR_ROWS 2
+.w%2:
+    xor                 xd, xd
+.w%2_col:
+%if %1 == 8
+    %if %2 == 8
+        pmovzxbd        m0, [dsyq + xq]
+    %elif %2 == 4
+        pmovzxbd       xm0, [dsyq + xq]
+    %else
+        movzx         tmpd, word [dsyq + xq]
+        movd           xm0, tmpd
+        pmovzxbd       xm0, xm0
+    %endif
+%else
+    %if %2 == 8
+        pmovzxwd        m0, [dsyq + xq * 2]
+    %elif %2 == 4
+        pmovzxwd       xm0, [dsyq + xq * 2]
+    %else
+        movd           xm0, [dsyq + xq * 2]
+        pmovzxwd       xm0, xm0
+    %endif
+%endif
+    pmulld              m0, m4
+    psrad               m0, xm5
+    paddd               m0, m6
+    packusdw            m0, m0
+    vpermq              m0, m0, q3120
+    pminuw              m0, m7
+%if %1 > 8
+    STORE_PIXELS      dstq + xq * 2, 0, %2, %1
+%else
+    STORE_PIXELS      dstq + xq, 0, %2, %1
+%endif
+    add                 xd, %2
+    cmp                 xd, wd
+    jl .w%2_col
+%if %1 == 8
+    add               dsyq, wq
+%else
+    lea               dsyq, [dsyq + wq * 2]
+%endif
+    add               dstq, strideq
+    dec                 hd
+    jg .w%2
+    RET
+%endmacro
+
+;void ff_vvc_cclm_linear_pred_%1bpc_avx2(uint8_t *dst, ptrdiff_t stride, const uint8_t *dsy,
+;    intptr_t w, intptr_t h, intptr_t a, intptr_t b, intptr_t k, intptr_t pixel_max);
+%macro CCLM_LINEAR_PRED 1
+cglobal vvc_cclm_linear_pred_%1bpc, 9, 11, 8, dst, stride, dsy, w, h, a, b, k, max, x, tmp
+    movd               xm4, ad
+    vpbroadcastd        m4, xm4
+    movd               xm5, kd
+    movd               xm6, bd
+    vpbroadcastd        m6, xm6
+    vpbroadcastw        m7, maxm
+    cmp                 wd, 4
+    jg .w8
+    je .w4
+    CCLM_LINEAR_ROWS    %1, 2
+    CCLM_LINEAR_ROWS    %1, 4
+    CCLM_LINEAR_ROWS    %1, 8
+%endmacro
+
+%if ARCH_X86_64
+%if HAVE_AVX2_EXTERNAL
+
+INIT_YMM avx2
+
+PRED_V       8
+PRED_V      16
+PRED_H       8
+PRED_H      16
+PRED_DC      8
+PRED_DC     16
+PRED_PLANAR  8
+PRED_PLANAR 16
+PRED_ANGULAR 8
+PRED_ANGULAR 16
+PDPC         8
+PDPC        16
+
+MIP_MATRIX_MUL
+MIP_UPSAMPLE_H 8
+MIP_UPSAMPLE_H 16
+MIP_UPSAMPLE_V 8
+MIP_UPSAMPLE_V 16
+
+CCLM_DOWNSAMPLE  8, 422
+CCLM_DOWNSAMPLE 16, 422
+CCLM_DOWNSAMPLE  8, 420
+CCLM_DOWNSAMPLE 16, 420
+CCLM_DOWNSAMPLE  8, 420_collocated
+CCLM_DOWNSAMPLE 16, 420_collocated
+CCLM_LINEAR_PRED 8
+CCLM_LINEAR_PRED 16
+
+%endif
+%endif
@@ -0,0 +1,269 @@
+; /*
+; * Provide SIMD inverse transform functions for VVC decoding
+; *
+; * This file is part of FFmpeg.
+; *
+; * FFmpeg is free software; you can redistribute it and/or
+; * modify it under the terms of the GNU Lesser General Public
+; * License as published by the Free Software Foundation; either
+; * version 2.1 of the License, or (at your option) any later version.
+; *
+; * FFmpeg is distributed in the hope that it will be useful,
+; * but WITHOUT ANY WARRANTY; without even the implied warranty of
+; * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+; * Lesser General Public License for more details.
+; *
+; * You should have received a copy of the GNU Lesser General Public
+; * License along with FFmpeg; if not, write to the Free Software
+; * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+; */
+
+%include "libavutil/x86/x86util.asm"
+
+SECTION .text
+
+; One 1-D pass of the inverse transform as a matrix multiplication,
+;     dst[l * dst_stride + i] = clip((sum(src[j * src_stride + l] * matrix[j * size + i], j < nz) + rnd) >> shift)
+; Each input is broadcast and multiplied with one matrix row, so the outputs of a line are
+; contiguous both for the vertical pass, which writes the block transposed, and the horizontal
+; pass. Only the first nz inputs are read, the rest are known to be zero. The lfnst is the same
+; product on a single line.
+
+; %1: number of ymm accumulators, 8 outputs each
+%macro ITX_PASS 1
+.line%1:
+    xor               offq, offq
+.group%1:
+    mov              srcpq, srcq
+    lea              matpq, [matq + offq]
+    mov                 jq, nzq
+%assign %%i 0
+%rep %1
+    pxor             m %+ %%i, m %+ %%i
+%assign %%i %%i+1
+%endrep
+.tap%1:
+    vpbroadcastd       m10, [srcpq]
+%assign %%i 0
+%rep %1
+    pmovsxbd            m4, [matpq + 8 * %%i]
+    pmulld              m4, m10
+    paddd            m %+ %%i, m4
+%assign %%i %%i+1
+%endrep
+    add              srcpq, sstrideq
+    add              matpq, sizeq
+    dec                 jq
+    jg .tap%1
+
+%assign %%i 0
+%rep %1
+    paddd            m %+ %%i, m7
+    psrad            m %+ %%i, xm6
+    pminsd           m %+ %%i, m8
+    pmaxsd           m %+ %%i, m9
+    movu [dstq + offq * 4 + 32 * %%i], m %+ %%i
+%assign %%i %%i+1
+%endrep
+    add               offq, 8 * %1
+    cmp               offq, sizeq
+    jl .group%1
+
+    add               srcq, 4
+    add               dstq, dstrideq
+    dec             linesq
+    jg .line%1
+    RET
+%endmacro
+
+%if ARCH_X86_64
+%if HAVE_AVX2_EXTERNAL
+
+INIT_YMM avx2
+
+; void ff_vvc_itx_pass_avx2(int *dst, const int *src, const int8_t *matrix, intptr_t size, intptr_t nz,
+;     intptr_t lines, intptr_t src_stride, intptr_t dst_stride, intptr_t shift, intptr_t max);
+cglobal vvc_itx_pass, 10, 14, 11, dst, src, mat, size, nz, lines, sstride, dstride, shift, max, j, srcp, matp, off
+    shl           sstrideq, 2
+    shl           dstrideq, 2
+
+    dec             shiftd
+    movd               xm6, shiftd
+    pcmpeqd             m7, m7
+    psrld               m7, 31
+    pslld               m7, xm6                 ; 1 << (shift - 1)
+    inc             shiftd
+    movd               xm6, shiftd
+
+    movd               xm8, maxd
+    vpbroadcastd        m8, xm8
+    pcmpeqd             m9, m9
+    pxor                m9, m8                  ; -max - 1
+
+    cmp              sizeq, 16
+    jl .size8
+    je .size16
+    test             sized, 31
+    jnz .size16                                 ; 48 outputs of the 8x8 lfnst
+    ITX_PASS 4
+.size16:
+    ITX_PASS 2
+.size8:
+    ITX_PASS 1
+
+
+; Vertical BDPCM, each row is the clipped sum of itself and the row above. The columns of a row
+; are done together, the rows one after the other in the accumulators.
+; %1: width, %2: number of accumulators, %3: register prefix, %4: load/store instruction, %5: bytes per accumulator
+%macro BDPCM_V 5
+.w%1:
+%assign %%i 0
+%rep %2
+    %4 %3 %+ %%i, [coeffsq + %%i * %5]
+%assign %%i %%i+1
+%endrep
+.v_loop%1:
+    add            coeffsq, strideq
+%assign %%i 0
+%rep %2
+    %4 %3 %+ 4, [coeffsq + %%i * %5]
+    paddd     %3 %+ %%i, %3 %+ 4
+    pminsd    %3 %+ %%i, %3 %+ 8
+    pmaxsd    %3 %+ %%i, %3 %+ 9
+    %4 [coeffsq + %%i * %5], %3 %+ %%i
+%assign %%i %%i+1
+%endrep
+    dec             heightd
+    jg .v_loop%1
+    RET
+%endmacro
+
+; Horizontal BDPCM, the clipped running sum of each row. The row is summed with shifts and
+; adds, when none of the partial sums is out of range the clipping has no effect and the
+; sums are stored, otherwise the row is redone serially with the clipping, so the output is
+; exact either way.
+; %1: width, %2: number of accumulators
+%macro BDPCM_H 2
+.w%1:
+    pxor                m6, m6
+%assign %%i 0
+%rep %2
+%if %1 == 4
+    movu               xm %+ %%i, [coeffsq]
+    pslldq             xm4, xm %+ %%i, 4
+    paddd              xm %+ %%i, xm4
+    pslldq             xm4, xm %+ %%i, 8
+    paddd              xm %+ %%i, xm4
+%else
+    movu            m %+ %%i, [coeffsq + %%i * 32]
+    pslldq              m4, m %+ %%i, 4
+    paddd           m %+ %%i, m4
+    pslldq              m4, m %+ %%i, 8
+    paddd           m %+ %%i, m4
+    pshufd              m4, m %+ %%i, q3333
+    vperm2i128          m4, m4, m4, 0x08        ; the sum of the low lane added to the high one
+    paddd           m %+ %%i, m4
+%if %%i
+    vpermq              m4, m %+ %%j, q3333
+    pshufd              m4, m4, q3333           ; the sum of the previous accumulators
+    paddd           m %+ %%i, m4
+%endif
+%endif
+    pcmpgtd             m4, m %+ %%i, m8
+    por                 m6, m4
+    pcmpgtd             m4, m9, m %+ %%i
+    por                 m6, m4
+%assign %%j %%i
+%assign %%i %%i+1
+%endrep
+    ptest               m6, m6
+    jnz .h_serial%1
+%assign %%i 0
+%rep %2
+%if %1 == 4
+    movu         [coeffsq], xm0
+%else
+    movu [coeffsq + %%i * 32], m %+ %%i
+%endif
+%assign %%i %%i+1
+%endrep
+    jmp .h_next%1
+.h_serial%1:
+    BDPCM_H_SERIAL %1
+.h_next%1:
+    add            coeffsq, 4 * %1
+    dec             heightd
+    jg .w%1
+    RET
+%endmacro
+
+; the running sum of one row, clipped after each addition
+%macro BDPCM_H_SERIAL 1
+    mov               vald, [coeffsq]
+    mov               colq, 1
+.h_serial_loop%1:
+    add               vald, [coeffsq + colq * 4]
+    cmp               vald, maxd
+    cmovg             vald, maxd
+    cmp               vald, mind
+    cmovl             vald, mind
+    mov [coeffsq + colq * 4], vald
+    inc               colq
+    cmp               colq, widthq
+    jl .h_serial_loop%1
+%endmacro
+
+; BDPCM is only used up to the maximum transform skip size, width is 2 to 32.
+; void ff_vvc_transform_bdpcm_v_avx2(int *coeffs, intptr_t width, intptr_t height, intptr_t max);
+cglobal vvc_transform_bdpcm_v, 4, 5, 10, coeffs, width, height, max, stride
+    lea            strideq, [widthq * 4]
+    movd               xm8, maxd
+    vpbroadcastd        m8, xm8
+    pcmpeqd             m9, m9
+    pxor                m9, m8                  ; -max - 1
+    dec             heightd
+
+    cmp             widthd, 8
+    jl .w_small
+    je .w8
+    cmp             widthd, 16
+    je .w16
+    BDPCM_V 32, 4, m, movu, 32
+    BDPCM_V 16, 2, m, movu, 32
+    BDPCM_V  8, 1, m, movu, 32
+.w_small:
+    cmp             widthd, 4
+    jl .w2
+    BDPCM_V  4, 1, xm, movu, 16
+    BDPCM_V  2, 1, xm, movq, 8
+
+; void ff_vvc_transform_bdpcm_h_avx2(int *coeffs, intptr_t width, intptr_t height, intptr_t max);
+cglobal vvc_transform_bdpcm_h, 4, 7, 10, coeffs, width, height, max, min, col, val
+    mov               mind, maxd
+    not               mind
+    movd               xm8, maxd
+    vpbroadcastd        m8, xm8
+    pcmpeqd             m9, m9
+    pxor                m9, m8                  ; -max - 1
+
+    cmp             widthd, 8
+    jl .w_small
+    je .w8
+    cmp             widthd, 16
+    je .w16
+    BDPCM_H 32, 4
+    BDPCM_H 16, 2
+    BDPCM_H  8, 1
+.w_small:
+    cmp             widthd, 4
+    jl .w2
+    BDPCM_H  4, 1
+.w2:
+    BDPCM_H_SERIAL 2
+    add            coeffsq, 4 * 2
+    dec             heightd
+    jg .w2
+    RET
+
+%endif
+%endif
@@ -0,0 +1,143 @@
+; /*
+; * Provide SIMD luma mapping with chroma scaling functions for VVC decoding
+; *
+; * This file is part of FFmpeg.
+; *
+; * FFmpeg is free software; you can redistribute it and/or
+; * modify it under the terms of the GNU Lesser General Public
+; * License as published by the Free Software Foundation; either
+; * version 2.1 of the License, or (at your option) any later version.
+; *
+; * FFmpeg is distributed in the hope that it will be useful,
+; * but WITHOUT ANY WARRANTY; without even the implied warranty of
+; * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+; * Lesser General Public License for more details.
+; *
+; * You should have received a copy of the GNU Lesser General Public
+; * License along with FFmpeg; if not, write to the Free Software
+; * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+; */
+
+%include "libavutil/x86/x86util.asm"
+
+SECTION_RODATA 32
+
+cextern pd_1
+cextern pd_65535
+
+SECTION .text
+
+; Maps %2 pixels at dstq + xq through the lut, the gathers read a dword at each lut entry.
+; %1: register prefix (m or xm), %2: pixels (8 or 4), %3: bpc
+%macro LMCS_LUT 3
+%if %3 == 8
+    pmovzxbd        %1 %+ 0, [dstq + xq]
+    pcmpeqd         %1 %+ 2, %1 %+ 2
+    vpgatherdd      %1 %+ 1, [lutq + %1 %+ 0], %1 %+ 2
+    pslld           %1 %+ 1, 24
+    psrld           %1 %+ 1, 24
+%else
+    pmovzxwd        %1 %+ 0, [dstq + xq * 2]
+    pcmpeqd         %1 %+ 2, %1 %+ 2
+    vpgatherdd      %1 %+ 1, [lutq + %1 %+ 0 * 2], %1 %+ 2
+    pand            %1 %+ 1, %1 %+ 3
+%endif
+    packusdw        %1 %+ 1, %1 %+ 1
+%if %2 == 8
+    vpermq               m1, m1, q3120
+%endif
+%if %3 == 8
+    packuswb            xm1, xm1
+    %if %2 == 8
+        movq  [dstq + xq], xm1
+    %else
+        movd  [dstq + xq], xm1
+    %endif
+%else
+    %if %2 == 8
+        movu  [dstq + xq * 2], xm1
+    %else
+        movq  [dstq + xq * 2], xm1
+    %endif
+%endif
+%endmacro
+
+;void ff_vvc_lmcs_filter_%1bpc_avx2(uint8_t *dst, ptrdiff_t dst_stride, int width, int height, const void *lut);
+%macro LMCS_FILTER 1
+cglobal vvc_lmcs_filter_%1bpc, 5, 7, 4, dst, stride, w, h, lut, x, tmp
+%if %1 > 8
+    mova                m3, [pd_65535]
+%endif
+.row:
+    xor                 xd, xd
+    cmp                 wd, 8
+    jl .w4
+.w8:
+    LMCS_LUT             m, 8, %1
+    add                 xd, 8
+    lea               tmpd, [xq + 8]
+    cmp               tmpd, wd
+    jle .w8
+    cmp                 xd, wd
+    je .next
+.w4:
+    LMCS_LUT            xm, 4, %1
+.next:
+    add               dstq, strideq
+    dec                 hd
+    jg .row
+    RET
+%endmacro
+
+; %1: register prefix (m or xm)
+%macro LMCS_SCALE 1
+    movu            %1 %+ 0, [coeffq]
+    pminsd          %1 %+ 0, %1 %+ 5
+    pmaxsd          %1 %+ 0, %1 %+ 6
+    pabsd           %1 %+ 1, %1 %+ 0
+    pmulld          %1 %+ 1, %1 %+ 4
+    paddd           %1 %+ 1, %1 %+ 7
+    psrld           %1 %+ 1, 11
+    psignd          %1 %+ 1, %1 %+ 0
+    movu            [dstq], %1 %+ 1
+%endmacro
+
+; The residuals are clipped to [-max - 1, max] and scaled with the sign and magnitude rounding
+;void ff_vvc_lmcs_scale_chroma_residual_avx2(int *dst, const int *coeff, intptr_t size,
+;    intptr_t chroma_scale, intptr_t max);
+%macro LMCS_SCALE_CHROMA_RESIDUAL 0
+cglobal vvc_lmcs_scale_chroma_residual, 5, 5, 8, dst, coeff, size, scale, max
+    movd               xm4, scaled
+    vpbroadcastd        m4, xm4
+    movd               xm5, maxd
+    vpbroadcastd        m5, xm5
+    pcmpeqd             m6, m6
+    pxor                m6, m5
+    vpbroadcastd        m7, [pd_1]
+    pslld               m7, 10
+    sub              sized, 8
+    jl .w4
+.w8:
+    LMCS_SCALE           m
+    add               dstq, 32
+    add             coeffq, 32
+    sub              sized, 8
+    jge .w8
+.w4:
+    add              sized, 8
+    jz .end
+    LMCS_SCALE          xm
+.end:
+    RET
+%endmacro
+
+%if ARCH_X86_64
+%if HAVE_AVX2_EXTERNAL
+
+INIT_YMM avx2
+LMCS_FILTER 8
+LMCS_FILTER 16
+LMCS_SCALE_CHROMA_RESIDUAL
+
+%endif
+%endif
@@ -41,6 +41,8 @@ pw_4    times 2 dw   4
 pw_12   times 2 dw  12
 pw_256  times 2 dw 256
 
+pb_scaled_shuf  db 0, 1, 4, 5, 8, 9, 12, 13, -1, -1, -1, -1, -1, -1, -1, -1
+
 %macro AVG_JMP_TABLE 3-*
     %xdefine %1_%2_%3_table (%%table - 2*%4)
     %xdefine %%base %1_%2_%3_table
@@ -297,6 +299,136 @@ VVC_AVG_AVX2 8
 VVC_W_AVG_AVX2 16
 
 VVC_W_AVG_AVX2 8
+
+; The filter of the scaled MC changes with every output column, so each call runs one filter
+; phase down a column of the source,
+;     dst[j] = (sum(filter[k] * src[j * src_stride + k], k < taps)) >> shift
+; Lines k and k + 4 share a register, so the sums of 8 lines end up in order after the
+; horizontal adds. Only the taps of a line are loaded and the tail is done line by line.
+
+; %1: register index, %2: first line, %3: line + 4, %4: bpc, %5: taps
+%macro SCALED_LOAD2 5
+%if %4 == 8
+    %if %5 == 8
+        movq        xm %+ %1, [%2]
+        movhps      xm %+ %1, [%3]
+    %else
+        movd        xm %+ %1, [%2]
+        pinsrd      xm %+ %1, [%3], 2
+    %endif
+        pmovzxbw     m %+ %1, xm %+ %1
+%else
+    %if %5 == 8
+        movu        xm %+ %1, [%2]
+        vinserti128  m %+ %1, m %+ %1, [%3], 1
+    %else
+        movq        xm %+ %1, [%2]
+        movq              xm4, [%3]
+        vinserti128  m %+ %1, m %+ %1, xm4, 1
+    %endif
+%endif
+%endmacro
+
+; %1: bpc, %2: taps
+%macro SCALED_LOAD1 2
+%if %1 == 8
+    %if %2 == 8
+        pmovzxbw          xm0, [srcq]
+    %else
+        movd              xm0, [srcq]
+        pmovzxbw          xm0, xm0
+    %endif
+%else
+    %if %2 == 8
+        movu              xm0, [srcq]
+    %else
+        movq              xm0, [srcq]
+    %endif
+%endif
+%endmacro
+
+; %1: bpc, %2: taps, %3: saturate
+%macro SCALED_FILTER_LINES 3
+.taps%2:
+    cmp             linesd, 8
+    jl .tail%2
+.loop%2:
+    lea               s4q, [srcq + 4 * strideq]
+    SCALED_LOAD2        0, srcq,                 s4q,                 %1, %2
+    SCALED_LOAD2        1, srcq + strideq,       s4q + strideq,       %1, %2
+    SCALED_LOAD2        2, srcq + 2 * strideq,   s4q + 2 * strideq,   %1, %2
+    SCALED_LOAD2        3, srcq + stride3q,      s4q + stride3q,      %1, %2
+    pmaddwd            m0, m8
+    pmaddwd            m1, m8
+    pmaddwd            m2, m8
+    pmaddwd            m3, m8
+    phaddd             m0, m1
+    phaddd             m2, m3
+    phaddd             m0, m2                   ; lines 0-3 | lines 4-7
+    psrad              m0, xm9
+%if %3
+    packssdw           m0, m0
+%else
+    pshufb             m0, m10
+%endif
+    vpermq             m0, m0, q3120
+    movu           [dstq], xm0
+
+    lea              srcq, [s4q + 4 * strideq]
+    add              dstq, 16
+    sub            linesd, 8
+    cmp            linesd, 8
+    jge .loop%2
+
+.tail%2:
+    test           linesd, linesd
+    jz .end%2
+.tail_loop%2:
+    SCALED_LOAD1       %1, %2
+    pmaddwd           xm0, xm8
+    phaddd            xm0, xm0
+    phaddd            xm0, xm0
+    psrad             xm0, xm9
+%if %3
+    packssdw          xm0, xm0
+%endif
+    movd             tmpd, xm0
+    mov            [dstq], tmpw
+
+    add              srcq, strideq
+    add              dstq, 2
+    dec            linesd
+    jg .tail_loop%2
+.end%2:
+    RET
+%endmacro
+
+;void ff_vvc_scaled_filter{,_sat}_%1bpc_avx2(int16_t *dst, const uint8_t *src, ptrdiff_t src_stride,
+;    intptr_t lines, const int16_t *filter, intptr_t taps, intptr_t shift);
+; filter has 8 coefficients, zero padded for the 4-tap filters. The _sat version saturates the
+; results to int16_t, the other one truncates them like a C store.
+%macro VVC_SCALED_FILTER_AVX2 2 ; bpc, saturate
+%if %2
+cglobal vvc_scaled_filter_sat_%1bpc, 7, 10, 11, dst, src, stride, lines, filter, taps, shift, s4, stride3, tmp
+%else
+cglobal vvc_scaled_filter_%1bpc, 7, 10, 11, dst, src, stride, lines, filter, taps, shift, s4, stride3, tmp
+%endif
+    vbroadcasti128     m8, [filterq]
+    movd              xm9, shiftd
+%if %2 == 0
+    vbroadcasti128    m10, [pb_scaled_shuf]
+%endif
+    lea           stride3q, [strideq * 3]
+
+    cmp             tapsd, 4
+    je .taps4
+    SCALED_FILTER_LINES %1, 8, %2
+    SCALED_FILTER_LINES %1, 4, %2
+%endmacro
+
+VVC_SCALED_FILTER_AVX2  8, 0
+VVC_SCALED_FILTER_AVX2 16, 0
+VVC_SCALED_FILTER_AVX2 16, 1
 %endif
 
 %endif
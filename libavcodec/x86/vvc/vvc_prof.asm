@@ -0,0 +1,195 @@
+; /*
+; * Provide SIMD prediction refinement with optical flow functions for VVC decoding
+; *
+; * This file is part of FFmpeg.
+; *
+; * FFmpeg is free software; you can redistribute it and/or
+; * modify it under the terms of the GNU Lesser General Public
+; * License as published by the Free Software Foundation; either
+; * version 2.1 of the License, or (at your option) any later version.
+; *
+; * FFmpeg is distributed in the hope that it will be useful,
+; * but WITHOUT ANY WARRANTY; without even the implied warranty of
+; * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+; * Lesser General Public License for more details.
+; *
+; * You should have received a copy of the GNU Lesser General Public
+; * License along with FFmpeg; if not, write to the Free Software
+; * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+; */
+
+%include "libavutil/x86/x86util.asm"
+
+%define MAX_PB_SIZE 128
+%define SRC_STRIDE  (MAX_PB_SIZE * 2)
+
+SECTION_RODATA
+
+pd_8191:      times 1 dd 8191
+pd_m8192:     times 1 dd -8192
+
+SECTION .text
+
+; The whole 4x4 block fits in one register, rows 0 and 1 in the low lane and rows 2 and 3
+; in the high lane.
+
+; LOAD_4x4(dst, tmp, src)
+%macro LOAD_4x4 3
+    movq                 xm%1, [%3]
+    movhps               xm%1, [%3 + SRC_STRIDE]
+    movq                 xm%2, [%3 + 2 * SRC_STRIDE]
+    movhps               xm%2, [%3 + 3 * SRC_STRIDE]
+    vinserti128           m%1, m%1, xm%2, 1
+%endmacro
+
+; output: m0 the source, m1, m5 the clipped refinements of the samples of
+; punpcklwd and punpckhwd
+%macro PROF_OFFSETS 0
+    vpbroadcastd           m8, [pd_8191]
+    vpbroadcastd           m9, [pd_m8192]
+
+    LOAD_4x4                1, 5, srcq + 2
+    LOAD_4x4                2, 5, srcq - 2
+    psraw                  m1, 6
+    psraw                  m2, 6
+    psubw                  m1, m2                       ; gradient_h
+    LOAD_4x4                2, 5, srcq + SRC_STRIDE
+    LOAD_4x4                3, 5, srcq - SRC_STRIDE
+    psraw                  m2, 6
+    psraw                  m3, 6
+    psubw                  m2, m3                       ; gradient_v
+
+    movu                   m3, [mvxq]
+    movu                   m4, [mvyq]
+    punpckhwd              m5, m1, m2
+    punpcklwd              m1, m2
+    punpckhwd              m2, m3, m4
+    punpcklwd              m3, m4
+    pmaddwd                m1, m3
+    pmaddwd                m5, m2
+    pminsd                 m1, m8
+    pminsd                 m5, m8
+    pmaxsd                 m1, m9
+    pmaxsd                 m5, m9
+
+    LOAD_4x4                0, 3, srcq
+%endmacro
+
+; STORE_4x4(src, bit_depth), bit_depth 0 stores the unclipped intermediate samples
+%macro STORE_4x4 2
+%if %2 == 8
+    packuswb              m%1, m%1
+    vextracti128          xm2, m%1, 1
+    movd               [dstq], xm%1
+    pextrd [dstq + dst_strideq], xm%1, 1
+    lea                  dstq, [dstq + 2 * dst_strideq]
+    movd               [dstq], xm2
+    pextrd [dstq + dst_strideq], xm2, 1
+%else
+%if %2
+    CLIPW                 m%1, m6, m7
+%endif
+    vextracti128          xm2, m%1, 1
+    movq               [dstq], xm%1
+    movhps [dstq + dst_strideq], xm%1
+    lea                  dstq, [dstq + 2 * dst_strideq]
+    movq               [dstq], xm2
+    movhps [dstq + dst_strideq], xm2
+%endif
+%endmacro
+
+; PIXEL_MAX_INIT(bit_depth, tmp): m6, m7 the clipping bounds of the 16 bit pixels
+%macro PIXEL_MAX_INIT 2
+%if %1 > 8
+    pxor                   m6, m6
+    mov                    %2, (1 << %1) - 1
+    movd                  xm7, %2
+    vpbroadcastw           m7, xm7
+%endif
+%endmacro
+
+; void ff_vvc_apply_prof_uni_%1_avx2(uint8_t *dst, ptrdiff_t dst_stride, const int16_t *src,
+;     const int16_t *diff_mv_x, const int16_t *diff_mv_y);
+%macro APPLY_PROF_UNI 1
+cglobal vvc_apply_prof_uni_%1, 5, 6, 10, dst, dst_stride, src, mvx, mvy, tmp
+    PROF_OFFSETS
+    PIXEL_MAX_INIT         %1, tmpd
+    mov                   tmpd, 1 << (13 - %1)
+    movd                  xm3, tmpd
+    vpbroadcastw           m3, xm3
+
+    ; saturation keeps the clipped result
+    packssdw               m1, m5
+    paddsw                 m0, m1
+    paddsw                 m0, m3
+    psraw                  m0, 14 - %1
+    STORE_4x4               0, %1
+    RET
+%endmacro
+
+; void ff_vvc_apply_prof_uni_w_%1_avx2(uint8_t *dst, ptrdiff_t dst_stride, const int16_t *src,
+;     const int16_t *diff_mv_x, const int16_t *diff_mv_y, int denom, int wx, int ox);
+%macro APPLY_PROF_UNI_W 1
+cglobal vvc_apply_prof_uni_w_%1, 8, 9, 14, dst, dst_stride, src, mvx, mvy, denom, wx, ox, tmp
+    PROF_OFFSETS
+    PIXEL_MAX_INIT         %1, tmpd
+
+    add                 denomd, 14 - %1 - 1
+    movd                 xm10, denomd
+    pcmpeqd               m11, m11
+    psrld                 m11, 31
+    pslld                 m11, xm10                     ; 1 << (shift - 1)
+    inc                 denomd
+    movd                 xm10, denomd                   ; shift
+    movd                 xm12, wxd
+    vpbroadcastd          m12, xm12
+%if %1 > 8
+    shl                    oxd, %1 - 8
+%endif
+    movd                 xm13, oxd
+    vpbroadcastd          m13, xm13
+
+    punpcklwd              m2, m0, m0
+    punpckhwd              m0, m0
+    psrad                  m2, 16
+    psrad                  m0, 16
+    paddd                  m1, m2
+    paddd                  m5, m0
+    pmulld                 m1, m12
+    pmulld                 m5, m12
+    paddd                  m1, m11
+    paddd                  m5, m11
+    psrad                  m1, xm10
+    psrad                  m5, xm10
+    paddd                  m1, m13
+    paddd                  m5, m13
+    packssdw               m1, m5
+    STORE_4x4               1, %1
+    RET
+%endmacro
+
+%if ARCH_X86_64
+%if HAVE_AVX2_EXTERNAL
+
+INIT_YMM avx2
+
+; void ff_vvc_apply_prof_avx2(int16_t *dst, const int16_t *src, const int16_t *diff_mv_x,
+;     const int16_t *diff_mv_y);
+cglobal vvc_apply_prof, 4, 5, 10, dst, src, mvx, mvy, dst_stride
+    PROF_OFFSETS
+    mov           dst_strideq, SRC_STRIDE
+    packssdw               m1, m5
+    paddw                  m0, m1
+    STORE_4x4               0, 0
+    RET
+
+APPLY_PROF_UNI          8
+APPLY_PROF_UNI         10
+APPLY_PROF_UNI         12
+
+APPLY_PROF_UNI_W        8
+APPLY_PROF_UNI_W       10
+APPLY_PROF_UNI_W       12
+
+%endif
+%endif
@@ -130,5 +130,84 @@ cglobal vvc_sad, 6, 9, 5, src1, src2, dx, dy, block_w, block_h, off1, off2, row_
         movd          eax, xm0
     RET
 
+
+; SAD_5x5_DX(dx, width)
+%macro SAD_5x5_DX 2
+%if %2 == 8
+    movu              xm5, [s1q + 2 * %1]
+    vinserti128        m5, m5, [s1q + 2 * %1 + MAX_PB_SIZE * ROWS * 2], 1
+    movu              xm6, [s2q - 2 * %1]
+    vinserti128        m6, m6, [s2q - 2 * %1 + MAX_PB_SIZE * ROWS * 2], 1
+%else
+    movu               m5, [s1q + 2 * %1]
+    movu               m6, [s2q - 2 * %1]
+%endif
+    MIN_MAX_SAD        m6, m5, m7
+    pmaddwd            m6, m8
+    paddd           m %+ %1, m6
+%endmacro
+
+; SAD_5x5_ROWS(width)
+%macro SAD_5x5_ROWS 1
+    .loop_height_%1:
+%assign %%dx 0
+%rep 5
+        SAD_5x5_DX   %%dx, %1
+%assign %%dx %%dx+1
+%endrep
+%if %1 == 8
+        add           s1q, 2 * MAX_PB_SIZE * ROWS * 2
+        add           s2q, 2 * MAX_PB_SIZE * ROWS * 2
+        sub          rowd, 4
+%else
+        add           s1q, MAX_PB_SIZE * ROWS * 2
+        add           s2q, MAX_PB_SIZE * ROWS * 2
+        sub          rowd, 2
+%endif
+        jg   .loop_height_%1
+%endmacro
+
+; void ff_vvc_sad_5x5_avx2(int *sad, const int16_t *src0, const int16_t *src1, int block_w, int block_h);
+; All the 25 SADs of the DMVR integer search, sad[dy * 5 + dx] = ff_vvc_sad_avx2(src0, src1, dx, dy, ...).
+; The accumulators of the 5 horizontal offsets of a row are reduced together.
+cglobal vvc_sad_5x5, 5, 9, 9, sad, src1, src2, block_w, block_h, dy, row, s1, s2
+    add             src2q, (4 * MAX_PB_SIZE + 4) * 2
+    vpbroadcastd       m8, [pw_1]
+    mov               dyd, 5
+
+    .loop_dy:
+        pxor           m0, m0
+        pxor           m1, m1
+        pxor           m2, m2
+        pxor           m3, m3
+        pxor           m4, m4
+        mov           s1q, src1q
+        mov           s2q, src2q
+        mov          rowd, block_hd
+
+        cmp      block_wd, 16
+        je   .w16
+        SAD_5x5_ROWS    8
+        jmp  .sum
+    .w16:
+        SAD_5x5_ROWS   16
+
+    .sum:
+        phaddd         m0, m1
+        phaddd         m2, m3
+        phaddd         m0, m2
+        vextracti128  xm1, m0, 1
+        paddd         xm0, xm1
+        movu       [sadq], xm0
+        HORIZ_ADD     xm1, xm4, m4
+        movd  [sadq + 16], xm1
+
+        add          sadq, 5 * 4
+        add         src1q, MAX_PB_SIZE * 2
+        sub         src2q, MAX_PB_SIZE * 2
+        dec           dyd
+        jg      .loop_dy
+    RET
+
 %endif
 %endif
@@ -0,0 +1,269 @@
+;******************************************************************************
+;* SIMD optimized SAO functions for VVC 8bit decoding
+;*
+;* Copyright (c) 2013 Pierre-Edouard LEPERE
+;* Copyright (c) 2014 James Almer
+;*
+;* This file is part of FFmpeg.
+;*
+;* FFmpeg is free software; you can redistribute it and/or
+;* modify it under the terms of the GNU Lesser General Public
+;* License as published by the Free Software Foundation; either
+;* version 2.1 of the License, or (at your option) any later version.
+;*
+;* FFmpeg is distributed in the hope that it will be useful,
+;* but WITHOUT ANY WARRANTY; without even the implied warranty of
+;* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+;* Lesser General Public License for more details.
+;*
+;* You should have received a copy of the GNU Lesser General Public
+;* License along with FFmpeg; if not, write to the Free Software
+;* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+;******************************************************************************
+
+; Ported from the HEVC SAO functions in hevc_sao.asm, for the VVC block sizes
+; up to 128 and the VVC edge filter source stride.
+
+%include "libavutil/x86/x86util.asm"
+
+SECTION_RODATA 32
+
+pb_edge_shuffle: times 2 db 1, 2, 0, 3, 4, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+pb_eo:                   db -1, 0, 1, 0, 0, -1, 0, 1, -1, -1, 1, 1, 1, -1, -1, 1
+cextern pb_1
+cextern pb_2
+
+SECTION .text
+
+;******************************************************************************
+;SAO Band Filter
+;******************************************************************************
+
+%macro VVC_SAO_BAND_FILTER_INIT 0
+    and            leftq, 31
+    movd             xm0, leftd
+    add            leftq, 1
+    and            leftq, 31
+    movd             xm1, leftd
+    add            leftq, 1
+    and            leftq, 31
+    movd             xm2, leftd
+    add            leftq, 1
+    and            leftq, 31
+    movd             xm3, leftd
+
+    SPLATW            m0, xm0
+    SPLATW            m1, xm1
+    SPLATW            m2, xm2
+    SPLATW            m3, xm3
+    SPLATW            m4, [offsetq + 2]
+    SPLATW            m5, [offsetq + 4]
+    SPLATW            m6, [offsetq + 6]
+    SPLATW            m7, [offsetq + 8]
+    pxor             m14, m14
+
+DEFINE_ARGS dst, src, dststride, srcstride, offset, height
+    mov          heightd, r7m
+%endmacro
+
+%macro VVC_SAO_BAND_FILTER_COMPUTE 2
+    psraw             %1, %2, 3
+    pcmpeqw          m10, %1, m0
+    pcmpeqw          m11, %1, m1
+    pcmpeqw          m12, %1, m2
+    pcmpeqw           %1, m3
+    pand             m10, m4
+    pand             m11, m5
+    pand             m12, m6
+    pand              %1, m7
+    por              m10, m11
+    por              m12, %1
+    por              m10, m12
+    paddw             %2, m10
+%endmacro
+
+%macro VVC_SAO_BAND_FILTER_BLOCK 1
+    movu             m13, [srcq + %1]
+    punpcklbw         m8, m13, m14
+    VVC_SAO_BAND_FILTER_COMPUTE m9,  m8
+    punpckhbw        m13, m14
+    VVC_SAO_BAND_FILTER_COMPUTE m9, m13
+    packuswb          m8, m13
+    movu      [dstq + %1], m8
+%endmacro
+
+;void ff_vvc_sao_band_filter_<width>_8_<opt>(uint8_t *_dst, const uint8_t *_src, ptrdiff_t _stride_dst, ptrdiff_t _stride_src,
+;                                            int16_t *sao_offset_val, int sao_left_class, int width, int height);
+%macro VVC_SAO_BAND_FILTER 2
+cglobal vvc_sao_band_filter_%1_8, 6, 6, 15, dst, src, dststride, srcstride, offset, left
+    VVC_SAO_BAND_FILTER_INIT
+
+align 16
+.loop:
+%if %1 == 8
+    movq              m8, [srcq]
+    punpcklbw         m8, m14
+    VVC_SAO_BAND_FILTER_COMPUTE m9, m8
+    packuswb          m8, m14
+    movq          [dstq], m8
+%endif ; %1 == 8
+
+%assign i 0
+%rep %2
+    VVC_SAO_BAND_FILTER_BLOCK i
+%assign i i+mmsize
+%endrep
+
+%if %1 > 8 && i < %1
+INIT_XMM cpuname
+    VVC_SAO_BAND_FILTER_BLOCK i
+INIT_YMM cpuname
+%endif
+
+    add             dstq, dststrideq             ; dst += dststride
+    add             srcq, srcstrideq             ; src += srcstride
+    dec          heightd                         ; cmp height
+    jnz               .loop                      ; height loop
+    RET
+%endmacro
+
+;******************************************************************************
+;SAO Edge Filter
+;******************************************************************************
+
+%define MAX_PB_SIZE  128
+%define PADDING_SIZE 64 ; AV_INPUT_BUFFER_PADDING_SIZE
+%define EDGE_SRCSTRIDE 2 * MAX_PB_SIZE + PADDING_SIZE
+
+%macro VVC_SAO_EDGE_FILTER_INIT 0
+%if WIN64
+    movsxd           eoq, dword eom
+%else
+    movsxd           eoq, eod
+%endif
+    lea            tmp2q, [pb_eo]
+    movsx      a_strideq, byte [tmp2q+eoq*4+1]
+    movsx      b_strideq, byte [tmp2q+eoq*4+3]
+    imul       a_strideq, EDGE_SRCSTRIDE
+    imul       b_strideq, EDGE_SRCSTRIDE
+    movsx           tmpq, byte [tmp2q+eoq*4]
+    add        a_strideq, tmpq
+    movsx           tmpq, byte [tmp2q+eoq*4+2]
+    add        b_strideq, tmpq
+%endmacro
+
+%macro VVC_SAO_EDGE_FILTER_COMPUTE 1
+    pminub            m4, m1, m2
+    pminub            m5, m1, m3
+    pcmpeqb           m2, m4
+    pcmpeqb           m3, m5
+    pcmpeqb           m4, m1
+    pcmpeqb           m5, m1
+    psubb             m4, m2
+    psubb             m5, m3
+    paddb             m4, m6
+    paddb             m4, m5
+
+    pshufb            m2, m0, m4
+%if %1 > 8
+    punpckhbw         m5, m7, m1
+    punpckhbw         m4, m2, m7
+    punpcklbw         m3, m7, m1
+    punpcklbw         m2, m7
+    pmaddubsw         m5, m4
+    pmaddubsw         m3, m2
+    packuswb          m3, m5
+%else
+    punpcklbw         m3, m7, m1
+    punpcklbw         m2, m7
+    pmaddubsw         m3, m2
+    packuswb          m3, m3
+%endif
+%endmacro
+
+%macro VVC_SAO_EDGE_FILTER_BLOCK 1
+    movu              m1, [srcq + %1]
+    movu              m2, [srcq + a_strideq + %1]
+    movu              m3, [srcq + b_strideq + %1]
+    VVC_SAO_EDGE_FILTER_COMPUTE 16
+    movu      [dstq + %1], m3
+%endmacro
+
+;void ff_vvc_sao_edge_filter_<width>_8_<opt>(uint8_t *_dst, uint8_t *_src, ptrdiff_t stride_dst, int16_t *sao_offset_val,
+;                                            int eo, int width, int height);
+%macro VVC_SAO_EDGE_FILTER 2
+cglobal vvc_sao_edge_filter_%1_8, 4, 9, 8, dst, src, dststride, offset, eo, a_stride, b_stride, height, tmp
+%define tmp2q heightq
+    VVC_SAO_EDGE_FILTER_INIT
+    mov          heightd, r6m
+
+%if mmsize > 16
+    vbroadcasti128    m0, [offsetq]
+%else
+    movu              m0, [offsetq]
+%endif
+    mova              m1, [pb_edge_shuffle]
+    packsswb          m0, m0
+    mova              m7, [pb_1]
+    pshufb            m0, m1
+    mova              m6, [pb_2]
+
+align 16
+.loop:
+
+%if %1 == 8
+    movq              m1, [srcq]
+    movq              m2, [srcq + a_strideq]
+    movq              m3, [srcq + b_strideq]
+    VVC_SAO_EDGE_FILTER_COMPUTE %1
+    movq          [dstq], m3
+%endif
+
+%assign i 0
+%rep %2
+    VVC_SAO_EDGE_FILTER_BLOCK i
+%assign i i+mmsize
+%endrep
+
+%if %1 > 8 && i < %1
+INIT_XMM cpuname
+    VVC_SAO_EDGE_FILTER_BLOCK i
+INIT_YMM cpuname
+%endif
+
+    add             dstq, dststrideq
+    add             srcq, EDGE_SRCSTRIDE
+    dec          heightd
+    jg .loop
+    RET
+%endmacro
+
+%if ARCH_X86_64
+%if HAVE_AVX2_EXTERNAL
+
+INIT_XMM avx2
+VVC_SAO_BAND_FILTER   8, 0
+VVC_SAO_BAND_FILTER  16, 1
+INIT_YMM avx2
+VVC_SAO_BAND_FILTER  32, 1
+VVC_SAO_BAND_FILTER  48, 1
+VVC_SAO_BAND_FILTER  64, 2
+VVC_SAO_BAND_FILTER  80, 2
+VVC_SAO_BAND_FILTER  96, 3
+VVC_SAO_BAND_FILTER 112, 3
+VVC_SAO_BAND_FILTER 128, 4
+
+INIT_XMM avx2
+VVC_SAO_EDGE_FILTER   8, 0
+VVC_SAO_EDGE_FILTER  16, 1
+INIT_YMM avx2
+VVC_SAO_EDGE_FILTER  32, 1
+VVC_SAO_EDGE_FILTER  48, 1
+VVC_SAO_EDGE_FILTER  64, 2
+VVC_SAO_EDGE_FILTER  80, 2
+VVC_SAO_EDGE_FILTER  96, 3
+VVC_SAO_EDGE_FILTER 112, 3
+VVC_SAO_EDGE_FILTER 128, 4
+
+%endif
+%endif
@@ -24,14 +24,22 @@
 #include "config.h"
 
 #include "libavutil/cpu.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/mem_internal.h"
+#include "libavutil/thread.h"
 #include "libavutil/x86/cpu.h"
 #include "libavcodec/vvc/dec.h"
 #include "libavcodec/vvc/ctu.h"
 #include "libavcodec/vvc/dsp.h"
+#include "libavcodec/vvc/intra.h"
+#include "libavcodec/vvc/itx_1d.h"
+#include "libavcodec/vvc/data.h"
 #include "libavcodec/x86/h26x/h2656dsp.h"
 
 #define PUT_PROTOTYPE(name, depth, opt) \
-void ff_vvc_put_ ## name ## _ ## depth ## _##opt(int16_t *dst, const uint8_t *src, ptrdiff_t srcstride, int height, const int8_t *hf, const int8_t *vf, int width);
+void ff_vvc_put_ ## name ## _ ## depth ## _##opt(int16_t *dst, const uint8_t *src, ptrdiff_t srcstride, int height, const int8_t *hf, const int8_t *vf, int width); \
+void ff_vvc_put_uni_w_ ## name ## _ ## depth ## _##opt(uint8_t *dst, ptrdiff_t dst_stride, const uint8_t *src, ptrdiff_t srcstride, int height, \
+    int denom, int wx, int ox, const int8_t *hf, const int8_t *vf, int width);
 
 #define PUT_PROTOTYPES(name, bitd, opt) \
         PUT_PROTOTYPE(name##2,   bitd, opt) \
@@ -63,6 +71,9 @@ PUT_TAP_PROTOTYPES(8, sse4)
 PUT_TAP_PROTOTYPES(4, avx2)
 PUT_TAP_PROTOTYPES(8, avx2)
 
+PUT_PROTOTYPE(8tap_h64,  8, avx512icl)
+PUT_PROTOTYPE(8tap_h128, 8, avx512icl)
+
 #define bf(fn, bd,  opt) fn##_##bd##_##opt
 #define BF(fn, bpc, opt) fn##_##bpc##bpc_##opt
 
@@ -87,25 +98,61 @@ AVG_PROTOTYPES( 8, avx2)
 AVG_PROTOTYPES(10, avx2)
 AVG_PROTOTYPES(12, avx2)
 
-#define ALF_BPC_PROTOTYPES(bpc, opt)                                                                                     \
+#define ALF_FILTER_BPC_PROTOTYPES(bpc, opt)                                                                              \
 void BF(ff_vvc_alf_filter_luma, bpc, opt)(uint8_t *dst, ptrdiff_t dst_stride,                                            \
     const uint8_t *src, ptrdiff_t src_stride, ptrdiff_t width, ptrdiff_t height,                                         \
     const int16_t *filter, const int16_t *clip, ptrdiff_t stride, ptrdiff_t vb_pos, ptrdiff_t pixel_max);                \
 void BF(ff_vvc_alf_filter_chroma, bpc, opt)(uint8_t *dst, ptrdiff_t dst_stride,                                          \
     const uint8_t *src, ptrdiff_t src_stride, ptrdiff_t width, ptrdiff_t height,                                         \
-    const int16_t *filter, const int16_t *clip, ptrdiff_t stride, ptrdiff_t vb_pos, ptrdiff_t pixel_max);                \
+    const int16_t *filter, const int16_t *clip, ptrdiff_t stride, ptrdiff_t vb_pos, ptrdiff_t pixel_max);
+
+#define ALF_BPC_PROTOTYPES(bpc, opt)                                                                                     \
+    ALF_FILTER_BPC_PROTOTYPES(bpc, opt)                                                                                  \
 void BF(ff_vvc_alf_classify_grad, bpc, opt)(int *gradient_sum,                                                           \
     const uint8_t *src, ptrdiff_t src_stride, intptr_t width, intptr_t height, intptr_t vb_pos);                         \
 void BF(ff_vvc_alf_classify, bpc, opt)(int *class_idx, int *transpose_idx, const int *gradient_sum,                      \
     intptr_t width, intptr_t height, intptr_t vb_pos, intptr_t bit_depth);                                               \
+void BF(ff_vvc_alf_filter_cc, bpc, opt)(uint8_t *dst, ptrdiff_t dst_stride,                                              \
+    const uint8_t *luma, ptrdiff_t luma_stride, ptrdiff_t width, ptrdiff_t height,                                       \
+    ptrdiff_t hs, ptrdiff_t vs, const int16_t *filter, ptrdiff_t vb_pos, ptrdiff_t pixel_max);                           \
 
-#define ALF_PROTOTYPES(bpc, bd, opt)                                                                                     \
+#define ALF_FILTER_PROTOTYPES(bd, opt)                                                                                   \
 void bf(ff_vvc_alf_filter_luma, bd, opt)(uint8_t *dst, ptrdiff_t dst_stride, const uint8_t *src, ptrdiff_t src_stride,   \
     int width, int height, const int16_t *filter, const int16_t *clip, const int vb_pos);                                \
 void bf(ff_vvc_alf_filter_chroma, bd, opt)(uint8_t *dst, ptrdiff_t dst_stride, const uint8_t *src, ptrdiff_t src_stride, \
-    int width, int height, const int16_t *filter, const int16_t *clip, const int vb_pos);                                \
+    int width, int height, const int16_t *filter, const int16_t *clip, const int vb_pos);
+
+#define ALF_PROTOTYPES(bpc, bd, opt)                                                                                     \
+    ALF_FILTER_PROTOTYPES(bd, opt)                                                                                       \
 void bf(ff_vvc_alf_classify, bd, opt)(int *class_idx, int *transpose_idx,                                                \
     const uint8_t *src, ptrdiff_t src_stride, int width, int height, int vb_pos, int *gradient_tmp);                     \
+void bf(ff_vvc_alf_filter_cc, bd, opt)(uint8_t *dst, ptrdiff_t dst_stride, const uint8_t *luma,                          \
+    ptrdiff_t luma_stride, int width, int height, int hs, int vs, const int16_t *filter, int vb_pos);                    \
+
+#define ADD_RES_BPC_PROTOTYPES(bpc, opt)                                                             \
+void BF(ff_vvc_add_residual, bpc, opt)(uint8_t *dst, const int *res, intptr_t width, intptr_t height, \
+    ptrdiff_t stride, intptr_t c_sign, intptr_t shift, intptr_t pixel_max);                          \
+void BF(ff_vvc_add_residual_joint, bpc, opt)(uint8_t *dst, const int *res, intptr_t width,           \
+    intptr_t height, ptrdiff_t stride, intptr_t c_sign, intptr_t shift, intptr_t pixel_max);         \
+void BF(ff_vvc_add_residual_dc, bpc, opt)(uint8_t *dst, intptr_t dc, intptr_t width,                 \
+    intptr_t height, ptrdiff_t stride, intptr_t pixel_max);
+
+#define ADD_RES_PROTOTYPES(bd, opt)                                                                  \
+void bf(ff_vvc_add_residual, bd, opt)(uint8_t *dst, const int *res, int width, int height,          \
+    ptrdiff_t stride);                                                                               \
+void bf(ff_vvc_add_residual_joint, bd, opt)(uint8_t *dst, const int *res, int width, int height,    \
+    ptrdiff_t stride, int c_sign, int shift);                                                        \
+void bf(ff_vvc_add_residual_dc, bd, opt)(uint8_t *dst, int dc, int width, int height,               \
+    ptrdiff_t stride);
+
+ADD_RES_BPC_PROTOTYPES( 8, avx2)
+ADD_RES_BPC_PROTOTYPES(16, avx2)
+
+ADD_RES_PROTOTYPES( 8, avx2)
+ADD_RES_PROTOTYPES(10, avx2)
+ADD_RES_PROTOTYPES(12, avx2)
+
+void ff_vvc_pred_residual_joint_avx2(int *buf, int width, int height, int c_sign, int shift);
 
 ALF_BPC_PROTOTYPES(8,  avx2)
 ALF_BPC_PROTOTYPES(16, avx2)
@@ -114,14 +161,83 @@ ALF_PROTOTYPES(8,  8,  avx2)
 ALF_PROTOTYPES(16, 10, avx2)
 ALF_PROTOTYPES(16, 12, avx2)
 
+ALF_FILTER_BPC_PROTOTYPES(8,  avx512icl)
+ALF_FILTER_BPC_PROTOTYPES(16, avx512icl)
+
+ALF_FILTER_PROTOTYPES(8,  avx512icl)
+ALF_FILTER_PROTOTYPES(10, avx512icl)
+ALF_FILTER_PROTOTYPES(12, avx512icl)
+
+#define LF_BPC_PROTOTYPES(bpc, opt)                                                                                      \
+void BF(ff_vvc_lf_luma_h, bpc, opt)(uint8_t *pix, ptrdiff_t stride, const VVCLFLanes *l, int pixel_max);                 \
+void BF(ff_vvc_lf_luma_v, bpc, opt)(uint8_t *pix, ptrdiff_t stride, const VVCLFLanes *l, int pixel_max);                 \
+void BF(ff_vvc_lf_chroma_h, bpc, opt)(uint8_t *pix, ptrdiff_t stride, const VVCLFLanes *l, int pixel_max);               \
+void BF(ff_vvc_lf_chroma_v, bpc, opt)(uint8_t *pix, ptrdiff_t stride, const VVCLFLanes *l, int pixel_max);
+
+#define LF_PROTOTYPE(name, bd, opt, last)                                                                                \
+void bf(ff_vvc_lf_filter_ ## name, bd, opt)(uint8_t *pix, ptrdiff_t stride, const int32_t *beta, const int32_t *tc,     \
+    const uint8_t *no_p, const uint8_t *no_q, const uint8_t *max_len_p, const uint8_t *max_len_q, int last);
+
+#define LF_PROTOTYPES(bd, opt)                                                                                           \
+    LF_PROTOTYPE(luma_h,   bd, opt, hor_ctu_edge)                                                                        \
+    LF_PROTOTYPE(luma_v,   bd, opt, hor_ctu_edge)                                                                        \
+    LF_PROTOTYPE(chroma_h, bd, opt, shift)                                                                               \
+    LF_PROTOTYPE(chroma_v, bd, opt, shift)
+
+#define SAO_FILTER_PROTOTYPE(w, bd, opt)                                                                                 \
+void ff_vvc_sao_band_filter_ ## w ## _ ## bd ## _ ## opt(uint8_t *dst, const uint8_t *src, ptrdiff_t dst_stride,         \
+    ptrdiff_t src_stride, const int16_t *sao_offset_val, int sao_left_class, int width, int height);                     \
+void ff_vvc_sao_edge_filter_ ## w ## _ ## bd ## _ ## opt(uint8_t *dst, const uint8_t *src, ptrdiff_t dst_stride,         \
+    const int16_t *sao_offset_val, int eo, int width, int height);
+
+#define SAO_FILTER_PROTOTYPES(bd, opt)                                                                                   \
+    SAO_FILTER_PROTOTYPE(8,   bd, opt)                                                                                   \
+    SAO_FILTER_PROTOTYPE(16,  bd, opt)                                                                                   \
+    SAO_FILTER_PROTOTYPE(32,  bd, opt)                                                                                   \
+    SAO_FILTER_PROTOTYPE(48,  bd, opt)                                                                                   \
+    SAO_FILTER_PROTOTYPE(64,  bd, opt)                                                                                   \
+    SAO_FILTER_PROTOTYPE(80,  bd, opt)                                                                                   \
+    SAO_FILTER_PROTOTYPE(96,  bd, opt)                                                                                   \
+    SAO_FILTER_PROTOTYPE(112, bd, opt)                                                                                   \
+    SAO_FILTER_PROTOTYPE(128, bd, opt)
+
+SAO_FILTER_PROTOTYPES(8,  avx2)
+SAO_FILTER_PROTOTYPES(10, avx2)
+SAO_FILTER_PROTOTYPES(12, avx2)
+
+LF_BPC_PROTOTYPES(8,  avx2)
+LF_BPC_PROTOTYPES(16, avx2)
+
+LF_PROTOTYPES(8,  avx2)
+LF_PROTOTYPES(10, avx2)
+LF_PROTOTYPES(12, avx2)
+
 #if ARCH_X86_64
 #if HAVE_SSE4_EXTERNAL
+#if HAVE_AVX2_EXTERNAL
+// a put into a temporary buffer and a w_avg with w1 = 0, denom - 1 takes out the extra bit of the
+// bi-prediction shift. The w_avg is avx2, so these are only linked for avx2 cpus.
+#define FW_PUT_UNI_W(name, depth, opt)                                                                          \
+void ff_vvc_put_uni_w_ ## name ## _ ## depth ## _##opt(uint8_t *dst, ptrdiff_t dst_stride,                     \
+    const uint8_t *src, ptrdiff_t srcstride, int height, int denom, int wx, int ox,                            \
+    const int8_t *hf, const int8_t *vf, int width)                                                             \
+{                                                                                                              \
+    LOCAL_ALIGNED_32(int16_t, tmp, [MAX_PB_SIZE * MAX_PB_SIZE]);                                               \
+    ff_h2656_put_## name ## _ ## depth ## _##opt(tmp, 2 * MAX_PB_SIZE, src, srcstride, height, hf, vf, width); \
+    (depth > 8 ? BF(ff_vvc_w_avg, 16, avx2) : BF(ff_vvc_w_avg, 8, avx2))(dst, dst_stride, tmp, tmp,           \
+        width, height, denom - 1, wx, 0, ox, ox, (1 << depth) - 1);                                            \
+}
+#else
+#define FW_PUT_UNI_W(name, depth, opt)
+#endif
+
 #define FW_PUT(name, depth, opt) \
 void ff_vvc_put_ ## name ## _ ## depth ## _##opt(int16_t *dst, const uint8_t *src, ptrdiff_t srcstride,        \
                                                  int height, const int8_t *hf, const int8_t *vf, int width)    \
 {                                                                                                              \
     ff_h2656_put_## name ## _ ## depth ## _##opt(dst, 2 * MAX_PB_SIZE, src, srcstride, height, hf, vf, width); \
-}
+}                                                                                                              \
+FW_PUT_UNI_W(name, depth, opt)
 
 #define FW_PUT_TAP(fname, bitd, opt ) \
     FW_PUT(fname##4,   bitd, opt )    \
@@ -209,7 +325,29 @@ AVG_FUNCS(8,  8,  avx2)
 AVG_FUNCS(16, 10, avx2)
 AVG_FUNCS(16, 12, avx2)
 
-#define ALF_FUNCS(bpc, bd, opt)                                                                                          \
+#define ADD_RES_FUNCS(bpc, bd, opt)                                                                 \
+void bf(ff_vvc_add_residual, bd, opt)(uint8_t *dst, const int *res, int width, int height,         \
+    ptrdiff_t stride)                                                                               \
+{                                                                                                   \
+    BF(ff_vvc_add_residual, bpc, opt)(dst, res, width, height, stride, 1, 0, (1 << bd) - 1);        \
+}                                                                                                   \
+void bf(ff_vvc_add_residual_joint, bd, opt)(uint8_t *dst, const int *res, int width, int height,   \
+    ptrdiff_t stride, int c_sign, int shift)                                                        \
+{                                                                                                   \
+    BF(ff_vvc_add_residual_joint, bpc, opt)(dst, res, width, height, stride,                        \
+        c_sign, shift, (1 << bd) - 1);                                                              \
+}                                                                                                   \
+void bf(ff_vvc_add_residual_dc, bd, opt)(uint8_t *dst, int dc, int width, int height,              \
+    ptrdiff_t stride)                                                                               \
+{                                                                                                   \
+    BF(ff_vvc_add_residual_dc, bpc, opt)(dst, dc, width, height, stride, (1 << bd) - 1);            \
+}
+
+ADD_RES_FUNCS(8,  8,  avx2)
+ADD_RES_FUNCS(16, 10, avx2)
+ADD_RES_FUNCS(16, 12, avx2)
+
+#define ALF_FILTER_FUNCS(bpc, bd, opt)                                                                                   \
 void bf(ff_vvc_alf_filter_luma, bd, opt)(uint8_t *dst, ptrdiff_t dst_stride, const uint8_t *src, ptrdiff_t src_stride,   \
     int width, int height, const int16_t *filter, const int16_t *clip, const int vb_pos)                                 \
 {                                                                                                                        \
@@ -222,105 +360,836 @@ void bf(ff_vvc_alf_filter_chroma, bd, opt)(uint8_t *dst, ptrdiff_t dst_stride, c
 {                                                                                                                        \
     BF(ff_vvc_alf_filter_chroma, bpc, opt)(dst, dst_stride, src, src_stride, width, height,                              \
         filter, clip, 0, vb_pos,(1 << bd)  - 1);                                                                         \
-}                                                                                                                        \
+}
+
+#define ALF_FUNCS(bpc, bd, opt)                                                                                          \
+    ALF_FILTER_FUNCS(bpc, bd, opt)                                                                                       \
 void bf(ff_vvc_alf_classify, bd, opt)(int *class_idx, int *transpose_idx,                                                \
     const uint8_t *src, ptrdiff_t src_stride, int width, int height, int vb_pos, int *gradient_tmp)                      \
 {                                                                                                                        \
     BF(ff_vvc_alf_classify_grad, bpc, opt)(gradient_tmp, src, src_stride, width, height, vb_pos);                        \
     BF(ff_vvc_alf_classify, bpc, opt)(class_idx, transpose_idx, gradient_tmp, width, height, vb_pos, bd);                \
 }                                                                                                                        \
+void bf(ff_vvc_alf_filter_cc, bd, opt)(uint8_t *dst, ptrdiff_t dst_stride, const uint8_t *luma,                          \
+    ptrdiff_t luma_stride, int width, int height, int hs, int vs, const int16_t *filter, int vb_pos)                     \
+{                                                                                                                        \
+    BF(ff_vvc_alf_filter_cc, bpc, opt)(dst, dst_stride, luma, luma_stride, width, height,                                \
+        hs, vs, filter, vb_pos, (1 << bd) - 1);                                                                          \
+}                                                                                                                        \
 
 ALF_FUNCS(8,  8,  avx2)
 ALF_FUNCS(16, 10, avx2)
 ALF_FUNCS(16, 12, avx2)
 
+#if HAVE_AVX512ICL_EXTERNAL
+FW_PUT(8tap_h64,  8, avx512icl)
+FW_PUT(8tap_h128, 8, avx512icl)
+
+ALF_FILTER_FUNCS(8,  8,  avx512icl)
+ALF_FILTER_FUNCS(16, 10, avx512icl)
+ALF_FILTER_FUNCS(16, 12, avx512icl)
+#endif
+
+// the decisions are made in C, the asm runs the filters on all 8 lines of the edge at once
+#define LF_FUNC(name, dir, xstride, ystride, bpc, bd, opt, last)                                                         \
+void bf(ff_vvc_lf_filter_ ## name ## _ ## dir, bd, opt)(uint8_t *pix, ptrdiff_t stride,                                 \
+    const int32_t *beta, const int32_t *tc, const uint8_t *no_p, const uint8_t *no_q,                                    \
+    const uint8_t *max_len_p, const uint8_t *max_len_q, const int last)                                                  \
+{                                                                                                                        \
+    VVCLFLanes l;                                                                                                        \
+    if (ff_vvc_lf_ ## name ## _lanes_ ## bd(&l, pix, xstride, ystride, beta, tc, no_p, no_q,                             \
+            max_len_p, max_len_q, last))                                                                                 \
+        BF(ff_vvc_lf_ ## name ## _ ## dir, bpc, opt)(pix, stride, &l, (1 << bd) - 1);                                    \
+}
+
+#define LF_FUNCS(bpc, bd, opt)                                                                                           \
+    LF_FUNC(luma,   h, stride, bpc / 8, bpc, bd, opt, hor_ctu_edge)                                                      \
+    LF_FUNC(luma,   v, bpc / 8, stride, bpc, bd, opt, hor_ctu_edge)                                                      \
+    LF_FUNC(chroma, h, stride, bpc / 8, bpc, bd, opt, shift)                                                             \
+    LF_FUNC(chroma, v, bpc / 8, stride, bpc, bd, opt, shift)
+
+LF_FUNCS(8,  8,  avx2)
+LF_FUNCS(16, 10, avx2)
+LF_FUNCS(16, 12, avx2)
+
 #endif
 
+// the simd put and avg are faster than the c put_bi
 #define PEL_LINK(dst, C, W, idx1, idx2, name, D, opt)                              \
     dst[C][W][idx1][idx2] = ff_vvc_put_## name ## _ ## D ## _##opt;                \
     dst ## _uni[C][W][idx1][idx2] = ff_h2656_put_uni_ ## name ## _ ## D ## _##opt; \
+    dst ## _bi[C][W][idx1][idx2] = NULL;                                           \
+
+#define PEL_LINK_UNI_W(dst, C, W, idx1, idx2, name, D, opt)                        \
+    dst ## _uni_w[C][W][idx1][idx2] = ff_vvc_put_uni_w_ ## name ## _ ## D ## _##opt; \
+
+#define MC_TAP_LINKS(link, pointer, C, my, mx, fname, bitd, opt )    \
+    link(pointer, C, 1, my , mx , fname##4 ,  bitd, opt );           \
+    link(pointer, C, 2, my , mx , fname##8 ,  bitd, opt );           \
+    link(pointer, C, 3, my , mx , fname##16,  bitd, opt );           \
+    link(pointer, C, 4, my , mx , fname##32,  bitd, opt );           \
+    link(pointer, C, 5, my , mx , fname##64,  bitd, opt );           \
+    link(pointer, C, 6, my , mx , fname##128, bitd, opt );
+
+#define MC_8TAP_LINKS(link, pointer, my, mx, fname, bitd, opt)       \
+    MC_TAP_LINKS(link, pointer, LUMA, my, mx, fname, bitd, opt)
+
+#define MC_8TAP_LINKS_SSE4(link, bd)                                 \
+    MC_8TAP_LINKS(link, c->inter.put, 0, 0, pixels, bd, sse4);       \
+    MC_8TAP_LINKS(link, c->inter.put, 0, 1, 8tap_h, bd, sse4);       \
+    MC_8TAP_LINKS(link, c->inter.put, 1, 0, 8tap_v, bd, sse4);       \
+    MC_8TAP_LINKS(link, c->inter.put, 1, 1, 8tap_hv, bd, sse4)
 
-#define MC_TAP_LINKS(pointer, C, my, mx, fname, bitd, opt )          \
-    PEL_LINK(pointer, C, 1, my , mx , fname##4 ,  bitd, opt );       \
-    PEL_LINK(pointer, C, 2, my , mx , fname##8 ,  bitd, opt );       \
-    PEL_LINK(pointer, C, 3, my , mx , fname##16,  bitd, opt );       \
-    PEL_LINK(pointer, C, 4, my , mx , fname##32,  bitd, opt );       \
-    PEL_LINK(pointer, C, 5, my , mx , fname##64,  bitd, opt );       \
-    PEL_LINK(pointer, C, 6, my , mx , fname##128, bitd, opt );
-
-#define MC_8TAP_LINKS(pointer, my, mx, fname, bitd, opt)             \
-    MC_TAP_LINKS(pointer, LUMA, my, mx, fname, bitd, opt)
-
-#define MC_8TAP_LINKS_SSE4(bd)                                       \
-    MC_8TAP_LINKS(c->inter.put, 0, 0, pixels, bd, sse4);             \
-    MC_8TAP_LINKS(c->inter.put, 0, 1, 8tap_h, bd, sse4);             \
-    MC_8TAP_LINKS(c->inter.put, 1, 0, 8tap_v, bd, sse4);             \
-    MC_8TAP_LINKS(c->inter.put, 1, 1, 8tap_hv, bd, sse4)
-
-#define MC_4TAP_LINKS(pointer, my, mx, fname, bitd, opt)             \
-    PEL_LINK(pointer, CHROMA, 0, my , mx , fname##2 ,  bitd, opt );  \
-    MC_TAP_LINKS(pointer, CHROMA, my, mx, fname, bitd, opt)          \
-
-#define MC_4TAP_LINKS_SSE4(bd)                                       \
-    MC_4TAP_LINKS(c->inter.put, 0, 0, pixels, bd, sse4);             \
-    MC_4TAP_LINKS(c->inter.put, 0, 1, 4tap_h, bd, sse4);             \
-    MC_4TAP_LINKS(c->inter.put, 1, 0, 4tap_v, bd, sse4);             \
-    MC_4TAP_LINKS(c->inter.put, 1, 1, 4tap_hv, bd, sse4)
+#define MC_4TAP_LINKS(link, pointer, my, mx, fname, bitd, opt)       \
+    link(pointer, CHROMA, 0, my , mx , fname##2 ,  bitd, opt );      \
+    MC_TAP_LINKS(link, pointer, CHROMA, my, mx, fname, bitd, opt)    \
+
+#define MC_4TAP_LINKS_SSE4(link, bd)                                 \
+    MC_4TAP_LINKS(link, c->inter.put, 0, 0, pixels, bd, sse4);       \
+    MC_4TAP_LINKS(link, c->inter.put, 0, 1, 4tap_h, bd, sse4);       \
+    MC_4TAP_LINKS(link, c->inter.put, 1, 0, 4tap_v, bd, sse4);       \
+    MC_4TAP_LINKS(link, c->inter.put, 1, 1, 4tap_hv, bd, sse4)
 
 #define MC_LINK_SSE4(bd)                                             \
-    MC_4TAP_LINKS_SSE4(bd)                                           \
-    MC_8TAP_LINKS_SSE4(bd)
-
-#define MC_TAP_LINKS_AVX2(C,tap,bd) do {                             \
-        PEL_LINK(c->inter.put, C, 4, 0, 0, pixels32,      bd, avx2)  \
-        PEL_LINK(c->inter.put, C, 5, 0, 0, pixels64,      bd, avx2)  \
-        PEL_LINK(c->inter.put, C, 6, 0, 0, pixels128,     bd, avx2)  \
-        PEL_LINK(c->inter.put, C, 4, 0, 1, tap##tap_h32,  bd, avx2)  \
-        PEL_LINK(c->inter.put, C, 5, 0, 1, tap##tap_h64,  bd, avx2)  \
-        PEL_LINK(c->inter.put, C, 6, 0, 1, tap##tap_h128, bd, avx2)  \
-        PEL_LINK(c->inter.put, C, 4, 1, 0, tap##tap_v32,  bd, avx2)  \
-        PEL_LINK(c->inter.put, C, 5, 1, 0, tap##tap_v64,  bd, avx2)  \
-        PEL_LINK(c->inter.put, C, 6, 1, 0, tap##tap_v128, bd, avx2)  \
+    MC_4TAP_LINKS_SSE4(PEL_LINK, bd)                                 \
+    MC_8TAP_LINKS_SSE4(PEL_LINK, bd)
+
+#define MC_TAP_LINKS_AVX2(link, C, tap, bd) do {                     \
+        link(c->inter.put, C, 4, 0, 0, pixels32,      bd, avx2)      \
+        link(c->inter.put, C, 5, 0, 0, pixels64,      bd, avx2)      \
+        link(c->inter.put, C, 6, 0, 0, pixels128,     bd, avx2)      \
+        link(c->inter.put, C, 4, 0, 1, tap##tap_h32,  bd, avx2)      \
+        link(c->inter.put, C, 5, 0, 1, tap##tap_h64,  bd, avx2)      \
+        link(c->inter.put, C, 6, 0, 1, tap##tap_h128, bd, avx2)      \
+        link(c->inter.put, C, 4, 1, 0, tap##tap_v32,  bd, avx2)      \
+        link(c->inter.put, C, 5, 1, 0, tap##tap_v64,  bd, avx2)      \
+        link(c->inter.put, C, 6, 1, 0, tap##tap_v128, bd, avx2)      \
     } while (0)
 
+// the weighted uni puts of the sse4 functions need the avx2 w_avg
 #define MC_LINKS_AVX2(bd)                                            \
-    MC_TAP_LINKS_AVX2(LUMA,   8, bd);                                \
-    MC_TAP_LINKS_AVX2(CHROMA, 4, bd);
-
-#define MC_TAP_LINKS_16BPC_AVX2(C, tap, bd) do {                     \
-        PEL_LINK(c->inter.put, C, 3, 0, 0, pixels16, bd, avx2)       \
-        PEL_LINK(c->inter.put, C, 3, 0, 1, tap##tap_h16, bd, avx2)   \
-        PEL_LINK(c->inter.put, C, 3, 1, 0, tap##tap_v16, bd, avx2)   \
-        PEL_LINK(c->inter.put, C, 3, 1, 1, tap##tap_hv16, bd, avx2)  \
-        PEL_LINK(c->inter.put, C, 4, 1, 1, tap##tap_hv32, bd, avx2)  \
-        PEL_LINK(c->inter.put, C, 5, 1, 1, tap##tap_hv64, bd, avx2)  \
-        PEL_LINK(c->inter.put, C, 6, 1, 1, tap##tap_hv128, bd, avx2) \
+    MC_4TAP_LINKS_SSE4(PEL_LINK_UNI_W, bd);                          \
+    MC_8TAP_LINKS_SSE4(PEL_LINK_UNI_W, bd);                          \
+    MC_TAP_LINKS_AVX2(PEL_LINK,       LUMA,   8, bd);                \
+    MC_TAP_LINKS_AVX2(PEL_LINK,       CHROMA, 4, bd);                \
+    MC_TAP_LINKS_AVX2(PEL_LINK_UNI_W, LUMA,   8, bd);                \
+    MC_TAP_LINKS_AVX2(PEL_LINK_UNI_W, CHROMA, 4, bd);
+
+#define MC_TAP_LINKS_16BPC_AVX2(link, C, tap, bd) do {               \
+        link(c->inter.put, C, 3, 0, 0, pixels16, bd, avx2)           \
+        link(c->inter.put, C, 3, 0, 1, tap##tap_h16, bd, avx2)       \
+        link(c->inter.put, C, 3, 1, 0, tap##tap_v16, bd, avx2)       \
+        link(c->inter.put, C, 3, 1, 1, tap##tap_hv16, bd, avx2)      \
+        link(c->inter.put, C, 4, 1, 1, tap##tap_hv32, bd, avx2)      \
+        link(c->inter.put, C, 5, 1, 1, tap##tap_hv64, bd, avx2)      \
+        link(c->inter.put, C, 6, 1, 1, tap##tap_hv128, bd, avx2)     \
     } while (0)
 
 #define MC_LINKS_16BPC_AVX2(bd)                                      \
-    MC_TAP_LINKS_16BPC_AVX2(LUMA,   8, bd);                          \
-    MC_TAP_LINKS_16BPC_AVX2(CHROMA, 4, bd);
+    MC_TAP_LINKS_16BPC_AVX2(PEL_LINK,       LUMA,   8, bd);          \
+    MC_TAP_LINKS_16BPC_AVX2(PEL_LINK,       CHROMA, 4, bd);          \
+    MC_TAP_LINKS_16BPC_AVX2(PEL_LINK_UNI_W, LUMA,   8, bd);          \
+    MC_TAP_LINKS_16BPC_AVX2(PEL_LINK_UNI_W, CHROMA, 4, bd);
+
+// the 8 bit luma h of the wide blocks, the vpdpbusd sums 4 taps at once
+#define MC_LINKS_AVX512ICL() do {                                            \
+        PEL_LINK_UNI_W(c->inter.put, LUMA, 5, 0, 1, 8tap_h64,  8, avx512icl) \
+        PEL_LINK_UNI_W(c->inter.put, LUMA, 6, 0, 1, 8tap_h128, 8, avx512icl) \
+        c->inter.put[LUMA][5][0][1] = ff_vvc_put_8tap_h64_8_avx512icl;       \
+        c->inter.put[LUMA][6][0][1] = ff_vvc_put_8tap_h128_8_avx512icl;      \
+    } while (0)
 
 #define AVG_INIT(bd, opt) do {                                       \
     c->inter.avg    = bf(ff_vvc_avg, bd, opt);                       \
     c->inter.w_avg  = bf(ff_vvc_w_avg, bd, opt);                     \
 } while (0)
 
-#define ALF_INIT(bd) do {                                            \
-    c->alf.filter[LUMA]   = ff_vvc_alf_filter_luma_##bd##_avx2;      \
-    c->alf.filter[CHROMA] = ff_vvc_alf_filter_chroma_##bd##_avx2;    \
-    c->alf.classify       = ff_vvc_alf_classify_##bd##_avx2;         \
+#define ADD_RES_INIT(bd) do {                                            \
+    c->itx.add_residual        = ff_vvc_add_residual_##bd##_avx2;        \
+    c->itx.add_residual_joint  = ff_vvc_add_residual_joint_##bd##_avx2;  \
+    c->itx.add_residual_dc     = ff_vvc_add_residual_dc_##bd##_avx2;     \
+    c->itx.pred_residual_joint = ff_vvc_pred_residual_joint_avx2;        \
+} while (0)
+
+#define ALF_INIT(bd) do {                                                          \
+    c->alf.filter[LUMA]         = ff_vvc_alf_filter_luma_##bd##_avx2;              \
+    c->alf.filter[CHROMA]       = ff_vvc_alf_filter_chroma_##bd##_avx2;            \
+    c->alf.classify             = ff_vvc_alf_classify_##bd##_avx2;                 \
+    c->alf.filter_cc            = ff_vvc_alf_filter_cc_##bd##_avx2;                \
+} while (0)
+
+#define ALF_AVX512ICL_INIT(bd) do {                                                \
+    c->alf.filter[LUMA]         = ff_vvc_alf_filter_luma_##bd##_avx512icl;         \
+    c->alf.filter[CHROMA]       = ff_vvc_alf_filter_chroma_##bd##_avx512icl;       \
+} while (0)
+
+#define LF_INIT(bd) do {                                             \
+    c->lf.filter_luma[0]   = ff_vvc_lf_filter_luma_h_##bd##_avx2;    \
+    c->lf.filter_luma[1]   = ff_vvc_lf_filter_luma_v_##bd##_avx2;    \
+    c->lf.filter_chroma[0] = ff_vvc_lf_filter_chroma_h_##bd##_avx2;  \
+    c->lf.filter_chroma[1] = ff_vvc_lf_filter_chroma_v_##bd##_avx2;  \
+} while (0)
+
+#define SAO_INIT(bd) do {                                            \
+    c->sao.band_filter[0] = ff_vvc_sao_band_filter_8_##bd##_avx2;    \
+    c->sao.band_filter[1] = ff_vvc_sao_band_filter_16_##bd##_avx2;   \
+    c->sao.band_filter[2] = ff_vvc_sao_band_filter_32_##bd##_avx2;   \
+    c->sao.band_filter[3] = ff_vvc_sao_band_filter_48_##bd##_avx2;   \
+    c->sao.band_filter[4] = ff_vvc_sao_band_filter_64_##bd##_avx2;   \
+    c->sao.band_filter[5] = ff_vvc_sao_band_filter_80_##bd##_avx2;   \
+    c->sao.band_filter[6] = ff_vvc_sao_band_filter_96_##bd##_avx2;   \
+    c->sao.band_filter[7] = ff_vvc_sao_band_filter_112_##bd##_avx2;  \
+    c->sao.band_filter[8] = ff_vvc_sao_band_filter_128_##bd##_avx2;  \
+    c->sao.edge_filter[0] = ff_vvc_sao_edge_filter_8_##bd##_avx2;    \
+    c->sao.edge_filter[1] = ff_vvc_sao_edge_filter_16_##bd##_avx2;   \
+    c->sao.edge_filter[2] = ff_vvc_sao_edge_filter_32_##bd##_avx2;   \
+    c->sao.edge_filter[3] = ff_vvc_sao_edge_filter_48_##bd##_avx2;   \
+    c->sao.edge_filter[4] = ff_vvc_sao_edge_filter_64_##bd##_avx2;   \
+    c->sao.edge_filter[5] = ff_vvc_sao_edge_filter_80_##bd##_avx2;   \
+    c->sao.edge_filter[6] = ff_vvc_sao_edge_filter_96_##bd##_avx2;   \
+    c->sao.edge_filter[7] = ff_vvc_sao_edge_filter_112_##bd##_avx2;  \
+    c->sao.edge_filter[8] = ff_vvc_sao_edge_filter_128_##bd##_avx2;  \
 } while (0)
 
 int ff_vvc_sad_avx2(const int16_t *src0, const int16_t *src1, int dx, int dy, int block_w, int block_h);
-#define SAD_INIT() c->inter.sad = ff_vvc_sad_avx2
+void ff_vvc_sad_5x5_avx2(int *sad, const int16_t *src0, const int16_t *src1, int block_w, int block_h);
+#define SAD_INIT() do {                                              \
+    c->inter.sad          = ff_vvc_sad_avx2;                         \
+    c->inter.sad_5x5      = ff_vvc_sad_5x5_avx2;                     \
+} while (0)
+
+#define DMVR_PROTOTYPES(bd, opt)                                                                 \
+void bf(ff_vvc_dmvr, bd, opt)(int16_t *dst, const uint8_t *src, ptrdiff_t src_stride,            \
+    int height, intptr_t mx, intptr_t my, int width);                                            \
+void bf(ff_vvc_dmvr_h, bd, opt)(int16_t *dst, const uint8_t *src, ptrdiff_t src_stride,          \
+    int height, intptr_t mx, intptr_t my, int width);                                            \
+void bf(ff_vvc_dmvr_v, bd, opt)(int16_t *dst, const uint8_t *src, ptrdiff_t src_stride,          \
+    int height, intptr_t mx, intptr_t my, int width);                                            \
+void bf(ff_vvc_dmvr_hv, bd, opt)(int16_t *dst, const uint8_t *src, ptrdiff_t src_stride,         \
+    int height, intptr_t mx, intptr_t my, int width);                                            \
+
+DMVR_PROTOTYPES( 8, avx2)
+DMVR_PROTOTYPES(10, avx2)
+DMVR_PROTOTYPES(12, avx2)
+
+#define DMVR_INIT(bd) do {                                           \
+    c->inter.dmvr[0][0]   = ff_vvc_dmvr_##bd##_avx2;                 \
+    c->inter.dmvr[0][1]   = ff_vvc_dmvr_h_##bd##_avx2;               \
+    c->inter.dmvr[1][0]   = ff_vvc_dmvr_v_##bd##_avx2;               \
+    c->inter.dmvr[1][1]   = ff_vvc_dmvr_hv_##bd##_avx2;              \
+} while (0)
+
+#define BDOF_PROTOTYPES(bd, opt)                                                                 \
+void bf(ff_vvc_apply_bdof, bd, opt)(uint8_t *dst, ptrdiff_t dst_stride,                          \
+    int16_t *src0, int16_t *src1, int block_w, int block_h);                                     \
+void bf(ff_vvc_bdof_fetch_samples, bd, opt)(int16_t *dst, const uint8_t *src,                    \
+    ptrdiff_t src_stride, int x_frac, int y_frac, int width, int height);                        \
+
+BDOF_PROTOTYPES( 8, avx2)
+BDOF_PROTOTYPES(10, avx2)
+BDOF_PROTOTYPES(12, avx2)
+
+#define BDOF_INIT(bd) do {                                                   \
+    c->inter.apply_bdof         = ff_vvc_apply_bdof_##bd##_avx2;             \
+    c->inter.bdof_fetch_samples = ff_vvc_bdof_fetch_samples_##bd##_avx2;     \
+} while (0)
+
+void ff_vvc_apply_prof_avx2(int16_t *dst, const int16_t *src, const int16_t *diff_mv_x, const int16_t *diff_mv_y);
+
+#define PROF_PROTOTYPES(bd, opt)                                                                 \
+void bf(ff_vvc_apply_prof_uni, bd, opt)(uint8_t *dst, ptrdiff_t dst_stride, const int16_t *src,   \
+    const int16_t *diff_mv_x, const int16_t *diff_mv_y);                                         \
+void bf(ff_vvc_apply_prof_uni_w, bd, opt)(uint8_t *dst, ptrdiff_t dst_stride, const int16_t *src, \
+    const int16_t *diff_mv_x, const int16_t *diff_mv_y, int denom, int wx, int ox);              \
+
+PROF_PROTOTYPES( 8, avx2)
+PROF_PROTOTYPES(10, avx2)
+PROF_PROTOTYPES(12, avx2)
+
+#define PROF_INIT(bd) do {                                                   \
+    c->inter.apply_prof         = ff_vvc_apply_prof_avx2;                    \
+    c->inter.apply_prof_uni     = ff_vvc_apply_prof_uni_##bd##_avx2;         \
+    c->inter.apply_prof_uni_w   = ff_vvc_apply_prof_uni_w_##bd##_avx2;       \
+} while (0)
+
+#define BLEND_PROTOTYPES(bd, opt)                                                                \
+void bf(ff_vvc_put_ciip, bd, opt)(uint8_t *dst, ptrdiff_t dst_stride, int width, int height,     \
+    const uint8_t *inter, ptrdiff_t inter_stride, int intra_weight);                             \
+void bf(ff_vvc_put_gpm, bd, opt)(uint8_t *dst, ptrdiff_t dst_stride, int width, int height,      \
+    const int16_t *src0, const int16_t *src1, const uint8_t *weights, int step_x, int step_y);   \
+
+BLEND_PROTOTYPES( 8, avx2)
+BLEND_PROTOTYPES(10, avx2)
+BLEND_PROTOTYPES(12, avx2)
+
+#define BLEND_INIT(bd) do {                                                  \
+    c->inter.put_ciip           = ff_vvc_put_ciip_##bd##_avx2;               \
+    c->inter.put_gpm            = ff_vvc_put_gpm_##bd##_avx2;                \
+} while (0)
+
+void ff_vvc_scaled_filter_8bpc_avx2(int16_t *dst, const uint8_t *src, ptrdiff_t src_stride,
+    intptr_t lines, const int16_t *filter, intptr_t taps, intptr_t shift);
+void ff_vvc_scaled_filter_16bpc_avx2(int16_t *dst, const uint8_t *src, ptrdiff_t src_stride,
+    intptr_t lines, const int16_t *filter, intptr_t taps, intptr_t shift);
+void ff_vvc_scaled_filter_sat_16bpc_avx2(int16_t *dst, const uint8_t *src, ptrdiff_t src_stride,
+    intptr_t lines, const int16_t *filter, intptr_t taps, intptr_t shift);
+
+#define SCALED_TMP_STRIDE EDGE_EMU_BUFFER_STRIDE
+
+// the two passes of put_scaled() in vvc/inter_template.c. The filter phase changes with every
+// column and row, so each asm call filters a whole column of the source with one phase, the
+// horizontal pass stores its columns as rows of tmp for the vertical one.
+static av_always_inline void put_scaled_avx2(int16_t *dst, const uint8_t *_src, const ptrdiff_t src_stride,
+    const int src_height, const int _x, const int _y, const int dx, const int dy, const int height,
+    const int8_t *hf, const int8_t *vf, const int width, const int is_chroma, const int saturate, const int bd)
+{
+    LOCAL_ALIGNED_32(int16_t, tmp, [SCALED_TMP_STRIDE * MAX_PB_SIZE]);
+    const int taps         = is_chroma ? VVC_INTER_CHROMA_TAPS : VVC_INTER_LUMA_TAPS;
+    const int extra        = is_chroma ? CHROMA_EXTRA : LUMA_EXTRA;
+    const int extra_before = is_chroma ? CHROMA_EXTRA_BEFORE : LUMA_EXTRA_BEFORE;
+    const int shift1       = 6 - is_chroma;
+    const int shift2       = 4 + is_chroma;
+    const int x0           = SCALED_INT(_x);
+    const int y0           = SCALED_INT(_y);
+    const int pixel_size   = (bd + 7) / 8;
+    const uint8_t *src     = _src - extra_before * src_stride;
+    int16_t filter[8]      = { 0 };
+
+    for (int i = 0; i < width; i++) {
+        const int tx    = _x + dx * i;
+        const int x     = SCALED_INT(tx) - x0 - extra_before;
+        const int8_t *f = hf + av_zero_extend(tx >> shift1, shift2) * taps;
+
+        for (int k = 0; k < taps; k++)
+            filter[k] = f[k];
+        if (bd == 8)
+            ff_vvc_scaled_filter_8bpc_avx2(tmp + i * SCALED_TMP_STRIDE, src + x, src_stride,
+                src_height + extra, filter, taps, 0);
+        else
+            ff_vvc_scaled_filter_16bpc_avx2(tmp + i * SCALED_TMP_STRIDE, src + x * pixel_size, src_stride,
+                src_height + extra, filter, taps, bd - 8);
+    }
+
+    for (int i = 0; i < height; i++) {
+        const int ty        = _y + dy * i;
+        const int y         = SCALED_INT(ty) - y0;
+        const int8_t *f     = vf + av_zero_extend(ty >> shift1, shift2) * taps;
+        const uint8_t *col  = (const uint8_t *)(tmp + y);
+
+        for (int k = 0; k < taps; k++)
+            filter[k] = f[k];
+        if (saturate)
+            ff_vvc_scaled_filter_sat_16bpc_avx2(dst + i * MAX_PB_SIZE, col, SCALED_TMP_STRIDE * sizeof(int16_t),
+                width, filter, taps, 6);
+        else
+            ff_vvc_scaled_filter_16bpc_avx2(dst + i * MAX_PB_SIZE, col, SCALED_TMP_STRIDE * sizeof(int16_t),
+                width, filter, taps, 6);
+    }
+}
+
+// the uni versions round the saturated intermediates with the avg and w_avg of the same value
+#define SCALED_FUNC(name, is_chroma, bpc, bd)                                                                    \
+static void bf(put_ ## name ## _scaled, bd, avx2)(int16_t *dst, const uint8_t *src, ptrdiff_t src_stride,      \
+    int src_height, int x, int y, int dx, int dy, int height, const int8_t *hf, const int8_t *vf, int width)   \
+{                                                                                                              \
+    put_scaled_avx2(dst, src, src_stride, src_height, x, y, dx, dy, height, hf, vf, width, is_chroma, 0, bd);  \
+}                                                                                                              \
+static void bf(put_uni_ ## name ## _scaled, bd, avx2)(uint8_t *dst, const ptrdiff_t dst_stride,                \
+    const uint8_t *src, ptrdiff_t src_stride, int src_height, int x, int y, int dx, int dy, int height,        \
+    const int8_t *hf, const int8_t *vf, int width)                                                             \
+{                                                                                                              \
+    LOCAL_ALIGNED_32(int16_t, tmp, [MAX_PB_SIZE * MAX_PB_SIZE]);                                               \
+    put_scaled_avx2(tmp, src, src_stride, src_height, x, y, dx, dy, height, hf, vf, width, is_chroma, 1, bd);  \
+    BF(ff_vvc_avg, bpc, avx2)(dst, dst_stride, tmp, tmp, width, height, (1 << bd) - 1);                        \
+}                                                                                                              \
+static void bf(put_uni_ ## name ## _w_scaled, bd, avx2)(uint8_t *dst, const ptrdiff_t dst_stride,              \
+    const uint8_t *src, ptrdiff_t src_stride, int src_height, int x, int y, int dx, int dy, int height,        \
+    int denom, int wx, int ox, const int8_t *hf, const int8_t *vf, int width)                                  \
+{                                                                                                              \
+    LOCAL_ALIGNED_32(int16_t, tmp, [MAX_PB_SIZE * MAX_PB_SIZE]);                                               \
+    put_scaled_avx2(tmp, src, src_stride, src_height, x, y, dx, dy, height, hf, vf, width, is_chroma, 1, bd);  \
+    BF(ff_vvc_w_avg, bpc, avx2)(dst, dst_stride, tmp, tmp, width, height,                                      \
+        denom - 1, wx, 0, ox, ox, (1 << bd) - 1);                                                              \
+}
+
+#define SCALED_FUNCS(bpc, bd)                                        \
+    SCALED_FUNC(luma,   0, bpc, bd)                                  \
+    SCALED_FUNC(chroma, 1, bpc, bd)
+
+SCALED_FUNCS(8,  8)
+SCALED_FUNCS(16, 10)
+SCALED_FUNCS(16, 12)
+
+#define SCALED_INIT(bd) do {                                                                 \
+    for (int i = 0; i < FF_ARRAY_ELEMS(c->inter.put_scaled[LUMA]); i++) {                    \
+        c->inter.put_scaled[LUMA][i]         = put_luma_scaled_##bd##_avx2;                  \
+        c->inter.put_scaled[CHROMA][i]       = put_chroma_scaled_##bd##_avx2;                \
+        c->inter.put_uni_scaled[LUMA][i]     = put_uni_luma_scaled_##bd##_avx2;              \
+        c->inter.put_uni_scaled[CHROMA][i]   = put_uni_chroma_scaled_##bd##_avx2;            \
+        c->inter.put_uni_w_scaled[LUMA][i]   = put_uni_luma_w_scaled_##bd##_avx2;            \
+        c->inter.put_uni_w_scaled[CHROMA][i] = put_uni_chroma_w_scaled_##bd##_avx2;          \
+    }                                                                                        \
+} while (0)
+
+#define INTRA_PROTOTYPES(bpc, opt)                                                                         \
+void BF(ff_vvc_intra_pred_planar, bpc, opt)(uint8_t *dst, ptrdiff_t stride, const uint8_t *top,            \
+    const uint8_t *left, intptr_t w, intptr_t h);                                                          \
+void BF(ff_vvc_intra_pred_dc, bpc, opt)(uint8_t *dst, ptrdiff_t stride, const uint8_t *top,                \
+    const uint8_t *left, intptr_t w, intptr_t h);                                                          \
+void BF(ff_vvc_intra_pred_v, bpc, opt)(uint8_t *dst, ptrdiff_t stride, const uint8_t *top,                 \
+    intptr_t w, intptr_t h);                                                                               \
+void BF(ff_vvc_intra_pred_h, bpc, opt)(uint8_t *dst, ptrdiff_t stride, const uint8_t *left,                \
+    intptr_t w, intptr_t h);                                                                               \
+void BF(ff_vvc_intra_pred_angular, bpc, opt)(uint8_t *dst, ptrdiff_t stride, const uint8_t *ref,           \
+    const int32_t *offsets, const int16_t *filters, intptr_t w, intptr_t h, intptr_t pixel_max);           \
+void BF(ff_vvc_intra_pdpc, bpc, opt)(uint8_t *dst, ptrdiff_t stride, const uint8_t *ref,                   \
+    const int32_t *offsets, const int16_t *weights, intptr_t w, intptr_t h, intptr_t pixel_max);           \
+
+INTRA_PROTOTYPES( 8, avx2)
+INTRA_PROTOTYPES(16, avx2)
+
+#define PDPC_COLS 16
+
+// the reference offset and the 4-tap filter of every row of an angular prediction, the
+// chroma and the integer positions are expressed with the luma filter layout
+static void intra_angular_rows(int32_t *offsets, int16_t (*filters)[4], const int n,
+    const int c_idx, const int mode, const int ref_idx, const int filter_flag)
+{
+    const int intra_pred_angle = ff_vvc_intra_pred_angle_derive(mode);
+    int pos = (1 + ref_idx) * intra_pred_angle;
+
+    for (int i = 0; i < n; i++) {
+        const int idx  = (pos >> 5) + ref_idx;
+        const int fact = pos & 31;
+        int16_t *f     = filters[i];
+
+        offsets[i] = idx - 1 - ref_idx;
+        if (!fact && (c_idx || !filter_flag)) {
+            f[0] = 0; f[1] = 64; f[2] = 0; f[3] = 0;
+        } else if (!c_idx) {
+            for (int k = 0; k < 4; k++)
+                f[k] = ff_vvc_intra_luma_filter[filter_flag][fact][k];
+        } else {
+            f[0] = 0; f[1] = 2 * (32 - fact); f[2] = 2 * fact; f[3] = 0;
+        }
+        pos += intra_pred_angle;
+    }
+}
+
+// the pdpc offsets and weights of the first n positions across the prediction direction
+static void intra_pdpc_cols(int32_t *offsets, int16_t *weights, const int n, const int w, const int h,
+    const int mode)
+{
+    const int inv_angle = ff_vvc_intra_inv_angle_derive(ff_vvc_intra_pred_angle_derive(mode));
+    const int nscale    = ff_vvc_nscale_derive(w, h, mode);
+    const int cols      = FFMIN(n, 3 << nscale);
+
+    for (int i = 0; i < PDPC_COLS; i++) {
+        offsets[i] = i < cols ? (256 + (i + 1) * inv_angle) >> 9 : 0;
+        weights[i] = i < cols ? 32 >> ((i << 1) >> nscale) : 0;
+    }
+}
+
+// pred_angular_h predicts the transposed block with the rows of pred_angular_v in tmp
+#define INTRA_FUNCS(bpc, bd)                                                                                   \
+static void bf(pred_planar, bd, avx2)(uint8_t *src, const uint8_t *top, const uint8_t *left,                  \
+    const int w, const int h, const ptrdiff_t stride)                                                          \
+{                                                                                                              \
+    BF(ff_vvc_intra_pred_planar, bpc, avx2)(src, stride * (bpc / 8), top, left, w, h);                         \
+}                                                                                                              \
+static void bf(pred_dc, bd, avx2)(uint8_t *src, const uint8_t *top, const uint8_t *left,                      \
+    const int w, const int h, const ptrdiff_t stride)                                                          \
+{                                                                                                              \
+    BF(ff_vvc_intra_pred_dc, bpc, avx2)(src, stride * (bpc / 8), top, left, w, h);                             \
+}                                                                                                              \
+static void bf(pred_v, bd, avx2)(uint8_t *src, const uint8_t *top, const int w, const int h,                  \
+    const ptrdiff_t stride)                                                                                    \
+{                                                                                                              \
+    BF(ff_vvc_intra_pred_v, bpc, avx2)(src, stride * (bpc / 8), top, w, h);                                    \
+}                                                                                                              \
+static void bf(pred_h, bd, avx2)(uint8_t *src, const uint8_t *left, const int w, const int h,                 \
+    const ptrdiff_t stride)                                                                                    \
+{                                                                                                              \
+    BF(ff_vvc_intra_pred_h, bpc, avx2)(src, stride * (bpc / 8), left, w, h);                                   \
+}                                                                                                              \
+static void bf(pred_angular_v, bd, avx2)(uint8_t *src, const uint8_t *top, const uint8_t *left,               \
+    const int w, const int h, const ptrdiff_t stride, const int c_idx, const int mode,                         \
+    const int ref_idx, const int filter_flag, const int need_pdpc)                                             \
+{                                                                                                              \
+    int32_t offsets[MAX_TB_SIZE];                                                                              \
+    int16_t filters[MAX_TB_SIZE][4];                                                                           \
+                                                                                                               \
+    intra_angular_rows(offsets, filters, h, c_idx, mode, ref_idx, filter_flag);                                \
+    BF(ff_vvc_intra_pred_angular, bpc, avx2)(src, stride * (bpc / 8), top, offsets, &filters[0][0],            \
+        w, h, (1 << bd) - 1);                                                                                  \
+    if (need_pdpc) {                                                                                           \
+        int16_t weights[PDPC_COLS];                                                                            \
+                                                                                                               \
+        intra_pdpc_cols(offsets, weights, w, w, h, mode);                                                      \
+        BF(ff_vvc_intra_pdpc, bpc, avx2)(src, stride * (bpc / 8), left, offsets, weights,                      \
+            FFMIN(w, PDPC_COLS), h, (1 << bd) - 1);                                                            \
+    }                                                                                                          \
+}                                                                                                              \
+static void bf(pred_angular_h, bd, avx2)(uint8_t *_src, const uint8_t *top, const uint8_t *left,              \
+    const int w, const int h, const ptrdiff_t stride, const int c_idx, const int mode,                         \
+    const int ref_idx, const int filter_flag, const int need_pdpc)                                             \
+{                                                                                                              \
+    LOCAL_ALIGNED_32(uint16_t, tmp, [MAX_TB_SIZE * MAX_TB_SIZE]);                                              \
+    const ptrdiff_t tmp_stride = MAX_TB_SIZE * (bpc / 8);                                                      \
+    const int tw = FFMAX(h, 2);                                                                                \
+    int32_t offsets[MAX_TB_SIZE];                                                                              \
+    int16_t filters[MAX_TB_SIZE][4];                                                                           \
+                                                                                                               \
+    intra_angular_rows(offsets, filters, w, c_idx, mode, ref_idx, filter_flag);                                \
+    BF(ff_vvc_intra_pred_angular, bpc, avx2)((uint8_t *)tmp, tmp_stride, left, offsets, &filters[0][0],        \
+        tw, w, (1 << bd) - 1);                                                                                 \
+    if (need_pdpc) {                                                                                           \
+        int16_t weights[PDPC_COLS];                                                                            \
+                                                                                                               \
+        intra_pdpc_cols(offsets, weights, h, w, h, mode);                                                      \
+        BF(ff_vvc_intra_pdpc, bpc, avx2)((uint8_t *)tmp, tmp_stride, top, offsets, weights,                    \
+            FFMIN(tw, PDPC_COLS), w, (1 << bd) - 1);                                                           \
+    }                                                                                                          \
+    for (int y = 0; y < h; y++) {                                                                              \
+        for (int x = 0; x < w; x++) {                                                                          \
+            if (bpc == 8)                                                                                      \
+                _src[y * stride + x] = ((const uint8_t *)tmp)[x * MAX_TB_SIZE + y];                            \
+            else                                                                                               \
+                ((uint16_t *)_src)[y * stride + x] = tmp[x * MAX_TB_SIZE + y];                                 \
+        }                                                                                                      \
+    }                                                                                                          \
+}
+
+INTRA_FUNCS(8,  8)
+INTRA_FUNCS(16, 10)
+INTRA_FUNCS(16, 12)
+
+#define INTRA_INIT(bd) do {                                                  \
+    c->intra.pred_planar        = pred_planar_##bd##_avx2;                   \
+    c->intra.pred_dc            = pred_dc_##bd##_avx2;                       \
+    c->intra.pred_v             = pred_v_##bd##_avx2;                        \
+    c->intra.pred_h             = pred_h_##bd##_avx2;                        \
+    c->intra.pred_angular_v     = pred_angular_v_##bd##_avx2;                \
+    c->intra.pred_angular_h     = pred_angular_h_##bd##_avx2;                \
+} while (0)
+
+void ff_vvc_mip_matrix_mul_avx2(int16_t *dst, const int16_t *reduced, const int16_t *matrix, intptr_t groups,
+    intptr_t pairs, intptr_t ow, intptr_t temp0, intptr_t pixel_max);
+
+#define MIP_PROTOTYPES(bpc, opt)                                                                           \
+void BF(ff_vvc_mip_upsample_h, bpc, opt)(uint8_t *dst, ptrdiff_t stride, const int16_t *pred,              \
+    const uint8_t *left, ptrdiff_t left_step, intptr_t w, intptr_t pred_size, intptr_t log2_factor);       \
+void BF(ff_vvc_mip_upsample_v, bpc, opt)(uint8_t *dst, ptrdiff_t stride, const uint8_t *top,               \
+    intptr_t w, intptr_t pred_size, intptr_t log2_factor);                                                 \
+
+MIP_PROTOTYPES( 8, avx2)
+MIP_PROTOTYPES(16, avx2)
+
+#define MIP_SIZE_IDS 3
+
+static const int mip_modes[MIP_SIZE_IDS]      = { 16, 8, 6 };
+static const int mip_pred_sizes[MIP_SIZE_IDS] = { 4, 4, 8 };
+static const int mip_in_sizes[MIP_SIZE_IDS]   = { 4, 8, 7 };
+
+// the matrices widened to words, [transposed][mode][output / 8][input / 2][output % 8][input % 2],
+// the transposed ones have their outputs in the order of the transposed prediction
+DECLARE_ALIGNED(32, static int16_t, mip_matrix_0)[2][16][ 2 * 2 * 16];
+DECLARE_ALIGNED(32, static int16_t, mip_matrix_1)[2][ 8][ 2 * 4 * 16];
+DECLARE_ALIGNED(32, static int16_t, mip_matrix_2)[2][ 6][ 8 * 4 * 16];
+
+static int16_t *mip_matrix(const int size_id, const int transposed, const int mode_id)
+{
+    if (size_id == 0)
+        return mip_matrix_0[transposed][mode_id];
+    if (size_id == 1)
+        return mip_matrix_1[transposed][mode_id];
+    return mip_matrix_2[transposed][mode_id];
+}
+
+static av_cold void mip_matrix_init(void)
+{
+    for (int size_id = 0; size_id < MIP_SIZE_IDS; size_id++) {
+        const int pred_size = mip_pred_sizes[size_id];
+        const int in_size   = mip_in_sizes[size_id];
+        const int pairs     = (in_size + 1) / 2;
+
+        for (int transposed = 0; transposed < 2; transposed++) {
+            for (int mode_id = 0; mode_id < mip_modes[size_id]; mode_id++) {
+                const uint8_t *src = ff_vvc_get_mip_matrix(size_id, mode_id);
+                int16_t *dst       = mip_matrix(size_id, transposed, mode_id);
+
+                for (int o = 0; o < pred_size * pred_size; o++) {
+                    const int row = transposed ? (o % pred_size) * pred_size + o / pred_size : o;
+
+                    for (int i = 0; i < 2 * pairs; i++)
+                        dst[((o / 8 * pairs + i / 2) * 8 + o % 8) * 2 + i % 2] = i < in_size ? src[row * in_size + i] : 0;
+                }
+            }
+        }
+    }
+}
+
+static av_always_inline void mip_downsampling(int16_t *reduced, const int boundary_size,
+    const uint8_t *_ref, const int n_tb_s, const int bd)
+{
+    const int b_dwn = n_tb_s / boundary_size;
+    const int log2  = av_log2(b_dwn);
+
+    for (int i = 0; i < boundary_size; i++) {
+        int r = 0;
+
+        for (int j = 0; j < b_dwn; j++) {
+            const int k = i * b_dwn + j;
+            r += bd == 8 ? _ref[k] : AV_RN16A(_ref + 2 * k);
+        }
+        reduced[i] = log2 ? (r + (1 << (log2 - 1))) >> log2 : r;
+    }
+}
+
+// the boundary downsampling of pred_mip() in vvc/intra_template.c, then the matrix product and the two
+// upsampling passes in asm
+static av_always_inline void pred_mip_avx2(uint8_t *src, const uint8_t *top, const uint8_t *left,
+    const int w, const int h, const ptrdiff_t stride, const int mode_id, const int is_transposed, const int bd)
+{
+    DECLARE_ALIGNED(32, int16_t, pred)[8 * 8];
+    DECLARE_ALIGNED(16, int16_t, reduced)[8] = { 0 };
+    const int size_id       = ff_vvc_get_mip_size_id(w, h);
+    const int boundary_size = size_id ? 4 : 2;
+    const int pred_size     = mip_pred_sizes[size_id];
+    const int in_size       = mip_in_sizes[size_id];
+    const int up_hor        = w / pred_size;
+    const int up_ver        = h / pred_size;
+    const int pixel_size    = (bd + 7) / 8;
+    int16_t *red_t          = reduced;
+    int16_t *red_l          = reduced + boundary_size;
+    int off = 1, ow, temp0;
+
+    if (is_transposed)
+        FFSWAP(int16_t *, red_t, red_l);
+    mip_downsampling(red_t, boundary_size, top, w, bd);
+    mip_downsampling(red_l, boundary_size, left, h, bd);
+
+    temp0 = reduced[0];
+    if (size_id != 2) {
+        off = 0;
+        ow  = (1 << (bd - 1)) - temp0;
+    } else {
+        ow  = reduced[1] - temp0;
+    }
+    reduced[0] = ow;
+    for (int i = 1; i < in_size; i++) {
+        reduced[i] = reduced[i + off] - temp0;
+        ow += reduced[i];
+    }
+    if (off)
+        reduced[in_size] = 0;
+    ow = 32 - 32 * ow;
+
+    ff_vvc_mip_matrix_mul_avx2(pred, reduced, mip_matrix(size_id, is_transposed, mode_id),
+        pred_size * pred_size / 8, (in_size + 1) / 2, ow, temp0, (1 << bd) - 1);
+    if (bd == 8) {
+        BF(ff_vvc_mip_upsample_h, 8, avx2)(src + (up_ver - 1) * stride, up_ver * stride, pred,
+            left + up_ver - 1, up_ver, w, pred_size, av_log2(up_hor));
+        if (up_ver > 1)
+            BF(ff_vvc_mip_upsample_v, 8, avx2)(src, stride, top, w, pred_size, av_log2(up_ver));
+    } else {
+        BF(ff_vvc_mip_upsample_h, 16, avx2)(src + (up_ver - 1) * stride * pixel_size, up_ver * stride * pixel_size,
+            pred, left + (up_ver - 1) * pixel_size, up_ver * pixel_size, w, pred_size, av_log2(up_hor));
+        if (up_ver > 1)
+            BF(ff_vvc_mip_upsample_v, 16, avx2)(src, stride * pixel_size, top, w, pred_size, av_log2(up_ver));
+    }
+}
+
+#define MIP_FUNC(bd)                                                                                  \
+static void bf(pred_mip, bd, avx2)(uint8_t *src, const uint8_t *top, const uint8_t *left,            \
+    int w, int h, ptrdiff_t stride, int mode_id, int is_transposed)                                   \
+{                                                                                                     \
+    pred_mip_avx2(src, top, left, w, h, stride, mode_id, is_transposed, bd);                          \
+}
+
+MIP_FUNC(8)
+MIP_FUNC(10)
+MIP_FUNC(12)
+
+#define MIP_INIT(bd) do {                                                    \
+    static AVOnce init_once = AV_ONCE_INIT;                                  \
+    ff_thread_once(&init_once, mip_matrix_init);                             \
+    c->intra.pred_mip           = pred_mip_##bd##_avx2;                      \
+} while (0)
+
+#define CCLM_PROTOTYPES(bpc, opt)                                                                          \
+void BF(ff_vvc_cclm_downsample_422, bpc, opt)(uint8_t *dsy, const uint8_t *src, ptrdiff_t stride,          \
+    intptr_t w, intptr_t h, intptr_t left, intptr_t top);                                                  \
+void BF(ff_vvc_cclm_downsample_420, bpc, opt)(uint8_t *dsy, const uint8_t *src, ptrdiff_t stride,          \
+    intptr_t w, intptr_t h, intptr_t left, intptr_t top);                                                  \
+void BF(ff_vvc_cclm_downsample_420_collocated, bpc, opt)(uint8_t *dsy, const uint8_t *src,                 \
+    ptrdiff_t stride, intptr_t w, intptr_t h, intptr_t left, intptr_t top);                                \
+void BF(ff_vvc_cclm_linear_pred, bpc, opt)(uint8_t *dst, ptrdiff_t stride, const uint8_t *dsy,             \
+    intptr_t w, intptr_t h, intptr_t a, intptr_t b, intptr_t k, intptr_t pixel_max);                       \
+
+CCLM_PROTOTYPES( 8, avx2)
+CCLM_PROTOTYPES(16, avx2)
+
+#define CCLM_FUNCS(bpc, bd)                                                                                    \
+static void bf(cclm_luma_downsample, bd, avx2)(uint8_t *dsy, const uint8_t *src, const ptrdiff_t stride,      \
+    const int w, const int h, const int vs, const int avail_t, const int avail_l, const int collocated)        \
+{                                                                                                              \
+    const ptrdiff_t byte_stride = stride * (bpc / 8);                                                          \
+    const ptrdiff_t left        = -avail_l * (bpc / 8);                                                        \
+    const ptrdiff_t top         = -avail_t * byte_stride;                                                      \
+                                                                                                               \
+    if (!vs)                                                                                                   \
+        BF(ff_vvc_cclm_downsample_422, bpc, avx2)(dsy, src, byte_stride, w, h, left, top);                    \
+    else if (collocated)                                                                                       \
+        BF(ff_vvc_cclm_downsample_420_collocated, bpc, avx2)(dsy, src, byte_stride, w, h, left, top);         \
+    else                                                                                                       \
+        BF(ff_vvc_cclm_downsample_420, bpc, avx2)(dsy, src, byte_stride, w, h, left, top);                    \
+}                                                                                                              \
+static void bf(cclm_linear_pred, bd, avx2)(uint8_t *src, const ptrdiff_t stride, const uint8_t *dsy,           \
+    const int w, const int h, const int a, const int b, const int k)                                           \
+{                                                                                                              \
+    BF(ff_vvc_cclm_linear_pred, bpc, avx2)(src, stride * (bpc / 8), dsy, w, h, a, b, k, (1 << bd) - 1);       \
+}
+
+CCLM_FUNCS(8,  8)
+CCLM_FUNCS(16, 10)
+CCLM_FUNCS(16, 12)
+
+#define CCLM_INIT(bd) do {                                                   \
+    c->intra.cclm_luma_downsample = cclm_luma_downsample_##bd##_avx2;        \
+    c->intra.cclm_linear_pred     = cclm_linear_pred_##bd##_avx2;            \
+} while (0)
+
+void ff_vvc_lmcs_filter_8bpc_avx2(uint8_t *dst, ptrdiff_t dst_stride, int width, int height, const void *lut);
+void ff_vvc_lmcs_filter_16bpc_avx2(uint8_t *dst, ptrdiff_t dst_stride, int width, int height, const void *lut);
+void ff_vvc_lmcs_scale_chroma_residual_avx2(int *dst, const int *coeff, intptr_t size, intptr_t chroma_scale,
+    intptr_t max);
+
+#define LMCS_FUNCS(bd)                                                                                 \
+static void bf(lmcs_scale_chroma_residual, bd, avx2)(int *dst, const int *coeff, const int width,     \
+    const int height, const int chroma_scale)                                                          \
+{                                                                                                      \
+    ff_vvc_lmcs_scale_chroma_residual_avx2(dst, coeff, width * height, chroma_scale, (1 << bd) - 1);   \
+}
+
+LMCS_FUNCS(8)
+LMCS_FUNCS(10)
+LMCS_FUNCS(12)
+
+#define LMCS_INIT(bpc, bd) do {                                              \
+    c->lmcs.filter                = BF(ff_vvc_lmcs_filter, bpc, avx2);       \
+    c->lmcs.scale_chroma_residual = lmcs_scale_chroma_residual_##bd##_avx2;  \
+} while (0)
+
+void ff_vvc_itx_pass_avx2(int *dst, const int *src, const int8_t *matrix, intptr_t size, intptr_t nz,
+    intptr_t lines, intptr_t src_stride, intptr_t dst_stride, intptr_t shift, intptr_t max);
+
+// the matrices are indexed [input][output], the dct2 ones are derived from the butterflies
+static int8_t itx_dct2_2[2 * 2], itx_dct2_4[4 * 4], itx_dct2_8[8 * 8];
+static int8_t itx_dct2_16[16 * 16], itx_dct2_32[32 * 32], itx_dct2_64[64 * 64];
+static const int8_t *const itx_matrix[N_TX_TYPE][N_TX_SIZE] = {
+    [DCT2] = { itx_dct2_2, itx_dct2_4, itx_dct2_8, itx_dct2_16, itx_dct2_32, itx_dct2_64 },
+    [DST7] = { NULL, &ff_vvc_dst7_4x4[0][0], &ff_vvc_dst7_8x8[0][0],
+               &ff_vvc_dst7_16x16[0][0], &ff_vvc_dst7_32x32[0][0] },
+    [DCT8] = { NULL, &ff_vvc_dct8_4x4[0][0], &ff_vvc_dct8_8x8[0][0],
+               &ff_vvc_dct8_16x16[0][0], &ff_vvc_dct8_32x32[0][0] },
+};
+
+static av_cold void itx_matrix_init(void)
+{
+    static const vvc_itx_1d_fn dct2[N_TX_SIZE] = {
+        ff_vvc_inv_dct2_2, ff_vvc_inv_dct2_4, ff_vvc_inv_dct2_8,
+        ff_vvc_inv_dct2_16, ff_vvc_inv_dct2_32, ff_vvc_inv_dct2_64,
+    };
+
+    for (int s = 0; s < N_TX_SIZE; s++) {
+        const int size = 2 << s;
+        int8_t *m      = (int8_t *)itx_matrix[DCT2][s];
+
+        for (int j = 0; j < size; j++) {
+            int v[64] = { 0 };
+
+            v[j] = 1;
+            dct2[s](v, 1, size);
+            for (int i = 0; i < size; i++)
+                m[j * size + i] = v[i];
+        }
+    }
+}
+
+static void itx_pass_c(int *dst, const int *src, const int8_t *matrix, const int size, const int nz,
+    const int lines, const ptrdiff_t src_stride, const ptrdiff_t dst_stride, const int shift, const int max)
+{
+    const int add = 1 << (shift - 1);
+
+    for (int l = 0; l < lines; l++) {
+        for (int i = 0; i < size; i++) {
+            int o = 0;
+
+            for (int j = 0; j < nz; j++)
+                o += src[j * src_stride + l] * matrix[j * size + i];
+            dst[l * dst_stride + i] = av_clip((o + add) >> shift, -max - 1, max);
+        }
+    }
+}
+
+static void itx_pass(int *dst, const int *src, const int8_t *matrix, const int size, const int nz,
+    const int lines, const ptrdiff_t src_stride, const ptrdiff_t dst_stride, const int shift, const int max)
+{
+    if (size >= 8)
+        ff_vvc_itx_pass_avx2(dst, src, matrix, size, nz, lines, src_stride, dst_stride, shift, max);
+    else
+        itx_pass_c(dst, src, matrix, size, nz, lines, src_stride, dst_stride, shift, max);
+}
+
+static void itx_2d_avx2(int *coeffs, const int log2_w, const int log2_h, const enum TxType trh, const enum TxType trv,
+    const size_t nzw, const size_t nzh, const int shift, const int log2_transform_range)
+{
+    LOCAL_ALIGNED_32(int, tmp, [MAX_TB_SIZE * MAX_TB_SIZE]);
+    const int w = 1 << log2_w;
+    const int h = 1 << log2_h;
+
+    // the vertical pass stores the columns as rows of tmp, so the zero columns are never touched
+    itx_pass(tmp, coeffs, itx_matrix[trv][log2_h - 1], h, nzh, nzw, w, h, 7, (1 << log2_transform_range) - 1);
+    itx_pass(coeffs, tmp, itx_matrix[trh][log2_w - 1], w, nzw, h, h, w, shift, INT_MAX);
+}
+
+static void lfnst_avx2(int *v, const int *u, const int no_zero_size, const int n_tr_s,
+    const int pred_mode_intra, const int lfnst_idx, const int log2_transform_range)
+{
+    const int tr_set_idx = pred_mode_intra < 0 ? 1 : ff_vvc_lfnst_tr_set_index[pred_mode_intra];
+    const int8_t *matrix = n_tr_s > 16 ? ff_vvc_lfnst_8x8[tr_set_idx][lfnst_idx - 1][0] :
+                                         ff_vvc_lfnst_4x4[tr_set_idx][lfnst_idx - 1][0];
+
+    ff_vvc_itx_pass_avx2(v, u, matrix, n_tr_s, no_zero_size, 1, 1, n_tr_s, 7, (1 << log2_transform_range) - 1);
+}
+
+void ff_vvc_transform_bdpcm_v_avx2(int *coeffs, intptr_t width, intptr_t height, intptr_t max);
+void ff_vvc_transform_bdpcm_h_avx2(int *coeffs, intptr_t width, intptr_t height, intptr_t max);
+
+static void transform_bdpcm_avx2(int *coeffs, const int width, const int height,
+    const int vertical, const int log2_transform_range)
+{
+    const int max = (1 << log2_transform_range) - 1;
+
+    if (vertical)
+        ff_vvc_transform_bdpcm_v_avx2(coeffs, width, height, max);
+    else
+        ff_vvc_transform_bdpcm_h_avx2(coeffs, width, height, max);
+}
+
+#define ITX_INIT() do {                                              \
+    static AVOnce init_once = AV_ONCE_INIT;                          \
+    ff_thread_once(&init_once, itx_matrix_init);                     \
+    c->itx.itx_2d          = itx_2d_avx2;                            \
+    c->itx.lfnst           = lfnst_avx2;                             \
+    c->itx.transform_bdpcm = transform_bdpcm_avx2;                   \
+} while (0)
 #endif
 
-void ff_vvc_dsp_init_x86(VVCDSPContext *const c, const int bd)
+void ff_vvc_dsp_init_x86(VVCDSPContext *const c, const int bd, const int cpu_flags)
 {
 #if ARCH_X86_64
-    const int cpu_flags = av_get_cpu_flags();
-
     switch (bd) {
     case 8:
         if (EXTERNAL_SSE4(cpu_flags)) {
@@ -328,9 +1197,26 @@ void ff_vvc_dsp_init_x86(VVCDSPContext *const c, const int bd)
         }
         if (EXTERNAL_AVX2_FAST(cpu_flags)) {
             ALF_INIT(8);
+            ADD_RES_INIT(8);
+            LF_INIT(8);
+            SAO_INIT(8);
             AVG_INIT(8, avx2);
             MC_LINKS_AVX2(8);
             SAD_INIT();
+            DMVR_INIT(8);
+            BDOF_INIT(8);
+            PROF_INIT(8);
+            BLEND_INIT(8);
+            SCALED_INIT(8);
+            INTRA_INIT(8);
+            MIP_INIT(8);
+            CCLM_INIT(8);
+            LMCS_INIT(8, 8);
+            ITX_INIT();
+        }
+        if (EXTERNAL_AVX512ICL(cpu_flags)) {
+            MC_LINKS_AVX512ICL();
+            ALF_AVX512ICL_INIT(8);
         }
         break;
     case 10:
@@ -339,10 +1225,26 @@ void ff_vvc_dsp_init_x86(VVCDSPContext *const c, const int bd)
         }
         if (EXTERNAL_AVX2_FAST(cpu_flags)) {
             ALF_INIT(10);
+            ADD_RES_INIT(10);
+            LF_INIT(10);
+            SAO_INIT(10);
             AVG_INIT(10, avx2);
             MC_LINKS_AVX2(10);
             MC_LINKS_16BPC_AVX2(10);
             SAD_INIT();
+            DMVR_INIT(10);
+            BDOF_INIT(10);
+            PROF_INIT(10);
+            BLEND_INIT(10);
+            SCALED_INIT(10);
+            INTRA_INIT(10);
+            MIP_INIT(10);
+            CCLM_INIT(10);
+            LMCS_INIT(16, 10);
+            ITX_INIT();
+        }
+        if (EXTERNAL_AVX512ICL(cpu_flags)) {
+            ALF_AVX512ICL_INIT(10);
         }
         break;
     case 12:
@@ -351,10 +1253,26 @@ void ff_vvc_dsp_init_x86(VVCDSPContext *const c, const int bd)
         }
         if (EXTERNAL_AVX2_FAST(cpu_flags)) {
             ALF_INIT(12);
+            ADD_RES_INIT(12);
+            LF_INIT(12);
+            SAO_INIT(12);
             AVG_INIT(12, avx2);
             MC_LINKS_AVX2(12);
             MC_LINKS_16BPC_AVX2(12);
             SAD_INIT();
+            DMVR_INIT(12);
+            BDOF_INIT(12);
+            PROF_INIT(12);
+            BLEND_INIT(12);
+            SCALED_INIT(12);
+            INTRA_INIT(12);
+            MIP_INIT(12);
+            CCLM_INIT(12);
+            LMCS_INIT(16, 12);
+            ITX_INIT();
+        }
+        if (EXTERNAL_AVX512ICL(cpu_flags)) {
+            ALF_AVX512ICL_INIT(12);
         }
         break;
     default:
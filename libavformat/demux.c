@@ -1246,6 +1246,16 @@ static int parse_packet(AVFormatContext *s, AVPacket *pkt,
         if (sti->parser->key_frame == -1 && sti->parser->pict_type ==AV_PICTURE_TYPE_NONE && (pkt->flags&AV_PKT_FLAG_KEY))
             out_pkt->flags |= AV_PKT_FLAG_KEY;
 
+        if (sti->parser->recovery_distance >= 0 && (out_pkt->flags & AV_PKT_FLAG_KEY) &&
+            !av_packet_get_side_data(out_pkt, AV_PKT_DATA_RECOVERY_POINT, NULL)) {
+            uint8_t *sd = av_packet_new_side_data(out_pkt, AV_PKT_DATA_RECOVERY_POINT, 4);
+            if (!sd) {
+                ret = AVERROR(ENOMEM);
+                goto fail;
+            }
+            AV_WL32(sd, sti->parser->recovery_distance);
+        }
+
         compute_pkt_fields(s, st, sti->parser, out_pkt, next_dts, next_pts);
 
         ret = avpriv_packet_list_put(&si->parse_queue,
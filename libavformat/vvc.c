@@ -20,6 +20,7 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include "libavcodec/defs.h"
 #include "libavcodec/get_bits.h"
 #include "libavcodec/put_bits.h"
 #include "libavcodec/golomb.h"
@@ -29,7 +30,6 @@
 #include "libavutil/mem.h"
 #include "avc.h"
 #include "avio.h"
-#include "avio_internal.h"
 #include "nal.h"
 #include "vvc.h"
 
@@ -807,71 +807,71 @@ static int vvcc_write(AVIOContext *pb, VVCDecoderConfigurationRecord *vvcc)
     return 0;
 }
 
-int ff_vvc_annexb2mp4(AVIOContext *pb, const uint8_t *buf_in,
+/**
+ * Convert the Annex B NAL units of buf_in in a single pass, writing them with
+ * their 32 bit sizes to pb, or to out when pb is NULL.
+ */
+static int annexb2mp4(AVIOContext *pb, uint8_t *out, const uint8_t *buf_in,
                       int size, int filter_ps, int *ps_count)
 {
+    const uint8_t *end = buf_in + size;
+    const uint8_t *nal_start, *nal_end;
     int num_ps = 0, ret = 0;
-    uint8_t *buf, *end, *start = NULL;
-
-    if (!filter_ps) {
-        ret = ff_nal_parse_units(pb, buf_in, size);
-        goto end;
-    }
 
-    ret = ff_nal_parse_units_buf(buf_in, &start, &size);
-    if (ret < 0)
-        goto end;
-
-    ret = 0;
-    buf = start;
-    end = start + size;
+    nal_start = ff_nal_find_startcode(buf_in, end);
+    for (;;) {
+        uint32_t len;
 
-    while (end - buf > 4) {
-        uint32_t len = FFMIN(AV_RB32(buf), end - buf - 4);
-        uint8_t type = (buf[5] >> 3);
+        while (nal_start < end && !*(nal_start++));
+        if (nal_start == end)
+            break;
 
-        buf += 4;
+        nal_end = ff_nal_find_startcode(nal_start, end);
+        len     = nal_end - nal_start;
 
-        switch (type) {
-        case VVC_VPS_NUT:
-        case VVC_SPS_NUT:
-        case VVC_PPS_NUT:
+        if (filter_ps && len > 1 &&
+            (nal_start[1] >> 3 == VVC_VPS_NUT || nal_start[1] >> 3 == VVC_SPS_NUT ||
+             nal_start[1] >> 3 == VVC_PPS_NUT)) {
             num_ps++;
-            break;
-        default:
-            ret += 4 + len;
+        } else if (pb) {
             avio_wb32(pb, len);
-            avio_write(pb, buf, len);
-            break;
+            avio_write(pb, nal_start, len);
+            ret += 4 + len;
+        } else {
+            AV_WB32(out + ret, len);
+            memcpy(out + ret + 4, nal_start, len);
+            ret += 4 + len;
         }
-
-        buf += len;
+        nal_start = nal_end;
     }
 
-  end:
-    av_free(start);
     if (ps_count)
         *ps_count = num_ps;
     return ret;
 }
 
+int ff_vvc_annexb2mp4(AVIOContext *pb, const uint8_t *buf_in,
+                      int size, int filter_ps, int *ps_count)
+{
+    return annexb2mp4(pb, NULL, buf_in, size, filter_ps, ps_count);
+}
+
 int ff_vvc_annexb2mp4_buf(const uint8_t *buf_in, uint8_t **buf_out,
                           int *size, int filter_ps, int *ps_count)
 {
-    AVIOContext *pb;
-    int ret;
-
-    ret = avio_open_dyn_buf(&pb);
-    if (ret < 0)
-        return ret;
-
-    ret = ff_vvc_annexb2mp4(pb, buf_in, *size, filter_ps, ps_count);
-    if (ret < 0) {
-        ffio_free_dyn_buf(&pb);
-        return ret;
-    }
-
-    *size = avio_close_dyn_buf(pb, buf_out);
+    uint8_t *out;
+
+    // every nal unit takes at least 4 bytes with its start code, and 1 more
+    // with its size field
+    if (*size > (INT_MAX - AV_INPUT_BUFFER_PADDING_SIZE) / 5 * 4)
+        return AVERROR(ERANGE);
+    out = av_malloc(*size + *size / 4 + 1 + AV_INPUT_BUFFER_PADDING_SIZE);
+    if (!out)
+        return AVERROR(ENOMEM);
+
+    *size = annexb2mp4(NULL, out, buf_in, *size, filter_ps, ps_count);
+    memset(out + *size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+    *buf_out = out;
 
     return 0;
 }
@@ -19,11 +19,33 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include <inttypes.h>
+
+#include "libavutil/avstring.h"
+#include "libavutil/file.h"
+#include "libavutil/opt.h"
+
+#include "libavcodec/startcode.h"
 #include "libavcodec/vvc.h"
 
 #include "avformat.h"
+#include "internal.h"
 #include "rawdec.h"
 
+#define INDEX_HEADER "FFVVCINDEX 1"
+
+#define IS_H266_SLICE(nut) (nut <= VVC_RASL_NUT || (nut >= VVC_IDR_W_RADL && nut <= VVC_GDR_NUT))
+
+typedef struct VVCDemuxContext {
+    FFRawVideoDemuxerContext raw;
+
+    char *index_file;
+    int nb_loaded_entries;
+
+    int use_mmap;
+    AVBufferRef *map;   ///< the whole file with use_mmap, the packets reference it
+} VVCDemuxContext;
+
 static int check_temporal_id(uint8_t nuh_temporal_id_plus1, int type)
 {
     if (nuh_temporal_id_plus1 == 0)
@@ -42,14 +64,15 @@ static int check_temporal_id(uint8_t nuh_temporal_id_plus1, int type)
 
 static int vvc_probe(const AVProbeData *p)
 {
+    // the second byte of the nal unit header follows the start code
+    const uint8_t *ptr = p->buf, *end = p->buf + p->buf_size - 1;
     uint32_t code = -1;
     int sps = 0, pps = 0, irap = 0;
-    int i;
 
-    for (i = 0; i < p->buf_size - 1; i++) {
-        code = (code << 8) + p->buf[i];
+    while (ptr < end) {
+        ptr = avpriv_find_start_code(ptr, end, &code);
         if ((code & 0xffffff00) == 0x100) {
-            uint8_t nal2 = p->buf[i + 1];
+            uint8_t nal2 = *ptr;
             int type = (nal2 & 0xF8) >> 3;
 
             if (code & 0x80) // forbidden_zero_bit
@@ -74,4 +97,280 @@ static int vvc_probe(const AVProbeData *p)
     return 0;
 }
 
-FF_DEF_RAWVIDEO_DEMUXER(vvc, "raw H.266/VVC video", vvc_probe, "h266,266,vvc", AV_CODEC_ID_VVC)
+/**
+ * The index file holds a header line, a line with the size of the stream,
+ * the time base and the frame rate the timestamps were generated with, then
+ * one "<byte offset> <timestamp>" line per IRAP access unit.
+ */
+static int read_index(AVFormatContext *s)
+{
+    VVCDemuxContext *ctx = s->priv_data;
+    AVStream *st         = s->streams[0];
+    AVIOContext *pb;
+    AVRational tb, rate;
+    char line[128];
+    int64_t size, pos, ts;
+    int ret;
+
+    ret = s->io_open(s, &pb, ctx->index_file, AVIO_FLAG_READ, NULL);
+    if (ret < 0) {
+        // not created yet
+        av_log(s, AV_LOG_VERBOSE, "Could not open index file %s\n", ctx->index_file);
+        return 0;
+    }
+
+    ff_get_chomp_line(pb, line, sizeof(line));
+    if (strcmp(line, INDEX_HEADER)) {
+        av_log(s, AV_LOG_WARNING, "%s is not a VVC index file, ignoring it\n", ctx->index_file);
+        goto end;
+    }
+    ff_get_chomp_line(pb, line, sizeof(line));
+    if (sscanf(line, "%"SCNd64" %d/%d %d/%d", &size, &tb.num, &tb.den, &rate.num, &rate.den) != 5 ||
+        size != avio_size(s->pb) || av_cmp_q(tb, st->time_base) || av_cmp_q(rate, ctx->raw.framerate)) {
+        av_log(s, AV_LOG_WARNING, "Index file %s does not match the stream, ignoring it\n", ctx->index_file);
+        goto end;
+    }
+
+    while (ff_get_chomp_line(pb, line, sizeof(line)) > 0) {
+        if (sscanf(line, "%"SCNd64" %"SCNd64, &pos, &ts) != 2 || pos < 0 || pos >= size) {
+            av_log(s, AV_LOG_WARNING, "Invalid entry in index file %s\n", ctx->index_file);
+            break;
+        }
+        ret = av_add_index_entry(st, pos, ts, 0, 0, AVINDEX_KEYFRAME);
+        if (ret < 0)
+            break;
+    }
+    ctx->nb_loaded_entries = ffstream(st)->nb_index_entries;
+    av_log(s, AV_LOG_VERBOSE, "Loaded %d index entries from %s\n",
+           ctx->nb_loaded_entries, ctx->index_file);
+
+end:
+    ff_format_io_close(s, &pb);
+    return 0;
+}
+
+static int write_index(AVFormatContext *s)
+{
+    VVCDemuxContext *ctx = s->priv_data;
+    AVStream *st         = s->streams[0];
+    const FFStream *sti  = ffstream(st);
+    const int64_t size   = avio_size(s->pb);
+    AVIOContext *pb;
+    int ret;
+
+    ret = s->io_open(s, &pb, ctx->index_file, AVIO_FLAG_WRITE, NULL);
+    if (ret < 0) {
+        av_log(s, AV_LOG_WARNING, "Could not write index file %s\n", ctx->index_file);
+        return ret;
+    }
+
+    avio_printf(pb, INDEX_HEADER "\n%"PRId64" %d/%d %d/%d\n", size,
+                st->time_base.num, st->time_base.den, ctx->raw.framerate.num, ctx->raw.framerate.den);
+    for (int i = 0; i < sti->nb_index_entries; i++)
+        avio_printf(pb, "%"PRId64" %"PRId64"\n", sti->index_entries[i].pos, sti->index_entries[i].timestamp);
+
+    return ff_format_io_close(s, &pb);
+}
+
+static void unmap_file(void *opaque, uint8_t *data)
+{
+    av_file_unmap(data, (uintptr_t)opaque);
+}
+
+static int map_file(AVFormatContext *s)
+{
+    VVCDemuxContext *ctx = s->priv_data;
+    const char *proto    = avio_find_protocol_name(s->url);
+    const char *filename = s->url;
+    uint8_t *data;
+    size_t size;
+    int ret;
+
+    if ((s->flags & AVFMT_FLAG_CUSTOM_IO) || !proto || strcmp(proto, "file")) {
+        av_log(s, AV_LOG_WARNING, "mmap needs a local file, reading %s through the I/O context\n", s->url);
+        return 0;
+    }
+    av_strstart(filename, "file:", &filename);
+
+    ret = av_file_map(filename, &data, &size, 0, s);
+    if (ret < 0)
+        return ret;
+    if (!size)
+        return 0;
+
+    ctx->map = av_buffer_create(data, size, unmap_file, (void *)(uintptr_t)size, AV_BUFFER_FLAG_READONLY);
+    if (!ctx->map) {
+        av_file_unmap(data, size);
+        return AVERROR(ENOMEM);
+    }
+    // the packets are whole access units, the parser only reads their headers
+    ffstream(s->streams[0])->need_parsing = AVSTREAM_PARSE_HEADERS;
+
+    return 0;
+}
+
+static int vvc_read_header(AVFormatContext *s)
+{
+    VVCDemuxContext *ctx = s->priv_data;
+    int ret;
+
+    ret = ff_raw_video_read_header(s);
+    if (ret < 0)
+        return ret;
+
+    if (ctx->use_mmap) {
+        ret = map_file(s);
+        if (ret < 0)
+            return ret;
+    }
+
+    if (ctx->index_file && (s->pb->seekable & AVIO_SEEKABLE_NORMAL))
+        return read_index(s);
+    return 0;
+}
+
+/**
+ * Find the end of the picture unit starting at buf, with the rules of the
+ * parser: it ends before the first non-VCL prefix unit or the first slice
+ * of the next picture.
+ */
+static int find_pu_end(const uint8_t *buf, int size)
+{
+    const uint8_t *ptr = buf, *end = buf + size;
+    uint32_t code      = -1;
+    int frame_start    = 0;
+
+    while (ptr < end) {
+        const uint8_t *start;
+        int nut;
+
+        // ptr is after the first byte of the nal unit header
+        ptr = avpriv_find_start_code(ptr, end, &code);
+        if ((code & 0xffffff00) != 0x100 || ptr >= end)
+            break;
+
+        nut   = *ptr >> 3;
+        start = ptr - 4;
+        if (start > buf && !start[-1])
+            start--;
+
+        // 7.4.2.4.3 and 7.4.2.4.4
+        if ((nut >= VVC_OPI_NUT && nut <= VVC_PREFIX_APS_NUT && nut != VVC_PH_NUT) || nut == VVC_AUD_NUT ||
+            (nut == VVC_PREFIX_SEI_NUT && !frame_start) ||
+            nut == VVC_RSV_NVCL_26 || nut == VVC_UNSPEC_28 || nut == VVC_UNSPEC_29) {
+            if (frame_start)
+                return start - buf;
+        } else if (nut == VVC_PH_NUT || (IS_H266_SLICE(nut) && ptr + 1 < end && ptr[1] >> 7)) {
+            // a picture header, or a slice with sh_picture_header_in_slice_header_flag
+            if (frame_start)
+                return start - buf;
+            frame_start = 1;
+        }
+    }
+    return size;
+}
+
+/**
+ * The padding of a packet referencing the mapping is the start of the next
+ * picture unit instead of zeros. It must start with a start code, so that the
+ * first 23 bits of the padding are zero as AV_INPUT_BUFFER_PADDING_SIZE
+ * requires; the readers stop there.
+ */
+static int padding_usable(const uint8_t *padding)
+{
+    return !padding[0] && !padding[1] && padding[2] <= 1;
+}
+
+/**
+ * With use_mmap, output each picture unit as a packet referencing the mapped
+ * file. The stream position is still kept in the I/O context for seeking.
+ */
+static int vvc_read_packet(AVFormatContext *s, AVPacket *pkt)
+{
+    VVCDemuxContext *ctx = s->priv_data;
+    int64_t pos;
+    size_t left;
+    int size, ret;
+
+    if (!ctx->map)
+        return ff_raw_read_partial_packet(s, pkt);
+
+    pos = avio_tell(s->pb);
+    if (pos < 0)
+        return pos;
+    if (pos >= ctx->map->size)
+        return AVERROR_EOF;
+
+    // a packet holds at most INT_MAX bytes, a longer picture unit is split
+    left = ctx->map->size - pos;
+    size = find_pu_end(ctx->map->data + pos, FFMIN(left, INT_MAX - AV_INPUT_BUFFER_PADDING_SIZE));
+    // the padding of the last packets would be past the end of the mapping
+    if (pos + size + AV_INPUT_BUFFER_PADDING_SIZE > ctx->map->size ||
+        !padding_usable(ctx->map->data + pos + size)) {
+        ret = av_new_packet(pkt, size);
+        if (ret < 0)
+            return ret;
+        memcpy(pkt->data, ctx->map->data + pos, size);
+    } else {
+        pkt->buf = av_buffer_ref(ctx->map);
+        if (!pkt->buf)
+            return AVERROR(ENOMEM);
+        pkt->data = ctx->map->data + pos;
+        pkt->size = size;
+    }
+    pkt->pos          = pos;
+    pkt->stream_index = 0;
+    // the parser does not derive it for complete frames
+    pkt->duration     = av_rescale_q(1, av_inv_q(ctx->raw.framerate), s->streams[0]->time_base);
+
+    ret = avio_seek(s->pb, pos + size, SEEK_SET);
+    if (ret < 0) {
+        av_packet_unref(pkt);
+        return ret;
+    }
+    return 0;
+}
+
+static int vvc_read_close(AVFormatContext *s)
+{
+    VVCDemuxContext *ctx = s->priv_data;
+
+    av_buffer_unref(&ctx->map);
+
+    // only rewrite the index when demuxing found new IRAPs
+    if (ctx->index_file && s->nb_streams && (s->pb->seekable & AVIO_SEEKABLE_NORMAL) &&
+        ffstream(s->streams[0])->nb_index_entries > ctx->nb_loaded_entries)
+        write_index(s);
+    return 0;
+}
+
+#define OFFSET(x) offsetof(VVCDemuxContext, x)
+#define DEC AV_OPT_FLAG_DECODING_PARAM
+static const AVOption vvc_options[] = {
+    { "framerate",       "", OFFSET(raw.framerate),       AV_OPT_TYPE_VIDEO_RATE, { .str = "25" }, 0, INT_MAX, DEC },
+    { "raw_packet_size", "", OFFSET(raw.raw_packet_size), AV_OPT_TYPE_INT, { .i64 = 1024 }, 1, INT_MAX, DEC },
+    { "index_file", "load and save the IRAP seek index from/to this file", OFFSET(index_file), AV_OPT_TYPE_STRING, { .str = NULL }, 0, 0, DEC },
+    { "mmap", "map a local file and output its picture units without copying them", OFFSET(use_mmap), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, DEC },
+    { NULL },
+};
+
+static const AVClass vvc_demuxer_class = {
+    .class_name = "vvc demuxer",
+    .item_name  = av_default_item_name,
+    .option     = vvc_options,
+    .version    = LIBAVUTIL_VERSION_INT,
+};
+
+const FFInputFormat ff_vvc_demuxer = {
+    .p.name         = "vvc",
+    .p.long_name    = NULL_IF_CONFIG_SMALL("raw H.266/VVC video"),
+    .p.extensions   = "h266,266,vvc",
+    .p.flags        = AVFMT_GENERIC_INDEX | AVFMT_NOTIMESTAMPS,
+    .p.priv_class   = &vvc_demuxer_class,
+    .read_probe     = vvc_probe,
+    .read_header    = vvc_read_header,
+    .read_packet    = vvc_read_packet,
+    .read_close     = vvc_read_close,
+    .raw_codec_id   = AV_CODEC_ID_VVC,
+    .priv_data_size = sizeof(VVCDemuxContext),
+};
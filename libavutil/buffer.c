@@ -90,6 +90,22 @@ AVBufferRef *av_buffer_alloc(size_t size)
     return ret;
 }
 
+AVBufferRef *av_buffer_alloc_huge(size_t size)
+{
+    AVBufferRef *ret = NULL;
+    uint8_t    *data = NULL;
+
+    data = av_malloc_huge(size);
+    if (!data)
+        return NULL;
+
+    ret = av_buffer_create(data, size, av_buffer_default_free, NULL, 0);
+    if (!ret)
+        av_freep(&data);
+
+    return ret;
+}
+
 AVBufferRef *av_buffer_allocz(size_t size)
 {
     AVBufferRef *ret = av_buffer_alloc(size);
@@ -273,6 +289,9 @@ AVBufferPool *av_buffer_pool_init2(size_t size, void *opaque,
     pool->pool_free = pool_free;
 
     atomic_init(&pool->refcount, 1);
+    atomic_init(&pool->released, 0);
+    atomic_init(&pool->nb_cached, 0);
+    atomic_init(&pool->max_cached, 0);
 
     return pool;
 }
@@ -289,19 +308,48 @@ AVBufferPool *av_buffer_pool_init(size_t size, AVBufferRef* (*alloc)(size_t size
     pool->alloc    = alloc ? alloc : av_buffer_alloc;
 
     atomic_init(&pool->refcount, 1);
+    atomic_init(&pool->released, 0);
+    atomic_init(&pool->nb_cached, 0);
+    atomic_init(&pool->max_cached, 0);
 
     return pool;
 }
 
+void av_buffer_pool_set_max_cached(AVBufferPool *pool, size_t max_size)
+{
+    atomic_store_explicit(&pool->max_cached, max_size, memory_order_relaxed);
+}
+
+static void pool_entry_free(BufferPoolEntry *buf)
+{
+    buf->free(buf->opaque, buf->data);
+    av_free(buf);
+}
+
+/* move the buffers released without the mutex to pool, must hold the mutex */
+static void buffer_pool_take_released(AVBufferPool *pool)
+{
+    if (!pool->pool)
+        pool->pool = (BufferPoolEntry*)atomic_exchange_explicit(&pool->released, 0,
+                                                                memory_order_acquire);
+}
+
 static void buffer_pool_flush(AVBufferPool *pool)
 {
-    while (pool->pool) {
-        BufferPoolEntry *buf = pool->pool;
-        pool->pool = buf->next;
+    size_t nb = 0;
 
-        buf->free(buf->opaque, buf->data);
-        av_freep(&buf);
-    }
+    do {
+        while (pool->pool) {
+            BufferPoolEntry *buf = pool->pool;
+            pool->pool = buf->next;
+
+            pool_entry_free(buf);
+            nb++;
+        }
+        buffer_pool_take_released(pool);
+    } while (pool->pool);
+
+    atomic_fetch_sub_explicit(&pool->nb_cached, nb, memory_order_relaxed);
 }
 
 /*
@@ -340,11 +388,21 @@ static void pool_release_buffer(void *opaque, uint8_t *data)
 {
     BufferPoolEntry *buf = opaque;
     AVBufferPool *pool = buf->pool;
+    const size_t max_cached = atomic_load_explicit(&pool->max_cached, memory_order_relaxed);
+    const size_t nb_cached  = atomic_fetch_add_explicit(&pool->nb_cached, 1, memory_order_relaxed);
 
-    ff_mutex_lock(&pool->mutex);
-    buf->next = pool->pool;
-    pool->pool = buf;
-    ff_mutex_unlock(&pool->mutex);
+    if (max_cached && (nb_cached + 1) * pool->size > max_cached) {
+        // keep at most max_cached bytes of idle buffers
+        atomic_fetch_sub_explicit(&pool->nb_cached, 1, memory_order_relaxed);
+        pool_entry_free(buf);
+    } else {
+        uintptr_t head = atomic_load_explicit(&pool->released, memory_order_relaxed);
+        do {
+            buf->next = (BufferPoolEntry*)head;
+        } while (!atomic_compare_exchange_weak_explicit(&pool->released, &head, (uintptr_t)buf,
+                                                        memory_order_release,
+                                                        memory_order_relaxed));
+    }
 
     if (atomic_fetch_sub_explicit(&pool->refcount, 1, memory_order_acq_rel) == 1)
         buffer_pool_free(pool);
@@ -387,6 +445,7 @@ AVBufferRef *av_buffer_pool_get(AVBufferPool *pool)
     BufferPoolEntry *buf;
 
     ff_mutex_lock(&pool->mutex);
+    buffer_pool_take_released(pool);
     buf = pool->pool;
     if (buf) {
         memset(&buf->buffer, 0, sizeof(buf->buffer));
@@ -396,6 +455,7 @@ AVBufferRef *av_buffer_pool_get(AVBufferPool *pool)
             pool->pool = buf->next;
             buf->next = NULL;
             buf->buffer.flags_internal |= BUFFER_FLAG_NO_FREE;
+            atomic_fetch_sub_explicit(&pool->nb_cached, 1, memory_order_relaxed);
         }
     } else {
         ret = pool_alloc_buffer(pool);
@@ -107,6 +107,13 @@ AVBufferRef *av_buffer_alloc(size_t size);
  */
 AVBufferRef *av_buffer_allocz(size_t size);
 
+/**
+ * Same as av_buffer_alloc(), except the data is allocated with
+ * av_malloc_huge(). It can be passed to av_buffer_pool_init() to back the
+ * buffers of a pool with huge pages.
+ */
+AVBufferRef *av_buffer_alloc_huge(size_t size);
+
 /**
  * Always treat the buffer as read-only, even when it has only one
  * reference.
@@ -244,7 +251,9 @@ int av_buffer_replace(AVBufferRef **dst, const AVBufferRef *src);
  *
  * Allocating and releasing buffers with this API is thread-safe as long as
  * either the default alloc callback is used, or the user-supplied one is
- * thread-safe.
+ * thread-safe. Releasing a buffer does not lock the pool, so buffers may be
+ * released from many threads without contention; the most recently released
+ * buffers are reused first.
  */
 
 /**
@@ -302,6 +311,18 @@ void av_buffer_pool_uninit(AVBufferPool **pool);
  */
 AVBufferRef *av_buffer_pool_get(AVBufferPool *pool);
 
+/**
+ * Limit the total size of the unused buffers kept by the pool. Buffers
+ * released while the limit is reached are freed instead of being kept for
+ * reuse. By default, all released buffers are kept.
+ *
+ * This function may be called at any time, also while buffers are in use.
+ *
+ * @param max_size maximum size in bytes of the buffers cached by the pool, 0
+ *                 for no limit
+ */
+void av_buffer_pool_set_max_cached(AVBufferPool *pool, size_t max_size);
+
 /**
  * Query the original opaque parameter of an allocated buffer in the pool.
  *
@@ -89,6 +89,19 @@ struct AVBufferPool {
     AVMutex mutex;
     BufferPoolEntry *pool;
 
+    /*
+     * Released buffers are pushed here without taking the mutex. The list is
+     * only taken as a whole, with the mutex held, when pool is empty, so the
+     * pushes cannot suffer from ABA.
+     */
+    atomic_uintptr_t released;
+    /*
+     * Number of buffers in pool and released, and the limit of their total
+     * size set with av_buffer_pool_set_max_cached(), 0 for none.
+     */
+    atomic_size_t nb_cached;
+    atomic_size_t max_cached;
+
     /*
      * This is used to track when the pool is to be freed.
      * The pointer to the pool itself held by the caller is considered to
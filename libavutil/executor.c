@@ -20,8 +20,27 @@
 
 #include "config.h"
 
+#if HAVE_SCHED_GETAFFINITY
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE
+#endif
+#include <sched.h>
+#endif
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if HAVE_GETPROCESSAFFINITYMASK
+#include <windows.h>
+#endif
+
+#include "common.h"
+#include "intmath.h"
 #include "mem.h"
 #include "thread.h"
+#include "time.h"
 
 #include "executor.h"
 
@@ -41,25 +60,125 @@
 
 #endif //!HAVE_THREADS
 
+#ifdef COMPAT_ATOMICS_WIN32_STDATOMIC_H
+typedef intptr_t  atomic_ptr_val;
+#else
+typedef uintptr_t atomic_ptr_val;
+#endif
+
+// A task of a few microseconds is often followed by the one it made ready, so an idle
+// worker polls for a while before it parks, which costs a futex wait and its wakeup.
+#define SPIN_MIN    16
+#define SPIN_MAX    4096
+
+typedef struct TaskQueue {
+    // ordered by priority_higher()
+    AVTask *tasks;
+
+    // per bucket FIFOs, used if AVTaskCallbacksExt.priority is set
+    AVTask *heads[AV_EXECUTOR_PRIORITIES];
+    AVTask *tails[AV_EXECUTOR_PRIORITIES];
+    uint64_t non_empty;
+
+    int nb_tasks;
+} TaskQueue;
+
+typedef struct ExecutorGroup {
+    // lock-free LIFO of submitted tasks, drained by the first worker of the group that wakes up
+    atomic_uintptr_t submitted;
+} ExecutorGroup;
+
+// written by the owning thread only, read by av_executor_get_stats()
+typedef struct WorkerStats {
+    atomic_uint_least64_t tasks;
+    atomic_uint_least64_t stolen;
+    atomic_uint_least64_t polls;
+    atomic_uint_least64_t queue_samples;
+    atomic_uint_least64_t queue_sum;
+    atomic_int            max_queue;
+    atomic_int_least64_t  lock_wait;
+    atomic_int_least64_t  lock_hold;
+    atomic_int_least64_t  run;
+    atomic_int_least64_t  idle;
+} WorkerStats;
+
 typedef struct ThreadInfo {
     AVExecutor *e;
     ExecutorThread thread;
+    void *local_context;            ///< allocated when the worker is spawned
+
+    int cpu;                        ///< cpu the worker is pinned to, or -1
+    int group;
+
+    // local queue, other workers steal from it
+    AVMutex lock;
+    TaskQueue q;
+
+    WorkerStats stats;
+    int64_t locked;                 ///< when this thread took a queue lock, for the stats
+
+    int spin;                       ///< pauses before parking, adapted to how often spinning found work
 } ThreadInfo;
 
 struct AVExecutor {
     AVTaskCallbacks cb;
-    int thread_count;
+    AVTaskCallbacksExt ext;         ///< the fields the caller did not know of are NULL
+    int threaded;                   ///< allocated with worker threads
+    int thread_count;               ///< workers spawned, only changed by av_executor_set_thread_count()
+    atomic_int nb_active;           ///< workers with a lower index keep running, the others exit
 
     ThreadInfo *threads;
-    uint8_t *local_contexts;
+    int nb_threads;                 ///< number of ThreadInfo, at least one for the caller's thread
+    int nb_thread_locks;
+
+    // workers sharing a NUMA node, tasks are submitted to the group they prefer
+    ExecutorGroup *groups;
+    int nb_groups;
+
+    int stats;                      ///< AV_EXECUTOR_FLAG_STATS
 
+    // bumped whenever new work may be available, parked workers recheck it before sleeping
+    atomic_uint seq;
+    atomic_int nb_sleeping;
+    atomic_int nb_spinning;         ///< idle workers not parked yet, which see seq change by themselves
+
+    // only used to park idle workers
     AVMutex lock;
     AVCond cond;
-    int die;
-
-    AVTask *tasks;
+    atomic_int die;
 };
 
+static void stat_add(atomic_uint_least64_t *stat, const uint64_t v)
+{
+    atomic_fetch_add_explicit(stat, v, memory_order_relaxed);
+}
+
+static void stat_add_time(atomic_int_least64_t *stat, const int64_t v)
+{
+    atomic_fetch_add_explicit(stat, v, memory_order_relaxed);
+}
+
+// lock the queue of ti from the thread self, NULL for a thread that is not a worker
+static void queue_lock(AVExecutor *e, ThreadInfo *self, ThreadInfo *ti)
+{
+    if (e->stats && self) {
+        const int64_t start = av_gettime_relative();
+
+        ff_mutex_lock(&ti->lock);
+        self->locked = av_gettime_relative();
+        stat_add_time(&self->stats.lock_wait, self->locked - start);
+    } else {
+        ff_mutex_lock(&ti->lock);
+    }
+}
+
+static void queue_unlock(AVExecutor *e, ThreadInfo *self, ThreadInfo *ti)
+{
+    if (e->stats && self)
+        stat_add_time(&self->stats.lock_hold, av_gettime_relative() - self->locked);
+    ff_mutex_unlock(&ti->lock);
+}
+
 static AVTask* remove_task(AVTask **prev, AVTask *t)
 {
     *prev  = t->next;
@@ -73,52 +192,488 @@ static void add_task(AVTask **prev, AVTask *t)
     *prev   = t;
 }
 
-static int run_one_task(AVExecutor *e, void *lc)
+static void queue_add(TaskQueue *q, const AVExecutor *e, AVTask *t)
 {
-    AVTaskCallbacks *cb = &e->cb;
+    const AVTaskCallbacks *cb = &e->cb;
+
+    if (e->ext.priority) {
+        const int p = av_clip(e->ext.priority(t, cb->user_data), 0, AV_EXECUTOR_PRIORITIES - 1);
+
+        t->next = NULL;
+        if (q->heads[p])
+            q->tails[p]->next = t;
+        else
+            q->heads[p] = t;
+        q->tails[p] = t;
+        q->non_empty |= 1ULL << p;
+    } else {
+        AVTask **prev;
+
+        for (prev = &q->tasks; *prev && cb->priority_higher(*prev, t); prev = &(*prev)->next)
+            /* nothing */;
+        add_task(prev, t);
+    }
+    q->nb_tasks++;
+}
+
+static int queue_has_more(const TaskQueue *q)
+{
+    if (q->non_empty)
+        return (q->non_empty & (q->non_empty - 1)) || q->heads[ff_ctzll(q->non_empty)]->next;
+    return q->tasks && q->tasks->next;
+}
+
+static int task_ready(const AVTaskCallbacks *cb, const AVTask *t, uint64_t *polls)
+{
+    if (!cb->ready)
+        return 1;
+    (*polls)++;
+    return cb->ready(t, cb->user_data);
+}
+
+static AVTask* queue_take_ready(TaskQueue *q, const AVExecutor *e, uint64_t *polls)
+{
+    const AVTaskCallbacks *cb = &e->cb;
     AVTask **prev;
 
-    for (prev = &e->tasks; *prev && !cb->ready(*prev, cb->user_data); prev = &(*prev)->next)
+    if (e->ext.priority) {
+        uint64_t non_empty = q->non_empty;
+
+        while (non_empty) {
+            const int p = ff_ctzll(non_empty);
+            AVTask *last = NULL;
+
+            for (prev = &q->heads[p]; *prev && !task_ready(cb, *prev, polls); prev = &(*prev)->next)
+                last = *prev;
+            if (*prev) {
+                AVTask *t = remove_task(prev, *prev);
+                if (q->tails[p] == t)
+                    q->tails[p] = last;
+                if (!q->heads[p])
+                    q->non_empty &= ~(1ULL << p);
+                q->nb_tasks--;
+                return t;
+            }
+            non_empty &= non_empty - 1;
+        }
+        return NULL;
+    }
+
+    for (prev = &q->tasks; *prev && !task_ready(cb, *prev, polls); prev = &(*prev)->next)
         /* nothing */;
     if (*prev) {
-        AVTask *t = remove_task(prev, *prev);
-        if (e->thread_count > 0)
-            ff_mutex_unlock(&e->lock);
-        cb->run(t, lc, cb->user_data);
-        if (e->thread_count > 0)
-            ff_mutex_lock(&e->lock);
+        q->nb_tasks--;
+        return remove_task(prev, *prev);
+    }
+    return NULL;
+}
+
+static void push_submitted(AVExecutor *e, AVTask *t)
+{
+    const AVTaskCallbacks *cb = &e->cb;
+    const int group           = e->ext.group ? e->ext.group(t, cb->user_data) : 0;
+    ExecutorGroup *g          = e->groups + (group > 0 ? group % e->nb_groups : 0);
+    atomic_ptr_val head       = atomic_load_explicit(&g->submitted, memory_order_relaxed);
+
+    do {
+        t->next = (AVTask *)head;
+    } while (!atomic_compare_exchange_weak_explicit(&g->submitted, &head, (atomic_ptr_val)t,
+        memory_order_release, memory_order_relaxed));
+}
+
+// a spinning worker picks the new work up without a syscall, so the parked ones are left alone
+static void wake_one(AVExecutor *e)
+{
+    atomic_fetch_add(&e->seq, 1);
+    if (e->threaded && !atomic_load(&e->nb_spinning) && atomic_load(&e->nb_sleeping)) {
+        ff_mutex_lock(&e->lock);
+        ff_cond_signal(&e->cond);
+        ff_mutex_unlock(&e->lock);
+    }
+}
+
+// move tasks submitted to group g to the local queue of ti from the thread self,
+// return 1 if we got more than one task
+static int drain_submitted(AVExecutor *e, ThreadInfo *self, ThreadInfo *ti, ExecutorGroup *g)
+{
+    AVTask *t = (AVTask *)atomic_exchange_explicit(&g->submitted, 0, memory_order_acquire);
+    AVTask *reversed = NULL;
+    int batch;
+
+    if (!t)
+        return 0;
+
+    // restore submission order, so equal priorities stay FIFO
+    while (t) {
+        AVTask *next = t->next;
+        add_task(&reversed, t);
+        t = next;
+    }
+
+    queue_lock(e, self, ti);
+    while (reversed) {
+        AVTask *next = reversed->next;
+        queue_add(&ti->q, e, reversed);
+        reversed = next;
+        if (e->stats && self) {
+            WorkerStats *stats = &ti->stats;
+
+            stat_add(&stats->queue_samples, 1);
+            stat_add(&stats->queue_sum, ti->q.nb_tasks);
+            if (ti->q.nb_tasks > atomic_load_explicit(&stats->max_queue, memory_order_relaxed))
+                atomic_store_explicit(&stats->max_queue, ti->q.nb_tasks, memory_order_relaxed);
+        }
+    }
+    batch = queue_has_more(&ti->q);
+    queue_unlock(e, self, ti);
+
+    return batch;
+}
+
+// take a ready task from the queue of ti, running on the thread self
+static AVTask* take_ready_task(AVExecutor *e, ThreadInfo *self, ThreadInfo *ti)
+{
+    uint64_t polls = 0;
+    AVTask *t;
+
+    queue_lock(e, self, ti);
+    t = queue_take_ready(&ti->q, e, &polls);
+    queue_unlock(e, self, ti);
+
+    if (e->stats && self && polls)
+        stat_add(&self->stats.polls, polls);
+
+    return t;
+}
+
+static AVTask* steal_task(AVExecutor *e, ThreadInfo *self, const int local)
+{
+    const int self_idx = self - e->threads;
+
+    for (int i = 1; i < e->nb_threads; i++) {
+        ThreadInfo *victim = e->threads + (self_idx + i) % e->nb_threads;
+        AVTask *t;
+
+        if ((victim->group == self->group) != local)
+            continue;
+        t = take_ready_task(e, self, victim);
+        if (t) {
+            if (e->stats)
+                stat_add(&self->stats.stolen, 1);
+            return t;
+        }
+    }
+    return NULL;
+}
+
+static AVTask* find_task(AVExecutor *e, ThreadInfo *ti)
+{
+    AVTask *t;
+
+    // let an idle worker steal the rest of the batch
+    if (drain_submitted(e, ti, ti, e->groups + ti->group))
+        wake_one(e);
+
+    t = take_ready_task(e, ti, ti);
+    if (!t)
+        t = steal_task(e, ti, 1);
+
+    // nothing left on our node, help the others
+    for (int i = 1; !t && i < e->nb_groups; i++) {
+        if (drain_submitted(e, ti, ti, e->groups + (ti->group + i) % e->nb_groups))
+            wake_one(e);
+        t = take_ready_task(e, ti, ti);
+    }
+    if (!t && e->nb_groups > 1)
+        t = steal_task(e, ti, 0);
+
+    return t;
+}
+
+static int run_one_task(AVExecutor *e, ThreadInfo *ti, void *lc)
+{
+    AVTaskCallbacks *cb = &e->cb;
+    AVTask *t = find_task(e, ti);
+
+    if (t) {
+        if (e->stats) {
+            const int64_t start = av_gettime_relative();
+
+            cb->run(t, lc, cb->user_data);
+            stat_add_time(&ti->stats.run, av_gettime_relative() - start);
+            stat_add(&ti->stats.tasks, 1);
+        } else {
+            cb->run(t, lc, cb->user_data);
+        }
         return 1;
     }
     return 0;
 }
 
+#define MAX_NODES 64
+
+#if HAVE_SCHED_GETAFFINITY && defined(CPU_COUNT)
+static int allowed_cpus(int *cpus, const int max)
+{
+    cpu_set_t cpuset;
+    int nb_cpus = 0;
+
+    CPU_ZERO(&cpuset);
+    if (sched_getaffinity(0, sizeof(cpuset), &cpuset))
+        return 0;
+    for (int i = 0; i < CPU_SETSIZE && nb_cpus < max; i++) {
+        if (CPU_ISSET(i, &cpuset))
+            cpus[nb_cpus++] = i;
+    }
+    return nb_cpus;
+}
+
+static void pin_thread(const int cpu)
+{
+    cpu_set_t cpuset;
+
+    CPU_ZERO(&cpuset);
+    CPU_SET(cpu, &cpuset);
+    sched_setaffinity(0, sizeof(cpuset), &cpuset);
+}
+
+// parse a sysfs cpulist like "0-15,32-47"
+static int cpulist_has(const char *list, const int cpu)
+{
+    while (*list) {
+        char *end;
+        const long first = strtol(list, &end, 10);
+        long last = first;
+
+        if (end == list)
+            break;
+        if (*end == '-')
+            last = strtol(end + 1, &end, 10);
+        if (cpu >= first && cpu <= last)
+            return 1;
+        list = end + (*end == ',');
+    }
+    return 0;
+}
+
+static int cpu_node(const int cpu)
+{
+    for (int node = 0; node < MAX_NODES; node++) {
+        char path[64], list[1024];
+        FILE *f;
+        int found;
+
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+        f = fopen(path, "r");
+        if (!f)
+            break;
+        found = fgets(list, sizeof(list), f) && cpulist_has(list, cpu);
+        fclose(f);
+        if (found)
+            return node;
+    }
+    return 0;
+}
+#elif HAVE_GETPROCESSAFFINITYMASK
+static int allowed_cpus(int *cpus, const int max)
+{
+    DWORD_PTR proc_aff, sys_aff;
+    int nb_cpus = 0;
+
+    if (!GetProcessAffinityMask(GetCurrentProcess(), &proc_aff, &sys_aff))
+        return 0;
+    for (int i = 0; i < sizeof(proc_aff) * 8 && nb_cpus < max; i++) {
+        if (proc_aff & ((DWORD_PTR)1 << i))
+            cpus[nb_cpus++] = i;
+    }
+    return nb_cpus;
+}
+
+static void pin_thread(const int cpu)
+{
+    SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu);
+}
+
+static int cpu_node(const int cpu)
+{
+    return 0;
+}
+#else
+static int allowed_cpus(int *cpus, const int max)
+{
+    return 0;
+}
+
+static void pin_thread(const int cpu)
+{
+}
+
+static int cpu_node(const int cpu)
+{
+    return 0;
+}
+#endif
+
+// pin worker i to the i-th allowed cpu and group the workers by NUMA node
+static int setup_affinity(AVExecutor *e)
+{
+    int node_to_group[MAX_NODES];
+    int *cpus = av_malloc_array(e->nb_threads, sizeof(*cpus));
+    int nb_cpus;
+
+    if (!cpus)
+        return AVERROR(ENOMEM);
+
+    nb_cpus = allowed_cpus(cpus, e->nb_threads);
+    for (int i = 0; i < FF_ARRAY_ELEMS(node_to_group); i++)
+        node_to_group[i] = -1;
+
+    e->nb_groups = 0;
+    for (int i = 0; i < e->nb_threads; i++) {
+        ThreadInfo *ti = e->threads + i;
+        int node = 0;
+
+        if (nb_cpus) {
+            ti->cpu = cpus[i % nb_cpus];
+            node    = av_clip(cpu_node(ti->cpu), 0, MAX_NODES - 1);
+        }
+        if (node_to_group[node] < 0)
+            node_to_group[node] = e->nb_groups++;
+        ti->group = node_to_group[node];
+    }
+    av_free(cpus);
+
+    return 0;
+}
+
 #if HAVE_THREADS
+static inline void cpu_pause(void)
+{
+#if HAVE_INLINE_ASM && ARCH_X86
+    __asm__ volatile ("pause" ::: "memory");
+#elif HAVE_INLINE_ASM && ARCH_AARCH64
+    __asm__ volatile ("yield" ::: "memory");
+#endif
+}
+
+// return 1 if new work may be available before the spin budget of ti ran out
+static int spin_wait(AVExecutor *e, ThreadInfo *ti, const unsigned seq)
+{
+    int found = 0;
+
+    atomic_fetch_add(&e->nb_spinning, 1);
+    for (int i = 0; i < ti->spin && !found; i++) {
+        cpu_pause();
+        found = atomic_load_explicit(&e->seq, memory_order_relaxed) != seq ||
+            atomic_load_explicit(&e->die, memory_order_relaxed);
+    }
+    atomic_fetch_sub(&e->nb_spinning, 1);
+
+    ti->spin = found ? FFMIN(ti->spin * 2, SPIN_MAX) : FFMAX(ti->spin / 2, SPIN_MIN);
+    return found;
+}
+
+static int worker_active(AVExecutor *e, const ThreadInfo *ti)
+{
+    return !atomic_load(&e->die) && ti - e->threads < atomic_load(&e->nb_active);
+}
+
 static void *executor_worker_task(void *data)
 {
     ThreadInfo *ti = (ThreadInfo*)data;
     AVExecutor *e  = ti->e;
-    void *lc       = e->local_contexts + (ti - e->threads) * e->cb.local_context_size;
+    void *lc       = ti->local_context;
 
-    ff_mutex_lock(&e->lock);
-    while (1) {
-        if (e->die) break;
+    if (ti->cpu >= 0)
+        pin_thread(ti->cpu);
+
+    while (worker_active(e, ti)) {
+        const unsigned seq = atomic_load(&e->seq);
+        int64_t spin_start = 0;
+
+        if (run_one_task(e, ti, lc))
+            continue;
+
+        //no task in one loop
+        if (e->stats)
+            spin_start = av_gettime_relative();
+        if (spin_wait(e, ti, seq)) {
+            if (e->stats)
+                stat_add_time(&ti->stats.idle, av_gettime_relative() - spin_start);
+            continue;
+        }
+        if (e->stats)
+            stat_add_time(&ti->stats.idle, av_gettime_relative() - spin_start);
+
+        ff_mutex_lock(&e->lock);
+        atomic_fetch_add(&e->nb_sleeping, 1);
+        if (worker_active(e, ti) && atomic_load(&e->seq) == seq) {
+            const int64_t start = e->stats ? av_gettime_relative() : 0;
 
-        if (!run_one_task(e, lc)) {
-            //no task in one loop
             ff_cond_wait(&e->cond, &e->lock);
+            if (e->stats)
+                stat_add_time(&ti->stats.idle, av_gettime_relative() - start);
         }
+        atomic_fetch_sub(&e->nb_sleeping, 1);
+        ff_mutex_unlock(&e->lock);
     }
-    ff_mutex_unlock(&e->lock);
     return NULL;
 }
 #endif
 
+// the worker index must be below nb_active before it runs
+static int spawn_worker(AVExecutor *e, ThreadInfo *ti)
+{
+    const int idx = ti - e->threads;
+
+    ti->local_context = av_mallocz(e->cb.local_context_size);
+    if (!ti->local_context)
+        return AVERROR(ENOMEM);
+    ti->e    = e;
+    ti->spin = SPIN_MIN;
+
+    atomic_store(&e->nb_active, idx + 1);
+    if (executor_thread_create(&ti->thread, NULL, executor_worker_task, ti)) {
+        atomic_store(&e->nb_active, idx);
+        av_freep(&ti->local_context);
+        return AVERROR(EAGAIN);
+    }
+    return 0;
+}
+
+// move the tasks left in the queue of an exited worker to the submitted lists
+static void queue_hand_over(AVExecutor *e, ThreadInfo *ti)
+{
+    TaskQueue *q = &ti->q;
+    AVTask *tasks;
+
+    queue_lock(e, NULL, ti);
+    tasks = q->tasks;
+    for (int p = AV_EXECUTOR_PRIORITIES - 1; p >= 0; p--) {
+        if (q->heads[p]) {
+            q->tails[p]->next = tasks;
+            tasks = q->heads[p];
+        }
+    }
+    memset(q, 0, sizeof(*q));
+    queue_unlock(e, NULL, ti);
+
+    if (!tasks)
+        return;
+    while (tasks) {
+        AVTask *next = tasks->next;
+        push_submitted(e, tasks);
+        tasks = next;
+    }
+    wake_one(e);
+}
+
 static void executor_free(AVExecutor *e, const int has_lock, const int has_cond)
 {
     if (e->thread_count) {
         //signal die
         ff_mutex_lock(&e->lock);
-        e->die = 1;
+        atomic_store(&e->die, 1);
         ff_cond_broadcast(&e->cond);
         ff_mutex_unlock(&e->lock);
 
@@ -130,34 +685,88 @@ static void executor_free(AVExecutor *e, const int has_lock, const int has_cond)
     if (has_lock)
         ff_mutex_destroy(&e->lock);
 
+    for (int i = 0; i < e->nb_thread_locks; i++)
+        ff_mutex_destroy(&e->threads[i].lock);
+    for (int i = 0; e->threads && i < e->nb_threads; i++)
+        av_free(e->threads[i].local_context);
+
     av_free(e->threads);
-    av_free(e->local_contexts);
+    av_free(e->groups);
 
     av_free(e);
 }
 
-AVExecutor* av_executor_alloc(const AVTaskCallbacks *cb, int thread_count)
+AVExecutor* av_executor_alloc2(const AVTaskCallbacks *cb, const AVTaskCallbacksExt *ext,
+                               int thread_count, int flags)
 {
     AVExecutor *e;
     int has_lock = 0, has_cond = 0;
-    if (!cb || !cb->user_data || !cb->ready || !cb->run || !cb->priority_higher)
+    if (!cb || !cb->user_data || !cb->run || (ext && ext->size < sizeof(ext->size)))
         return NULL;
 
     e = av_mallocz(sizeof(*e));
     if (!e)
         return NULL;
-    e->cb = *cb;
+    e->cb    = *cb;
+    // only the fields the caller knows of are copied, the others stay NULL
+    if (ext)
+        memcpy(&e->ext, ext, FFMIN(ext->size, sizeof(e->ext)));
+    e->ext.size = sizeof(e->ext);
+    if (!e->cb.priority_higher && !e->ext.priority) {
+        av_free(e);
+        return NULL;
+    }
+    e->stats = !!(flags & AV_EXECUTOR_FLAG_STATS);
+    atomic_init(&e->seq, 0);
+    atomic_init(&e->nb_sleeping, 0);
+    atomic_init(&e->nb_spinning, 0);
+    atomic_init(&e->die, 0);
+    atomic_init(&e->nb_active, 0);
+
+    e->threaded   = thread_count > 0;
+    e->nb_threads = FFMAX(thread_count, 1);
+    e->threads = av_calloc(e->nb_threads, sizeof(*e->threads));
+    if (!e->threads)
+        goto free_executor;
 
-    e->local_contexts = av_calloc(FFMAX(thread_count, 1), e->cb.local_context_size);
-    if (!e->local_contexts)
+    e->nb_groups = 1;
+    for (int i = 0; i < e->nb_threads; i++) {
+        WorkerStats *stats = &e->threads[i].stats;
+
+        e->threads[i].cpu  = -1;
+        e->threads[i].spin = SPIN_MIN;
+        atomic_init(&stats->tasks, 0);
+        atomic_init(&stats->stolen, 0);
+        atomic_init(&stats->polls, 0);
+        atomic_init(&stats->queue_samples, 0);
+        atomic_init(&stats->queue_sum, 0);
+        atomic_init(&stats->max_queue, 0);
+        atomic_init(&stats->lock_wait, 0);
+        atomic_init(&stats->lock_hold, 0);
+        atomic_init(&stats->run, 0);
+        atomic_init(&stats->idle, 0);
+    }
+    if (thread_count && (flags & AV_EXECUTOR_FLAG_AFFINITY) && setup_affinity(e) < 0)
         goto free_executor;
 
-    e->threads = av_calloc(FFMAX(thread_count, 1), sizeof(*e->threads));
-    if (!e->threads)
+    e->groups = av_calloc(e->nb_groups, sizeof(*e->groups));
+    if (!e->groups)
         goto free_executor;
+    for (int i = 0; i < e->nb_groups; i++)
+        atomic_init(&e->groups[i].submitted, 0);
 
-    if (!thread_count)
+    for (/* nothing */; e->nb_thread_locks < e->nb_threads; e->nb_thread_locks++) {
+        if (ff_mutex_init(&e->threads[e->nb_thread_locks].lock, NULL))
+            goto free_executor;
+    }
+
+    if (!thread_count) {
+        // the caller's thread runs the tasks with the context of the only ThreadInfo
+        e->threads->local_context = av_mallocz(e->cb.local_context_size);
+        if (!e->threads->local_context)
+            goto free_executor;
         return e;
+    }
 
     has_lock = !ff_mutex_init(&e->lock, NULL);
     has_cond = !ff_cond_init(&e->cond, NULL);
@@ -166,9 +775,7 @@ AVExecutor* av_executor_alloc(const AVTaskCallbacks *cb, int thread_count)
         goto free_executor;
 
     for (/* nothing */; e->thread_count < thread_count; e->thread_count++) {
-        ThreadInfo *ti = e->threads + e->thread_count;
-        ti->e = e;
-        if (executor_thread_create(&ti->thread, NULL, executor_worker_task, ti))
+        if (spawn_worker(e, e->threads + e->thread_count) < 0)
             goto free_executor;
     }
     return e;
@@ -178,34 +785,129 @@ free_executor:
     return NULL;
 }
 
+AVExecutor* av_executor_alloc(const AVTaskCallbacks *cb, int thread_count)
+{
+    return av_executor_alloc2(cb, NULL, thread_count, 0);
+}
+
+int av_executor_nb_groups(const AVExecutor *e)
+{
+    return e->nb_groups;
+}
+
 void av_executor_free(AVExecutor **executor)
 {
-    int thread_count;
+    int threaded;
 
     if (!executor || !*executor)
         return;
-    thread_count = (*executor)->thread_count;
-    executor_free(*executor, thread_count, thread_count);
+    threaded = (*executor)->threaded;
+    executor_free(*executor, threaded, threaded);
     *executor = NULL;
 }
 
 void av_executor_execute(AVExecutor *e, AVTask *t)
 {
-    AVTaskCallbacks *cb = &e->cb;
-    AVTask **prev;
+    if (t)
+        push_submitted(e, t);
+    wake_one(e);
 
-    ff_mutex_lock(&e->lock);
-    if (t) {
-        for (prev = &e->tasks; *prev && cb->priority_higher(*prev, t); prev = &(*prev)->next)
+    if (!e->threaded || !HAVE_THREADS) {
+        // We are running in a single-threaded environment, so we must handle all tasks ourselves
+        while (run_one_task(e, e->threads, e->threads->local_context))
             /* nothing */;
-        add_task(prev, t);
     }
-    ff_cond_signal(&e->cond);
-    ff_mutex_unlock(&e->lock);
+}
 
-    if (!e->thread_count || !HAVE_THREADS) {
-        // We are running in a single-threaded environment, so we must handle all tasks ourselves
-        while (run_one_task(e, e->local_contexts))
-            /* nothing */;
+int av_executor_get_stats(const AVExecutor *e, AVExecutorStats *stats)
+{
+    uint64_t queue_samples = 0, queue_sum = 0;
+
+    if (!e->stats)
+        return AVERROR(EINVAL);
+
+    memset(stats, 0, sizeof(*stats));
+    for (int i = 0; i < e->nb_threads; i++) {
+        // the counters are not consistent with each other, relaxed loads are enough
+        WorkerStats *w = &e->threads[i].stats;
+
+        stats->nb_tasks         += atomic_load_explicit(&w->tasks,     memory_order_relaxed);
+        stats->nb_stolen        += atomic_load_explicit(&w->stolen,    memory_order_relaxed);
+        stats->nb_ready_polls   += atomic_load_explicit(&w->polls,     memory_order_relaxed);
+        stats->lock_wait_time   += atomic_load_explicit(&w->lock_wait, memory_order_relaxed);
+        stats->lock_hold_time   += atomic_load_explicit(&w->lock_hold, memory_order_relaxed);
+        stats->run_time         += atomic_load_explicit(&w->run,       memory_order_relaxed);
+        stats->idle_time        += atomic_load_explicit(&w->idle,      memory_order_relaxed);
+        stats->max_queue_length  = FFMAX(stats->max_queue_length,
+                                         atomic_load_explicit(&w->max_queue, memory_order_relaxed));
+        queue_samples           += atomic_load_explicit(&w->queue_samples, memory_order_relaxed);
+        queue_sum               += atomic_load_explicit(&w->queue_sum,     memory_order_relaxed);
+    }
+    stats->avg_queue_length = queue_samples ? (double)queue_sum / queue_samples : 0;
+
+    return 0;
+}
+
+int av_executor_run_one(AVExecutor *e, void *local_context)
+{
+    AVTask *t = NULL;
+    int nb_active;
+
+    if (!e->threaded || !HAVE_THREADS)
+        return 0;
+
+    // the calling thread has no queue, the submitted tasks go to the first running worker
+    // of their group, or to the first worker if none of the group runs
+    nb_active = FFMAX(atomic_load(&e->nb_active), 1);
+    for (int g = 0; g < e->nb_groups; g++) {
+        ThreadInfo *ti = e->threads;
+
+        for (int i = 0; i < nb_active; i++) {
+            if (e->threads[i].group == g) {
+                ti = e->threads + i;
+                break;
+            }
+        }
+        if (drain_submitted(e, NULL, ti, e->groups + g))
+            wake_one(e);
+    }
+
+    for (int i = 0; !t && i < e->nb_threads; i++)
+        t = take_ready_task(e, NULL, e->threads + i);
+    if (!t)
+        return 0;
+
+    e->cb.run(t, local_context, e->cb.user_data);
+    return 1;
+}
+
+int av_executor_set_thread_count(AVExecutor *e, int thread_count)
+{
+    int ret = 0;
+
+    if (!e->threaded || thread_count < 1 || thread_count > e->nb_threads)
+        return AVERROR(EINVAL);
+
+    if (thread_count < e->thread_count) {
+        atomic_store(&e->nb_active, thread_count);
+        ff_mutex_lock(&e->lock);
+        ff_cond_broadcast(&e->cond);
+        ff_mutex_unlock(&e->lock);
+
+        // each worker finishes its current task first
+        for (/* nothing */; e->thread_count > thread_count; e->thread_count--) {
+            ThreadInfo *ti = e->threads + e->thread_count - 1;
+
+            executor_thread_join(ti->thread, NULL);
+            av_freep(&ti->local_context);
+            queue_hand_over(e, ti);
+        }
+    }
+
+    for (/* nothing */; e->thread_count < thread_count; e->thread_count++) {
+        ret = spawn_worker(e, e->threads + e->thread_count);
+        if (ret < 0)
+            break;
     }
+    return ret;
 }
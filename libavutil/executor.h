@@ -21,6 +21,8 @@
 #ifndef AVUTIL_EXECUTOR_H
 #define AVUTIL_EXECUTOR_H
 
+#include <stdint.h>
+
 typedef struct AVExecutor AVExecutor;
 typedef struct AVTask AVTask;
 
@@ -28,6 +30,11 @@ struct AVTask {
     AVTask *next;
 };
 
+/**
+ * Number of priority buckets, see AVTaskCallbacksExt.priority
+ */
+#define AV_EXECUTOR_PRIORITIES 64
+
 typedef struct AVTaskCallbacks {
     void *user_data;
 
@@ -36,21 +43,128 @@ typedef struct AVTaskCallbacks {
     // return 1 if a's priority > b's priority
     int (*priority_higher)(const AVTask *a, const AVTask *b);
 
-    // task is ready for run
+    /**
+     * Optional, return 1 if the task is ready for run. The executor polls it on
+     * queued tasks whenever a worker looks for work. If NULL, every submitted task
+     * is considered runnable, the caller must only submit tasks whose dependencies
+     * are met, and no polling happens.
+     */
     int (*ready)(const AVTask *t, void *user_data);
 
     // run the task
     int (*run)(AVTask *t, void *local_context, void *user_data);
 } AVTaskCallbacks;
 
+/**
+ * Optional callbacks of av_executor_alloc2(). Fields are only added at the end,
+ * and size tells the executor which ones the caller knows of, so an application
+ * built with older headers passes a valid struct.
+ */
+typedef struct AVTaskCallbacksExt {
+    /**
+     * sizeof(AVTaskCallbacksExt) in the headers the caller was built with, the
+     * fields past it are considered NULL
+     */
+    size_t size;
+
+    /**
+     * Optional, return the priority bucket of t, from 0 (highest) to
+     * AV_EXECUTOR_PRIORITIES - 1. If set, tasks are queued in per bucket FIFOs,
+     * which makes submitting and picking a task O(1). AVTaskCallbacks.priority_higher
+     * is not used in this case and may be NULL. It is passed AVTaskCallbacks.user_data.
+     */
+    int (*priority)(const AVTask *t, void *user_data);
+
+    /**
+     * Optional, return the worker group t prefers to run on, see
+     * av_executor_nb_groups(). Idle workers of other groups may still run it.
+     * It is passed AVTaskCallbacks.user_data.
+     */
+    int (*group)(const AVTask *t, void *user_data);
+} AVTaskCallbacksExt;
+
+/**
+ * Pin each worker thread to one cpu, and group the workers by NUMA node
+ */
+#define AV_EXECUTOR_FLAG_AFFINITY (1 << 0)
+
+/**
+ * Collect scheduling statistics, see av_executor_get_stats(). This adds a few
+ * clock reads per task and per lock.
+ */
+#define AV_EXECUTOR_FLAG_STATS    (1 << 1)
+
+/**
+ * Scheduling statistics of an executor, summed over all workers and the
+ * caller's thread. Times are in microseconds, measured with
+ * av_gettime_relative(), so they are only meaningful summed over many events.
+ *
+ * sizeof(AVExecutorStats) is part of the public ABI.
+ */
+typedef struct AVExecutorStats {
+    uint64_t nb_tasks;              ///< tasks run
+    uint64_t nb_stolen;             ///< tasks taken from the queue of another worker
+    uint64_t nb_ready_polls;        ///< AVTaskCallbacks.ready calls, nb_ready_polls / nb_tasks per run
+    int      max_queue_length;      ///< longest worker queue seen when a task was queued
+    double   avg_queue_length;      ///< mean worker queue length seen when a task was queued
+    int64_t  lock_wait_time;        ///< waiting for the queue locks
+    int64_t  lock_hold_time;        ///< holding the queue locks
+    int64_t  run_time;              ///< running tasks
+    int64_t  idle_time;             ///< workers parked without work
+} AVExecutorStats;
+
 /**
  * Alloc executor
+ *
+ * Each worker owns a task queue ordered by priority_higher(). Submitted tasks
+ * are handed over through a lock-free list, idle workers steal ready tasks from
+ * the queues of busy ones, so the priority order is only followed per worker.
+ *
  * @param callbacks callback structure for executor
- * @param thread_count worker thread number, 0 for run on caller's thread directly
+ * @param thread_count worker thread number, 0 for run on caller's thread directly,
+ *                     and the most av_executor_set_thread_count() accepts
  * @return return the executor
  */
 AVExecutor* av_executor_alloc(const AVTaskCallbacks *callbacks, int thread_count);
 
+/**
+ * Alloc executor with optional callbacks and flags
+ * @param callbacks callback structure for executor
+ * @param ext optional callbacks, may be NULL
+ * @param thread_count worker thread number, 0 for run on caller's thread directly,
+ *                     and the most av_executor_set_thread_count() accepts
+ * @param flags a combination of AV_EXECUTOR_FLAG_*
+ * @return return the executor
+ */
+AVExecutor* av_executor_alloc2(const AVTaskCallbacks *callbacks, const AVTaskCallbacksExt *ext,
+                               int thread_count, int flags);
+
+/**
+ * Set the number of worker threads, e.g. to follow the load of the caller.
+ * New workers are spawned, the extra ones finish their current task and exit,
+ * and the tasks queued on them are run by the others. The local context of a
+ * worker is allocated when it is spawned and freed when it exits.
+ *
+ * It must not be called from a task, nor concurrently with itself or
+ * av_executor_free(). Tasks may be submitted and run meanwhile.
+ *
+ * @param e pointer to executor, allocated with a thread_count greater than 0
+ * @param thread_count new number of worker threads, from 1 to the thread_count
+ *                     the executor was allocated with
+ * @return 0 on success, AVERROR(EINVAL) if thread_count is out of range, or
+ *         another negative error code if a worker could not be spawned, the
+ *         executor then keeps the workers it already had
+ */
+int av_executor_set_thread_count(AVExecutor *e, int thread_count);
+
+/**
+ * Get the number of worker groups. Workers are grouped by NUMA node when
+ * AV_EXECUTOR_FLAG_AFFINITY is set, otherwise there is only one group.
+ * @param e pointer to executor
+ * @return number of groups, at least 1
+ */
+int av_executor_nb_groups(const AVExecutor *e);
+
 /**
  * Free executor
  * @param e  pointer to executor
@@ -64,4 +178,28 @@ void av_executor_free(AVExecutor **e);
  */
 void av_executor_execute(AVExecutor *e, AVTask *t);
 
+/**
+ * Run one ready task on the calling thread, which is not a worker of the
+ * executor, e.g. one waiting for its tasks to finish. The tasks run this way
+ * are not counted in the statistics.
+ * @param e pointer to executor
+ * @param local_context the local context the task is run with, owned by the
+ *                      calling thread and AVTaskCallbacks.local_context_size
+ *                      bytes large
+ * @return 1 if a task was run, 0 if none was ready or the executor has no
+ *         worker thread, as it then already runs all the tasks on the thread
+ *         calling av_executor_execute()
+ */
+int av_executor_run_one(AVExecutor *e, void *local_context);
+
+/**
+ * Get the scheduling statistics collected since the executor was allocated.
+ * It may be called while tasks are running, the counters are then read one
+ * by one and may be slightly inconsistent with each other.
+ * @param e pointer to executor, allocated with AV_EXECUTOR_FLAG_STATS
+ * @param stats filled with the statistics
+ * @return 0 on success, AVERROR(EINVAL) if the executor does not collect statistics
+ */
+int av_executor_get_stats(const AVExecutor *e, AVExecutorStats *stats);
+
 #endif //AVUTIL_EXECUTOR_H
@@ -228,6 +228,13 @@ enum AVFrameSideDataType {
      * encoding.
      */
     AV_FRAME_DATA_VIDEO_HINT,
+
+    /**
+     * Syntax statistics of the coding blocks of the frame, as exported by
+     * some decoders. The data is the AVVideoCodingStats struct defined in
+     * libavutil/video_coding_stats.h.
+     */
+    AV_FRAME_DATA_VIDEO_CODING_STATS,
 };
 
 enum AVActiveFormatDescription {
@@ -24,6 +24,9 @@
  * default memory allocator for libavutil
  */
 
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE
+#endif
 #define _XOPEN_SOURCE 600
 
 #include "config.h"
@@ -36,6 +39,9 @@
 #if HAVE_MALLOC_H
 #include <malloc.h>
 #endif
+#if HAVE_MADVISE
+#include <sys/mman.h>
+#endif
 
 #include "attributes.h"
 #include "avassert.h"
@@ -152,6 +158,32 @@ void *av_malloc(size_t size)
     return ptr;
 }
 
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+void *av_malloc_huge(size_t size)
+{
+#if HAVE_POSIX_MEMALIGN && HAVE_MADVISE && defined(MADV_HUGEPAGE)
+    void *ptr = NULL;
+
+    if (size < HUGE_PAGE_SIZE)
+        return av_malloc(size);
+    if (size > atomic_load_explicit(&max_alloc_size, memory_order_relaxed))
+        return NULL;
+
+    // only an aligned block can be backed by huge pages from its start
+    if (posix_memalign(&ptr, HUGE_PAGE_SIZE, size))
+        return NULL;
+    // the hint is best effort, the memory is usable without it
+    madvise(ptr, size & ~(size_t)(HUGE_PAGE_SIZE - 1), MADV_HUGEPAGE);
+#if CONFIG_MEMORY_POISONING
+    memset(ptr, FF_MEMORY_POISON, size);
+#endif
+    return ptr;
+#else
+    return av_malloc(size);
+#endif
+}
+
 void *av_realloc(void *ptr, size_t size)
 {
     void *ret;
@@ -129,6 +129,19 @@ void *av_malloc(size_t size) av_malloc_attrib av_alloc_size(1);
  */
 void *av_mallocz(size_t size) av_malloc_attrib av_alloc_size(1);
 
+/**
+ * Allocate a memory block like av_malloc(), and ask the system to back it
+ * with huge pages where that is supported, which reduces TLB misses on large
+ * tables. Blocks smaller than a huge page are allocated with av_malloc().
+ *
+ * The block is freed with av_free() like any other.
+ *
+ * @param size Size in bytes for the memory block to be allocated
+ * @return Pointer to the allocated block, or `NULL` if it cannot be allocated
+ * @see av_malloc()
+ */
+void *av_malloc_huge(size_t size) av_malloc_attrib av_alloc_size(1);
+
 /**
  * Allocate a memory block for an array with av_malloc().
  *
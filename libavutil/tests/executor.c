@@ -0,0 +1,247 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/executor.h"
+#include "libavutil/macros.h"
+#include "libavutil/thread.h"
+
+#define GRID_W 16
+#define GRID_H 16
+
+typedef struct GridTask {
+    AVTask task;
+    int x, y;
+} GridTask;
+
+typedef struct Grid {
+    GridTask tasks[GRID_H][GRID_W];
+    atomic_int done[GRID_H][GRID_W];
+    atomic_int deps[GRID_H][GRID_W];
+    int event_driven;
+    atomic_int nb_runs;
+    atomic_int errors;
+    AVExecutor *e;
+
+    AVMutex lock;
+    AVCond cond;
+} Grid;
+
+static int grid_done(Grid *g, const int x, const int y)
+{
+    if (x < 0 || y < 0)
+        return 1;
+    return atomic_load(&g->done[y][x]);
+}
+
+static int priority_higher(const AVTask *_a, const AVTask *_b)
+{
+    const GridTask *a = (const GridTask *)_a;
+    const GridTask *b = (const GridTask *)_b;
+
+    if (a->x + a->y != b->x + b->y)
+        return a->x + a->y < b->x + b->y;
+    return a->y < b->y;
+}
+
+static int priority(const AVTask *_t, void *user_data)
+{
+    const GridTask *t = (const GridTask *)_t;
+
+    return (t->x + t->y) * AV_EXECUTOR_PRIORITIES / (GRID_W + GRID_H);
+}
+
+static int ready(const AVTask *_t, void *user_data)
+{
+    const GridTask *t = (const GridTask *)_t;
+    Grid *g           = user_data;
+
+    return grid_done(g, t->x - 1, t->y) && grid_done(g, t->x, t->y - 1);
+}
+
+static int run(AVTask *_t, void *local_context, void *user_data)
+{
+    GridTask *t = (GridTask *)_t;
+    Grid *g     = user_data;
+    int *nb_local_runs = local_context;
+
+    if (!ready(_t, user_data) || atomic_fetch_add(&g->done[t->y][t->x], 1))
+        atomic_fetch_add(&g->errors, 1);
+    (*nb_local_runs)++;
+
+    if (g->event_driven) {
+        // the executor does not poll, submit the neighbours once their dependencies are met
+        if (t->x + 1 < GRID_W && atomic_fetch_sub(&g->deps[t->y][t->x + 1], 1) == 1)
+            av_executor_execute(g->e, &g->tasks[t->y][t->x + 1].task);
+        if (t->y + 1 < GRID_H && atomic_fetch_sub(&g->deps[t->y + 1][t->x], 1) == 1)
+            av_executor_execute(g->e, &g->tasks[t->y + 1][t->x].task);
+    }
+
+    if (atomic_fetch_add(&g->nb_runs, 1) + 1 == GRID_W * GRID_H) {
+        ff_mutex_lock(&g->lock);
+        ff_cond_signal(&g->cond);
+        ff_mutex_unlock(&g->lock);
+    } else if (!g->event_driven) {
+        // neighbours may be ready now
+        av_executor_execute(g->e, NULL);
+    }
+    return 0;
+}
+
+static void check_stats(Grid *g, const int thread_count, const int flags)
+{
+    AVExecutorStats st;
+    const int ret = av_executor_get_stats(g->e, &st);
+
+    if (!(flags & AV_EXECUTOR_FLAG_STATS)) {
+        if (ret >= 0)
+            atomic_fetch_add(&g->errors, 1);
+        return;
+    }
+
+    // workers count a task once it returned, which may be after the last one signalled us
+    if (ret < 0 || st.nb_tasks > GRID_W * GRID_H || (!thread_count && st.nb_tasks != GRID_W * GRID_H) ||
+        st.max_queue_length > GRID_W * GRID_H || st.avg_queue_length > st.max_queue_length ||
+        (!g->event_driven && st.nb_ready_polls < st.nb_tasks) || st.run_time < 0 || st.idle_time < 0 ||
+        st.lock_wait_time < 0 || st.lock_hold_time < 0)
+        atomic_fetch_add(&g->errors, 1);
+}
+
+// grow and shrink the pool while the tasks run, the workers that exit hand their queue over
+static void resize(Grid *g, const int thread_count)
+{
+    if (av_executor_set_thread_count(g->e, 0) >= 0 ||
+        av_executor_set_thread_count(g->e, thread_count + 1) >= 0)
+        atomic_fetch_add(&g->errors, 1);
+    if (!thread_count)
+        return;
+
+    for (int i = 0; atomic_load(&g->nb_runs) != GRID_W * GRID_H; i++) {
+        if (av_executor_set_thread_count(g->e, 1 + i % thread_count) < 0)
+            atomic_fetch_add(&g->errors, 1);
+    }
+    if (av_executor_set_thread_count(g->e, thread_count) < 0)
+        atomic_fetch_add(&g->errors, 1);
+}
+
+static int test_executor(const int thread_count, const int bucketed, const int event_driven, const int flags,
+                         const int help, const int resizing)
+{
+    static Grid g;
+    int caller_runs = 0;
+    AVTaskCallbacks cb = {
+        .user_data          = &g,
+        .local_context_size = sizeof(int),
+        .priority_higher    = bucketed ? NULL : priority_higher,
+        .ready              = event_driven ? NULL : ready,
+        .run                = run,
+    };
+    const AVTaskCallbacksExt ext = {
+        .size               = sizeof(ext),
+        .priority           = bucketed ? priority : NULL,
+    };
+
+    memset(&g, 0, sizeof(g));
+    g.event_driven = event_driven;
+    ff_mutex_init(&g.lock, NULL);
+    ff_cond_init(&g.cond, NULL);
+
+    g.e = av_executor_alloc2(&cb, &ext, thread_count, flags);
+    if (!g.e)
+        return 1;
+
+    for (int y = 0; y < GRID_H; y++) {
+        for (int x = 0; x < GRID_W; x++) {
+            GridTask *t = &g.tasks[y][x];
+            t->x = x;
+            t->y = y;
+            atomic_init(&g.deps[y][x], (x > 0) + (y > 0));
+        }
+    }
+
+    if (event_driven) {
+        av_executor_execute(g.e, &g.tasks[0][0].task);
+    } else {
+        // submit in reverse order, so most tasks are queued before they are ready
+        for (int y = GRID_H - 1; y >= 0; y--) {
+            for (int x = GRID_W - 1; x >= 0; x--)
+                av_executor_execute(g.e, &g.tasks[y][x].task);
+        }
+    }
+
+    if (resizing)
+        resize(&g, thread_count);
+
+    // the waiting thread runs the ready tasks, and blocks when there are none
+    while (help && atomic_load(&g.nb_runs) != GRID_W * GRID_H && av_executor_run_one(g.e, &caller_runs))
+        /* nothing */;
+    if (!thread_count && av_executor_run_one(g.e, &caller_runs))
+        atomic_fetch_add(&g.errors, 1);
+
+    ff_mutex_lock(&g.lock);
+    while (atomic_load(&g.nb_runs) != GRID_W * GRID_H)
+        ff_cond_wait(&g.cond, &g.lock);
+    ff_mutex_unlock(&g.lock);
+
+    check_stats(&g, thread_count, flags);
+    av_executor_free(&g.e);
+    ff_cond_destroy(&g.cond);
+    ff_mutex_destroy(&g.lock);
+
+    printf("%s%s%s%s%s%s, threads %d: %d tasks, %d errors\n", bucketed ? "bucketed" : "sorted",
+           event_driven ? ", event driven" : "", flags & AV_EXECUTOR_FLAG_AFFINITY ? ", affinity" : "",
+           flags & AV_EXECUTOR_FLAG_STATS ? ", stats" : "", help ? ", caller helps" : "",
+           resizing ? ", resized" : "", thread_count, atomic_load(&g.nb_runs), atomic_load(&g.errors));
+    return atomic_load(&g.errors) != 0;
+}
+
+int main(void)
+{
+    static const int thread_counts[] = { 0, 1, 2, 4, 8 };
+    int ret = 0;
+
+    for (int event_driven = 0; event_driven < 2; event_driven++) {
+        for (int bucketed = 0; bucketed < 2; bucketed++) {
+            for (int i = 0; i < FF_ARRAY_ELEMS(thread_counts); i++)
+                ret |= test_executor(thread_counts[i], bucketed, event_driven, 0, 0, 0);
+        }
+    }
+
+    for (int i = 0; i < FF_ARRAY_ELEMS(thread_counts); i++)
+        ret |= test_executor(thread_counts[i], 1, 1, AV_EXECUTOR_FLAG_AFFINITY, 0, 0);
+
+    for (int bucketed = 0; bucketed < 2; bucketed++) {
+        for (int i = 0; i < FF_ARRAY_ELEMS(thread_counts); i++)
+            ret |= test_executor(thread_counts[i], bucketed, 0, AV_EXECUTOR_FLAG_STATS, 0, 0);
+    }
+
+    for (int event_driven = 0; event_driven < 2; event_driven++) {
+        for (int i = 0; i < FF_ARRAY_ELEMS(thread_counts); i++)
+            ret |= test_executor(thread_counts[i], 1, event_driven, 0, 1, 0);
+    }
+
+    for (int bucketed = 0; bucketed < 2; bucketed++) {
+        for (int i = 0; i < FF_ARRAY_ELEMS(thread_counts); i++)
+            ret |= test_executor(thread_counts[i], bucketed, 0, 0, 0, 1);
+    }
+
+    return ret;
+}
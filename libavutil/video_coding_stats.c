@@ -0,0 +1,77 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "buffer.h"
+#include "frame.h"
+#include "mem.h"
+#include "video_coding_stats.h"
+
+AVVideoCodingStats *av_video_coding_stats_alloc(unsigned int nb_blocks, size_t *out_size)
+{
+    struct TestStruct {
+        AVVideoCodingStats      s;
+        AVVideoCodingBlockStats b;
+    };
+    const size_t blocks_offset = offsetof(struct TestStruct, b);
+    size_t size = blocks_offset;
+    AVVideoCodingStats *stats;
+
+    if (nb_blocks > (SIZE_MAX - size) / sizeof(AVVideoCodingBlockStats))
+        return NULL;
+    size += sizeof(AVVideoCodingBlockStats) * nb_blocks;
+
+    stats = av_mallocz(size);
+    if (!stats)
+        return NULL;
+
+    stats->nb_blocks     = nb_blocks;
+    stats->block_size    = sizeof(AVVideoCodingBlockStats);
+    stats->blocks_offset = blocks_offset;
+
+    if (out_size)
+        *out_size = size;
+
+    return stats;
+}
+
+AVVideoCodingStats*
+av_video_coding_stats_create_side_data(AVFrame *frame, unsigned int nb_blocks)
+{
+    AVBufferRef        *buf;
+    AVVideoCodingStats *stats;
+    size_t size;
+
+    stats = av_video_coding_stats_alloc(nb_blocks, &size);
+    if (!stats)
+        return NULL;
+    buf = av_buffer_create((uint8_t *)stats, size, NULL, NULL, 0);
+    if (!buf) {
+        av_freep(&stats);
+        return NULL;
+    }
+
+    if (!av_frame_new_side_data_from_buf(frame, AV_FRAME_DATA_VIDEO_CODING_STATS, buf)) {
+        av_buffer_unref(&buf);
+        return NULL;
+    }
+
+    return stats;
+}
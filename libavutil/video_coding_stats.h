@@ -0,0 +1,148 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVUTIL_VIDEO_CODING_STATS_H
+#define AVUTIL_VIDEO_CODING_STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "libavutil/avassert.h"
+#include "libavutil/frame.h"
+
+/**
+ * Syntax statistics of a coded frame, gathered by a decoder for each of its
+ * coding blocks (macroblocks or coding tree units). This struct is allocated
+ * along with an array of per-block AVVideoCodingBlockStats.
+ * Must be allocated with av_video_coding_stats_alloc().
+ */
+typedef struct AVVideoCodingStats {
+    /**
+     * Number of blocks in the array, in raster scan order.
+     */
+    unsigned int nb_blocks;
+    /**
+     * Offset in bytes from the beginning of this structure at which the array
+     * of blocks starts.
+     */
+    size_t blocks_offset;
+    /**
+     * Size of each block in bytes. May not match sizeof(AVVideoCodingBlockStats).
+     */
+    size_t block_size;
+} AVVideoCodingStats;
+
+/**
+ * Statistics of one coding block. It is allocated as a part of
+ * AVVideoCodingStats and should be retrieved with av_video_coding_stats_block().
+ *
+ * sizeof(AVVideoCodingBlockStats) is not a part of the ABI and new fields may
+ * be added to it.
+ */
+typedef struct AVVideoCodingBlockStats {
+    /**
+     * Distance in luma pixels from the top-left corner of the coded frame
+     * to the top-left corner of the block.
+     */
+    int src_x, src_y;
+    /**
+     * Width and height of the block in luma pixels, cropped to the coded frame.
+     */
+    int w, h;
+
+    /**
+     * Number of bits of the coded data of the block. For arithmetic coding
+     * this is the position of the decoder, so it is exact up to a few bits.
+     */
+    uint32_t bits;
+
+    /**
+     * Number of coding units. With separate luma and chroma trees, the units
+     * of both trees are counted.
+     */
+    uint32_t nb_cus;
+    /**
+     * Number of intra, inter, intra block copy and palette coding units, and
+     * how many of the inter units are skipped.
+     */
+    uint32_t nb_intra, nb_inter, nb_ibc, nb_palette, nb_skip;
+    /**
+     * Number of coding units with a coded residual.
+     */
+    uint32_t nb_coded;
+
+    /**
+     * Deepest quadtree split and smallest coding unit area in luma pixels.
+     */
+    int max_qt_depth;
+    int min_cu_area;
+
+    /**
+     * Luma quantization parameter averaged over the coding units, rounded down.
+     */
+    int qp;
+
+    /**
+     * Number of transform units.
+     */
+    uint32_t nb_tus;
+    /**
+     * Number of bins the arithmetic decoder decoded, context coded and bypass.
+     */
+    uint32_t bins;
+
+    /**
+     * Time in microseconds the decoder spent parsing, reconstructing and
+     * filtering the block, or 0 if it was not measured. Reconstruction
+     * includes the prediction and the residuals. The times are read from a
+     * microsecond clock, so they are only meaningful summed over many blocks.
+     */
+    int64_t parse_time;
+    int64_t recon_time;
+    int64_t filter_time;
+} AVVideoCodingBlockStats;
+
+/**
+ * Get the block at the specified {@code idx}. Must be between 0 and nb_blocks - 1.
+ */
+static av_always_inline AVVideoCodingBlockStats*
+av_video_coding_stats_block(AVVideoCodingStats *stats, unsigned int idx)
+{
+    av_assert0(idx < stats->nb_blocks);
+    return (AVVideoCodingBlockStats *)((uint8_t *)stats + stats->blocks_offset +
+                                       idx * stats->block_size);
+}
+
+/**
+ * Allocates memory for AVVideoCodingStats plus an array of {@code nb_blocks}
+ * zeroed AVVideoCodingBlockStats. Can be freed with a normal av_free() call.
+ *
+ * @param out_size if non-NULL, the size in bytes of the resulting data array is
+ * written here.
+ */
+AVVideoCodingStats *av_video_coding_stats_alloc(unsigned int nb_blocks, size_t *out_size);
+
+/**
+ * Allocates memory for AVVideoCodingStats plus an array of {@code nb_blocks}
+ * AVVideoCodingBlockStats in the given AVFrame {@code frame} as AVFrameSideData
+ * of type AV_FRAME_DATA_VIDEO_CODING_STATS.
+ */
+AVVideoCodingStats*
+av_video_coding_stats_create_side_data(AVFrame *frame, unsigned int nb_blocks);
+
+#endif /* AVUTIL_VIDEO_CODING_STATS_H */
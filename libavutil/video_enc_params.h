@@ -63,6 +63,20 @@ enum AVVideoEncParamsType {
      * resulting quantizer for the block.
      */
     AV_VIDEO_ENC_PARAMS_MPEG2,
+
+    /**
+     * H.266 stores:
+     * - in PPS (per-picture):
+     *   * initial QP_Y (luma) value, exported as AVVideoEncParams.qp
+     *   * offsets of the Cb and Cr QP values, exported in the corresponding
+     *     entries of AVVideoEncParams.delta_qp. The chroma QPs are mapped
+     *     from the luma QP through tables of the SPS before the offsets are
+     *     added, so adding them to the luma QP only gives an approximation.
+     * - per-slice and per-CU QP deltas, not exported directly; the final QP_Y
+     *   of each luma coding unit minus the value in AVVideoEncParams.qp is
+     *   exported as AVVideoBlockParams.delta_qp.
+     */
+    AV_VIDEO_ENC_PARAMS_H266,
 };
 
 /**
@@ -139,7 +139,12 @@ void checkasm_check_vp9dsp(void);
 void checkasm_check_videodsp(void);
 void checkasm_check_vorbisdsp(void);
 void checkasm_check_vvc_alf(void);
+void checkasm_check_vvc_deblock(void);
+void checkasm_check_vvc_intra(void);
+void checkasm_check_vvc_itx(void);
+void checkasm_check_vvc_lmcs(void);
 void checkasm_check_vvc_mc(void);
+void checkasm_check_vvc_sao(void);
 
 struct CheckasmPerf;
 
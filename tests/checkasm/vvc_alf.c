@@ -181,6 +181,47 @@ static void check_alf_classify(VVCDSPContext *c, const int bit_depth)
     }
 }
 
+static void check_alf_filter_cc(VVCDSPContext *c, const int bit_depth)
+{
+    LOCAL_ALIGNED_32(uint8_t, dst0, [DST_BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [DST_BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, src, [SRC_BUF_SIZE]);
+    int16_t filter[ALF_NUM_COEFF_CC];
+
+    ptrdiff_t src_stride = SRC_PIXEL_STRIDE * SIZEOF_PIXEL;
+    ptrdiff_t dst_stride = DST_PIXEL_STRIDE * SIZEOF_PIXEL;
+    int offset = (3 * SRC_PIXEL_STRIDE + 3) * SIZEOF_PIXEL;
+
+    declare_func(void, uint8_t *dst, ptrdiff_t dst_stride, const uint8_t *luma, ptrdiff_t luma_stride,
+        int width, int height, int hs, int vs, const int16_t *filter, int vb_pos);
+
+    randomize_buffers(src, src, SRC_BUF_SIZE);
+    for (int i = 0; i < ALF_NUM_COEFF_CC; i++)
+        filter[i] = (int)(rnd() % 129) - 64;
+
+    // 4:4:4, 4:2:2 and 4:2:0
+    for (int vs = 0; vs <= 1; vs++) {
+        for (int hs = vs; hs <= 1; hs++) {
+            for (int h = 4; h <= MAX_CTU_SIZE >> vs; h += 4) {
+                for (int w = 4; w <= MAX_CTU_SIZE >> hs; w += 4) {
+                    if (((w << hs) % 8) || ((h << vs) % 8))
+                        continue;
+                    if (check_func(c->alf.filter_cc, "vvc_alf_filter_cc_%d%d_%dx%d_%d", hs, vs, w, h, bit_depth)) {
+                        const int vb_pos = get_alf_vb_pos(h << vs, ALF_VB_POS_ABOVE_LUMA);
+                        randomize_buffers(dst0, dst1, DST_BUF_SIZE);
+                        call_ref(dst0, dst_stride, src + offset, src_stride, w, h, hs, vs, filter, vb_pos);
+                        call_new(dst1, dst_stride, src + offset, src_stride, w, h, hs, vs, filter, vb_pos);
+                        if (memcmp(dst0, dst1, DST_BUF_SIZE))
+                            fail();
+                        if (w == h && (w & (w - 1)) == 0)
+                            bench_new(dst1, dst_stride, src + offset, src_stride, w, h, hs, vs, filter, vb_pos);
+                    }
+                }
+            }
+        }
+    }
+}
+
 void checkasm_check_vvc_alf(void)
 {
     int bit_depth;
@@ -196,4 +237,10 @@ void checkasm_check_vvc_alf(void)
         check_alf_classify(&h, bit_depth);
     }
     report("alf_classify");
+
+    for (bit_depth = 8; bit_depth <= 12; bit_depth += 2) {
+        ff_vvc_dsp_init(&h, bit_depth);
+        check_alf_filter_cc(&h, bit_depth);
+    }
+    report("alf_filter_cc");
 }
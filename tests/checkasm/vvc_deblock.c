@@ -0,0 +1,153 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#include "checkasm.h"
+#include "libavcodec/vvc/dsp.h"
+
+#include "libavutil/common.h"
+#include "libavutil/mem_internal.h"
+
+#define SIZEOF_PIXEL ((bit_depth + 7) / 8)
+#define PIXEL_STRIDE 32
+#define BUF_STRIDE   (PIXEL_STRIDE * 2)
+#define BUF_SIZE     (BUF_STRIDE * PIXEL_STRIDE)
+#define EDGE         16
+#define NUM_TESTS    64
+
+// a flat area with some noise and a step at the edge, so all the filter decisions are taken
+static void randomize_edge(uint8_t *buf0, uint8_t *buf1, const int vertical, const int bit_depth)
+{
+    const int max  = (1 << bit_depth) - 1;
+    const int base = rnd() & max;
+    const int amp  = 1 << (rnd() % (bit_depth + 1));
+    const int step = rnd() % (4 * amp + 1);
+
+    for (int y = 0; y < PIXEL_STRIDE; y++) {
+        for (int x = 0; x < PIXEL_STRIDE; x++) {
+            const int pos = vertical ? x : y;
+            const int v   = av_clip(base + (pos >= EDGE ? step : 0) + (int)(rnd() % amp) - amp / 2, 0, max);
+            if (SIZEOF_PIXEL == 2) {
+                ((uint16_t *)buf0)[y * PIXEL_STRIDE + x] = v;
+                ((uint16_t *)buf1)[y * PIXEL_STRIDE + x] = v;
+            } else {
+                buf0[y * BUF_STRIDE + x] = v;
+                buf1[y * BUF_STRIDE + x] = v;
+            }
+        }
+    }
+}
+
+static void randomize_params(int32_t *beta, int32_t *tc, uint8_t *no_p, uint8_t *no_q,
+    uint8_t *max_len_p, uint8_t *max_len_q, const int chroma)
+{
+    static const uint8_t luma_len[]   = { 1, 2, 3, 5, 7 };
+    static const uint8_t chroma_len[] = { 0, 1, 3, 3 };
+
+    for (int i = 0; i < 4; i++) {
+        beta[i]      = rnd() % 89;
+        tc[i]        = (rnd() & 3) ? rnd() % 396 : 0;
+        no_p[i]      = !(rnd() % 5);
+        no_q[i]      = !(rnd() % 5);
+        max_len_p[i] = chroma ? chroma_len[rnd() & 3] : luma_len[rnd() % 5];
+        max_len_q[i] = chroma ? chroma_len[rnd() & 3] : luma_len[rnd() % 5];
+    }
+}
+
+static void check_deblock(VVCDSPContext *c, const int bit_depth, const int chroma)
+{
+    LOCAL_ALIGNED_32(uint8_t, buf0, [BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, buf1, [BUF_SIZE]);
+    int32_t beta[4], tc[4];
+    uint8_t no_p[4], no_q[4], max_len_p[4], max_len_q[4];
+
+    declare_func(void, uint8_t *pix, ptrdiff_t stride, const int32_t *beta, const int32_t *tc,
+        const uint8_t *no_p, const uint8_t *no_q, const uint8_t *max_len_p, const uint8_t *max_len_q, int last);
+
+    memset(buf0, 0, BUF_SIZE);
+    memset(buf1, 0, BUF_SIZE);
+    for (int vertical = 0; vertical < 2; vertical++) {
+        const ptrdiff_t offset = vertical ? (EDGE / 2) * BUF_STRIDE + EDGE * SIZEOF_PIXEL :
+                                            EDGE * BUF_STRIDE + (EDGE / 2) * SIZEOF_PIXEL;
+
+        if (check_func(chroma ? c->lf.filter_chroma[vertical] : c->lf.filter_luma[vertical],
+                "vvc_%s_loop_filter_%s_%d", vertical ? "v" : "h", chroma ? "chroma" : "luma", bit_depth)) {
+            for (int i = 0; i < NUM_TESTS; i++) {
+                const int last = rnd() & 1;
+
+                randomize_edge(buf0, buf1, vertical, bit_depth);
+                randomize_params(beta, tc, no_p, no_q, max_len_p, max_len_q, chroma);
+                call_ref(buf0 + offset, BUF_STRIDE, beta, tc, no_p, no_q, max_len_p, max_len_q, last);
+                call_new(buf1 + offset, BUF_STRIDE, beta, tc, no_p, no_q, max_len_p, max_len_q, last);
+                if (memcmp(buf0, buf1, BUF_SIZE))
+                    fail();
+            }
+            bench_new(buf1 + offset, BUF_STRIDE, beta, tc, no_p, no_q, max_len_p, max_len_q, 0);
+        }
+    }
+}
+
+static void check_ladf_level(VVCDSPContext *c, const int bit_depth)
+{
+    LOCAL_ALIGNED_32(uint8_t, buf0, [BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, buf1, [BUF_SIZE]);
+
+    declare_func(int, const uint8_t *pix, ptrdiff_t stride);
+
+    for (int vertical = 0; vertical < 2; vertical++) {
+        const ptrdiff_t offset = vertical ? (EDGE / 2) * BUF_STRIDE + EDGE * SIZEOF_PIXEL :
+                                            EDGE * BUF_STRIDE + (EDGE / 2) * SIZEOF_PIXEL;
+
+        if (check_func(c->lf.ladf_level[vertical], "vvc_%s_loop_ladf_level_%d", vertical ? "v" : "h", bit_depth)) {
+            for (int i = 0; i < NUM_TESTS; i++) {
+                int level0, level1;
+
+                randomize_edge(buf0, buf1, vertical, bit_depth);
+                level0 = call_ref(buf0 + offset, BUF_STRIDE);
+                level1 = call_new(buf1 + offset, BUF_STRIDE);
+                if (level0 != level1)
+                    fail();
+            }
+            bench_new(buf1 + offset, BUF_STRIDE);
+        }
+    }
+}
+
+void checkasm_check_vvc_deblock(void)
+{
+    VVCDSPContext h;
+
+    for (int bit_depth = 8; bit_depth <= 12; bit_depth += 2) {
+        ff_vvc_dsp_init(&h, bit_depth);
+        check_deblock(&h, bit_depth, 0);
+    }
+    report("deblock_luma");
+
+    for (int bit_depth = 8; bit_depth <= 12; bit_depth += 2) {
+        ff_vvc_dsp_init(&h, bit_depth);
+        check_deblock(&h, bit_depth, 1);
+    }
+    report("deblock_chroma");
+
+    for (int bit_depth = 8; bit_depth <= 12; bit_depth += 2) {
+        ff_vvc_dsp_init(&h, bit_depth);
+        check_ladf_level(&h, bit_depth);
+    }
+    report("ladf_level");
+}
@@ -0,0 +1,307 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#include "checkasm.h"
+#include "libavcodec/vvc/ctu.h"
+#include "libavcodec/vvc/dsp.h"
+#include "libavcodec/vvc/intra.h"
+
+#include "libavutil/common.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/mem_internal.h"
+
+#define SIZEOF_PIXEL ((bit_depth + 7) / 8)
+#define PIXEL_STRIDE MAX_TB_SIZE
+#define PIXEL_BUF_SIZE (PIXEL_STRIDE * MAX_TB_SIZE * 2)
+#define EDGE_SIZE (6 * MAX_TB_SIZE)
+#define EDGE_OFFSET (2 * MAX_TB_SIZE)
+
+static const uint32_t pixel_mask[3] = { 0xffffffff, 0x03ff03ff, 0x0fff0fff };
+
+static void randomize_edge(uint8_t *buf, const int size, const int bit_depth)
+{
+    const uint32_t mask = pixel_mask[(bit_depth - 8) >> 1];
+
+    for (int i = 0; i < size; i += 4)
+        AV_WN32A(buf + i, rnd() & mask);
+}
+
+// the mode after ff_vvc_wide_angle_mode_mapping(), the isp blocks of one or two rows are mapped with
+// the size of their coding block
+static int wide_angle_mode(const int w, const int h, const int pred_mode_intra)
+{
+    const int nh       = h < 4 ? 4 * h : h;
+    const int wh_ratio = FFABS(av_log2(w) - av_log2(nh));
+    const int max      = (wh_ratio > 1) ? (8  + 2 * wh_ratio) : 8;
+    const int min      = (wh_ratio > 1) ? (60 - 2 * wh_ratio) : 60;
+
+    if (w > nh && pred_mode_intra < max)
+        return pred_mode_intra + 65;
+    if (nh > w && pred_mode_intra > min)
+        return pred_mode_intra - 67;
+    return pred_mode_intra;
+}
+
+static void check_pred_dc_planar(VVCDSPContext *c, const int bit_depth, uint8_t *dst0, uint8_t *dst1,
+    const uint8_t *top, const uint8_t *left)
+{
+    const ptrdiff_t stride = PIXEL_STRIDE;
+
+    declare_func(void, uint8_t *src, const uint8_t *top, const uint8_t *left, int w, int h, ptrdiff_t stride);
+
+    for (int h = 1; h <= MAX_TB_SIZE; h *= 2) {
+        for (int w = 4; w <= MAX_TB_SIZE; w *= 2) {
+            if (check_func(c->intra.pred_planar, "vvc_intra_pred_planar_%dx%d_%d", w, h, bit_depth)) {
+                memset(dst0, 0, PIXEL_BUF_SIZE);
+                memset(dst1, 0, PIXEL_BUF_SIZE);
+                call_ref(dst0, top, left, w, h, stride);
+                call_new(dst1, top, left, w, h, stride);
+                if (memcmp(dst0, dst1, PIXEL_BUF_SIZE))
+                    fail();
+                bench_new(dst1, top, left, w, h, stride);
+            }
+            if (check_func(c->intra.pred_dc, "vvc_intra_pred_dc_%dx%d_%d", w, h, bit_depth)) {
+                memset(dst0, 0, PIXEL_BUF_SIZE);
+                memset(dst1, 0, PIXEL_BUF_SIZE);
+                call_ref(dst0, top, left, w, h, stride);
+                call_new(dst1, top, left, w, h, stride);
+                if (memcmp(dst0, dst1, PIXEL_BUF_SIZE))
+                    fail();
+                bench_new(dst1, top, left, w, h, stride);
+            }
+        }
+    }
+}
+
+static void check_pred_v_h(VVCDSPContext *c, const int bit_depth, uint8_t *dst0, uint8_t *dst1,
+    const uint8_t *top, const uint8_t *left)
+{
+    const ptrdiff_t stride = PIXEL_STRIDE;
+
+    declare_func(void, uint8_t *src, const uint8_t *edge, int w, int h, ptrdiff_t stride);
+
+    for (int h = 1; h <= MAX_TB_SIZE; h *= 2) {
+        for (int w = 4; w <= MAX_TB_SIZE; w *= 2) {
+            if (check_func(c->intra.pred_v, "vvc_intra_pred_v_%dx%d_%d", w, h, bit_depth)) {
+                memset(dst0, 0, PIXEL_BUF_SIZE);
+                memset(dst1, 0, PIXEL_BUF_SIZE);
+                call_ref(dst0, top, w, h, stride);
+                call_new(dst1, top, w, h, stride);
+                if (memcmp(dst0, dst1, PIXEL_BUF_SIZE))
+                    fail();
+                bench_new(dst1, top, w, h, stride);
+            }
+            if (check_func(c->intra.pred_h, "vvc_intra_pred_h_%dx%d_%d", w, h, bit_depth)) {
+                memset(dst0, 0, PIXEL_BUF_SIZE);
+                memset(dst1, 0, PIXEL_BUF_SIZE);
+                call_ref(dst0, left, w, h, stride);
+                call_new(dst1, left, w, h, stride);
+                if (memcmp(dst0, dst1, PIXEL_BUF_SIZE))
+                    fail();
+                bench_new(dst1, left, w, h, stride);
+            }
+        }
+    }
+}
+
+static void check_pred_angular(VVCDSPContext *c, const int bit_depth, uint8_t *dst0, uint8_t *dst1,
+    const uint8_t *top, const uint8_t *left)
+{
+    const ptrdiff_t stride = PIXEL_STRIDE;
+
+    declare_func(void, uint8_t *src, const uint8_t *top, const uint8_t *left, int w, int h, ptrdiff_t stride,
+        int c_idx, int mode, int ref_idx, int filter_flag, int need_pdpc);
+
+    for (int vertical = 0; vertical < 2; vertical++) {
+        for (int h = 1; h <= MAX_TB_SIZE; h *= 2) {
+            for (int w = 4; w <= MAX_TB_SIZE; w *= 2) {
+                if (check_func(vertical ? c->intra.pred_angular_v : c->intra.pred_angular_h,
+                        "vvc_intra_pred_angular_%s_%dx%d_%d", vertical ? "v" : "h", w, h, bit_depth)) {
+                    for (int pred_mode_intra = 2; pred_mode_intra <= INTRA_VDIAG; pred_mode_intra++) {
+                        const int mode        = wide_angle_mode(w, h, pred_mode_intra);
+                        // the isp blocks of one or two rows are luma only
+                        const int c_idx       = h < 4 ? 0 : rnd() % 3;
+                        const int ref_idx     = c_idx ? 0 : rnd() % 3;
+                        const int filter_flag = !c_idx && !ref_idx && (rnd() & 1);
+                        const int need_pdpc   = ff_vvc_need_pdpc(w, h, 0, mode, ref_idx);
+
+                        if (mode == INTRA_HORZ || mode == INTRA_VERT || (mode >= INTRA_DIAG) != vertical)
+                            continue;
+
+                        memset(dst0, 0, PIXEL_BUF_SIZE);
+                        memset(dst1, 0, PIXEL_BUF_SIZE);
+                        call_ref(dst0, top, left, w, h, stride, c_idx, mode, ref_idx, filter_flag, need_pdpc);
+                        call_new(dst1, top, left, w, h, stride, c_idx, mode, ref_idx, filter_flag, need_pdpc);
+                        if (memcmp(dst0, dst1, PIXEL_BUF_SIZE))
+                            fail();
+                    }
+                    bench_new(dst1, top, left, w, h, stride, 0, vertical ? 40 : 26, 0, 1, 0);
+                }
+            }
+        }
+    }
+}
+
+static void check_pred_mip(VVCDSPContext *c, const int bit_depth, uint8_t *dst0, uint8_t *dst1,
+    const uint8_t *top, const uint8_t *left)
+{
+    static const int num_modes[] = { 16, 8, 6 };
+    const ptrdiff_t stride = PIXEL_STRIDE;
+
+    declare_func(void, uint8_t *src, const uint8_t *top, const uint8_t *left, int w, int h, ptrdiff_t stride,
+        int mode_id, int is_transposed);
+
+    for (int h = 4; h <= MAX_TB_SIZE; h *= 2) {
+        for (int w = 4; w <= MAX_TB_SIZE; w *= 2) {
+            if (check_func(c->intra.pred_mip, "vvc_intra_pred_mip_%dx%d_%d", w, h, bit_depth)) {
+                const int size_id = ff_vvc_get_mip_size_id(w, h);
+
+                for (int mode_id = 0; mode_id < num_modes[size_id]; mode_id++) {
+                    const int is_transposed = rnd() & 1;
+
+                    memset(dst0, 0, PIXEL_BUF_SIZE);
+                    memset(dst1, 0, PIXEL_BUF_SIZE);
+                    call_ref(dst0, top, left, w, h, stride, mode_id, is_transposed);
+                    call_new(dst1, top, left, w, h, stride, mode_id, is_transposed);
+                    if (memcmp(dst0, dst1, PIXEL_BUF_SIZE))
+                        fail();
+                }
+                bench_new(dst1, top, left, w, h, stride, 0, 0);
+            }
+        }
+    }
+}
+
+static void check_cclm(VVCDSPContext *c, const int bit_depth, uint8_t *dst0, uint8_t *dst1,
+    uint8_t *luma)
+{
+    const ptrdiff_t luma_stride = 2 * PIXEL_STRIDE;
+    const uint8_t *src = luma + (luma_stride + 1) * SIZEOF_PIXEL;
+
+    declare_func(void, uint8_t *dsy, const uint8_t *src, ptrdiff_t stride, int w, int h,
+        int vs, int avail_t, int avail_l, int collocated);
+
+    for (int type = 0; type < 3; type++) {
+        const int vs         = type > 0;
+        const int collocated = type > 1;
+        static const char *const types[] = { "422", "420", "420_collocated" };
+
+        for (int h = 2; h <= MAX_TB_SIZE / 2; h *= 2) {
+            for (int w = 2; w <= MAX_TB_SIZE / 2; w *= 2) {
+                if (check_func(c->intra.cclm_luma_downsample, "vvc_cclm_downsample_%s_%dx%d_%d",
+                        types[type], w, h, bit_depth)) {
+                    for (int avail = 0; avail < 4; avail++) {
+                        memset(dst0, 0, PIXEL_BUF_SIZE);
+                        memset(dst1, 0, PIXEL_BUF_SIZE);
+                        call_ref(dst0, src, luma_stride, w, h, vs, avail & 1, avail >> 1, collocated);
+                        call_new(dst1, src, luma_stride, w, h, vs, avail & 1, avail >> 1, collocated);
+                        if (memcmp(dst0, dst1, PIXEL_BUF_SIZE))
+                            fail();
+                    }
+                    bench_new(dst1, src, luma_stride, w, h, vs, 1, 1, collocated);
+                }
+            }
+        }
+    }
+}
+
+static void check_cclm_linear_pred(VVCDSPContext *c, const int bit_depth, uint8_t *dst0, uint8_t *dst1,
+    const uint8_t *dsy)
+{
+    const ptrdiff_t stride = PIXEL_STRIDE;
+
+    declare_func(void, uint8_t *src, ptrdiff_t stride, const uint8_t *dsy, int w, int h, int a, int b, int k);
+
+    for (int h = 2; h <= MAX_TB_SIZE; h *= 2) {
+        for (int w = 2; w <= MAX_TB_SIZE; w *= 2) {
+            if (check_func(c->intra.cclm_linear_pred, "vvc_cclm_linear_pred_%dx%d_%d", w, h, bit_depth)) {
+                const int a = (int)(rnd() % 31) - 15;
+                const int k = 1 + rnd() % 16;
+                const int b = (int)(rnd() % (4 << bit_depth)) - (2 << bit_depth);
+
+                memset(dst0, 0, PIXEL_BUF_SIZE);
+                memset(dst1, 0, PIXEL_BUF_SIZE);
+                call_ref(dst0, stride, dsy, w, h, a, b, k);
+                call_new(dst1, stride, dsy, w, h, a, b, k);
+                if (memcmp(dst0, dst1, PIXEL_BUF_SIZE))
+                    fail();
+                bench_new(dst1, stride, dsy, w, h, a, b, k);
+            }
+        }
+    }
+}
+
+void checkasm_check_vvc_intra(void)
+{
+    LOCAL_ALIGNED_32(uint8_t, dst0, [PIXEL_BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [PIXEL_BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, top,  [EDGE_SIZE * 2]);
+    LOCAL_ALIGNED_32(uint8_t, left, [EDGE_SIZE * 2]);
+    LOCAL_ALIGNED_32(uint8_t, luma, [PIXEL_BUF_SIZE * 4]);
+    VVCDSPContext h;
+
+    for (int bit_depth = 8; bit_depth <= 12; bit_depth += 2) {
+        const int offset = EDGE_OFFSET * SIZEOF_PIXEL;
+
+        ff_vvc_dsp_init(&h, bit_depth);
+        randomize_edge(top,  EDGE_SIZE * 2, bit_depth);
+        randomize_edge(left, EDGE_SIZE * 2, bit_depth);
+        check_pred_dc_planar(&h, bit_depth, dst0, dst1, top + offset, left + offset);
+    }
+    report("pred_dc_planar");
+
+    for (int bit_depth = 8; bit_depth <= 12; bit_depth += 2) {
+        const int offset = EDGE_OFFSET * SIZEOF_PIXEL;
+
+        ff_vvc_dsp_init(&h, bit_depth);
+        randomize_edge(top,  EDGE_SIZE * 2, bit_depth);
+        randomize_edge(left, EDGE_SIZE * 2, bit_depth);
+        check_pred_v_h(&h, bit_depth, dst0, dst1, top + offset, left + offset);
+    }
+    report("pred_v_h");
+
+    for (int bit_depth = 8; bit_depth <= 12; bit_depth += 2) {
+        const int offset = EDGE_OFFSET * SIZEOF_PIXEL;
+
+        ff_vvc_dsp_init(&h, bit_depth);
+        randomize_edge(top,  EDGE_SIZE * 2, bit_depth);
+        randomize_edge(left, EDGE_SIZE * 2, bit_depth);
+        check_pred_angular(&h, bit_depth, dst0, dst1, top + offset, left + offset);
+    }
+    report("pred_angular");
+
+    for (int bit_depth = 8; bit_depth <= 12; bit_depth += 2) {
+        const int offset = EDGE_OFFSET * SIZEOF_PIXEL;
+
+        ff_vvc_dsp_init(&h, bit_depth);
+        randomize_edge(top,  EDGE_SIZE * 2, bit_depth);
+        randomize_edge(left, EDGE_SIZE * 2, bit_depth);
+        check_pred_mip(&h, bit_depth, dst0, dst1, top + offset, left + offset);
+    }
+    report("pred_mip");
+
+    for (int bit_depth = 8; bit_depth <= 12; bit_depth += 2) {
+        ff_vvc_dsp_init(&h, bit_depth);
+        randomize_edge(luma, PIXEL_BUF_SIZE * 4, bit_depth);
+        check_cclm(&h, bit_depth, dst0, dst1, luma);
+        check_cclm_linear_pred(&h, bit_depth, dst0, dst1, luma);
+    }
+    report("cclm");
+}
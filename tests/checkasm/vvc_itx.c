@@ -0,0 +1,280 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#include "checkasm.h"
+#include "libavcodec/vvc/ctu.h"
+#include "libavcodec/vvc/dsp.h"
+
+#include "libavutil/common.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/mem_internal.h"
+
+#define LOG2_TRANSFORM_RANGE 15
+#define PIXEL_STRIDE (MAX_TB_SIZE * 2)
+#define PIXEL_BUF_SIZE (PIXEL_STRIDE * MAX_TB_SIZE)
+
+static const uint32_t pixel_mask[3] = { 0xffffffff, 0x03ff03ff, 0x0fff0fff };
+
+static const char *const tx_type_names[N_TX_TYPE] = { "dct2", "dst7", "dct8" };
+
+static int max_nz(const enum TxType type, const int log2_size)
+{
+    // zero out of the high frequencies
+    if (type != DCT2)
+        return FFMIN(1 << log2_size, 16);
+    return FFMIN(1 << log2_size, 32);
+}
+
+static void randomize_coeffs(int *coeffs0, int *coeffs1, const int w, const int h, const int nzw, const int nzh)
+{
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            const int i = y * w + x;
+
+            coeffs0[i] = coeffs1[i] = (x < nzw && y < nzh) ? sign_extend(rnd(), LOG2_TRANSFORM_RANGE + 1) : 0;
+        }
+    }
+}
+
+static void randomize_pixels(uint8_t *buf0, uint8_t *buf1, const int bit_depth)
+{
+    const uint32_t mask = pixel_mask[(bit_depth - 8) >> 1];
+
+    for (int i = 0; i < PIXEL_BUF_SIZE; i += 4) {
+        const uint32_t r = rnd() & mask;
+        AV_WN32A(buf0 + i, r);
+        AV_WN32A(buf1 + i, r);
+    }
+}
+
+static void randomize_residuals(int *res0, int *res1, const int size)
+{
+    for (int i = 0; i < size; i++)
+        res0[i] = res1[i] = sign_extend(rnd(), LOG2_TRANSFORM_RANGE + 1);
+}
+
+static void check_add_residual(VVCDSPContext *c, const int bit_depth)
+{
+    LOCAL_ALIGNED_32(uint8_t, dst0, [PIXEL_BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [PIXEL_BUF_SIZE]);
+    LOCAL_ALIGNED_32(int, res, [MAX_TB_SIZE * MAX_TB_SIZE]);
+    LOCAL_ALIGNED_32(int, res1, [MAX_TB_SIZE * MAX_TB_SIZE]);
+
+    for (int h = 2; h <= MAX_TB_SIZE; h *= 2) {
+        for (int w = 2; w <= MAX_TB_SIZE; w *= 2) {
+            {
+                declare_func(void, uint8_t *dst, const int *res, int width, int height, ptrdiff_t stride);
+
+                if (check_func(c->itx.add_residual, "vvc_add_residual_%dx%d_%d", w, h, bit_depth)) {
+                    randomize_pixels(dst0, dst1, bit_depth);
+                    randomize_residuals(res, res1, w * h);
+                    call_ref(dst0, res, w, h, PIXEL_STRIDE);
+                    call_new(dst1, res, w, h, PIXEL_STRIDE);
+                    if (memcmp(dst0, dst1, PIXEL_BUF_SIZE))
+                        fail();
+                    bench_new(dst1, res, w, h, PIXEL_STRIDE);
+                }
+            }
+            {
+                declare_func(void, uint8_t *dst, int dc, int width, int height, ptrdiff_t stride);
+
+                if (check_func(c->itx.add_residual_dc, "vvc_add_residual_dc_%dx%d_%d", w, h, bit_depth)) {
+                    const int dc = sign_extend(rnd(), LOG2_TRANSFORM_RANGE + 1);
+
+                    randomize_pixels(dst0, dst1, bit_depth);
+                    call_ref(dst0, dc, w, h, PIXEL_STRIDE);
+                    call_new(dst1, dc, w, h, PIXEL_STRIDE);
+                    if (memcmp(dst0, dst1, PIXEL_BUF_SIZE))
+                        fail();
+                    bench_new(dst1, dc, w, h, PIXEL_STRIDE);
+                }
+            }
+            {
+                declare_func(void, uint8_t *dst, const int *res, int width, int height, ptrdiff_t stride,
+                    int c_sign, int shift);
+
+                if (check_func(c->itx.add_residual_joint, "vvc_add_residual_joint_%dx%d_%d", w, h, bit_depth)) {
+                    const int c_sign = (rnd() & 1) ? 1 : -1;
+                    const int shift  = rnd() & 1;
+
+                    randomize_pixels(dst0, dst1, bit_depth);
+                    randomize_residuals(res, res1, w * h);
+                    call_ref(dst0, res, w, h, PIXEL_STRIDE, c_sign, shift);
+                    call_new(dst1, res, w, h, PIXEL_STRIDE, c_sign, shift);
+                    if (memcmp(dst0, dst1, PIXEL_BUF_SIZE))
+                        fail();
+                    bench_new(dst1, res, w, h, PIXEL_STRIDE, c_sign, shift);
+                }
+            }
+            {
+                declare_func(void, int *buf, int width, int height, int c_sign, int shift);
+
+                if (check_func(c->itx.pred_residual_joint, "vvc_pred_residual_joint_%dx%d_%d", w, h, bit_depth)) {
+                    const int c_sign = (rnd() & 1) ? 1 : -1;
+                    const int shift  = rnd() & 1;
+
+                    randomize_residuals(res, res1, w * h);
+                    call_ref(res, w, h, c_sign, shift);
+                    call_new(res1, w, h, c_sign, shift);
+                    if (memcmp(res, res1, w * h * sizeof(*res)))
+                        fail();
+                    bench_new(res1, w, h, c_sign, shift);
+                }
+            }
+        }
+    }
+
+    for (int h = 8; h <= MAX_TB_SIZE; h *= 2) {
+        for (int i = 0; i < FF_ARRAY_ELEMS(c->itx.add_residual_isp); i++) {
+            declare_func(void, uint8_t *dst, const int *res, int height, ptrdiff_t stride);
+
+            if (check_func(c->itx.add_residual_isp[i], "vvc_add_residual_isp_%dx%d_%d", 1 << i, h, bit_depth)) {
+                randomize_pixels(dst0, dst1, bit_depth);
+                randomize_residuals(res, res1, 4 * h);
+                call_ref(dst0, res, h, PIXEL_STRIDE);
+                call_new(dst1, res, h, PIXEL_STRIDE);
+                if (memcmp(dst0, dst1, PIXEL_BUF_SIZE))
+                    fail();
+                bench_new(dst1, res, h, PIXEL_STRIDE);
+            }
+        }
+    }
+}
+
+static void check_itx_2d(VVCDSPContext *c, const int bit_depth)
+{
+    LOCAL_ALIGNED_32(int, coeffs0, [MAX_TB_SIZE * MAX_TB_SIZE]);
+    LOCAL_ALIGNED_32(int, coeffs1, [MAX_TB_SIZE * MAX_TB_SIZE]);
+    const int shift = 5 + LOG2_TRANSFORM_RANGE - bit_depth;
+
+    declare_func(void, int *coeffs, int log2_w, int log2_h, enum TxType trh, enum TxType trv,
+        size_t nzw, size_t nzh, int shift, int log2_transform_range);
+
+    for (int log2_h = 1; log2_h <= 6; log2_h++) {
+        for (int log2_w = 1; log2_w <= 6; log2_w++) {
+            for (enum TxType trv = DCT2; trv < N_TX_TYPE; trv++) {
+                for (enum TxType trh = DCT2; trh < N_TX_TYPE; trh++) {
+                    const int w = 1 << log2_w;
+                    const int h = 1 << log2_h;
+
+                    if ((trh != DCT2 && (log2_w < 2 || log2_w > 5)) ||
+                        (trv != DCT2 && (log2_h < 2 || log2_h > 5)))
+                        continue;
+
+                    if (check_func(c->itx.itx_2d, "vvc_itx_2d_%s_%s_%dx%d_%d",
+                            tx_type_names[trh], tx_type_names[trv], w, h, bit_depth)) {
+                        const int nzw = 1 + rnd() % max_nz(trh, log2_w);
+                        const int nzh = 1 + rnd() % max_nz(trv, log2_h);
+
+                        randomize_coeffs(coeffs0, coeffs1, w, h, nzw, nzh);
+                        call_ref(coeffs0, log2_w, log2_h, trh, trv, nzw, nzh, shift, LOG2_TRANSFORM_RANGE);
+                        call_new(coeffs1, log2_w, log2_h, trh, trv, nzw, nzh, shift, LOG2_TRANSFORM_RANGE);
+                        if (memcmp(coeffs0, coeffs1, w * h * sizeof(*coeffs0)))
+                            fail();
+
+                        randomize_coeffs(coeffs0, coeffs1, w, h, max_nz(trh, log2_w), max_nz(trv, log2_h));
+                        bench_new(coeffs1, log2_w, log2_h, trh, trv,
+                            max_nz(trh, log2_w), max_nz(trv, log2_h), shift, LOG2_TRANSFORM_RANGE);
+                    }
+                }
+            }
+        }
+    }
+}
+
+static void check_lfnst(VVCDSPContext *c)
+{
+    int u[16], v0[48], v1[48];
+
+    declare_func(void, int *v, const int *u, int no_zero_size, int n_tr_s,
+        int pred_mode_intra, int lfnst_idx, int log2_transform_range);
+
+    for (int n_tr_s = 16; n_tr_s <= 48; n_tr_s += 32) {
+        for (int no_zero_size = 8; no_zero_size <= 16; no_zero_size += 8) {
+            if (check_func(c->itx.lfnst, "vvc_lfnst_%dx%d", no_zero_size, n_tr_s)) {
+                // -1 is the cclm set
+                const int pred_mode_intra = (int)(rnd() % 96) - 1;
+                const int lfnst_idx       = 1 + (rnd() & 1);
+
+                randomize_residuals(u, u, no_zero_size);
+                memset(v0, 0, sizeof(v0));
+                memset(v1, 0, sizeof(v1));
+                call_ref(v0, u, no_zero_size, n_tr_s, pred_mode_intra, lfnst_idx, LOG2_TRANSFORM_RANGE);
+                call_new(v1, u, no_zero_size, n_tr_s, pred_mode_intra, lfnst_idx, LOG2_TRANSFORM_RANGE);
+                if (memcmp(v0, v1, sizeof(v0)))
+                    fail();
+                bench_new(v1, u, no_zero_size, n_tr_s, pred_mode_intra, lfnst_idx, LOG2_TRANSFORM_RANGE);
+            }
+        }
+    }
+}
+
+static void check_transform_bdpcm(VVCDSPContext *c)
+{
+    LOCAL_ALIGNED_32(int, coeffs0, [MAX_TB_SIZE * MAX_TB_SIZE]);
+    LOCAL_ALIGNED_32(int, coeffs1, [MAX_TB_SIZE * MAX_TB_SIZE]);
+
+    declare_func(void, int *coeffs, int width, int height, int vertical, int log2_transform_range);
+
+    // up to the maximum transform skip size
+    for (int h = 2; h <= 32; h *= 2) {
+        for (int w = 2; w <= 32; w *= 2) {
+            for (int vertical = 0; vertical <= 1; vertical++) {
+                if (check_func(c->itx.transform_bdpcm, "vvc_transform_bdpcm_%s_%dx%d",
+                        vertical ? "v" : "h", w, h)) {
+                    // small residuals as in screen content, and full range ones to hit the clipping
+                    for (int bits = 8; bits <= LOG2_TRANSFORM_RANGE + 1; bits += LOG2_TRANSFORM_RANGE + 1 - 8) {
+                        for (int i = 0; i < w * h; i++)
+                            coeffs0[i] = coeffs1[i] = sign_extend(rnd(), bits);
+                        call_ref(coeffs0, w, h, vertical, LOG2_TRANSFORM_RANGE);
+                        call_new(coeffs1, w, h, vertical, LOG2_TRANSFORM_RANGE);
+                        if (memcmp(coeffs0, coeffs1, w * h * sizeof(*coeffs0)))
+                            fail();
+                    }
+                    bench_new(coeffs1, w, h, vertical, LOG2_TRANSFORM_RANGE);
+                }
+            }
+        }
+    }
+}
+
+void checkasm_check_vvc_itx(void)
+{
+    VVCDSPContext h;
+
+    for (int bit_depth = 8; bit_depth <= 12; bit_depth += 2) {
+        ff_vvc_dsp_init(&h, bit_depth);
+        check_itx_2d(&h, bit_depth);
+    }
+    report("itx_2d");
+
+    for (int bit_depth = 8; bit_depth <= 12; bit_depth += 2) {
+        ff_vvc_dsp_init(&h, bit_depth);
+        check_add_residual(&h, bit_depth);
+    }
+    report("add_residual");
+
+    ff_vvc_dsp_init(&h, 8);
+    check_lfnst(&h);
+    report("lfnst");
+
+    check_transform_bdpcm(&h);
+    report("transform_bdpcm");
+}
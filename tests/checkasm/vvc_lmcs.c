@@ -0,0 +1,117 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <string.h>
+
+#include "checkasm.h"
+#include "libavcodec/vvc/ctu.h"
+#include "libavcodec/vvc/dsp.h"
+#include "libavcodec/vvc/ps.h"
+
+#include "libavutil/intreadwrite.h"
+#include "libavutil/mem_internal.h"
+
+#define SIZEOF_PIXEL ((bit_depth + 7) / 8)
+#define PIXEL_STRIDE (MAX_CTU_SIZE * 2)
+#define PIXEL_BUF_SIZE (PIXEL_STRIDE * MAX_CTU_SIZE)
+#define COEFF_BUF_SIZE (MAX_TB_SIZE * MAX_TB_SIZE)
+// the simd versions may read a few bytes beyond the last lut entry
+#define LUT_BUF_SIZE (LMCS_MAX_LUT_SIZE * 2 + 64)
+
+static const uint32_t pixel_mask[3] = { 0xffffffff, 0x03ff03ff, 0x0fff0fff };
+
+static void randomize_buffer(uint8_t *buf, const int size, const int bit_depth)
+{
+    const uint32_t mask = pixel_mask[(bit_depth - 8) >> 1];
+
+    for (int i = 0; i < size; i += 4)
+        AV_WN32A(buf + i, rnd() & mask);
+}
+
+static void check_lmcs_filter(VVCDSPContext *c, const int bit_depth, uint8_t *dst0, uint8_t *dst1,
+    const uint8_t *lut)
+{
+    const ptrdiff_t stride = PIXEL_STRIDE;
+
+    declare_func(void, uint8_t *dst, ptrdiff_t dst_stride, int width, int height, const void *lut);
+
+    for (int h = 4; h <= MAX_CTU_SIZE; h *= 2) {
+        for (int w = 4; w <= MAX_CTU_SIZE; w *= 2) {
+            if (check_func(c->lmcs.filter, "vvc_lmcs_filter_%dx%d_%d", w, h, bit_depth)) {
+                randomize_buffer(dst0, PIXEL_BUF_SIZE, bit_depth);
+                memcpy(dst1, dst0, PIXEL_BUF_SIZE);
+                call_ref(dst0, stride, w, h, lut);
+                call_new(dst1, stride, w, h, lut);
+                if (memcmp(dst0, dst1, PIXEL_BUF_SIZE))
+                    fail();
+                bench_new(dst1, stride, w, h, lut);
+            }
+        }
+    }
+}
+
+static void check_lmcs_scale_chroma_residual(VVCDSPContext *c, const int bit_depth)
+{
+    LOCAL_ALIGNED_32(int, coeff, [COEFF_BUF_SIZE]);
+    LOCAL_ALIGNED_32(int, dst0,  [COEFF_BUF_SIZE]);
+    LOCAL_ALIGNED_32(int, dst1,  [COEFF_BUF_SIZE]);
+
+    declare_func(void, int *dst, const int *coeff, int width, int height, int chroma_scale);
+
+    for (int h = 2; h <= MAX_TB_SIZE; h *= 2) {
+        for (int w = 2; w <= MAX_TB_SIZE; w *= 2) {
+            if (check_func(c->lmcs.scale_chroma_residual, "vvc_lmcs_scale_chroma_residual_%dx%d_%d",
+                    w, h, bit_depth)) {
+                // the scale is a 16 bit value derived from the lmcs codeword sizes
+                const int chroma_scale = rnd() & 0xffff;
+
+                // beyond the residual range to cover the clipping
+                for (int i = 0; i < COEFF_BUF_SIZE; i++)
+                    coeff[i] = (int)(rnd() % (8 << bit_depth)) - (4 << bit_depth);
+                memset(dst0, 0, sizeof(*dst0) * COEFF_BUF_SIZE);
+                memset(dst1, 0, sizeof(*dst1) * COEFF_BUF_SIZE);
+                call_ref(dst0, coeff, w, h, chroma_scale);
+                call_new(dst1, coeff, w, h, chroma_scale);
+                if (memcmp(dst0, dst1, sizeof(*dst0) * COEFF_BUF_SIZE))
+                    fail();
+                bench_new(dst1, coeff, w, h, chroma_scale);
+            }
+        }
+    }
+}
+
+void checkasm_check_vvc_lmcs(void)
+{
+    LOCAL_ALIGNED_32(uint8_t, dst0, [PIXEL_BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [PIXEL_BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, lut,  [LUT_BUF_SIZE]);
+    VVCDSPContext h;
+
+    for (int bit_depth = 8; bit_depth <= 12; bit_depth += 2) {
+        ff_vvc_dsp_init(&h, bit_depth);
+        randomize_buffer(lut, LUT_BUF_SIZE, bit_depth);
+        check_lmcs_filter(&h, bit_depth, dst0, dst1, lut);
+    }
+    report("lmcs_filter");
+
+    for (int bit_depth = 8; bit_depth <= 12; bit_depth += 2) {
+        ff_vvc_dsp_init(&h, bit_depth);
+        check_lmcs_scale_chroma_residual(&h, bit_depth);
+    }
+    report("lmcs_scale_chroma_residual");
+}
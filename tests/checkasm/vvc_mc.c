@@ -262,6 +262,209 @@ static void check_put_vvc_chroma_uni(void)
     report("put_uni_chroma");
 }
 
+static void check_put_vvc_bi(void)
+{
+    LOCAL_ALIGNED_32(uint8_t, dst0, [DST_BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [DST_BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, src0, [SRC_BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, src1, [SRC_BUF_SIZE]);
+    LOCAL_ALIGNED_32(int16_t, pred0, [DST_BUF_SIZE / 2]);
+    LOCAL_ALIGNED_32(int16_t, pred1, [DST_BUF_SIZE / 2]);
+    VVCDSPContext c;
+
+    declare_func(void, uint8_t *dst, ptrdiff_t dst_stride, const int16_t *src0,
+        const uint8_t *src, ptrdiff_t src_stride, int height,
+        const int8_t *hf, const int8_t *vf, int width);
+
+    for (int bit_depth = 8; bit_depth <= 12; bit_depth += 2) {
+        ff_vvc_dsp_init(&c, bit_depth);
+        randomize_pixels(src0, src1, SRC_BUF_SIZE);
+        randomize_avg_src((uint8_t*)pred0, (uint8_t*)pred1, DST_BUF_SIZE);
+        for (int is_chroma = 0; is_chroma <= 1; is_chroma++) {
+            for (int i = 0; i < 2; i++) {
+                for (int j = 0; j < 2; j++) {
+                    for (int h = 4 >> is_chroma; h <= MAX_CTU_SIZE; h *= 2) {
+                        for (int w = 4 >> is_chroma; w <= MAX_CTU_SIZE; w *= 2) {
+                            const int idx    = av_log2(w) - 1;
+                            const int8_t *hf = is_chroma ?
+                                ff_vvc_inter_chroma_filters[rnd() % VVC_INTER_CHROMA_FILTER_TYPES][rnd() % VVC_INTER_CHROMA_FACTS] :
+                                ff_vvc_inter_luma_filters[rnd() % VVC_INTER_LUMA_FILTER_TYPES][rnd() % VVC_INTER_LUMA_FACTS];
+                            const int8_t *vf = is_chroma ?
+                                ff_vvc_inter_chroma_filters[rnd() % VVC_INTER_CHROMA_FILTER_TYPES][rnd() % VVC_INTER_CHROMA_FACTS] :
+                                ff_vvc_inter_luma_filters[rnd() % VVC_INTER_LUMA_FILTER_TYPES][rnd() % VVC_INTER_LUMA_FACTS];
+                            static const char *const types[] = { "pixels", "h", "v", "hv" };
+
+                            if (check_func(c.inter.put_bi[is_chroma][idx][j][i], "put_bi_%s_%s_%d_%dx%d",
+                                    is_chroma ? "chroma" : "luma", types[(j << 1) | i], bit_depth, w, h)) {
+                                memset(dst0, 0, DST_BUF_SIZE);
+                                memset(dst1, 0, DST_BUF_SIZE);
+                                call_ref(dst0, PIXEL_STRIDE, pred0, src0 + SRC_OFFSET, PIXEL_STRIDE, h, hf, vf, w);
+                                call_new(dst1, PIXEL_STRIDE, pred1, src1 + SRC_OFFSET, PIXEL_STRIDE, h, hf, vf, w);
+                                if (memcmp(dst0, dst1, DST_BUF_SIZE))
+                                    fail();
+                                if (w == h)
+                                    bench_new(dst1, PIXEL_STRIDE, pred1, src1 + SRC_OFFSET, PIXEL_STRIDE, h, hf, vf, w);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+    report("put_bi");
+}
+
+static void check_put_vvc_uni_w(void)
+{
+    LOCAL_ALIGNED_32(uint8_t, dst0, [DST_BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [DST_BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, src0, [SRC_BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, src1, [SRC_BUF_SIZE]);
+
+    VVCDSPContext c;
+    declare_func(void, uint8_t *dst, ptrdiff_t dststride,
+        const uint8_t *src, ptrdiff_t srcstride, int height,
+        int denom, int wx, int ox, const int8_t *hf, const int8_t *vf, int width);
+
+    for (int bit_depth = 8; bit_depth <= 12; bit_depth += 2) {
+        ff_vvc_dsp_init(&c, bit_depth);
+        randomize_pixels(src0, src1, SRC_BUF_SIZE);
+        for (int chroma = 0; chroma < 2; chroma++) {
+            for (int i = 0; i < 2; i++) {
+                for (int j = 0; j < 2; j++) {
+                    for (int h = 4 >> chroma; h <= MAX_CTU_SIZE; h *= 2) {
+                        for (int w = 4 >> chroma; w <= MAX_CTU_SIZE; w *= 2) {
+                            const int idx       = av_log2(w) - 1;
+                            const int denom     = rnd() % 8;
+                            const int wx        = rnd() % 256 - 128;
+                            const int ox        = rnd() % 256 - 128;
+                            const int8_t *hf    = chroma ?
+                                ff_vvc_inter_chroma_filters[rnd() % VVC_INTER_CHROMA_FILTER_TYPES][rnd() % VVC_INTER_CHROMA_FACTS] :
+                                ff_vvc_inter_luma_filters[rnd() % VVC_INTER_LUMA_FILTER_TYPES][rnd() % VVC_INTER_LUMA_FACTS];
+                            const int8_t *vf    = chroma ?
+                                ff_vvc_inter_chroma_filters[rnd() % VVC_INTER_CHROMA_FILTER_TYPES][rnd() % VVC_INTER_CHROMA_FACTS] :
+                                ff_vvc_inter_luma_filters[rnd() % VVC_INTER_LUMA_FILTER_TYPES][rnd() % VVC_INTER_LUMA_FACTS];
+                            const char *type;
+
+                            switch ((j << 1) | i) {
+                                case 0: type = "put_uni_w_pixels"; break; // 0 0
+                                case 1: type = "put_uni_w_h"; break; // 0 1
+                                case 2: type = "put_uni_w_v"; break; // 1 0
+                                case 3: type = "put_uni_w_hv"; break; // 1 1
+                            }
+
+                            if (check_func(c.inter.put_uni_w[chroma][idx][j][i], "%s_%s_%d_%dx%d", type,
+                                    chroma ? "chroma" : "luma", bit_depth, w, h)) {
+                                memset(dst0, 0, DST_BUF_SIZE);
+                                memset(dst1, 0, DST_BUF_SIZE);
+                                call_ref(dst0, PIXEL_STRIDE, src0 + SRC_OFFSET, PIXEL_STRIDE, h, denom, wx, ox, hf, vf, w);
+                                call_new(dst1, PIXEL_STRIDE, src1 + SRC_OFFSET, PIXEL_STRIDE, h, denom, wx, ox, hf, vf, w);
+                                if (memcmp(dst0, dst1, DST_BUF_SIZE))
+                                    fail();
+                                if (w == h)
+                                    bench_new(dst1, PIXEL_STRIDE, src1 + SRC_OFFSET, PIXEL_STRIDE, h, denom, wx, ox, hf, vf, w);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+    report("put_uni_w");
+}
+
+// up to 2x downscaling, the source covers twice the block size
+#define SCALED_SRC_STRIDE   ((2 * MAX_PB_SIZE + SRC_EXTRA) * 2)
+#define SCALED_SRC_BUF_SIZE (SCALED_SRC_STRIDE * (2 * MAX_PB_SIZE + SRC_EXTRA))
+#define SCALED_SRC_OFFSET   ((SCALED_SRC_STRIDE + EXTRA_BEFORE * 2) * EXTRA_BEFORE)
+
+static void check_put_vvc_scaled(void)
+{
+    LOCAL_ALIGNED_32(uint8_t, dst0, [DST_BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [DST_BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, src0, [SCALED_SRC_BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, src1, [SCALED_SRC_BUF_SIZE]);
+    VVCDSPContext c;
+
+    for (int bit_depth = 8; bit_depth <= 12; bit_depth += 2) {
+        ff_vvc_dsp_init(&c, bit_depth);
+        randomize_pixels(src0, src1, SCALED_SRC_BUF_SIZE);
+        for (int chroma = 0; chroma < 2; chroma++) {
+            const char *comp = chroma ? "chroma" : "luma";
+
+            for (int h = 4 >> chroma; h <= MAX_CTU_SIZE; h *= 2) {
+                for (int w = 4 >> chroma; w <= MAX_CTU_SIZE; w *= 2) {
+                    const int idx        = av_log2(w) - 1;
+                    const int x          = rnd() & 0xfff;
+                    const int y          = rnd() & 0xfff;
+                    const int dx         = 512 + rnd() % 1537;
+                    const int dy         = 512 + rnd() % 1537;
+                    const int y_end      = SCALED_INT(y + h * dy);
+                    const int y_last     = SCALED_INT(y + (h - 1) * dy);
+                    const int src_height = y_end - SCALED_INT(y) + (y_end == y_last);
+                    const int8_t *hf     = chroma ? ff_vvc_inter_chroma_filters[rnd() % VVC_INTER_CHROMA_FILTER_TYPES][0] :
+                                                    ff_vvc_inter_luma_filters[rnd() % VVC_INTER_LUMA_FILTER_TYPES][0];
+                    const int8_t *vf     = chroma ? ff_vvc_inter_chroma_filters[rnd() % VVC_INTER_CHROMA_FILTER_TYPES][0] :
+                                                    ff_vvc_inter_luma_filters[rnd() % VVC_INTER_LUMA_FILTER_TYPES][0];
+                    {
+                        declare_func(void, int16_t *dst, const uint8_t *src, ptrdiff_t src_stride, int src_height,
+                            int x, int y, int dx, int dy, int height, const int8_t *hf, const int8_t *vf, int width);
+
+                        if (check_func(c.inter.put_scaled[chroma][idx], "put_%s_scaled_%d_%dx%d", comp, bit_depth, w, h)) {
+                            memset(dst0, 0, DST_BUF_SIZE);
+                            memset(dst1, 0, DST_BUF_SIZE);
+                            call_ref((int16_t *)dst0, src0 + SCALED_SRC_OFFSET, SCALED_SRC_STRIDE, src_height, x, y, dx, dy, h, hf, vf, w);
+                            call_new((int16_t *)dst1, src1 + SCALED_SRC_OFFSET, SCALED_SRC_STRIDE, src_height, x, y, dx, dy, h, hf, vf, w);
+                            if (memcmp(dst0, dst1, DST_BUF_SIZE))
+                                fail();
+                            if (w == h)
+                                bench_new((int16_t *)dst1, src1 + SCALED_SRC_OFFSET, SCALED_SRC_STRIDE, src_height, x, y, dx, dy, h, hf, vf, w);
+                        }
+                    }
+                    {
+                        declare_func(void, uint8_t *dst, ptrdiff_t dst_stride, const uint8_t *src, ptrdiff_t src_stride,
+                            int src_height, int x, int y, int dx, int dy, int height, const int8_t *hf, const int8_t *vf, int width);
+
+                        if (check_func(c.inter.put_uni_scaled[chroma][idx], "put_uni_%s_scaled_%d_%dx%d", comp, bit_depth, w, h)) {
+                            memset(dst0, 0, DST_BUF_SIZE);
+                            memset(dst1, 0, DST_BUF_SIZE);
+                            call_ref(dst0, PIXEL_STRIDE, src0 + SCALED_SRC_OFFSET, SCALED_SRC_STRIDE, src_height, x, y, dx, dy, h, hf, vf, w);
+                            call_new(dst1, PIXEL_STRIDE, src1 + SCALED_SRC_OFFSET, SCALED_SRC_STRIDE, src_height, x, y, dx, dy, h, hf, vf, w);
+                            if (memcmp(dst0, dst1, DST_BUF_SIZE))
+                                fail();
+                            if (w == h)
+                                bench_new(dst1, PIXEL_STRIDE, src1 + SCALED_SRC_OFFSET, SCALED_SRC_STRIDE, src_height, x, y, dx, dy, h, hf, vf, w);
+                        }
+                    }
+                    {
+                        const int denom = rnd() % 8;
+                        const int wx    = rnd() % 256 - 128;
+                        const int ox    = rnd() % 256 - 128;
+                        declare_func(void, uint8_t *dst, ptrdiff_t dst_stride, const uint8_t *src, ptrdiff_t src_stride,
+                            int src_height, int x, int y, int dx, int dy, int height, int denom, int wx, int ox,
+                            const int8_t *hf, const int8_t *vf, int width);
+
+                        if (check_func(c.inter.put_uni_w_scaled[chroma][idx], "put_uni_w_%s_scaled_%d_%dx%d", comp, bit_depth, w, h)) {
+                            memset(dst0, 0, DST_BUF_SIZE);
+                            memset(dst1, 0, DST_BUF_SIZE);
+                            call_ref(dst0, PIXEL_STRIDE, src0 + SCALED_SRC_OFFSET, SCALED_SRC_STRIDE, src_height,
+                                x, y, dx, dy, h, denom, wx, ox, hf, vf, w);
+                            call_new(dst1, PIXEL_STRIDE, src1 + SCALED_SRC_OFFSET, SCALED_SRC_STRIDE, src_height,
+                                x, y, dx, dy, h, denom, wx, ox, hf, vf, w);
+                            if (memcmp(dst0, dst1, DST_BUF_SIZE))
+                                fail();
+                            if (w == h)
+                                bench_new(dst1, PIXEL_STRIDE, src1 + SCALED_SRC_OFFSET, SCALED_SRC_STRIDE, src_height,
+                                    x, y, dx, dy, h, denom, wx, ox, hf, vf, w);
+                        }
+                    }
+                }
+            }
+        }
+    }
+    report("put_scaled");
+}
+
 #define AVG_SRC_BUF_SIZE (MAX_CTU_SIZE * MAX_CTU_SIZE)
 #define AVG_DST_BUF_SIZE (MAX_PB_SIZE * MAX_PB_SIZE * 2)
 
@@ -324,6 +527,41 @@ static void check_avg(void)
     report("avg");
 }
 
+static void check_avg_pixels(void)
+{
+    LOCAL_ALIGNED_32(uint8_t, src00, [SRC_BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, src01, [SRC_BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, src10, [SRC_BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, src11, [SRC_BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, dst0, [DST_BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [DST_BUF_SIZE]);
+    VVCDSPContext c;
+
+    declare_func(void, uint8_t *dst, ptrdiff_t dst_stride, const uint8_t *src0, ptrdiff_t src0_stride,
+        const uint8_t *src1, ptrdiff_t src1_stride, int width, int height);
+
+    for (int bit_depth = 8; bit_depth <= 12; bit_depth += 2) {
+        randomize_pixels(src00, src10, SRC_BUF_SIZE);
+        randomize_pixels(src01, src11, SRC_BUF_SIZE);
+        ff_vvc_dsp_init(&c, bit_depth);
+        for (int h = 2; h <= MAX_CTU_SIZE; h *= 2) {
+            for (int w = 2; w <= MAX_CTU_SIZE; w *= 2) {
+                if (check_func(c.inter.avg_pixels, "avg_pixels_%d_%dx%d", bit_depth, w, h)) {
+                    memset(dst0, 0, DST_BUF_SIZE);
+                    memset(dst1, 0, DST_BUF_SIZE);
+                    call_ref(dst0, PIXEL_STRIDE, src00 + SRC_OFFSET, PIXEL_STRIDE, src01 + SRC_OFFSET, PIXEL_STRIDE, w, h);
+                    call_new(dst1, PIXEL_STRIDE, src10 + SRC_OFFSET, PIXEL_STRIDE, src11 + SRC_OFFSET, PIXEL_STRIDE, w, h);
+                    if (memcmp(dst0, dst1, DST_BUF_SIZE))
+                        fail();
+                    if (w == h)
+                        bench_new(dst1, PIXEL_STRIDE, src10 + SRC_OFFSET, PIXEL_STRIDE, src11 + SRC_OFFSET, PIXEL_STRIDE, w, h);
+                }
+            }
+        }
+    }
+    report("avg_pixels");
+}
+
 static void check_vvc_sad(void)
 {
     const int bit_depth = 10;
@@ -361,12 +599,413 @@ static void check_vvc_sad(void)
     report("sad");
 }
 
+static void check_vvc_sad_5x5(void)
+{
+    const int bit_depth = 10;
+    VVCDSPContext c;
+    LOCAL_ALIGNED_32(uint16_t, src0, [MAX_CTU_SIZE * MAX_CTU_SIZE * 4]);
+    LOCAL_ALIGNED_32(uint16_t, src1, [MAX_CTU_SIZE * MAX_CTU_SIZE * 4]);
+    int sad0[5 * 5], sad1[5 * 5];
+    declare_func(void, int *sad, const int16_t *src0, const int16_t *src1, int block_w, int block_h);
+
+    ff_vvc_dsp_init(&c, bit_depth);
+    randomize_pixels(src0, src1, MAX_CTU_SIZE * MAX_CTU_SIZE * 4);
+    for (int h = 8; h <= 16; h *= 2) {
+        for (int w = 8; w <= 16; w *= 2) {
+            if (w * h < 128)
+                continue;
+
+            if (check_func(c.inter.sad_5x5, "sad_5x5_%dx%d", w, h)) {
+                call_ref(sad0, src0 + PIXEL_STRIDE * 2 + 2, src1 + PIXEL_STRIDE * 2 + 2, w, h);
+                call_new(sad1, src0 + PIXEL_STRIDE * 2 + 2, src1 + PIXEL_STRIDE * 2 + 2, w, h);
+                if (memcmp(sad0, sad1, sizeof(sad0)))
+                    fail();
+                bench_new(sad1, src0 + PIXEL_STRIDE * 2 + 2, src1 + PIXEL_STRIDE * 2 + 2, w, h);
+            }
+        }
+    }
+
+    report("sad_5x5");
+}
+
+static void check_vvc_dmvr(void)
+{
+    LOCAL_ALIGNED_32(int16_t, dst0, [DST_BUF_SIZE / 2]);
+    LOCAL_ALIGNED_32(int16_t, dst1, [DST_BUF_SIZE / 2]);
+    LOCAL_ALIGNED_32(uint8_t, src0, [SRC_BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, src1, [SRC_BUF_SIZE]);
+    static const char *const type[2][2] = { { "", "_h" }, { "_v", "_hv" } };
+    VVCDSPContext c;
+
+    declare_func(void, int16_t *dst, const uint8_t *src, ptrdiff_t src_stride, int height,
+        intptr_t mx, intptr_t my, int width);
+
+    for (int bit_depth = 8; bit_depth <= 12; bit_depth += 2) {
+        const ptrdiff_t src_stride = PIXEL_STRIDE * SIZEOF_PIXEL;
+
+        randomize_pixels(src0, src1, SRC_BUF_SIZE);
+        ff_vvc_dsp_init(&c, bit_depth);
+        for (int v = 0; v < 2; v++) {
+            for (int h = 0; h < 2; h++) {
+                // the 8x16, 16x8 and 16x16 sub-blocks and the 2 samples of search range around them
+                for (int bh = 8; bh <= 16; bh *= 2) {
+                    for (int bw = 8; bw <= 16; bw *= 2) {
+                        const int width  = bw + 4;
+                        const int height = bh + 4;
+                        const int mx     = h ? 1 + rnd() % 15 : 0;
+                        const int my     = v ? 1 + rnd() % 15 : 0;
+
+                        if (bw * bh < 128)
+                            continue;
+                        if (check_func(c.inter.dmvr[v][h], "dmvr%s_%dx%d_%d", type[v][h], width, height, bit_depth)) {
+                            memset(dst0, 0, DST_BUF_SIZE);
+                            memset(dst1, 0, DST_BUF_SIZE);
+                            call_ref(dst0, src0 + SRC_OFFSET, src_stride, height, mx, my, width);
+                            call_new(dst1, src1 + SRC_OFFSET, src_stride, height, mx, my, width);
+                            for (int y = 0; y < height; y++) {
+                                if (memcmp(dst0 + y * MAX_PB_SIZE, dst1 + y * MAX_PB_SIZE, width * sizeof(int16_t)))
+                                    fail();
+                            }
+                            if (bw == 16 && bh == 16)
+                                bench_new(dst1, src1 + SRC_OFFSET, src_stride, height, mx, my, width);
+                        }
+                    }
+                }
+            }
+        }
+    }
+    report("dmvr");
+}
+
+#define BDOF_OFFSET (MAX_PB_SIZE + 32)
+
+static void check_vvc_bdof(void)
+{
+    LOCAL_ALIGNED_32(uint8_t, dst0, [DST_BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [DST_BUF_SIZE]);
+    LOCAL_ALIGNED_32(int16_t, src00, [DST_BUF_SIZE / 2]);
+    LOCAL_ALIGNED_32(int16_t, src01, [DST_BUF_SIZE / 2]);
+    LOCAL_ALIGNED_32(int16_t, src10, [DST_BUF_SIZE / 2]);
+    LOCAL_ALIGNED_32(int16_t, src11, [DST_BUF_SIZE / 2]);
+    VVCDSPContext c;
+
+    declare_func(void, uint8_t *dst, ptrdiff_t dst_stride, int16_t *src0, int16_t *src1,
+        int block_w, int block_h);
+
+    for (int bit_depth = 8; bit_depth <= 12; bit_depth += 2) {
+        const ptrdiff_t dst_stride = MAX_PB_SIZE * SIZEOF_PIXEL;
+
+        ff_vvc_dsp_init(&c, bit_depth);
+        for (int bh = 8; bh <= 16; bh *= 2) {
+            for (int bw = 8; bw <= 16; bw *= 2) {
+                if (bw * bh < 128)
+                    continue;
+                if (check_func(c.inter.apply_bdof, "apply_bdof_%dx%d_%d", bw, bh, bit_depth)) {
+                    // the reference pads the borders of the sources in place, so each side has its own copy
+                    randomize_avg_src(src00, src01, DST_BUF_SIZE / 2);
+                    randomize_avg_src(src10, src11, DST_BUF_SIZE / 2);
+                    memset(dst0, 0, DST_BUF_SIZE);
+                    memset(dst1, 0, DST_BUF_SIZE);
+                    call_ref(dst0, dst_stride, src00 + BDOF_OFFSET, src10 + BDOF_OFFSET, bw, bh);
+                    call_new(dst1, dst_stride, src01 + BDOF_OFFSET, src11 + BDOF_OFFSET, bw, bh);
+                    if (memcmp(dst0, dst1, DST_BUF_SIZE))
+                        fail();
+                    if (bw == 16 && bh == 16)
+                        bench_new(dst1, dst_stride, src01 + BDOF_OFFSET, src11 + BDOF_OFFSET, bw, bh);
+                }
+            }
+        }
+    }
+    report("apply_bdof");
+}
+
+static void check_vvc_bdof_fetch_samples(void)
+{
+    LOCAL_ALIGNED_32(int16_t, dst0, [DST_BUF_SIZE / 2]);
+    LOCAL_ALIGNED_32(int16_t, dst1, [DST_BUF_SIZE / 2]);
+    LOCAL_ALIGNED_32(uint8_t, src0, [SRC_BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, src1, [SRC_BUF_SIZE]);
+    VVCDSPContext c;
+
+    declare_func(void, int16_t *dst, const uint8_t *src, ptrdiff_t src_stride,
+        int x_frac, int y_frac, int width, int height);
+
+    for (int bit_depth = 8; bit_depth <= 12; bit_depth += 2) {
+        const ptrdiff_t src_stride = PIXEL_STRIDE * SIZEOF_PIXEL;
+
+        randomize_pixels(src0, src1, SRC_BUF_SIZE);
+        ff_vvc_dsp_init(&c, bit_depth);
+        for (int h = 8; h <= 16; h *= 2) {
+            for (int w = 8; w <= 16; w *= 2) {
+                const int x_frac = rnd() & 15;
+                const int y_frac = rnd() & 15;
+
+                if (w * h < 128)
+                    continue;
+                if (check_func(c.inter.bdof_fetch_samples, "bdof_fetch_samples_%dx%d_%d", w, h, bit_depth)) {
+                    memset(dst0, 0, DST_BUF_SIZE);
+                    memset(dst1, 0, DST_BUF_SIZE);
+                    call_ref(dst0 + BDOF_OFFSET, src0 + SRC_OFFSET, src_stride, x_frac, y_frac, w, h);
+                    call_new(dst1 + BDOF_OFFSET, src1 + SRC_OFFSET, src_stride, x_frac, y_frac, w, h);
+                    if (memcmp(dst0, dst1, DST_BUF_SIZE))
+                        fail();
+                    if (w == 16 && h == 16)
+                        bench_new(dst1 + BDOF_OFFSET, src1 + SRC_OFFSET, src_stride, x_frac, y_frac, w, h);
+                }
+            }
+        }
+    }
+    report("bdof_fetch_samples");
+}
+
+static void check_vvc_fetch_samples(void)
+{
+    LOCAL_ALIGNED_32(int16_t, dst0, [DST_BUF_SIZE / 2]);
+    LOCAL_ALIGNED_32(int16_t, dst1, [DST_BUF_SIZE / 2]);
+    LOCAL_ALIGNED_32(uint8_t, src0, [SRC_BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, src1, [SRC_BUF_SIZE]);
+    VVCDSPContext c;
+
+    declare_func(void, int16_t *dst, const uint8_t *src, ptrdiff_t src_stride, int x_frac, int y_frac);
+
+    for (int bit_depth = 8; bit_depth <= 12; bit_depth += 2) {
+        const ptrdiff_t src_stride = PIXEL_STRIDE * SIZEOF_PIXEL;
+        const int x_frac = rnd() & 15;
+        const int y_frac = rnd() & 15;
+
+        randomize_pixels(src0, src1, SRC_BUF_SIZE);
+        ff_vvc_dsp_init(&c, bit_depth);
+        if (check_func(c.inter.fetch_samples, "fetch_samples_%d", bit_depth)) {
+            memset(dst0, 0, DST_BUF_SIZE);
+            memset(dst1, 0, DST_BUF_SIZE);
+            call_ref(dst0 + BDOF_OFFSET, src0 + SRC_OFFSET, src_stride, x_frac, y_frac);
+            call_new(dst1 + BDOF_OFFSET, src1 + SRC_OFFSET, src_stride, x_frac, y_frac);
+            if (memcmp(dst0, dst1, DST_BUF_SIZE))
+                fail();
+            bench_new(dst1 + BDOF_OFFSET, src1 + SRC_OFFSET, src_stride, x_frac, y_frac);
+        }
+    }
+    report("fetch_samples");
+}
+
+#define GRAD_STRIDE (16 + 2)
+
+static void check_vvc_prof_grad_filter(void)
+{
+    LOCAL_ALIGNED_32(int16_t, src, [DST_BUF_SIZE / 2]);
+    LOCAL_ALIGNED_32(int16_t, unused, [DST_BUF_SIZE / 2]);
+    int16_t grad_h0[GRAD_STRIDE * GRAD_STRIDE], grad_v0[GRAD_STRIDE * GRAD_STRIDE];
+    int16_t grad_h1[GRAD_STRIDE * GRAD_STRIDE], grad_v1[GRAD_STRIDE * GRAD_STRIDE];
+    VVCDSPContext c;
+
+    declare_func(void, int16_t *gradient_h, int16_t *gradient_v, ptrdiff_t gradient_stride,
+        const int16_t *src, ptrdiff_t src_stride, int width, int height, int pad);
+
+    for (int bit_depth = 8; bit_depth <= 12; bit_depth += 2) {
+        randomize_avg_src(src, unused, DST_BUF_SIZE / 2);
+        ff_vvc_dsp_init(&c, bit_depth);
+        // the 4x4 PROF subblock without and the BDOF blocks with their padding
+        for (int h = 4; h <= 16; h *= 2) {
+            for (int w = 4; w <= 16; w *= 2) {
+                const int pad = w != 4 || h != 4;
+                const ptrdiff_t gradient_stride = pad ? GRAD_STRIDE : AFFINE_MIN_BLOCK_SIZE;
+
+                if (pad && w * h < 128)
+                    continue;
+                if (check_func(c.inter.prof_grad_filter, "prof_grad_filter_%dx%d_%d", w, h, bit_depth)) {
+                    memset(grad_h0, 0, sizeof(grad_h0));
+                    memset(grad_v0, 0, sizeof(grad_v0));
+                    memset(grad_h1, 0, sizeof(grad_h1));
+                    memset(grad_v1, 0, sizeof(grad_v1));
+                    call_ref(grad_h0, grad_v0, gradient_stride, src + BDOF_OFFSET, MAX_PB_SIZE, w, h, pad);
+                    call_new(grad_h1, grad_v1, gradient_stride, src + BDOF_OFFSET, MAX_PB_SIZE, w, h, pad);
+                    if (memcmp(grad_h0, grad_h1, sizeof(grad_h0)) || memcmp(grad_v0, grad_v1, sizeof(grad_v0)))
+                        fail();
+                    if (w == h)
+                        bench_new(grad_h1, grad_v1, gradient_stride, src + BDOF_OFFSET, MAX_PB_SIZE, w, h, pad);
+                }
+            }
+        }
+    }
+    report("prof_grad_filter");
+}
+
+static void check_vvc_ciip(void)
+{
+    LOCAL_ALIGNED_32(uint8_t, dst0, [DST_BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [DST_BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, inter0, [DST_BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, inter1, [DST_BUF_SIZE]);
+    VVCDSPContext c;
+
+    declare_func(void, uint8_t *dst, ptrdiff_t dst_stride, int width, int height,
+        const uint8_t *inter, ptrdiff_t inter_stride, int intra_weight);
+
+    for (int bit_depth = 8; bit_depth <= 12; bit_depth += 2) {
+        const ptrdiff_t stride = MAX_PB_SIZE * SIZEOF_PIXEL;
+
+        ff_vvc_dsp_init(&c, bit_depth);
+        for (int h = 4; h <= 64; h *= 2) {
+            for (int w = 4; w <= 64; w *= 2) {
+                const int intra_weight = 1 + rnd() % 3;
+
+                if (check_func(c.inter.put_ciip, "put_ciip_%d_%dx%d", bit_depth, w, h)) {
+                    randomize_pixels(dst0, dst1, DST_BUF_SIZE);
+                    randomize_pixels(inter0, inter1, DST_BUF_SIZE);
+                    call_ref(dst0, stride, w, h, inter0, stride, intra_weight);
+                    call_new(dst1, stride, w, h, inter1, stride, intra_weight);
+                    if (memcmp(dst0, dst1, DST_BUF_SIZE))
+                        fail();
+                    if (w == h)
+                        bench_new(dst1, stride, w, h, inter1, stride, intra_weight);
+                }
+            }
+        }
+    }
+    report("put_ciip");
+}
+
+static void check_vvc_gpm(void)
+{
+    LOCAL_ALIGNED_32(uint8_t, dst0, [DST_BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [DST_BUF_SIZE]);
+    LOCAL_ALIGNED_32(int16_t, src0, [DST_BUF_SIZE / 2]);
+    LOCAL_ALIGNED_32(int16_t, src1, [DST_BUF_SIZE / 2]);
+    VVCDSPContext c;
+
+    declare_func(void, uint8_t *dst, ptrdiff_t dst_stride, int width, int height,
+        const int16_t *src0, const int16_t *src1, const uint8_t *weights, int step_x, int step_y);
+
+    for (int bit_depth = 8; bit_depth <= 12; bit_depth += 2) {
+        const ptrdiff_t dst_stride = MAX_PB_SIZE * SIZEOF_PIXEL;
+
+        ff_vvc_dsp_init(&c, bit_depth);
+        randomize_avg_src(src0, src1, DST_BUF_SIZE / 2);
+        // luma and subsampled chroma, each with the three mirror types of pred_gpm_blk()
+        for (int shift = 0; shift <= 1; shift++) {
+            for (int h = 8 >> shift; h <= 64 >> shift; h *= 2) {
+                for (int w = 8 >> shift; w <= 64 >> shift; w *= 2) {
+                    const int mirror  = rnd() % 3;
+                    const int off_x   = rnd() % (VVC_GPM_WEIGHT_SIZE - (w << shift) + 1);
+                    const int off_y   = rnd() % (VVC_GPM_WEIGHT_SIZE - (h << shift) + 1);
+                    const uint8_t *weights = ff_vvc_gpm_weights[rnd() % 6];
+                    int step_x = 1 << shift;
+                    int step_y = VVC_GPM_WEIGHT_SIZE << shift;
+
+                    if (!mirror) {
+                        weights += off_y * VVC_GPM_WEIGHT_SIZE + off_x;
+                    } else if (mirror == 1) {
+                        step_x   = -step_x;
+                        weights += off_y * VVC_GPM_WEIGHT_SIZE + VVC_GPM_WEIGHT_SIZE - 1 - off_x;
+                    } else {
+                        step_y   = -step_y;
+                        weights += (VVC_GPM_WEIGHT_SIZE - 1 - off_y) * VVC_GPM_WEIGHT_SIZE + off_x;
+                    }
+                    if (check_func(c.inter.put_gpm, "put_gpm_%d_%dx%d", bit_depth, w, h)) {
+                        memset(dst0, 0, DST_BUF_SIZE);
+                        memset(dst1, 0, DST_BUF_SIZE);
+                        call_ref(dst0, dst_stride, w, h, src0, src1, weights, step_x, step_y);
+                        call_new(dst1, dst_stride, w, h, src0, src1, weights, step_x, step_y);
+                        if (memcmp(dst0, dst1, DST_BUF_SIZE))
+                            fail();
+                        if (w == h && !shift)
+                            bench_new(dst1, dst_stride, w, h, src0, src1, weights, step_x, step_y);
+                    }
+                }
+            }
+        }
+    }
+    report("put_gpm");
+}
+
+static void randomize_diff_mv(int16_t *diff_mv_x, int16_t *diff_mv_y)
+{
+    for (int i = 0; i < AFFINE_MIN_BLOCK_SIZE * AFFINE_MIN_BLOCK_SIZE; i++) {
+        diff_mv_x[i] = (int)(rnd() % 63) - 31;
+        diff_mv_y[i] = (int)(rnd() % 63) - 31;
+    }
+}
+
+static void check_vvc_prof(void)
+{
+    LOCAL_ALIGNED_32(uint8_t, dst0, [DST_BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [DST_BUF_SIZE]);
+    LOCAL_ALIGNED_32(int16_t, src0, [DST_BUF_SIZE / 2]);
+    LOCAL_ALIGNED_32(int16_t, src1, [DST_BUF_SIZE / 2]);
+    int16_t diff_mv_x[AFFINE_MIN_BLOCK_SIZE * AFFINE_MIN_BLOCK_SIZE];
+    int16_t diff_mv_y[AFFINE_MIN_BLOCK_SIZE * AFFINE_MIN_BLOCK_SIZE];
+    VVCDSPContext c;
+
+    for (int bit_depth = 8; bit_depth <= 12; bit_depth += 2) {
+        const ptrdiff_t dst_stride = MAX_PB_SIZE * SIZEOF_PIXEL;
+
+        ff_vvc_dsp_init(&c, bit_depth);
+        randomize_avg_src(src0, src1, DST_BUF_SIZE / 2);
+        randomize_diff_mv(diff_mv_x, diff_mv_y);
+
+        if (check_func(c.inter.apply_prof, "apply_prof_%d", bit_depth)) {
+            declare_func(void, int16_t *dst, const int16_t *src, const int16_t *diff_mv_x, const int16_t *diff_mv_y);
+
+            memset(dst0, 0, DST_BUF_SIZE);
+            memset(dst1, 0, DST_BUF_SIZE);
+            call_ref((int16_t *)dst0, src0 + BDOF_OFFSET, diff_mv_x, diff_mv_y);
+            call_new((int16_t *)dst1, src1 + BDOF_OFFSET, diff_mv_x, diff_mv_y);
+            if (memcmp(dst0, dst1, DST_BUF_SIZE))
+                fail();
+            bench_new((int16_t *)dst1, src1 + BDOF_OFFSET, diff_mv_x, diff_mv_y);
+        }
+
+        if (check_func(c.inter.apply_prof_uni, "apply_prof_uni_%d", bit_depth)) {
+            declare_func(void, uint8_t *dst, ptrdiff_t dst_stride, const int16_t *src,
+                const int16_t *diff_mv_x, const int16_t *diff_mv_y);
+
+            memset(dst0, 0, DST_BUF_SIZE);
+            memset(dst1, 0, DST_BUF_SIZE);
+            call_ref(dst0, dst_stride, src0 + BDOF_OFFSET, diff_mv_x, diff_mv_y);
+            call_new(dst1, dst_stride, src1 + BDOF_OFFSET, diff_mv_x, diff_mv_y);
+            if (memcmp(dst0, dst1, DST_BUF_SIZE))
+                fail();
+            bench_new(dst1, dst_stride, src1 + BDOF_OFFSET, diff_mv_x, diff_mv_y);
+        }
+
+        if (check_func(c.inter.apply_prof_uni_w, "apply_prof_uni_w_%d", bit_depth)) {
+            declare_func(void, uint8_t *dst, ptrdiff_t dst_stride, const int16_t *src,
+                const int16_t *diff_mv_x, const int16_t *diff_mv_y, int denom, int wx, int ox);
+            const int denom = rnd() % 8;
+            const int wx    = (int)(rnd() % 256) - 128;
+            const int ox    = (int)(rnd() % 256) - 128;
+
+            memset(dst0, 0, DST_BUF_SIZE);
+            memset(dst1, 0, DST_BUF_SIZE);
+            call_ref(dst0, dst_stride, src0 + BDOF_OFFSET, diff_mv_x, diff_mv_y, denom, wx, ox);
+            call_new(dst1, dst_stride, src1 + BDOF_OFFSET, diff_mv_x, diff_mv_y, denom, wx, ox);
+            if (memcmp(dst0, dst1, DST_BUF_SIZE))
+                fail();
+            bench_new(dst1, dst_stride, src1 + BDOF_OFFSET, diff_mv_x, diff_mv_y, denom, wx, ox);
+        }
+    }
+    report("prof");
+}
+
 void checkasm_check_vvc_mc(void)
 {
     check_vvc_sad();
+    check_vvc_sad_5x5();
+    check_vvc_dmvr();
+    check_vvc_bdof();
+    check_vvc_bdof_fetch_samples();
+    check_vvc_fetch_samples();
+    check_vvc_prof_grad_filter();
+    check_vvc_prof();
+    check_vvc_ciip();
+    check_vvc_gpm();
     check_put_vvc_luma();
     check_put_vvc_luma_uni();
     check_put_vvc_chroma();
     check_put_vvc_chroma_uni();
+    check_put_vvc_bi();
+    check_put_vvc_uni_w();
+    check_put_vvc_scaled();
     check_avg();
+    check_avg_pixels();
 }
@@ -48,6 +48,96 @@ FATE_VVC-$(call FRAMECRC, VVC, VVC, VVC_PARSER SCALE_FILTER) +=            \
                                                     $(VVC_TESTS_10BIT)     \
                                                     $(VVC_TESTS_444_10BIT) \
 
+# the packets of the mapped file are padded with the next picture unit instead of zeros
+VVC_SAMPLES_MMAP = PHSH_B_1 SLICES_A_3 WPP_A_3
+VVC_TESTS_MMAP := $(addprefix fate-vvc-mmap-, $(VVC_SAMPLES_MMAP))
+fate-vvc-mmap-%: CMD = framecrc -c:v vvc -strict experimental -mmap 1 -i $(TARGET_SAMPLES)/vvc-conformance/$(subst fate-vvc-mmap-,,$(@)).bit -pix_fmt yuv420p10le -vf scale
+fate-vvc-mmap-%: REF = $(SRC_PATH)/tests/ref/fate/vvc-conformance-$(subst fate-vvc-mmap-,,$(@))
+FATE_VVC-$(call FRAMECRC, VVC, VVC, VVC_PARSER SCALE_FILTER) += $(VVC_TESTS_MMAP)
+
+# the guard bands of the references do not change the output
+VVC_SAMPLES_PAD_REFS = RPR_A_4 WP_A_3 WRAP_A_4
+VVC_TESTS_PAD_REFS := $(addprefix fate-vvc-pad-refs-, $(VVC_SAMPLES_PAD_REFS))
+fate-vvc-pad-refs-%: CMD = framecrc -c:v vvc -strict experimental -pad_refs 1 -i $(TARGET_SAMPLES)/vvc-conformance/$(subst fate-vvc-pad-refs-,,$(@)).bit -pix_fmt yuv420p10le -vf scale
+fate-vvc-pad-refs-%: REF = $(SRC_PATH)/tests/ref/fate/vvc-conformance-$(subst fate-vvc-pad-refs-,,$(@))
+FATE_VVC-$(call FRAMECRC, VVC, VVC, VVC_PARSER SCALE_FILTER) += $(VVC_TESTS_PAD_REFS)
+
+# the rescaled copies of the references give the same prediction
+fate-vvc-rpr-cache: CMD = framecrc -c:v vvc -strict experimental -rpr_cache 1 -i $(TARGET_SAMPLES)/vvc-conformance/RPR_A_4.bit -pix_fmt yuv420p10le -vf scale
+fate-vvc-rpr-cache: REF = $(SRC_PATH)/tests/ref/fate/vvc-conformance-RPR_A_4
+FATE_VVC-$(call FRAMECRC, VVC, VVC, VVC_PARSER SCALE_FILTER) += fate-vvc-rpr-cache
+
+# the interleaved chroma is converted back to the planar layout losslessly
+VVC_SAMPLES_SEMI_PLANAR_8BIT = CodingToolsSets_A_2
+VVC_SAMPLES_SEMI_PLANAR_10BIT = SLICES_A_3 WPP_A_3
+VVC_SAMPLES_SEMI_PLANAR_444_10BIT = CROP_B_4
+$(foreach VAR,$(FATE_VVC_VARS), $(eval VVC_TESTS_SEMI_PLANAR_$(VAR) := $(addprefix fate-vvc-semi-planar-, $(VVC_SAMPLES_SEMI_PLANAR_$(VAR)))))
+$(VVC_TESTS_SEMI_PLANAR_8BIT): SCALE_OPTS := -pix_fmt yuv420p -vf scale
+$(VVC_TESTS_SEMI_PLANAR_10BIT): SCALE_OPTS := -pix_fmt yuv420p10le -vf scale
+$(VVC_TESTS_SEMI_PLANAR_444_10BIT): SCALE_OPTS := -pix_fmt yuv444p10le -vf scale
+fate-vvc-semi-planar-%: CMD = framecrc -c:v vvc -strict experimental -semi_planar 1 -i $(TARGET_SAMPLES)/vvc-conformance/$(subst fate-vvc-semi-planar-,,$(@)).bit $(SCALE_OPTS)
+fate-vvc-semi-planar-%: REF = $(SRC_PATH)/tests/ref/fate/vvc-conformance-$(subst fate-vvc-semi-planar-,,$(@))
+FATE_VVC-$(call FRAMECRC, VVC, VVC, VVC_PARSER SCALE_FILTER) += $(VVC_TESTS_SEMI_PLANAR_8BIT)     \
+                                                             $(VVC_TESTS_SEMI_PLANAR_10BIT)    \
+                                                             $(VVC_TESTS_SEMI_PLANAR_444_10BIT)
+
+# the slice data of the first and fourth slices starts with 0xff 0xc0, an ivlOffset
+# of 511 the cabac decoder can not start from, their ctus are concealed
+fate-vvc-cabac-invalid-offset: CMD = framecrc -c:v vvc -strict experimental -conceal 1 -i $(TARGET_SAMPLES)/vvc/cabac_ivl_offset_511.266
+FATE_VVC-$(call FRAMECRC, VVC, VVC, VVC_PARSER) += fate-vvc-cabac-invalid-offset
+
+# the concealed ctus do not depend on the order the threads decode the frames in
+VVC_CONCEAL_THREADS = 1 4
+VVC_TESTS_CONCEAL := $(addprefix fate-vvc-conceal-threads-, $(VVC_CONCEAL_THREADS))
+fate-vvc-conceal-threads-%: CMD = framecrc -c:v vvc -strict experimental -conceal 1 -i $(TARGET_SAMPLES)/vvc/cabac_ivl_offset_511.266
+fate-vvc-conceal-threads-%: override THREADS = $(subst fate-vvc-conceal-threads-,,$(@))
+fate-vvc-conceal-threads-%: REF = $(SRC_PATH)/tests/ref/fate/vvc-cabac-invalid-offset
+FATE_VVC-$(call FRAMECRC, VVC, VVC, VVC_PARSER) += $(VVC_TESTS_CONCEAL)
+
+# four tiles of one ctu column each, parsed in parallel, the luma qp of a cu
+# is predicted from its neighbours, the output does not depend on the thread count
+VVC_TILES_THREADS = 1 4
+VVC_TESTS_TILES := $(addprefix fate-vvc-tiles-threads-, $(VVC_TILES_THREADS))
+fate-vvc-tiles-threads-%: CMD = framecrc -c:v vvc -strict experimental -i $(TARGET_SAMPLES)/vvc/tiles_4x1.266
+fate-vvc-tiles-threads-%: override THREADS = $(subst fate-vvc-tiles-threads-,,$(@))
+fate-vvc-tiles-threads-%: REF = $(SRC_PATH)/tests/ref/fate/vvc-tiles-4x1
+FATE_VVC-$(call FRAMECRC, VVC, VVC, VVC_PARSER) += $(VVC_TESTS_TILES)
+
+# the chroma planes are left at mid grey and the luma is decoded as usual
+fate-vvc-gray: CMD = framecrc -c:v vvc -strict experimental -flags gray -i $(TARGET_SAMPLES)/vvc/tiles_4x1.266
+FATE_VVC-$(call FRAMECRC, VVC, VVC, VVC_PARSER GRAY) += fate-vvc-gray
+
+# the output frames are the rounded mean of the 2x2 and 4x4 blocks of the full size ones
+VVC_LOWRES = 1 2
+VVC_TESTS_LOWRES := $(addprefix fate-vvc-lowres-, $(VVC_LOWRES))
+fate-vvc-lowres-%: CMD = framecrc -c:v vvc -strict experimental -lowres $(subst fate-vvc-lowres-,,$(@)) -i $(TARGET_SAMPLES)/vvc/tiles_4x1.266
+FATE_VVC-$(call FRAMECRC, VVC, VVC, VVC_PARSER) += $(VVC_TESTS_LOWRES)
+
+# four independent subpictures with the ids 10 to 13, the second and fourth are decoded
+fate-vvc-subpic-ids: CMD = framecrc -c:v vvc -strict experimental -subpic_ids 11,13 -i $(TARGET_SAMPLES)/vvc/subpics_4x1.266
+FATE_VVC-$(call FRAMECRC, VVC, VVC, VVC_PARSER) += fate-vvc-subpic-ids
+
 FATE_SAMPLES_FFMPEG += $(FATE_VVC-yes)
 
 fate-vvc: $(FATE_VVC-yes)
+
+# Decoding speed at several thread counts, one JSON line per stream and
+# thread count; not part of fate, run with make bench-vvc SAMPLES=<path>
+VVC_BENCH_SAMPLES ?= WPP_A_3 WPP_B_3 RPR_A_4 SUBPIC_A_3 LMCS_B_1 ALF_A_2 SAO_A_3 TILE_A_2
+VVC_BENCH_THREADS ?=
+
+bench-vvc: tools/decode_bench$(EXESUF)
+	$(foreach S,$(VVC_BENCH_SAMPLES),tools/decode_bench$(EXESUF) $(TARGET_SAMPLES)/vvc-conformance/$(S).bit 0 "$(VVC_BENCH_THREADS)" strict=experimental;)
+
+# Speed regression check with make bench-vvc-check, against a baseline recorded
+# on this machine with make bench-vvc-record, fails if a stream got more than
+# VVC_BENCH_TOLERANCE percent slower; not part of fate either
+VVC_BENCH_BASELINE  ?= vvc-bench-baseline.txt
+VVC_BENCH_TOLERANCE ?= 5
+VVC_BENCH_RUNS      ?= 3
+
+bench-vvc-record bench-vvc-check: tools/decode_bench$(EXESUF)
+	$(SRC_PATH)/tests/vvc-bench.sh $(if $(filter bench-vvc-record,$@),record,check) tools/decode_bench$(EXESUF) \
+		$(TARGET_SAMPLES)/vvc-conformance $(VVC_BENCH_BASELINE) $(VVC_BENCH_TOLERANCE) $(VVC_BENCH_RUNS) $(VVC_BENCH_SAMPLES)
+
+.PHONY: bench-vvc bench-vvc-record bench-vvc-check
@@ -0,0 +1,87 @@
+#!/bin/sh
+#
+# Decoding speed of VVC streams against a baseline recorded on the same machine.
+#
+# usage: vvc-bench.sh record|check <decode_bench> <samples dir> <baseline file> <tolerance %> <runs> <streams...>
+#
+# Each stream is decoded <runs> times on one thread with the deterministic option and the
+# best speed is kept. record writes the speeds to the baseline file along with a description
+# of the machine, check fails when a stream is more than <tolerance> percent slower than its
+# baseline, or when the baseline was recorded on another machine.
+
+export LC_ALL=C
+
+mode=$1
+bench=$2
+dir=$3
+baseline=$4
+tolerance=$5
+runs=$6
+shift 6
+
+machine() {
+    echo "# $(uname -sm) $(sed -n 's/^model name[[:space:]]*: //p' /proc/cpuinfo 2>/dev/null | head -n 1)"
+}
+
+threads=1
+i=1
+while [ $i -lt $runs ]; do
+    threads="$threads,1"
+    i=$((i + 1))
+done
+
+fps() {
+    "$bench" "$dir/$1.bit" 0 "$threads" strict=experimental:deterministic=1 2>/dev/null |
+        sed -n 's/.*"fps":\([0-9.]*\).*/\1/p' | sort -n | tail -n 1
+}
+
+case $mode in
+record)
+    machine > "$baseline" || exit 1
+    ;;
+check)
+    if [ ! -f "$baseline" ]; then
+        echo "No baseline in $baseline, record one first"
+        exit 1
+    fi
+    if [ "$(head -n 1 "$baseline")" != "$(machine)" ]; then
+        echo "The baseline in $baseline was recorded on another machine:"
+        head -n 1 "$baseline"
+        exit 1
+    fi
+    ;;
+*)
+    echo "Unknown mode $mode"
+    exit 1
+    ;;
+esac
+
+status=0
+for stream; do
+    speed=$(fps $stream)
+    if [ -z "$speed" ]; then
+        echo "$stream: decoding failed"
+        status=1
+        continue
+    fi
+
+    if [ $mode = record ]; then
+        echo "$stream $speed" >> "$baseline"
+        echo "$stream: $speed fps"
+        continue
+    fi
+
+    ref=$(awk -v s=$stream '$1 == s { print $2 }' "$baseline")
+    if [ -z "$ref" ]; then
+        echo "$stream: not in the baseline"
+        status=1
+        continue
+    fi
+    awk -v s=$stream -v f=$speed -v b=$ref -v t=$tolerance 'BEGIN {
+        d = 100 * (f - b) / b
+        printf "%s: %.2f fps, baseline %.2f fps, %+.1f%%%s\n", s, f, b, d, d < -t ? ", REGRESSION" : ""
+        exit d < -t
+    }' || status=1
+done
+
+exit $status
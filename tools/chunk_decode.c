@@ -0,0 +1,427 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Split a stream into chunks starting at closed GOP boundaries, decode the
+ * chunks in parallel with one decoder per worker and print one line per
+ * frame in presentation order with its chunk, timestamp and checksum.
+ *
+ * Every chunk is decoded from a flushed decoder, so the stream must not
+ * have references across the chunk boundaries, and the parameter sets must
+ * be repeated in the stream before every boundary or be in the extradata.
+ * For VVC the chunks start at IDR pictures, for other codecs at key frames.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libavutil/adler32.h"
+#include "libavutil/common.h"
+#include "libavutil/cpu.h"
+#include "libavutil/error.h"
+#include "libavutil/imgutils.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/mem.h"
+#include "libavutil/pixdesc.h"
+#include "libavutil/thread.h"
+#include "libavutil/time.h"
+
+#include "libavformat/avformat.h"
+
+#include "libavcodec/avcodec.h"
+#include "libavcodec/vvc.h"
+
+#define MAX_WORKERS 64
+
+typedef struct FrameInfo {
+    int64_t  pts;
+    uint32_t checksum;
+} FrameInfo;
+
+typedef struct Chunk {
+    AVPacket  **pkts;
+    int         nb_pkts;
+    unsigned    pkts_size;
+
+    FrameInfo  *frames;
+    int         nb_frames;
+    unsigned    frames_size;
+
+    int         done;
+    int         ret;
+} Chunk;
+
+typedef struct ChunkDecoder {
+    const AVCodecParameters *par;
+    int                 threads;
+
+    Chunk              *chunks;         ///< ring of nb_chunks entries
+    int                 nb_chunks;
+    int                 next_print;     ///< index of the next chunk to print
+    int                 next_decode;    ///< index of the next chunk to decode
+    int                 nb_queued;      ///< number of chunks submitted
+    int                 eof;
+
+    int64_t             nb_frames;
+
+    pthread_mutex_t     lock;
+    pthread_cond_t      cond;
+} ChunkDecoder;
+
+/**
+ * Check whether no picture before pkt in decode order is referenced by a
+ * picture from pkt on.
+ */
+static int starts_closed_gop(const AVCodecParameters *par, const AVPacket *pkt)
+{
+    const uint8_t *p = pkt->data, *end = pkt->data + pkt->size;
+    int length_size = 0;
+
+    if (!(pkt->flags & AV_PKT_FLAG_KEY))
+        return 0;
+    if (par->codec_id != AV_CODEC_ID_VVC)
+        return 1;
+
+    // the sizes are prefixed when the extradata is a VvcDecoderConfigurationRecord
+    if (par->extradata_size > 3 && AV_RB24(par->extradata) != 1 && AV_RB32(par->extradata) != 1)
+        length_size = ((par->extradata[0] & 6) >> 1) + 1;
+
+    while (end - p > 2) {
+        int size, type;
+
+        if (length_size) {
+            if (end - p < length_size)
+                break;
+            size = 0;
+            for (int i = 0; i < length_size; i++)
+                size = (size << 8) | *p++;
+            if (size < 2 || size > end - p)
+                break;
+        } else {
+            if (AV_RB24(p) != 1) {
+                p++;
+                continue;
+            }
+            p   += 3;
+            size = end - p;
+        }
+        if (size < 2)
+            break;
+
+        type = p[1] >> 3;
+        if (type <= VVC_RSV_IRAP_11)
+            return type == VVC_IDR_W_RADL || type == VVC_IDR_N_LP;
+        p += length_size ? size : 2;
+    }
+    return 0;
+}
+
+static uint32_t frame_checksum(const AVFrame *frame)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(frame->format);
+    const int nb_planes            = av_pix_fmt_count_planes(frame->format);
+    uint32_t checksum              = 0;
+
+    for (int i = 0; i < nb_planes; i++) {
+        const int width  = av_image_get_linesize(frame->format, frame->width, i);
+        const int height = i == 1 || i == 2 ? AV_CEIL_RSHIFT(frame->height, desc->log2_chroma_h) :
+                                              frame->height;
+
+        for (int y = 0; y < height; y++)
+            checksum = av_adler32_update(checksum, frame->data[i] + y * frame->linesize[i], width);
+    }
+    return checksum;
+}
+
+static int receive_frames(AVCodecContext *dec, AVFrame *frame, Chunk *c)
+{
+    int ret;
+
+    while ((ret = avcodec_receive_frame(dec, frame)) >= 0) {
+        FrameInfo *f = av_fast_realloc(c->frames, &c->frames_size, (c->nb_frames + 1) * sizeof(*c->frames));
+
+        if (!f) {
+            av_frame_unref(frame);
+            return AVERROR(ENOMEM);
+        }
+        c->frames = f;
+        f += c->nb_frames++;
+
+        f->pts      = frame->pts;
+        f->checksum = frame_checksum(frame);
+        av_frame_unref(frame);
+    }
+    return ret == AVERROR(EAGAIN) || ret == AVERROR_EOF ? 0 : ret;
+}
+
+static int decode_chunk(AVCodecContext *dec, AVFrame *frame, Chunk *c)
+{
+    int ret = 0;
+
+    for (int i = 0; i < c->nb_pkts && ret >= 0; i++) {
+        ret = avcodec_send_packet(dec, c->pkts[i]);
+        if (ret >= 0)
+            ret = receive_frames(dec, frame, c);
+    }
+    if (ret >= 0)
+        ret = avcodec_send_packet(dec, NULL);
+    if (ret >= 0)
+        ret = receive_frames(dec, frame, c);
+
+    // start the next chunk from a clean state
+    avcodec_flush_buffers(dec);
+    return ret;
+}
+
+static void *worker(void *arg)
+{
+    ChunkDecoder *cd = arg;
+    const AVCodec *codec = avcodec_find_decoder(cd->par->codec_id);
+    AVCodecContext *dec  = avcodec_alloc_context3(codec);
+    AVFrame *frame       = av_frame_alloc();
+    int ret              = AVERROR(ENOMEM);
+
+    if (dec && frame) {
+        ret = avcodec_parameters_to_context(dec, cd->par);
+        if (ret >= 0) {
+            dec->thread_count          = cd->threads;
+            dec->strict_std_compliance = FF_COMPLIANCE_EXPERIMENTAL;
+            ret = avcodec_open2(dec, codec, NULL);
+        }
+    }
+
+    pthread_mutex_lock(&cd->lock);
+    for (;;) {
+        Chunk *c;
+
+        while (cd->next_decode == cd->nb_queued && !cd->eof)
+            pthread_cond_wait(&cd->cond, &cd->lock);
+        if (cd->next_decode == cd->nb_queued)
+            break;
+        c = &cd->chunks[cd->next_decode++ % cd->nb_chunks];
+        pthread_mutex_unlock(&cd->lock);
+
+        c->ret = ret < 0 ? ret : decode_chunk(dec, frame, c);
+
+        pthread_mutex_lock(&cd->lock);
+        c->done = 1;
+        pthread_cond_broadcast(&cd->cond);
+    }
+    pthread_mutex_unlock(&cd->lock);
+
+    av_frame_free(&frame);
+    avcodec_free_context(&dec);
+    return NULL;
+}
+
+static void chunk_reset(Chunk *c)
+{
+    for (int i = 0; i < c->nb_pkts; i++)
+        av_packet_free(&c->pkts[i]);
+    c->nb_pkts   = 0;
+    c->nb_frames = 0;
+    c->done      = 0;
+    c->ret       = 0;
+}
+
+static int compare_pts(const void *a, const void *b)
+{
+    const FrameInfo *fa = a, *fb = b;
+
+    return FFDIFFSIGN(fa->pts, fb->pts);
+}
+
+/**
+ * Wait for the oldest chunk to be decoded and print its frames.
+ */
+static int print_chunk(ChunkDecoder *cd)
+{
+    Chunk *c = &cd->chunks[cd->next_print % cd->nb_chunks];
+    int ret;
+
+    pthread_mutex_lock(&cd->lock);
+    while (!c->done)
+        pthread_cond_wait(&cd->cond, &cd->lock);
+    pthread_mutex_unlock(&cd->lock);
+
+    ret = c->ret;
+    if (ret < 0) {
+        fprintf(stderr, "Error decoding chunk %d: %s\n", cd->next_print, av_err2str(ret));
+    } else {
+        // frames are returned in presentation order within a chunk, unless the timestamps are broken
+        qsort(c->frames, c->nb_frames, sizeof(*c->frames), compare_pts);
+        for (int i = 0; i < c->nb_frames; i++)
+            printf("%"PRId64", %d, %"PRId64", 0x%08"PRIx32"\n",
+                   cd->nb_frames++, cd->next_print, c->frames[i].pts, c->frames[i].checksum);
+    }
+
+    chunk_reset(c);
+    cd->next_print++;
+    return ret;
+}
+
+static int submit_chunk(ChunkDecoder *cd)
+{
+    int ret = 0;
+
+    pthread_mutex_lock(&cd->lock);
+    cd->nb_queued++;
+    pthread_cond_broadcast(&cd->cond);
+    pthread_mutex_unlock(&cd->lock);
+
+    // the ring is full once the next chunk to fill is the next to print
+    if (cd->nb_queued - cd->next_print == cd->nb_chunks)
+        ret = print_chunk(cd);
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    ChunkDecoder cd = { 0 };
+    AVFormatContext *fmt = NULL;
+    pthread_t workers[MAX_WORKERS];
+    AVPacket *pkt = NULL;
+    int nb_workers, stream_idx, nb_started = 0;
+    int64_t wall;
+    int ret;
+
+    if (argc <= 2) {
+        fprintf(stderr, "Usage: %s <input file> <stream index> [<workers> [<threads per decoder>]]\n"
+                "Prints frame number, chunk, pts and adler32 of the decoded frames.\n", argv[0]);
+        return 0;
+    }
+
+    stream_idx = strtol(argv[2], NULL, 0);
+    nb_workers = argc > 3 ? strtol(argv[3], NULL, 0) : av_cpu_count();
+    nb_workers = av_clip(nb_workers, 1, MAX_WORKERS);
+    cd.threads = argc > 4 ? FFMAX(strtol(argv[4], NULL, 0), 0) : 1;
+
+    ret = avformat_open_input(&fmt, argv[1], NULL, NULL);
+    if (ret < 0) {
+        fprintf(stderr, "Error opening %s: %s\n", argv[1], av_err2str(ret));
+        return 1;
+    }
+    pthread_mutex_init(&cd.lock, NULL);
+    pthread_cond_init(&cd.cond, NULL);
+
+    ret = avformat_find_stream_info(fmt, NULL);
+    if (ret < 0)
+        goto finish;
+    if (stream_idx < 0 || stream_idx >= fmt->nb_streams) {
+        fprintf(stderr, "No stream %d in %s\n", stream_idx, argv[1]);
+        ret = AVERROR(EINVAL);
+        goto finish;
+    }
+    for (int i = 0; i < fmt->nb_streams; i++)
+        fmt->streams[i]->discard = i == stream_idx ? AVDISCARD_DEFAULT : AVDISCARD_ALL;
+    cd.par = fmt->streams[stream_idx]->codecpar;
+    if (!avcodec_find_decoder(cd.par->codec_id)) {
+        fprintf(stderr, "No decoder for stream %d\n", stream_idx);
+        ret = AVERROR_DECODER_NOT_FOUND;
+        goto finish;
+    }
+
+    // two chunks per worker, so the workers keep busy while the oldest one is printed
+    cd.nb_chunks = 2 * nb_workers;
+    cd.chunks    = av_calloc(cd.nb_chunks, sizeof(*cd.chunks));
+    pkt          = av_packet_alloc();
+    if (!cd.chunks || !pkt) {
+        ret = AVERROR(ENOMEM);
+        goto finish;
+    }
+
+    for (; nb_started < nb_workers; nb_started++) {
+        if (pthread_create(&workers[nb_started], NULL, worker, &cd)) {
+            ret = AVERROR(ENOMEM);
+            goto finish;
+        }
+    }
+
+    wall = av_gettime_relative();
+    while ((ret = av_read_frame(fmt, pkt)) >= 0) {
+        Chunk *c = &cd.chunks[cd.nb_queued % cd.nb_chunks];
+        AVPacket **pkts;
+
+        if (pkt->stream_index != stream_idx) {
+            av_packet_unref(pkt);
+            continue;
+        }
+
+        if (c->nb_pkts && starts_closed_gop(cd.par, pkt)) {
+            ret = submit_chunk(&cd);
+            if (ret < 0)
+                goto finish;
+            c = &cd.chunks[cd.nb_queued % cd.nb_chunks];
+        }
+
+        pkts = av_fast_realloc(c->pkts, &c->pkts_size, (c->nb_pkts + 1) * sizeof(*c->pkts));
+        if (!pkts) {
+            ret = AVERROR(ENOMEM);
+            goto finish;
+        }
+        c->pkts = pkts;
+        c->pkts[c->nb_pkts] = av_packet_alloc();
+        if (!c->pkts[c->nb_pkts]) {
+            ret = AVERROR(ENOMEM);
+            goto finish;
+        }
+        av_packet_move_ref(c->pkts[c->nb_pkts++], pkt);
+    }
+    if (ret != AVERROR_EOF)
+        goto finish;
+
+    ret = 0;
+    if (cd.chunks[cd.nb_queued % cd.nb_chunks].nb_pkts)
+        ret = submit_chunk(&cd);
+    while (ret >= 0 && cd.next_print < cd.nb_queued)
+        ret = print_chunk(&cd);
+
+    if (ret >= 0) {
+        wall = av_gettime_relative() - wall;
+        fprintf(stderr, "%"PRId64" frames in %d chunks, %d workers: %.3f fps\n", cd.nb_frames,
+                cd.nb_queued, nb_workers, wall ? cd.nb_frames * 1000000.0 / wall : 0);
+    }
+
+finish:
+    if (ret < 0 && ret != AVERROR_EOF)
+        fprintf(stderr, "Error: %s\n", av_err2str(ret));
+
+    if (nb_started) {
+        pthread_mutex_lock(&cd.lock);
+        cd.eof = 1;
+        pthread_cond_broadcast(&cd.cond);
+        pthread_mutex_unlock(&cd.lock);
+        for (int i = 0; i < nb_started; i++)
+            pthread_join(workers[i], NULL);
+    }
+    pthread_mutex_destroy(&cd.lock);
+    pthread_cond_destroy(&cd.cond);
+    if (cd.chunks) {
+        for (int i = 0; i < cd.nb_chunks; i++) {
+            chunk_reset(&cd.chunks[i]);
+            av_freep(&cd.chunks[i].pkts);
+            av_freep(&cd.chunks[i].frames);
+        }
+        av_freep(&cd.chunks);
+    }
+    av_packet_free(&pkt);
+    avformat_close_input(&fmt);
+    return ret < 0;
+}
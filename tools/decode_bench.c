@@ -0,0 +1,194 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Decode a stream at several thread counts and print one JSON object per
+ * thread count with the speed, the CPU time and the memory used.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#if HAVE_SYS_RESOURCE_H
+#include <sys/time.h>
+#include <sys/resource.h>
+#endif
+
+#include "decode_simple.h"
+
+#include "libavutil/common.h"
+#include "libavutil/cpu.h"
+#include "libavutil/dict.h"
+#include "libavutil/error.h"
+#include "libavutil/time.h"
+
+#include "libavformat/avformat.h"
+
+#include "libavcodec/avcodec.h"
+
+typedef struct BenchResult {
+    int64_t frames;
+    int64_t wall;           ///< microseconds
+    int64_t cpu;            ///< microseconds, user and system
+    int64_t max_rss;        ///< bytes, the peak of the process so far
+} BenchResult;
+
+static int64_t cpu_time(void)
+{
+#if HAVE_GETRUSAGE
+    struct rusage rusage;
+
+    getrusage(RUSAGE_SELF, &rusage);
+    return (rusage.ru_utime.tv_sec + rusage.ru_stime.tv_sec) * 1000000LL +
+           rusage.ru_utime.tv_usec + rusage.ru_stime.tv_usec;
+#else
+    return 0;
+#endif
+}
+
+static int64_t max_rss(void)
+{
+#if HAVE_GETRUSAGE && HAVE_STRUCT_RUSAGE_RU_MAXRSS
+    struct rusage rusage;
+
+    getrusage(RUSAGE_SELF, &rusage);
+    return (int64_t)rusage.ru_maxrss * 1024;
+#else
+    return 0;
+#endif
+}
+
+static int process_frame(DecodeContext *dc, AVFrame *frame)
+{
+    return 0;
+}
+
+static int bench(BenchResult *r, const char *filename, int stream_idx,
+                 int threads, const AVDictionary *opts)
+{
+    DecodeContext dc;
+    int64_t wall, cpu;
+    int ret;
+
+    ret = ds_open(&dc, filename, stream_idx);
+    if (ret < 0)
+        goto finish;
+
+    dc.process_frame = process_frame;
+
+    ret = av_dict_copy(&dc.decoder_opts, opts, 0);
+    if (ret >= 0)
+        ret = av_dict_set_int(&dc.decoder_opts, "threads", threads, 0);
+    if (ret < 0)
+        goto finish;
+
+    wall = av_gettime_relative();
+    cpu  = cpu_time();
+    ret  = ds_run(&dc);
+    if (ret < 0)
+        goto finish;
+
+    r->wall    = av_gettime_relative() - wall;
+    r->cpu     = cpu_time() - cpu;
+    r->frames  = dc.decoder->frame_num;
+    r->max_rss = max_rss();
+
+finish:
+    ds_free(&dc);
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    AVDictionary *opts = NULL;
+    const char *filename, *threads_list = NULL;
+    int stream_idx, nb_threads = 0, threads[64];
+    double base = 0;
+    int ret = 0;
+
+    if (argc <= 2) {
+        fprintf(stderr, "Usage: %s <input file> <stream index> [<thread counts> [<decoder options>]]\n"
+                "The thread counts are separated by commas; if empty they default to the powers of 2\n"
+                "up to the number of CPUs, the decoder options are key=value pairs separated by colons.\n", argv[0]);
+        return 0;
+    }
+
+    filename   = argv[1];
+    stream_idx = strtol(argv[2], NULL, 0);
+    if (argc > 3 && *argv[3])
+        threads_list = argv[3];
+    if (argc > 4) {
+        ret = av_dict_parse_string(&opts, argv[4], "=", ":", 0);
+        if (ret < 0) {
+            fprintf(stderr, "Invalid decoder options: %s\n", argv[4]);
+            goto finish;
+        }
+    }
+
+    if (threads_list) {
+        const char *p = threads_list;
+
+        while (*p && nb_threads < FF_ARRAY_ELEMS(threads)) {
+            char *end;
+            const long n = strtol(p, &end, 10);
+
+            if (end == p || n <= 0) {
+                fprintf(stderr, "Invalid thread counts: %s\n", threads_list);
+                ret = AVERROR(EINVAL);
+                goto finish;
+            }
+            threads[nb_threads++] = n;
+            p = *end == ',' ? end + 1 : end;
+        }
+    } else {
+        const int cpus = av_cpu_count();
+
+        for (int n = 1; n < cpus && nb_threads < FF_ARRAY_ELEMS(threads) - 1; n *= 2)
+            threads[nb_threads++] = n;
+        threads[nb_threads++] = cpus;
+    }
+
+    for (int i = 0; i < nb_threads; i++) {
+        BenchResult r = { 0 };
+        double fps;
+
+        ret = bench(&r, filename, stream_idx, threads[i], opts);
+        if (ret < 0) {
+            fprintf(stderr, "Error decoding %s with %d threads: %s\n",
+                    filename, threads[i], av_err2str(ret));
+            goto finish;
+        }
+
+        fps = r.wall ? r.frames * 1000000.0 / r.wall : 0;
+        // the efficiency is the speedup over the first thread count, per thread
+        if (!i)
+            base = fps / threads[0];
+        printf("{\"file\":\"%s\",\"threads\":%d,\"frames\":%"PRId64",\"wall_s\":%.6f,"
+               "\"cpu_s\":%.6f,\"fps\":%.3f,\"max_rss_bytes\":%"PRId64",\"efficiency\":%.4f}\n",
+               filename, threads[i], r.frames, r.wall / 1000000.0, r.cpu / 1000000.0,
+               fps, r.max_rss, base ? fps / (base * threads[i]) : 0);
+        fflush(stdout);
+    }
+
+finish:
+    av_dict_free(&opts);
+    return ret < 0;
+}
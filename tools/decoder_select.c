@@ -0,0 +1,248 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Decode the first GOP of a stream with every candidate decoder, print one
+ * JSON object per decoder with its speed and a last one naming the fastest,
+ * so a pipeline can pick the decoder per title, e.g. the native vvc decoder
+ * or libvvdec.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "decode_simple.h"
+
+#include "libavutil/avstring.h"
+#include "libavutil/error.h"
+#include "libavutil/mem.h"
+#include "libavutil/time.h"
+
+#include "libavformat/avformat.h"
+
+#include "libavcodec/avcodec.h"
+
+#define MAX_DECODERS    16
+#define MAX_GOP_FRAMES  1024
+
+static int process_frame(DecodeContext *dc, AVFrame *frame)
+{
+    return 0;
+}
+
+/**
+ * Count the packets of the stream before its second key frame, i.e. the
+ * frames of the first GOP.
+ */
+static int first_gop_frames(const char *filename, int stream_idx)
+{
+    AVFormatContext *fmt = NULL;
+    AVPacket *pkt = av_packet_alloc();
+    int nb_pkts = 0, nb_keys = 0;
+    int ret;
+
+    if (!pkt)
+        return AVERROR(ENOMEM);
+
+    ret = avformat_open_input(&fmt, filename, NULL, NULL);
+    if (ret < 0)
+        goto finish;
+
+    while (nb_pkts < MAX_GOP_FRAMES && (ret = av_read_frame(fmt, pkt)) >= 0) {
+        if (pkt->stream_index == stream_idx) {
+            nb_keys += !!(pkt->flags & AV_PKT_FLAG_KEY);
+            if (nb_keys > 1) {
+                av_packet_unref(pkt);
+                break;
+            }
+            nb_pkts++;
+        }
+        av_packet_unref(pkt);
+    }
+    ret = (ret >= 0 || ret == AVERROR_EOF) ? nb_pkts : ret;
+
+finish:
+    av_packet_free(&pkt);
+    avformat_close_input(&fmt);
+    return ret;
+}
+
+static int time_decoder(const char *filename, int stream_idx, const AVCodec *codec,
+                        int max_frames, const AVDictionary *opts,
+                        int64_t *frames, int64_t *wall)
+{
+    DecodeContext dc;
+    int64_t start;
+    int ret;
+
+    ret = ds_open(&dc, filename, stream_idx);
+    if (ret < 0)
+        return ret;
+
+    dc.process_frame = process_frame;
+    dc.max_frames    = max_frames;
+
+    // replace the default decoder ds_open() created by the candidate
+    avcodec_free_context(&dc.decoder);
+    dc.decoder = avcodec_alloc_context3(codec);
+    if (!dc.decoder) {
+        ret = AVERROR(ENOMEM);
+        goto finish;
+    }
+    ret = avcodec_parameters_to_context(dc.decoder, dc.stream->codecpar);
+    if (ret < 0)
+        goto finish;
+    dc.decoder->strict_std_compliance = FF_COMPLIANCE_EXPERIMENTAL;
+
+    ret = av_dict_copy(&dc.decoder_opts, opts, 0);
+    if (ret < 0)
+        goto finish;
+
+    start = av_gettime_relative();
+    ret   = ds_run(&dc);
+    if (ret < 0)
+        goto finish;
+
+    *wall   = av_gettime_relative() - start;
+    *frames = dc.decoder->frame_num;
+
+finish:
+    ds_free(&dc);
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    AVFormatContext *fmt = NULL;
+    AVDictionary *opts = NULL;
+    const AVCodec *decoders[MAX_DECODERS];
+    const char *filename, *best = NULL;
+    double best_fps = 0;
+    int stream_idx, nb_decoders = 0, max_frames;
+    int ret = 0;
+
+    if (argc <= 2) {
+        fprintf(stderr, "Usage: %s <input file> <stream index> [<decoders> [<decoder options>]]\n"
+                "The decoders are separated by commas; if empty they default to all the decoders\n"
+                "for the codec of the stream, the decoder options are key=value pairs separated\n"
+                "by colons.\n", argv[0]);
+        return 0;
+    }
+
+    filename   = argv[1];
+    stream_idx = strtol(argv[2], NULL, 0);
+    if (argc > 4) {
+        ret = av_dict_parse_string(&opts, argv[4], "=", ":", 0);
+        if (ret < 0) {
+            fprintf(stderr, "Invalid decoder options: %s\n", argv[4]);
+            goto finish;
+        }
+    }
+
+    ret = avformat_open_input(&fmt, filename, NULL, NULL);
+    if (ret < 0) {
+        fprintf(stderr, "Error opening %s: %s\n", filename, av_err2str(ret));
+        goto finish;
+    }
+    if (stream_idx < 0 || stream_idx >= fmt->nb_streams) {
+        fprintf(stderr, "Invalid stream index %d\n", stream_idx);
+        ret = AVERROR(EINVAL);
+        goto finish;
+    }
+
+    if (argc > 3 && *argv[3]) {
+        char *list = av_strdup(argv[3]), *saveptr = NULL;
+
+        if (!list) {
+            ret = AVERROR(ENOMEM);
+            goto finish;
+        }
+        for (char *name = av_strtok(list, ",", &saveptr); name && nb_decoders < MAX_DECODERS;
+             name = av_strtok(NULL, ",", &saveptr)) {
+            const AVCodec *codec = avcodec_find_decoder_by_name(name);
+
+            if (!codec || codec->id != fmt->streams[stream_idx]->codecpar->codec_id) {
+                fprintf(stderr, "Decoder %s not found for the stream\n", name);
+                av_free(list);
+                ret = AVERROR_DECODER_NOT_FOUND;
+                goto finish;
+            }
+            decoders[nb_decoders++] = codec;
+        }
+        av_free(list);
+    } else {
+        const AVCodec *codec;
+        void *iter = NULL;
+
+        while ((codec = av_codec_iterate(&iter)) && nb_decoders < MAX_DECODERS)
+            if (av_codec_is_decoder(codec) &&
+                codec->id == fmt->streams[stream_idx]->codecpar->codec_id &&
+                !(codec->capabilities & AV_CODEC_CAP_HARDWARE))
+                decoders[nb_decoders++] = codec;
+    }
+    if (!nb_decoders) {
+        fprintf(stderr, "No decoder for the stream\n");
+        ret = AVERROR_DECODER_NOT_FOUND;
+        goto finish;
+    }
+
+    max_frames = first_gop_frames(filename, stream_idx);
+    if (max_frames < 0) {
+        ret = max_frames;
+        fprintf(stderr, "Error reading %s: %s\n", filename, av_err2str(ret));
+        goto finish;
+    }
+
+    for (int i = 0; i < nb_decoders; i++) {
+        int64_t frames = 0, wall = 0;
+        double fps;
+        int err;
+
+        err = time_decoder(filename, stream_idx, decoders[i], max_frames, opts, &frames, &wall);
+        if (err < 0) {
+            // a decoder that cannot decode the stream is just not a candidate
+            printf("{\"file\":\"%s\",\"decoder\":\"%s\",\"error\":\"%s\"}\n",
+                   filename, decoders[i]->name, av_err2str(err));
+            continue;
+        }
+
+        fps = wall ? frames * 1000000.0 / wall : 0;
+        printf("{\"file\":\"%s\",\"decoder\":\"%s\",\"frames\":%"PRId64",\"wall_s\":%.6f,\"fps\":%.3f}\n",
+               filename, decoders[i]->name, frames, wall / 1000000.0, fps);
+        fflush(stdout);
+
+        if (frames && (!best || fps > best_fps)) {
+            best     = decoders[i]->name;
+            best_fps = fps;
+        }
+    }
+
+    if (!best) {
+        fprintf(stderr, "No decoder could decode %s\n", filename);
+        ret = AVERROR_INVALIDDATA;
+        goto finish;
+    }
+    printf("{\"file\":\"%s\",\"best\":\"%s\"}\n", filename, best);
+
+finish:
+    avformat_close_input(&fmt);
+    av_dict_free(&opts);
+    return ret < 0;
+}
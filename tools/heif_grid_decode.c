@@ -0,0 +1,313 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Decode the tile grid of a HEIF image into one frame and write it as raw
+ * video. Each tile has its own decoder; a packet is sent as soon as it is
+ * read, so the tiles are decoded in parallel, on one thread pool for the
+ * decoders with shared_threads like the native vvc one. Every decoded tile
+ * is copied straight to its place in the output frame.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "libavutil/error.h"
+#include "libavutil/frame.h"
+#include "libavutil/imgutils.h"
+#include "libavutil/mem.h"
+#include "libavutil/opt.h"
+#include "libavutil/pixdesc.h"
+
+#include "libavformat/avformat.h"
+
+#include "libavcodec/avcodec.h"
+
+typedef struct Tile {
+    AVCodecContext *dec;
+    int stream_index;
+    int x, y;                       ///< position on the canvas of the grid
+} Tile;
+
+static const AVStreamGroup *find_grid(const AVFormatContext *fmt)
+{
+    const AVStreamGroup *grid = NULL;
+
+    for (int i = 0; i < fmt->nb_stream_groups; i++) {
+        const AVStreamGroup *stg = fmt->stream_groups[i];
+
+        if (stg->type != AV_STREAM_GROUP_PARAMS_TILE_GRID)
+            continue;
+        if (!grid || (stg->disposition & AV_DISPOSITION_DEFAULT))
+            grid = stg;
+    }
+    return grid;
+}
+
+static int open_decoder(AVCodecContext **pdec, const AVStream *st, const AVDictionary *opts)
+{
+    const AVCodec *codec = avcodec_find_decoder(st->codecpar->codec_id);
+    AVDictionary *dec_opts = NULL;
+    AVCodecContext *dec;
+    int ret;
+
+    if (!codec)
+        return AVERROR_DECODER_NOT_FOUND;
+    dec = *pdec = avcodec_alloc_context3(codec);
+    if (!dec)
+        return AVERROR(ENOMEM);
+    ret = avcodec_parameters_to_context(dec, st->codecpar);
+    if (ret < 0)
+        return ret;
+    dec->strict_std_compliance = FF_COMPLIANCE_EXPERIMENTAL;
+
+    ret = av_dict_copy(&dec_opts, opts, 0);
+    if (ret < 0)
+        return ret;
+    // the tiles share one pool rather than each starting one per core
+    if (av_opt_find(dec, "shared_threads", NULL, 0, AV_OPT_SEARCH_CHILDREN))
+        av_dict_set(&dec_opts, "shared_threads", "1", AV_DICT_DONT_OVERWRITE);
+
+    ret = avcodec_open2(dec, codec, &dec_opts);
+    av_dict_free(&dec_opts);
+    return ret;
+}
+
+static int alloc_output(AVFrame *out, const AVStreamGroupTileGrid *tg, enum AVPixelFormat format,
+                        enum AVColorRange range)
+{
+    ptrdiff_t linesize[4];
+    int ret;
+
+    out->format = format;
+    out->width  = tg->width;
+    out->height = tg->height;
+    ret = av_frame_get_buffer(out, 0);
+    if (ret < 0)
+        return ret;
+
+    // the grid may not cover all of the output
+    for (int i = 0; i < 4; i++)
+        linesize[i] = out->linesize[i];
+    return av_image_fill_black(out->data, linesize, format, range, out->width, out->height);
+}
+
+// copy the part of the tile in the output, its position is relative to the canvas
+static void place_tile(AVFrame *out, const AVFrame *tile, const AVStreamGroupTileGrid *tg,
+                       const int tx, const int ty)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(out->format);
+    const int x0 = FFMAX(tx, tg->horizontal_offset);
+    const int y0 = FFMAX(ty, tg->vertical_offset);
+    const int x1 = FFMIN(tx + tile->width,  tg->horizontal_offset + tg->width);
+    const int y1 = FFMIN(ty + tile->height, tg->vertical_offset + tg->height);
+
+    if (x0 >= x1 || y0 >= y1)
+        return;
+
+    for (int c = 0; c < desc->nb_components; c++) {
+        const AVComponentDescriptor *comp = desc->comp + c;
+        const int chroma = (c == 1 || c == 2) && !(desc->flags & AV_PIX_FMT_FLAG_RGB);
+        const int hs     = chroma ? desc->log2_chroma_w : 0;
+        const int vs     = chroma ? desc->log2_chroma_h : 0;
+        const int sx     = (x0 - tx) >> hs, sy = (y0 - ty) >> vs;
+        const int dx     = (x0 - tg->horizontal_offset) >> hs;
+        const int dy     = (y0 - tg->vertical_offset) >> vs;
+        const int w      = AV_CEIL_RSHIFT(x1 - tx, hs) - sx;
+        const int h      = AV_CEIL_RSHIFT(y1 - ty, vs) - sy;
+
+        // the components sharing a plane are copied with the first one
+        if (c && comp->plane == desc->comp[c - 1].plane)
+            continue;
+        av_image_copy_plane(out->data[comp->plane] + dy * out->linesize[comp->plane] + dx * comp->step,
+                            out->linesize[comp->plane],
+                            tile->data[comp->plane] + sy * tile->linesize[comp->plane] + sx * comp->step,
+                            tile->linesize[comp->plane], w * comp->step, h);
+    }
+}
+
+static int receive_tile(Tile *t, AVFrame *out, AVFrame *frame, const AVStreamGroupTileGrid *tg)
+{
+    int ret = avcodec_receive_frame(t->dec, frame);
+
+    if (ret < 0)
+        return ret;
+    if (!out->buf[0]) {
+        ret = alloc_output(out, tg, frame->format, frame->color_range);
+        if (ret < 0)
+            goto finish;
+    } else if (frame->format != out->format) {
+        fprintf(stderr, "The tiles differ in pixel format\n");
+        ret = AVERROR_PATCHWELCOME;
+        goto finish;
+    }
+    place_tile(out, frame, tg, t->x, t->y);
+
+finish:
+    av_frame_unref(frame);
+    return ret;
+}
+
+static int write_output(const char *filename, const AVFrame *out)
+{
+    const int size = av_image_get_buffer_size(out->format, out->width, out->height, 1);
+    uint8_t *buf;
+    FILE *f;
+    int ret;
+
+    if (size < 0)
+        return size;
+    buf = av_malloc(size);
+    if (!buf)
+        return AVERROR(ENOMEM);
+    ret = av_image_copy_to_buffer(buf, size, (const uint8_t * const *)out->data, out->linesize,
+                                  out->format, out->width, out->height, 1);
+    if (ret < 0)
+        goto finish;
+
+    f = fopen(filename, "wb");
+    if (!f) {
+        ret = AVERROR(errno);
+        goto finish;
+    }
+    if (fwrite(buf, 1, size, f) != size)
+        ret = AVERROR(EIO);
+    if (fclose(f) && ret >= 0)
+        ret = AVERROR(EIO);
+
+finish:
+    av_free(buf);
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    AVFormatContext *fmt = NULL;
+    AVDictionary *opts = NULL;
+    const AVStreamGroup *grid;
+    const AVStreamGroupTileGrid *tg;
+    Tile *tiles = NULL;
+    AVPacket *pkt = NULL;
+    AVFrame *frame = NULL, *out = NULL;
+    int nb_tiles = 0;
+    int ret = 0;
+
+    if (argc <= 2) {
+        fprintf(stderr, "Usage: %s <input file> <output file> [<decoder options>]\n"
+                "The tile grid of the input, the default one if there are several, is written\n"
+                "as raw video. The decoder options are key=value pairs separated by colons.\n",
+                argv[0]);
+        return 0;
+    }
+
+    if (argc > 3) {
+        ret = av_dict_parse_string(&opts, argv[3], "=", ":", 0);
+        if (ret < 0) {
+            fprintf(stderr, "Invalid decoder options: %s\n", argv[3]);
+            goto finish;
+        }
+    }
+
+    ret = avformat_open_input(&fmt, argv[1], NULL, NULL);
+    if (ret < 0) {
+        fprintf(stderr, "Error opening %s: %s\n", argv[1], av_err2str(ret));
+        goto finish;
+    }
+    ret = avformat_find_stream_info(fmt, NULL);
+    if (ret < 0)
+        goto finish;
+
+    grid = find_grid(fmt);
+    if (!grid) {
+        fprintf(stderr, "No tile grid in %s\n", argv[1]);
+        ret = AVERROR_INVALIDDATA;
+        goto finish;
+    }
+    tg = grid->params.tile_grid;
+
+    pkt   = av_packet_alloc();
+    frame = av_frame_alloc();
+    out   = av_frame_alloc();
+    tiles = av_calloc(tg->nb_tiles, sizeof(*tiles));
+    if (!pkt || !frame || !out || !tiles) {
+        ret = AVERROR(ENOMEM);
+        goto finish;
+    }
+
+    for (; nb_tiles < tg->nb_tiles; nb_tiles++) {
+        const AVStream *st = grid->streams[tg->offsets[nb_tiles].idx];
+        Tile *t            = tiles + nb_tiles;
+
+        t->stream_index = st->index;
+        t->x            = tg->offsets[nb_tiles].horizontal;
+        t->y            = tg->offsets[nb_tiles].vertical;
+        ret = open_decoder(&t->dec, st, opts);
+        if (ret < 0) {
+            fprintf(stderr, "Error opening the decoder of stream %d: %s\n", st->index, av_err2str(ret));
+            nb_tiles++;
+            goto finish;
+        }
+    }
+
+    // the decoding starts with the send, so the tiles read first decode while the others are read;
+    // a stream placed several times is decoded once per place
+    while ((ret = av_read_frame(fmt, pkt)) >= 0) {
+        for (int i = 0; i < nb_tiles && ret >= 0; i++) {
+            if (tiles[i].stream_index == pkt->stream_index)
+                ret = avcodec_send_packet(tiles[i].dec, pkt);
+        }
+        av_packet_unref(pkt);
+        if (ret < 0)
+            goto finish;
+    }
+    if (ret != AVERROR_EOF)
+        goto finish;
+
+    for (int i = 0; i < nb_tiles; i++) {
+        ret = avcodec_send_packet(tiles[i].dec, NULL);
+        if (ret < 0)
+            goto finish;
+    }
+    for (int i = 0; i < nb_tiles; i++) {
+        ret = receive_tile(tiles + i, out, frame, tg);
+        if (ret < 0) {
+            fprintf(stderr, "Error decoding tile %d: %s\n", i, av_err2str(ret));
+            goto finish;
+        }
+    }
+
+    ret = write_output(argv[2], out);
+    if (ret < 0) {
+        fprintf(stderr, "Error writing %s: %s\n", argv[2], av_err2str(ret));
+        goto finish;
+    }
+    printf("%dx%d %s, %d tiles\n", out->width, out->height,
+           av_get_pix_fmt_name(out->format), nb_tiles);
+
+finish:
+    for (int i = 0; i < nb_tiles; i++)
+        avcodec_free_context(&tiles[i].dec);
+    av_freep(&tiles);
+    av_frame_free(&out);
+    av_frame_free(&frame);
+    av_packet_free(&pkt);
+    avformat_close_input(&fmt);
+    av_dict_free(&opts);
+    return ret < 0;
+}
@@ -0,0 +1,162 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Decode a VVC stream with the replay option, which runs the stages after
+ * the parse again on each decoded frame, and print one JSON object per stage
+ * with the time of its replays.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "decode_simple.h"
+
+#include "libavutil/avstring.h"
+#include "libavutil/common.h"
+#include "libavutil/dict.h"
+#include "libavutil/error.h"
+
+#include "libavformat/avformat.h"
+
+#include "libavcodec/avcodec.h"
+
+#define MAX_STAGES 16
+
+typedef struct ReplayStage {
+    char    name[32];
+    int64_t replay;         ///< microseconds, all the frames and iterations
+} ReplayStage;
+
+typedef struct ReplayBench {
+    ReplayStage stages[MAX_STAGES];
+    int nb_stages;
+    int64_t frames;
+} ReplayBench;
+
+// the decoder exports the times as lavc.vvc.<stage>.replay
+static int process_frame(DecodeContext *dc, AVFrame *frame)
+{
+    static const char prefix[] = "lavc.vvc.", suffix[] = ".replay";
+    ReplayBench *rb = dc->opaque;
+    const AVDictionaryEntry *e = NULL;
+
+    if (!frame)
+        return 0;
+
+    while ((e = av_dict_iterate(frame->metadata, e))) {
+        const size_t len = strlen(e->key);
+        const char *name;
+        size_t name_len;
+        int i;
+
+        if (!av_strstart(e->key, prefix, &name) || len < sizeof(prefix) + sizeof(suffix) - 2 ||
+            strcmp(e->key + len - sizeof(suffix) + 1, suffix))
+            continue;
+        name_len = len - (sizeof(prefix) - 1) - (sizeof(suffix) - 1);
+        if (name_len >= sizeof(rb->stages[0].name))
+            continue;
+
+        for (i = 0; i < rb->nb_stages; i++) {
+            if (!strncmp(rb->stages[i].name, name, name_len) && !rb->stages[i].name[name_len])
+                break;
+        }
+        if (i == rb->nb_stages) {
+            if (rb->nb_stages == MAX_STAGES)
+                continue;
+            av_strlcpy(rb->stages[i].name, name, name_len + 1);
+            rb->nb_stages++;
+        }
+        rb->stages[i].replay += strtoll(e->value, NULL, 10);
+    }
+    rb->frames++;
+
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    DecodeContext dc;
+    ReplayBench rb = { 0 };
+    const char *filename, *stages = "inter+recon+lmcs+deblock+sao+alf";
+    int stream_idx, iterations = 10;
+    int ret = 0;
+
+    if (argc <= 2) {
+        fprintf(stderr, "Usage: %s <input file> <stream index> [<iterations> [<stages> [<decoder options>]]]\n"
+                "The stages are the flags of the replay_stages option of the VVC decoder, all by default,\n"
+                "the decoder options are key=value pairs separated by colons.\n", argv[0]);
+        return 0;
+    }
+
+    filename   = argv[1];
+    stream_idx = strtol(argv[2], NULL, 0);
+    if (argc > 3 && *argv[3])
+        iterations = strtol(argv[3], NULL, 0);
+    if (argc > 4 && *argv[4])
+        stages = argv[4];
+    if (iterations <= 0) {
+        fprintf(stderr, "Invalid number of iterations: %s\n", argv[3]);
+        return 1;
+    }
+
+    ret = ds_open(&dc, filename, stream_idx);
+    if (ret < 0)
+        goto finish;
+
+    dc.process_frame = process_frame;
+    dc.opaque        = &rb;
+
+    if (argc > 5) {
+        ret = av_dict_parse_string(&dc.decoder_opts, argv[5], "=", ":", 0);
+        if (ret < 0) {
+            fprintf(stderr, "Invalid decoder options: %s\n", argv[5]);
+            goto finish;
+        }
+    }
+    ret = av_dict_set_int(&dc.decoder_opts, "replay", iterations, 0);
+    if (ret >= 0)
+        ret = av_dict_set(&dc.decoder_opts, "replay_stages", stages, 0);
+    if (ret < 0)
+        goto finish;
+
+    ret = ds_run(&dc);
+    if (ret < 0) {
+        fprintf(stderr, "Error decoding %s: %s\n", filename, av_err2str(ret));
+        goto finish;
+    }
+
+    // the stages that were not replayed have no time
+    for (int i = 0; i < rb.nb_stages; i++) {
+        const ReplayStage *st = &rb.stages[i];
+        const int64_t runs    = rb.frames * iterations;
+
+        if (!st->replay)
+            continue;
+        printf("{\"file\":\"%s\",\"stage\":\"%s\",\"frames\":%"PRId64",\"iterations\":%d,"
+               "\"replay_s\":%.6f,\"us_per_frame\":%.3f}\n",
+               filename, st->name, rb.frames, iterations, st->replay / 1000000.0,
+               runs ? (double)st->replay / runs : 0);
+    }
+
+finish:
+    ds_free(&dc);
+    return ret < 0;
+}
@@ -37,6 +37,11 @@
   * Run fuzzing:
     ./target_dec_fuzzer -max_len=100000 CORPUS
 
+  * To also catch inputs which decode disproportionately slowly, set a time
+    budget in microseconds per input byte; an input exceeding it aborts, so
+    the fuzzer keeps it like a crash:
+    FFMPEG_FUZZ_TIME_PER_BYTE=20 ./target_dec_fuzzer -max_len=100000 CORPUS
+
    More info:
    http://libfuzzer.info
    http://tutorial.libfuzzer.info
@@ -52,6 +57,7 @@
 #include "libavutil/imgutils.h"
 #include "libavutil/intreadwrite.h"
 #include "libavutil/mem.h"
+#include "libavutil/time.h"
 
 #include "libavcodec/avcodec.h"
 #include "libavcodec/bytestream.h"
@@ -103,6 +109,18 @@ static int audio_video_handler(AVCodecContext *avctx, AVFrame *frame,
 // Ensure we don't loop forever
 const uint32_t maxiteration = 8096;
 
+// Microseconds of decoding allowed per input byte, 0 disables the check
+static int64_t time_per_byte;
+
+static void check_time_budget(int64_t deadline, size_t size)
+{
+    if (av_gettime_relative() > deadline) {
+        fprintf(stderr, "time budget of %"PRId64" us per byte exceeded, %zu bytes\n",
+                time_per_byte, size);
+        abort();
+    }
+}
+
 static const uint64_t FUZZ_TAG = 0x4741542D5A5A5546ULL;
 
 static int fuzz_video_get_buffer(AVCodecContext *ctx, AVFrame *frame)
@@ -178,6 +196,10 @@ int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
     uint64_t keyframes = 0;
     uint64_t flushpattern = -1;
     AVDictionary *opts = NULL;
+    // a fixed allowance covers the decoder setup, which does not depend on the input
+    const int64_t deadline = time_per_byte > 0 ?
+                             av_gettime_relative() + 100000 + (int64_t)size * time_per_byte : INT64_MAX;
+    const size_t input_size = size;
 
     if (!c) {
 #ifdef FFMPEG_DECODER
@@ -196,6 +218,9 @@ int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
         c = AVCodecInitialize(FFMPEG_CODEC);  // Done once.
 #endif
         av_log_set_level(AV_LOG_PANIC);
+
+        if (getenv("FFMPEG_FUZZ_TIME_PER_BYTE"))
+            time_per_byte = strtoll(getenv("FFMPEG_FUZZ_TIME_PER_BYTE"), NULL, 10);
     }
 
     switch (c->p.type) {
@@ -310,6 +335,7 @@ int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
     case AV_CODEC_ID_VP6A:        maxpixels  /= 4096;  break;
     case AV_CODEC_ID_VP7:         maxpixels  /= 256;   break;
     case AV_CODEC_ID_VP9:         maxpixels  /= 4096;  break;
+    case AV_CODEC_ID_VVC:         maxpixels  /= 4096;  break;
     case AV_CODEC_ID_WAVPACK:     maxsamples /= 1024;  break;
     case AV_CODEC_ID_WCMV:        maxpixels  /= 1024;  break;
     case AV_CODEC_ID_WMV3IMAGE:   maxpixels  /= 8192;  break;
@@ -457,6 +483,10 @@ int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
             ctx->width = ctx->height = 0;
     }
 
+    // thousands of tiny slices per picture only make the decoding slow
+    if (c->p.id == AV_CODEC_ID_VVC)
+        av_dict_set_int(&opts, "max_slices", 256, 0);
+
     int res = avcodec_open2(ctx, &c->p, &opts);
     if (res < 0) {
         avcodec_free_context(&ctx);
@@ -550,6 +580,7 @@ int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
             av_frame_unref(frame);
             int ret = decode_handler(ctx, frame, &got_frame, avpkt);
 
+            check_time_budget(deadline, input_size);
             ec_pixels += (ctx->width + 32LL) * (ctx->height + 32LL);
             if (it > 20 || ec_pixels > 4 * ctx->max_pixels) {
                 ctx->error_concealment = 0;
@@ -592,6 +623,7 @@ maximums_reached:
         got_frame = 0;
         av_frame_unref(frame);
         decode_handler(ctx, frame, &got_frame, avpkt);
+        check_time_budget(deadline, input_size);
 
         nb_samples += frame->nb_samples;
         if (nb_samples > maxsamples)